@@ -7,19 +7,49 @@ struct FrameCB {
     float3 Gravity;
     float WindStrength;
     float3 WindDirection;
-    float Padding;
+    float FurScale;
+    float4 OsmLayerEnds;
+    uint OsmLayerCount;
+    float ImpostorBlend;
+    uint ShellInstances;
+    uint ImpostorLayers;
+    uint DirectionalLights;
+    uint ClusterTilesX;
+    uint ClusterTilesY;
+    uint ClusterSlices;
+    float ClusterDepthScale;
+    float ClusterDepthBias;
+    float2 LightPadding;
 };
 ConstantBuffer<FrameCB> g_Frame : register(b0);
 
+// Coat layers by reach, the outermost last (FurCoat); heights are fractions of FurLength
+struct CoatLayer {
+    float Length;
+    float Density;
+    float Thickness;
+    uint NoiseChannel;
+    float3 Color;
+    float Reach;     // Height of the layer's top shell
+    uint LastShell;  // Last instance of the layer's segment
+    uint3 LayerPadding;
+};
 struct FurCB {
-    float FurLength;
+    float FurLength; // The longest layer
     uint ShellCount;
-    float Density;
+    float Density;   // Density, Thickness and FurColor are the outermost layer's
     float Thickness;
     float3 FurColor;
-    float Padding;
+    uint ColorMap; // Heap slot of the colour map, 0xffffffff for none
+    uint LayerCount;
+    uint ShellInstances; // Of the coat draw
+    uint2 CoatPadding;
+    CoatLayer Layers[4];
 };
-ConstantBuffer<FurCB> g_Fur : register(b1);
+// One entry per material, picked by a root constant the renderer sets per draw
+StructuredBuffer<FurCB> g_FurMaterials : register(t3);
+cbuffer DrawCB : register(b1) { uint g_MaterialIndex; };
+#define g_Fur g_FurMaterials[g_MaterialIndex]
 
 struct GS_IN {
     float4 PosCS : SV_POSITION;
@@ -27,6 +57,8 @@ struct GS_IN {
     float3 NormalWS : NORMAL;
     float2 UV : TEXCOORD;
     float NormalizedHeight : HEIGHT;
+    float4 Occlusion : OCCLUSION;
+    float4 Strand : STRAND;
 };
 
 struct GS_OUT {
@@ -35,13 +67,17 @@ struct GS_OUT {
     float3 NormalWS : NORMAL;
     float2 UV : TEXCOORD;
     float NormalizedHeight : HEIGHT;
+    float4 Occlusion : OCCLUSION;
+    float4 Strand : STRAND;
+    nointerpolation uint CoatSegment : SEGMENT; // Fins show the outermost coat layer only
 };
 
-// Exactly matches Shell VS extrusion
-float4 ExtrudeTip(GS_IN v, float3 normalWS, float h) {
+// Exactly matches Shell VS extrusion, along the groomed strand
+float4 ExtrudeTip(GS_IN v, float4 strand, float h) {
     float3 posWS = v.PosWS;
+    float furLength = g_Fur.FurLength * g_Frame.FurScale * strand.w;
     
-    float3 extrusion = normalWS * h * g_Fur.FurLength;
+    float3 extrusion = strand.xyz * h * furLength;
     
     float stiffness = h * h; 
     float3 droop = g_Frame.Gravity * stiffness;
@@ -58,7 +94,7 @@ float4 ExtrudeTip(GS_IN v, float3 normalWS, float h) {
     
     float currentLen = length(combinedDisplacement);
     float3 strandDir = combinedDisplacement / currentLen;
-    float3 finalPosWS = posWS + strandDir * (h * g_Fur.FurLength);
+    float3 finalPosWS = posWS + strandDir * (h * furLength);
     
     return mul(float4(finalPosWS, 1.0f), g_Frame.ViewProj);
 }
@@ -107,25 +143,37 @@ void main(
             v[0].PosWS = input[vStart].PosWS;
             v[0].NormalWS = input[vStart].NormalWS;
             v[0].UV = input[vStart].UV;
+            v[0].Occlusion = input[vStart].Occlusion;
+            v[0].Strand = input[vStart].Strand;
+            v[0].CoatSegment = g_Fur.LayerCount - 1;
             v[0].NormalizedHeight = -0.001f; // Sink slightly to prevent Z-fighting with shells at roots
             
             v[1].PosCS = input[vEnd].PosCS;
             v[1].PosWS = input[vEnd].PosWS;
             v[1].NormalWS = input[vEnd].NormalWS;
             v[1].UV = input[vEnd].UV;
+            v[1].Occlusion = input[vEnd].Occlusion;
+            v[1].Strand = input[vEnd].Strand;
+            v[1].CoatSegment = g_Fur.LayerCount - 1;
             v[1].NormalizedHeight = -0.001f;
             
             // Tip vertices (h = 1)
-            v[2].PosCS = ExtrudeTip(input[vStart], input[vStart].NormalWS, 1.0f); 
+            v[2].PosCS = ExtrudeTip(input[vStart], input[vStart].Strand, 1.0f); 
             v[2].PosWS = input[vStart].PosWS; // Not used for lighting
             v[2].NormalWS = input[vStart].NormalWS;
             v[2].UV = input[vStart].UV;
+            v[2].Occlusion = input[vStart].Occlusion;
+            v[2].Strand = input[vStart].Strand;
+            v[2].CoatSegment = g_Fur.LayerCount - 1;
             v[2].NormalizedHeight = 1.0f;
             
-            v[3].PosCS = ExtrudeTip(input[vEnd], input[vEnd].NormalWS, 1.0f);
+            v[3].PosCS = ExtrudeTip(input[vEnd], input[vEnd].Strand, 1.0f);
             v[3].PosWS = input[vEnd].PosWS; 
             v[3].NormalWS = input[vEnd].NormalWS;
             v[3].UV = input[vEnd].UV;
+            v[3].Occlusion = input[vEnd].Occlusion;
+            v[3].Strand = input[vEnd].Strand;
+            v[3].CoatSegment = g_Fur.LayerCount - 1;
             v[3].NormalizedHeight = 1.0f;
             
             stream.Append(v[0]);
@@ -7,7 +7,19 @@ struct FrameCB {
     float3 Gravity;
     float WindStrength;
     float3 WindDirection;
-    float Padding;
+    float FurScale;
+    float4 OsmLayerEnds;
+    uint OsmLayerCount;
+    float ImpostorBlend;
+    uint ShellInstances;
+    uint ImpostorLayers;
+    uint DirectionalLights;
+    uint ClusterTilesX;
+    uint ClusterTilesY;
+    uint ClusterSlices;
+    float ClusterDepthScale;
+    float ClusterDepthBias;
+    float2 LightPadding;
 };
 ConstantBuffer<FrameCB> g_Frame : register(b0);
 
@@ -15,6 +27,8 @@ struct VS_IN {
     float3 Pos : POSITION;
     float3 Normal : NORMAL;
     float2 UV : TEXCOORD;
+    float4 Occlusion : OCCLUSION; // Second vertex stream
+    float4 Tangent : TANGENT;     // Third vertex stream, w = bitangent sign
 };
 
 struct VS_OUT {
@@ -23,9 +37,55 @@ struct VS_OUT {
     float3 NormalWS : NORMAL;
     float2 UV : TEXCOORD;
     float NormalizedHeight : HEIGHT;
+    float4 Occlusion : OCCLUSION; // Baked visibility SH, L1 in world space
+    float4 Strand : STRAND;       // Groomed strand direction in world space, fur length scale
 };
 
-// Fin VS just passes data to GS. We don't extrude here.
+// Baked occlusion: order-1 SH of visibility per vertex (OcclusionBaker). L0 is a scalar; the L1
+// vector turns with the mesh and keeps its length.
+float4 OcclusionToWorld(float4 occlusion) {
+    float3 l1 = mul(occlusion.yzw, (float3x3)g_Frame.World);
+    float l1Length = length(l1);
+    return float4(occlusion.x, l1Length > 0.0f ? l1 * (length(occlusion.yzw) / l1Length) : l1);
+}
+
+// Bindless: every view is in one shader-visible heap, bound whole. The renderer's
+// BindlessConstants, set once per frame, say which slot holds which view; the arrays alias the
+// heap, one per resource type (FurRenderer::CreateRootSignature).
+cbuffer BindlessCB : register(b2) {
+    uint g_NoiseSlot;
+    uint g_OsmSlot;
+    uint g_OsmDepthSlot;
+    uint g_FurVolumeSlot;
+    uint g_GroomMapSlot;
+    uint g_LightsSlot;
+    uint g_LightClustersSlot;
+    uint g_LightIndicesSlot;
+    uint g_SceneColorSlot; // The transients, for the resolve step
+    uint g_SceneDepthSlot;
+    uint g_FurColorSlot;
+    uint g_FurDepthSlot;
+};
+Texture2D<float4> g_Textures[] : register(t0, space1);
+#define g_GroomMap g_Textures[g_GroomMapSlot]
+SamplerState g_SamLinear : register(s0);
+
+static const float GroomMaxLength = 2.0f; // GroomMapSettings::MaxLength
+
+// Mirrors GroomedStrand in shell_vs
+float4 GroomedStrand(float2 uv, float3 normalWS, float4 tangent) {
+    float4 groom = g_GroomMap.SampleLevel(g_SamLinear, uv, 0);
+    float3 tangentWS = mul(tangent.xyz, (float3x3)g_Frame.World);
+    tangentWS -= normalWS * dot(normalWS, tangentWS);
+    float tangentLength = length(tangentWS);
+    tangentWS = tangentLength > 1e-6f ? tangentWS / tangentLength : normalize(cross(normalWS, float3(0.0f, 0.0f, 1.0f)) + 1e-6f);
+    float3 bitangentWS = cross(normalWS, tangentWS) * tangent.w;
+    float3 dir = groom.rgb * 2.0f - 1.0f;
+    return float4(normalize(dir.x * tangentWS + dir.y * bitangentWS + dir.z * normalWS), groom.a * GroomMaxLength);
+}
+
+// Fin VS just passes data to GS. We don't extrude here, but the groomed strand the fins follow
+// is looked up once per vertex.
 VS_OUT main(VS_IN input) {
     VS_OUT output;
     output.PosWS = mul(float4(input.Pos, 1.0f), g_Frame.World).xyz;
@@ -33,5 +93,7 @@ VS_OUT main(VS_IN input) {
     output.NormalWS = normalize(mul(input.Normal, (float3x3)g_Frame.World));
     output.UV = input.UV;
     output.NormalizedHeight = 0.0f; // Base height
+    output.Occlusion = OcclusionToWorld(input.Occlusion);
+    output.Strand = GroomedStrand(input.UV, output.NormalWS, input.Tangent);
     return output;
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+// The depth the half-resolution fur is tested against: for each texel, the nearest depth of every
+// sample of the 2x2 full resolution pixels under it (FurUpsample::DownsampleDepth). The nearest,
+// so fur behind a thin occluder is not drawn over it; the resolve fills the fur back in around
+// the occluder from the neighbouring texels.
+
+// Bindless: every view is in one shader-visible heap, bound whole. The renderer's
+// BindlessConstants, set once per frame, say which slot holds which view; the arrays alias the
+// heap, one per resource type (FurRenderer::CreateRootSignature).
+cbuffer BindlessCB : register(b2) {
+    uint g_NoiseSlot;
+    uint g_OsmSlot;
+    uint g_OsmDepthSlot;
+    uint g_FurVolumeSlot;
+    uint g_GroomMapSlot;
+    uint g_LightsSlot;
+    uint g_LightClustersSlot;
+    uint g_LightIndicesSlot;
+    uint g_SceneColorSlot;
+    uint g_SceneDepthSlot;
+    uint g_FurColorSlot;
+    uint g_FurDepthSlot;
+};
+Texture2DMS<float> g_DepthsMS[] : register(t0, space9);
+#define g_SceneDepth g_DepthsMS[g_SceneDepthSlot] // The skin's, 4x MSAA
+
+static const uint SampleCount = 4; // MakeTransientDesc
+
+float main(float4 position : SV_POSITION) : SV_DEPTH {
+    uint width, height, samples;
+    g_SceneDepth.GetDimensions(width, height, samples);
+
+    // Odd sizes: the last block is one pixel wide or tall
+    const int2 first = int2(position.xy) * 2;
+    float depth = 1.0f;
+    [unroll] for (uint i = 0; i < 4; i++) {
+        const int2 pixel = min(first + int2(i & 1, i >> 1), int2(width, height) - 1);
+        [unroll] for (uint s = 0; s < SampleCount; s++) depth = min(depth, g_SceneDepth.Load(pixel, s));
+    }
+    return depth;
+}
@@ -1,14 +1,77 @@
+struct FrameCB {
+    float4x4 ViewProj;
+    float4x4 World;
+    float4x4 LightViewProj;
+    float3 CameraPos;
+    float Time;
+    float3 Gravity;
+    float WindStrength;
+    float3 WindDirection;
+    float FurScale;
+    float4 OsmLayerEnds;
+    uint OsmLayerCount;
+    float ImpostorBlend;
+    uint ShellInstances;
+    uint ImpostorLayers;
+    uint DirectionalLights;
+    uint ClusterTilesX;
+    uint ClusterTilesY;
+    uint ClusterSlices;
+    float ClusterDepthScale;
+    float ClusterDepthBias;
+    float2 LightPadding;
+};
+ConstantBuffer<FrameCB> g_Frame : register(b0);
+
+// Coat layers by reach, the outermost last (FurCoat); heights are fractions of FurLength
+struct CoatLayer {
+    float Length;
+    float Density;
+    float Thickness;
+    uint NoiseChannel;
+    float3 Color;
+    float Reach;     // Height of the layer's top shell
+    uint LastShell;  // Last instance of the layer's segment
+    uint3 LayerPadding;
+};
 struct FurCB {
-    float FurLength;
+    float FurLength; // The longest layer
     uint ShellCount;
-    float Density;
+    float Density;   // Density, Thickness and FurColor are the outermost layer's
     float Thickness;
     float3 FurColor;
-    float Padding;
+    uint ColorMap; // Heap slot of the colour map, 0xffffffff for none
+    uint LayerCount;
+    uint ShellInstances; // Of the coat draw
+    uint2 CoatPadding;
+    CoatLayer Layers[4];
 };
-ConstantBuffer<FurCB> g_Fur : register(b1);
+// One entry per material, picked by a root constant the renderer sets per draw
+StructuredBuffer<FurCB> g_FurMaterials : register(t3);
+cbuffer DrawCB : register(b1) { uint g_MaterialIndex; };
+#define g_Fur g_FurMaterials[g_MaterialIndex]
 
-Texture2D<float> g_NoiseTex : register(t0);
+// Bindless: every view is in one shader-visible heap, bound whole. The renderer's
+// BindlessConstants, set once per frame, say which slot holds which view; the arrays alias the
+// heap, one per resource type (FurRenderer::CreateRootSignature).
+cbuffer BindlessCB : register(b2) {
+    uint g_NoiseSlot;
+    uint g_OsmSlot;
+    uint g_OsmDepthSlot;
+    uint g_FurVolumeSlot;
+    uint g_GroomMapSlot;
+    uint g_LightsSlot;
+    uint g_LightClustersSlot;
+    uint g_LightIndicesSlot;
+    uint g_SceneColorSlot; // The transients, for the resolve step
+    uint g_SceneDepthSlot;
+    uint g_FurColorSlot;
+    uint g_FurDepthSlot;
+};
+Texture2D<float2> g_Textures2[] : register(t0, space2);
+Texture2D<float> g_Textures1[] : register(t0, space3);
+#define g_NoiseTex g_Textures2[g_NoiseSlot]    // One Voronoi noise per channel, picked by the coat layer
+#define g_OsmDepth g_Textures1[g_OsmDepthSlot] // First-hit depth from the light-space pre-pass
 SamplerState g_SamLinear : register(s0);
 
 struct VS_OUT {
@@ -17,34 +80,54 @@ struct VS_OUT {
     float3 NormalWS : NORMAL;
     float2 UV : TEXCOORD;
     float NormalizedHeight : HEIGHT;
+    float4 Occlusion : OCCLUSION; // Baked visibility SH, L1 in world space
+    float4 Strand : STRAND;       // Groomed strand direction in world space, fur length scale
+    nointerpolation uint CoatSegment : SEGMENT; // First coat layer that reaches the shell
 };
 
-struct PS_OUT {
-    float4 Layer0 : SV_Target0;
-    float4 Layer1 : SV_Target1;
-    float4 Layer2 : SV_Target2;
-    float4 Layer3 : SV_Target3;
-};
+// Mirrors DeepOpacityMaps::LayerIndex
+uint DeepOpacityLayer(float depth, float firstHitDepth) {
+    float d = max(depth - firstHitDepth, 0.0f);
+    uint layer = 0;
+    [unroll]
+    for (uint i = 0; i < 3; i++) {
+        layer += (i + 1 < g_Frame.OsmLayerCount && d >= g_Frame.OsmLayerEnds[i]) ? 1 : 0;
+    }
+    return layer;
+}
+
+// Mirrors FurCoat::SegmentStep: height between neighbouring shells of a segment
+float CoatSegmentStep(uint segment) {
+    uint first = segment > 0 ? g_Fur.Layers[segment - 1].LastShell : 0;
+    float start = segment > 0 ? g_Fur.Layers[segment - 1].Reach : 0.0f;
+    CoatLayer layer = g_Fur.Layers[segment];
+    return layer.LastShell > first ? (layer.Reach - start) / (float)(layer.LastShell - first) : 0.0f;
+}
 
-PS_OUT main(VS_OUT input) {
-    float noiseValue = g_NoiseTex.Sample(g_SamLinear, input.UV * g_Fur.Density).r;
-    float strandShape = noiseValue - (input.NormalizedHeight * g_Fur.Thickness);
-    clip(strandShape);
-    
-    // We are inside the strand. Output opacity.
-    float opacity = (1.0f - input.NormalizedHeight) * (1.0f / (float)g_Fur.ShellCount); // Prevent white-out
-    
-    // Determine depth slice in light space (0.0 to 1.0)
+float4 main(VS_OUT input) : SV_TARGET {
+    // Mirrors FurCoat::OsmOpacity: every coat layer reaching this shell whose strand covers the
+    // texel adds its opacity, weighted by the shell spacing against the layer's own so the coat
+    // casts the shadow of one pass per layer
+    float2 dUVdx = ddx(input.UV), dUVdy = ddy(input.UV);
+    float step = CoatSegmentStep(input.CoatSegment);
+    float opacity = 0.0f;
+    [loop]
+    for (uint k = input.CoatSegment; k < g_Fur.LayerCount; k++) {
+        CoatLayer layer = g_Fur.Layers[k];
+        float noiseValue = g_NoiseTex.SampleGrad(g_SamLinear, input.UV * layer.Density, dUVdx * layer.Density, dUVdy * layer.Density)[layer.NoiseChannel];
+        float h = input.NormalizedHeight / layer.Length;
+        if (noiseValue - h * layer.Thickness < 0.0f) continue;
+        float weight = step > 0.0f ? step * (float)(g_Fur.ShellCount - 1) / layer.Length : 1.0f;
+        opacity += (1.0f - h) * (1.0f / (float)g_Fur.ShellCount) * weight; // Prevent white-out
+    }
+    // We are inside a strand only if some layer covered the texel
+    clip(opacity > 0.0f ? 1.0f : -1.0f);
+
+    // Layers start where the light first enters the fur at this texel, not at the light's near plane.
     // input.PosCS.z is already normalized depth in D3D12
-    float sliceDepth = input.PosCS.z * 4.0f; 
-    
-    PS_OUT output = (PS_OUT)0;
-    
-    // Assign opacity to the correct MRT using ternary selects
-    output.Layer0.r = (sliceDepth < 1.0f) ? opacity : 0.0f;
-    output.Layer1.r = (sliceDepth >= 1.0f && sliceDepth < 2.0f) ? opacity : 0.0f;
-    output.Layer2.r = (sliceDepth >= 2.0f && sliceDepth < 3.0f) ? opacity : 0.0f;
-    output.Layer3.r = (sliceDepth >= 3.0f) ? opacity : 0.0f;
-    
-    return output;
-}
\ No newline at end of file
+    float firstHitDepth = g_OsmDepth.Load(int3(input.PosCS.xy, 0));
+    uint layer = DeepOpacityLayer(input.PosCS.z, firstHitDepth);
+
+    // One layer per RGBA channel of the packed target
+    return (uint4(0, 1, 2, 3) == layer) ? opacity : 0.0f;
+}
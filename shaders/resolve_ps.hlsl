@@ -0,0 +1,85 @@
+// The resolve step with the fur drawn at half resolution: resolves the MSAA base pass and puts
+// the fur over it, upsampled depth-aware. Mirrors FurUpsample::UpsamplePixel and Composite, the
+// CPU reference PelageFurUpsampleBench tests. The fur target holds premultiplied colour with
+// coverage in A: A2C leaves uncovered samples at their clear of zero, the impostor layers blend
+// premultiplied.
+
+// Bindless: every view is in one shader-visible heap, bound whole. The renderer's
+// BindlessConstants, set once per frame, say which slot holds which view; the arrays alias the
+// heap, one per resource type (FurRenderer::CreateRootSignature).
+cbuffer BindlessCB : register(b2) {
+    uint g_NoiseSlot;
+    uint g_OsmSlot;
+    uint g_OsmDepthSlot;
+    uint g_FurVolumeSlot;
+    uint g_GroomMapSlot;
+    uint g_LightsSlot;
+    uint g_LightClustersSlot;
+    uint g_LightIndicesSlot;
+    uint g_SceneColorSlot;
+    uint g_SceneDepthSlot;
+    uint g_FurColorSlot;
+    uint g_FurDepthSlot;
+};
+Texture2DMS<float4> g_TexturesMS[] : register(t0, space8);
+Texture2DMS<float> g_DepthsMS[] : register(t0, space9);
+#define g_SceneColor g_TexturesMS[g_SceneColorSlot] // The skin, full resolution
+#define g_SceneDepth g_DepthsMS[g_SceneDepthSlot]
+#define g_FurColor g_TexturesMS[g_FurColorSlot]     // The fur, half resolution
+#define g_FurDepth g_DepthsMS[g_FurDepthSlot]       // What the fur was tested against, the same in every sample
+
+static const uint SampleCount = 4;         // MakeTransientDesc
+static const float DepthTolerance = 0.01f; // FurUpsampleSettings
+static const float MinWeight = 0.05f;
+
+// FurUpsample::DepthWeight
+float DepthWeight(float pixelDepth, float texelDepth) {
+    const float d = abs(texelDepth - pixelDepth) / max(1.0f - pixelDepth, 1e-7f) / DepthTolerance;
+    return 1.0f / (1.0f + d * d);
+}
+
+float4 main(float4 position : SV_POSITION) : SV_TARGET {
+    const int2 pixel = int2(position.xy);
+    float4 base = 0.0f;
+    float depth = 1.0f;
+    [unroll] for (uint s = 0; s < SampleCount; s++) {
+        base += g_SceneColor.Load(pixel, s);
+        depth = min(depth, g_SceneDepth.Load(pixel, s));
+    }
+    base /= SampleCount;
+
+    uint width, height, samples;
+    g_FurColor.GetDimensions(width, height, samples);
+    // Pixel centres in texel units: even pixels are a quarter texel before a texel centre, odd
+    // ones a quarter after
+    const float2 halfPos = (float2(pixel) + 0.5f) * 0.5f - 0.5f;
+    const float2 first = floor(halfPos);
+    const float2 f = halfPos - first;
+
+    float4 texels[4];
+    float texelDepths[4];
+    float weights[4];
+    float total = 0.0f;
+    [unroll] for (uint i = 0; i < 4; i++) {
+        const int2 texel = clamp(int2(first) + int2(i & 1, i >> 1), 0, int2(width, height) - 1);
+        texels[i] = 0.0f;
+        [unroll] for (uint s = 0; s < SampleCount; s++) texels[i] += g_FurColor.Load(texel, s);
+        texels[i] /= SampleCount;
+        texelDepths[i] = g_FurDepth.Load(texel, 0);
+        weights[i] = ((i & 1) ? f.x : 1.0f - f.x) * ((i >> 1) ? f.y : 1.0f - f.y) * DepthWeight(depth, texelDepths[i]);
+        total += weights[i];
+    }
+
+    // No texel at the pixel's depth: a thin occluder took the whole block, use the nearest alone
+    if (total < MinWeight) {
+        uint nearest = 0;
+        [unroll] for (uint i = 1; i < 4; i++) {
+            if (abs(texelDepths[i] - depth) < abs(texelDepths[nearest] - depth)) nearest = i;
+        }
+        [unroll] for (uint i = 0; i < 4; i++) weights[i] = i == nearest ? 1.0f : 0.0f;
+        total = 1.0f;
+    }
+
+    const float4 fur = (texels[0] * weights[0] + texels[1] * weights[1] + texels[2] * weights[2] + texels[3] * weights[3]) / total;
+    return float4(base.rgb * (1.0f - fur.a) + fur.rgb, 1.0f);
+}
@@ -7,22 +7,103 @@ struct FrameCB {
     float3 Gravity;
     float WindStrength;
     float3 WindDirection;
-    float Padding;
+    float FurScale;
+    float4 OsmLayerEnds;
+    uint OsmLayerCount;
+    float ImpostorBlend;
+    uint ShellInstances;
+    uint ImpostorLayers;
+    uint DirectionalLights;
+    uint ClusterTilesX;
+    uint ClusterTilesY;
+    uint ClusterSlices;
+    float ClusterDepthScale;
+    float ClusterDepthBias;
+    float2 LightPadding;
 };
 ConstantBuffer<FrameCB> g_Frame : register(b0);
 
+// Coat layers by reach, the outermost last (FurCoat); heights are fractions of FurLength
+struct CoatLayer {
+    float Length;
+    float Density;
+    float Thickness;
+    uint NoiseChannel;
+    float3 Color;
+    float Reach;     // Height of the layer's top shell
+    uint LastShell;  // Last instance of the layer's segment
+    uint3 LayerPadding;
+};
 struct FurCB {
-    float FurLength;
+    float FurLength; // The longest layer
     uint ShellCount;
-    float Density;
+    float Density;   // Density, Thickness and FurColor are the outermost layer's
     float Thickness;
     float3 FurColor;
-    float Padding;
+    uint ColorMap; // Heap slot of the colour map, 0xffffffff for none
+    uint LayerCount;
+    uint ShellInstances; // Of the coat draw
+    uint2 CoatPadding;
+    CoatLayer Layers[4];
 };
-ConstantBuffer<FurCB> g_Fur : register(b1);
+// One entry per material, picked by a root constant the renderer sets per draw
+StructuredBuffer<FurCB> g_FurMaterials : register(t3);
+cbuffer DrawCB : register(b1) { uint g_MaterialIndex; };
+#define g_Fur g_FurMaterials[g_MaterialIndex]
 
-Texture2D<float> g_NoiseTex : register(t0);
-Texture2D<float> g_OsmTex[4] : register(t1);
+// Bindless: every view is in one shader-visible heap, bound whole. The renderer's
+// BindlessConstants, set once per frame, say which slot holds which view; the arrays alias the
+// heap, one per resource type (FurRenderer::CreateRootSignature).
+cbuffer BindlessCB : register(b2) {
+    uint g_NoiseSlot;
+    uint g_OsmSlot;
+    uint g_OsmDepthSlot;
+    uint g_FurVolumeSlot;
+    uint g_GroomMapSlot;
+    uint g_LightsSlot;
+    uint g_LightClustersSlot;
+    uint g_LightIndicesSlot;
+    uint g_SceneColorSlot; // The transients, for the resolve step
+    uint g_SceneDepthSlot;
+    uint g_FurColorSlot;
+    uint g_FurDepthSlot;
+};
+Texture2D<float4> g_Textures[] : register(t0, space1);
+Texture2D<float2> g_Textures2[] : register(t0, space2);
+Texture2D<float> g_Textures1[] : register(t0, space3);
+Texture2DArray<float2> g_TextureArrays2[] : register(t0, space4);
+
+#define g_NoiseTex g_Textures2[g_NoiseSlot]    // One Voronoi noise per channel, picked by the coat layer
+#define g_OsmTex g_Textures[g_OsmSlot]         // Deep opacity layers packed into RGBA
+#define g_OsmDepth g_Textures1[g_OsmDepthSlot] // First-hit depth from the light-space pre-pass
+// Material colour maps (sRGB, mipped) are g_Textures[g_Fur.ColorMap]; the slot comes from the
+// material, so it is uniform across a draw.
+// Fur volume for the impostor layers (FurVolume): one slice per noise threshold, RG = coverage
+// and partial mean of the noise
+#define g_FurVolume g_TextureArrays2[g_FurVolumeSlot]
+// Clustered lights, rebuilt by LightCuller every frame: directional lights first (light 0 is the
+// key light the OSM shadows), then point and spot lights, which are only evaluated when listed in
+// the pixel's cluster
+struct GpuLight {
+    float3 Position;
+    float Range;
+    float3 Direction; // Where the light travels
+    uint Type;        // LightType: 0 directional, 1 point, 2 spot
+    float3 Color;
+    float SpotScale;
+    float SpotOffset;
+    float3 Padding;
+};
+struct LightCluster {
+    uint Offset;
+    uint Count;
+};
+StructuredBuffer<GpuLight> g_LightBuffers[] : register(t0, space5);
+StructuredBuffer<LightCluster> g_LightClusterBuffers[] : register(t0, space6);
+StructuredBuffer<uint> g_LightIndexBuffers[] : register(t0, space7);
+#define g_Lights g_LightBuffers[g_LightsSlot]
+#define g_LightClusters g_LightClusterBuffers[g_LightClustersSlot]
+#define g_LightIndices g_LightIndexBuffers[g_LightIndicesSlot]
 SamplerState g_SamLinear : register(s0);
 
 struct VS_OUT {
@@ -31,39 +112,84 @@ struct VS_OUT {
     float3 NormalWS : NORMAL;
     float2 UV : TEXCOORD;
     float NormalizedHeight : HEIGHT;
+    float4 Occlusion : OCCLUSION; // Baked visibility SH, L1 in world space
+    float4 Strand : STRAND;       // Groomed strand direction in world space, fur length scale
+    nointerpolation uint CoatSegment : SEGMENT; // First coat layer that reaches the shell
+#ifdef FUR_IMPOSTOR
+    nointerpolation uint ImpostorLayer : LAYER;
+#endif
 };
 
-float4 main(VS_OUT input) : SV_TARGET {
-    // TRADEOFF: Sampling a pre-computed Voronoi texture is significantly faster 
-    // on mid-range GPUs than computing cellular noise procedurally in the PS.
-    float noiseValue = g_NoiseTex.Sample(g_SamLinear, input.UV * g_Fur.Density).r;
-    
-    // Shape the strand: thicker at bottom, tapers at the top.
-    // We subtract the shell height from the noise, scaled by thickness.
-    float strandShape = noiseValue - (input.NormalizedHeight * g_Fur.Thickness);
-    
-    // Alpha discard
-    clip(strandShape);
-    
-    // Kajiya-Kay Shading (Physically-based hair approximation)
-    // For shell fur extruded along the normal, the strand tangent 'T' is the normal itself.
-    float3 T = normalize(input.NormalWS);
-    float3 L = normalize(float3(1.0f, 1.0f, -1.0f)); // Light direction
-    float3 V = normalize(g_Frame.CameraPos - input.PosWS); // View direction
-    
+// Mirrors DeepOpacityMaps::AccumulatedOpacity: layers fully in front of the receiver count
+// completely, the containing layer is interpolated so layer boundaries don't band.
+float DeepOpacityAccumulate(float4 layers, float depth, float firstHitDepth) {
+    float d = max(depth - firstHitDepth, 0.0f);
+    float accumulated = 0.0f;
+    float layerStart = 0.0f;
+    [unroll]
+    for (uint i = 0; i < 4; i++) {
+        if (i < g_Frame.OsmLayerCount) {
+            float layerEnd = g_Frame.OsmLayerEnds[i];
+            accumulated += layers[i] * saturate((d - layerStart) / (layerEnd - layerStart));
+            layerStart = layerEnd;
+        }
+    }
+    return accumulated;
+}
+
+// Fur LOD cross-fade: a 4x4 ordered dither, where the shells keep the pixels at or above
+// ImpostorBlend and the impostor layers the rest, so the two never cover the same pixel
+float LodDither(float2 pixel) {
+    static const float bayer[16] = { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+    uint2 p = (uint2)pixel & 3;
+    return (bayer[p.y * 4 + p.x] + 0.5f) / 16.0f;
+}
+
+// Mirrors LightClusterGrid::ClusterIndex, from the same clip-space position the camera sees
+uint LightClusterIndex(float3 posWS) {
+    float4 posCS = mul(float4(posWS, 1.0f), g_Frame.ViewProj);
+    float depth = max(posCS.w, 1e-6f);
+    float2 ndc = posCS.xy / depth;
+    int x = (int)floor((ndc.x * 0.5f + 0.5f) * g_Frame.ClusterTilesX);
+    int y = (int)floor((0.5f - ndc.y * 0.5f) * g_Frame.ClusterTilesY);
+    int slice = (int)floor(log(depth) * g_Frame.ClusterDepthScale + g_Frame.ClusterDepthBias);
+    x = clamp(x, 0, (int)g_Frame.ClusterTilesX - 1);
+    y = clamp(y, 0, (int)g_Frame.ClusterTilesY - 1);
+    slice = clamp(slice, 0, (int)g_Frame.ClusterSlices - 1);
+    return ((uint)slice * g_Frame.ClusterTilesY + (uint)y) * g_Frame.ClusterTilesX + (uint)x;
+}
+
+// Mirrors LightCuller::Attenuation and ::SpotFalloff: the direction towards the light in L and
+// its intensity at posWS
+float3 LightIncidence(GpuLight light, float3 posWS, out float3 L) {
+    if (light.Type == 0) {
+        L = -light.Direction;
+        return light.Color;
+    }
+    float3 toLight = light.Position - posWS;
+    float distance = length(toLight);
+    L = toLight / max(distance, 1e-6f);
+    float ratio = distance / light.Range;
+    float window = saturate(1.0f - ratio * ratio * ratio * ratio);
+    float spot = saturate(dot(light.Direction, -L) * light.SpotScale + light.SpotOffset);
+    return light.Color * (window * window / max(distance * distance, 0.01f)) * spot * spot;
+}
+
+// Kajiya-Kay (physically-based hair approximation) for one light, diffuse and specular kept apart
+void KajiyaKay(float3 T, float3 V, float3 L, out float diffuse, out float specular) {
     // Hair diffuse is not Lambertian (dot(N,L)). It's based on scattering through the cylindrical strand.
     // Approximated by the sine of the angle between light and strand.
     float dotTL = dot(T, L);
     float sinTL = sqrt(max(0.0f, 1.0f - dotTL * dotTL));
-    float diffuse = sinTL;
-    
+    diffuse = sinTL;
+
     // Kajiya-Kay Specular Highlight
     float dotTV = dot(T, V);
     float sinTV = sqrt(max(0.0f, 1.0f - dotTV * dotTV));
     // The specular alignment term: T.L * T.V + sin(theta_L) * sin(theta_V)
     float specAlignment = max(0.0f, (dotTL * dotTV) + (sinTL * sinTV));
-    float specular = pow(specAlignment, 32.0f); // Primary shininess
-    
+    specular = pow(specAlignment, 32.0f); // Primary shininess
+
     // Secondary shifted highlight (internal reflection)
     float shift = -0.1f;
     float3 shiftedT = normalize(T + V * shift);
@@ -72,14 +198,135 @@ float4 main(VS_OUT input) : SV_TARGET {
     float sinShiftedTL = sqrt(max(0.0f, 1.0f - dotShiftedTL * dotShiftedTL));
     float sinShiftedTV = sqrt(max(0.0f, 1.0f - dotShiftedTV * dotShiftedTV));
     float specAlignment2 = max(0.0f, (dotShiftedTL * dotShiftedTV) + (sinShiftedTL * sinShiftedTV));
-    float secondarySpecular = pow(specAlignment2, 12.0f) * 0.4f;
+    specular += pow(specAlignment2, 12.0f) * 0.4f;
+}
 
-    // Combine terms
-    float3 ambient = g_Fur.FurColor * 0.15f;
-    float3 diffuseLight = g_Fur.FurColor * diffuse * 0.85f;
-    float3 specularLight = float3(1.0f, 0.9f, 0.8f) * (specular + secondarySpecular) * 0.6f; // Slightly warm
+// Baked visibility towards L, as OcclusionBaker::Visibility: relative to an open surface's, whose
+// order-1 visibility falls from 1.25 along the normal to 0.5 at the horizon
+float BakedShadow(float4 occlusion, float3 N, float3 L) {
+    float lightVisibility = 0.282095f * occlusion.x + 0.488603f * dot(occlusion.yzw, L);
+    return saturate(lightVisibility / max(0.5f + 0.75f * dot(N, L), 0.25f));
+}
+
+#ifdef FUR_IMPOSTOR
+static const float NoiseCells = 32.0f; // FurNoiseSettings::Cells
+
+// Coverage and partial mean at threshold t, linear between the slices
+float2 FurVolumeSample(float2 uv, float t) {
+    uint width, height, slices;
+    g_FurVolume.GetDimensions(width, height, slices);
+    float slice = saturate(t) * (slices - 1);
+    float s0 = floor(slice);
+    float2 a = g_FurVolume.Sample(g_SamLinear, float3(uv, s0));
+    float2 b = g_FurVolume.Sample(g_SamLinear, float3(uv, min(s0 + 1.0f, slices - 1)));
+    return lerp(a, b, slice - s0);
+}
+
+// Mirrors FurVolumeBaker::ImpostorCorrelation
+float ImpostorCorrelation(float cosView, float furLengthTiles) {
+    float cosine = clamp(abs(cosView), 1e-3f, 1.0f);
+    float tanView = sqrt(1.0f - cosine * cosine) / cosine;
+    float shiftCells = furLengthTiles * tanView * NoiseCells / (float)(g_Fur.ShellCount - 1);
+    return saturate(1.0f - 3.0f * shiftCells);
+}
+
+// Mirrors FurVolumeBaker::ImpostorLayer: x = opacity of the layer's band of shells over what is
+// below, y = mean height of the strand tips seen in it
+float2 ImpostorLayer(float2 uv, uint layer, float correlation) {
+    float step = 1.0f / (float)(g_Fur.ShellCount - 1);
+    float top = (float)(g_Frame.ShellInstances - 1) * step;
+    float bandLow = top * layer / g_Frame.ImpostorLayers;
+    float bandHigh = top * (layer + 1) / g_Frame.ImpostorLayers;
+    bool topBand = layer + 1 == g_Frame.ImpostorLayers;
+
+    float2 low = FurVolumeSample(uv, bandLow * g_Fur.Thickness);
+    float2 high = FurVolumeSample(uv, bandHigh * g_Fur.Thickness);
+
+    // Correlated shells: each noise texel shows the highest shell it reaches
+    float inBand = max(low.x - high.x, 0.0f);
+    float clamped = topBand ? high.x : 0.0f;
+    float correlatedAlpha = topBand ? low.x : inBand / max(1.0f - high.x, 1e-4f);
+    float heightSum = (low.y - high.y) / g_Fur.Thickness - 0.5f * step * inBand + top * clamped;
+    float correlatedHeight = heightSum / max(inBand + clamped, 1e-4f);
+
+    // Uncorrelated shells, from the top shell of the band down
+    uint firstShell = (uint)ceil(bandLow / step - 1e-3f);
+    uint endShell = topBand ? g_Frame.ShellInstances : (uint)ceil(bandHigh / step - 1e-3f);
+    float transmitted = 1.0f;
+    float hitHeight = 0.0f;
+    [loop]
+    for (uint shell = endShell; shell > firstShell; shell--) {
+        float h = (shell - 1) * step;
+        float c = lerp(low.x, high.x, (h - bandLow) / (bandHigh - bandLow));
+        hitHeight += transmitted * c * h;
+        transmitted *= 1.0f - c;
+    }
+    float independentAlpha = 1.0f - transmitted;
+    float independentHeight = hitHeight / max(independentAlpha, 1e-4f);
+
+    return float2(saturate(lerp(independentAlpha, correlatedAlpha, correlation)),
+                  clamp(lerp(independentHeight, correlatedHeight, correlation), bandLow, bandHigh));
+}
+#endif
+
+// The outermost layer from 'segment' on whose strand covers the texel at height 'h' (a fraction
+// of FurLength), -1 for none. Each layer samples its own noise channel at its own density, with
+// the gradients taken outside the loop.
+// TRADEOFF: Sampling a pre-computed Voronoi texture is significantly faster
+// on mid-range GPUs than computing cellular noise procedurally in the PS.
+int CoatLayerAt(float2 uv, float h, uint segment) {
+    float2 dUVdx = ddx(uv), dUVdy = ddy(uv);
+    [loop]
+    for (uint k = g_Fur.LayerCount; k > segment; k--) {
+        CoatLayer layer = g_Fur.Layers[k - 1];
+        float noiseValue = g_NoiseTex.SampleGrad(g_SamLinear, uv * layer.Density, dUVdx * layer.Density, dUVdy * layer.Density)[layer.NoiseChannel];
+        // Shape the strand: thicker at bottom, tapers at the top.
+        // We subtract the layer's height from the noise, scaled by thickness.
+        if (noiseValue - h / layer.Length * layer.Thickness >= 0.0f) return (int)(k - 1);
+    }
+    return -1;
+}
+
+float4 main(VS_OUT input) : SV_TARGET {
+#ifdef FUR_IMPOSTOR
+    // Fur length in noise tiles, from how much UV the pixel covers per unit of surface
+    float2 dUVdx = ddx(input.UV), dUVdy = ddy(input.UV);
+    float uvArea = abs(dUVdx.x * dUVdy.y - dUVdx.y * dUVdy.x);
+    float worldArea = length(cross(ddx(input.PosWS), ddy(input.PosWS)));
+    float furLengthTiles = g_Fur.FurLength * g_Frame.FurScale * input.Strand.w * sqrt(uvArea / max(worldArea, 1e-12f)) * g_Fur.Density;
+    float cosView = dot(normalize(input.Strand.xyz), normalize(g_Frame.CameraPos - input.PosWS));
+    float2 impostor = ImpostorLayer(input.UV * g_Fur.Density, input.ImpostorLayer, ImpostorCorrelation(cosView, furLengthTiles));
+
+    if (LodDither(input.PosCS.xy) >= g_Frame.ImpostorBlend) discard;
+    float height = impostor.y;
+    float alpha = impostor.x;
+    float3 furColor = g_Fur.FurColor;
+#else
+    // Mirrors FurCoat::ShadeLayer: of the coat layers that reach this shell, the outermost whose
+    // strands cover the texel is drawn
+    int coatLayer = CoatLayerAt(input.UV, input.NormalizedHeight, input.CoatSegment);
     
-    // OSM Shadowing
+    // Alpha discard
+    clip(coatLayer);
+    if (LodDither(input.PosCS.xy) < g_Frame.ImpostorBlend) discard;
+    CoatLayer layer = g_Fur.Layers[coatLayer];
+    float height = input.NormalizedHeight / layer.Length;
+    float alpha = 1.0f;
+    float3 furColor = layer.Color;
+#endif
+
+    // Every shell and fin of a strand carries the base mesh UV, so the whole strand takes the
+    // colour under its root
+    if (g_Fur.ColorMap != 0xffffffff) {
+        furColor *= g_Textures[g_Fur.ColorMap].Sample(g_SamLinear, input.UV).rgb;
+    }
+    
+    // The strand tangent 'T' is the groomed strand direction (the normal for ungroomed fur).
+    float3 T = normalize(input.Strand.xyz);
+    float3 V = normalize(g_Frame.CameraPos - input.PosWS); // View direction
+    float3 N = T;
+
+    // OSM Shadowing, of the key light only
     float4 posLightCS = mul(float4(input.PosWS, 1.0f), g_Frame.LightViewProj);
     posLightCS.xyz /= posLightCS.w;
     
@@ -88,28 +335,68 @@ float4 main(VS_OUT input) : SV_TARGET {
     
     float shadowFactor = 1.0f;
     if (shadowUV.x >= 0.0f && shadowUV.x <= 1.0f && shadowUV.y >= 0.0f && shadowUV.y <= 1.0f) {
-        // Sample all 4 layers
-        float accumulatedOpacity = 0.0f;
-        accumulatedOpacity += g_OsmTex[0].Sample(g_SamLinear, shadowUV).r;
-        accumulatedOpacity += g_OsmTex[1].Sample(g_SamLinear, shadowUV).r;
-        accumulatedOpacity += g_OsmTex[2].Sample(g_SamLinear, shadowUV).r;
-        accumulatedOpacity += g_OsmTex[3].Sample(g_SamLinear, shadowUV).r;
+        // Sample all layers in one fetch, and the depth the layers are measured from
+        float4 layers = g_OsmTex.Sample(g_SamLinear, shadowUV);
+        uint osmWidth, osmHeight;
+        g_OsmDepth.GetDimensions(osmWidth, osmHeight);
+        // The texel containing shadowUV, the one osm_ps wrote for this point (it indexes by
+        // PosCS.xy); shadowUV 1 maps one past the last texel
+        int2 osmTexel = min(int2(shadowUV * float2(osmWidth, osmHeight)), int2(osmWidth, osmHeight) - 1);
+        float firstHitDepth = g_OsmDepth.Load(int3(osmTexel, 0));
+        float accumulatedOpacity = DeepOpacityAccumulate(layers, posLightCS.z, firstHitDepth);
         
         // Deep shadow using Beer's Law approximation
         shadowFactor = exp(-accumulatedOpacity * 5.0f);
     }
-    
-    float3 lighting = ambient + (diffuseLight + specularLight) * shadowFactor;
+
+    // Directional lights reach every pixel; point and spot lights only where the culler listed
+    // them in the pixel's cluster, so a shell pixel pays for the few lights near it
+    float3 diffuseSum = 0.0f;
+    float3 specularSum = 0.0f;
+    [loop]
+    for (uint d = 0; d < g_Frame.DirectionalLights; d++) {
+        GpuLight light = g_Lights[d];
+        float3 L;
+        float3 incidence = LightIncidence(light, input.PosWS, L);
+        float diffuse, specular;
+        KajiyaKay(T, V, L, diffuse, specular);
+        float shadow = BakedShadow(input.Occlusion, N, L) * (d == 0 ? shadowFactor : 1.0f);
+        diffuseSum += incidence * (diffuse * shadow);
+        specularSum += incidence * (specular * shadow);
+    }
+    LightCluster cluster = g_LightClusters[LightClusterIndex(input.PosWS)];
+    [loop]
+    for (uint i = 0; i < cluster.Count; i++) {
+        GpuLight light = g_Lights[g_LightIndices[cluster.Offset + i]];
+        float3 L;
+        float3 incidence = LightIncidence(light, input.PosWS, L);
+        if (all(incidence <= 0.0f)) continue;
+        float diffuse, specular;
+        KajiyaKay(T, V, L, diffuse, specular);
+        float shadow = BakedShadow(input.Occlusion, N, L);
+        diffuseSum += incidence * (diffuse * shadow);
+        specularSum += incidence * (specular * shadow);
+    }
+
+    // Combine terms
+    float3 ambient = furColor * 0.15f;
+    float3 diffuseLight = furColor * diffuseSum * 0.85f;
+    float3 specularLight = float3(1.0f, 0.9f, 0.8f) * specularSum * 0.6f; // Slightly warm
+
+    // Baked occlusion of the fur hull, as OcclusionBaker::AmbientOcclusion: crevices lose ambient light
+    float bakedAo = saturate(0.282095f * input.Occlusion.x + 0.325735f * dot(input.Occlusion.yzw, N));
+
+    float3 lighting = ambient * bakedAo + diffuseLight + specularLight;
     
     // Darken roots for pseudo-AO using an exponential curve for subsurface feel
-    float ao = pow(input.NormalizedHeight, 0.4f); // steep curve for dark roots, bright tips
+    float ao = pow(height, 0.4f); // steep curve for dark roots, bright tips
     lighting *= lerp(0.1f, 1.0f, ao);
     
     // Fresnel Rim Lighting
     float f0 = 0.04f;
     float cosTheta = saturate(dot(input.NormalWS, V));
     float rim = f0 + (1.0f - f0) * pow(1.0f - cosTheta, 5.0f);
-    lighting += g_Fur.FurColor * rim * 0.5f;
+    lighting += furColor * rim * 0.5f;
     
-    return float4(lighting, 1.0f);
+    return float4(lighting, alpha);
 }
\ No newline at end of file
@@ -7,24 +7,56 @@ struct FrameCB {
     float3 Gravity;
     float WindStrength;
     float3 WindDirection;
-    float Padding;
+    float FurScale;
+    float4 OsmLayerEnds;
+    uint OsmLayerCount;
+    float ImpostorBlend;
+    uint ShellInstances;
+    uint ImpostorLayers;
+    uint DirectionalLights;
+    uint ClusterTilesX;
+    uint ClusterTilesY;
+    uint ClusterSlices;
+    float ClusterDepthScale;
+    float ClusterDepthBias;
+    float2 LightPadding;
 };
 ConstantBuffer<FrameCB> g_Frame : register(b0);
 
+// Coat layers by reach, the outermost last (FurCoat); heights are fractions of FurLength
+struct CoatLayer {
+    float Length;
+    float Density;
+    float Thickness;
+    uint NoiseChannel;
+    float3 Color;
+    float Reach;     // Height of the layer's top shell
+    uint LastShell;  // Last instance of the layer's segment
+    uint3 LayerPadding;
+};
 struct FurCB {
-    float FurLength;
+    float FurLength; // The longest layer
     uint ShellCount;
-    float Density;
+    float Density;   // Density, Thickness and FurColor are the outermost layer's
     float Thickness;
     float3 FurColor;
-    float Padding;
+    uint ColorMap; // Heap slot of the colour map, 0xffffffff for none
+    uint LayerCount;
+    uint ShellInstances; // Of the coat draw
+    uint2 CoatPadding;
+    CoatLayer Layers[4];
 };
-ConstantBuffer<FurCB> g_Fur : register(b1);
+// One entry per material, picked by a root constant the renderer sets per draw
+StructuredBuffer<FurCB> g_FurMaterials : register(t3);
+cbuffer DrawCB : register(b1) { uint g_MaterialIndex; };
+#define g_Fur g_FurMaterials[g_MaterialIndex]
 
 struct VS_IN {
     float3 Pos : POSITION;
     float3 Normal : NORMAL;
     float2 UV : TEXCOORD;
+    float4 Occlusion : OCCLUSION; // Second vertex stream
+    float4 Tangent : TANGENT;     // Third vertex stream, w = bitangent sign
     uint InstanceID : SV_InstanceID;
 };
 
@@ -34,13 +66,95 @@ struct VS_OUT {
     float3 NormalWS : NORMAL;
     float2 UV : TEXCOORD;
     float NormalizedHeight : HEIGHT;
+    float4 Occlusion : OCCLUSION; // Baked visibility SH, L1 in world space
+    float4 Strand : STRAND;       // Groomed strand direction in world space, fur length scale
+    nointerpolation uint CoatSegment : SEGMENT; // First coat layer that reaches the shell
+#ifdef FUR_IMPOSTOR
+    nointerpolation uint ImpostorLayer : LAYER;
+#endif
 };
 
+// Baked occlusion: order-1 SH of visibility per vertex (OcclusionBaker). L0 is a scalar; the L1
+// vector turns with the mesh and keeps its length.
+float4 OcclusionToWorld(float4 occlusion) {
+    float3 l1 = mul(occlusion.yzw, (float3x3)g_Frame.World);
+    float l1Length = length(l1);
+    return float4(occlusion.x, l1Length > 0.0f ? l1 * (length(occlusion.yzw) / l1Length) : l1);
+}
+
+// Bindless: every view is in one shader-visible heap, bound whole. The renderer's
+// BindlessConstants, set once per frame, say which slot holds which view; the arrays alias the
+// heap, one per resource type (FurRenderer::CreateRootSignature).
+cbuffer BindlessCB : register(b2) {
+    uint g_NoiseSlot;
+    uint g_OsmSlot;
+    uint g_OsmDepthSlot;
+    uint g_FurVolumeSlot;
+    uint g_GroomMapSlot;
+    uint g_LightsSlot;
+    uint g_LightClustersSlot;
+    uint g_LightIndicesSlot;
+    uint g_SceneColorSlot; // The transients, for the resolve step
+    uint g_SceneDepthSlot;
+    uint g_FurColorSlot;
+    uint g_FurDepthSlot;
+};
+Texture2D<float4> g_Textures[] : register(t0, space1);
+#define g_GroomMap g_Textures[g_GroomMapSlot]
+SamplerState g_SamLinear : register(s0);
+
+static const float GroomMaxLength = 2.0f; // GroomMapSettings::MaxLength
+
+// Groomed strand (Grooming): the map holds the direction in the tangent frame (x along +U, y
+// along +V, z along the normal) and a scale on the fur length. Skinned normals move while the
+// tangents stay in the bind pose, so the tangent is made orthogonal to the normal again.
+float4 GroomedStrand(float2 uv, float3 normalWS, float4 tangent) {
+    float4 groom = g_GroomMap.SampleLevel(g_SamLinear, uv, 0);
+    float3 tangentWS = mul(tangent.xyz, (float3x3)g_Frame.World);
+    tangentWS -= normalWS * dot(normalWS, tangentWS);
+    float tangentLength = length(tangentWS);
+    tangentWS = tangentLength > 1e-6f ? tangentWS / tangentLength : normalize(cross(normalWS, float3(0.0f, 0.0f, 1.0f)) + 1e-6f);
+    float3 bitangentWS = cross(normalWS, tangentWS) * tangent.w;
+    float3 dir = groom.rgb * 2.0f - 1.0f;
+    return float4(normalize(dir.x * tangentWS + dir.y * bitangentWS + dir.z * normalWS), groom.a * GroomMaxLength);
+}
+
+// Mirrors FurCoat::Segment and ::ShellHeight: the layers cut the coat draw's instances into
+// segments, each ending at one layer's top shell and stepped evenly inside
+float CoatShellHeight(uint instance, out uint segment) {
+    uint first = 0;
+    float start = 0.0f;
+    [loop]
+    for (segment = 0; segment < g_Fur.LayerCount; segment++) {
+        CoatLayer layer = g_Fur.Layers[segment];
+        if (instance <= layer.LastShell) {
+            if (layer.LastShell == first) return layer.Reach;
+            return start + (float)(instance - first) * (layer.Reach - start) / (float)(layer.LastShell - first);
+        }
+        first = layer.LastShell;
+        start = layer.Reach;
+    }
+    segment = g_Fur.LayerCount - 1;
+    return start;
+}
+
 VS_OUT main(VS_IN input) {
     VS_OUT output;
     
     // Normalized height 'h' goes from 0.0 (skin) to 1.0 (tips)
-    float h = (float)input.InstanceID / (float)(g_Fur.ShellCount - 1);
+#ifdef FUR_IMPOSTOR
+    // Impostor layer i stands in for band i of the drawn shells (FurVolumeBaker::BandBoundary)
+    // and sits in the middle of it
+    float shellTop = (float)(g_Frame.ShellInstances - 1) / (float)(g_Fur.ShellCount - 1);
+    float h = ((float)input.InstanceID + 0.5f) / (float)g_Frame.ImpostorLayers * shellTop;
+    output.ImpostorLayer = input.InstanceID;
+    output.CoatSegment = g_Fur.LayerCount - 1;
+#else
+    // One instance per shell of the coat; heights are fractions of the longest layer
+    uint segment;
+    float h = CoatShellHeight(input.InstanceID, segment);
+    output.CoatSegment = segment;
+#endif
     
     // Create strand frizz/jitter using the UV and instance ID
     // Magic numbers are just arbitrary non-collinear primes for hashing
@@ -52,13 +166,17 @@ VS_OUT main(VS_IN input) {
     float3 basePosWS = mul(float4(input.Pos, 1.0f), g_Frame.World).xyz;
     float3 normalWS = normalize(mul(input.Normal, (float3x3)g_Frame.World));
     
-    // Apply jitter to the normal vector, scaling the jitter intensity by height 
+    // Combed direction and length from the groom map; along the normal without guides
+    float4 strand = GroomedStrand(input.UV, normalWS, input.Tangent);
+    float furLength = g_Fur.FurLength * g_Frame.FurScale * strand.w;
+    
+    // Apply jitter to the strand direction, scaling the jitter intensity by height 
     // so roots stay attached but tips frizz out. 
     // Scale down the overall frizz amount to keep it subtle
-    float3 frizzNormalWS = normalize(normalWS + jitter * h * 0.4f);
+    float3 frizzNormalWS = normalize(strand.xyz + jitter * h * 0.4f);
     
-    // Stage 1: Extrude vertex along frizz normal in World Space
-    float3 extrusion = frizzNormalWS * h * g_Fur.FurLength;
+    // Stage 1: Extrude vertex along frizz direction in World Space
+    float3 extrusion = frizzNormalWS * h * furLength;
     
     // Stage 2: Gravity droop (quadratic stiffness: t^2 weighting)
     float stiffness = h * h; 
@@ -79,13 +197,15 @@ VS_OUT main(VS_IN input) {
     // Length preservation
     float currentLen = length(combinedDisplacement);
     float3 strandDir = combinedDisplacement / currentLen;
-    float3 finalPosWS = basePosWS + strandDir * (h * g_Fur.FurLength);
+    float3 finalPosWS = basePosWS + strandDir * (h * furLength);
     
     output.PosWS = finalPosWS;
     output.PosCS = mul(float4(finalPosWS, 1.0f), g_Frame.ViewProj);
     output.NormalWS = normalWS;
     output.UV = input.UV;
     output.NormalizedHeight = h;
+    output.Occlusion = OcclusionToWorld(input.Occlusion);
+    output.Strand = strand;
     
     return output;
 }
\ No newline at end of file
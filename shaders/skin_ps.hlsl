@@ -0,0 +1,70 @@
+struct FrameCB {
+    float4x4 ViewProj;
+    float4x4 World;
+    float4x4 LightViewProj;
+    float3 CameraPos;
+    float Time;
+    float3 Gravity;
+    float WindStrength;
+    float3 WindDirection;
+    float FurScale;
+    float4 OsmLayerEnds;
+    uint OsmLayerCount;
+    float ImpostorBlend;
+    uint ShellInstances;
+    uint ImpostorLayers;
+    uint DirectionalLights;
+    uint ClusterTilesX;
+    uint ClusterTilesY;
+    uint ClusterSlices;
+    float ClusterDepthScale;
+    float ClusterDepthBias;
+    float2 LightPadding;
+};
+ConstantBuffer<FrameCB> g_Frame : register(b0);
+
+// Coat layers by reach, the outermost last (FurCoat); heights are fractions of FurLength
+struct CoatLayer {
+    float Length;
+    float Density;
+    float Thickness;
+    uint NoiseChannel;
+    float3 Color;
+    float Reach;     // Height of the layer's top shell
+    uint LastShell;  // Last instance of the layer's segment
+    uint3 LayerPadding;
+};
+struct FurCB {
+    float FurLength; // The longest layer
+    uint ShellCount;
+    float Density;   // Density, Thickness and FurColor are the outermost layer's
+    float Thickness;
+    float3 FurColor;
+    uint ColorMap; // Heap slot of the colour map, 0xffffffff for none
+    uint LayerCount;
+    uint ShellInstances; // Of the coat draw
+    uint2 CoatPadding;
+    CoatLayer Layers[4];
+};
+// One entry per material, picked by a root constant the renderer sets per draw
+StructuredBuffer<FurCB> g_FurMaterials : register(t3);
+cbuffer DrawCB : register(b1) { uint g_MaterialIndex; };
+#define g_Fur g_FurMaterials[g_MaterialIndex]
+
+struct VS_OUT {
+    float4 PosCS : SV_POSITION;
+    float3 PosWS : POSITION;
+    float3 NormalWS : NORMAL;
+    float2 UV : TEXCOORD;
+    float NormalizedHeight : HEIGHT;
+};
+
+float4 main(VS_OUT input) : SV_TARGET {
+    // Only visible through gaps between strands. Matches the dark root end of the shell AO
+    // curve so the skin reads as the bottom of the coat rather than a separate surface.
+    float3 N = normalize(input.NormalWS);
+    float3 L = normalize(float3(1.0f, 1.0f, -1.0f)); // Same light direction as shell_ps
+    float wrap = saturate((dot(N, L) + 0.5f) / 1.5f);
+    float3 lighting = g_Fur.FurColor * (0.15f + 0.85f * wrap) * 0.1f;
+    return float4(lighting, 1.0f);
+}
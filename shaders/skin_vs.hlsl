@@ -0,0 +1,78 @@
+struct FrameCB {
+    float4x4 ViewProj;
+    float4x4 World;
+    float4x4 LightViewProj;
+    float3 CameraPos;
+    float Time;
+    float3 Gravity;
+    float WindStrength;
+    float3 WindDirection;
+    float FurScale;
+    float4 OsmLayerEnds;
+    uint OsmLayerCount;
+    float ImpostorBlend;
+    uint ShellInstances;
+    uint ImpostorLayers;
+    uint DirectionalLights;
+    uint ClusterTilesX;
+    uint ClusterTilesY;
+    uint ClusterSlices;
+    float ClusterDepthScale;
+    float ClusterDepthBias;
+    float2 LightPadding;
+};
+ConstantBuffer<FrameCB> g_Frame : register(b0);
+
+// Coat layers by reach, the outermost last (FurCoat); heights are fractions of FurLength
+struct CoatLayer {
+    float Length;
+    float Density;
+    float Thickness;
+    uint NoiseChannel;
+    float3 Color;
+    float Reach;     // Height of the layer's top shell
+    uint LastShell;  // Last instance of the layer's segment
+    uint3 LayerPadding;
+};
+struct FurCB {
+    float FurLength; // The longest layer
+    uint ShellCount;
+    float Density;   // Density, Thickness and FurColor are the outermost layer's
+    float Thickness;
+    float3 FurColor;
+    uint ColorMap; // Heap slot of the colour map, 0xffffffff for none
+    uint LayerCount;
+    uint ShellInstances; // Of the coat draw
+    uint2 CoatPadding;
+    CoatLayer Layers[4];
+};
+// One entry per material, picked by a root constant the renderer sets per draw
+StructuredBuffer<FurCB> g_FurMaterials : register(t3);
+cbuffer DrawCB : register(b1) { uint g_MaterialIndex; };
+#define g_Fur g_FurMaterials[g_MaterialIndex]
+
+struct VS_IN {
+    float3 Pos : POSITION;
+    float3 Normal : NORMAL;
+    float2 UV : TEXCOORD;
+};
+
+struct VS_OUT {
+    float4 PosCS : SV_POSITION;
+    float3 PosWS : POSITION;
+    float3 NormalWS : NORMAL;
+    float2 UV : TEXCOORD;
+    float NormalizedHeight : HEIGHT;
+};
+
+// Undisplaced base mesh. Writes the depth the shells and fins are tested against.
+VS_OUT main(VS_IN input) {
+    VS_OUT output;
+    float3 posWS = mul(float4(input.Pos, 1.0f), g_Frame.World).xyz;
+    output.PosWS = posWS;
+    output.PosCS = mul(float4(posWS, 1.0f), g_Frame.ViewProj);
+    output.NormalWS = normalize(mul(input.Normal, (float3x3)g_Frame.World));
+    output.UV = input.UV;
+    output.NormalizedHeight = 0.0f;
+    return output;
+}
@@ -0,0 +1,72 @@
+#include "Animation.h"
+#include <algorithm>
+#include <cmath>
+
+// Key interval holding 't' and the blend factor inside it; clamps outside the key range
+static void FindKeys(const std::vector<float>& times, float t, size_t& k0, size_t& k1, float& blend) {
+    auto it = std::upper_bound(times.begin(), times.end(), t);
+    if (it == times.begin()) {
+        k0 = k1 = 0;
+        blend = 0.0f;
+        return;
+    }
+    if (it == times.end()) {
+        k0 = k1 = times.size() - 1;
+        blend = 0.0f;
+        return;
+    }
+    k1 = (size_t)(it - times.begin());
+    k0 = k1 - 1;
+    float span = times[k1] - times[k0];
+    blend = span > 0.0f ? (t - times[k0]) / span : 0.0f;
+}
+
+void Animation::Sample(const Skeleton& skeleton, const AnimationClip& clip, float time, std::vector<JointPose>& pose) {
+    pose = skeleton.RestPose;
+    float t = clip.Duration > 0.0f ? std::fmod(time, clip.Duration) : 0.0f;
+    if (t < 0.0f) t += clip.Duration;
+
+    for (const AnimationChannel& channel : clip.Channels) {
+        if (channel.Times.empty() || channel.Joint >= pose.size()) continue;
+
+        size_t k0, k1;
+        float blend;
+        FindKeys(channel.Times, t, k0, k1, blend);
+        if (channel.Interpolation == AnimationInterpolation::Step) blend = 0.0f;
+
+        JointPose& joint = pose[channel.Joint];
+        if (channel.Path == AnimationPath::Rotation) {
+            const float* a = &channel.Values[k0 * 4];
+            const float* b = &channel.Values[k1 * 4];
+            joint.Rotation = Slerp(Quat(a[0], a[1], a[2], a[3]), Quat(b[0], b[1], b[2], b[3]), blend);
+        } else {
+            const float* a = &channel.Values[k0 * 3];
+            const float* b = &channel.Values[k1 * 3];
+            Float3 value = Float3(a[0], a[1], a[2]) * (1.0f - blend) + Float3(b[0], b[1], b[2]) * blend;
+            if (channel.Path == AnimationPath::Translation) {
+                joint.Translation = value;
+            } else {
+                joint.Scale = value;
+            }
+        }
+    }
+}
+
+void Animation::ComputePalette(const Skeleton& skeleton, const std::vector<JointPose>& pose, std::vector<Float4x4>& palette) {
+    uint32_t jointCount = skeleton.JointCount();
+    palette.resize(jointCount + 1);
+
+    // Parents come first, so one forward pass resolves every global transform. The globals
+    // are kept in the palette slots until the inverse bind is applied.
+    for (uint32_t j = 0; j < jointCount; j++) {
+        const JointPose& local = pose[j];
+        Float4x4 localMatrix = ComposeTrs(local.Translation, local.Rotation, local.Scale);
+        int32_t parent = skeleton.Parents[j];
+        palette[j] = Multiply(localMatrix, parent >= 0 ? palette[parent] : skeleton.RootTransform);
+    }
+    // Separate pass: the loop above still needed every parent's plain global transform
+    for (uint32_t j = 0; j < jointCount; j++) {
+        palette[j] = Multiply(skeleton.InverseBind[j], palette[j]);
+    }
+    palette[jointCount] = Float4x4::Identity();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "CoreMath.h"
+#include <string>
+#include <vector>
+
+// Skeletal animation independent of the file format: a joint hierarchy, keyframed clips, and
+// the skinning matrix palette for a sampled pose. GeometryGen fills these from glTF skins.
+// Matrices follow CoreMath (row vectors), so a joint's global transform is local * parentGlobal.
+
+struct JointPose {
+    Float3 Translation;
+    Quat Rotation;
+    Float3 Scale = Float3(1.0f, 1.0f, 1.0f);
+};
+
+struct Skeleton {
+    std::vector<std::string> Names;
+    std::vector<int32_t> Parents;      // -1 for roots; a parent always comes before its children
+    std::vector<Float4x4> InverseBind; // Mesh space -> joint space in the bind pose
+    std::vector<JointPose> RestPose;   // Local transforms of joints no channel animates
+    // Applied after the root joints: non-joint ancestors and the importer's axis/scale change
+    Float4x4 RootTransform = Float4x4::Identity();
+
+    uint32_t JointCount() const { return (uint32_t)Parents.size(); }
+    bool Empty() const { return Parents.empty(); }
+};
+
+enum class AnimationPath { Translation, Rotation, Scale };
+enum class AnimationInterpolation { Step, Linear };
+
+struct AnimationChannel {
+    uint32_t Joint = 0;
+    AnimationPath Path = AnimationPath::Translation;
+    AnimationInterpolation Interpolation = AnimationInterpolation::Linear;
+    std::vector<float> Times;  // Ascending, in seconds
+    std::vector<float> Values; // 3 floats per key, 4 (xyzw) for rotations
+};
+
+struct AnimationClip {
+    std::string Name;
+    float Duration = 0.0f;
+    std::vector<AnimationChannel> Channels;
+};
+
+class Animation {
+public:
+    // Local pose at 'time', wrapped into the clip so it loops. Joints without a channel keep
+    // their rest pose.
+    static void Sample(const Skeleton& skeleton, const AnimationClip& clip, float time, std::vector<JointPose>& pose);
+
+    // palette[j] = InverseBind[j] * global[j], taking bind-pose mesh space to posed mesh space.
+    // An extra identity entry at index JointCount() binds vertices that are outside the skin.
+    static void ComputePalette(const Skeleton& skeleton, const std::vector<JointPose>& pose, std::vector<Float4x4>& palette);
+};
@@ -0,0 +1,95 @@
+#include "AssetGraph.h"
+#include "Hash.h"
+#include <algorithm>
+
+AssetId AssetGraph::Add(const std::string& name, AssetKind kind, uint64_t hash) {
+    if (!m_names.emplace(name, (AssetId)m_nodes.size()).second) return InvalidAsset;
+    AssetNode node;
+    node.Name = name;
+    node.Kind = kind;
+    node.Hash = hash;
+    m_nodes.push_back(std::move(node));
+    return (AssetId)m_nodes.size() - 1;
+}
+
+AssetId AssetGraph::AddSource(const std::string& name, uint64_t hash) {
+    return Add(name, AssetKind::Source, hash);
+}
+
+AssetId AssetGraph::AddSettings(const std::string& name, uint64_t hash) {
+    return Add(name, AssetKind::Settings, hash);
+}
+
+AssetId AssetGraph::AddDerived(const std::string& name, const std::vector<AssetId>& inputs) {
+    for (AssetId input : inputs) {
+        if (input >= m_nodes.size()) return InvalidAsset;
+    }
+    AssetId id = Add(name, AssetKind::Derived, 0);
+    if (id == InvalidAsset) return id;
+    m_nodes[id].Inputs = inputs;
+    for (AssetId input : inputs) m_nodes[input].Dependents.push_back(id);
+    // Never built: the next Plan includes it
+    m_nodes[id].Stale = true;
+    m_firstStale = std::min(m_firstStale, id);
+    return id;
+}
+
+AssetId AssetGraph::Find(const std::string& name) const {
+    auto it = m_names.find(name);
+    return it == m_names.end() ? InvalidAsset : it->second;
+}
+
+bool AssetGraph::SetHash(AssetId id, uint64_t hash) {
+    AssetNode& node = m_nodes[id];
+    if (node.Kind == AssetKind::Derived || node.Hash == hash) return false;
+    node.Hash = hash;
+    node.Stale = true;
+    m_firstStale = std::min(m_firstStale, id);
+    return true;
+}
+
+std::vector<AssetId> AssetGraph::Plan() {
+    std::vector<AssetId> plan;
+    m_stats = {};
+    if (m_firstStale == InvalidAsset) return plan;
+
+    // Dependents always have larger ids, so one forward sweep from the first stale node reaches
+    // everything downstream in order
+    m_reached.assign(m_nodes.size(), 0);
+    for (AssetId id = m_firstStale; id < (AssetId)m_nodes.size(); id++) {
+        AssetNode& node = m_nodes[id];
+        if (!node.Stale && !m_reached[id]) continue;
+        node.Stale = false;
+        if (node.Kind == AssetKind::Derived) plan.push_back(id);
+        for (AssetId dependent : node.Dependents) m_reached[dependent] = 1;
+    }
+    m_firstStale = InvalidAsset;
+    m_stats.Planned = (uint32_t)plan.size();
+    return plan;
+}
+
+uint64_t AssetGraph::InputHash(AssetId id) const {
+    uint64_t hash = HashSeed;
+    for (AssetId input : m_nodes[id].Inputs) hash = HashBytes(hash, &m_nodes[input].Hash, sizeof(uint64_t));
+    return hash;
+}
+
+bool AssetGraph::NeedsBuild(AssetId id) const {
+    const AssetNode& node = m_nodes[id];
+    return node.Kind == AssetKind::Derived && (!node.Built || node.BuiltFrom != InputHash(id));
+}
+
+void AssetGraph::MarkBuilt(AssetId id, uint64_t outputHash) {
+    AssetNode& node = m_nodes[id];
+    m_stats.Rebuilt++;
+    if (node.Built && node.Hash == outputHash) m_stats.Unchanged++;
+    node.Hash = outputHash;
+    node.BuiltFrom = InputHash(id);
+    node.Built = true;
+}
+
+void AssetGraph::MarkFailed(AssetId) {
+    // Nothing to record: the node keeps the input hash of its last good build, so it is rebuilt
+    // once an input changes again, and not if the change is undone
+    m_stats.Failed++;
+}
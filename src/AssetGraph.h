@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Dependency tracking for hot reload. Sources (files) and settings carry a content hash. Derived
+// data (compiled shader variants, PSOs, baked maps, GPU buffers) lists the nodes it is built from
+// and remembers the hash of those inputs at its last build, and the hash of what it produced.
+//
+// After sources change, Plan() lists the derived nodes downstream of them in dependency order.
+// The caller walks the list and rebuilds a node only if NeedsBuild(): the inputs' hashes now
+// differ from the ones it was built from. A rebuild that produces the same output as before (a
+// shader edited only in a comment, an edited glTF whose materials stayed the same) reports the
+// same hash to MarkBuilt, and nothing after it is rebuilt.
+//
+// Inputs must exist before the nodes that use them, so ids are a topological order and the graph
+// can't have cycles.
+
+using AssetId = uint32_t;
+static constexpr AssetId InvalidAsset = UINT32_MAX;
+
+enum class AssetKind : uint32_t { Source, Settings, Derived };
+
+struct AssetNode {
+    std::string Name;
+    AssetKind Kind = AssetKind::Source;
+    std::vector<AssetId> Inputs;
+    std::vector<AssetId> Dependents;
+    uint64_t Hash = 0;      // Content of a source or settings; the output of a derived node once built
+    uint64_t BuiltFrom = 0; // Derived: InputHash() at the last MarkBuilt
+    bool Built = false;     // Derived: MarkBuilt was called at least once
+    bool Stale = false;     // Changed since the last Plan, or a derived node added since then
+};
+
+struct AssetGraphStats {
+    uint32_t Planned = 0;   // Nodes the last Plan returned
+    uint32_t Rebuilt = 0;   // MarkBuilt calls since that Plan
+    uint32_t Unchanged = 0; // Of those, builds whose output hash stayed the same
+    uint32_t Failed = 0;
+};
+
+class AssetGraph {
+public:
+    AssetId AddSource(const std::string& name, uint64_t hash = 0);
+    AssetId AddSettings(const std::string& name, uint64_t hash);
+    // InvalidAsset if an input doesn't exist or the name is taken
+    AssetId AddDerived(const std::string& name, const std::vector<AssetId>& inputs);
+    AssetId Find(const std::string& name) const;
+
+    // New content of a source or settings node. Returns whether it changed.
+    bool SetHash(AssetId id, uint64_t hash);
+
+    // Derived nodes that may be out of date, in dependency order: those downstream of a node that
+    // changed since the last Plan, and those added since. Clears the changes; call NeedsBuild on
+    // each just before building it.
+    std::vector<AssetId> Plan();
+    bool NeedsBuild(AssetId id) const;
+    // Order-dependent hash of the inputs' hashes: a cache key for the node's output
+    uint64_t InputHash(AssetId id) const;
+    void MarkBuilt(AssetId id, uint64_t outputHash);
+    // The previous output stays in use; the node is rebuilt after its inputs change again
+    void MarkFailed(AssetId id);
+
+    const AssetNode& Node(AssetId id) const { return m_nodes[id]; }
+    uint32_t NodeCount() const { return (uint32_t)m_nodes.size(); }
+    const AssetGraphStats& Stats() const { return m_stats; }
+
+private:
+    AssetId Add(const std::string& name, AssetKind kind, uint64_t hash);
+
+    std::vector<AssetNode> m_nodes;
+    std::unordered_map<std::string, AssetId> m_names;
+    AssetId m_firstStale = InvalidAsset; // No stale node before it
+    std::vector<uint8_t> m_reached;      // Plan scratch
+    AssetGraphStats m_stats;
+};
@@ -0,0 +1,244 @@
+// Headless asset-processing memory benchmark: the load-time steps of GeometryGen::LoadGLTF run
+// on a carpet-sized mesh twice, once as they were (indices appended without reserving, an
+// std::map from edge to a vector of triangles for adjacency, decimation into copies) and once
+// as they are now (reserved once, MeshAdjacency with its scratch in a LinearArena, decimation in
+// place). Every heap allocation in the process is counted through a global operator new, so the
+// table shows allocations, peak heap and time per step, and the two adjacency buffers must be
+// identical. The mesh is the glTF's own when its buffers are present, otherwise a carpet tile
+// generated at the glTF's triangle count (or at 'triangle cap' if smaller).
+// Usage: PelageAssetMemoryBench [gltf] [triangle cap]
+#include "MemoryArena.h"
+#include "MeshAdjacency.h"
+#include "MeshStream.h"
+#include "SceneGen.h"
+#include "Timing.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <new>
+
+// Every allocation carries its size (and the malloc'd block) in a header, so frees can be
+// subtracted from the live total
+static std::atomic<uint64_t> g_heapBytes{ 0 };
+static std::atomic<uint64_t> g_heapPeak{ 0 };
+static std::atomic<uint64_t> g_heapAllocations{ 0 };
+static constexpr size_t HeaderSize = 2 * sizeof(void*) > alignof(std::max_align_t) ? 2 * sizeof(void*) : alignof(std::max_align_t);
+
+// Over-aligned requests (the arenas' blocks come through std::pmr::new_delete_resource) take a
+// header as large as their alignment, with the size in the word just before the pointer
+static void* CountedAlloc(size_t size, size_t alignment) {
+    const size_t header = std::max(HeaderSize, alignment);
+    void* block = std::malloc(size + header + alignment);
+    if (!block) throw std::bad_alloc();
+    uintptr_t p = ((uintptr_t)block + header + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    reinterpret_cast<size_t*>(p)[-1] = size;
+    reinterpret_cast<void**>(p)[-2] = block;
+    uint64_t live = g_heapBytes += size;
+    uint64_t peak = g_heapPeak.load();
+    while (live > peak && !g_heapPeak.compare_exchange_weak(peak, live)) {}
+    g_heapAllocations++;
+    return reinterpret_cast<void*>(p);
+}
+
+static void CountedFree(void* p) {
+    if (!p) return;
+    g_heapBytes -= static_cast<size_t*>(p)[-1];
+    std::free(static_cast<void**>(p)[-2]);
+}
+
+void* operator new(size_t size) { return CountedAlloc(size, HeaderSize); }
+void* operator new[](size_t size) { return CountedAlloc(size, HeaderSize); }
+void* operator new(size_t size, std::align_val_t alignment) { return CountedAlloc(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return CountedAlloc(size, (size_t)alignment); }
+void operator delete(void* p) noexcept { CountedFree(p); }
+void operator delete[](void* p) noexcept { CountedFree(p); }
+void operator delete(void* p, size_t) noexcept { CountedFree(p); }
+void operator delete[](void* p, size_t) noexcept { CountedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { CountedFree(p); }
+
+struct StepResult {
+    double Ms = 0.0;
+    uint64_t Allocations = 0;
+    uint64_t PeakBytes = 0; // Above the live heap when the step started
+};
+
+template <typename Step>
+static StepResult Measure(Step&& step) {
+    const uint64_t base = g_heapBytes.load();
+    const uint64_t allocations = g_heapAllocations.load();
+    g_heapPeak.store(base);
+    auto start = Clock::now();
+    step();
+    StepResult result;
+    result.Ms = MillisecondsSince(start);
+    result.Allocations = g_heapAllocations.load() - allocations;
+    result.PeakBytes = g_heapPeak.load() - base;
+    return result;
+}
+
+// GeometryGen's adjacency before the arena, verbatim apart from the mesh arguments
+struct Edge {
+    uint32_t v1, v2;
+    bool operator<(const Edge& other) const {
+        if (v1 != other.v1) return v1 < other.v1;
+        return v2 < other.v2;
+    }
+};
+
+static void LegacyAdjacency(const std::vector<uint32_t>& indices, std::vector<uint32_t>& indicesAdj) {
+    std::map<Edge, std::vector<uint32_t>> edgeToTri;
+    uint32_t numTris = (uint32_t)indices.size() / 3;
+    for (uint32_t i = 0; i < numTris; i++) {
+        uint32_t i0 = indices[i*3 + 0];
+        uint32_t i1 = indices[i*3 + 1];
+        uint32_t i2 = indices[i*3 + 2];
+        edgeToTri[{ std::min(i0,i1), std::max(i0,i1) }].push_back(i);
+        edgeToTri[{ std::min(i1,i2), std::max(i1,i2) }].push_back(i);
+        edgeToTri[{ std::min(i2,i0), std::max(i2,i0) }].push_back(i);
+    }
+    indicesAdj.resize(numTris * 6);
+    for (uint32_t i = 0; i < numTris; i++) {
+        uint32_t i0 = indices[i*3 + 0];
+        uint32_t i1 = indices[i*3 + 1];
+        uint32_t i2 = indices[i*3 + 2];
+        uint32_t adj[3] = { i0, i1, i2 };
+        Edge edges[3] = {
+            { std::min(i0,i1), std::max(i0,i1) },
+            { std::min(i1,i2), std::max(i1,i2) },
+            { std::min(i2,i0), std::max(i2,i0) }
+        };
+        for (int e = 0; e < 3; e++) {
+            const auto& tris = edgeToTri[edges[e]];
+            for (uint32_t t : tris) {
+                if (t != i) {
+                    uint32_t n0 = indices[t*3+0];
+                    uint32_t n1 = indices[t*3+1];
+                    uint32_t n2 = indices[t*3+2];
+                    if (n0 != edges[e].v1 && n0 != edges[e].v2) adj[e] = n0;
+                    if (n1 != edges[e].v1 && n1 != edges[e].v2) adj[e] = n1;
+                    if (n2 != edges[e].v1 && n2 != edges[e].v2) adj[e] = n2;
+                    break;
+                }
+            }
+        }
+        indicesAdj[i*6 + 0] = i0;
+        indicesAdj[i*6 + 1] = adj[0];
+        indicesAdj[i*6 + 2] = i1;
+        indicesAdj[i*6 + 3] = adj[1];
+        indicesAdj[i*6 + 4] = i2;
+        indicesAdj[i*6 + 5] = adj[2];
+    }
+}
+
+static void PrintRow(const char* name, const StepResult& before, const StepResult& after) {
+    printf("%-12s %10.1f %12llu %10.1f   %10.1f %12llu %10.1f\n", name,
+           before.Ms, (unsigned long long)before.Allocations, before.PeakBytes / (1024.0 * 1024.0),
+           after.Ms, (unsigned long long)after.Allocations, after.PeakBytes / (1024.0 * 1024.0));
+}
+
+int main(int argc, char** argv) {
+    const std::string gltfPath = argc > 1 ? argv[1] : "assets/fur_carpet/scene.gltf";
+    const uint64_t cap = argc > 2 ? (uint64_t)std::max(atoll(argv[2]), 1000ll) : UINT64_MAX;
+
+    MeshArrays source;
+    MeshStreamSummary summary;
+    uint64_t targetTriangles = 4000000;
+    if (MeshStreamer::Describe(gltfPath, summary)) {
+        targetTriangles = summary.Triangles;
+        MeshStreamer::LoadInCore(gltfPath, MeshStreamSettings(), source);
+    }
+    // Missing buffer files read as zeros
+    const bool loaded = std::any_of(source.Vertices.begin(), source.Vertices.end(), [](float v) { return v != 0.0f; });
+    if (loaded && source.TriangleCount() <= cap) {
+        printf("%s: %llu triangles, %llu vertices\n", gltfPath.c_str(),
+               (unsigned long long)source.TriangleCount(), (unsigned long long)source.VertexCount());
+    } else {
+        // The glTF's buffers are not here (or it is over the cap): a carpet tile of the same size
+        SynthScene scene;
+        SynthObject tile;
+        tile.Shape = SynthShape::CarpetTile;
+        tile.Resolution = SceneGen::ResolutionFor(SynthShape::CarpetTile, std::min(targetTriangles, cap));
+        scene.Objects.push_back(tile);
+        JobSystem jobs;
+        SceneGen(jobs).Generate(scene, source);
+        printf("%s buffers not loaded: carpet tile stand-in, %llu triangles, %llu vertices\n", gltfPath.c_str(),
+               (unsigned long long)source.TriangleCount(), (unsigned long long)source.VertexCount());
+    }
+    const std::vector<uint32_t>& sourceIndices = source.Indices;
+    const std::vector<uint32_t>& sourceMaterials = source.TriangleMaterials;
+    const size_t triangleCount = source.TriangleCount();
+
+    printf("%-12s %10s %12s %10s   %10s %12s %10s\n", "step", "before ms", "allocs", "peak MB", "after ms", "allocs", "peak MB");
+
+    // Index assembly, one primitive at a time
+    std::vector<uint32_t> legacyIndices, legacyMaterials;
+    StepResult legacyAssemble = Measure([&] {
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (int c = 0; c < 3; c++) legacyIndices.push_back(sourceIndices[t * 3 + c]);
+            legacyMaterials.push_back(sourceMaterials.empty() ? 0 : sourceMaterials[t]);
+        }
+    });
+    std::vector<uint32_t> indices, materials;
+    StepResult assemble = Measure([&] {
+        indices.reserve(triangleCount * 3);
+        materials.reserve(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (int c = 0; c < 3; c++) indices.push_back(sourceIndices[t * 3 + c]);
+            materials.push_back(sourceMaterials.empty() ? 0 : sourceMaterials[t]);
+        }
+    });
+    PrintRow("assemble", legacyAssemble, assemble);
+
+    std::vector<uint32_t> legacyAdj, adj;
+    StepResult legacyAdjacency = Measure([&] { LegacyAdjacency(legacyIndices, legacyAdj); });
+    StepResult adjacency = Measure([&] {
+        LinearArena arena(MemoryTracker::Counter("Adjacency"));
+        adj.resize(indices.size() * 2);
+        MeshAdjacency::Build(indices.data(), indices.size() / 3, adj.data(), &arena);
+    });
+    PrintRow("adjacency", legacyAdjacency, adjacency);
+
+    // GeometryGen's 1-in-200 cut for meshes over 500K vertices
+    const size_t step = 200;
+    StepResult legacyDecimate = Measure([&] {
+        std::vector<uint32_t> downsampledIndices, downsampledMaterials;
+        for (size_t i = 0; i < legacyIndices.size(); i += 3 * step) {
+            if (i + 2 < legacyIndices.size()) {
+                downsampledIndices.push_back(legacyIndices[i]);
+                downsampledIndices.push_back(legacyIndices[i+1]);
+                downsampledIndices.push_back(legacyIndices[i+2]);
+                downsampledMaterials.push_back(legacyMaterials[i / 3]);
+            }
+        }
+        legacyIndices = downsampledIndices;
+        legacyMaterials = downsampledMaterials;
+    });
+    StepResult decimate = Measure([&] {
+        size_t kept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3 * step) {
+            if (i + 2 < indices.size()) {
+                indices[kept * 3 + 0] = indices[i];
+                indices[kept * 3 + 1] = indices[i+1];
+                indices[kept * 3 + 2] = indices[i+2];
+                materials[kept] = materials[i / 3];
+                kept++;
+            }
+        }
+        indices.resize(kept * 3);
+        indices.shrink_to_fit();
+        materials.resize(kept);
+        materials.shrink_to_fit();
+    });
+    PrintRow("decimate", legacyDecimate, decimate);
+
+    const bool identical = legacyAdj == adj && legacyIndices == indices && legacyMaterials == materials;
+    printf("Adjacency and decimated triangles %s\n", identical ? "identical" : "DIFFERENT");
+    printf("%s", MemoryTracker::Report().c_str());
+    return identical ? 0 : 1;
+}
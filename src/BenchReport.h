@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h> // Defines 'near' and 'far' as empty macros: not for names in the benches
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// The headless benches check their system on cases with known answers before timing it: one
+// line per check, and main returns 1 if any failed. Returns 'pass', for 'ok &= Report(...)'.
+inline bool Report(const char* name, bool pass) { printf("%-34s %s\n", name, pass ? "ok" : "FAILED"); return pass; }
+
+// Peak resident set of the process so far; benches that call it link psapi on Windows
+inline double PeakRssMB() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0); // Bytes
+#else
+    return usage.ru_maxrss / 1024.0;            // Kilobytes
+#endif
+#endif
+}
@@ -0,0 +1,346 @@
+#include "Bvh.h"
+#include "Simd.h"
+#include "Timing.h"
+#include <bit>
+#include <numeric>
+
+static float AxisValue(const Float3& v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+static float HalfArea(const Aabb& b) {
+    if (b.IsEmpty()) return 0.0f;
+    Float3 d = b.Max - b.Min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+using BoxClass = Bvh4::BoxClass;
+
+BoxClass Bvh4::ClassifyBox(const Frustum& frustum, const Aabb& box) {
+    BoxClass result = BoxClass::Inside;
+    for (const Plane& p : frustum.Planes) {
+        // Corner furthest along the normal decides "outside", the nearest one "inside"
+        Float3 far(p.Normal.x > 0.0f ? box.Max.x : box.Min.x,
+                   p.Normal.y > 0.0f ? box.Max.y : box.Min.y,
+                   p.Normal.z > 0.0f ? box.Max.z : box.Min.z);
+        Float3 near(p.Normal.x > 0.0f ? box.Min.x : box.Max.x,
+                    p.Normal.y > 0.0f ? box.Min.y : box.Max.y,
+                    p.Normal.z > 0.0f ? box.Min.z : box.Max.z);
+        if (p.Distance(far) < 0.0f) return BoxClass::Outside;
+        if (p.Distance(near) < 0.0f) result = BoxClass::Intersecting;
+    }
+    return result;
+}
+
+// Classifies the four child boxes of a node at once. Bit i of the masks refers to slot i.
+static void ClassifyChildren(const Bvh4Node& node, const Frustum& frustum, uint32_t& outsideMask, uint32_t& insideMask) {
+#if PELAGE_SSE2
+    __m128 minX = _mm_load_ps(node.MinX), minY = _mm_load_ps(node.MinY), minZ = _mm_load_ps(node.MinZ);
+    __m128 maxX = _mm_load_ps(node.MaxX), maxY = _mm_load_ps(node.MaxY), maxZ = _mm_load_ps(node.MaxZ);
+    __m128 zero = _mm_setzero_ps();
+    __m128 outside = zero;
+    __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+    for (const Plane& p : frustum.Planes) {
+        __m128 nx = _mm_set1_ps(p.Normal.x), ny = _mm_set1_ps(p.Normal.y), nz = _mm_set1_ps(p.Normal.z);
+        __m128 ax = _mm_mul_ps(nx, minX), bx = _mm_mul_ps(nx, maxX);
+        __m128 ay = _mm_mul_ps(ny, minY), by = _mm_mul_ps(ny, maxY);
+        __m128 az = _mm_mul_ps(nz, minZ), bz = _mm_mul_ps(nz, maxZ);
+        __m128 d = _mm_set1_ps(p.D);
+
+        // min/max per axis picks the nearest/furthest corner without branching on the normal sign
+        __m128 farDist = _mm_add_ps(_mm_add_ps(_mm_max_ps(ax, bx), _mm_max_ps(ay, by)), _mm_add_ps(_mm_max_ps(az, bz), d));
+        __m128 nearDist = _mm_add_ps(_mm_add_ps(_mm_min_ps(ax, bx), _mm_min_ps(ay, by)), _mm_add_ps(_mm_min_ps(az, bz), d));
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(farDist, zero));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(nearDist, zero));
+    }
+    outsideMask = (uint32_t)_mm_movemask_ps(outside);
+    insideMask = (uint32_t)_mm_movemask_ps(inside) & ~outsideMask;
+#else
+    outsideMask = 0;
+    insideMask = 0;
+    for (int i = 0; i < 4; i++) {
+        Aabb box;
+        box.Min = Float3(node.MinX[i], node.MinY[i], node.MinZ[i]);
+        box.Max = Float3(node.MaxX[i], node.MaxY[i], node.MaxZ[i]);
+        BoxClass c = Bvh4::ClassifyBox(frustum, box);
+        if (c == BoxClass::Outside) outsideMask |= 1u << i;
+        else if (c == BoxClass::Inside) insideMask |= 1u << i;
+    }
+#endif
+}
+
+void Bvh4::Build(const std::vector<Aabb>& primitiveBounds, float inflation, uint32_t maxLeafSize) {
+    Clock::time_point start = Clock::now();
+
+    m_stats = Bvh4Stats();
+    m_nodes.clear();
+    m_primBounds = primitiveBounds;
+    m_maxLeafSize = std::max(maxLeafSize, 1u);
+    m_inflation = inflation;
+
+    uint32_t count = (uint32_t)m_primBounds.size();
+    m_primIndices.resize(count);
+    std::iota(m_primIndices.begin(), m_primIndices.end(), 0u);
+    if (count == 0) return;
+
+    BuildRange root = { 0, count, Aabb(), Aabb() };
+    m_centroids.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        m_centroids[i] = m_primBounds[i].Center();
+        root.Bounds.Expand(m_primBounds[i]);
+        root.CentroidBounds.Expand(m_centroids[i]);
+    }
+
+    m_nodes.reserve(count / 2 + 1);
+    BuildNode(root, 1);
+    m_centroids.clear();
+    m_centroids.shrink_to_fit();
+
+    // Topology only so far; the boxes come from the same sweep Refit uses
+    Refit(inflation);
+
+    m_stats.NodeCount = (uint32_t)m_nodes.size();
+    m_stats.BuildMs = MillisecondsSince(start);
+}
+
+uint32_t Bvh4::BuildNode(BuildRange range, uint32_t depth) {
+    uint32_t nodeIndex = (uint32_t)m_nodes.size();
+    Bvh4Node node = {};
+    for (int i = 0; i < 4; i++) node.Child[i] = Bvh4Node::InvalidChild;
+    m_nodes.push_back(node);
+    m_stats.Depth = std::max(m_stats.Depth, depth);
+
+    // Keep splitting the largest child until there are four or all of them fit in a leaf
+    BuildRange children[4] = { range };
+    int childCount = 1;
+    while (childCount < 4) {
+        int best = -1;
+        float bestArea = -1.0f;
+        for (int i = 0; i < childCount; i++) {
+            float area = HalfArea(children[i].Bounds);
+            if (children[i].End - children[i].Begin > m_maxLeafSize && area > bestArea) {
+                best = i;
+                bestArea = area;
+            }
+        }
+        if (best < 0) break;
+
+        BuildRange left, right;
+        SplitRange(children[best], left, right);
+        children[best] = left;
+        children[childCount++] = right;
+    }
+
+    for (int i = 0; i < childCount; i++) {
+        uint32_t count = children[i].End - children[i].Begin;
+        if (count <= m_maxLeafSize) {
+            m_nodes[nodeIndex].Child[i] = children[i].Begin;
+            m_nodes[nodeIndex].Count[i] = count;
+            m_stats.LeafCount++;
+        } else {
+            uint32_t child = BuildNode(children[i], depth + 1); // May reallocate m_nodes
+            m_nodes[nodeIndex].Child[i] = child;
+        }
+    }
+    return nodeIndex;
+}
+
+bool Bvh4::SplitRange(const BuildRange& range, BuildRange& left, BuildRange& right) {
+    const int BinCount = 16;
+    uint32_t* first = m_primIndices.data() + range.Begin;
+    uint32_t* last = m_primIndices.data() + range.End;
+    uint32_t* mid = nullptr;
+
+    Float3 extent = range.CentroidBounds.Max - range.CentroidBounds.Min;
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    float axisMin = AxisValue(range.CentroidBounds.Min, axis);
+    float axisExtent = AxisValue(extent, axis);
+
+    if (axisExtent > 0.0f) {
+        float scale = (float)BinCount * 0.9999f / axisExtent;
+        auto binOf = [&](uint32_t prim) {
+            return std::min(BinCount - 1, (int)((AxisValue(m_centroids[prim], axis) - axisMin) * scale));
+        };
+
+        Aabb binBounds[BinCount];
+        uint32_t binCounts[BinCount] = {};
+        for (uint32_t* p = first; p != last; ++p) {
+            int b = binOf(*p);
+            binBounds[b].Expand(m_primBounds[*p]);
+            binCounts[b]++;
+        }
+
+        // Sweep from the right to get the cost of every right-hand side, then from the left
+        float rightCost[BinCount] = {};
+        Aabb accum;
+        uint32_t accumCount = 0;
+        for (int b = BinCount - 1; b > 0; b--) {
+            accum.Expand(binBounds[b]);
+            accumCount += binCounts[b];
+            rightCost[b] = HalfArea(accum) * (float)accumCount;
+        }
+
+        int bestSplit = -1;
+        float bestCost = std::numeric_limits<float>::max();
+        accum = Aabb();
+        accumCount = 0;
+        for (int b = 0; b < BinCount - 1; b++) {
+            accum.Expand(binBounds[b]);
+            accumCount += binCounts[b];
+            if (accumCount == 0 || accumCount == range.End - range.Begin) continue;
+            float cost = HalfArea(accum) * (float)accumCount + rightCost[b + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestSplit = b;
+            }
+        }
+
+        if (bestSplit >= 0) {
+            mid = std::partition(first, last, [&](uint32_t prim) { return binOf(prim) <= bestSplit; });
+        }
+    }
+
+    // Coincident centroids or a degenerate binning: split at the median so leaves stay bounded
+    bool usedSah = mid != nullptr && mid != first && mid != last;
+    if (!usedSah) {
+        mid = first + (last - first) / 2;
+        std::nth_element(first, mid, last, [&](uint32_t a, uint32_t b) {
+            return AxisValue(m_centroids[a], axis) < AxisValue(m_centroids[b], axis);
+        });
+    }
+
+    uint32_t split = (uint32_t)(mid - m_primIndices.data());
+    left = { range.Begin, split, Aabb(), Aabb() };
+    right = { split, range.End, Aabb(), Aabb() };
+    for (BuildRange* r : { &left, &right }) {
+        for (uint32_t i = r->Begin; i < r->End; i++) {
+            r->Bounds.Expand(m_primBounds[m_primIndices[i]]);
+            r->CentroidBounds.Expand(m_centroids[m_primIndices[i]]);
+        }
+    }
+    return usedSah;
+}
+
+void Bvh4::SetChild(Bvh4Node& node, int slot, const Aabb& bounds) const {
+    node.MinX[slot] = bounds.Min.x; node.MinY[slot] = bounds.Min.y; node.MinZ[slot] = bounds.Min.z;
+    node.MaxX[slot] = bounds.Max.x; node.MaxY[slot] = bounds.Max.y; node.MaxZ[slot] = bounds.Max.z;
+}
+
+void Bvh4::Refit(const std::vector<Aabb>& primitiveBounds, float inflation) {
+    if (primitiveBounds.size() != m_primBounds.size()) {
+        Build(primitiveBounds, inflation, m_maxLeafSize);
+        return;
+    }
+    m_primBounds = primitiveBounds;
+    Refit(inflation);
+}
+
+void Bvh4::Refit(float inflation) {
+    Clock::time_point start = Clock::now();
+    m_inflation = inflation;
+
+    // Children always follow their parent, so a reverse sweep sees them finished
+    for (size_t n = m_nodes.size(); n-- > 0;) {
+        Bvh4Node& node = m_nodes[n];
+        for (int i = 0; i < 4; i++) {
+            Aabb bounds;
+            if (node.Child[i] == Bvh4Node::InvalidChild) {
+                // Empty slots keep an inverted box; traversal skips them by index anyway
+            } else if (node.Count[i] > 0) {
+                for (uint32_t k = node.Child[i]; k < node.Child[i] + node.Count[i]; k++) {
+                    bounds.Expand(m_primBounds[m_primIndices[k]]);
+                }
+                bounds = bounds.Inflated(inflation);
+            } else {
+                const Bvh4Node& child = m_nodes[node.Child[i]];
+                for (int c = 0; c < 4; c++) {
+                    if (child.Child[c] == Bvh4Node::InvalidChild) continue;
+                    bounds.Expand(Float3(child.MinX[c], child.MinY[c], child.MinZ[c]));
+                    bounds.Expand(Float3(child.MaxX[c], child.MaxY[c], child.MaxZ[c]));
+                }
+            }
+            SetChild(node, i, bounds);
+        }
+    }
+    m_stats.RefitMs = MillisecondsSince(start);
+}
+
+Aabb Bvh4::Bounds() const {
+    Aabb bounds;
+    if (m_nodes.empty()) return bounds;
+    const Bvh4Node& root = m_nodes[0];
+    for (int i = 0; i < 4; i++) {
+        if (root.Child[i] == Bvh4Node::InvalidChild) continue;
+        bounds.Expand(Float3(root.MinX[i], root.MinY[i], root.MinZ[i]));
+        bounds.Expand(Float3(root.MaxX[i], root.MaxY[i], root.MaxZ[i]));
+    }
+    return bounds;
+}
+
+void Bvh4::CullFrusta(const Frustum* frusta, uint32_t frustumCount, std::vector<uint32_t>& masks) {
+    Clock::time_point start = Clock::now();
+    masks.assign(m_primBounds.size(), 0);
+    m_stats.QueryNodesVisited = 0;
+
+    frustumCount = std::min(frustumCount, MaxFrusta);
+    if (m_nodes.empty() || frustumCount == 0) {
+        m_stats.QueryMs = MillisecondsSince(start);
+        return;
+    }
+
+    // Per entry: frusta that still need testing, and frusta known to contain the whole node
+    struct StackEntry {
+        uint32_t Node;
+        uint32_t Partial;
+        uint32_t Inside;
+    };
+    std::vector<StackEntry> stack;
+    stack.reserve(64);
+    uint32_t allFrusta = frustumCount == 32 ? 0xffffffffu : (1u << frustumCount) - 1;
+    stack.push_back({ 0, allFrusta, 0 });
+
+    while (!stack.empty()) {
+        StackEntry entry = stack.back();
+        stack.pop_back();
+        const Bvh4Node& node = m_nodes[entry.Node];
+        m_stats.QueryNodesVisited++;
+
+        uint32_t childPartial[4] = {};
+        uint32_t childInside[4] = { entry.Inside, entry.Inside, entry.Inside, entry.Inside };
+        for (uint32_t bits = entry.Partial; bits; bits &= bits - 1) {
+            uint32_t f = (uint32_t)std::countr_zero(bits);
+            uint32_t outsideMask, insideMask;
+            ClassifyChildren(node, frusta[f], outsideMask, insideMask);
+            for (int i = 0; i < 4; i++) {
+                if (insideMask & (1u << i)) childInside[i] |= 1u << f;
+                else if (!(outsideMask & (1u << i))) childPartial[i] |= 1u << f;
+            }
+        }
+
+        for (int i = 0; i < 4; i++) {
+            if (node.Child[i] == Bvh4Node::InvalidChild) continue;
+            if ((childPartial[i] | childInside[i]) == 0) continue;
+
+            if (node.Count[i] == 0) {
+                stack.push_back({ node.Child[i], childPartial[i], childInside[i] });
+                continue;
+            }
+
+            // Leaf: primitives only need their own test against frusta that cut the leaf box
+            for (uint32_t k = node.Child[i]; k < node.Child[i] + node.Count[i]; k++) {
+                uint32_t prim = m_primIndices[k];
+                uint32_t mask = childInside[i];
+                if (childPartial[i]) {
+                    Aabb box = m_primBounds[prim].Inflated(m_inflation);
+                    for (uint32_t bits = childPartial[i]; bits; bits &= bits - 1) {
+                        uint32_t f = (uint32_t)std::countr_zero(bits);
+                        if (ClassifyBox(frusta[f], box) != BoxClass::Outside) mask |= 1u << f;
+                    }
+                }
+                masks[prim] |= mask;
+            }
+        }
+    }
+    m_stats.QueryMs = MillisecondsSince(start);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "CoreMath.h"
+#include <vector>
+
+// 4-wide bounding volume hierarchy over arbitrary primitive bounds (mesh clusters, triangles...).
+// Built top-down with binned SAH, then stored as a flat array of nodes whose four child boxes
+// are laid out SoA so one SSE2 register tests all four children against a plane.
+// Nodes are emitted in depth-first order (children always after their parent), which is what
+// lets Refit run as a single reverse sweep.
+//
+// Every primitive box is inflated by a uniform amount, e.g. the maximum fur displacement.
+// When the envelope changes (wind, simulation, skinning) Refit recomputes the boxes without
+// touching the topology.
+
+struct alignas(16) Bvh4Node {
+    static constexpr uint32_t InvalidChild = 0xffffffffu;
+
+    float MinX[4], MinY[4], MinZ[4];
+    float MaxX[4], MaxY[4], MaxZ[4];
+    uint32_t Child[4]; // Node index, or first primitive slot for leaves, InvalidChild for empty slots
+    uint32_t Count[4]; // 0 for interior children, otherwise the number of primitives in the leaf
+};
+
+struct Bvh4Stats {
+    uint32_t NodeCount = 0;
+    uint32_t LeafCount = 0;
+    uint32_t Depth = 0;
+    double BuildMs = 0.0;
+    double RefitMs = 0.0;
+    double QueryMs = 0.0;          // Last CullFrusta call
+    uint64_t QueryNodesVisited = 0; // Last CullFrusta call
+};
+
+class Bvh4 {
+public:
+    static constexpr uint32_t MaxFrusta = 32;    // One bit per frustum in the query masks
+    static constexpr uint32_t DefaultLeafSize = 4;
+
+    enum class BoxClass { Outside, Intersecting, Inside };
+
+    // One box against one frustum, by its corners furthest along and against each plane normal.
+    // CullFrusta's test per primitive, and the brute-force reference for it.
+    static BoxClass ClassifyBox(const Frustum& frustum, const Aabb& box);
+
+    void Build(const std::vector<Aabb>& primitiveBounds, float inflation, uint32_t maxLeafSize = DefaultLeafSize);
+
+    // Same primitives, new bounds and/or inflation. The tree quality degrades gracefully as the
+    // boxes drift; rebuild when they have moved a lot.
+    void Refit(const std::vector<Aabb>& primitiveBounds, float inflation);
+    void Refit(float inflation);
+
+    // Tests every primitive against up to MaxFrusta frusta in one traversal. masks[i] gets bit f
+    // set when primitive i (original order) may be visible in frusta[f]. A frustum drops out of
+    // a subtree as soon as a node is entirely inside or outside it.
+    void CullFrusta(const Frustum* frusta, uint32_t frustumCount, std::vector<uint32_t>& masks);
+
+    bool Empty() const { return m_nodes.empty(); }
+    float Inflation() const { return m_inflation; }
+    Aabb Bounds() const;
+    const std::vector<Bvh4Node>& Nodes() const { return m_nodes; }
+    const std::vector<uint32_t>& PrimitiveIndices() const { return m_primIndices; }
+    const Bvh4Stats& Stats() const { return m_stats; }
+
+private:
+    struct BuildRange {
+        uint32_t Begin, End;
+        Aabb Bounds;         // Of the primitive boxes
+        Aabb CentroidBounds;
+    };
+
+    uint32_t BuildNode(BuildRange range, uint32_t depth);
+    bool SplitRange(const BuildRange& range, BuildRange& left, BuildRange& right);
+    void SetChild(Bvh4Node& node, int slot, const Aabb& bounds) const;
+
+    std::vector<Bvh4Node> m_nodes;
+    std::vector<uint32_t> m_primIndices; // Leaf slots -> original primitive index
+    std::vector<Aabb> m_primBounds;      // Uninflated, original order
+    std::vector<Float3> m_centroids;     // Build scratch
+    uint32_t m_maxLeafSize = DefaultLeafSize;
+    float m_inflation = 0.0f;
+    Bvh4Stats m_stats;
+};
@@ -0,0 +1,233 @@
+// Headless cluster BVH benchmark over the carpet's clusters (or a generated carpet of the same
+// size when the glTF's buffers are missing), clustered the way the renderer does it. First checks
+// Bvh4 against brute force:
+//   build              every cluster in exactly one leaf, children after their parent, every box
+//                      holding its children and its primitives' inflated bounds
+//   refit              the same after moving every cluster and changing the inflation
+//   cull vs brute      CullFrusta masks equal ClassifyBox of every inflated cluster against every
+//                      frustum, for 1 to 32 random frusta around the carpet
+//   32 frusta          bit 31 is set only from the 32nd frustum, and a 33rd frustum is ignored
+// Then times the build, a refit and CullFrusta for 1, 2, 8 and 32 frusta against brute force.
+// Usage: PelageBvhBench [gltf] [triangles per cluster]
+#include "BenchReport.h"
+#include "Bvh.h"
+#include "MeshClusters.h"
+#include "MeshStream.h"
+#include "SceneGen.h"
+#include "Timing.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static uint64_t g_random = 1;
+
+// Uniform in [0, 1)
+static float Random() {
+    g_random = g_random * 6364136223846793005ull + 1442695040888963407ull;
+    return (float)(g_random >> 40) * (1.0f / 16777216.0f);
+}
+
+// Carpet default (FurMaterial::FurLength)
+static constexpr float FurLength = 0.04f;
+
+static std::vector<Aabb> LoadClusterBounds(const std::string& gltfPath, uint32_t trianglesPerCluster) {
+    MeshArrays mesh;
+    MeshStreamSummary summary;
+    uint64_t targetTriangles = 4000000;
+    if (MeshStreamer::Describe(gltfPath, summary)) {
+        targetTriangles = summary.Triangles;
+        MeshStreamer::LoadInCore(gltfPath, MeshStreamSettings(), mesh);
+    }
+    // Missing buffer files read as zeros
+    const bool loaded = std::any_of(mesh.Vertices.begin(), mesh.Vertices.end(), [](float v) { return v != 0.0f; });
+    if (loaded) {
+        printf("%s: %llu triangles\n", gltfPath.c_str(), (unsigned long long)mesh.TriangleCount());
+    } else {
+        SynthScene scene;
+        SynthObject tile;
+        tile.Shape = SynthShape::CarpetTile;
+        tile.Resolution = SceneGen::ResolutionFor(SynthShape::CarpetTile, targetTriangles);
+        scene.Objects.push_back(tile);
+        JobSystem jobs;
+        SceneGen(jobs).Generate(scene, mesh);
+        printf("%s buffers not loaded: carpet tile stand-in, %llu triangles\n", gltfPath.c_str(), (unsigned long long)mesh.TriangleCount());
+    }
+
+    const std::vector<uint32_t> order = MeshClusters::SpatialTriangleOrder(mesh.Vertices.data(), MeshArrays::VertexStride, mesh.Indices);
+    MeshClusters::ApplyTriangleOrder(mesh.Indices, order, 3);
+    const std::vector<MeshCluster> clusters =
+        MeshClusters::Build(mesh.Vertices.data(), MeshArrays::VertexStride, mesh.Indices, trianglesPerCluster);
+    std::vector<Aabb> bounds(clusters.size());
+    for (size_t i = 0; i < clusters.size(); i++) bounds[i] = clusters[i].Bounds;
+    return bounds;
+}
+
+// A camera somewhere around the bounds looking at a random point inside them, with a random
+// field of view, so frusta see all, part or none of the primitives
+static Frustum RandomFrustum(const Aabb& bounds) {
+    const Float3 center = bounds.Center(), extents = bounds.Extents();
+    const float reach = std::max({ extents.x, extents.y, extents.z }) * 3.0f;
+    const Float3 eye = center + Float3((Random() * 2.0f - 1.0f) * reach, Random() * reach + 0.1f, (Random() * 2.0f - 1.0f) * reach);
+    const Float3 target = center + Float3((Random() * 2.0f - 1.0f) * extents.x * 1.5f, 0.0f, (Random() * 2.0f - 1.0f) * extents.z * 1.5f);
+    const float fov = 0.2f + Random() * 1.2f;
+    return Frustum::FromViewProj(Multiply(LookAtLH(eye, target, Float3(0.0f, 1.0f, 0.0f)), PerspectiveFovLH(fov, 16.0f / 9.0f, 0.1f, reach * 4.0f)));
+}
+
+static std::vector<uint32_t> BruteForceMasks(const std::vector<Aabb>& bounds, float inflation, const Frustum* frusta, uint32_t frustumCount) {
+    std::vector<uint32_t> masks(bounds.size(), 0);
+    for (size_t i = 0; i < bounds.size(); i++) {
+        const Aabb box = bounds[i].Inflated(inflation);
+        for (uint32_t f = 0; f < std::min(frustumCount, Bvh4::MaxFrusta); f++) {
+            if (Bvh4::ClassifyBox(frusta[f], box) != Bvh4::BoxClass::Outside) masks[i] |= 1u << f;
+        }
+    }
+    return masks;
+}
+
+static bool Contains(const Aabb& outer, const Aabb& inner) {
+    return outer.Min.x <= inner.Min.x && outer.Min.y <= inner.Min.y && outer.Min.z <= inner.Min.z && outer.Max.x >= inner.Max.x &&
+           outer.Max.y >= inner.Max.y && outer.Max.z >= inner.Max.z;
+}
+
+// Structure and boxes of the tree against the primitives it was given
+static bool Valid(const Bvh4& bvh, const std::vector<Aabb>& bounds, float inflation) {
+    const std::vector<Bvh4Node>& nodes = bvh.Nodes();
+    const std::vector<uint32_t>& prims = bvh.PrimitiveIndices();
+    std::vector<uint32_t> seen(bounds.size(), 0);
+    bool valid = !nodes.empty() && prims.size() == bounds.size();
+    for (uint32_t n = 0; n < (uint32_t)nodes.size() && valid; n++) {
+        const Bvh4Node& node = nodes[n];
+        for (int i = 0; i < 4; i++) {
+            if (node.Child[i] == Bvh4Node::InvalidChild) continue;
+            Aabb box;
+            box.Min = Float3(node.MinX[i], node.MinY[i], node.MinZ[i]);
+            box.Max = Float3(node.MaxX[i], node.MaxY[i], node.MaxZ[i]);
+            if (node.Count[i] == 0) {
+                valid &= node.Child[i] > n && node.Child[i] < nodes.size();
+                if (!valid) break;
+                const Bvh4Node& child = nodes[node.Child[i]];
+                for (int j = 0; j < 4; j++) {
+                    if (child.Child[j] == Bvh4Node::InvalidChild) continue;
+                    Aabb childBox;
+                    childBox.Min = Float3(child.MinX[j], child.MinY[j], child.MinZ[j]);
+                    childBox.Max = Float3(child.MaxX[j], child.MaxY[j], child.MaxZ[j]);
+                    valid &= Contains(box, childBox);
+                }
+            } else {
+                valid &= node.Child[i] + node.Count[i] <= prims.size();
+                for (uint32_t k = node.Child[i]; valid && k < node.Child[i] + node.Count[i]; k++) {
+                    valid &= prims[k] < bounds.size() && Contains(box, bounds[prims[k]].Inflated(inflation));
+                    if (valid) seen[prims[k]]++;
+                }
+            }
+        }
+    }
+    return valid && std::all_of(seen.begin(), seen.end(), [](uint32_t count) { return count == 1; });
+}
+
+static bool Check(const std::vector<Aabb>& bounds) {
+    bool ok = true;
+
+    Bvh4 bvh;
+    bvh.Build(bounds, FurLength);
+    ok &= Report("build", Valid(bvh, bounds, FurLength) && Contains(bvh.Bounds(), bounds[0].Inflated(FurLength)));
+
+    // Every cluster drifts by up to a fur length, like skinning moves them, and the fur grows
+    std::vector<Aabb> moved = bounds;
+    for (Aabb& box : moved) {
+        const Float3 offset((Random() - 0.5f) * FurLength, (Random() - 0.5f) * FurLength, (Random() - 0.5f) * FurLength);
+        box.Min = box.Min + offset;
+        box.Max = box.Max + offset;
+    }
+    Bvh4 refit = bvh;
+    refit.Refit(moved, FurLength * 2.0f);
+    bool refitOk = Valid(refit, moved, FurLength * 2.0f) && refit.Inflation() == FurLength * 2.0f;
+    refit.Refit(FurLength * 0.5f);
+    refitOk &= Valid(refit, moved, FurLength * 0.5f) && refit.Nodes().size() == bvh.Nodes().size();
+    ok &= Report("refit", refitOk);
+
+    const Aabb all = bvh.Bounds();
+    bool match = true;
+    std::vector<uint32_t> masks;
+    std::vector<Frustum> frusta;
+    for (uint32_t trial = 0; trial < 64; trial++) {
+        const uint32_t count = 1 + trial % Bvh4::MaxFrusta;
+        frusta.clear();
+        for (uint32_t f = 0; f < count; f++) frusta.push_back(RandomFrustum(all));
+        // Alternately the built and the refit tree
+        Bvh4& tree = trial % 2 ? refit : bvh;
+        const std::vector<Aabb>& treeBounds = trial % 2 ? moved : bounds;
+        tree.CullFrusta(frusta.data(), count, masks);
+        match &= masks == BruteForceMasks(treeBounds, tree.Inflation(), frusta.data(), count);
+    }
+    bvh.CullFrusta(frusta.data(), 0, masks);
+    match &= std::all_of(masks.begin(), masks.end(), [](uint32_t mask) { return mask == 0; }) && masks.size() == bounds.size();
+    ok &= Report("cull vs brute", match);
+
+    // 31 frusta far away from the carpet, then one seeing all of it, then one more seeing it
+    // that must not count
+    const Float3 center = all.Center();
+    const float reach = std::max({ all.Extents().x, all.Extents().y, all.Extents().z }) * 4.0f;
+    const Frustum away = Frustum::FromViewProj(Multiply(LookAtLH(center + Float3(0.0f, reach, 0.0f), center + Float3(0.0f, reach * 2.0f, 0.0f),
+                                                                 Float3(0.0f, 0.0f, 1.0f)),
+                                                        PerspectiveFovLH(0.5f, 1.0f, 0.1f, reach)));
+    const Frustum overview = Frustum::FromViewProj(Multiply(LookAtLH(center + Float3(0.0f, reach, 0.0f), center, Float3(0.0f, 0.0f, 1.0f)),
+                                                            PerspectiveFovLH(1.5f, 1.0f, 0.1f, reach * 2.0f)));
+    frusta.assign(31, away);
+    frusta.push_back(overview);
+    frusta.push_back(overview);
+    bvh.CullFrusta(frusta.data(), 33, masks);
+    bool edge = std::all_of(masks.begin(), masks.end(), [](uint32_t mask) { return mask == 0x80000000u; });
+    edge &= masks == BruteForceMasks(bounds, FurLength, frusta.data(), 33);
+    ok &= Report("32 frusta", edge);
+    return ok;
+}
+
+static void Benchmark(const std::vector<Aabb>& bounds) {
+    const uint32_t repeats = 20;
+    Bvh4 bvh;
+    double buildMs = 0.0, refitMs = 0.0;
+    for (uint32_t i = 0; i < repeats; i++) {
+        bvh.Build(bounds, FurLength);
+        buildMs += bvh.Stats().BuildMs;
+        bvh.Refit(bounds, FurLength);
+        refitMs += bvh.Stats().RefitMs;
+    }
+    printf("\n%zu clusters: %u nodes, %u deep\n", bounds.size(), bvh.Stats().NodeCount, bvh.Stats().Depth);
+    printf("  build               %8.3f ms\n", buildMs / repeats);
+    printf("  refit               %8.3f ms\n", refitMs / repeats);
+
+    const Aabb all = bvh.Bounds();
+    printf("  frusta     CullFrusta ms   nodes visited   brute force ms   visible\n");
+    for (uint32_t count : { 1u, 2u, 8u, 32u }) {
+        double cullMs = 0.0, bruteMs = 0.0;
+        uint64_t visited = 0, visible = 0;
+        std::vector<uint32_t> masks;
+        for (uint32_t i = 0; i < repeats; i++) {
+            std::vector<Frustum> frusta;
+            for (uint32_t f = 0; f < count; f++) frusta.push_back(RandomFrustum(all));
+            bvh.CullFrusta(frusta.data(), count, masks);
+            cullMs += bvh.Stats().QueryMs;
+            visited += bvh.Stats().QueryNodesVisited;
+            for (uint32_t mask : masks) visible += std::popcount(mask);
+            const Clock::time_point start = Clock::now();
+            const std::vector<uint32_t> brute = BruteForceMasks(bounds, FurLength, frusta.data(), count);
+            bruteMs += MillisecondsSince(start);
+        }
+        printf("  %6u   %13.3f   %13.0f   %14.3f   %6.1f%%\n", count, cullMs / repeats, (double)visited / repeats, bruteMs / repeats,
+               100.0 * visible / ((double)repeats * count * bounds.size()));
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::string gltfPath = argc > 1 ? argv[1] : "assets/fur_carpet/scene.gltf";
+    const uint32_t trianglesPerCluster = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 1) : MeshClusters::DefaultTrianglesPerCluster;
+    const std::vector<Aabb> bounds = LoadClusterBounds(gltfPath, trianglesPerCluster);
+    bool ok = Check(bounds);
+    Benchmark(bounds);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+// Headless benchmark of the depth-sorted cluster draws. First checks RadixSort and MeshClusters'
+// ordering on cases with known answers:
+//   float key          keys increase with the value across negatives, -0 / +0, denormals, large
+//                      values and infinities, and -0 sorts right before +0
+//   sort pairs         matches std::stable_sort (ties keep their input order) for keys differing
+//                      in 0 to 4 bytes, i.e. every odd and even number of passes, and for 0 or 1 key
+//   view depth         only visible clusters, nearest first, equal depths in cluster order
+//   draw ranges        neighbours in the order merge only when adjacent in the index buffer (either
+//                      way round) and of the same material, and the ranges cover every visible
+//                      triangle once
+// Then times SortPairs against std::sort of the same pairs, for keys spread over the whole float
+// range and for view depths of one object.
+// Usage: PelageClusterSortBench [pairs]
+#include "BenchReport.h"
+#include "MeshClusters.h"
+#include "RadixSort.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+static uint64_t g_random = 1;
+
+static uint32_t Random32() {
+    g_random = g_random * 6364136223846793005ull + 1442695040888963407ull;
+    return (uint32_t)(g_random >> 32);
+}
+
+// Uniform in [0, 1)
+static float Random() {
+    g_random = g_random * 6364136223846793005ull + 1442695040888963407ull;
+    return (float)(g_random >> 40) * (1.0f / 16777216.0f);
+}
+
+// Sorts with RadixSort and checks the result against std::stable_sort on the same pairs
+static bool SortsLikeStableSort(const std::vector<uint32_t>& keys) {
+    std::vector<uint32_t> sortedKeys = keys, values(keys.size()), scratchKeys, scratchValues;
+    std::iota(values.begin(), values.end(), 0u);
+    RadixSort::SortPairs(sortedKeys, values, scratchKeys, scratchValues);
+
+    std::vector<uint32_t> reference(keys.size());
+    std::iota(reference.begin(), reference.end(), 0u);
+    std::stable_sort(reference.begin(), reference.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+    bool same = values == reference;
+    for (size_t i = 0; i < keys.size() && same; i++) same &= sortedKeys[i] == keys[reference[i]];
+    return same;
+}
+
+static std::vector<MeshCluster> ContiguousClusters(const std::vector<uint32_t>& materials, uint32_t trianglesPerCluster) {
+    std::vector<MeshCluster> clusters(materials.size());
+    for (size_t i = 0; i < clusters.size(); i++) {
+        clusters[i].FirstTriangle = (uint32_t)i * trianglesPerCluster;
+        clusters[i].TriangleCount = trianglesPerCluster;
+        clusters[i].Material = materials[i];
+    }
+    return clusters;
+}
+
+static bool RangesEqual(const std::vector<DrawRange>& ranges, const std::vector<DrawRange>& expected) {
+    if (ranges.size() != expected.size()) return false;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        if (ranges[i].FirstTriangle != expected[i].FirstTriangle || ranges[i].TriangleCount != expected[i].TriangleCount ||
+            ranges[i].Material != expected[i].Material) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool Check() {
+    bool ok = true;
+
+    const float denormal = std::numeric_limits<float>::denorm_min();
+    const float values[] = { -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::max(), -1e20f, -1.0f, -denormal, -0.0f,
+                             0.0f, denormal, std::numeric_limits<float>::min(), 1.0f, 1.0000001f, 1e20f, std::numeric_limits<float>::max(),
+                             std::numeric_limits<float>::infinity() };
+    bool floatKey = true;
+    for (size_t i = 1; i < sizeof(values) / sizeof(values[0]); i++) {
+        floatKey &= RadixSort::FloatKey(values[i - 1]) < RadixSort::FloatKey(values[i]);
+    }
+    floatKey &= RadixSort::FloatKey(-0.0f) + 1 == RadixSort::FloatKey(0.0f);
+    for (int i = 0; i < 10000; i++) {
+        const float a = (Random() - 0.5f) * std::ldexp(1.0f, (int)(Random32() % 200) - 100);
+        const float b = (Random() - 0.5f) * std::ldexp(1.0f, (int)(Random32() % 200) - 100);
+        floatKey &= (a < b) == (RadixSort::FloatKey(a) < RadixSort::FloatKey(b));
+    }
+    ok &= Report("float key", floatKey);
+
+    // Random low bytes only, so the sort runs 'bytes' passes; few distinct keys make many ties
+    bool sortPairs = SortsLikeStableSort({}) && SortsLikeStableSort({ 7 });
+    for (uint32_t bytes = 0; bytes <= 4; bytes++) {
+        const uint32_t mask = bytes == 4 ? 0xffffffffu : (1u << (bytes * 8)) - 1;
+        for (uint32_t distinct : { 3u, 1000000u }) {
+            std::vector<uint32_t> keys(5000);
+            for (uint32_t& key : keys) key = (0xa5a5a5a5u & ~mask) | ((Random32() % distinct * 0x01010101u + Random32() % distinct) & mask);
+            // Every low byte varies, whatever the number of distinct keys
+            keys[0] = 0xa5a5a5a5u & ~mask;
+            keys[1] = keys[0] | mask;
+            sortPairs &= SortsLikeStableSort(keys);
+        }
+    }
+    ok &= Report("sort pairs", sortPairs);
+
+    // Clusters along +z with a camera at the origin looking down +z, every third one hidden and
+    // pairs of clusters at the same depth
+    std::vector<MeshCluster> line(30);
+    std::vector<uint8_t> visible(line.size());
+    for (uint32_t i = 0; i < (uint32_t)line.size(); i++) {
+        const float z = (float)(Random32() % 10) - 2.0f;
+        line[i].Bounds.Expand(Float3(-1.0f, -1.0f, z - 0.5f));
+        line[i].Bounds.Expand(Float3(1.0f, 1.0f, z + 0.5f));
+        visible[i] = i % 3 != 0;
+    }
+    const Float4x4 view = LookAtLH(Float3(0.0f, 0.0f, 0.0f), Float3(0.0f, 0.0f, 1.0f), Float3(0.0f, 1.0f, 0.0f));
+    std::vector<uint32_t> order;
+    MeshClusters::SortByViewDepth(line, visible, view, order);
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < (uint32_t)line.size(); i++) {
+        if (visible[i]) expected.push_back(i);
+    }
+    std::stable_sort(expected.begin(), expected.end(),
+                     [&](uint32_t a, uint32_t b) { return line[a].Bounds.Center().z < line[b].Bounds.Center().z; });
+    bool viewDepth = order == expected;
+    // Looking the other way reverses the depths, ties still in cluster order
+    MeshClusters::SortByViewDepth(line, visible, LookAtLH(Float3(0.0f, 0.0f, 0.0f), Float3(0.0f, 0.0f, -1.0f), Float3(0.0f, 1.0f, 0.0f)),
+                                  order);
+    std::stable_sort(expected.begin(), expected.end(),
+                     [&](uint32_t a, uint32_t b) { return line[a].Bounds.Center().z > line[b].Bounds.Center().z; });
+    viewDepth &= order == expected;
+    MeshClusters::SortByViewDepth(line, std::vector<uint8_t>(line.size(), 0), view, order);
+    viewDepth &= order.empty();
+    ok &= Report("view depth", viewDepth);
+
+    // Six clusters of 10 triangles back to back, materials 0 0 0 1 1 0
+    const std::vector<MeshCluster> clusters = ContiguousClusters({ 0, 0, 0, 1, 1, 0 }, 10);
+    std::vector<DrawRange> ranges;
+    bool drawRanges = true;
+    auto rangesFor = [&](const std::vector<uint32_t>& clusterOrder) {
+        MeshClusters::BuildDrawRanges(clusters, clusterOrder, ranges);
+        return ranges;
+    };
+    drawRanges &= RangesEqual(rangesFor({ 0, 1, 2 }), { { 0, 30, 0 } });
+    drawRanges &= RangesEqual(rangesFor({ 2, 1, 0 }), { { 0, 30, 0 } });            // Backwards
+    drawRanges &= RangesEqual(rangesFor({ 0, 2 }), { { 0, 10, 0 }, { 20, 10, 0 } }); // A gap
+    drawRanges &= RangesEqual(rangesFor({ 2, 3 }), { { 20, 10, 0 }, { 30, 10, 1 } }); // Material change
+    drawRanges &= RangesEqual(rangesFor({ 4, 3 }), { { 30, 20, 1 } });
+    drawRanges &= RangesEqual(rangesFor({ 0, 2, 1 }), { { 0, 10, 0 }, { 10, 20, 0 } });
+    drawRanges &= RangesEqual(rangesFor({ 4, 5, 2 }), { { 40, 10, 1 }, { 50, 10, 0 }, { 20, 10, 0 } });
+    drawRanges &= RangesEqual(rangesFor({}), {});
+    MeshClusters::BuildDrawRanges(clusters, std::vector<uint8_t>({ 1, 1, 0, 1, 1, 1 }), ranges);
+    drawRanges &= RangesEqual(ranges, { { 0, 20, 0 }, { 30, 20, 1 }, { 50, 10, 0 } });
+
+    // Random orders over many clusters: every visible triangle drawn exactly once
+    const uint32_t clusterCount = 500;
+    std::vector<uint32_t> materials(clusterCount);
+    for (uint32_t i = 0; i < clusterCount; i++) materials[i] = i / 50 % 3;
+    const std::vector<MeshCluster> many = ContiguousClusters(materials, 4);
+    for (int trial = 0; trial < 20; trial++) {
+        std::vector<uint8_t> manyVisible(clusterCount);
+        for (uint8_t& v : manyVisible) v = Random32() % 4 != 0;
+        std::vector<MeshCluster> placed = many;
+        for (MeshCluster& cluster : placed) {
+            const float z = (float)(Random32() % 8);
+            cluster.Bounds.Expand(Float3(0.0f, 0.0f, z));
+        }
+        MeshClusters::SortByViewDepth(placed, manyVisible, view, order);
+        MeshClusters::BuildDrawRanges(placed, order, ranges);
+        std::vector<uint32_t> drawn(clusterCount * 4, 0);
+        for (const DrawRange& range : ranges) {
+            for (uint32_t t = range.FirstTriangle; t < range.FirstTriangle + range.TriangleCount; t++) {
+                drawn[t]++;
+                drawRanges &= many[t / 4].Material == range.Material;
+            }
+        }
+        for (uint32_t t = 0; t < (uint32_t)drawn.size(); t++) drawRanges &= drawn[t] == (manyVisible[t / 4] ? 1u : 0u);
+        drawRanges &= ranges.size() <= order.size();
+    }
+    ok &= Report("draw ranges", drawRanges);
+    return ok;
+}
+
+static void Benchmark(uint32_t maxPairs) {
+    printf("\n  pairs      keys          radix ms   std::sort ms\n");
+    std::vector<uint32_t> keys, values, scratchKeys, scratchValues;
+    std::vector<uint64_t> pairs;
+    for (uint32_t count = 1000; count <= maxPairs; count *= 10) {
+        for (int narrow = 0; narrow < 2; narrow++) {
+            // Random floats over many orders of magnitude, or view depths between 10 and 12
+            std::vector<uint32_t> input(count);
+            for (uint32_t& key : input) {
+                key = RadixSort::FloatKey(narrow ? 10.0f + Random() * 2.0f : (Random() - 0.5f) * std::ldexp(1.0f, (int)(Random32() % 60) - 30));
+            }
+            const uint32_t repeats = std::max(10000000u / count, 3u);
+            double radixMs = 0.0, stdMs = 0.0;
+            for (uint32_t r = 0; r < repeats; r++) {
+                keys = input;
+                values.resize(count);
+                std::iota(values.begin(), values.end(), 0u);
+                Clock::time_point start = Clock::now();
+                RadixSort::SortPairs(keys, values, scratchKeys, scratchValues);
+                radixMs += MillisecondsSince(start);
+
+                pairs.resize(count);
+                for (uint32_t i = 0; i < count; i++) pairs[i] = (uint64_t)input[i] << 32 | i;
+                start = Clock::now();
+                std::sort(pairs.begin(), pairs.end());
+                stdMs += MillisecondsSince(start);
+            }
+            printf("  %8u   %-12s %10.3f %12.3f\n", count, narrow ? "view depths" : "wide floats", radixMs / repeats, stdMs / repeats);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint32_t maxPairs = argc > 1 ? (uint32_t)std::max(atoi(argv[1]), 1000) : 1000000;
+    bool ok = Check();
+    Benchmark(maxPairs);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+// Small platform-independent math types for the CPU-side modules in pelage_core.
+// Conventions match DirectXMath so data can be memcpy'd across the boundary:
+// row vectors, row-major Float4x4 (layout-compatible with XMFLOAT4X4), left-handed.
+
+struct Float3 {
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+
+    Float3() = default;
+    constexpr Float3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+
+    Float3 operator+(const Float3& o) const { return { x + o.x, y + o.y, z + o.z }; }
+    Float3 operator-(const Float3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+    Float3 operator*(float s) const { return { x * s, y * s, z * s }; }
+    Float3& operator+=(const Float3& o) { x += o.x; y += o.y; z += o.z; return *this; }
+};
+
+inline float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Float3 Cross(const Float3& a, const Float3& b) {
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+inline float Length(const Float3& v) { return std::sqrt(Dot(v, v)); }
+inline Float3 Normalize(const Float3& v) {
+    float len = Length(v);
+    return len > 0.0f ? v * (1.0f / len) : v;
+}
+inline Float3 Min(const Float3& a, const Float3& b) { return { std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) }; }
+inline Float3 Max(const Float3& a, const Float3& b) { return { std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) }; }
+
+struct Float4x4 {
+    float m[4][4] = {};
+
+    static Float4x4 Identity() {
+        Float4x4 r;
+        r.m[0][0] = r.m[1][1] = r.m[2][2] = r.m[3][3] = 1.0f;
+        return r;
+    }
+};
+
+inline Float4x4 Multiply(const Float4x4& a, const Float4x4& b) {
+    Float4x4 r;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+        }
+    }
+    return r;
+}
+
+// Affine transform of a point (w = 1, no perspective divide)
+inline Float3 TransformPoint(const Float4x4& t, const Float3& p) {
+    return {
+        p.x * t.m[0][0] + p.y * t.m[1][0] + p.z * t.m[2][0] + t.m[3][0],
+        p.x * t.m[0][1] + p.y * t.m[1][1] + p.z * t.m[2][1] + t.m[3][1],
+        p.x * t.m[0][2] + p.y * t.m[1][2] + p.z * t.m[2][2] + t.m[3][2]
+    };
+}
+
+// Same as XMMatrixLookAtLH
+inline Float4x4 LookAtLH(const Float3& eye, const Float3& target, const Float3& up) {
+    Float3 zAxis = Normalize(target - eye);
+    Float3 xAxis = Normalize(Cross(up, zAxis));
+    Float3 yAxis = Cross(zAxis, xAxis);
+
+    Float4x4 r = Float4x4::Identity();
+    r.m[0][0] = xAxis.x; r.m[0][1] = yAxis.x; r.m[0][2] = zAxis.x;
+    r.m[1][0] = xAxis.y; r.m[1][1] = yAxis.y; r.m[1][2] = zAxis.y;
+    r.m[2][0] = xAxis.z; r.m[2][1] = yAxis.z; r.m[2][2] = zAxis.z;
+    r.m[3][0] = -Dot(xAxis, eye);
+    r.m[3][1] = -Dot(yAxis, eye);
+    r.m[3][2] = -Dot(zAxis, eye);
+    return r;
+}
+
+// Same as XMMatrixPerspectiveFovLH (D3D clip depth 0..1)
+inline Float4x4 PerspectiveFovLH(float fovY, float aspect, float nearZ, float farZ) {
+    float h = std::cos(0.5f * fovY) / std::sin(0.5f * fovY);
+    float range = farZ / (farZ - nearZ);
+    Float4x4 r;
+    r.m[0][0] = h / aspect;
+    r.m[1][1] = h;
+    r.m[2][2] = range;
+    r.m[2][3] = 1.0f;
+    r.m[3][2] = -range * nearZ;
+    return r;
+}
+
+// Same as XMMatrixOrthographicOffCenterLH
+inline Float4x4 OrthographicOffCenterLH(float left, float right, float bottom, float top, float nearZ, float farZ) {
+    float range = 1.0f / (farZ - nearZ);
+    Float4x4 r = Float4x4::Identity();
+    r.m[0][0] = 2.0f / (right - left);
+    r.m[1][1] = 2.0f / (top - bottom);
+    r.m[2][2] = range;
+    r.m[3][0] = -(left + right) / (right - left);
+    r.m[3][1] = -(top + bottom) / (top - bottom);
+    r.m[3][2] = -range * nearZ;
+    return r;
+}
+
+// Same as XMMatrixRotationX
+inline Float4x4 RotationX(float angle) {
+    float c = std::cos(angle), s = std::sin(angle);
+    Float4x4 r = Float4x4::Identity();
+    r.m[1][1] = c; r.m[1][2] = s;
+    r.m[2][1] = -s; r.m[2][2] = c;
+    return r;
+}
+
+// Constant buffers take column-major matrices
+inline Float4x4 Transpose(const Float4x4& a) {
+    Float4x4 r;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) r.m[i][j] = a.m[j][i];
+    }
+    return r;
+}
+
+// Unit quaternion, xyzw as in glTF and XMFLOAT4
+struct Quat {
+    float x = 0.0f, y = 0.0f, z = 0.0f, w = 1.0f;
+
+    Quat() = default;
+    constexpr Quat(float x_, float y_, float z_, float w_) : x(x_), y(y_), z(z_), w(w_) {}
+};
+
+inline Quat Normalize(const Quat& q) {
+    float len = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    return len > 0.0f ? Quat(q.x / len, q.y / len, q.z / len, q.w / len) : Quat();
+}
+
+// Shortest-arc slerp; falls back to a normalized lerp when the rotations are nearly equal
+inline Quat Slerp(const Quat& a, Quat b, float t) {
+    float cosTheta = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    if (cosTheta < 0.0f) {
+        b = Quat(-b.x, -b.y, -b.z, -b.w);
+        cosTheta = -cosTheta;
+    }
+    float wa = 1.0f - t, wb = t;
+    if (cosTheta < 0.9995f) {
+        float theta = std::acos(cosTheta);
+        float sinTheta = std::sin(theta);
+        wa = std::sin(wa * theta) / sinTheta;
+        wb = std::sin(wb * theta) / sinTheta;
+    }
+    return Normalize(Quat(a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb, a.w * wa + b.w * wb));
+}
+
+// Scale, then rotate, then translate (row vectors), the same as XMMatrixAffineTransformation
+// and glTF's T * R * S
+inline Float4x4 ComposeTrs(const Float3& t, const Quat& r, const Float3& s) {
+    float xx = r.x * r.x, yy = r.y * r.y, zz = r.z * r.z;
+    float xy = r.x * r.y, xz = r.x * r.z, yz = r.y * r.z;
+    float wx = r.w * r.x, wy = r.w * r.y, wz = r.w * r.z;
+
+    Float4x4 m;
+    m.m[0][0] = (1.0f - 2.0f * (yy + zz)) * s.x; m.m[0][1] = 2.0f * (xy + wz) * s.x;          m.m[0][2] = 2.0f * (xz - wy) * s.x;
+    m.m[1][0] = 2.0f * (xy - wz) * s.y;          m.m[1][1] = (1.0f - 2.0f * (xx + zz)) * s.y; m.m[1][2] = 2.0f * (yz + wx) * s.y;
+    m.m[2][0] = 2.0f * (xz + wy) * s.z;          m.m[2][1] = 2.0f * (yz - wx) * s.z;          m.m[2][2] = (1.0f - 2.0f * (xx + yy)) * s.z;
+    m.m[3][0] = t.x; m.m[3][1] = t.y; m.m[3][2] = t.z; m.m[3][3] = 1.0f;
+    return m;
+}
+
+struct Aabb {
+    Float3 Min = {  std::numeric_limits<float>::max(),  std::numeric_limits<float>::max(),  std::numeric_limits<float>::max() };
+    Float3 Max = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+
+    bool IsEmpty() const { return Min.x > Max.x || Min.y > Max.y || Min.z > Max.z; }
+
+    void Expand(const Float3& p) { Min = ::Min(Min, p); Max = ::Max(Max, p); }
+    void Expand(const Aabb& b) { Min = ::Min(Min, b.Min); Max = ::Max(Max, b.Max); }
+
+    // Grow every face outwards, e.g. by the maximum fur displacement
+    Aabb Inflated(float amount) const {
+        Aabb r = *this;
+        if (IsEmpty()) return r;
+        r.Min = Min - Float3(amount, amount, amount);
+        r.Max = Max + Float3(amount, amount, amount);
+        return r;
+    }
+
+    Float3 Center() const { return (Min + Max) * 0.5f; }
+    Float3 Extents() const { return (Max - Min) * 0.5f; }
+
+    Float3 Corner(int i) const {
+        return { (i & 1) ? Max.x : Min.x, (i & 2) ? Max.y : Min.y, (i & 4) ? Max.z : Min.z };
+    }
+};
+
+inline Aabb TransformAabb(const Float4x4& t, const Aabb& b) {
+    Aabb r;
+    if (b.IsEmpty()) return r;
+    for (int i = 0; i < 8; i++) {
+        r.Expand(TransformPoint(t, b.Corner(i)));
+    }
+    return r;
+}
+
+// Bounds of an interleaved position stream. 'stride' is in floats (8 for the GPU Vertex layout).
+inline Aabb ComputeBounds(const float* positions, size_t count, size_t stride) {
+    Aabb r;
+    for (size_t i = 0; i < count; i++) {
+        const float* p = positions + i * stride;
+        r.Expand(Float3(p[0], p[1], p[2]));
+    }
+    return r;
+}
+
+// Plane with p.Normal + D >= 0 on the inside
+struct Plane {
+    Float3 Normal;
+    float D = 0.0f;
+
+    float Distance(const Float3& p) const { return Dot(Normal, p) + D; }
+};
+
+struct Frustum {
+    static constexpr int PlaneCount = 6;
+    Plane Planes[PlaneCount]; // Left, right, bottom, top, near, far
+
+    // Planes of a row-vector view-projection with D3D clip depth (0..w). Passing world * viewProj
+    // gives the frustum in that object's space.
+    static Frustum FromViewProj(const Float4x4& vp) {
+        auto column = [&](int c) { return Plane{ Float3(vp.m[0][c], vp.m[1][c], vp.m[2][c]), vp.m[3][c] }; };
+        auto add = [](const Plane& a, const Plane& b, float s) { return Plane{ a.Normal + b.Normal * s, a.D + b.D * s }; };
+
+        Plane x = column(0), y = column(1), z = column(2), w = column(3);
+        Frustum f;
+        f.Planes[0] = add(w, x, 1.0f);
+        f.Planes[1] = add(w, x, -1.0f);
+        f.Planes[2] = add(w, y, 1.0f);
+        f.Planes[3] = add(w, y, -1.0f);
+        f.Planes[4] = z;
+        f.Planes[5] = add(w, z, -1.0f);
+        for (Plane& p : f.Planes) {
+            float len = Length(p.Normal);
+            if (len > 0.0f) {
+                p.Normal = p.Normal * (1.0f / len);
+                p.D /= len;
+            }
+        }
+        return f;
+    }
+};
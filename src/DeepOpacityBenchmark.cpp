@@ -0,0 +1,186 @@
+// Headless deep opacity map benchmark. First checks the CPU reference of the slicing math that
+// osm_ps.hlsl and shell_ps.hlsl mirror, on cases with known answers:
+//   layout             1 to 4 layers: ends strictly increasing, the last inner end at the coat
+//                      thickness, the open last layer past it; growth 1 gives uniform layers
+//   layer index        fragments just before, on and after every boundary, in front of the
+//                      first hit and far behind the coat
+//   splat round trip   opacity splatted at random depths reads back exactly at every layer end,
+//                      0 at the first hit and the total behind the coat
+//   flat light bounds  a coat flat in light space still gets a finite frustum around it
+// Then splats a coat of shells denser at the front into 1 to 4 layers at growth 1 and 2, reports
+// the error of the reconstructed opacity against the shells' exact sum, and the cost per splat
+// and per lookup.
+// Usage: PelageDeepOpacityBench [shells]
+#include "BenchReport.h"
+#include "DeepOpacityMaps.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static uint64_t g_random = 1;
+
+// Uniform in [0, 1)
+static float Random() {
+    g_random = g_random * 6364136223846793005ull + 1442695040888963407ull;
+    return (float)(g_random >> 40) * (1.0f / 16777216.0f);
+}
+
+static bool Check() {
+    bool ok = true;
+
+    const float span = 0.2f;
+    bool layout = true;
+    for (uint32_t count = 1; count <= DeepOpacityLayout::MaxLayers; count++) {
+        for (float growth : { 1.0f, 2.0f, 3.0f }) {
+            const DeepOpacityLayout l = DeepOpacityMaps::BuildLayout(count, span, growth);
+            layout &= l.LayerCount == count && l.LayerEnds[0] > 0.0f;
+            for (uint32_t i = 1; i < count; i++) layout &= l.LayerEnds[i] > l.LayerEnds[i - 1];
+            if (count > 1) layout &= l.LayerEnds[count - 2] == span;
+            // The open layer reaches the far end of normalized light depth
+            layout &= l.LayerEnds[count - 1] >= 1.0f;
+            if (growth == 1.0f) {
+                for (uint32_t i = 0; i + 1 < count; i++) layout &= std::fabs(l.LayerEnds[i] - span * (i + 1) / (count - 1)) < 1e-6f;
+            } else {
+                // Front layers thinner, each 'growth' times the one before
+                for (uint32_t i = 1; i + 1 < count; i++) {
+                    const float previous = l.LayerEnds[i - 1] - (i > 1 ? l.LayerEnds[i - 2] : 0.0f);
+                    layout &= std::fabs((l.LayerEnds[i] - l.LayerEnds[i - 1]) / previous - growth) < 1e-4f;
+                }
+            }
+        }
+    }
+    layout &= DeepOpacityMaps::BuildLayout(0, span).LayerCount == 1 && DeepOpacityMaps::BuildLayout(9, span).LayerCount == 4;
+    ok &= Report("layout", layout);
+
+    const float firstHit = 0.3f;
+    bool index = true;
+    for (uint32_t count = 1; count <= DeepOpacityLayout::MaxLayers; count++) {
+        const DeepOpacityLayout l = DeepOpacityMaps::BuildLayout(count, span);
+        index &= DeepOpacityMaps::LayerIndex(l, firstHit - 0.1f, firstHit) == 0;
+        index &= DeepOpacityMaps::LayerIndex(l, firstHit, firstHit) == 0;
+        index &= DeepOpacityMaps::LayerIndex(l, firstHit + 0.9f, firstHit) == count - 1;
+        for (uint32_t i = 0; i + 1 < count; i++) {
+            // A boundary belongs to the layer behind it (first hit at 0 keeps the depths exact)
+            const float end = l.LayerEnds[i];
+            index &= DeepOpacityMaps::LayerIndex(l, end, 0.0f) == i + 1;
+            index &= DeepOpacityMaps::LayerIndex(l, std::nextafter(end, 0.0f), 0.0f) == i;
+            index &= DeepOpacityMaps::LayerIndex(l, firstHit + end * 1.001f, firstHit) == i + 1;
+        }
+    }
+    ok &= Report("layer index", index);
+
+    bool roundTrip = true;
+    for (uint32_t count = 1; count <= DeepOpacityLayout::MaxLayers; count++) {
+        const DeepOpacityLayout l = DeepOpacityMaps::BuildLayout(count, span);
+        float layers[4] = {};
+        float inLayer[4] = {};
+        float total = 0.0f;
+        for (uint32_t i = 0; i < 200; i++) {
+            const float depth = firstHit + Random() * span * 1.5f, opacity = Random() * 0.05f;
+            DeepOpacityMaps::Splat(l, depth, firstHit, opacity, layers);
+            inLayer[DeepOpacityMaps::LayerIndex(l, depth, firstHit)] += opacity;
+            total += opacity;
+        }
+        roundTrip &= DeepOpacityMaps::AccumulatedOpacity(l, layers, firstHit, firstHit) == 0.0f;
+        roundTrip &= DeepOpacityMaps::AccumulatedOpacity(l, layers, firstHit - 0.1f, firstHit) == 0.0f;
+        roundTrip &= std::fabs(DeepOpacityMaps::AccumulatedOpacity(l, layers, 1.0f + firstHit, firstHit) - total) < 1e-4f;
+        float before = 0.0f;
+        for (uint32_t i = 0; i < count; i++) {
+            before += inLayer[i];
+            roundTrip &= std::fabs(layers[i] - inLayer[i]) < 1e-5f;
+            roundTrip &= std::fabs(DeepOpacityMaps::AccumulatedOpacity(l, layers, firstHit + l.LayerEnds[i], firstHit) - before) < 1e-4f;
+            // Halfway through a layer, half of it
+            const float start = i > 0 ? l.LayerEnds[i - 1] : 0.0f;
+            const float halfway = DeepOpacityMaps::AccumulatedOpacity(l, layers, firstHit + (start + l.LayerEnds[i]) * 0.5f, firstHit);
+            roundTrip &= std::fabs(halfway - (before - inLayer[i] * 0.5f)) < 1e-4f;
+        }
+    }
+    ok &= Report("splat round trip", roundTrip);
+
+    // A light straight above a flat carpet, and one seeing a single point
+    Aabb carpet;
+    carpet.Expand(Float3(-1.0f, 0.0f, -1.0f));
+    carpet.Expand(Float3(1.0f, 0.0f, 1.0f));
+    const Float4x4 above = LookAtLH(Float3(0.0f, 10.0f, 0.0f), Float3(0.0f, 0.0f, 0.0f), Float3(0.0f, 0.0f, 1.0f));
+    auto finite = [](const LightOrthoFit& fit) {
+        const Float4x4 projection = OrthographicOffCenterLH(fit.Left, fit.Right, fit.Bottom, fit.Top, fit.Near, fit.Far);
+        bool result = fit.Right > fit.Left && fit.Top > fit.Bottom && fit.Far > fit.Near;
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) result &= std::isfinite(projection.m[i][j]);
+        }
+        return result;
+    };
+    const LightOrthoFit flat = DeepOpacityMaps::FitLightOrtho(above, carpet);
+    bool flatFit = finite(flat) && flat.Left <= -1.0f && flat.Right >= 1.0f && flat.Bottom <= -1.0f && flat.Top >= 1.0f;
+    flatFit &= flat.Near <= 10.0f && flat.Far >= 10.0f && flat.Far - flat.Near < 1e-3f;
+    Aabb point;
+    point.Expand(Float3(0.5f, 0.0f, 0.5f));
+    const LightOrthoFit pointFit = DeepOpacityMaps::FitLightOrtho(above, point);
+    flatFit &= finite(pointFit) && pointFit.Left <= 0.5f && pointFit.Right >= 0.5f;
+    const LightOrthoFit empty = DeepOpacityMaps::FitLightOrtho(above, Aabb());
+    flatFit &= finite(empty);
+    ok &= Report("flat light bounds", flatFit);
+    return ok;
+}
+
+static void Benchmark(uint32_t shells) {
+    // Shell k sits at k / shells of the coat; the front ones are denser, as the light meets the
+    // tips of every strand before the roots
+    const float span = 0.2f, firstHit = 0.3f;
+    std::vector<float> shellDepth(shells), shellOpacity(shells);
+    for (uint32_t k = 0; k < shells; k++) {
+        shellDepth[k] = firstHit + span * k / shells;
+        shellOpacity[k] = 4.0f / shells * std::exp(-3.0f * k / shells);
+    }
+    auto exact = [&](float depth) {
+        float sum = 0.0f;
+        for (uint32_t k = 0; k < shells && shellDepth[k] < depth; k++) sum += shellOpacity[k];
+        return sum;
+    };
+
+    printf("\n%u shells, opacity %.2f across the coat\n", shells, exact(2.0f));
+    printf("  layers growth   mean error   max error\n");
+    const uint32_t receivers = 1000;
+    for (uint32_t count = 1; count <= DeepOpacityLayout::MaxLayers; count++) {
+        for (float growth : { 1.0f, 2.0f }) {
+            const DeepOpacityLayout layout = DeepOpacityMaps::BuildLayout(count, span, growth);
+            float layers[4] = {};
+            for (uint32_t k = 0; k < shells; k++) DeepOpacityMaps::Splat(layout, shellDepth[k], firstHit, shellOpacity[k], layers);
+            double sum = 0.0, worst = 0.0;
+            for (uint32_t i = 0; i < receivers; i++) {
+                const float depth = firstHit + span * (i + 0.5f) / receivers;
+                const double error = std::fabs(DeepOpacityMaps::AccumulatedOpacity(layout, layers, depth, firstHit) - exact(depth));
+                sum += error;
+                worst = std::max(worst, error);
+            }
+            printf("  %6u %6.0f   %10.4f  %10.4f\n", count, growth, sum / receivers, worst);
+        }
+    }
+
+    // What a pixel of each pass costs on the CPU reference
+    const uint32_t fragments = 4000000;
+    std::vector<float> depths(fragments);
+    for (float& depth : depths) depth = firstHit + Random() * span * 1.2f;
+    const DeepOpacityLayout layout = DeepOpacityMaps::BuildLayout(4, span);
+    float layers[4] = {};
+    Clock::time_point start = Clock::now();
+    for (float depth : depths) DeepOpacityMaps::Splat(layout, depth, firstHit, 0.001f, layers);
+    const double splatMs = MillisecondsSince(start);
+    start = Clock::now();
+    // Folded into a sink so the compiler can't drop the calls
+    volatile float sink = 0.0f;
+    for (float depth : depths) sink = sink + DeepOpacityMaps::AccumulatedOpacity(layout, layers, depth, firstHit);
+    const double lookupMs = MillisecondsSince(start);
+    printf("  splat               %8.2f ns per fragment\n", splatMs * 1e6 / fragments);
+    printf("  lookup              %8.2f ns per fragment\n", lookupMs * 1e6 / fragments);
+}
+
+int main(int argc, char** argv) {
+    const uint32_t shells = argc > 1 ? (uint32_t)std::max(atoi(argv[1]), 1) : 64;
+    bool ok = Check();
+    Benchmark(shells);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include "DeepOpacityMaps.h"
+
+LightOrthoFit DeepOpacityMaps::FitLightOrtho(const Float4x4& lightView, const Aabb& worldBounds) {
+    LightOrthoFit fit;
+    if (worldBounds.IsEmpty()) return fit;
+
+    Aabb lightBounds = TransformAabb(lightView, worldBounds);
+
+    // Small margin so silhouettes and the nearest/farthest strands never touch the clip planes
+    Float3 margin = lightBounds.Extents() * 0.02f;
+    fit.Left = lightBounds.Min.x - margin.x;
+    fit.Right = lightBounds.Max.x + margin.x;
+    fit.Bottom = lightBounds.Min.y - margin.y;
+    fit.Top = lightBounds.Max.y + margin.y;
+    fit.Near = lightBounds.Min.z - margin.z;
+    fit.Far = lightBounds.Max.z + margin.z;
+
+    // Degenerate (flat) bounds would produce an infinite projection
+    const float minExtent = 1e-4f;
+    if (fit.Right - fit.Left < minExtent) fit.Right = fit.Left + minExtent;
+    if (fit.Top - fit.Bottom < minExtent) fit.Top = fit.Bottom + minExtent;
+    if (fit.Far - fit.Near < minExtent) fit.Far = fit.Near + minExtent;
+    return fit;
+}
+
+DeepOpacityLayout DeepOpacityMaps::BuildLayout(uint32_t layerCount, float furDepthSpan, float growth) {
+    DeepOpacityLayout layout;
+    layout.LayerCount = std::clamp(layerCount, 1u, DeepOpacityLayout::MaxLayers);
+
+    // Normalized light depth never exceeds 1, so the open last layer can simply end there
+    const float openEnd = std::max(1.0f, furDepthSpan * 2.0f);
+    furDepthSpan = std::max(furDepthSpan, 1e-6f);
+
+    // The first LayerCount-1 layers cover the coat thickness, the last one everything behind it
+    uint32_t innerLayers = layout.LayerCount - 1;
+    float end = 0.0f;
+    if (innerLayers > 0) {
+        float firstThickness;
+        if (std::abs(growth - 1.0f) < 1e-4f) {
+            firstThickness = furDepthSpan / innerLayers;
+        } else {
+            firstThickness = furDepthSpan * (growth - 1.0f) / (std::pow(growth, (float)innerLayers) - 1.0f);
+        }
+
+        float thickness = firstThickness;
+        for (uint32_t i = 0; i < innerLayers; i++) {
+            end += thickness;
+            layout.LayerEnds[i] = end;
+            thickness *= growth;
+        }
+        layout.LayerEnds[innerLayers - 1] = furDepthSpan; // Kill accumulated rounding
+    }
+
+    for (uint32_t i = innerLayers; i < DeepOpacityLayout::MaxLayers; i++) {
+        layout.LayerEnds[i] = openEnd;
+    }
+    return layout;
+}
+
+uint32_t DeepOpacityMaps::LayerIndex(const DeepOpacityLayout& layout, float depth, float firstHitDepth) {
+    float d = std::max(depth - firstHitDepth, 0.0f);
+    for (uint32_t i = 0; i + 1 < layout.LayerCount; i++) {
+        if (d < layout.LayerEnds[i]) return i;
+    }
+    return layout.LayerCount - 1;
+}
+
+void DeepOpacityMaps::Splat(const DeepOpacityLayout& layout, float depth, float firstHitDepth, float opacity, float layers[4]) {
+    layers[LayerIndex(layout, depth, firstHitDepth)] += opacity;
+}
+
+float DeepOpacityMaps::AccumulatedOpacity(const DeepOpacityLayout& layout, const float layers[4], float depth, float firstHitDepth) {
+    float d = std::max(depth - firstHitDepth, 0.0f);
+
+    // Layers fully in front count completely, the containing layer partially, later layers not at all
+    float accumulated = 0.0f;
+    float layerStart = 0.0f;
+    for (uint32_t i = 0; i < layout.LayerCount; i++) {
+        float layerEnd = layout.LayerEnds[i];
+        float coverage = std::clamp((d - layerStart) / (layerEnd - layerStart), 0.0f, 1.0f);
+        accumulated += layers[i] * coverage;
+        layerStart = layerEnd;
+    }
+    return accumulated;
+}
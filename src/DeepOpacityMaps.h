@@ -0,0 +1,45 @@
+#pragma once
+#include "CoreMath.h"
+
+// Deep Opacity Maps (Yuksel & Keyser 2008) slicing math.
+// A light-space depth pre-pass stores, per texel, the depth where the light first enters the fur.
+// Opacity layers then start at that depth instead of at the light's near plane, so every layer
+// lands inside the coat rather than in empty space. Layers are packed into the RGBA channels
+// of a single render target. Both osm_ps.hlsl and shell_ps.hlsl mirror these functions exactly.
+
+struct DeepOpacityLayout {
+    static constexpr uint32_t MaxLayers = 4; // One per RGBA channel
+
+    uint32_t LayerCount = MaxLayers;
+    // End of each layer, measured from the first-hit depth in normalized light depth.
+    // Strictly increasing; the last layer is open ended and absorbs everything behind the coat.
+    float LayerEnds[MaxLayers] = {};
+};
+
+// Off-center orthographic bounds in light view space (feeds XMMatrixOrthographicOffCenterLH)
+struct LightOrthoFit {
+    float Left = -1.0f, Right = 1.0f;
+    float Bottom = -1.0f, Top = 1.0f;
+    float Near = 0.0f, Far = 1.0f;
+};
+
+class DeepOpacityMaps {
+public:
+    // Tightly fits the light frustum around the world-space fur bounds seen through 'lightView'
+    static LightOrthoFit FitLightOrtho(const Float4x4& lightView, const Aabb& worldBounds);
+
+    // Places layer boundaries geometrically across 'furDepthSpan' (the coat thickness in normalized
+    // light depth). growth > 1 makes the front layers thinner, where the light first enters the fur
+    // and the opacity gradient is steepest.
+    static DeepOpacityLayout BuildLayout(uint32_t layerCount, float furDepthSpan, float growth = 2.0f);
+
+    // Layer a fragment at 'depth' falls into, given the first-hit depth from the pre-pass
+    static uint32_t LayerIndex(const DeepOpacityLayout& layout, float depth, float firstHitDepth);
+
+    // Reference of osm_ps.hlsl: adds 'opacity' into the channel of the fragment's layer
+    static void Splat(const DeepOpacityLayout& layout, float depth, float firstHitDepth, float opacity, float layers[4]);
+
+    // Reference of the shell_ps.hlsl lookup: opacity in front of 'depth', with the containing
+    // layer linearly interpolated to avoid banding at layer boundaries
+    static float AccumulatedOpacity(const DeepOpacityLayout& layout, const float layers[4], float depth, float firstHitDepth);
+};
@@ -0,0 +1,70 @@
+#include "DescriptorAllocator.h"
+#include <algorithm>
+
+DescriptorAllocator::DescriptorAllocator(uint32_t persistent, uint32_t transientPerFrame, uint32_t frames)
+    : m_persistent(persistent), m_transientPerFrame(transientPerFrame), m_frames(std::max(frames, 1u)),
+      m_generations(persistent, 0), m_live(persistent, 0), m_ringFences(m_frames, 0) {
+    m_freeList.resize(persistent);
+    for (uint32_t i = 0; i < persistent; i++) m_freeList[i] = persistent - 1 - i;
+}
+
+DescriptorHandle DescriptorAllocator::Allocate() {
+    if (m_freeList.empty()) {
+        m_stats.Failed++;
+        return DescriptorHandle();
+    }
+    const uint32_t index = m_freeList.back();
+    m_freeList.pop_back();
+    m_live[index] = 1;
+    m_stats.Allocations++;
+    m_stats.Live++;
+    m_stats.PeakLive = std::max(m_stats.PeakLive, m_stats.Live);
+    return { index, m_generations[index] };
+}
+
+bool DescriptorAllocator::IsLive(DescriptorHandle handle) const {
+    return handle.Index < m_persistent && m_live[handle.Index] && m_generations[handle.Index] == handle.Generation;
+}
+
+bool DescriptorAllocator::Free(DescriptorHandle handle, uint64_t fence) {
+    if (!IsLive(handle)) {
+        m_stats.StaleFrees++;
+        return false;
+    }
+    // Handles to the slot go stale now, even though it is only recycled later
+    m_live[handle.Index] = 0;
+    m_generations[handle.Index]++;
+    m_stats.Live--;
+    // Kept in fence order, so Retire only looks at the front
+    if (!m_pending.empty()) fence = std::max(fence, m_pending.back().Fence);
+    m_pending.push_back({ fence, handle.Index });
+    m_stats.PendingFrees = (uint32_t)m_pending.size();
+    return true;
+}
+
+void DescriptorAllocator::Retire(uint64_t completedFence) {
+    while (!m_pending.empty() && m_pending.front().Fence <= completedFence) {
+        m_freeList.push_back(m_pending.front().Index);
+        m_pending.pop_front();
+    }
+    m_stats.PendingFrees = (uint32_t)m_pending.size();
+}
+
+uint64_t DescriptorAllocator::BeginFrame(uint64_t fence) {
+    m_ring = m_ring == UINT32_MAX ? 0 : (m_ring + 1) % m_frames;
+    m_ringUsed = 0;
+    const uint64_t previous = m_ringFences[m_ring];
+    m_ringFences[m_ring] = fence;
+    return previous;
+}
+
+uint32_t DescriptorAllocator::AllocateTransient(uint32_t count) {
+    if (m_ring == UINT32_MAX || count > m_transientPerFrame - m_ringUsed) {
+        m_stats.Failed++;
+        return UINT32_MAX;
+    }
+    const uint32_t first = m_persistent + m_ring * m_transientPerFrame + m_ringUsed;
+    m_ringUsed += count;
+    m_stats.TransientPeak = std::max(m_stats.TransientPeak, m_ringUsed);
+    return first;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Slot bookkeeping for one large shader-visible descriptor heap, bound whole so shaders index it
+// with the slot numbers (bindless). The heap starts with a persistent region: views of assets,
+// allocated and freed one at a time from a free list. A freed slot is only recycled once the
+// fence of the last commands that may read it has completed. Handles carry a generation, bumped
+// on every free, so a handle kept past its free is recognised as stale rather than aliasing
+// whatever view the slot holds next. After the persistent region come one ring per frame in
+// flight for views rewritten every frame; a ring is reused whole once its frame's fence has
+// completed.
+//
+// Only indices and fences: the renderer writes the descriptors, so the bookkeeping runs headless
+// (PelageDescriptorBench).
+
+struct DescriptorHandle {
+    uint32_t Index = UINT32_MAX; // Heap slot, what the shaders index with
+    uint32_t Generation = 0;
+
+    bool Valid() const { return Index != UINT32_MAX; }
+};
+
+struct DescriptorAllocatorStats {
+    uint32_t Live = 0;          // Persistent slots allocated
+    uint32_t PeakLive = 0;
+    uint32_t PendingFrees = 0;  // Freed, waiting for their fence
+    uint64_t Allocations = 0;
+    uint64_t Failed = 0;        // Persistent region or the frame's ring full
+    uint64_t StaleFrees = 0;    // Freed twice, or never allocated; ignored
+    uint32_t TransientPeak = 0; // Most slots one frame took from its ring
+};
+
+class DescriptorAllocator {
+public:
+    // 'persistent' slots from 0, then 'frames' rings of 'transientPerFrame' slots each
+    DescriptorAllocator(uint32_t persistent, uint32_t transientPerFrame, uint32_t frames);
+
+    // Descriptors the heap needs
+    uint32_t Capacity() const { return m_persistent + m_transientPerFrame * m_frames; }
+
+    // An invalid handle when every persistent slot is live or waiting for its fence
+    DescriptorHandle Allocate();
+    // 'fence' is the last fence whose commands may read the slot. Fences are expected in
+    // submission order; one lower than an earlier free's waits for that one instead. Returns
+    // false for a stale handle.
+    bool Free(DescriptorHandle handle, uint64_t fence);
+    bool IsLive(DescriptorHandle handle) const;
+    // Recycles the slots of the frees whose fence is at most 'completedFence'
+    void Retire(uint64_t completedFence);
+
+    // Starts a frame on the next ring; 'fence' signals when the frame's commands are done.
+    // Returns the fence of the frame that used the ring last, which must complete before the
+    // ring's slots are written (0 if none did).
+    uint64_t BeginFrame(uint64_t fence);
+    // First of 'count' consecutive slots in the frame's ring, valid until the ring comes round
+    // again; UINT32_MAX if the ring is full or no frame was begun
+    uint32_t AllocateTransient(uint32_t count);
+
+    const DescriptorAllocatorStats& Stats() const { return m_stats; }
+
+private:
+    struct PendingFree {
+        uint64_t Fence = 0;
+        uint32_t Index = 0;
+    };
+
+    uint32_t m_persistent;
+    uint32_t m_transientPerFrame;
+    uint32_t m_frames;
+
+    std::vector<uint32_t> m_generations; // Per persistent slot
+    std::vector<uint8_t> m_live;
+    std::vector<uint32_t> m_freeList;    // Popped from the back, lowest slots first
+    std::deque<PendingFree> m_pending;   // In fence order
+
+    std::vector<uint64_t> m_ringFences;  // Per ring, the fence of the frame that used it last
+    uint32_t m_ring = UINT32_MAX;        // The current frame's
+    uint32_t m_ringUsed = 0;
+
+    DescriptorAllocatorStats m_stats;
+};
@@ -0,0 +1,161 @@
+// Headless bindless descriptor allocator benchmark. First checks DescriptorAllocator on cases
+// with known answers:
+//   allocate and free   every persistent slot once, then none, then the freed one again
+//   stale handles       a freed handle is no longer live, and freeing it again is ignored
+//   deferred by fence   a freed slot is not handed out before its fence completes
+//   fence order         a free with a lower fence than an earlier one is never recycled early
+//   transient rings     consecutive slots per frame, a full ring fails, rings wait for their fence
+//   churn               random allocations and frees against a GPU running frames behind never
+//                       hand out a slot that is live or still readable
+// Then replaces views of a live set every frame, like hot reloads and streaming swaps do, with the
+// GPU two frames behind, and reports the cost per allocation and free and the slots held back.
+// Usage: PelageDescriptorBench [live views] [replaced per frame]
+#include "BenchReport.h"
+#include "DescriptorAllocator.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+static uint64_t g_random = 1;
+
+static uint32_t Random(uint32_t range) {
+    g_random = g_random * 6364136223846793005ull + 1442695040888963407ull;
+    return (uint32_t)((g_random >> 33) % range);
+}
+
+static bool Check() {
+    bool ok = true;
+
+    DescriptorAllocator allocator(64, 8, 2);
+    std::vector<DescriptorHandle> handles;
+    std::vector<uint8_t> seen(64, 0);
+    bool unique = allocator.Capacity() == 80;
+    for (uint32_t i = 0; i < 64; i++) {
+        DescriptorHandle handle = allocator.Allocate();
+        unique &= handle.Valid() && handle.Index < 64 && !seen[handle.Index];
+        if (handle.Valid() && handle.Index < 64) seen[handle.Index] = 1;
+        handles.push_back(handle);
+    }
+    const bool full = !allocator.Allocate().Valid() && allocator.Stats().Failed == 1;
+    allocator.Free(handles[10], 0);
+    allocator.Retire(0);
+    const DescriptorHandle again = allocator.Allocate();
+    ok &= Report("allocate and free", unique && full && again.Index == handles[10].Index && allocator.Stats().Live == 64);
+
+    const bool stale = !allocator.IsLive(handles[10]) && allocator.IsLive(again) && again.Generation != handles[10].Generation &&
+                       !allocator.Free(handles[10], 0) && allocator.IsLive(again) && allocator.Free(again, 0) &&
+                       !allocator.Free(again, 0) && !allocator.IsLive(DescriptorHandle()) && allocator.Stats().StaleFrees == 2;
+    ok &= Report("stale handles", stale);
+
+    DescriptorAllocator fenced(4, 0, 1);
+    DescriptorHandle a = fenced.Allocate(), b = fenced.Allocate(), c = fenced.Allocate(), d = fenced.Allocate();
+    fenced.Free(a, 3);
+    fenced.Free(b, 5);
+    bool deferred = !fenced.Allocate().Valid() && fenced.Stats().PendingFrees == 2;
+    fenced.Retire(2);
+    deferred &= !fenced.Allocate().Valid();
+    fenced.Retire(4);
+    const DescriptorHandle afterA = fenced.Allocate();
+    deferred &= afterA.Index == a.Index && !fenced.Allocate().Valid() && fenced.Stats().PendingFrees == 1;
+    fenced.Retire(5);
+    deferred &= fenced.Allocate().Index == b.Index && fenced.Stats().PendingFrees == 0;
+    ok &= Report("deferred by fence", deferred);
+
+    fenced.Free(c, 9);
+    fenced.Free(d, 4);
+    fenced.Retire(8);
+    bool ordered = !fenced.Allocate().Valid();
+    fenced.Retire(9);
+    ordered &= fenced.Allocate().Valid() && fenced.Allocate().Valid() && !fenced.Allocate().Valid();
+    ok &= Report("fence order", ordered);
+
+    // Two rings of 8 after 64 persistent slots
+    bool rings = allocator.AllocateTransient(1) == UINT32_MAX && allocator.BeginFrame(1) == 0;
+    rings &= allocator.AllocateTransient(3) == 64 && allocator.AllocateTransient(5) == 67 && allocator.AllocateTransient(1) == UINT32_MAX;
+    rings &= allocator.BeginFrame(2) == 0 && allocator.AllocateTransient(8) == 72;
+    rings &= allocator.BeginFrame(3) == 1 && allocator.AllocateTransient(2) == 64 && allocator.Stats().TransientPeak == 8;
+    ok &= Report("transient rings", rings);
+
+    // The GPU completes each frame's fence 'latency' frames after it was submitted. A slot may be
+    // handed out again only if no live handle holds it and no frame that could read it is running.
+    const uint32_t slots = 256, latency = 2;
+    DescriptorAllocator churn(slots, 0, 1);
+    std::vector<uint64_t> readableUntil(slots, 0);
+    std::vector<uint8_t> held(slots, 0);
+    std::vector<DescriptorHandle> live;
+    bool safe = true;
+    uint64_t allocated = 0;
+    for (uint64_t frame = 1; frame <= 20000; frame++) {
+        const uint64_t completed = frame > latency ? frame - latency : 0;
+        churn.Retire(completed);
+        const uint32_t operations = Random(16);
+        for (uint32_t i = 0; i < operations; i++) {
+            if (Random(2) == 0 || live.empty()) {
+                DescriptorHandle handle = churn.Allocate();
+                if (!handle.Valid()) continue;
+                safe &= handle.Index < slots && !held[handle.Index] && readableUntil[handle.Index] <= completed;
+                held[handle.Index] = 1;
+                live.push_back(handle);
+                allocated++;
+            } else {
+                const uint32_t pick = Random((uint32_t)live.size());
+                const DescriptorHandle handle = live[pick];
+                live[pick] = live.back();
+                live.pop_back();
+                // This frame's commands may still read it
+                held[handle.Index] = 0;
+                readableUntil[handle.Index] = frame;
+                safe &= churn.Free(handle, frame);
+            }
+        }
+        for (const DescriptorHandle& handle : live) safe &= churn.IsLive(handle);
+    }
+    ok &= Report("churn", safe && allocated > 10000 && churn.Stats().Live == live.size() && churn.Stats().StaleFrees == 0);
+    return ok;
+}
+
+static void Benchmark(uint32_t liveViews, uint32_t replacedPerFrame) {
+    const uint32_t frames = 100000, latency = 2;
+    // Room for the live set plus what the frames in flight hold back
+    const uint32_t persistent = liveViews + replacedPerFrame * (latency + 1);
+    DescriptorAllocator allocator(persistent, 64, latency);
+    std::vector<DescriptorHandle> live(liveViews);
+    for (DescriptorHandle& handle : live) handle = allocator.Allocate();
+
+    Clock::time_point start = Clock::now();
+    uint64_t operations = 0, failed = 0;
+    uint32_t peakPending = 0;
+    for (uint64_t frame = 1; frame <= frames; frame++) {
+        allocator.Retire(frame > latency ? frame - latency : 0);
+        allocator.BeginFrame(frame);
+        // The light lists: three views rewritten every frame
+        failed += allocator.AllocateTransient(3) == UINT32_MAX;
+        for (uint32_t i = 0; i < replacedPerFrame; i++) {
+            DescriptorHandle& handle = live[Random(liveViews)];
+            allocator.Free(handle, frame);
+            handle = allocator.Allocate();
+            failed += !handle.Valid();
+        }
+        operations += replacedPerFrame * 2 + 1;
+        peakPending = std::max(peakPending, allocator.Stats().PendingFrees);
+    }
+    const double ms = MillisecondsSince(start);
+
+    printf("\n%u live views, %u replaced per frame, GPU %u frames behind, %u frames\n", liveViews, replacedPerFrame, latency, frames);
+    printf("  heap                %8u descriptors (%u persistent, 2 rings of 64)\n", allocator.Capacity(), persistent);
+    printf("  per operation       %8.1f ns\n", ms * 1e6 / operations);
+    printf("  per frame           %8.3f us\n", ms * 1e3 / frames);
+    printf("  held back by fences %8u slots at most\n", peakPending);
+    printf("  failed              %8llu\n", (unsigned long long)failed);
+}
+
+int main(int argc, char** argv) {
+    const uint32_t liveViews = argc > 1 ? (uint32_t)std::max(atoi(argv[1]), 1) : 3000;
+    const uint32_t replaced = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 1) : 64;
+    bool ok = Check();
+    Benchmark(liveViews, std::min(replaced, liveViews));
+    return ok ? 0 : 1;
+}
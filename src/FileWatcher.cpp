@@ -0,0 +1,77 @@
+#include "FileWatcher.h"
+#include "AssetGraph.h"
+#include "Hash.h"
+#include "Timing.h"
+#include <fstream>
+
+bool FileWatcher::HashFile(const std::string& path, uint64_t& hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    hash = HashSeed;
+    char buffer[64 * 1024];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+        hash = HashBytes(hash, buffer, (size_t)file.gcount());
+    }
+    return !file.bad();
+}
+
+bool FileWatcher::Stamp(const std::string& path, uint64_t& size, std::filesystem::file_time_type& time) {
+    std::error_code error;
+    size = std::filesystem::file_size(path, error);
+    if (error) return false;
+    time = std::filesystem::last_write_time(path, error);
+    return !error;
+}
+
+uint64_t FileWatcher::Watch(const std::string& path) {
+    for (const WatchedFile& file : m_files) {
+        if (file.Path == path) return file.Hash;
+    }
+    WatchedFile file;
+    file.Path = path;
+    // Stamped before hashing: a write in between shows up as a new stamp on the next poll
+    file.Stamped = Stamp(path, file.Size, file.Time);
+    if (!HashFile(path, file.Hash)) {
+        file.Hash = 0;
+        file.Stamped = false;
+    }
+    m_files.push_back(file);
+    m_stats.Files = (uint32_t)m_files.size();
+    return file.Hash;
+}
+
+std::vector<std::string> FileWatcher::Poll() {
+    const Clock::time_point start = Clock::now();
+    std::vector<std::string> changed;
+    m_stats.Read = 0;
+    for (WatchedFile& file : m_files) {
+        uint64_t size = 0;
+        std::filesystem::file_time_type time;
+        if (!Stamp(file.Path, size, time)) {
+            file.Stamped = false;
+            continue;
+        }
+        if (file.Stamped && size == file.Size && time == file.Time) continue;
+
+        uint64_t hash = 0;
+        m_stats.Read++;
+        if (!HashFile(file.Path, hash)) continue;
+        file.Size = size;
+        file.Time = time;
+        file.Stamped = true;
+        if (hash != file.Hash) {
+            file.Hash = hash;
+            changed.push_back(file.Path);
+        }
+    }
+    m_stats.Changed = (uint32_t)changed.size();
+    m_stats.PollMs = MillisecondsSince(start);
+    return changed;
+}
+
+uint64_t FileWatcher::Hash(const std::string& path) const {
+    for (const WatchedFile& file : m_files) {
+        if (file.Path == path) return file.Hash;
+    }
+    return 0;
+}
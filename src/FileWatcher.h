@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Polls files for hot reload. Only a file whose size or modification time moved is read again,
+// so an unchanged tree costs one stat per file, and it only counts as changed when its content
+// hash differs from the last one seen: touching a file or saving it unchanged reports nothing.
+// A file that can't be read (deleted, or locked mid-save) keeps its last hash and is looked at
+// again on the next poll.
+
+struct FileWatcherStats {
+    uint32_t Files = 0;
+    uint32_t Read = 0;    // Files hashed by the last Poll
+    uint32_t Changed = 0; // Of those, with new content
+    double PollMs = 0.0;
+};
+
+class FileWatcher {
+public:
+    // FNV-1a of the whole file; false if it can't be read
+    static bool HashFile(const std::string& path, uint64_t& hash);
+
+    // Starts watching 'path' (once per path) and returns its content hash, 0 if unreadable
+    uint64_t Watch(const std::string& path);
+    // Paths whose content changed since the last Poll or Watch, in the order they were watched
+    std::vector<std::string> Poll();
+    // Last content hash seen, 0 if never readable or not watched
+    uint64_t Hash(const std::string& path) const;
+
+    const FileWatcherStats& Stats() const { return m_stats; }
+
+private:
+    struct WatchedFile {
+        std::string Path;
+        uint64_t Hash = 0;
+        uint64_t Size = 0;
+        std::filesystem::file_time_type Time;
+        bool Stamped = false; // Size and Time belong to the content hashed
+    };
+
+    // Size and time of the file now; false if it doesn't exist
+    static bool Stamp(const std::string& path, uint64_t& size, std::filesystem::file_time_type& time);
+
+    std::vector<WatchedFile> m_files;
+    FileWatcherStats m_stats;
+};
@@ -0,0 +1,274 @@
+#include "FramePipeline.h"
+#include "MeshStream.h"
+#include "Timing.h"
+
+const char* FrameStageName(FrameStage stage) {
+    static const char* names[FrameStageCount] = { "Skinning", "OSM", "Culling", "Occlusion", "DrawLists", "Lights", "Constants" };
+    return stage < FrameStageCount ? names[stage] : "";
+}
+
+FramePipeline::FramePipeline(JobSystem& jobs)
+    : m_jobs(jobs), m_occlusionCuller(jobs), m_skinner(jobs), m_lightCuller(jobs) {}
+
+void FramePipeline::SetMesh(const float* vertices, size_t stride, size_t vertexCount, const std::vector<uint32_t>& indices,
+                            const std::vector<MeshCluster>& clusters, float furLength) {
+    m_vertexStride = stride;
+    m_furLength = furLength;
+    m_bindVertices.assign(vertices, vertices + vertexCount * stride);
+    m_meshBounds = ComputeBounds(vertices, vertexCount, stride);
+
+    m_occluderPositions.resize(vertexCount * 3);
+    for (size_t i = 0; i < vertexCount; i++) {
+        for (int c = 0; c < 3; c++) m_occluderPositions[i * 3 + c] = vertices[i * stride + c];
+    }
+    m_occluderIndices = indices;
+    BuildOccluder(indices);
+
+    m_clusters = clusters;
+    m_clusterVisible.assign(m_clusters.size(), 1);
+    std::vector<Aabb> clusterBounds(m_clusters.size());
+    for (size_t i = 0; i < m_clusters.size(); i++) {
+        clusterBounds[i] = m_clusters[i].Bounds;
+    }
+    m_clusterBvh.Build(clusterBounds, m_furLength, 1);
+
+    m_animations.clear();
+    m_osmScheduler.Invalidate();
+}
+
+// The full mesh costs the occlusion raster most of a frame at a few hundred thousand triangles,
+// for a depth buffer of 256x128. Clustered to OccluderGridResolution it keeps the silhouette to
+// within a cell. Vertices on the surface keep a convex body's occluder inside the body, so it
+// hides only what the mesh hides.
+void FramePipeline::BuildOccluder(const std::vector<uint32_t>& indices) {
+    const size_t vertexCount = m_occluderPositions.size() / 3;
+    MeshArrays input, coarse;
+    input.Vertices.assign(vertexCount * MeshArrays::VertexStride, 0.0f);
+    for (size_t i = 0; i < vertexCount; i++) {
+        for (int c = 0; c < 3; c++) input.Vertices[i * MeshArrays::VertexStride + c] = m_occluderPositions[i * 3 + c];
+    }
+    input.Indices = indices;
+    MeshStreamSettings settings;
+    settings.GridResolution = OccluderGridResolution;
+    std::vector<uint32_t> remap;
+    MeshStreamer::ProcessInCore(input, settings, coarse, &remap);
+
+    m_occluderSources.assign(coarse.VertexCount(), 0);
+    std::vector<float> nearest(coarse.VertexCount(), std::numeric_limits<float>::max());
+    for (size_t i = 0; i < vertexCount; i++) {
+        const uint32_t cell = remap[i];
+        if (cell == UINT32_MAX) continue;
+        const float* mean = &coarse.Vertices[(size_t)cell * MeshArrays::VertexStride];
+        const Float3 offset(m_occluderPositions[i * 3] - mean[0], m_occluderPositions[i * 3 + 1] - mean[1],
+                            m_occluderPositions[i * 3 + 2] - mean[2]);
+        const float distance = Dot(offset, offset);
+        if (distance < nearest[cell]) {
+            nearest[cell] = distance;
+            m_occluderSources[cell] = (uint32_t)i;
+        }
+    }
+    m_coarseOccluderIndices = std::move(coarse.Indices);
+    GatherOccluder();
+}
+
+void FramePipeline::GatherOccluder() {
+    m_coarseOccluderPositions.resize(m_occluderSources.size() * 3);
+    for (size_t i = 0; i < m_occluderSources.size(); i++) {
+        for (int c = 0; c < 3; c++) m_coarseOccluderPositions[i * 3 + c] = m_occluderPositions[(size_t)m_occluderSources[i] * 3 + c];
+    }
+}
+
+void FramePipeline::AddOccluder(const float* positions, size_t stride, size_t vertexCount, const std::vector<uint32_t>& indices,
+                                const Float4x4& world) {
+    ExtraOccluder occluder;
+    occluder.Positions.resize(vertexCount * 3);
+    for (size_t i = 0; i < vertexCount; i++) {
+        for (int c = 0; c < 3; c++) occluder.Positions[i * 3 + c] = positions[i * stride + c];
+    }
+    occluder.Indices = indices;
+    occluder.World = world;
+    m_extraOccluders.push_back(std::move(occluder));
+}
+
+void FramePipeline::SetSkin(const std::vector<SkinWeights>& weights, const Skeleton& skeleton, const std::vector<AnimationClip>& animations) {
+    m_skinWeights = weights;
+    m_skeleton = skeleton;
+    m_animations = animations;
+}
+
+void FramePipeline::UpdateSkinning(float time, float furLength, float* skinnedVertices) {
+    Animation::Sample(m_skeleton, m_animations[0], time, m_pose);
+    Animation::ComputePalette(m_skeleton, m_pose, m_skinPalette);
+
+    size_t vertexCount = m_occluderPositions.size() / 3;
+    if (!skinnedVertices) {
+        m_skinnedVertices.resize(m_bindVertices.size());
+        skinnedVertices = m_skinnedVertices.data();
+    }
+    m_skinner.Skin(m_bindVertices.data(), m_vertexStride, m_skinWeights.data(), vertexCount, m_skinPalette.data(),
+                   skinnedVertices, m_occluderPositions.data());
+    GatherOccluder();
+
+    // Adjacency, fin edges and clusters were built once on the bind pose and stay valid;
+    // only the cluster bounds follow the skinned positions, and the BVH is refit over them
+    m_clusterBounds.resize(m_clusters.size());
+    m_jobs.ParallelFor(m_clusters.size(), 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            m_clusters[i].Bounds = MeshClusters::ClusterBounds(m_clusters[i], m_occluderPositions.data(), 3, m_occluderIndices);
+            m_clusterBounds[i] = m_clusters[i].Bounds;
+        }
+    });
+    m_meshBounds = Aabb();
+    for (const Aabb& bounds : m_clusterBounds) m_meshBounds.Expand(bounds);
+    m_clusterBvh.Refit(m_clusterBounds, furLength);
+}
+
+void FramePipeline::Update(float time, const FrameSceneState& scene, float aspect, float* skinnedVertices) {
+    const Clock::time_point frameStart = Clock::now();
+    const float furLength = m_furLength * scene.FurScale;
+
+    // Skin first: bounds, culling and the OSM below all follow the posed mesh
+    Clock::time_point start = frameStart;
+    if (Animated()) {
+        UpdateSkinning(time, furLength, skinnedVertices);
+    }
+    m_stats.StageMs[FrameStageSkinning] = MillisecondsSince(start);
+
+    start = Clock::now();
+    const Float3 origin(0.0f, 0.0f, 0.0f);
+    const Float3 up(0.0f, 1.0f, 0.0f);
+    Float4x4 view = LookAtLH(scene.CameraPosition, scene.CameraTarget, up);
+    Float4x4 viewProj = Multiply(view, PerspectiveFovLH(scene.FieldOfView, aspect, NearZ, FarZ));
+
+    // Scale is baked into the vertices during load; the world transform only stands the mesh up
+    Float4x4 world = RotationX(1.570796327f);
+    Float4x4 lightView = LookAtLH(scene.LightPosition, origin, up);
+
+    // Length preservation in the shell VS keeps every tip within FurLength of its root,
+    // whatever gravity and wind are doing
+    Aabb furBounds = TransformAabb(world, m_meshBounds).Inflated(furLength);
+
+    OsmSceneState osmState;
+    osmState.LightDirection = Normalize(origin - scene.LightPosition);
+    osmState.FurBounds = furBounds;
+    osmState.WindAmplitude = scene.WindStrength;
+    m_osmUpdate = m_osmScheduler.Update(osmState);
+
+    // Only a full OSM refresh may move the light frustum; partial refreshes and reuse must keep
+    // sampling with the projection the cached layers were rendered with
+    if (m_osmUpdate.Kind == OsmUpdateKind::Full) {
+        LightOrthoFit fit = DeepOpacityMaps::FitLightOrtho(lightView, furBounds);
+        m_osmLightViewProj = Multiply(lightView, OrthographicOffCenterLH(fit.Left, fit.Right, fit.Bottom, fit.Top, fit.Near, fit.Far));
+
+        // Rays crossing the coat obliquely see up to roughly twice the strand length
+        float furDepthSpan = 2.0f * furLength / (fit.Far - fit.Near);
+        m_osmLayout = DeepOpacityMaps::BuildLayout(m_osmLayerCount, furDepthSpan);
+    }
+    m_stats.StageMs[FrameStageOsm] = MillisecondsSince(start);
+
+    // One BVH traversal culls the clusters for the camera and for the OSM band being redrawn
+    // (the cached light projection cropped to the band's rows). Further views such as shadow
+    // cascades only add frusta. The BVH lives in object space, so the frusta are taken from
+    // world * viewProj; the world transform is rigid, which keeps the fur inflation valid.
+    start = Clock::now();
+    if (m_clusterBvh.Inflation() != furLength) {
+        m_clusterBvh.Refit(furLength);
+    }
+    Frustum frusta[2];
+    uint32_t frustumCount = 0;
+    frusta[frustumCount++] = Frustum::FromViewProj(Multiply(world, viewProj));
+    if (m_osmUpdate.RendersAnything()) {
+        OsmTileRect band = OsmTiles();
+        float bandTop = 1.0f - 2.0f * band.Top / OsmResolution;
+        float bandBottom = 1.0f - 2.0f * band.Bottom / OsmResolution;
+        Float4x4 crop = Float4x4::Identity();
+        crop.m[1][1] = 2.0f / (bandTop - bandBottom);
+        crop.m[3][1] = -(bandTop + bandBottom) / (bandTop - bandBottom);
+        frusta[frustumCount++] = Frustum::FromViewProj(Multiply(Multiply(world, m_osmLightViewProj), crop));
+    }
+    m_clusterBvh.CullFrusta(frusta, frustumCount, m_clusterFrustumMasks);
+
+    m_clusterVisible.resize(m_clusters.size());
+    m_clusterInOsmBand.resize(m_clusters.size());
+    for (size_t i = 0; i < m_clusters.size(); i++) {
+        m_clusterVisible[i] = (m_clusterFrustumMasks[i] & 1) ? 1 : 0;
+        m_clusterInOsmBand[i] = (m_clusterFrustumMasks[i] & 2) ? 1 : 0;
+    }
+    MeshClusters::BuildDrawRanges(m_clusters, m_clusterInOsmBand, m_osmDrawRanges);
+    m_stats.StageMs[FrameStageCulling] = MillisecondsSince(start);
+
+    // The base mesh occludes the fur on its far side, along with any registered occluders.
+    // Clusters are tested with bounds grown by the fur length for the same reason furBounds is.
+    // The light sees fur the camera does not, so the OSM ranges above skip this step.
+    start = Clock::now();
+    m_occlusionCuller.BeginFrame(viewProj);
+    m_occlusionCuller.AddOccluder(m_coarseOccluderPositions.data(), 3, m_coarseOccluderPositions.size() / 3,
+                                  m_coarseOccluderIndices.data(), m_coarseOccluderIndices.size(), world);
+    for (const ExtraOccluder& occluder : m_extraOccluders) {
+        m_occlusionCuller.AddOccluder(occluder.Positions.data(), 3, occluder.Positions.size() / 3, occluder.Indices.data(),
+                                      occluder.Indices.size(), occluder.World);
+    }
+    m_occlusionCuller.RasterizeOccluders();
+    m_occlusionCuller.CullClusters(m_clusters, world, furLength, m_clusterVisible);
+    m_stats.StageMs[FrameStageOcclusion] = MillisecondsSince(start);
+
+    // The fur is drawn strictly back to front, whatever the material: its layering depends on it.
+    // The opaque skin is batched by material, nearest first within each material.
+    start = Clock::now();
+    MeshClusters::SortByViewDepth(m_clusters, m_clusterVisible, Multiply(world, view), m_clusterOrder);
+    std::reverse(m_clusterOrder.begin(), m_clusterOrder.end());
+    MeshClusters::BuildDrawRanges(m_clusters, m_clusterOrder, m_drawRanges);
+    std::reverse(m_clusterOrder.begin(), m_clusterOrder.end());
+    std::stable_sort(m_clusterOrder.begin(), m_clusterOrder.end(), [&](uint32_t a, uint32_t b) {
+        return m_clusters[a].Material < m_clusters[b].Material;
+    });
+    MeshClusters::BuildDrawRanges(m_clusters, m_clusterOrder, m_skinDrawRanges);
+    m_stats.StageMs[FrameStageDrawLists] = MillisecondsSince(start);
+
+    // The key light is the one the OSM shadows; it sorts first among the directional lights
+    start = Clock::now();
+    m_frameLights.resize(1);
+    m_frameLights[0].Type = LightType::Directional;
+    m_frameLights[0].Direction = osmState.LightDirection;
+    m_frameLights.insert(m_frameLights.end(), m_sceneLights.begin(), m_sceneLights.end());
+    m_lightCuller.Build(m_frameLights, view, scene.FieldOfView, aspect, NearZ, FarZ);
+    m_stats.StageMs[FrameStageLights] = MillisecondsSince(start);
+
+    start = Clock::now();
+    m_constants.ViewProj = Transpose(viewProj);
+    m_constants.World = Transpose(world);
+    m_constants.LightViewProj = Transpose(m_osmLightViewProj);
+    m_constants.CameraPos = scene.CameraPosition;
+    m_constants.Time = time;
+    m_constants.Gravity = scene.Gravity;
+    m_constants.WindStrength = scene.WindStrength;
+    m_constants.WindDirection = scene.WindDirection;
+    m_constants.FurScale = scene.FurScale;
+    for (uint32_t i = 0; i < DeepOpacityLayout::MaxLayers; i++) m_constants.OsmLayerEnds[i] = m_osmLayout.LayerEnds[i];
+    m_constants.OsmLayerCount = m_osmLayout.LayerCount;
+
+    // Fur LOD from the fur length on screen where the pelt is nearest the camera
+    Float3 nearest = Min(Max(scene.CameraPosition, furBounds.Min), furBounds.Max);
+    float distance = Length(nearest - scene.CameraPosition);
+    float furOnScreen = distance > 0.0f ? furLength / (2.0f * distance * std::tan(0.5f * scene.FieldOfView)) : 1.0f;
+    float lodRange = std::max(m_furLod.ImpostorStart - m_furLod.ImpostorEnd, 1e-6f);
+    m_constants.ImpostorBlend = std::clamp((m_furLod.ImpostorStart - furOnScreen) / lodRange, 0.0f, 1.0f);
+    m_constants.ShellInstances = ShellInstances;
+    m_constants.ImpostorLayers = ImpostorLayers;
+    const LightClusterGrid& grid = m_lightCuller.Grid();
+    m_constants.DirectionalLights = m_lightCuller.DirectionalCount();
+    m_constants.ClusterTilesX = grid.TilesX;
+    m_constants.ClusterTilesY = grid.TilesY;
+    m_constants.ClusterSlices = grid.Slices;
+    m_constants.ClusterDepthScale = grid.DepthScale;
+    m_constants.ClusterDepthBias = grid.DepthBias;
+
+    // The OSM passes see the scene from the light
+    m_lightConstants = m_constants;
+    m_lightConstants.CameraPos = scene.LightPosition;
+    m_lightConstants.ViewProj = m_constants.LightViewProj;
+    m_lightConstants.ImpostorBlend = 0.0f; // The opacity maps always come from the shells
+    m_stats.StageMs[FrameStageConstants] = MillisecondsSince(start);
+
+    m_stats.TotalMs = MillisecondsSince(frameStart);
+}
@@ -0,0 +1,205 @@
+#pragma once
+#include "CoreMath.h"
+#include "JobSystem.h"
+#include "MeshClusters.h"
+#include "OcclusionCuller.h"
+#include "OsmScheduler.h"
+#include "DeepOpacityMaps.h"
+#include "Bvh.h"
+#include "Skinning.h"
+#include "Animation.h"
+#include "LightCulling.h"
+#include <vector>
+
+// The CPU half of a frame, without any GPU: skinning, the OSM schedule and light fit, BVH and
+// occlusion culling, draw lists, clustered light lists and the constant buffer contents. FurRenderer runs it every
+// Update and uploads the results; the headless replay runs exactly the same code.
+
+// Everything about a frame that is scene input rather than derived state
+struct FrameSceneState {
+    Float3 CameraPosition = { 15.0f, 5.0f, 0.0f };
+    Float3 CameraTarget = { 0.0f, 0.0f, 0.0f };
+    float FieldOfView = 0.785398163f; // Vertical, radians
+    Float3 LightPosition = { 15.0f, 15.0f, -15.0f }; // The light looks at the origin
+    Float3 Gravity = { 0.0f, -2.5f, 0.0f };
+    Float3 WindDirection = { 1.0f, 0.0f, 0.0f };
+    float WindStrength = 0.2f;
+    float FurScale = 1.0f; // Multiplies every material's FurLength
+};
+
+// FrameCB in the shaders. Matrices are transposed for HLSL's column-major packing.
+struct FrameConstants {
+    Float4x4 ViewProj;
+    Float4x4 World;
+    Float4x4 LightViewProj;
+    Float3 CameraPos;
+    float Time = 0.0f;
+    Float3 Gravity;
+    float WindStrength = 0.0f;
+    Float3 WindDirection;
+    float FurScale = 1.0f;
+    float OsmLayerEnds[4] = {}; // Deep opacity layer boundaries, see DeepOpacityLayout
+    uint32_t OsmLayerCount = 0;
+    float ImpostorBlend = 0.0f;  // Fur LOD: 0 shells only, 1 impostor layers only, dithered in between
+    uint32_t ShellInstances = 0; // Shells drawn per triangle
+    uint32_t ImpostorLayers = 0; // Impostor layers drawn per triangle, see FurVolume
+    // Clustered lights, see LightCuller. Light 0 is the shadowed key light.
+    uint32_t DirectionalLights = 0;
+    uint32_t ClusterTilesX = 0;
+    uint32_t ClusterTilesY = 0;
+    uint32_t ClusterSlices = 0;
+    float ClusterDepthScale = 0.0f; // Slice = log(view depth) * ClusterDepthScale + ClusterDepthBias
+    float ClusterDepthBias = 0.0f;
+    float LightPadding[2] = {};
+};
+
+// When the fur turns into FurVolume impostor layers, by the fraction of the viewport height that
+// the fur length spans at the nearest point of the pelt. Shells that short alias anyway.
+struct FurLodSettings {
+    float ImpostorStart = 2.0f / 1080.0f; // Shells start to dither out (2 pixels at 1080p)
+    float ImpostorEnd = 1.0f / 1080.0f;   // Impostor layers only
+};
+
+enum FrameStage : uint32_t {
+    FrameStageSkinning = 0, // Palette, skinning, cluster bounds and BVH refit
+    FrameStageOsm,          // Scheduler and light fit
+    FrameStageCulling,      // BVH traversal for the camera and the OSM band
+    FrameStageOcclusion,    // Occluder raster and cluster tests
+    FrameStageDrawLists,    // Depth sort and draw ranges
+    FrameStageLights,       // Clustered light lists
+    FrameStageConstants,
+    FrameStageCount
+};
+
+const char* FrameStageName(FrameStage stage);
+
+struct FramePipelineStats {
+    double StageMs[FrameStageCount] = {}; // Last Update
+    double TotalMs = 0.0;
+};
+
+class FramePipeline {
+public:
+    static constexpr uint32_t OsmResolution = 1024;
+    static constexpr float NearZ = 0.1f;
+    static constexpr float FarZ = 100.0f;
+    static constexpr uint32_t ShellInstances = 32;
+    static constexpr uint32_t ImpostorLayers = 4;
+    static constexpr uint32_t OccluderGridResolution = 48; // Cells along the mesh's longest axis for its occluder
+
+    explicit FramePipeline(JobSystem& jobs);
+
+    // The clustered base mesh. 'vertices' use the GPU layout ('stride' floats, position first)
+    // and are copied; 'furLength' is the longest fur of any material.
+    void SetMesh(const float* vertices, size_t stride, size_t vertexCount, const std::vector<uint32_t>& indices,
+                 const std::vector<MeshCluster>& clusters, float furLength);
+    // Makes the mesh animated: every Update samples the first clip and skins the bind pose
+    void SetSkin(const std::vector<SkinWeights>& weights, const Skeleton& skeleton, const std::vector<AnimationClip>& animations);
+    bool Animated() const { return !m_animations.empty(); }
+
+    // Point, spot and directional lights besides the key light at FrameSceneState::LightPosition
+    void SetLights(const std::vector<SceneLight>& lights) { m_sceneLights = lights; }
+
+    // Extra opaque geometry hiding fur (floors, props), rasterized with the mesh's own occluder
+    // every Update. Positions are 'stride' floats apart, position first; both arrays are copied.
+    void AddOccluder(const float* positions, size_t stride, size_t vertexCount, const std::vector<uint32_t>& indices,
+                     const Float4x4& world);
+    void ClearOccluders() { m_extraOccluders.clear(); }
+
+    void SetFurLod(const FurLodSettings& settings) { m_furLod = settings; }
+    const FurLodSettings& FurLod() const { return m_furLod; }
+
+    // Runs one frame at 'time'. Animated meshes are skinned into 'skinnedVertices' (SetMesh's
+    // layout, write-only, e.g. mapped upload memory) or, if null, into an internal buffer.
+    void Update(float time, const FrameSceneState& scene, float aspect, float* skinnedVertices = nullptr);
+
+    // Scene and light-view constants of the last Update
+    const FrameConstants& Constants() const { return m_constants; }
+    const FrameConstants& LightConstants() const { return m_lightConstants; }
+
+    const OsmUpdate& Osm() const { return m_osmUpdate; }
+    OsmTileRect OsmTiles() const { return m_osmScheduler.TileRange(m_osmUpdate.FirstTile, m_osmUpdate.TileCount, OsmResolution); }
+
+    const std::vector<DrawRange>& DrawRanges() const { return m_drawRanges; }         // Fins and shells, back to front
+    const std::vector<DrawRange>& SkinDrawRanges() const { return m_skinDrawRanges; } // By material, front to back
+    const std::vector<DrawRange>& OsmDrawRanges() const { return m_osmDrawRanges; }   // Inside the OSM band being redrawn
+
+    // Light lists of the last Update, key light first
+    const LightCuller& Lights() const { return m_lightCuller; }
+
+    const std::vector<MeshCluster>& Clusters() const { return m_clusters; }
+    const Skeleton& Rig() const { return m_skeleton; }
+    const std::vector<AnimationClip>& Animations() const { return m_animations; }
+
+    OsmScheduler& OsmSchedule() { return m_osmScheduler; }
+    const OcclusionCuller& Occlusion() const { return m_occlusionCuller; }
+    const Bvh4& ClusterBvh() const { return m_clusterBvh; }
+    const Skinner& Skinning() const { return m_skinner; }
+    const FramePipelineStats& Stats() const { return m_stats; }
+
+private:
+    void UpdateSkinning(float time, float furLength, float* skinnedVertices);
+    void BuildOccluder(const std::vector<uint32_t>& indices);
+    void GatherOccluder();
+
+    JobSystem& m_jobs;
+    size_t m_vertexStride = 0;
+    float m_furLength = 0.0f;
+    FurLodSettings m_furLod;
+    Aabb m_meshBounds; // Object-space bounds of the undisplaced base mesh
+
+    // Temporal OSM caching: the scheduler picks reuse / partial / full each frame
+    OsmScheduler m_osmScheduler;
+    OsmUpdate m_osmUpdate;
+    Float4x4 m_osmLightViewProj; // Projection the cached OSM content was rendered with
+    DeepOpacityLayout m_osmLayout;
+    uint32_t m_osmLayerCount = DeepOpacityLayout::MaxLayers;
+
+    OcclusionCuller m_occlusionCuller;
+    std::vector<MeshCluster> m_clusters;
+    std::vector<uint8_t> m_clusterVisible;
+    std::vector<uint32_t> m_clusterOrder;    // Visible clusters, nearest first
+    std::vector<DrawRange> m_skinDrawRanges;
+    std::vector<DrawRange> m_drawRanges;
+    std::vector<DrawRange> m_osmDrawRanges;
+    std::vector<uint8_t> m_clusterInOsmBand;
+
+    // Object-space cluster BVH, inflated by the fur length; one traversal culls every view
+    Bvh4 m_clusterBvh;
+    std::vector<uint32_t> m_clusterFrustumMasks;
+    std::vector<float> m_occluderPositions; // Base mesh xyz, tightly packed; skinned when animated
+    std::vector<uint32_t> m_occluderIndices;
+
+    // What the occlusion raster draws for the mesh: the mesh clustered to OccluderGridResolution
+    // (MeshStreamer's vertex clustering), each vertex taken from the mesh vertex nearest its
+    // cell's mean so it follows the skinning
+    std::vector<uint32_t> m_occluderSources;
+    std::vector<float> m_coarseOccluderPositions;
+    std::vector<uint32_t> m_coarseOccluderIndices;
+
+    struct ExtraOccluder {
+        std::vector<float> Positions; // xyz
+        std::vector<uint32_t> Indices;
+        Float4x4 World;
+    };
+    std::vector<ExtraOccluder> m_extraOccluders;
+
+    // Skinning of animated meshes; the bind pose stays here
+    Skinner m_skinner;
+    std::vector<float> m_bindVertices;
+    std::vector<float> m_skinnedVertices; // Used when Update is given no destination
+    std::vector<SkinWeights> m_skinWeights;
+    Skeleton m_skeleton;
+    std::vector<AnimationClip> m_animations;
+    std::vector<JointPose> m_pose;
+    std::vector<Float4x4> m_skinPalette;
+    std::vector<Aabb> m_clusterBounds;
+
+    std::vector<SceneLight> m_sceneLights;
+    std::vector<SceneLight> m_frameLights; // The key light, then m_sceneLights
+    LightCuller m_lightCuller;
+
+    FrameConstants m_constants;
+    FrameConstants m_lightConstants;
+    FramePipelineStats m_stats;
+};
@@ -0,0 +1,203 @@
+#include "FrameScript.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "../third_party/tinygltf/json.hpp"
+
+using json = nlohmann::json;
+
+FrameScript FrameScript::DefaultOrbit() {
+    // Radius 15 at height 5, half a radian per second. Keys every 0.1 s keep the chord within
+    // a few thousandths of the circle.
+    const float angularSpeed = 0.5f;
+    const float period = 2.0f * 3.14159265f / angularSpeed;
+    const uint32_t keyCount = 126;
+
+    FrameScript script;
+    script.Loop = true;
+    script.FrameCount = (uint32_t)(period / script.FixedDt + 0.5f);
+    for (uint32_t i = 0; i <= keyCount; i++) {
+        FrameScriptKey key;
+        key.Time = period * i / keyCount;
+        float angle = key.Time * angularSpeed;
+        key.State.CameraPosition = Float3(15.0f * std::cos(angle), 5.0f, 15.0f * std::sin(angle));
+        script.Keys.push_back(key);
+    }
+    return script;
+}
+
+static Float3 Lerp(const Float3& a, const Float3& b, float t) {
+    return a + (b - a) * t;
+}
+
+FrameSceneState FrameScript::Evaluate(float time) const {
+    if (Keys.empty()) return FrameSceneState();
+    if (Loop && Keys.back().Time > Keys.front().Time) {
+        float span = Keys.back().Time - Keys.front().Time;
+        time = Keys.front().Time + std::fmod(std::max(time - Keys.front().Time, 0.0f), span);
+    }
+    if (time <= Keys.front().Time) return Keys.front().State;
+    if (time >= Keys.back().Time) return Keys.back().State;
+
+    auto next = std::upper_bound(Keys.begin(), Keys.end(), time, [](float t, const FrameScriptKey& key) { return t < key.Time; });
+    const FrameScriptKey& b = *next;
+    const FrameScriptKey& a = *(next - 1);
+    float t = b.Time > a.Time ? (time - a.Time) / (b.Time - a.Time) : 1.0f;
+
+    FrameSceneState state;
+    state.CameraPosition = Lerp(a.State.CameraPosition, b.State.CameraPosition, t);
+    state.CameraTarget = Lerp(a.State.CameraTarget, b.State.CameraTarget, t);
+    state.FieldOfView = a.State.FieldOfView + (b.State.FieldOfView - a.State.FieldOfView) * t;
+    state.LightPosition = Lerp(a.State.LightPosition, b.State.LightPosition, t);
+    state.Gravity = Lerp(a.State.Gravity, b.State.Gravity, t);
+    state.WindDirection = Lerp(a.State.WindDirection, b.State.WindDirection, t);
+    state.WindStrength = a.State.WindStrength + (b.State.WindStrength - a.State.WindStrength) * t;
+    state.FurScale = a.State.FurScale + (b.State.FurScale - a.State.FurScale) * t;
+    return state;
+}
+
+void FrameScript::Record(float time, const FrameSceneState& state) {
+    Keys.push_back({ time, state });
+    FrameCount = (uint32_t)Keys.size();
+    if (Keys.size() > 1) FixedDt = (Keys.back().Time - Keys.front().Time) / (Keys.size() - 1);
+}
+
+// The readers keep 'value' when the field is missing or of the wrong type
+static void ReadFloat3(const json& object, const char* name, Float3& value) {
+    auto it = object.find(name);
+    if (it == object.end() || !it->is_array() || it->size() != 3) return;
+    if (!(*it)[0].is_number() || !(*it)[1].is_number() || !(*it)[2].is_number()) return;
+    value = Float3((*it)[0].get<float>(), (*it)[1].get<float>(), (*it)[2].get<float>());
+}
+
+static void ReadFloat(const json& object, const char* name, float& value) {
+    auto it = object.find(name);
+    if (it != object.end() && it->is_number()) value = it->get<float>();
+}
+
+static void ReadUint(const json& object, const char* name, uint32_t& value) {
+    auto it = object.find(name);
+    if (it != object.end() && it->is_number_unsigned() && it->get<uint64_t>() <= UINT32_MAX) value = it->get<uint32_t>();
+}
+
+static void ReadBool(const json& object, const char* name, bool& value) {
+    auto it = object.find(name);
+    if (it != object.end() && it->is_boolean()) value = it->get<bool>();
+}
+
+static void ReadString(const json& object, const char* name, std::string& value) {
+    auto it = object.find(name);
+    if (it != object.end() && it->is_string()) value = it->get<std::string>();
+}
+
+// An optional array of objects; false if the field is there but isn't one
+static bool ReadObjects(const json& object, const char* name, json& value) {
+    auto it = object.find(name);
+    value = it != object.end() ? *it : json::array();
+    if (!value.is_array()) return false;
+    return std::all_of(value.begin(), value.end(), [](const json& entry) { return entry.is_object(); });
+}
+
+static const char* LightTypeNames[] = { "directional", "point", "spot" };
+
+bool FrameScript::Load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    json root = json::parse(contents.str(), nullptr, false);
+    if (root.is_discarded() || !root.is_object()) return false;
+
+    *this = FrameScript();
+    ReadFloat(root, "fixedDt", FixedDt);
+    ReadFloat(root, "aspect", Aspect);
+    ReadUint(root, "frames", FrameCount);
+    ReadBool(root, "loop", Loop);
+    ReadString(root, "mesh", Mesh);
+
+    json keys, lights;
+    if (!ReadObjects(root, "keys", keys) || !ReadObjects(root, "lights", lights)) return false;
+
+    FrameSceneState state;
+    for (const json& entry : keys) {
+        FrameScriptKey key;
+        key.Time = Keys.empty() ? 0.0f : Keys.back().Time;
+        ReadFloat(entry, "time", key.Time);
+        ReadFloat3(entry, "camera", state.CameraPosition);
+        ReadFloat3(entry, "target", state.CameraTarget);
+        ReadFloat(entry, "fov", state.FieldOfView);
+        ReadFloat3(entry, "light", state.LightPosition);
+        ReadFloat3(entry, "gravity", state.Gravity);
+        ReadFloat3(entry, "windDirection", state.WindDirection);
+        ReadFloat(entry, "windStrength", state.WindStrength);
+        ReadFloat(entry, "furScale", state.FurScale);
+        key.State = state;
+        Keys.push_back(key);
+    }
+    std::stable_sort(Keys.begin(), Keys.end(), [](const FrameScriptKey& a, const FrameScriptKey& b) { return a.Time < b.Time; });
+
+    for (const json& entry : lights) {
+        SceneLight light;
+        std::string type = LightTypeNames[(uint32_t)light.Type];
+        if (entry.contains("type") && !entry["type"].is_string()) return false;
+        ReadString(entry, "type", type);
+        auto name = std::find(std::begin(LightTypeNames), std::end(LightTypeNames), type);
+        if (name == std::end(LightTypeNames)) return false;
+        light.Type = (LightType)(name - std::begin(LightTypeNames));
+        ReadFloat3(entry, "position", light.Position);
+        ReadFloat3(entry, "direction", light.Direction);
+        ReadFloat3(entry, "color", light.Color);
+        ReadFloat(entry, "range", light.Range);
+        ReadFloat(entry, "innerAngle", light.InnerAngle);
+        ReadFloat(entry, "outerAngle", light.OuterAngle);
+        Lights.push_back(light);
+    }
+    return FixedDt > 0.0f && Aspect > 0.0f;
+}
+
+bool FrameScript::Save(const std::string& path) const {
+    auto array3 = [](const Float3& v) { return json::array({ v.x, v.y, v.z }); };
+    json root;
+    root["fixedDt"] = FixedDt;
+    root["frames"] = FrameCount;
+    root["aspect"] = Aspect;
+    root["loop"] = Loop;
+    if (!Mesh.empty()) root["mesh"] = Mesh;
+    if (!Lights.empty()) {
+        json lights = json::array();
+        for (const SceneLight& light : Lights) {
+            lights.push_back({
+                { "type", LightTypeNames[(uint32_t)light.Type] },
+                { "position", array3(light.Position) },
+                { "direction", array3(light.Direction) },
+                { "color", array3(light.Color) },
+                { "range", light.Range },
+                { "innerAngle", light.InnerAngle },
+                { "outerAngle", light.OuterAngle },
+            });
+        }
+        root["lights"] = lights;
+    }
+
+    // One key per line: recorded sessions run to thousands of keys
+    std::ofstream file(path, std::ios::trunc);
+    std::string header = root.dump();
+    file << header.substr(0, header.size() - 1) << ",\"keys\":[\n";
+    for (size_t i = 0; i < Keys.size(); i++) {
+        const FrameSceneState& state = Keys[i].State;
+        json key = {
+            { "time", Keys[i].Time },
+            { "camera", array3(state.CameraPosition) },
+            { "target", array3(state.CameraTarget) },
+            { "fov", state.FieldOfView },
+            { "light", array3(state.LightPosition) },
+            { "gravity", array3(state.Gravity) },
+            { "windDirection", array3(state.WindDirection) },
+            { "windStrength", state.WindStrength },
+            { "furScale", state.FurScale },
+        };
+        file << " " << key.dump() << (i + 1 < Keys.size() ? ",\n" : "\n");
+    }
+    file << "]}\n";
+    return (bool)file;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "FramePipeline.h"
+#include <string>
+#include <vector>
+
+// A scripted scene: keyframed FrameSceneStates, played back at a fixed timestep for a number of
+// frames. The headless replay reads scripts, and the renderer can play one live or record the
+// live session into the same format. JSON:
+//
+//   { "fixedDt": 0.0166667, "frames": 600, "aspect": 1.7778, "loop": false, "mesh": "carpet.pmesh",
+//     "keys": [ { "time": 0.0, "camera": [15, 5, 0], "target": [0, 0, 0], "fov": 0.785,
+//                 "light": [15, 15, -15], "gravity": [0, -2.5, 0], "windDirection": [1, 0, 0],
+//                 "windStrength": 0.2, "furScale": 1.0 }, ... ],
+//     "lights": [ { "type": "spot", "position": [0, 4, 0], "direction": [0, -1, 0], "color": [4, 3, 2],
+//                   "range": 8, "innerAngle": 0.3, "outerAngle": 0.6 }, ... ] }
+//
+// Every field is optional; a key inherits whatever it leaves out from the key before it. Lights
+// ("point", "spot" or "directional") are not keyed; they shine besides the key light.
+
+struct FrameScriptKey {
+    float Time = 0.0f;
+    FrameSceneState State;
+};
+
+class FrameScript {
+public:
+    float FixedDt = 1.0f / 60.0f;
+    uint32_t FrameCount = 600;
+    float Aspect = 16.0f / 9.0f;
+    bool Loop = false;   // Time wraps at the last key
+    std::string Mesh;    // Replay only: a .pmesh, relative to the script; empty for the built-in sphere
+    std::vector<FrameScriptKey> Keys; // Ascending time
+    std::vector<SceneLight> Lights;
+
+    // The camera orbit the renderer has always shown, as one looping revolution
+    static FrameScript DefaultOrbit();
+
+    // Linear between the keys around 'time'; the first or last key outside them
+    FrameSceneState Evaluate(float time) const;
+
+    // Appends a key for a live frame; FixedDt becomes the mean frame time
+    void Record(float time, const FrameSceneState& state);
+
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+};
@@ -0,0 +1,100 @@
+#include "FurCoat.h"
+#include <algorithm>
+#include <cmath>
+
+uint32_t FurCoat::SeparateShells(const CoatLayer* layers, uint32_t count) {
+    uint32_t shells = 0;
+    for (uint32_t i = 0; i < std::min(count, MaxLayers); i++) shells += std::max(layers[i].Shells, 1u);
+    return shells;
+}
+
+CoatPlan FurCoat::Plan(const CoatLayer* layers, uint32_t count, uint32_t shellCount) {
+    CoatPlan plan;
+    plan.ShellCount = std::max(shellCount, 2u);
+    plan.LayerCount = std::min(count, MaxLayers);
+    if (plan.LayerCount == 0) return plan;
+    for (uint32_t i = 0; i < plan.LayerCount; i++) plan.Length = std::max(plan.Length, layers[i].Length);
+    if (plan.Length <= 0.0f) plan.Length = 1.0f;
+
+    const float heightSteps = (float)(plan.ShellCount - 1);
+    float spacing[MaxLayers];
+    for (uint32_t i = 0; i < plan.LayerCount; i++) {
+        const CoatLayer& source = layers[i];
+        CoatPlanLayer& layer = plan.Layers[i];
+        layer.Length = std::max(source.Length / plan.Length, 1e-6f);
+        layer.Density = source.Density;
+        layer.Thickness = source.Thickness;
+        layer.Color = source.Color;
+        layer.NoiseChannel = std::min(source.NoiseChannel, NoiseChannels - 1);
+        layer.Reach = layer.Length * (float)(std::max(source.Shells, 1u) - 1) / heightSteps;
+    }
+    // Stable, so layers that reach equally keep their order
+    std::stable_sort(plan.Layers, plan.Layers + plan.LayerCount,
+                     [](const CoatPlanLayer& a, const CoatPlanLayer& b) { return a.Reach < b.Reach; });
+    for (uint32_t i = 0; i < plan.LayerCount; i++) spacing[i] = plan.Layers[i].Length / heightSteps;
+
+    // Each segment in as few equal steps as keep every layer reaching it at its own spacing or finer
+    uint32_t last = 0;
+    float start = 0.0f;
+    for (uint32_t k = 0; k < plan.LayerCount; k++) {
+        CoatPlanLayer& layer = plan.Layers[k];
+        const float step = *std::min_element(spacing + k, spacing + plan.LayerCount);
+        if (layer.Reach > start) {
+            last += std::max((uint32_t)std::ceil((layer.Reach - start) / step - 1e-4f), 1u);
+            start = layer.Reach;
+        }
+        layer.LastShell = last;
+    }
+    plan.Instances = last + 1;
+    return plan;
+}
+
+uint32_t FurCoat::Segment(const CoatPlan& plan, uint32_t instance) {
+    for (uint32_t k = 0; k < plan.LayerCount; k++) {
+        if (instance <= plan.Layers[k].LastShell) return k;
+    }
+    return plan.LayerCount > 0 ? plan.LayerCount - 1 : 0;
+}
+
+float FurCoat::ShellHeight(const CoatPlan& plan, uint32_t instance) {
+    uint32_t first = 0;
+    float start = 0.0f;
+    for (uint32_t k = 0; k < plan.LayerCount; k++) {
+        const CoatPlanLayer& layer = plan.Layers[k];
+        if (instance <= layer.LastShell) {
+            if (layer.LastShell == first) return layer.Reach;
+            return start + (float)(instance - first) * (layer.Reach - start) / (float)(layer.LastShell - first);
+        }
+        first = layer.LastShell;
+        start = layer.Reach;
+    }
+    return start;
+}
+
+float FurCoat::SegmentStep(const CoatPlan& plan, uint32_t segment) {
+    if (segment >= plan.LayerCount) return 0.0f;
+    const CoatPlanLayer& layer = plan.Layers[segment];
+    const uint32_t first = segment > 0 ? plan.Layers[segment - 1].LastShell : 0;
+    const float start = segment > 0 ? plan.Layers[segment - 1].Reach : 0.0f;
+    return layer.LastShell > first ? (layer.Reach - start) / (float)(layer.LastShell - first) : 0.0f;
+}
+
+int32_t FurCoat::ShadeLayer(const CoatPlan& plan, uint32_t instance, const float* layerNoise) {
+    const float height = ShellHeight(plan, instance);
+    for (uint32_t k = plan.LayerCount; k > Segment(plan, instance); k--) {
+        const CoatPlanLayer& layer = plan.Layers[k - 1];
+        if (layerNoise[k - 1] - height / layer.Length * layer.Thickness >= 0.0f) return (int32_t)(k - 1);
+    }
+    return -1;
+}
+
+float FurCoat::OsmOpacity(const CoatPlan& plan, uint32_t instance, uint32_t layer) {
+    const uint32_t segment = Segment(plan, instance);
+    if (layer < segment || layer >= plan.LayerCount) return 0.0f;
+    const CoatPlanLayer& l = plan.Layers[layer];
+    const float h = ShellHeight(plan, instance) / l.Length;
+    // A segment without steps is the root shell alone, which the layer's own pass draws once too
+    const float step = SegmentStep(plan, segment);
+    const float weight = step > 0.0f ? step * (float)(plan.ShellCount - 1) / l.Length : 1.0f;
+    return (1.0f - h) / (float)plan.ShellCount * weight;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "CoreMath.h"
+#include <cstdint>
+
+// Layered coats: a dense short undercoat under sparse long guard hairs, in one instanced shell
+// draw. On its own, a layer would be drawn like a single-layer material: 'Shells' shells, shell
+// k at height k / (ShellCount - 1) of the layer's length, clipped where the layer's noise falls
+// below height * Thickness. The coat draw instead steps once through the union of those heights.
+// Sorted by how high their top shell reaches, the layers cut the heights into segments: segment
+// k ends at layer k's top shell and is stepped at the finest spacing of the layers still
+// reaching it (layer k and every longer one), so no layer gets coarser shells than it would
+// alone. A shell only evaluates the layers that reach it, and where several cover a texel the
+// outermost is drawn. shell_vs, shell_ps and osm_ps mirror the mapping.
+
+// One layer as a material describes it
+struct CoatLayer {
+    float Length = 0.04f;  // World units, like FurMaterial::FurLength
+    uint32_t Shells = 32;  // Shells the layer gets when drawn on its own
+    float Density = 120.0f;
+    float Thickness = 0.85f;
+    Float3 Color = { 0.85f, 0.82f, 0.78f };
+    uint32_t NoiseChannel = 0; // Of the shells' noise texture, below FurCoat::NoiseChannels
+};
+
+// One layer as the shaders see it (FurCB::Layers); heights are fractions of CoatPlan::Length
+struct CoatPlanLayer {
+    float Length = 1.0f;
+    float Density = 0.0f;
+    float Thickness = 0.0f;
+    Float3 Color;
+    uint32_t NoiseChannel = 0;
+    float Reach = 0.0f;     // Height of the layer's top shell
+    uint32_t LastShell = 0; // Last instance of the layer's segment, the one at Reach
+};
+
+struct CoatPlan {
+    float Length = 0.0f;     // The longest layer, world units
+    uint32_t ShellCount = 0; // Height resolution, FurCB::ShellCount
+    uint32_t Instances = 0;  // Shells the coat draw instances per triangle
+    uint32_t LayerCount = 0;
+    CoatPlanLayer Layers[4]; // By Reach, the outermost last
+};
+
+class FurCoat {
+public:
+    static constexpr uint32_t MaxLayers = 4;
+    static constexpr uint32_t NoiseChannels = 2; // RG of the noise texture
+    static constexpr uint32_t ShellCount = 48;   // Height resolution of every material, FurCB::ShellCount
+
+    // Layers past MaxLayers are ignored; every layer gets at least one shell
+    static CoatPlan Plan(const CoatLayer* layers, uint32_t count, uint32_t shellCount);
+    // Shells drawn when every layer is a pass of its own
+    static uint32_t SeparateShells(const CoatLayer* layers, uint32_t count);
+    // Seed of one noise channel's Voronoi points, far from every other channel's
+    static uint64_t NoiseSeed(uint64_t seed, uint32_t channel) { return seed + channel * 0x9e3779b97f4a7c15ull; }
+
+    // Mirrors shell_vs: the segment instance 'instance' falls in, i.e. the first layer that
+    // reaches it (every later one does too), and its height
+    static uint32_t Segment(const CoatPlan& plan, uint32_t instance);
+    static float ShellHeight(const CoatPlan& plan, uint32_t instance);
+    // Height between neighbouring shells of a segment
+    static float SegmentStep(const CoatPlan& plan, uint32_t segment);
+
+    // Mirrors shell_ps: the layer drawn at a texel of shell 'instance', from each layer's noise
+    // there ('layerNoise' per plan layer, at its density and channel); -1 if no layer covers it
+    static int32_t ShadeLayer(const CoatPlan& plan, uint32_t instance, const float* layerNoise);
+    // Mirrors osm_ps: the opacity 'layer' adds at shell 'instance' where it covers the texel.
+    // Scaled by the shell spacing against the layer's own, so over the coat draw it sums to what
+    // the layer's separate pass adds.
+    static float OsmOpacity(const CoatPlan& plan, uint32_t instance, uint32_t layer);
+};
@@ -0,0 +1,182 @@
+// Headless layered coat benchmark. First checks FurCoat's instance-to-layer mapping on cases with
+// known answers:
+//   single layer        one layer plans exactly the shells a single-layer material draws today
+//   layer spacing       every segment is stepped at least as finely as each layer reaching it
+//   instance to layer   a shell evaluates a layer exactly when its height is within the layer's reach
+//   unsorted layers     layers given outermost first, or reaching equally, plan the same coat
+//   outermost wins      where several layers cover a texel the longest one is drawn
+//   osm opacity         per layer, the coat draw adds the opacity of the layer's own pass
+// Then compares coats of two to four layers against one pass per layer: shells instanced per
+// triangle, layer tests, and fragments shaded per texel over the shells' real noise.
+// Usage: PelageFurCoatBench [noise size]
+#include "BenchReport.h"
+#include "FurCoat.h"
+#include "FurVolume.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static constexpr uint32_t ShellCount = FurCoat::ShellCount;
+
+static CoatLayer Layer(float length, uint32_t shells, float density, float thickness, uint32_t channel) {
+    CoatLayer layer;
+    layer.Length = length;
+    layer.Shells = shells;
+    layer.Density = density;
+    layer.Thickness = thickness;
+    layer.NoiseChannel = channel;
+    return layer;
+}
+
+// A dense short undercoat under sparse guard hairs as long as the single-layer default
+static const CoatLayer Pelt[2] = { Layer(0.016f, 24, 240.0f, 0.9f, 0), Layer(0.04f, 32, 60.0f, 0.7f, 1) };
+
+static bool SameHeight(float a, float b) {
+    return std::fabs(a - b) <= 1e-5f;
+}
+
+static bool Check() {
+    bool ok = true;
+
+    // The default material: 32 shells, shell i at i / 47 of the fur length
+    const CoatLayer single = Layer(0.04f, 32, 120.0f, 0.85f, 0);
+    CoatPlan plan = FurCoat::Plan(&single, 1, ShellCount);
+    bool same = plan.Instances == 32 && plan.LayerCount == 1 && plan.Length == 0.04f;
+    for (uint32_t i = 0; i < plan.Instances; i++) {
+        same &= SameHeight(FurCoat::ShellHeight(plan, i), (float)i / (ShellCount - 1)) && FurCoat::Segment(plan, i) == 0;
+        same &= std::fabs(FurCoat::OsmOpacity(plan, i, 0) - (1.0f - (float)i / (ShellCount - 1)) / ShellCount) <= 1e-6f;
+    }
+    ok &= Report("single layer", same);
+
+    plan = FurCoat::Plan(Pelt, 2, ShellCount);
+    bool spaced = plan.Instances < FurCoat::SeparateShells(Pelt, 2) && FurCoat::ShellHeight(plan, 0) == 0.0f;
+    for (uint32_t i = 1; i < plan.Instances; i++) {
+        const float step = FurCoat::ShellHeight(plan, i) - FurCoat::ShellHeight(plan, i - 1);
+        const uint32_t segment = FurCoat::Segment(plan, i);
+        spaced &= step > 0.0f;
+        for (uint32_t k = segment; k < plan.LayerCount; k++) spaced &= step <= plan.Layers[k].Length / (ShellCount - 1) + 1e-6f;
+    }
+    for (uint32_t k = 0; k < plan.LayerCount; k++) {
+        spaced &= SameHeight(FurCoat::ShellHeight(plan, plan.Layers[k].LastShell), plan.Layers[k].Reach);
+    }
+    ok &= Report("layer spacing", spaced && SameHeight(plan.Layers[1].Reach, 31.0f / 47.0f));
+
+    bool mapped = true;
+    for (uint32_t i = 0; i < plan.Instances; i++) {
+        const float height = FurCoat::ShellHeight(plan, i);
+        for (uint32_t k = 0; k < plan.LayerCount; k++) {
+            mapped &= (k >= FurCoat::Segment(plan, i)) == (height <= plan.Layers[k].Reach + 1e-6f);
+        }
+    }
+    ok &= Report("instance to layer", mapped);
+
+    // Outermost first, plus a layer that reaches exactly as high as the undercoat
+    const CoatLayer reversed[3] = { Pelt[1], Pelt[0], Layer(0.016f, 24, 90.0f, 0.5f, 1) };
+    CoatPlan unsorted = FurCoat::Plan(reversed, 3, ShellCount);
+    bool sorted = unsorted.Instances == plan.Instances && unsorted.LayerCount == 3 &&
+                  unsorted.Layers[0].Density == 240.0f && unsorted.Layers[1].Density == 90.0f &&
+                  unsorted.Layers[0].LastShell == unsorted.Layers[1].LastShell;
+    for (uint32_t i = 0; i < plan.Instances; i++) sorted &= FurCoat::ShellHeight(unsorted, i) == FurCoat::ShellHeight(plan, i);
+    ok &= Report("unsorted layers", sorted);
+
+    // Both cover at the root; only the undercoat at a mid shell; none past the undercoat's noise
+    const float bothCover[2] = { 1.0f, 1.0f }, underOnly[2] = { 1.0f, 0.0f }, none[2] = { 0.0f, 0.0f };
+    const uint32_t mid = plan.Layers[0].LastShell / 2, top = plan.Instances - 1;
+    ok &= Report("outermost wins", FurCoat::ShadeLayer(plan, 0, bothCover) == 1 && FurCoat::ShadeLayer(plan, mid, underOnly) == 0 &&
+                                   FurCoat::ShadeLayer(plan, mid, none) == -1 && FurCoat::ShadeLayer(plan, top, underOnly) == -1);
+
+    // A texel every shell covers: the coat draw adds what each layer's own pass does. The pelt's
+    // layers are already in reach order.
+    bool opacity = true;
+    for (uint32_t k = 0; k < plan.LayerCount; k++) {
+        const CoatLayer& source = Pelt[k];
+        float alone = 0.0f, coat = 0.0f;
+        for (uint32_t s = 0; s < source.Shells; s++) alone += (1.0f - (float)s / (ShellCount - 1)) / ShellCount;
+        for (uint32_t i = 0; i < plan.Instances; i++) coat += FurCoat::OsmOpacity(plan, i, k);
+        opacity &= std::fabs(coat - alone) <= 0.05f * alone;
+    }
+    ok &= Report("osm opacity", opacity);
+    return ok;
+}
+
+struct CoatWork {
+    uint32_t Shells = 0;     // Instanced per triangle
+    uint32_t LayerTests = 0; // Noise lookups per texel, summed over the shells
+    double Fragments = 0.0;  // Shaded per texel: shells where some layer covers it
+};
+
+// Average over a grid of UVs, sampling each layer's noise channel at its density
+static void Measure(const CoatLayer* layers, uint32_t count, const std::vector<float>* noise, uint32_t noiseSize,
+                    CoatWork& separate, CoatWork& coat) {
+    const CoatPlan plan = FurCoat::Plan(layers, count, ShellCount);
+    separate.Shells = FurCoat::SeparateShells(layers, count);
+    separate.LayerTests = separate.Shells;
+    coat.Shells = plan.Instances;
+    coat.LayerTests = 0;
+    for (uint32_t i = 0; i < plan.Instances; i++) coat.LayerTests += plan.LayerCount - FurCoat::Segment(plan, i);
+
+    const uint32_t grid = 256;
+    double separateFragments = 0.0, coatFragments = 0.0;
+    std::vector<float> layerNoise(plan.LayerCount);
+    for (uint32_t y = 0; y < grid; y++) {
+        for (uint32_t x = 0; x < grid; x++) {
+            const float u = (x + 0.5f) / grid * 0.25f, v = (y + 0.5f) / grid * 0.25f;
+            for (uint32_t k = 0; k < plan.LayerCount; k++) {
+                const CoatPlanLayer& layer = plan.Layers[k];
+                layerNoise[k] = FurVolumeBaker::SampleNoise(noise[layer.NoiseChannel].data(), noiseSize, u * layer.Density,
+                                                            v * layer.Density);
+                // Its own pass: shell s at s / (ShellCount - 1) of the layer, up to its reach
+                const uint32_t shells = (uint32_t)std::lround(layer.Reach / layer.Length * (ShellCount - 1)) + 1;
+                for (uint32_t s = 0; s < shells; s++) {
+                    separateFragments += layerNoise[k] - (float)s / (ShellCount - 1) * layer.Thickness >= 0.0f ? 1.0 : 0.0;
+                }
+            }
+            for (uint32_t i = 0; i < plan.Instances; i++) coatFragments += FurCoat::ShadeLayer(plan, i, layerNoise.data()) >= 0 ? 1.0 : 0.0;
+        }
+    }
+    separate.Fragments = separateFragments / ((double)grid * grid);
+    coat.Fragments = coatFragments / ((double)grid * grid);
+}
+
+static void Benchmark(uint32_t noiseSize) {
+    JobSystem jobs;
+    FurVolumeBaker baker(jobs);
+    std::vector<float> noise[FurCoat::NoiseChannels];
+    FurNoiseSettings settings;
+    settings.Size = noiseSize;
+    Clock::time_point start = Clock::now();
+    for (uint32_t c = 0; c < FurCoat::NoiseChannels; c++) {
+        settings.Seed = FurCoat::NoiseSeed(1, c);
+        baker.GenerateNoise(settings, noise[c]);
+    }
+    printf("\n%u noise channels of %ux%u in %.1f ms\n", FurCoat::NoiseChannels, noiseSize, noiseSize,
+           MillisecondsSince(start));
+
+    struct Preset {
+        const char* Name;
+        std::vector<CoatLayer> Layers;
+    };
+    const Preset presets[] = {
+        { "undercoat + guard", { Pelt[0], Pelt[1] } },
+        { "equal lengths", { Layer(0.04f, 32, 240.0f, 0.9f, 0), Layer(0.04f, 32, 60.0f, 0.7f, 1) } },
+        { "three layers", { Pelt[0], Layer(0.028f, 28, 120.0f, 0.85f, 1), Pelt[1] } },
+        { "four layers", { Layer(0.008f, 16, 320.0f, 0.95f, 0), Pelt[0], Layer(0.028f, 28, 120.0f, 0.85f, 1), Pelt[1] } },
+    };
+    printf("%-18s %22s %22s %22s\n", "coat", "shells sep/coat", "layer tests sep/coat", "fragments sep/coat");
+    for (const Preset& preset : presets) {
+        CoatWork separate, coat;
+        Measure(preset.Layers.data(), (uint32_t)preset.Layers.size(), noise, noiseSize, separate, coat);
+        printf("%-18s %8u %6u %5.2fx %15u %6u %14.2f %7.2f\n", preset.Name, separate.Shells, coat.Shells,
+               (double)separate.Shells / coat.Shells, separate.LayerTests, coat.LayerTests, separate.Fragments, coat.Fragments);
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint32_t noiseSize = argc > 1 ? (uint32_t)std::max(atoi(argv[1]), 16) : 256;
+    bool ok = Check();
+    Benchmark(noiseSize);
+    return ok ? 0 : 1;
+}
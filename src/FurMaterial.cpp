@@ -0,0 +1,102 @@
+#include "FurMaterial.h"
+#include <algorithm>
+#include "../third_party/tinygltf/json.hpp"
+
+using json = nlohmann::json;
+
+// The readers keep 'value' when the field is missing or of the wrong type
+static void ReadColor(const json& object, const char* name, Float3& value) {
+    auto it = object.find(name);
+    if (it == object.end() || !it->is_array() || it->size() < 3) return;
+    if (!(*it)[0].is_number() || !(*it)[1].is_number() || !(*it)[2].is_number()) return;
+    value = Float3((*it)[0].get<float>(), (*it)[1].get<float>(), (*it)[2].get<float>());
+}
+
+static void ReadFloat(const json& object, const char* name, float& value) {
+    auto it = object.find(name);
+    if (it != object.end() && it->is_number()) value = it->get<float>();
+}
+
+static const json& EmptyObject() {
+    static const json empty = json::object();
+    return empty;
+}
+
+// The member object 'name', or an empty one if there is none
+static const json& Member(const json& object, const char* name) {
+    auto it = object.find(name);
+    return it != object.end() && it->is_object() ? *it : EmptyObject();
+}
+
+// glTF image index of a texture info object ({ "index": texture }), -1 if there is none
+static int TextureImageIndex(const json& gltf, const json& textureInfo) {
+    auto index = textureInfo.find("index");
+    auto textures = gltf.find("textures");
+    auto images = gltf.find("images");
+    if (index == textureInfo.end() || !index->is_number_integer() || textures == gltf.end() || !textures->is_array()) return -1;
+    const int64_t texture = index->get<int64_t>();
+    if (texture < 0 || texture >= (int64_t)textures->size() || !(*textures)[texture].is_object()) return -1;
+    auto source = (*textures)[texture].find("source");
+    if (source == (*textures)[texture].end() || !source->is_number_integer() || images == gltf.end() || !images->is_array()) return -1;
+    const int64_t image = source->get<int64_t>();
+    return image >= 0 && image < (int64_t)images->size() ? (int)image : -1;
+}
+
+static FurMaterial ReadMaterial(const json& gltf, const json& material) {
+    FurMaterial fur;
+    auto name = material.find("name");
+    if (name != material.end() && name->is_string()) fur.Name = name->get<std::string>();
+    fur.ColorTexture = TextureImageIndex(gltf, Member(Member(material, "pbrMetallicRoughness"), "baseColorTexture"));
+
+    const json& sheen = Member(Member(material, "extensions"), "KHR_materials_sheen");
+    ReadColor(sheen, "sheenColorFactor", fur.FurColor);
+    const int sheenImage = TextureImageIndex(gltf, Member(sheen, "sheenColorTexture"));
+    if (sheenImage >= 0) fur.ColorTexture = sheenImage;
+
+    const json& extras = Member(material, "extras");
+    ReadFloat(extras, "furLength", fur.FurLength);
+    ReadFloat(extras, "furDensity", fur.Density);
+    ReadFloat(extras, "furThickness", fur.Thickness);
+    ReadColor(extras, "furColor", fur.FurColor);
+
+    auto layers = extras.find("furLayers");
+    for (size_t i = 0; layers != extras.end() && layers->is_array() && i < layers->size() && i < FurCoat::MaxLayers; i++) {
+        const json& entry = (*layers)[i].is_object() ? (*layers)[i] : EmptyObject();
+        CoatLayer layer;
+        layer.Length = fur.FurLength;
+        layer.Density = fur.Density;
+        layer.Thickness = fur.Thickness;
+        layer.Color = fur.FurColor;
+        float shells = (float)layer.Shells, noise = 0.0f;
+        ReadFloat(entry, "length", layer.Length);
+        ReadFloat(entry, "shells", shells);
+        ReadFloat(entry, "density", layer.Density);
+        ReadFloat(entry, "thickness", layer.Thickness);
+        ReadColor(entry, "color", layer.Color);
+        ReadFloat(entry, "noise", noise);
+        layer.Length = std::max(layer.Length, 1e-4f);
+        layer.Shells = (uint32_t)std::max(shells, 1.0f);
+        layer.NoiseChannel = std::min((uint32_t)std::max(noise, 0.0f), FurCoat::NoiseChannels - 1);
+        fur.Layers.push_back(layer);
+    }
+    if (!fur.Layers.empty()) {
+        // The whole coat as one material to everything else: the hull, culling and the fins
+        const CoatPlan plan = FurCoat::Plan(fur.Layers.data(), (uint32_t)fur.Layers.size(), FurCoat::ShellCount);
+        const CoatPlanLayer& outer = plan.Layers[plan.LayerCount - 1];
+        fur.FurLength = plan.Length;
+        fur.Density = outer.Density;
+        fur.Thickness = outer.Thickness;
+        fur.FurColor = outer.Color;
+    }
+    return fur;
+}
+
+bool FurMaterials::ReadGltf(const std::string& gltfText, std::vector<FurMaterial>& materials) {
+    materials.clear();
+    const json gltf = json::parse(gltfText, nullptr, false);
+    if (gltf.is_discarded() || !gltf.is_object()) return false;
+    auto list = gltf.find("materials");
+    if (list == gltf.end() || !list->is_array()) return true;
+    for (const json& material : *list) materials.push_back(ReadMaterial(gltf, material.is_object() ? material : EmptyObject()));
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "CoreMath.h"
+#include "FurCoat.h"
+#include <string>
+#include <vector>
+
+// Fur look of one glTF material. The defaults are the carpet's; see FurMaterials::ReadGltf for
+// the material properties and extras that override them.
+struct FurMaterial {
+    std::string Name;
+    float FurLength = 0.04f;  // Short fibers
+    float Density = 120.0f;   // Extremely dense
+    float Thickness = 0.85f;  // Keep tips reasonably sharp
+    Float3 FurColor = Float3(0.85f, 0.82f, 0.78f); // Soft off-white/cream
+    int32_t ColorTexture = -1; // Index into MeshData::Textures, tints FurColor; -1 for none
+    // Coat layers drawn by the one shell draw (FurCoat), e.g. an undercoat under guard hairs.
+    // Empty means a single layer from the values above. When set, FurLength is the longest
+    // layer's and Density, Thickness and FurColor are the outermost layer's, for the fins and
+    // impostor layers.
+    std::vector<CoatLayer> Layers;
+};
+
+class FurMaterials {
+public:
+    // glTF materials -> fur parameters, one per entry of "materials", in order. KHR_materials_sheen
+    // (the glTF model for cloth and fibers) tints the fur; "extras" set anything explicitly:
+    //   "extras": { "furLength": 0.06, "furDensity": 90, "furThickness": 0.7, "furColor": [r, g, b] }
+    // and "furLayers" makes a layered coat, each layer taking the material's values where unset:
+    //   "furLayers": [ { "length": 0.02, "shells": 24, "density": 240, "thickness": 0.9, "color": [r, g, b], "noise": 0 },
+    //                  { "length": 0.06, "density": 60, "noise": 1 } ]
+    // Fields of the wrong type are ignored. The colour map is the sheen colour texture, else the
+    // base colour texture; ColorTexture is left as a glTF image index for the loader to remap.
+    // False if 'gltfText' is not a JSON object.
+    static bool ReadGltf(const std::string& gltfText, std::vector<FurMaterial>& materials);
+};
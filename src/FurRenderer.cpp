@@ -1,6 +1,17 @@
 #include "FurRenderer.h"
+#include "FurVolume.h"
+#include "Grooming.h"
 #include "GeometryGen.h"
+#include "Hash.h"
+#include "MemoryArena.h"
+#include "MeshStream.h"
+#include "../third_party/tinygltf/json.hpp"
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 
 // Helper to check HRESULTs
 inline void ThrowIfFailed(HRESULT hr) {
@@ -9,6 +20,17 @@ inline void ThrowIfFailed(HRESULT hr) {
     }
 }
 
+// Depth transients (D32_FLOAT) are typeless so the resolve step can read them: D32_FLOAT DSVs,
+// R32_FLOAT SRVs
+static D3D12_RESOURCE_DESC ToResourceDesc(const RgTextureDesc& desc) {
+    if (desc.DepthStencil) {
+        return CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_TYPELESS, desc.Width, desc.Height, 1, 1, desc.SampleCount, 0,
+                                            D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+    }
+    return CD3DX12_RESOURCE_DESC::Tex2D((DXGI_FORMAT)desc.Format, desc.Width, desc.Height, 1, 1, desc.SampleCount, 0,
+                                        D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+}
+
 FurRenderer::FurRenderer(HWND hwnd, uint32_t width, uint32_t height)
     : m_hwnd(hwnd), m_width(width), m_height(height) {
     m_viewport = {0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f};
@@ -16,7 +38,12 @@ FurRenderer::FurRenderer(HWND hwnd, uint32_t width, uint32_t height)
 }
 
 FurRenderer::~FurRenderer() {
+    m_sceneStream.reset(); // Joins the scene's builders before anything they read goes
     FlushCommandQueue();
+    m_recording.Lights = m_script.Lights; // Not keyed; the session ran with the script's lights
+    if (!m_recordPath.empty() && !m_recording.Save(m_recordPath)) {
+        OutputDebugStringA(("Failed to save the recording to " + m_recordPath + "\n").c_str());
+    }
     // Keep it simple for now; ComPtrs will clean up
 }
 
@@ -27,188 +54,376 @@ void FurRenderer::Init() {
     CreateRtvAndDsvDescriptorHeaps();
     CreateRootSignature();
     CreateConstantBuffers();
-    CreateShadersAndPSOs();
+    CreateGpuTimers();
     BuildRenderItems();
 }
 
 void FurRenderer::Update(float deltaTime) {
-    static float time = 0.0f;
-    time += deltaTime;
+    HotReload(deltaTime);
+    StreamScene();
+    m_time += deltaTime;
+    FrameSceneState scene = m_script.Evaluate(m_time);
+    if (!m_recordPath.empty()) {
+        m_recording.Record(m_time, scene);
+    }
 
-    FrameCB frameData = {};
-    
-    // Rotating camera
-    float camRadius = 15.0f; // Zoom out
-    frameData.CameraPos = XMFLOAT3(camRadius * cosf(time * 0.5f), 5.0f, camRadius * sinf(time * 0.5f));
-    
-    XMVECTOR pos = XMLoadFloat3(&frameData.CameraPos);
-    XMVECTOR target = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-    XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-    
-    XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
-    XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)m_width / m_height, 0.1f, 100.0f);
-    
-    frameData.ViewProj = XMMatrixTranspose(view * proj);
-    // Update frameData.Time and others ...
-    
-    // Apply transformations
-    // Scale is baked into the vertices during load now, so we just rotate/translate if needed
-    XMMATRIX rot = XMMatrixRotationX(XM_PIDIV2); // Rotate 90 degrees on X (often needed for models)
-    XMMATRIX trans = XMMatrixTranslation(0.0f, 0.0f, 0.0f);
-    frameData.World = XMMatrixTranspose(rot * trans);
-
-    frameData.Time = time;
-    frameData.Gravity = XMFLOAT3(0.0f, -2.5f, 0.0f);
-    frameData.WindStrength = 0.2f;
-    frameData.WindDirection = XMFLOAT3(1.0f, 0.0f, 0.0f);
-    
-    // Light Frame
-    float lightRadius = 15.0f; // Scale up light for larger scene
-    XMFLOAT3 lightPosF3 = XMFLOAT3(lightRadius, lightRadius, -lightRadius);
-    XMVECTOR lightPos = XMLoadFloat3(&lightPosF3);
-    XMMATRIX lightView = XMMatrixLookAtLH(lightPos, target, up);
-    XMMATRIX lightProj = XMMatrixOrthographicLH(25.0f, 25.0f, 0.1f, 50.0f); // Wider light ortho
-    XMMATRIX lightVP = lightView * lightProj;
-    frameData.LightViewProj = XMMatrixTranspose(lightVP);
-
-    memcpy(m_frameCBMapped, &frameData, sizeof(FrameCB));
-
-    FrameCB lightData = frameData;
-    lightData.CameraPos = lightPosF3; 
-    lightData.ViewProj = frameData.LightViewProj; // For OSM Pass
-    
-    memcpy(m_lightFrameCBMapped, &lightData, sizeof(FrameCB));
+    // Animated meshes are skinned straight into the next ring slot. Alternating slots means a
+    // frame never overwrites vertices an earlier one may still read.
+    float* skinnedVertices = nullptr;
+    if (m_skinnedVertexRing) {
+        m_skinnedRingSlot = (m_skinnedRingSlot + 1) % SwapChainBufferCount;
+        UINT64 slotOffset = (UINT64)m_skinnedRingSlot * m_vertexBufferView.SizeInBytes;
+        skinnedVertices = reinterpret_cast<float*>(m_skinnedVertexRingMapped + slotOffset);
+        m_vertexBufferView.BufferLocation = m_skinnedVertexRing->GetGPUVirtualAddress() + slotOffset;
+    }
+
+    // Everything up to the constant buffer contents is platform-independent; the headless
+    // replay (PelageReplayBench) runs the same pipeline
+    m_framePipeline.Update(m_time, scene, (float)m_width / m_height, skinnedVertices);
+
+    memcpy(m_frameCBMapped, &m_framePipeline.Constants(), sizeof(FrameConstants));
+    memcpy(m_lightFrameCBMapped, &m_framePipeline.LightConstants(), sizeof(FrameConstants));
+
+    const LightCuller& lights = m_framePipeline.Lights();
+    UploadLightData(m_lightBuffer, lights.Lights().data(), lights.Lights().size() * sizeof(GpuLight));
+    UploadLightData(m_lightClusterBuffer, lights.Clusters().data(), lights.Clusters().size() * sizeof(LightCluster));
+    UploadLightData(m_lightIndexBuffer, lights.Indices().data(), lights.Indices().size() * sizeof(uint32_t));
+    WriteLightSrvs();
+}
+
+void FurRenderer::UploadLightData(LightUploadBuffer& buffer, const void* data, UINT64 byteSize) {
+    // Grown by half again so a slowly rising light count doesn't reallocate every frame. The
+    // GPU is idle between frames, so the old buffer can go at once.
+    if (!buffer.Resource || byteSize > buffer.Capacity) {
+        buffer.Capacity = std::max<UINT64>(byteSize + byteSize / 2, 4096);
+        CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(buffer.Capacity);
+        buffer.Resource.Reset();
+        ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&buffer.Resource)));
+        CD3DX12_RANGE readRange(0, 0);
+        ThrowIfFailed(buffer.Resource->Map(0, &readRange, reinterpret_cast<void**>(&buffer.Mapped)));
+    }
+    if (byteSize) memcpy(buffer.Mapped, data, byteSize);
+}
+
+void FurRenderer::WriteLightSrvs() {
+    // The ring's last frame is done unless frames ever overlap; the fence is the frame's own,
+    // signalled by the FlushCommandQueue that ends Render
+    WaitForFence(m_descriptors.BeginFrame(m_currentFence + 1));
+    m_lightSrvs = m_descriptors.AllocateTransient(3);
+    if (m_lightSrvs == UINT32_MAX) throw std::runtime_error("Descriptor ring full");
+
+    const LightUploadBuffer* buffers[] = { &m_lightBuffer, &m_lightClusterBuffer, &m_lightIndexBuffer };
+    const UINT strides[] = { sizeof(GpuLight), sizeof(LightCluster), sizeof(uint32_t) };
+    for (UINT i = 0; i < 3; i++) {
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+        srvDesc.Buffer.NumElements = (UINT)(buffers[i]->Capacity / strides[i]);
+        srvDesc.Buffer.StructureByteStride = strides[i];
+        CD3DX12_CPU_DESCRIPTOR_HANDLE descriptor(m_cbvSrvUavHeap->GetCPUDescriptorHandleForHeapStart(), m_lightSrvs + i, m_cbvSrvUavDescriptorSize);
+        m_device->CreateShaderResourceView(buffers[i]->Resource.Get(), &srvDesc, descriptor);
+    }
+}
+
+void FurRenderer::PlayScript(const FrameScript& script) {
+    m_script = script;
+    m_time = 0.0f;
+    m_framePipeline.SetLights(script.Lights);
+}
+
+void FurRenderer::RecordTo(const std::string& path) {
+    m_recordPath = path;
+    m_recording = FrameScript();
+    m_recording.Aspect = (float)m_width / m_height;
+}
+
+void FurRenderer::UseSyntheticScene(const SynthScene& scene) {
+    m_syntheticScene = scene;
 }
 
 void FurRenderer::Render() {
     HRESULT hr = m_commandAllocator->Reset();
     hr = m_commandList->Reset(m_commandAllocator.Get(), nullptr);
+    m_frameDrawCalls = 0;
+    m_frameMaterialSwitches = 0;
 
-    // ==========================================
-    // Pass 1: OSM Shadows
-    // ==========================================
-    D3D12_RESOURCE_BARRIER osmBarriers[4];
-    for(int i = 0; i < 4; i++) {
-        osmBarriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(
-            m_osmTextures[i].Get(),
-            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-            D3D12_RESOURCE_STATE_RENDER_TARGET);
+    // Passes only declare what they read and write; the graph derives every barrier from that.
+    // The OSM targets are imported because their content is cached across frames.
+    const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+    const float clearDepth[] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    const float clearZero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    m_fullResFurFrame = m_furResolution == FurResolution::Full || (m_furResolution == FurResolution::Compare && m_statsFrameCount % 2 == 1);
+
+    RenderGraph graph;
+    RgResource osmDepth = graph.ImportTexture("OsmDepth", RgStatePixelShaderResource, RgStatePixelShaderResource);
+    RgResource osmLayers = graph.ImportTexture("OsmLayers", RgStatePixelShaderResource, RgStatePixelShaderResource);
+    RgResource backBuffer = graph.ImportTexture("BackBuffer", RgStatePresent, RgStatePresent);
+    RgResource sceneColor = graph.CreateTexture("SceneColor", MakeTransientDesc(DXGI_FORMAT_R8G8B8A8_UNORM, false, clearColor));
+    RgResource sceneDepth = graph.CreateTexture("SceneDepth", MakeTransientDesc(DXGI_FORMAT_D32_FLOAT, true, clearDepth));
+    // Premultiplied fur with coverage in A, over nothing
+    RgResource furColor = graph.CreateTexture("FurColor", MakeTransientDesc(DXGI_FORMAT_R8G8B8A8_UNORM, false, clearZero, 2));
+    RgResource furDepth = graph.CreateTexture("FurDepth", MakeTransientDesc(DXGI_FORMAT_D32_FLOAT, true, clearDepth, 2));
+
+    std::vector<ID3D12Resource*> physical(graph.ResourceCount(), nullptr);
+    std::vector<UINT> viewSlots(graph.ResourceCount(), 0);
+    viewSlots[sceneColor] = RtvSceneColor;
+    viewSlots[sceneDepth] = DsvSceneDepth;
+    viewSlots[furColor] = RtvFurColor;
+    viewSlots[furDepth] = DsvFurDepth;
+
+    // The scheduler decided in Update whether the cached OSM is reused or which bands are redrawn
+    if (m_framePipeline.Osm().RendersAnything()) {
+        OsmTileRect tiles = m_framePipeline.OsmTiles();
+        D3D12_RECT osmScissor = { (LONG)tiles.Left, (LONG)tiles.Top, (LONG)tiles.Right, (LONG)tiles.Bottom };
+
+        // ==========================================
+        // Pass 1a: Deep OSM depth pre-pass (first light hit per texel)
+        // ==========================================
+        RgPass osmDepthPass = graph.AddPass("OsmDepth", [=, this]() {
+            m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerOsm * 2);
+
+            CD3DX12_CPU_DESCRIPTOR_HANDLE osmDsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(), DsvOsm, m_dsvDescriptorSize);
+            m_commandList->ClearDepthStencilView(osmDsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 1, &osmScissor);
+            m_commandList->OMSetRenderTargets(0, nullptr, FALSE, &osmDsvHandle);
+
+            D3D12_VIEWPORT osmViewport = { 0.0f, 0.0f, (float)OsmResolution, (float)OsmResolution, 0.0f, 1.0f };
+            m_commandList->RSSetViewports(1, &osmViewport);
+            m_commandList->RSSetScissorRects(1, &osmScissor);
+
+            m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            const D3D12_VERTEX_BUFFER_VIEW vertexStreams[] = { m_vertexBufferView, m_occlusionBufferView, m_tangentBufferView };
+            m_commandList->IASetVertexBuffers(0, _countof(vertexStreams), vertexStreams);
+            m_commandList->IASetIndexBuffer(&m_indexBufferView);
+
+            m_commandList->SetPipelineState(m_osmDepthPSO.Get());
+
+            m_commandList->SetGraphicsRootConstantBufferView(0, m_lightFrameCB->GetGPUVirtualAddress());
+
+            DrawCoatRanges(m_framePipeline.OsmDrawRanges());
+        });
+        graph.Write(osmDepthPass, osmDepth, RgStateDepthWrite);
+
+        // ==========================================
+        // Pass 1b: Deep OSM opacity layers
+        // ==========================================
+        RgPass osmLayerPass = graph.AddPass("OsmLayers", [=, this]() {
+            CD3DX12_CPU_DESCRIPTOR_HANDLE osmRtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), RtvOsm, m_rtvDescriptorSize);
+
+            m_commandList->ClearRenderTargetView(osmRtvHandle, clearZero, 1, &osmScissor);
+            m_commandList->OMSetRenderTargets(1, &osmRtvHandle, FALSE, nullptr);
+
+            m_commandList->SetPipelineState(m_osmPSO.Get());
+            DrawCoatRanges(m_framePipeline.OsmDrawRanges());
+
+            m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerOsm * 2 + 1);
+        });
+        graph.Read(osmLayerPass, osmDepth, RgStatePixelShaderResource);
+        graph.Write(osmLayerPass, osmLayers, RgStateRenderTarget);
+    } else {
+        // Cached OSM: keep the timer pair valid, at zero cost
+        m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerOsm * 2);
+        m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerOsm * 2 + 1);
     }
-    m_commandList->ResourceBarrier(4, osmBarriers);
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE osmRtvHandle(
-        m_rtvHeap->GetCPUDescriptorHandleForHeapStart(),
-        SwapChainBufferCount + 1, m_rtvDescriptorSize);
+    // ==========================================
+    // Pass 2: Skin (MSAA target), writes the depth the fur is tested against
+    // ==========================================
+    const D3D12_CPU_DESCRIPTOR_HANDLE rtvStart = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
+    const D3D12_CPU_DESCRIPTOR_HANDLE dsvStart = m_dsvHeap->GetCPUDescriptorHandleForHeapStart();
+    CD3DX12_CPU_DESCRIPTOR_HANDLE msaaRtvHandle(rtvStart, RtvSceneColor, m_rtvDescriptorSize);
+    CD3DX12_CPU_DESCRIPTOR_HANDLE depthDsvHandle(dsvStart, DsvSceneDepth, m_dsvDescriptorSize);
+    CD3DX12_CPU_DESCRIPTOR_HANDLE depthReadOnlyDsvHandle(dsvStart, DsvSceneDepth + 1, m_dsvDescriptorSize);
+    CD3DX12_CPU_DESCRIPTOR_HANDLE furRtvHandle(rtvStart, RtvFurColor, m_rtvDescriptorSize);
+    CD3DX12_CPU_DESCRIPTOR_HANDLE furDsvHandle(dsvStart, DsvFurDepth, m_dsvDescriptorSize);
+    CD3DX12_CPU_DESCRIPTOR_HANDLE furReadOnlyDsvHandle(dsvStart, DsvFurDepth + 1, m_dsvDescriptorSize);
+    CD3DX12_CPU_DESCRIPTOR_HANDLE backBufferRtvHandle(rtvStart, m_currentBackBuffer, m_rtvDescriptorSize);
+
+    // Texel centres of the half-resolution targets sit on full resolution pixel corners: the
+    // viewport is exactly half, even at odd sizes, and the scissor rounds up
+    const D3D12_VIEWPORT halfViewport = { 0.0f, 0.0f, m_width * 0.5f, m_height * 0.5f, 0.0f, 1.0f };
+    const D3D12_RECT halfScissor = { 0, 0, (LONG)((m_width + 1) / 2), (LONG)((m_height + 1) / 2) };
+
+    RgPass skinPass = graph.AddPass("Skin", [=, this]() {
+        m_commandList->OMSetRenderTargets(1, &msaaRtvHandle, FALSE, &depthDsvHandle);
+
+        // Both targets may share memory with other transients: clearing is what initializes them
+        m_commandList->ClearRenderTargetView(msaaRtvHandle, clearColor, 0, nullptr);
+        m_commandList->ClearDepthStencilView(depthDsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+        m_commandList->RSSetViewports(1, &m_viewport);
+        m_commandList->RSSetScissorRects(1, &m_scissorRect);
+
+        m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        const D3D12_VERTEX_BUFFER_VIEW vertexStreams[] = { m_vertexBufferView, m_occlusionBufferView, m_tangentBufferView };
+        m_commandList->IASetVertexBuffers(0, _countof(vertexStreams), vertexStreams);
+        m_commandList->IASetIndexBuffer(&m_indexBufferView);
+
+        m_commandList->SetGraphicsRootConstantBufferView(0, m_frameCB->GetGPUVirtualAddress());
+
+        // Front to back so early-Z rejects the hidden parts. Its depth then rejects the
+        // fins and shells behind the body before they run their pixel shader.
+        m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerSkin * 2);
+        m_commandList->SetPipelineState(m_opaquePSO.Get());
+        DrawClusterRanges(m_framePipeline.SkinDrawRanges(), 3, 1);
+        m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerSkin * 2 + 1);
+    });
+    graph.Write(skinPass, sceneColor, RgStateRenderTarget);
+    graph.Write(skinPass, sceneDepth, RgStateDepthWrite);
 
-    D3D12_CPU_DESCRIPTOR_HANDLE osmRtvs[4];
-    for(int i = 0; i < 4; i++) {
-        osmRtvs[i] = osmRtvHandle;
-        const float clearZero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-        m_commandList->ClearRenderTargetView(osmRtvHandle, clearZero, 0, nullptr);
-        osmRtvHandle.Offset(1, m_rtvDescriptorSize);
+    // ==========================================
+    // Pass 2b: The half-resolution fur's depth, the nearest of each 2x2 block of the skin's
+    // ==========================================
+    if (!m_fullResFurFrame) {
+        RgPass furDepthPass = graph.AddPass("FurDepth", [=, this]() {
+            m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerFurDepth * 2);
+            m_commandList->OMSetRenderTargets(0, nullptr, FALSE, &furDsvHandle);
+            m_commandList->ClearDepthStencilView(furDsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+            m_commandList->RSSetViewports(1, &halfViewport);
+            m_commandList->RSSetScissorRects(1, &halfScissor);
+            m_commandList->SetPipelineState(m_furDepthPSO.Get());
+            m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            m_commandList->DrawInstanced(3, 1, 0, 0);
+            m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerFurDepth * 2 + 1);
+        });
+        graph.Read(furDepthPass, sceneDepth, RgStatePixelShaderResource);
+        graph.Write(furDepthPass, furDepth, RgStateDepthWrite);
+    } else {
+        m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerFurDepth * 2);
+        m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerFurDepth * 2 + 1);
     }
 
-    m_commandList->OMSetRenderTargets(4, osmRtvs, FALSE, nullptr);
-    
-    D3D12_VIEWPORT osmViewport = { 0.0f, 0.0f, 1024.0f, 1024.0f, 0.0f, 1.0f };
-    D3D12_RECT osmScissor = { 0, 0, 1024, 1024 };
-    m_commandList->RSSetViewports(1, &osmViewport);
-    m_commandList->RSSetScissorRects(1, &osmScissor);
-
-    m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-    m_commandList->IASetIndexBuffer(&m_indexBufferView);
-
-    m_commandList->SetPipelineState(m_osmPSO.Get());
-    m_commandList->SetGraphicsRootSignature(m_commonRootSignature.Get());
-
-    ID3D12DescriptorHeap* descriptorHeaps[] = { m_cbvSrvUavHeap.Get() };
-    m_commandList->SetDescriptorHeaps(1, descriptorHeaps);
+    // ==========================================
+    // Pass 3: Fins and shells, depth-tested with a read-only DSV: at half resolution into the fur
+    // target, or at full resolution straight over the skin
+    // ==========================================
+    const bool fullResFur = m_fullResFurFrame;
+    RgPass furPass = graph.AddPass("Fur", [=, this]() {
+        if (fullResFur) {
+            m_commandList->OMSetRenderTargets(1, &msaaRtvHandle, FALSE, &depthReadOnlyDsvHandle);
+        } else {
+            m_commandList->OMSetRenderTargets(1, &furRtvHandle, FALSE, &furReadOnlyDsvHandle);
+            m_commandList->ClearRenderTargetView(furRtvHandle, clearZero, 0, nullptr);
+            m_commandList->RSSetViewports(1, &halfViewport);
+            m_commandList->RSSetScissorRects(1, &halfScissor);
+        }
 
-    m_commandList->SetGraphicsRootConstantBufferView(0, m_lightFrameCB->GetGPUVirtualAddress());
-    m_commandList->SetGraphicsRootConstantBufferView(1, m_furCB->GetGPUVirtualAddress());
-    m_commandList->SetGraphicsRootDescriptorTable(2, m_cbvSrvUavHeap->GetGPUDescriptorHandleForHeapStart());
-    
-    m_commandList->DrawIndexedInstanced(m_indexCount, 32, 0, 0, 0);
+        m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerMain * 2);
+        m_commandList->BeginQuery(m_pipelineStatsHeap.Get(), D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
+
+        // Distance LOD: shells and fins up close, impostor layers far away, dithered between
+        const float impostorBlend = m_framePipeline.Constants().ImpostorBlend;
+        if (impostorBlend < 1.0f) {
+            // Fins and shells don't write depth, so between clusters draw order is what layers them:
+            // back to front, the reverse of the skin order
+            m_commandList->SetPipelineState(m_finPSO.Get());
+            m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ);
+            m_commandList->IASetIndexBuffer(&m_indexBufferAdjView);
+            DrawClusterRanges(m_framePipeline.DrawRanges(), 6, 1);
+
+            // Shells, only the clusters that survived culling: every layer of a material's coat in one draw
+            m_commandList->SetPipelineState(m_shellPSO.Get());
+            m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            m_commandList->IASetIndexBuffer(&m_indexBufferView);
+            DrawCoatRanges(m_framePipeline.DrawRanges());
+        }
+        if (impostorBlend > 0.0f) {
+            m_commandList->SetPipelineState(m_impostorPSO.Get());
+            m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            m_commandList->IASetIndexBuffer(&m_indexBufferView);
+            DrawClusterRanges(m_framePipeline.DrawRanges(), 3, FramePipeline::ImpostorLayers);
+        }
 
-    for(int i = 0; i < 4; i++) {
-        osmBarriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(
-            m_osmTextures[i].Get(),
-            D3D12_RESOURCE_STATE_RENDER_TARGET,
-            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_commandList->EndQuery(m_pipelineStatsHeap.Get(), D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
+        m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerMain * 2 + 1);
+    });
+    graph.Read(furPass, osmLayers, RgStatePixelShaderResource);
+    graph.Read(furPass, osmDepth, RgStatePixelShaderResource);
+    if (fullResFur) {
+        graph.Read(furPass, sceneDepth, RgStateDepthRead);
+        graph.Write(furPass, sceneColor, RgStateRenderTarget);
+    } else {
+        graph.Read(furPass, furDepth, RgStateDepthRead);
+        graph.Write(furPass, furColor, RgStateRenderTarget);
     }
-    m_commandList->ResourceBarrier(4, osmBarriers);
 
     // ==========================================
-    // Pass 2: Main Render (MSAA Target)
+    // Pass 4: Resolve to the back buffer; the graph returns it to PRESENT afterwards. With the fur
+    // at half resolution, the resolve puts it over the skin (resolve_ps).
     // ==========================================
-    CD3DX12_RESOURCE_BARRIER transitionToRT = CD3DX12_RESOURCE_BARRIER::Transition(
-        m_msaaRenderTarget.Get(),
-        D3D12_RESOURCE_STATE_RESOLVE_SOURCE,
-        D3D12_RESOURCE_STATE_RENDER_TARGET);
-    m_commandList->ResourceBarrier(1, &transitionToRT);
-
-    CD3DX12_CPU_DESCRIPTOR_HANDLE msaaRtvHandle(
-        m_rtvHeap->GetCPUDescriptorHandleForHeapStart(),
-        SwapChainBufferCount, m_rtvDescriptorSize);
+    if (fullResFur) {
+        RgPass resolvePass = graph.AddPass("Resolve", [&]() {
+            m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerResolve * 2);
+            m_commandList->ResolveSubresource(
+                physical[backBuffer], 0,
+                physical[sceneColor], 0,
+                DXGI_FORMAT_R8G8B8A8_UNORM);
+            m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerResolve * 2 + 1);
+        });
+        graph.Read(resolvePass, sceneColor, RgStateResolveSource);
+        graph.Write(resolvePass, backBuffer, RgStateResolveDest);
+    } else {
+        RgPass resolvePass = graph.AddPass("Resolve", [=, this]() {
+            m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerResolve * 2);
+            m_commandList->OMSetRenderTargets(1, &backBufferRtvHandle, FALSE, nullptr);
+            m_commandList->RSSetViewports(1, &m_viewport);
+            m_commandList->RSSetScissorRects(1, &m_scissorRect);
+            m_commandList->SetPipelineState(m_resolvePSO.Get());
+            m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            m_commandList->DrawInstanced(3, 1, 0, 0);
+            m_commandList->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GpuTimerResolve * 2 + 1);
+        });
+        graph.Read(resolvePass, sceneColor, RgStatePixelShaderResource);
+        graph.Read(resolvePass, sceneDepth, RgStatePixelShaderResource);
+        graph.Read(resolvePass, furColor, RgStatePixelShaderResource);
+        graph.Read(resolvePass, furDepth, RgStatePixelShaderResource);
+        graph.Write(resolvePass, backBuffer, RgStateRenderTarget);
+    }
 
-    m_commandList->OMSetRenderTargets(1, &msaaRtvHandle, FALSE, nullptr);
+    graph.Compile();
+    m_renderGraphStats = graph.Stats();
+
+    physical[osmDepth] = m_osmDepth.Get();
+    physical[osmLayers] = m_osmTexture.Get();
+    physical[backBuffer] = m_swapChainBuffer[m_currentBackBuffer].Get();
+    RealizeTransients(graph, physical, viewSlots);
+
+    // The transients' views for the resolve step, rewritten every frame since a new layout
+    // replaces the resources. The frame's ring was begun in Update.
+    const uint32_t transientSrvs = m_descriptors.AllocateTransient(4);
+    if (transientSrvs == UINT32_MAX) throw std::runtime_error("Descriptor ring full");
+    const RgResource srvResources[] = { sceneColor, sceneDepth, furColor, furDepth };
+    for (UINT i = 0; i < 4; i++) {
+        if (!physical[srvResources[i]]) continue; // Not used on full resolution frames
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Format = graph.Desc(srvResources[i]).DepthStencil ? DXGI_FORMAT_R32_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DMS;
+        CD3DX12_CPU_DESCRIPTOR_HANDLE descriptor(m_cbvSrvUavHeap->GetCPUDescriptorHandleForHeapStart(), transientSrvs + i, m_cbvSrvUavDescriptorSize);
+        m_device->CreateShaderResourceView(physical[srvResources[i]], &srvDesc, descriptor);
+    }
 
-    const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-    m_commandList->ClearRenderTargetView(msaaRtvHandle, clearColor, 0, nullptr);
+    // Bindless: the whole heap and where this frame's views are in it, for every pass. Passes
+    // only switch the frame constants; draws only the material index. Recorded here, once the
+    // transients are placed, but ahead of every pass.
+    m_commandList->SetGraphicsRootSignature(m_commonRootSignature.Get());
 
-    m_commandList->RSSetViewports(1, &m_viewport);
-    m_commandList->RSSetScissorRects(1, &m_scissorRect);
-    
-    m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-    m_commandList->IASetIndexBuffer(&m_indexBufferView);
+    ID3D12DescriptorHeap* descriptorHeaps[] = { m_cbvSrvUavHeap.Get() };
+    m_commandList->SetDescriptorHeaps(1, descriptorHeaps);
 
-    m_commandList->SetGraphicsRootConstantBufferView(0, m_frameCB->GetGPUVirtualAddress());
-    m_commandList->SetGraphicsRootConstantBufferView(1, m_furCB->GetGPUVirtualAddress());
+    const BindlessConstants bindless = { m_noiseSrv.Index, m_osmSrv.Index, m_osmDepthSrv.Index, m_furVolumeSrv.Index,
+                                         m_groomMapSrv.Index, m_lightSrvs, m_lightSrvs + 1, m_lightSrvs + 2,
+                                         transientSrvs, transientSrvs + 1, transientSrvs + 2, transientSrvs + 3 };
+    m_commandList->SetGraphicsRootShaderResourceView(1, m_furMaterials->GetGPUVirtualAddress());
     m_commandList->SetGraphicsRootDescriptorTable(2, m_cbvSrvUavHeap->GetGPUDescriptorHandleForHeapStart());
-    
-    // Bind OSM SRVs at offset 1 from the heap start
-    CD3DX12_GPU_DESCRIPTOR_HANDLE osmSrvHandle(m_cbvSrvUavHeap->GetGPUDescriptorHandleForHeapStart());
-    osmSrvHandle.Offset(1, m_cbvSrvUavDescriptorSize);
-    m_commandList->SetGraphicsRootDescriptorTable(3, osmSrvHandle);
-
-    // Fins
-    m_commandList->SetPipelineState(m_finPSO.Get());
-    m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ);
-    m_commandList->IASetIndexBuffer(&m_indexBufferAdjView);
-    m_commandList->DrawIndexedInstanced(m_indexCountAdj, 1, 0, 0, 0);
-
-    // Shells
-    m_commandList->SetPipelineState(m_shellPSO.Get());
-    m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    m_commandList->IASetIndexBuffer(&m_indexBufferView);
-    m_commandList->DrawIndexedInstanced(m_indexCount, 32, 0, 0, 0);
+    m_commandList->SetGraphicsRoot32BitConstants(3, sizeof(bindless) / sizeof(uint32_t), &bindless, 0);
 
-    // ==========================================
-    // Pass 3: Resolve & Present
-    // ==========================================
-    D3D12_RESOURCE_BARRIER resolveBarriers[2];
-    resolveBarriers[0] = CD3DX12_RESOURCE_BARRIER::Transition(
-        m_msaaRenderTarget.Get(),
-        D3D12_RESOURCE_STATE_RENDER_TARGET,
-        D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
-    resolveBarriers[1] = CD3DX12_RESOURCE_BARRIER::Transition(
-        m_swapChainBuffer[m_currentBackBuffer].Get(),
-        D3D12_RESOURCE_STATE_PRESENT,
-        D3D12_RESOURCE_STATE_RESOLVE_DEST);
-    m_commandList->ResourceBarrier(2, resolveBarriers);
-
-    m_commandList->ResolveSubresource(
-        m_swapChainBuffer[m_currentBackBuffer].Get(), 0,
-        m_msaaRenderTarget.Get(), 0,
-        DXGI_FORMAT_R8G8B8A8_UNORM);
-
-    CD3DX12_RESOURCE_BARRIER presentBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-        m_swapChainBuffer[m_currentBackBuffer].Get(),
-        D3D12_RESOURCE_STATE_RESOLVE_DEST,
-        D3D12_RESOURCE_STATE_PRESENT);
-    m_commandList->ResourceBarrier(1, &presentBarrier);
+    graph.Execute([&](const std::vector<RgBarrier>& barriers) { SubmitBarriers(barriers, physical); });
+
+    m_commandList->ResolveQueryData(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 0, GpuTimerCount * 2, m_timestampReadback.Get(), 0);
+    m_commandList->ResolveQueryData(m_pipelineStatsHeap.Get(), D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0, 1, m_pipelineStatsReadback.Get(), 0);
 
     hr = m_commandList->Close();
     ID3D12CommandList* cmdsLists[] = { m_commandList.Get() };
@@ -217,9 +432,131 @@ void FurRenderer::Render() {
     ThrowIfFailed(m_swapChain->Present(1, 0));
     FlushCommandQueue();
 
+    ReadGpuTimers();
+    ReportFrameStats();
+
     m_currentBackBuffer = (m_currentBackBuffer + 1) % SwapChainBufferCount;
 }
 
+RgTextureDesc FurRenderer::MakeTransientDesc(DXGI_FORMAT format, bool depthStencil, const float clearValue[4], uint32_t downscale) const {
+    RgTextureDesc desc;
+    desc.Width = (m_width + downscale - 1) / downscale;
+    desc.Height = (m_height + downscale - 1) / downscale;
+    desc.Format = (uint32_t)format;
+    desc.SampleCount = 4;
+    desc.DepthStencil = depthStencil;
+    for (int i = 0; i < 4; i++) desc.ClearValue[i] = clearValue[i];
+
+    D3D12_RESOURCE_DESC d3dDesc = ToResourceDesc(desc);
+    D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &d3dDesc);
+    desc.SizeInBytes = info.SizeInBytes;
+    desc.Alignment = info.Alignment;
+    return desc;
+}
+
+void FurRenderer::RealizeTransients(const RenderGraph& graph, std::vector<ID3D12Resource*>& physical, const std::vector<UINT>& viewSlots) {
+    // Called between frames with the GPU idle (every frame ends in FlushCommandQueue), so
+    // replacing the heap or a placed resource needs no further synchronization
+    if (!m_transientHeap || graph.HeapSize() > m_transientHeapSize) {
+        m_transientTextures.clear();
+        m_transientHeap.Reset();
+
+        D3D12_HEAP_DESC heapDesc = {};
+        heapDesc.SizeInBytes = graph.HeapSize();
+        heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+        heapDesc.Alignment = graph.HeapAlignment();
+        heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+        ThrowIfFailed(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_transientHeap)));
+        m_transientHeapSize = graph.HeapSize();
+    }
+
+    for (RgResource r = 0; r < graph.ResourceCount(); r++) {
+        if (!graph.IsTransient(r) || !graph.IsUsed(r)) continue;
+
+        auto it = std::find_if(m_transientTextures.begin(), m_transientTextures.end(),
+            [&](const TransientTexture& t) { return t.Name == graph.Name(r); });
+        if (it != m_transientTextures.end() && it->HeapOffset == graph.HeapOffset(r)) {
+            physical[r] = it->Resource.Get();
+            continue;
+        }
+
+        const RgTextureDesc& desc = graph.Desc(r);
+        D3D12_RESOURCE_DESC d3dDesc = ToResourceDesc(desc);
+        D3D12_CLEAR_VALUE clearValue = {};
+        clearValue.Format = (DXGI_FORMAT)desc.Format;
+        if (desc.DepthStencil) {
+            clearValue.DepthStencil.Depth = desc.ClearValue[0];
+        } else {
+            for (int i = 0; i < 4; i++) clearValue.Color[i] = desc.ClearValue[i];
+        }
+
+        // The graph hands every transient back in the state of its first use at frame end
+        TransientTexture texture;
+        texture.Name = graph.Name(r);
+        texture.HeapOffset = graph.HeapOffset(r);
+        ThrowIfFailed(m_device->CreatePlacedResource(
+            m_transientHeap.Get(),
+            texture.HeapOffset,
+            &d3dDesc,
+            (D3D12_RESOURCE_STATES)graph.InitialState(r),
+            &clearValue,
+            IID_PPV_ARGS(&texture.Resource)));
+
+        // Fixed view slots: an RTV, or a DSV and its read-only twin
+        if (desc.DepthStencil) {
+            D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+            dsvDesc.Format = DXGI_FORMAT_D32_FLOAT; // The resource is typeless (ToResourceDesc)
+            dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DMS;
+            CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(), viewSlots[r], m_dsvDescriptorSize);
+            m_device->CreateDepthStencilView(texture.Resource.Get(), &dsvDesc, dsvHandle);
+
+            dsvDesc.Flags = D3D12_DSV_FLAG_READ_ONLY_DEPTH;
+            dsvHandle.Offset(1, m_dsvDescriptorSize);
+            m_device->CreateDepthStencilView(texture.Resource.Get(), &dsvDesc, dsvHandle);
+        } else {
+            CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), viewSlots[r], m_rtvDescriptorSize);
+            m_device->CreateRenderTargetView(texture.Resource.Get(), nullptr, rtvHandle);
+        }
+
+        physical[r] = texture.Resource.Get();
+        if (it != m_transientTextures.end()) {
+            *it = texture;
+        } else {
+            m_transientTextures.push_back(texture);
+        }
+    }
+}
+
+void FurRenderer::SubmitBarriers(const std::vector<RgBarrier>& barriers, const std::vector<ID3D12Resource*>& physical) {
+    std::vector<D3D12_RESOURCE_BARRIER> d3dBarriers;
+    d3dBarriers.reserve(barriers.size());
+    for (const RgBarrier& barrier : barriers) {
+        switch (barrier.Type) {
+        case RgBarrierType::Transition: {
+            D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+            if (barrier.Split == RgBarrierSplit::Begin) flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+            if (barrier.Split == RgBarrierSplit::End) flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+            d3dBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+                physical[barrier.Resource],
+                (D3D12_RESOURCE_STATES)barrier.StateBefore,
+                (D3D12_RESOURCE_STATES)barrier.StateAfter,
+                D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+                flags));
+            break;
+        }
+        case RgBarrierType::Aliasing:
+            d3dBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(
+                barrier.AliasBefore != RgInvalidResource ? physical[barrier.AliasBefore] : nullptr,
+                physical[barrier.Resource]));
+            break;
+        case RgBarrierType::Uav:
+            d3dBarriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(physical[barrier.Resource]));
+            break;
+        }
+    }
+    m_commandList->ResourceBarrier((UINT)d3dBarriers.size(), d3dBarriers.data());
+}
+
 void FurRenderer::Resize(uint32_t width, uint32_t height) {
     // Left unimplemented for now
 }
@@ -264,6 +601,11 @@ void FurRenderer::CreateCommandObjects() {
 
     // Close in case we don't use it right away
     m_commandList->Close();
+
+    ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_uploadAllocator)));
+    ThrowIfFailed(m_device->CreateCommandList(
+        0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_uploadAllocator.Get(), nullptr, IID_PPV_ARGS(&m_uploadList)));
+    m_uploadList->Close();
 }
 
 void FurRenderer::CreateSwapChain() {
@@ -288,7 +630,7 @@ void FurRenderer::CreateSwapChain() {
 
 void FurRenderer::CreateRtvAndDsvDescriptorHeaps() {
     D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc;
-    rtvHeapDesc.NumDescriptors = SwapChainBufferCount + 1 + 4; // +1 for MSAA Render Target, +4 for OSM
+    rtvHeapDesc.NumDescriptors = RtvCount; // Swap chain, MSAA scene colour, packed OSM, half-resolution fur
     rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
     rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
     rtvHeapDesc.NodeMask = 0;
@@ -301,59 +643,66 @@ void FurRenderer::CreateRtvAndDsvDescriptorHeaps() {
         rtvHandle.Offset(1, m_rtvDescriptorSize);
     }
 
-    // Create MSAA Render Target
-    D3D12_RESOURCE_DESC msaaRTDesc = CD3DX12_RESOURCE_DESC::Tex2D(
-        DXGI_FORMAT_R8G8B8A8_UNORM, m_width, m_height, 1, 1, 4, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
-    
-    D3D12_CLEAR_VALUE msaaClear;
-    msaaClear.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    msaaClear.Color[0] = 0.0f;
-    msaaClear.Color[1] = 0.2f;
-    msaaClear.Color[2] = 0.4f;
-    msaaClear.Color[3] = 1.0f;
-    
-    CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
-    ThrowIfFailed(m_device->CreateCommittedResource(
-        &heapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &msaaRTDesc,
-        D3D12_RESOURCE_STATE_RESOLVE_SOURCE, // Start in resolve source so first frame transition works
-        &msaaClear,
-        IID_PPV_ARGS(&m_msaaRenderTarget)));
-        
-    m_device->CreateRenderTargetView(m_msaaRenderTarget.Get(), nullptr, rtvHandle);
+    // The MSAA scene colour and depth and the half-resolution fur targets are render graph
+    // transients, placed in a shared heap by RealizeTransients. Their views go in the slots
+    // reserved here.
     rtvHandle.Offset(1, m_rtvDescriptorSize);
 
-    // Create OSM Render Targets
+    CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
+
+    // Create OSM Render Target: every deep opacity layer packed into one RGBA channel
     D3D12_RESOURCE_DESC osmRTDesc = CD3DX12_RESOURCE_DESC::Tex2D(
-        DXGI_FORMAT_R8_UNORM, 1024, 1024, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
-    
+        DXGI_FORMAT_R8G8B8A8_UNORM, OsmResolution, OsmResolution, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+
     D3D12_CLEAR_VALUE osmClear;
-    osmClear.Format = DXGI_FORMAT_R8_UNORM;
+    osmClear.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
     osmClear.Color[0] = 0.0f;
     osmClear.Color[1] = 0.0f;
     osmClear.Color[2] = 0.0f;
     osmClear.Color[3] = 0.0f;
 
-    for (int i = 0; i < 4; i++) {
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &heapProps,
-            D3D12_HEAP_FLAG_NONE,
-            &osmRTDesc,
-            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-            &osmClear,
-            IID_PPV_ARGS(&m_osmTextures[i])));
-
-        D3D12_RENDER_TARGET_VIEW_DESC osmRTVDesc = {};
-        osmRTVDesc.Format = DXGI_FORMAT_R8_UNORM;
-        osmRTVDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D;
-        m_device->CreateRenderTargetView(m_osmTextures[i].Get(), &osmRTVDesc, rtvHandle);
-        rtvHandle.Offset(1, m_rtvDescriptorSize);
-    }
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &heapProps,
+        D3D12_HEAP_FLAG_NONE,
+        &osmRTDesc,
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+        &osmClear,
+        IID_PPV_ARGS(&m_osmTexture)));
+
+    m_device->CreateRenderTargetView(m_osmTexture.Get(), nullptr, rtvHandle);
+    rtvHandle.Offset(1, m_rtvDescriptorSize);
+
+    // Light-space depth for the deep opacity pre-pass. Typeless so it can be both DSV and SRV.
+    D3D12_RESOURCE_DESC osmDepthDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+        DXGI_FORMAT_R32_TYPELESS, OsmResolution, OsmResolution, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+
+    D3D12_CLEAR_VALUE osmDepthClear = {};
+    osmDepthClear.Format = DXGI_FORMAT_D32_FLOAT;
+    osmDepthClear.DepthStencil.Depth = 1.0f;
+    osmDepthClear.DepthStencil.Stencil = 0;
 
-    // SRV Heap
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &heapProps,
+        D3D12_HEAP_FLAG_NONE,
+        &osmDepthDesc,
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+        &osmDepthClear,
+        IID_PPV_ARGS(&m_osmDepth)));
+
+    D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
+    dsvHeapDesc.NumDescriptors = DsvCount; // OSM depth, then scene depth and fur depth, each writable and read-only
+    dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+    dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    ThrowIfFailed(m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsvHeap)));
+
+    D3D12_DEPTH_STENCIL_VIEW_DESC osmDsvDesc = {};
+    osmDsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+    osmDsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+    m_device->CreateDepthStencilView(m_osmDepth.Get(), &osmDsvDesc, m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
+
+    // SRV Heap: the persistent slots, then the per-frame rings (DescriptorAllocator)
     D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-    srvHeapDesc.NumDescriptors = 10;
+    srvHeapDesc.NumDescriptors = m_descriptors.Capacity();
     srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
     srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
     ThrowIfFailed(m_device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_cbvSrvUavHeap)));
@@ -363,22 +712,31 @@ void FurRenderer::CreateRootSignature() {
 //... (Already done, so I will add CreateConstantBuffers right after it)
 
     // Root Parameter 0: CBV (Frame/Camera data)
-    // Root Parameter 1: CBV (Fur parameters)
-    // Root Parameter 2: Descriptor Table (1 SRV: Voronoi Noise)
-    // Root Parameter 3: Descriptor Table (4 SRVs: OSM Shadow Maps)
+    // Root Parameter 1: SRV (Fur parameters, one structured buffer entry per material)
+    // Root Parameter 2: Descriptor Table (the whole SRV heap, bindless)
+    // Root Parameter 3: Root constants (BindlessConstants: heap slots of the frame's views)
+    // Root Parameter 4: Root constant (material index, set per draw)
     // Static Sampler: Linear Wrap
     
-    CD3DX12_ROOT_PARAMETER1 rootParameters[4];
+    CD3DX12_ROOT_PARAMETER1 rootParameters[5];
     rootParameters[0].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_ALL);
-    rootParameters[1].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_ALL);
-
-    CD3DX12_DESCRIPTOR_RANGE1 rangeNoise;
-    rangeNoise.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
-    rootParameters[2].InitAsDescriptorTable(1, &rangeNoise, D3D12_SHADER_VISIBILITY_PIXEL);
-
-    CD3DX12_DESCRIPTOR_RANGE1 rangeOSM;
-    rangeOSM.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 4, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
-    rootParameters[3].InitAsDescriptorTable(1, &rangeOSM, D3D12_SHADER_VISIBILITY_PIXEL);
+    rootParameters[1].InitAsShaderResourceView(3, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_ALL);
+    rootParameters[3].InitAsConstants(sizeof(BindlessConstants) / sizeof(uint32_t), 2, 0, D3D12_SHADER_VISIBILITY_ALL);
+    rootParameters[4].InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_ALL);
+
+    // One unbounded range per resource type the shaders index the heap as, all aliasing the heap
+    // from slot 0: spaces 1-3 Texture2D of float4, float2 and float, space4 Texture2DArray of
+    // float2, spaces 5-7 the light list StructuredBuffers, spaces 8-9 Texture2DMS of float4 and
+    // float for the resolve step (BindlessCB in the shaders). Feature
+    // level 12_0 guarantees the binding tier for unbounded SRV tables. Volatile: unused slots
+    // hold no view, slots are written between frames, and the OSM targets are rendered to while
+    // the table is set.
+    const D3D12_DESCRIPTOR_RANGE_FLAGS bindlessFlags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
+    CD3DX12_DESCRIPTOR_RANGE1 rangeBindless[9];
+    for (UINT i = 0; i < _countof(rangeBindless); i++) {
+        rangeBindless[i].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1 + i, bindlessFlags, 0);
+    }
+    rootParameters[2].InitAsDescriptorTable(_countof(rangeBindless), rangeBindless, D3D12_SHADER_VISIBILITY_ALL);
 
     CD3DX12_STATIC_SAMPLER_DESC sampler(
         0, // shaderRegister
@@ -389,7 +747,7 @@ void FurRenderer::CreateRootSignature() {
     );
 
     CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSigDesc;
-    rootSigDesc.Init_1_1(4, rootParameters, 1, &sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+    rootSigDesc.Init_1_1(_countof(rootParameters), rootParameters, 1, &sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
     ComPtr<ID3DBlob> signature;
     ComPtr<ID3DBlob> error;
@@ -418,29 +776,49 @@ ComPtr<ID3DBlob> CompileShader(const std::wstring& filename, const D3D_SHADER_MA
         OutputDebugStringA((char*)errors->GetBufferPointer());
     }
 
-    ThrowIfFailed(hr);
-    return byteCode;
+    // A hot reload keeps the previous variant; the initial load fails in BuildAssets
+    return SUCCEEDED(hr) ? byteCode : nullptr;
 }
 
-void FurRenderer::CreateShadersAndPSOs() {
-    ComPtr<ID3DBlob> shellVS = CompileShader(L"shaders/shell_vs.hlsl", nullptr, "main", "vs_5_1");
-    ComPtr<ID3DBlob> shellPS = CompileShader(L"shaders/shell_ps.hlsl", nullptr, "main", "ps_5_1");
-    
-    ComPtr<ID3DBlob> finVS = CompileShader(L"shaders/fin_vs.hlsl", nullptr, "main", "vs_5_1");
-    ComPtr<ID3DBlob> finGS = CompileShader(L"shaders/fin_gs.hlsl", nullptr, "main", "gs_5_1");
-    // finPS uses shellPS
-    
-    D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-    };
+// Compiled shader variants, indexed by FurRenderer::ShaderVariant. The impostor variants are
+// the shell shaders reading the fur volume instead of clipping against the noise.
+static const struct {
+    const char* File;
+    const char* Target;
+    bool Impostor; // Compiled with FUR_IMPOSTOR
+} ShaderVariantFiles[] = {
+    { "shaders/shell_vs.hlsl", "vs_5_1", false },
+    { "shaders/shell_ps.hlsl", "ps_5_1", false },
+    { "shaders/fin_vs.hlsl",   "vs_5_1", false },
+    { "shaders/fin_gs.hlsl",   "gs_5_1", false },
+    { "shaders/skin_vs.hlsl",  "vs_5_1", false },
+    { "shaders/skin_ps.hlsl",  "ps_5_1", false },
+    { "shaders/osm_ps.hlsl",   "ps_5_1", false },
+    { "shaders/shell_vs.hlsl", "vs_5_1", true },
+    { "shaders/shell_ps.hlsl", "ps_5_1", true },
+    { "shaders/fullscreen_vs.hlsl", "vs_5_1", false },
+    { "shaders/fur_depth_ps.hlsl",  "ps_5_1", false },
+    { "shaders/resolve_ps.hlsl",    "ps_5_1", false },
+};
+
+static const D3D12_INPUT_ELEMENT_DESC FurInputLayout[] = {
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "OCCLUSION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TANGENT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 2, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+};
+
+// Every PSO is the shell one with some state changed. Returns false, keeping the current PSO, if
+// the device rejects it.
+bool FurRenderer::CreatePipelineState(PipelineKind kind) {
+    auto bytecode = [&](ShaderVariant variant) { return CD3DX12_SHADER_BYTECODE(m_shaderBytecode[variant].Get()); };
 
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-    psoDesc.InputLayout = { inputLayout, _countof(inputLayout) };
+    psoDesc.InputLayout = { FurInputLayout, _countof(FurInputLayout) };
     psoDesc.pRootSignature = m_commonRootSignature.Get();
-    psoDesc.VS = CD3DX12_SHADER_BYTECODE(shellVS.Get());
-    psoDesc.PS = CD3DX12_SHADER_BYTECODE(shellPS.Get());
+    psoDesc.VS = bytecode(ShaderShellVs);
+    psoDesc.PS = bytecode(ShaderShellPs);
     
     CD3DX12_RASTERIZER_DESC rsDesc(D3D12_DEFAULT);
     rsDesc.CullMode = D3D12_CULL_MODE_BACK;
@@ -458,55 +836,132 @@ void FurRenderer::CreateShadersAndPSOs() {
     // Enable Alpha to Coverage for Shells
     psoDesc.BlendState.AlphaToCoverageEnable = TRUE;
     
-    // DSV is missing because we haven't created a depth buffer yet, but let's assume we'll use DXGI_FORMAT_D32_FLOAT
-    // psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT; 
-
-    // For now, no depth buffer
-    psoDesc.DepthStencilState.DepthEnable = FALSE;
-
-    ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_shellPSO)));
-
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC finPsoDesc = psoDesc;
-    finPsoDesc.BlendState.AlphaToCoverageEnable = FALSE; // Fins don't need A2C, they use solid geometry
-    finPsoDesc.VS = CD3DX12_SHADER_BYTECODE(finVS.Get());
-    finPsoDesc.GS = CD3DX12_SHADER_BYTECODE(finGS.Get());
-    // Fin uses adjacency topology!
-    finPsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE; // Still triangles, just adjacency for input assembler
-
-    ThrowIfFailed(m_device->CreateGraphicsPipelineState(&finPsoDesc, IID_PPV_ARGS(&m_finPSO)));
-
-    ComPtr<ID3DBlob> osmPS = CompileShader(L"shaders/osm_ps.hlsl", nullptr, "main", "ps_5_1");
-
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC osmPsoDesc = psoDesc;
-    osmPsoDesc.SampleDesc.Count = 1; // Shadows don't need MSAA
-    osmPsoDesc.BlendState.AlphaToCoverageEnable = FALSE;
-    osmPsoDesc.PS = CD3DX12_SHADER_BYTECODE(osmPS.Get());
-    osmPsoDesc.NumRenderTargets = 4;
-    for(int i=0; i<4; i++) {
-        osmPsoDesc.RTVFormats[i] = DXGI_FORMAT_R8G8B8A8_UNORM; // Should be R8_UNORM but we reuse texture formats for simplicity in scaffolding
+    // Shells and fins test against the skin's depth but never write it: the layers are
+    // alpha-tested cut-outs and must not occlude each other
+    psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+    psoDesc.DepthStencilState.DepthEnable = TRUE;
+    psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+    psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL; // The root shell sits on the skin
+
+    ComPtr<ID3D12PipelineState>* target = nullptr;
+    switch (kind) {
+    case PipelineShell:
+        target = &m_shellPSO;
+        break;
+
+    case PipelineFin:
+        target = &m_finPSO;
+        psoDesc.BlendState.AlphaToCoverageEnable = FALSE; // Fins don't need A2C, they use solid geometry
+        psoDesc.VS = bytecode(ShaderFinVs);
+        psoDesc.GS = bytecode(ShaderFinGs);
+        // Fin uses adjacency topology!
+        psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE; // Still triangles, just adjacency for input assembler
+        break;
+
+    case PipelineImpostor: {
+        // Impostor layers for distant pelts, blended bottom layer first
+        target = &m_impostorPSO;
+        psoDesc.VS = bytecode(ShaderImpostorVs);
+        psoDesc.PS = bytecode(ShaderImpostorPs);
+        psoDesc.BlendState.AlphaToCoverageEnable = FALSE;
+        D3D12_RENDER_TARGET_BLEND_DESC& alphaBlend = psoDesc.BlendState.RenderTarget[0];
+        alphaBlend.BlendEnable = TRUE;
+        alphaBlend.SrcBlend = D3D12_BLEND_SRC_ALPHA;
+        alphaBlend.DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+        alphaBlend.BlendOp = D3D12_BLEND_OP_ADD;
+        alphaBlend.SrcBlendAlpha = D3D12_BLEND_ONE;
+        alphaBlend.DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA;
+        alphaBlend.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+        break;
     }
 
-    D3D12_RENDER_TARGET_BLEND_DESC additiveBlend = {};
-    additiveBlend.BlendEnable = TRUE;
-    additiveBlend.SrcBlend = D3D12_BLEND_ONE;
-    additiveBlend.DestBlend = D3D12_BLEND_ONE;
-    additiveBlend.BlendOp = D3D12_BLEND_OP_ADD;
-    additiveBlend.SrcBlendAlpha = D3D12_BLEND_ONE;
-    additiveBlend.DestBlendAlpha = D3D12_BLEND_ONE;
-    additiveBlend.BlendOpAlpha = D3D12_BLEND_OP_ADD;
-    additiveBlend.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+    case PipelineOpaque:
+        // Opaque skin: the only pass that writes main depth
+        target = &m_opaquePSO;
+        psoDesc.VS = bytecode(ShaderSkinVs);
+        psoDesc.PS = bytecode(ShaderSkinPs);
+        psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+        break;
+
+    case PipelineOsm: {
+        target = &m_osmPSO;
+        psoDesc.SampleDesc.Count = 1; // Shadows don't need MSAA
+        psoDesc.BlendState.AlphaToCoverageEnable = FALSE;
+        psoDesc.PS = bytecode(ShaderOsmPs);
+        psoDesc.NumRenderTargets = 1;
+        psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM; // Matches the packed OSM resource
+
+        D3D12_RENDER_TARGET_BLEND_DESC additiveBlend = {};
+        additiveBlend.BlendEnable = TRUE;
+        additiveBlend.SrcBlend = D3D12_BLEND_ONE;
+        additiveBlend.DestBlend = D3D12_BLEND_ONE;
+        additiveBlend.BlendOp = D3D12_BLEND_OP_ADD;
+        additiveBlend.SrcBlendAlpha = D3D12_BLEND_ONE;
+        additiveBlend.DestBlendAlpha = D3D12_BLEND_ONE;
+        additiveBlend.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+        additiveBlend.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+
+        psoDesc.BlendState.RenderTarget[0] = additiveBlend;
+        psoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN; // Reads the light-space depth as an SRV instead
+        psoDesc.DepthStencilState.DepthEnable = FALSE;
+        psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO; // No Z-write!
+        break;
+    }
 
-    for(int i=0; i<4; ++i) {
-        osmPsoDesc.BlendState.RenderTarget[i] = additiveBlend;
+    case PipelineOsmDepth:
+        // Depth-only pre-pass from the light. No pixel shader: the outermost shell marks where the
+        // light enters the coat, which is all the deep opacity layers need.
+        target = &m_osmDepthPSO;
+        psoDesc.SampleDesc.Count = 1;
+        psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        psoDesc.PS = {};
+        psoDesc.NumRenderTargets = 0;
+        psoDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+        psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+        psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+        break;
+
+    case PipelineFurDepth:
+        // Fullscreen over the half-resolution fur depth, writing every texel whatever was there
+        target = &m_furDepthPSO;
+        psoDesc.InputLayout = {};
+        psoDesc.VS = bytecode(ShaderFullscreenVs);
+        psoDesc.PS = bytecode(ShaderFurDepthPs);
+        psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+        psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        psoDesc.NumRenderTargets = 0;
+        psoDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+        psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+        psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+        break;
+
+    case PipelineResolve:
+        // Fullscreen into the back buffer: no MSAA, no depth
+        target = &m_resolvePSO;
+        psoDesc.InputLayout = {};
+        psoDesc.VS = bytecode(ShaderFullscreenVs);
+        psoDesc.PS = bytecode(ShaderResolvePs);
+        psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+        psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        psoDesc.SampleDesc.Count = 1;
+        psoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
+        psoDesc.DepthStencilState.DepthEnable = FALSE;
+        break;
+
+    default:
+        return false;
     }
-    osmPsoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO; // No Z-write!
 
-    ThrowIfFailed(m_device->CreateGraphicsPipelineState(&osmPsoDesc, IID_PPV_ARGS(&m_osmPSO)));
+    ComPtr<ID3D12PipelineState> pso;
+    if (FAILED(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)))) return false;
+    Retire(*target);
+    *target = pso;
+    return true;
 }
 
 void FurRenderer::CreateConstantBuffers() {
-    uint32_t frameCBSize = (sizeof(FrameCB) + 255) & ~255;
-    uint32_t furCBSize = (sizeof(FurCB) + 255) & ~255;
+    uint32_t frameCBSize = (sizeof(FrameConstants) + 255) & ~255;
 
     CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
     
@@ -527,30 +982,21 @@ void FurRenderer::CreateConstantBuffers() {
         nullptr,
         IID_PPV_ARGS(&m_lightFrameCB)));
 
-    CD3DX12_RESOURCE_DESC furCBDesc = CD3DX12_RESOURCE_DESC::Buffer(furCBSize);
-    ThrowIfFailed(m_device->CreateCommittedResource(
-        &uploadHeapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &furCBDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_furCB)));
-
     // Map them
     CD3DX12_RANGE readRange(0, 0); // No reading on CPU
     ThrowIfFailed(m_frameCB->Map(0, &readRange, reinterpret_cast<void**>(&m_frameCBMapped)));
     ThrowIfFailed(m_lightFrameCB->Map(0, &readRange, reinterpret_cast<void**>(&m_lightFrameCBMapped)));
-    ThrowIfFailed(m_furCB->Map(0, &readRange, reinterpret_cast<void**>(&m_furCBMapped)));
 
-    // Initialize Fur Parameters with recommended defaults for a Carpet
+    // Shared fur settings; per-material values replace these in UploadMaterials.
+    // The defaults are the carpet's (see FurMaterial).
+    FurMaterial defaults;
     FurCB initialFurData = {};
-    initialFurData.FurLength = 0.04f; // Short fibers
-    initialFurData.ShellCount = 48;   // High shell count for soft appearance
-    initialFurData.Density = 120.0f;  // Extremely dense
-    initialFurData.Thickness = 0.85f; // Keep tips reasonably sharp
-    initialFurData.FurColor = XMFLOAT3(0.85f, 0.82f, 0.78f); // Soft off-white/cream
-    
-    memcpy(m_furCBMapped, &initialFurData, sizeof(FurCB));
+    initialFurData.FurLength = defaults.FurLength;
+    initialFurData.ShellCount = FurCoat::ShellCount; // High shell count for soft appearance
+    initialFurData.Density = defaults.Density;
+    initialFurData.Thickness = defaults.Thickness;
+    initialFurData.FurColor = XMFLOAT3(defaults.FurColor.x, defaults.FurColor.y, defaults.FurColor.z);
+    m_furParams = initialFurData;
 }
 
 ComPtr<ID3D12Resource> CreateDefaultBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const void* initData, UINT64 byteSize, ComPtr<ID3D12Resource>& uploadBuffer) {
@@ -592,29 +1038,534 @@ ComPtr<ID3D12Resource> CreateDefaultBuffer(ID3D12Device* device, ID3D12GraphicsC
     return defaultBuffer;
 }
 
+// Content hashes of the parts of a loaded mesh, so a reload only re-uploads what changed
+template <typename T>
+static uint64_t HashVector(const std::vector<T>& items, uint64_t hash) {
+    const uint64_t count = items.size();
+    hash = HashBytes(hash, &count, sizeof(count));
+    return HashBytes(hash, items.data(), items.size() * sizeof(T));
+}
+
+static uint64_t HashGeometry(const MeshData& mesh) {
+    uint64_t hash = HashVector(mesh.Vertices, HashSeed);
+    hash = HashVector(mesh.Indices, hash);
+    hash = HashVector(mesh.IndicesAdj, hash);
+    hash = HashVector(mesh.Clusters, hash);
+    hash = HashVector(mesh.TriangleMaterials, hash);
+    hash = HashVector(mesh.Skin, hash);
+    hash = HashVector(mesh.Rig.Parents, hash);
+    hash = HashVector(mesh.Rig.InverseBind, hash);
+    hash = HashVector(mesh.Rig.RestPose, hash);
+    hash = HashBytes(hash, &mesh.Rig.RootTransform, sizeof(mesh.Rig.RootTransform));
+    for (const AnimationClip& clip : mesh.Animations) {
+        hash = HashBytes(hash, &clip.Duration, sizeof(clip.Duration));
+        for (const AnimationChannel& channel : clip.Channels) {
+            const uint32_t target[3] = { channel.Joint, (uint32_t)channel.Path, (uint32_t)channel.Interpolation };
+            hash = HashBytes(hash, target, sizeof(target));
+            hash = HashVector(channel.Times, hash);
+            hash = HashVector(channel.Values, hash);
+        }
+    }
+    return hash;
+}
+
+static uint64_t HashMaterials(const MeshData& mesh) {
+    uint64_t hash = HashSeed;
+    for (const FurMaterial& material : mesh.Materials) {
+        const float values[6] = { material.FurLength, material.Density, material.Thickness,
+                                  material.FurColor.x, material.FurColor.y, material.FurColor.z };
+        hash = HashBytes(hash, values, sizeof(values));
+        hash = HashBytes(hash, &material.ColorTexture, sizeof(material.ColorTexture));
+        hash = HashVector(material.Layers, hash);
+    }
+    for (const TextureImage& image : mesh.Textures) {
+        const uint32_t header[3] = { image.Width, image.Height, (uint32_t)image.Format };
+        hash = HashBytes(hash, header, sizeof(header));
+        hash = HashVector(image.Mips, hash);
+        hash = HashVector(image.Data, hash);
+    }
+    return hash;
+}
+
+static const char* const SceneGltfPath = "assets/fur_carpet/scene.gltf";
+
+// The files LoadScene reads: the glTF, its external buffers and images, and the groom files
+// next to it. Taken once at startup; a buffer or image added to the glTF later isn't watched.
+std::vector<std::string> FurRenderer::SceneFiles() const {
+    std::vector<std::string> files;
+    if (!m_syntheticScene.Objects.empty()) return files;
+
+    const std::string path = SceneGltfPath;
+    const std::string stem = path.substr(0, path.find_last_of('.'));
+    const std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    files = { path, stem + ".pgrm", stem + ".groom.json" };
+
+    std::ifstream file(path);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    nlohmann::json gltf = nlohmann::json::parse(contents.str(), nullptr, false);
+    if (gltf.is_discarded()) return files;
+    for (const char* section : { "buffers", "images" }) {
+        for (const auto& entry : gltf.value(section, nlohmann::json::array())) {
+            const std::string uri = entry.value("uri", std::string());
+            if (uri.empty() || uri.rfind("data:", 0) == 0) continue; // Embedded
+            if (std::find(files.begin(), files.end(), directory + uri) == files.end()) files.push_back(directory + uri);
+        }
+    }
+    return files;
+}
+
+void FurRenderer::InitAssetGraph() {
+    static_assert(_countof(ShaderVariantFiles) == ShaderVariantCount, "One file per shader variant");
+
+    // Shader files, the variants compiled from them and the PSOs using those
+    for (uint32_t v = 0; v < ShaderVariantCount; v++) {
+        const std::string file = ShaderVariantFiles[v].File;
+        AssetId source = m_assets.Find(file);
+        if (source == InvalidAsset) source = m_assets.AddSource(file, m_watcher.Watch(file));
+        m_shaderAssets[v] = m_assets.AddDerived(file + (ShaderVariantFiles[v].Impostor ? " (FUR_IMPOSTOR)" : ""), { source });
+    }
+    const std::vector<ShaderVariant> pipelineShaders[PipelineCount] = {
+        { ShaderShellVs, ShaderShellPs },
+        { ShaderFinVs, ShaderFinGs, ShaderShellPs },
+        { ShaderImpostorVs, ShaderImpostorPs },
+        { ShaderSkinVs, ShaderSkinPs },
+        { ShaderShellVs, ShaderOsmPs },
+        { ShaderShellVs },
+        { ShaderFullscreenVs, ShaderFurDepthPs },
+        { ShaderFullscreenVs, ShaderResolvePs },
+    };
+    const char* const pipelineNames[PipelineCount] = { "shell PSO", "fin PSO", "impostor PSO", "opaque PSO", "OSM PSO", "OSM depth PSO",
+                                                       "fur depth PSO", "resolve PSO" };
+    for (uint32_t p = 0; p < PipelineCount; p++) {
+        std::vector<AssetId> inputs;
+        for (ShaderVariant variant : pipelineShaders[p]) inputs.push_back(m_shaderAssets[variant]);
+        m_pipelineAssets[p] = m_assets.AddDerived(pipelineNames[p], inputs);
+    }
+
+    // The scene, loaded whole from its files (none for a generated scene), then split into parts
+    // hashed and uploaded on their own. Everything after the mesh node reads m_loadedMesh, which
+    // is only filled in a walk that rebuilt the mesh; they all descend from it.
+    std::vector<AssetId> sceneFiles;
+    for (const std::string& path : SceneFiles()) sceneFiles.push_back(m_assets.AddSource(path, m_watcher.Watch(path)));
+    m_meshAsset = m_assets.AddDerived("mesh", sceneFiles);
+    const char* const partNames[MeshPartCount] = { "geometry", "vertex streams", "materials", "groom map" };
+    for (uint32_t p = 0; p < MeshPartCount; p++) {
+        m_meshPartAssets[p] = m_assets.AddDerived(std::string("mesh ") + partNames[p], { m_meshAsset });
+        m_meshUploadAssets[p] = m_assets.AddDerived(std::string(partNames[p]) + " upload", { m_meshPartAssets[p] });
+    }
+    // Material and groom uploads report the fur length, so the BVH is only rebuilt if that moved
+    m_framePipelineAsset = m_assets.AddDerived("frame pipeline mesh", { m_meshPartAssets[MeshPartGeometry],
+        m_meshUploadAssets[MeshPartMaterials], m_meshUploadAssets[MeshPartGroom] });
+
+    AssetId noiseSettings = m_assets.AddSettings("fur noise settings", HashBytes(HashSeed, &m_noiseSettings, sizeof(m_noiseSettings)));
+    AssetId volumeSettings = m_assets.AddSettings("fur volume settings", HashBytes(HashSeed, &m_volumeSettings, sizeof(m_volumeSettings)));
+    m_noiseAsset = m_assets.AddDerived("fur noise", { noiseSettings });
+    m_volumeAsset = m_assets.AddDerived("fur volume", { m_noiseAsset, volumeSettings });
+}
+
 void FurRenderer::BuildRenderItems() {
     ThrowIfFailed(m_commandAllocator->Reset());
     ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), nullptr));
 
-    MeshData sphere = GeometryGen::LoadGLTF("assets/fur_carpet/scene.gltf");
-    
-    // Fallback if glTF fails to load
-    if (sphere.Vertices.empty()) {
-        OutputDebugStringA("Failed to load fur_carpet. Falling back to sphere.\n");
-        sphere = GeometryGen::CreateSphere(1.0f, 20, 20);
+    // Packed OSM layers and OSM first-hit depth. The noise, colour maps, fur volume and groom map
+    // views are written as their assets are built.
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MostDetailedMip = 0;
+    srvDesc.Texture2D.MipLevels = 1;
+    WriteSrv(m_osmSrv, m_osmTexture.Get(), srvDesc);
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC osmDepthSrvDesc = srvDesc;
+    osmDepthSrvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    WriteSrv(m_osmDepthSrv, m_osmDepth.Get(), osmDepthSrvDesc);
+
+    // Every asset, built once
+    InitAssetGraph();
+    std::vector<ComPtr<ID3D12Resource>> uploadBuffers;
+    BuildAssets(m_assets.Plan(), m_commandList.Get(), uploadBuffers, true);
+
+    ThrowIfFailed(m_commandList->Close());
+    ID3D12CommandList* cmdsLists[] = { m_commandList.Get() };
+    m_commandQueue->ExecuteCommandLists(1, cmdsLists);
+
+    FlushCommandQueue();
+}
+
+// Called at the start of Update, with the GPU idle or finishing the last upload: every frame
+// ends in FlushCommandQueue. The copies go on their own list ahead of the frame's, so the frame
+// draws with the new data; new views go to fresh heap slots (WriteSrv).
+void FurRenderer::HotReload(float deltaTime) {
+    ReleaseRetired();
+    m_hotReloadTimer += deltaTime;
+    if (m_hotReloadTimer < HotReloadInterval) return;
+    m_hotReloadTimer = 0.0f;
+
+    const std::vector<std::string> changed = m_watcher.Poll();
+    for (const std::string& path : changed) m_assets.SetHash(m_assets.Find(path), m_watcher.Hash(path));
+    const std::vector<AssetId> plan = m_assets.Plan();
+    if (plan.empty()) return;
+
+    const auto start = std::chrono::steady_clock::now();
+    WaitForFence(m_uploadFence);
+    ThrowIfFailed(m_uploadAllocator->Reset());
+    ThrowIfFailed(m_uploadList->Reset(m_uploadAllocator.Get(), nullptr));
+    std::vector<ComPtr<ID3D12Resource>> uploadBuffers;
+    BuildAssets(plan, m_uploadList.Get(), uploadBuffers, false);
+    ThrowIfFailed(m_uploadList->Close());
+    ID3D12CommandList* cmdsLists[] = { m_uploadList.Get() };
+    m_commandQueue->ExecuteCommandLists(1, cmdsLists);
+    for (const ComPtr<ID3D12Resource>& buffer : uploadBuffers) Retire(buffer);
+    m_uploadFence = ++m_currentFence;
+    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_uploadFence));
+
+    const AssetGraphStats& stats = m_assets.Stats();
+    char reloadInfo[192];
+    snprintf(reloadInfo, sizeof(reloadInfo), "Hot reload: %zu files changed, %u assets planned, %u rebuilt (%u unchanged), %u failed in %.1f ms\n",
+        changed.size(), stats.Planned, stats.Rebuilt, stats.Unchanged, stats.Failed,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    OutputDebugStringA(reloadInfo);
+}
+
+void FurRenderer::BuildAssets(const std::vector<AssetId>& plan, ID3D12GraphicsCommandList* list,
+                              std::vector<ComPtr<ID3D12Resource>>& uploadBuffers, bool initial) {
+    for (AssetId id : plan) {
+        if (!m_assets.NeedsBuild(id)) continue;
+        uint64_t outputHash = 0;
+        if (BuildAsset(id, list, uploadBuffers, outputHash)) {
+            m_assets.MarkBuilt(id, outputHash);
+            continue;
+        }
+        if (initial) throw std::runtime_error("Failed to build " + m_assets.Node(id).Name);
+        m_assets.MarkFailed(id);
+        OutputDebugStringA(("Hot reload: " + m_assets.Node(id).Name + " failed, keeping the previous one\n").c_str());
+    }
+    m_loadedMesh = MeshData(); // The GPU and the frame pipeline hold their own copies
+}
+
+// Open occlusion where none was baked, and tangents from the UVs unless the mesh brought its own
+static void FillVertexStreams(MeshData& mesh) {
+    if (mesh.Occlusion.size() != mesh.Vertices.size()) mesh.Occlusion.assign(mesh.Vertices.size(), VertexOcclusion());
+    if (mesh.Tangents.size() != mesh.Vertices.size()) {
+        GroomBaker::ComputeTangents(reinterpret_cast<const float*>(mesh.Vertices.data()), sizeof(Vertex) / sizeof(float),
+                                    mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size() / 3, mesh.Tangents);
     }
+}
 
-    const UINT vbByteSize = (UINT)sphere.Vertices.size() * sizeof(Vertex);
-    const UINT ibByteSize = (UINT)sphere.Indices.size() * sizeof(uint32_t);
-    const UINT ibAdjByteSize = (UINT)sphere.IndicesAdj.size() * sizeof(uint32_t);
+bool FurRenderer::BuildAsset(AssetId id, ID3D12GraphicsCommandList* list, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers,
+                             uint64_t& outputHash) {
+    // Unless the node hashes what it produced, its output is new whenever its inputs are
+    outputHash = m_assets.InputHash(id);
+
+    for (uint32_t v = 0; v < ShaderVariantCount; v++) {
+        if (id != m_shaderAssets[v]) continue;
+        const std::string file = ShaderVariantFiles[v].File;
+        const D3D_SHADER_MACRO impostorDefines[] = { { "FUR_IMPOSTOR", "1" }, { nullptr, nullptr } };
+        ComPtr<ID3DBlob> bytecode = CompileShader(std::wstring(file.begin(), file.end()),
+            ShaderVariantFiles[v].Impostor ? impostorDefines : nullptr, "main", ShaderVariantFiles[v].Target);
+        if (!bytecode) return false;
+        m_shaderBytecode[v] = bytecode;
+        // A comment-only edit compiles to the same bytecode and leaves the PSOs alone
+        outputHash = HashBytes(HashSeed, bytecode->GetBufferPointer(), bytecode->GetBufferSize());
+        return true;
+    }
+    for (uint32_t p = 0; p < PipelineCount; p++) {
+        if (id == m_pipelineAssets[p]) return CreatePipelineState((PipelineKind)p);
+    }
 
-    ComPtr<ID3D12Resource> vUploadBuffer, iUploadBuffer, iAdjUploadBuffer;
+    if (id == m_meshAsset) {
+        // A reload waits for the builders still running, then replaces whatever level is on screen
+        m_sceneStream.reset();
+        for (std::vector<ComPtr<ID3D12Resource>>& buffers : m_sceneUploads.Buffers) buffers.clear();
+        if (m_indexCount == 0) {
+            m_loadedMesh = GeometryGen::CreateSphere(1.0f, 20, 20);
+            StartSceneStream();
+            return true;
+        }
+        m_loadedMesh = LoadScene(m_jobs);
+        return !m_loadedMesh.Vertices.empty();
+    }
+    if (id == m_meshPartAssets[MeshPartGeometry]) {
+        outputHash = HashGeometry(m_loadedMesh);
+        return true;
+    }
+    if (id == m_meshPartAssets[MeshPartStreams]) {
+        // Baked occlusion and tangents (bind pose for skinned meshes); tangents are derived from
+        // the UVs unless the mesh brought its own
+        MeshData& mesh = m_loadedMesh;
+        FillVertexStreams(mesh);
+        outputHash = HashVector(mesh.Tangents, HashVector(mesh.Occlusion, HashSeed));
+        return true;
+    }
+    if (id == m_meshPartAssets[MeshPartMaterials]) {
+        outputHash = HashMaterials(m_loadedMesh);
+        return true;
+    }
+    if (id == m_meshPartAssets[MeshPartGroom]) {
+        const GroomMap& groomMap = m_loadedMesh.FurGroomMap;
+        const uint32_t header[2] = { groomMap.Width, groomMap.Height };
+        outputHash = HashVector(groomMap.Texels, HashBytes(HashSeed, header, sizeof(header)));
+        outputHash = HashBytes(outputHash, &groomMap.MaxLength, sizeof(groomMap.MaxLength));
+        return true;
+    }
+
+    if (id == m_meshUploadAssets[MeshPartGeometry]) {
+        UploadGeometry(list, uploadBuffers);
+        return true;
+    }
+    if (id == m_meshUploadAssets[MeshPartStreams]) {
+        UploadVertexStreams(list, uploadBuffers);
+        return true;
+    }
+    if (id == m_meshUploadAssets[MeshPartMaterials]) {
+        UploadMaterials(list, m_loadedMesh, uploadBuffers);
+        outputHash = HashBytes(HashSeed, &m_materialFurLength, sizeof(m_materialFurLength));
+        return true;
+    }
+    if (id == m_meshUploadAssets[MeshPartGroom]) {
+        UploadGroomMap(list, m_loadedMesh, uploadBuffers);
+        outputHash = HashBytes(HashSeed, &m_groomLongestStrand, sizeof(m_groomLongestStrand));
+        return true;
+    }
+    if (id == m_framePipelineAsset) {
+        SetPipelineMesh(m_loadedMesh);
+        return true;
+    }
+
+    if (id == m_noiseAsset) {
+        UploadFurNoise(list, uploadBuffers);
+        outputHash = HashBytes(HashSeed, m_noiseData.data(), m_noiseData.size() * sizeof(float));
+        return true;
+    }
+    if (id == m_volumeAsset) {
+        UploadFurVolume(list, uploadBuffers);
+        return true;
+    }
+    return false;
+}
+
+MeshData FurRenderer::LoadScene(JobSystem& jobs) {
+    MeshData mesh = m_syntheticScene.Objects.empty()
+        ? GeometryGen::LoadGLTF(SceneGltfPath, jobs)
+        : GeometryGen::CreateSynthetic(m_syntheticScene, jobs);
+
+    // The mesh already on screen stays: the sphere if the first load fails, the previous scene
+    // if a reload catches a file mid-save
+    if (mesh.Vertices.empty()) {
+        OutputDebugStringA("Failed to load fur_carpet, keeping the mesh on screen.\n");
+    }
+    OutputDebugStringA(MemoryTracker::Report().c_str());
+    return mesh;
+}
+
+void FurRenderer::StartSceneStream() {
+    if (!m_streamArena) {
+        CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC arenaDesc = CD3DX12_RESOURCE_DESC::Buffer(StreamFrameBudget);
+        ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &arenaDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_streamArena)));
+        CD3DX12_RANGE readRange(0, 0);
+        ThrowIfFailed(m_streamArena->Map(0, &readRange, reinterpret_cast<void**>(&m_streamArenaMapped)));
+    }
+    LodStreamSettings settings;
+    settings.FrameBudget = StreamFrameBudget;
+    m_sceneStream = std::make_unique<SceneStream>();
+    m_sceneStream->Levels.resize(SceneLodCount - 1);
+    m_sceneStream->Streamer = std::make_unique<LodStreamer>(settings);
+    // The builders hold the stream itself: m_sceneStream is already null while a reset joins them
+    SceneStream* stream = m_sceneStream.get();
+    m_sceneStream->Streamer->Start(SceneLodCount, [this, stream](uint32_t level, JobSystem& jobs, std::vector<LodSection>& sections) {
+        return BuildSceneLevel(*stream, level, jobs, sections);
+    });
+}
+
+bool FurRenderer::BuildSceneLevel(SceneStream& stream, uint32_t level, JobSystem& jobs, std::vector<LodSection>& sections) {
+    std::call_once(stream.SourceLoaded, [&] { stream.Source = LoadScene(jobs); });
+    const MeshData& source = stream.Source;
+    if (source.Vertices.empty()) return false;
+
+    MeshData* mesh = &stream.Source;
+    if (level + 1 < SceneLodCount) {
+        // Clustering would tear the skin weights apart
+        if (!source.Skin.empty()) return false;
+        MeshArrays input, clustered;
+        input.Vertices.resize(source.Vertices.size() * MeshArrays::VertexStride);
+        memcpy(input.Vertices.data(), source.Vertices.data(), source.Vertices.size() * sizeof(Vertex));
+        input.Indices = source.Indices;
+        input.TriangleMaterials = source.TriangleMaterials;
+        MeshStreamSettings settings;
+        settings.GridResolution = SceneLodGrids[level];
+        MeshStreamer::ProcessInCore(input, settings, clustered);
+        if (clustered.Indices.empty()) return false;
+
+        mesh = &stream.Levels[level];
+        mesh->Vertices.resize(clustered.VertexCount());
+        memcpy(mesh->Vertices.data(), clustered.Vertices.data(), mesh->Vertices.size() * sizeof(Vertex));
+        mesh->Indices = std::move(clustered.Indices);
+        mesh->IndicesAdj = std::move(clustered.IndicesAdj);
+        if (!source.TriangleMaterials.empty()) mesh->TriangleMaterials = std::move(clustered.TriangleMaterials);
+        GeometryGen::BuildClusters(*mesh);
+    }
+    // The finest level's builder is the only one writing the source after the load, and only
+    // its streams, which the others don't read
+    FillVertexStreams(*mesh);
+    sections.resize(SceneSectionCount);
+    sections[SceneSectionVertices] = { mesh->Vertices.data(), mesh->Vertices.size() * sizeof(Vertex) };
+    sections[SceneSectionIndices] = { mesh->Indices.data(), mesh->Indices.size() * sizeof(uint32_t) };
+    sections[SceneSectionIndicesAdj] = { mesh->IndicesAdj.data(), mesh->IndicesAdj.size() * sizeof(uint32_t) };
+    sections[SceneSectionOcclusion] = { mesh->Occlusion.data(), mesh->Occlusion.size() * sizeof(VertexOcclusion) };
+    sections[SceneSectionTangents] = { mesh->Tangents.data(), mesh->Tangents.size() * sizeof(VertexTangent) };
+    return true;
+}
+
+// Called after HotReload, with the GPU idle or finishing the hot reload's upload. The level swap
+// and this frame's chunks go on the upload list, queued ahead of the frame's.
+void FurRenderer::StreamScene() {
+    if (!m_sceneStream) return;
+    LodStreamer& streamer = *m_sceneStream->Streamer;
+    WaitForFence(m_uploadFence);
+    ThrowIfFailed(m_uploadAllocator->Reset());
+    ThrowIfFailed(m_uploadList->Reset(m_uploadAllocator.Get(), nullptr));
+    m_sceneUploads.ArenaOffset = 0;
+    std::vector<ComPtr<ID3D12Resource>> uploadBuffers;
+    const int32_t level = streamer.Update(m_sceneUploads);
+    if (level >= 0) SwapSceneLevel((uint32_t)level, uploadBuffers);
+    ThrowIfFailed(m_uploadList->Close());
+    ID3D12CommandList* cmdsLists[] = { m_uploadList.Get() };
+    m_commandQueue->ExecuteCommandLists(1, cmdsLists);
+    for (const ComPtr<ID3D12Resource>& buffer : uploadBuffers) Retire(buffer);
+    m_uploadFence = ++m_currentFence; // SceneUploadQueue::EndLevel counts on it
+    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_uploadFence));
+
+    if (!streamer.Finished()) return;
+    const LodStreamStats& stats = streamer.Stats();
+    char streamInfo[192];
+    if (streamer.Current() < 0) {
+        snprintf(streamInfo, sizeof(streamInfo), "Scene streaming: no level could be built, keeping the sphere\n");
+    } else {
+        snprintf(streamInfo, sizeof(streamInfo), "Scene streaming: first LOD after %.1f ms, full quality after %.1f ms, %.1f MB in %llu frames\n",
+            stats.FirstLevelMs, stats.FinestMs, stats.BytesQueued / 1048576.0, (unsigned long long)stats.Updates);
+    }
+    OutputDebugStringA(streamInfo);
+    m_sceneStream.reset();
+}
 
-    m_vertexBuffer = CreateDefaultBuffer(m_device.Get(), m_commandList.Get(), sphere.Vertices.data(), vbByteSize, vUploadBuffer);
-    m_indexBuffer = CreateDefaultBuffer(m_device.Get(), m_commandList.Get(), sphere.Indices.data(), ibByteSize, iUploadBuffer);
-    m_indexBufferAdj = CreateDefaultBuffer(m_device.Get(), m_commandList.Get(), sphere.IndicesAdj.data(), ibAdjByteSize, iAdjUploadBuffer);
+// Draws from the level's streamed buffers from this frame on; the scene's materials and groom
+// map come with the first level shown
+void FurRenderer::SwapSceneLevel(uint32_t level, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers) {
+    SceneStream& stream = *m_sceneStream;
+    const MeshData& source = stream.Source;
+    const MeshData& mesh = level + 1 < SceneLodCount ? stream.Levels[level] : source;
+    std::vector<ComPtr<ID3D12Resource>>& buffers = m_sceneUploads.Buffers[level];
+
+    Retire(m_vertexBuffer);
+    Retire(m_skinnedVertexRing);
+    Retire(m_indexBuffer);
+    Retire(m_indexBufferAdj);
+    Retire(m_occlusionBuffer);
+    Retire(m_tangentBuffer);
+    m_meshAnimated = !mesh.Skin.empty() && !mesh.Animations.empty();
+    if (m_meshAnimated) {
+        // Skinned into the upload ring every frame; the streamed bind pose goes unused
+        Retire(buffers[SceneSectionVertices]);
+        m_vertexBuffer.Reset();
+        CreateSkinnedVertexRing(mesh);
+    } else {
+        m_skinnedVertexRing.Reset();
+        m_skinnedVertexRingMapped = nullptr;
+        m_vertexBuffer = buffers[SceneSectionVertices];
+        m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
+    }
+    m_indexBuffer = buffers[SceneSectionIndices];
+    m_indexBufferAdj = buffers[SceneSectionIndicesAdj];
+    m_occlusionBuffer = buffers[SceneSectionOcclusion];
+    m_tangentBuffer = buffers[SceneSectionTangents];
+    buffers.clear();
+
+    m_vertexBufferView.StrideInBytes = sizeof(Vertex);
+    m_vertexBufferView.SizeInBytes = (UINT)(mesh.Vertices.size() * sizeof(Vertex));
+    m_indexBufferView = { m_indexBuffer->GetGPUVirtualAddress(), (UINT)(mesh.Indices.size() * sizeof(uint32_t)), DXGI_FORMAT_R32_UINT };
+    m_indexBufferAdjView = { m_indexBufferAdj->GetGPUVirtualAddress(), (UINT)(mesh.IndicesAdj.size() * sizeof(uint32_t)), DXGI_FORMAT_R32_UINT };
+    m_occlusionBufferView = { m_occlusionBuffer->GetGPUVirtualAddress(), (UINT)(mesh.Occlusion.size() * sizeof(VertexOcclusion)),
+                              sizeof(VertexOcclusion) };
+    m_tangentBufferView = { m_tangentBuffer->GetGPUVirtualAddress(), (UINT)(mesh.Tangents.size() * sizeof(VertexTangent)),
+                            sizeof(VertexTangent) };
+    m_indexCount = (UINT)mesh.Indices.size();
+    m_indexCountAdj = (UINT)mesh.IndicesAdj.size();
+
+    if (!stream.MaterialsUploaded) {
+        UploadMaterials(m_uploadList.Get(), source, uploadBuffers);
+        UploadGroomMap(m_uploadList.Get(), source, uploadBuffers);
+        stream.MaterialsUploaded = true;
+    }
+    SetPipelineMesh(mesh);
+
+    char levelInfo[160];
+    snprintf(levelInfo, sizeof(levelInfo), "Scene streaming: LOD %u of %u on screen, %zu triangles, after %.1f ms\n",
+        level + 1, SceneLodCount, mesh.Indices.size() / 3, m_sceneStream->Streamer->Stats().Levels[level].ShownMs);
+    OutputDebugStringA(levelInfo);
+    // Its builder is done; the GPU and the frame pipeline hold their own copies
+    if (level + 1 < SceneLodCount) stream.Levels[level] = MeshData();
+}
+
+void FurRenderer::SceneUploadQueue::BeginLevel(uint32_t level, const std::vector<LodSection>& sections) {
+    std::vector<ComPtr<ID3D12Resource>>& buffers = Buffers[level];
+    buffers.resize(sections.size());
+    CD3DX12_HEAP_PROPERTIES defaultHeapProps(D3D12_HEAP_TYPE_DEFAULT);
+    for (size_t s = 0; s < sections.size(); s++) {
+        // Views of an empty stream still need a buffer behind them
+        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(std::max<UINT64>(sections[s].Size, 256));
+        ThrowIfFailed(m_renderer.m_device->CreateCommittedResource(&defaultHeapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+            D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&buffers[s])));
+    }
+}
+
+void FurRenderer::SceneUploadQueue::Upload(uint32_t level, uint32_t section, uint64_t offset, const void* data, uint64_t size) {
+    memcpy(m_renderer.m_streamArenaMapped + ArenaOffset, data, size);
+    m_renderer.m_uploadList->CopyBufferRegion(Buffers[level][section].Get(), offset, m_renderer.m_streamArena.Get(), ArenaOffset, size);
+    ArenaOffset += size;
+}
+
+uint64_t FurRenderer::SceneUploadQueue::EndLevel(uint32_t) {
+    return m_renderer.m_currentFence + 1; // Signalled once StreamScene submits this frame's copies
+}
+
+uint64_t FurRenderer::SceneUploadQueue::CompletedFence() {
+    return m_renderer.m_fence->GetCompletedValue();
+}
+
+void FurRenderer::UploadGeometry(ID3D12GraphicsCommandList* list, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers) {
+    const MeshData& mesh = m_loadedMesh;
+    const UINT vbByteSize = (UINT)mesh.Vertices.size() * sizeof(Vertex);
+    const UINT ibByteSize = (UINT)mesh.Indices.size() * sizeof(uint32_t);
+    const UINT ibAdjByteSize = (UINT)mesh.IndicesAdj.size() * sizeof(uint32_t);
+
+    ComPtr<ID3D12Resource> vUploadBuffer, iUploadBuffer, iAdjUploadBuffer;
+    Retire(m_vertexBuffer);
+    Retire(m_skinnedVertexRing);
+    Retire(m_indexBuffer);
+    Retire(m_indexBufferAdj);
+
+    // Animated meshes are skinned on the CPU into an upload ring each frame (see Update) instead
+    // of living in a static default-heap buffer
+    m_meshAnimated = !mesh.Skin.empty() && !mesh.Animations.empty();
+    if (m_meshAnimated) {
+        m_vertexBuffer.Reset();
+        CreateSkinnedVertexRing(mesh);
+    } else {
+        m_skinnedVertexRing.Reset();
+        m_skinnedVertexRingMapped = nullptr;
+        m_vertexBuffer = CreateDefaultBuffer(m_device.Get(), list, mesh.Vertices.data(), vbByteSize, vUploadBuffer);
+        m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
+        uploadBuffers.push_back(vUploadBuffer);
+    }
+    m_indexBuffer = CreateDefaultBuffer(m_device.Get(), list, mesh.Indices.data(), ibByteSize, iUploadBuffer);
+    m_indexBufferAdj = CreateDefaultBuffer(m_device.Get(), list, mesh.IndicesAdj.data(), ibAdjByteSize, iAdjUploadBuffer);
+    uploadBuffers.push_back(iUploadBuffer);
+    uploadBuffers.push_back(iAdjUploadBuffer);
 
-    m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
     m_vertexBufferView.StrideInBytes = sizeof(Vertex);
     m_vertexBufferView.SizeInBytes = vbByteSize;
 
@@ -626,61 +1577,193 @@ void FurRenderer::BuildRenderItems() {
     m_indexBufferAdjView.Format = DXGI_FORMAT_R32_UINT;
     m_indexBufferAdjView.SizeInBytes = ibAdjByteSize;
 
-    m_indexCount = (UINT)sphere.Indices.size();
-    m_indexCountAdj = (UINT)sphere.IndicesAdj.size();
+    m_indexCount = (UINT)mesh.Indices.size();
+    m_indexCountAdj = (UINT)mesh.IndicesAdj.size();
+}
 
-    // Generate High-Resolution Cellular (Voronoi) Noise
-    const UINT texWidth = 512, texHeight = 512;
-    std::vector<float> noiseData(texWidth * texHeight);
-    
-    // Generate feature points
-    const int cells = 32;
-    struct Point2D { float x, y; };
-    std::vector<Point2D> points;
-    for(int i = 0; i < cells * cells; ++i) {
-        float px = (rand() % 1000) / 1000.0f;
-        float py = (rand() % 1000) / 1000.0f;
-        points.push_back({px, py});
-    }
-
-    // Evaluate Voronoi distance for each pixel
-    for (UINT y = 0; y < texHeight; ++y) {
-        for (UINT x = 0; x < texWidth; ++x) {
-            float u = (float)x / texWidth;
-            float v = (float)y / texHeight;
-            
-            float minDist = 1.0f;
-            
-            // Optimization: Only check neighboring cells (simplified here to all points for basic 32x32 grids)
-            // Need to wrap distance to make it seamlessly tileable
-            for (const auto& pt : points) {
-                float dx = std::abs(u - pt.x);
-                float dy = std::abs(v - pt.y);
-                if (dx > 0.5f) dx = 1.0f - dx; // Wrap around for tiling
-                if (dy > 0.5f) dy = 1.0f - dy; // Wrap around for tiling
-                
-                float dist = sqrt(dx * dx + dy * dy);
-                if (dist < minDist) {
-                    minDist = dist;
-                }
-            }
-            
-            // Invert so strands are thickest at the point centers
-            // Scale so maximum value is roughly 1.0
-            float cellMaxDist = sqrt(0.5f * 0.5f + 0.5f * 0.5f) / cells * 2.0f;
-            float val = 1.0f - (minDist / cellMaxDist);
-            if (val < 0.0f) val = 0.0f;
-            
-            // Optional: apply a power function to make the strands thinner and taper sharper
-            val = pow(val, 2.5f);
-            
-            noiseData[y * texWidth + x] = val;
+void FurRenderer::CreateSkinnedVertexRing(const MeshData& mesh) {
+    const UINT vbByteSize = (UINT)mesh.Vertices.size() * sizeof(Vertex);
+    CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC ringDesc = CD3DX12_RESOURCE_DESC::Buffer((UINT64)vbByteSize * SwapChainBufferCount);
+    ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &ringDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_skinnedVertexRing)));
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(m_skinnedVertexRing->Map(0, &readRange, reinterpret_cast<void**>(&m_skinnedVertexRingMapped)));
+    // Both slots start in the bind pose, so a frame drawn before the first skinning is valid
+    for (UINT slot = 0; slot < SwapChainBufferCount; slot++) {
+        memcpy(m_skinnedVertexRingMapped + (size_t)slot * vbByteSize, mesh.Vertices.data(), vbByteSize);
+    }
+    m_vertexBufferView.BufferLocation = m_skinnedVertexRing->GetGPUVirtualAddress();
+}
+
+// Baked occlusion and tangents: the second and third static vertex streams
+void FurRenderer::UploadVertexStreams(ID3D12GraphicsCommandList* list, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers) {
+    const MeshData& mesh = m_loadedMesh;
+    Retire(m_occlusionBuffer);
+    Retire(m_tangentBuffer);
+
+    ComPtr<ID3D12Resource> occlusionUploadBuffer;
+    const UINT occlusionByteSize = (UINT)mesh.Occlusion.size() * sizeof(VertexOcclusion);
+    m_occlusionBuffer = CreateDefaultBuffer(m_device.Get(), list, mesh.Occlusion.data(), occlusionByteSize, occlusionUploadBuffer);
+    m_occlusionBufferView.BufferLocation = m_occlusionBuffer->GetGPUVirtualAddress();
+    m_occlusionBufferView.StrideInBytes = sizeof(VertexOcclusion);
+    m_occlusionBufferView.SizeInBytes = occlusionByteSize;
+
+    ComPtr<ID3D12Resource> tangentUploadBuffer;
+    const UINT tangentByteSize = (UINT)mesh.Tangents.size() * sizeof(VertexTangent);
+    m_tangentBuffer = CreateDefaultBuffer(m_device.Get(), list, mesh.Tangents.data(), tangentByteSize, tangentUploadBuffer);
+    m_tangentBufferView.BufferLocation = m_tangentBuffer->GetGPUVirtualAddress();
+    m_tangentBufferView.StrideInBytes = sizeof(VertexTangent);
+    m_tangentBufferView.SizeInBytes = tangentByteSize;
+
+    uploadBuffers.push_back(occlusionUploadBuffer);
+    uploadBuffers.push_back(tangentUploadBuffer);
+}
+
+// Per-material fur parameters, indexed in the shaders by the root constant each draw sets. Each
+// material's coat is planned here; a material without layers is a coat of one, drawn exactly
+// like the single-layer shells.
+void FurRenderer::UploadMaterials(ID3D12GraphicsCommandList* list, const MeshData& mesh,
+                                  std::vector<ComPtr<ID3D12Resource>>& uploadBuffers) {
+    std::vector<FurMaterial> materials = mesh.Materials;
+    if (materials.empty()) materials.push_back(FurMaterial());
+    std::vector<FurCB> furMaterials(materials.size(), m_furParams);
+    CreateColorMaps(list, mesh.Textures, uploadBuffers);
+    m_materialFurLength = 0.0f;
+    m_coatInstances.assign(materials.size(), 0);
+    for (size_t i = 0; i < materials.size(); i++) {
+        std::vector<CoatLayer> layers = materials[i].Layers;
+        if (layers.empty()) {
+            CoatLayer layer;
+            layer.Length = materials[i].FurLength;
+            layer.Shells = FramePipeline::ShellInstances;
+            layer.Density = materials[i].Density;
+            layer.Thickness = materials[i].Thickness;
+            layer.Color = Float3(materials[i].FurColor.x, materials[i].FurColor.y, materials[i].FurColor.z);
+            layers.push_back(layer);
+        }
+        const CoatPlan coat = FurCoat::Plan(layers.data(), (uint32_t)layers.size(), FurCoat::ShellCount);
+        const CoatPlanLayer& outer = coat.Layers[coat.LayerCount - 1];
+        FurCB& fur = furMaterials[i];
+        fur.FurLength = coat.Length;
+        fur.Density = outer.Density;
+        fur.Thickness = outer.Thickness;
+        fur.FurColor = XMFLOAT3(outer.Color.x, outer.Color.y, outer.Color.z);
+        int32_t colorMap = materials[i].ColorTexture;
+        fur.ColorMap = colorMap >= 0 && colorMap < (int32_t)m_colorMapSrvs.size() && m_colorMapSrvs[colorMap].Valid()
+                           ? m_colorMapSrvs[colorMap].Index : UINT32_MAX;
+        fur.LayerCount = coat.LayerCount;
+        fur.ShellInstances = coat.Instances;
+        for (uint32_t k = 0; k < coat.LayerCount; k++) {
+            const CoatPlanLayer& layer = coat.Layers[k];
+            fur.Layers[k] = { layer.Length, layer.Density, layer.Thickness, layer.NoiseChannel,
+                              XMFLOAT3(layer.Color.x, layer.Color.y, layer.Color.z), layer.Reach, layer.LastShell, {} };
         }
+        m_coatInstances[i] = coat.Instances;
+        m_materialFurLength = std::max(m_materialFurLength, coat.Length);
     }
+
+    // A new buffer rather than a rewrite: the material count may have changed
+    Retire(m_furMaterials);
+    CD3DX12_HEAP_PROPERTIES materialHeapProps(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC materialDesc = CD3DX12_RESOURCE_DESC::Buffer(furMaterials.size() * sizeof(FurCB));
+    ThrowIfFailed(m_device->CreateCommittedResource(&materialHeapProps, D3D12_HEAP_FLAG_NONE, &materialDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_furMaterials)));
+    CD3DX12_RANGE materialReadRange(0, 0);
+    ThrowIfFailed(m_furMaterials->Map(0, &materialReadRange, reinterpret_cast<void**>(&m_furMaterialsMapped)));
+    memcpy(m_furMaterialsMapped, furMaterials.data(), furMaterials.size() * sizeof(FurCB));
+    m_furMaterialCount = (uint32_t)furMaterials.size();
+}
+
+// Groom map, sampled by the vertex shaders
+void FurRenderer::UploadGroomMap(ID3D12GraphicsCommandList* list, const MeshData& mesh,
+                                 std::vector<ComPtr<ID3D12Resource>>& uploadBuffers) {
+    const GroomMap groomMap = mesh.FurGroomMap.Empty() ? GroomMap::Neutral() : mesh.FurGroomMap;
+    // Groomed strands may be longer than their material's fur
+    m_groomLongestStrand = groomMap.LongestStrand();
+
+    Retire(m_groomMap);
+    CD3DX12_HEAP_PROPERTIES defaultHeap(D3D12_HEAP_TYPE_DEFAULT);
+    CD3DX12_RESOURCE_DESC groomDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, groomMap.Width, groomMap.Height, 1, 1);
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &defaultHeap, D3D12_HEAP_FLAG_NONE, &groomDesc,
+        D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_groomMap)));
+
+    ComPtr<ID3D12Resource> groomUploadBuffer;
+    CD3DX12_HEAP_PROPERTIES uploadHeap(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC groomBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(m_groomMap.Get(), 0, 1));
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &uploadHeap, D3D12_HEAP_FLAG_NONE, &groomBufferDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&groomUploadBuffer)));
+
+    D3D12_SUBRESOURCE_DATA groomData = {};
+    groomData.pData = groomMap.Texels.data();
+    groomData.RowPitch = groomMap.Width * sizeof(uint32_t);
+    groomData.SlicePitch = groomData.RowPitch * groomMap.Height;
+    UpdateSubresources(list, m_groomMap.Get(), groomUploadBuffer.Get(), 0, 0, 1, &groomData);
+
+    CD3DX12_RESOURCE_BARRIER groomToSRV = CD3DX12_RESOURCE_BARRIER::Transition(m_groomMap.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    list->ResourceBarrier(1, &groomToSRV);
+    uploadBuffers.push_back(groomUploadBuffer);
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC groomSrvDesc = {};
+    groomSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    groomSrvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    groomSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    groomSrvDesc.Texture2D.MipLevels = 1;
+    WriteSrv(m_groomMapSrv, m_groomMap.Get(), groomSrvDesc);
+}
+
+// Culling bounds, the BVH and the OSM fit use the longest fur of any material, groomed
+void FurRenderer::SetPipelineMesh(const MeshData& mesh) {
+    m_furParams.FurLength = m_materialFurLength * m_groomLongestStrand;
+    m_framePipeline.SetMesh(reinterpret_cast<const float*>(mesh.Vertices.data()), sizeof(Vertex) / sizeof(float),
+                            mesh.Vertices.size(), mesh.Indices, mesh.Clusters, m_furParams.FurLength);
+    if (m_meshAnimated) {
+        m_framePipeline.SetSkin(mesh.Skin, mesh.Rig, mesh.Animations);
+    }
+
+    const Bvh4Stats& bvh = m_framePipeline.ClusterBvh().Stats();
+    char bvhInfo[160];
+    snprintf(bvhInfo, sizeof(bvhInfo), "Cluster BVH: %zu clusters, %u nodes, depth %u, built in %.3f ms\n",
+        mesh.Clusters.size(), bvh.NodeCount, bvh.Depth, bvh.BuildMs);
+    OutputDebugStringA(bvhInfo);
+    if (m_meshAnimated) {
+        char skinInfo[160];
+        snprintf(skinInfo, sizeof(skinInfo), "Skinned mesh: %zu vertices, %u joints, %zu animations, playing '%s'\n",
+            mesh.Vertices.size(), mesh.Rig.JointCount(), mesh.Animations.size(), mesh.Animations[0].Name.c_str());
+        OutputDebugStringA(skinInfo);
+    }
+}
+
+// High-resolution cellular (Voronoi) noise for the shells. Kept on the CPU: the fur volume is
+// baked from it.
+// One Voronoi noise per coat noise channel, packed RG. The impostor volume is baked from the
+// first, which single-layer coats use.
+void FurRenderer::UploadFurNoise(ID3D12GraphicsCommandList* list, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers) {
+    static_assert(FurCoat::NoiseChannels == 2, "The noise texture is RG");
+    FurVolumeBaker furVolumeBaker(m_jobs);
+    furVolumeBaker.GenerateNoise(m_noiseSettings, m_noiseData);
+    double noiseMs = furVolumeBaker.Stats().NoiseMs;
+    FurNoiseSettings secondSettings = m_noiseSettings;
+    secondSettings.Seed = FurCoat::NoiseSeed(m_noiseSettings.Seed, 1);
+    std::vector<float> secondNoise;
+    furVolumeBaker.GenerateNoise(secondSettings, secondNoise);
+    noiseMs += furVolumeBaker.Stats().NoiseMs;
+    std::vector<float> texels(m_noiseData.size() * FurCoat::NoiseChannels);
+    for (size_t i = 0; i < m_noiseData.size(); i++) {
+        texels[i * 2] = m_noiseData[i];
+        texels[i * 2 + 1] = secondNoise[i];
+    }
+    const UINT texWidth = m_noiseSettings.Size, texHeight = m_noiseSettings.Size;
+    char noiseInfo[96];
+    snprintf(noiseInfo, sizeof(noiseInfo), "Fur noise %ux%u, %u channels in %.1f ms\n", texWidth, texHeight,
+        FurCoat::NoiseChannels, noiseMs);
+    OutputDebugStringA(noiseInfo);
     
     D3D12_RESOURCE_DESC texDesc = {};
     texDesc.MipLevels = 1;
-    texDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    texDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
     texDesc.Width = texWidth;
     texDesc.Height = texHeight;
     texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
@@ -689,6 +1772,7 @@ void FurRenderer::BuildRenderItems() {
     texDesc.SampleDesc.Quality = 0;
     texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 
+    Retire(m_noiseTex);
     CD3DX12_HEAP_PROPERTIES defaultHeap(D3D12_HEAP_TYPE_DEFAULT);
     ThrowIfFailed(m_device->CreateCommittedResource(
         &defaultHeap, D3D12_HEAP_FLAG_NONE, &texDesc,
@@ -703,50 +1787,320 @@ void FurRenderer::BuildRenderItems() {
         D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&noiseUploadBuffer)));
 
     D3D12_SUBRESOURCE_DATA texResourceData = {};
-    texResourceData.pData = noiseData.data();
-    texResourceData.RowPitch = texWidth * sizeof(float);
+    texResourceData.pData = texels.data();
+    texResourceData.RowPitch = texWidth * FurCoat::NoiseChannels * sizeof(float);
     texResourceData.SlicePitch = texResourceData.RowPitch * texHeight;
 
-    UpdateSubresources(m_commandList.Get(), m_noiseTex.Get(), noiseUploadBuffer.Get(), 0, 0, 1, &texResourceData);
+    UpdateSubresources(list, m_noiseTex.Get(), noiseUploadBuffer.Get(), 0, 0, 1, &texResourceData);
     
     CD3DX12_RESOURCE_BARRIER transitionToSRV = CD3DX12_RESOURCE_BARRIER::Transition(m_noiseTex.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-    m_commandList->ResourceBarrier(1, &transitionToSRV);
+    list->ResourceBarrier(1, &transitionToSRV);
+    uploadBuffers.push_back(noiseUploadBuffer);
 
-    // Create SRV in heap for noise (1 slot) and OSM (4 slots)
+    // Slot 0: Noise
     D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
     srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
     srvDesc.Format = texDesc.Format;
     srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
     srvDesc.Texture2D.MostDetailedMip = 0;
     srvDesc.Texture2D.MipLevels = 1;
-    
-    CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(m_cbvSrvUavHeap->GetCPUDescriptorHandleForHeapStart());
-    
-    // Slot 0: Noise
-    m_device->CreateShaderResourceView(m_noiseTex.Get(), &srvDesc, hDescriptor);
-    hDescriptor.Offset(1, m_cbvSrvUavDescriptorSize);
-    
-    // Slot 1-4: OSM Textures
-    D3D12_SHADER_RESOURCE_VIEW_DESC osmSrvDesc = srvDesc;
-    osmSrvDesc.Format = DXGI_FORMAT_R8_UNORM;
-    for(int i = 0; i < 4; ++i) {
-        m_device->CreateShaderResourceView(m_osmTextures[i].Get(), &osmSrvDesc, hDescriptor);
-        hDescriptor.Offset(1, m_cbvSrvUavDescriptorSize);
+    WriteSrv(m_noiseSrv, m_noiseTex.Get(), srvDesc);
+}
+
+// The fur volume the impostor layers of distant pelts read, baked from the same noise
+void FurRenderer::UploadFurVolume(ID3D12GraphicsCommandList* list, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers) {
+    FurVolumeBaker furVolumeBaker(m_jobs);
+    FurVolume furVolume;
+    furVolumeBaker.Bake(m_noiseData.data(), m_noiseSettings.Size, m_volumeSettings, furVolume);
+
+    const FurVolumeStats& volumeStats = furVolumeBaker.Stats();
+    char volumeInfo[160];
+    snprintf(volumeInfo, sizeof(volumeInfo), "Fur volume %ux%u x %u slices, %u mips (%.1f KB) in %.1f ms\n",
+        furVolume.Width, furVolume.Height, furVolume.Slices, furVolume.MipLevels, volumeStats.Bytes / 1024.0, volumeStats.BakeMs);
+    OutputDebugStringA(volumeInfo);
+
+    // A texture array with one slice per threshold, every mip of every slice in one copy
+    Retire(m_furVolume);
+    const UINT volumeSubresources = (UINT)furVolume.Levels.size();
+    CD3DX12_HEAP_PROPERTIES defaultHeap(D3D12_HEAP_TYPE_DEFAULT);
+    CD3DX12_RESOURCE_DESC volumeDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16G16_UNORM, furVolume.Width, furVolume.Height,
+        (UINT16)furVolume.Slices, (UINT16)furVolume.MipLevels);
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &defaultHeap, D3D12_HEAP_FLAG_NONE, &volumeDesc,
+        D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_furVolume)));
+
+    ComPtr<ID3D12Resource> volumeUploadBuffer;
+    CD3DX12_HEAP_PROPERTIES uploadHeap(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC volumeBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(m_furVolume.Get(), 0, volumeSubresources));
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &uploadHeap, D3D12_HEAP_FLAG_NONE, &volumeBufferDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&volumeUploadBuffer)));
+
+    std::vector<D3D12_SUBRESOURCE_DATA> volumeLevels(volumeSubresources);
+    for (UINT i = 0; i < volumeSubresources; i++) {
+        const FurVolumeLevel& level = furVolume.Levels[i];
+        volumeLevels[i].pData = level.Texels.data();
+        volumeLevels[i].RowPitch = level.Width * 2 * sizeof(uint16_t);
+        volumeLevels[i].SlicePitch = volumeLevels[i].RowPitch * level.Height;
     }
+    UpdateSubresources(list, m_furVolume.Get(), volumeUploadBuffer.Get(), 0, 0, volumeSubresources, volumeLevels.data());
+
+    CD3DX12_RESOURCE_BARRIER volumeToSRV = CD3DX12_RESOURCE_BARRIER::Transition(m_furVolume.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    list->ResourceBarrier(1, &volumeToSRV);
+    uploadBuffers.push_back(volumeUploadBuffer);
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC volumeSrvDesc = {};
+    volumeSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    volumeSrvDesc.Format = DXGI_FORMAT_R16G16_UNORM;
+    volumeSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+    volumeSrvDesc.Texture2DArray.MipLevels = furVolume.MipLevels;
+    volumeSrvDesc.Texture2DArray.ArraySize = furVolume.Slices;
+    WriteSrv(m_furVolumeSrv, m_furVolume.Get(), volumeSrvDesc);
+}
 
-    ThrowIfFailed(m_commandList->Close());
-    ID3D12CommandList* cmdsLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(1, cmdsLists);
+void FurRenderer::Retire(const ComPtr<ID3D12Pageable>& object) {
+    // Freed once the next fence signalled has completed
+    if (object) m_retired.push_back({ m_currentFence + 1, object });
+}
 
-    FlushCommandQueue();
+void FurRenderer::ReleaseRetired() {
+    const UINT64 completed = m_fence->GetCompletedValue();
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(),
+        [&](const RetiredObject& retired) { return retired.Fence <= completed; }), m_retired.end());
+    m_descriptors.Retire(completed);
+}
+
+void FurRenderer::WriteSrv(DescriptorHandle& handle, ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc) {
+    FreeSrv(handle);
+    handle = m_descriptors.Allocate();
+    if (!handle.Valid()) throw std::runtime_error("Descriptor heap full");
+    CD3DX12_CPU_DESCRIPTOR_HANDLE descriptor(m_cbvSrvUavHeap->GetCPUDescriptorHandleForHeapStart(), handle.Index, m_cbvSrvUavDescriptorSize);
+    m_device->CreateShaderResourceView(resource, &desc, descriptor);
+}
+
+void FurRenderer::FreeSrv(DescriptorHandle& handle) {
+    // Recycled once the next fence signalled has completed, like Retire
+    if (handle.Valid()) m_descriptors.Free(handle, m_currentFence + 1);
+    handle = DescriptorHandle();
+}
+
+// Uploads the cooked colour maps (every mip in one copy each) on 'list' and gives each a view
+// in the heap. Upload buffers must live until the list has executed.
+void FurRenderer::CreateColorMaps(ID3D12GraphicsCommandList* list, const std::vector<TextureImage>& textures,
+                                  std::vector<ComPtr<ID3D12Resource>>& uploadBuffers) {
+    for (const ComPtr<ID3D12Resource>& colorMap : m_colorMaps) Retire(colorMap);
+    for (DescriptorHandle& srv : m_colorMapSrvs) FreeSrv(srv);
+    m_colorMaps.clear();
+    m_colorMapSrvs.clear();
+
+    for (const TextureImage& image : textures) {
+        // Empty images (failed decodes) get no view; materials using them draw untextured
+        if (image.Empty()) {
+            m_colorMaps.push_back(nullptr);
+            m_colorMapSrvs.push_back(DescriptorHandle());
+            continue;
+        }
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        switch (image.Format) {
+        case TextureFormat::Bc1Srgb: srvDesc.Format = DXGI_FORMAT_BC1_UNORM_SRGB; break;
+        case TextureFormat::Bc7Srgb: srvDesc.Format = DXGI_FORMAT_BC7_UNORM_SRGB; break;
+        default: srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; break;
+        }
+        const UINT mipCount = (UINT)image.Mips.size();
+        srvDesc.Texture2D.MipLevels = mipCount;
+
+        CD3DX12_RESOURCE_DESC texDesc = CD3DX12_RESOURCE_DESC::Tex2D(srvDesc.Format, image.Width, image.Height, 1, (UINT16)mipCount);
+        CD3DX12_HEAP_PROPERTIES defaultHeap(D3D12_HEAP_TYPE_DEFAULT);
+        ComPtr<ID3D12Resource> texture;
+        ThrowIfFailed(m_device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &texDesc,
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&texture)));
+
+        ComPtr<ID3D12Resource> uploadBuffer;
+        CD3DX12_HEAP_PROPERTIES uploadHeap(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(texture.Get(), 0, mipCount));
+        ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer)));
+
+        // Mip rows are in blocks for the BC formats, which is what D3D12 expects as well
+        std::vector<D3D12_SUBRESOURCE_DATA> mips(mipCount);
+        for (UINT level = 0; level < mipCount; level++) {
+            mips[level].pData = image.Data.data() + image.Mips[level].Offset;
+            mips[level].RowPitch = image.Mips[level].RowPitch;
+            mips[level].SlicePitch = (LONG_PTR)image.Mips[level].Size;
+        }
+        UpdateSubresources(list, texture.Get(), uploadBuffer.Get(), 0, 0, mipCount, mips.data());
+
+        CD3DX12_RESOURCE_BARRIER toSrv = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        list->ResourceBarrier(1, &toSrv);
+        DescriptorHandle srv;
+        WriteSrv(srv, texture.Get(), srvDesc);
+
+        m_colorMaps.push_back(texture);
+        m_colorMapSrvs.push_back(srv);
+        uploadBuffers.push_back(uploadBuffer);
+    }
+}
+
+void FurRenderer::CreateGpuTimers() {
+    D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+    queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    queryHeapDesc.Count = GpuTimerCount * 2; // Begin/end pair per timer
+    ThrowIfFailed(m_device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_timestampHeap)));
+
+    CD3DX12_HEAP_PROPERTIES readbackHeapProps(D3D12_HEAP_TYPE_READBACK);
+    CD3DX12_RESOURCE_DESC readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(GpuTimerCount * 2 * sizeof(UINT64));
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &readbackHeapProps,
+        D3D12_HEAP_FLAG_NONE,
+        &readbackDesc,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&m_timestampReadback)));
+
+    ThrowIfFailed(m_commandQueue->GetTimestampFrequency(&m_timestampFrequency));
+
+    D3D12_QUERY_HEAP_DESC statsHeapDesc = {};
+    statsHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
+    statsHeapDesc.Count = 1;
+    ThrowIfFailed(m_device->CreateQueryHeap(&statsHeapDesc, IID_PPV_ARGS(&m_pipelineStatsHeap)));
+
+    CD3DX12_RESOURCE_DESC statsReadbackDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS));
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &readbackHeapProps,
+        D3D12_HEAP_FLAG_NONE,
+        &statsReadbackDesc,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&m_pipelineStatsReadback)));
+}
+
+void FurRenderer::ReadGpuTimers() {
+    // Only valid after the frame's fence has been waited on
+    CD3DX12_RANGE readRange(0, GpuTimerCount * 2 * sizeof(UINT64));
+    UINT64* timestamps = nullptr;
+    ThrowIfFailed(m_timestampReadback->Map(0, &readRange, reinterpret_cast<void**>(&timestamps)));
+    for (UINT i = 0; i < GpuTimerCount; i++) {
+        UINT64 ticks = timestamps[i * 2 + 1] - timestamps[i * 2];
+        m_gpuTimerMs[i] = 1000.0 * (double)ticks / (double)m_timestampFrequency;
+        m_gpuTimerTotalMs[i] += m_gpuTimerMs[i];
+    }
+    CD3DX12_RANGE writeRange(0, 0);
+    m_timestampReadback->Unmap(0, &writeRange);
+
+    // The fur depth timer reads zero on full resolution frames
+    const uint32_t path = m_fullResFurFrame ? 1 : 0;
+    m_furPathTotalMs[path] += m_gpuTimerMs[GpuTimerMain] + m_gpuTimerMs[GpuTimerFurDepth] + m_gpuTimerMs[GpuTimerResolve];
+    m_furPathFrames[path]++;
+
+    // PSInvocations counts pixel shader runs, i.e. fur pixels that survived the depth test
+    CD3DX12_RANGE statsRange(0, sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS));
+    D3D12_QUERY_DATA_PIPELINE_STATISTICS* pipelineStats = nullptr;
+    ThrowIfFailed(m_pipelineStatsReadback->Map(0, &statsRange, reinterpret_cast<void**>(&pipelineStats)));
+    m_furPixelsShaded = pipelineStats->PSInvocations;
+    m_furPixelsShadedTotal += m_furPixelsShaded;
+    m_pipelineStatsReadback->Unmap(0, &writeRange);
+}
+
+void FurRenderer::ReportFrameStats() {
+    const uint32_t reportInterval = 240;
+    if (++m_statsFrameCount < reportInterval) return;
+
+    const OsmSchedulerStats& osm = m_framePipeline.OsmSchedule().Stats();
+    const OcclusionStats& occlusion = m_framePipeline.Occlusion().Stats(); // Last frame only
+    const Bvh4Stats& bvh = m_framePipeline.ClusterBvh().Stats();
+    const SkinningStats& skinning = m_framePipeline.Skinning().Stats();
+    const double halfResMs = m_furPathFrames[0] ? m_furPathTotalMs[0] / m_furPathFrames[0] : 0.0;
+    const double fullResMs = m_furPathFrames[1] ? m_furPathTotalMs[1] / m_furPathFrames[1] : 0.0;
+    const double furDepthMs = m_furPathFrames[0] ? m_gpuTimerTotalMs[GpuTimerFurDepth] / m_furPathFrames[0] : 0.0;
+    // Both paths are only timed when comparing them
+    char furPaths[256];
+    if (m_furResolution == FurResolution::Compare) {
+        snprintf(furPaths, sizeof(furPaths), "Fur and resolve %.3f ms at half resolution (fur depth %.3f ms), %.3f ms at full resolution, %.1f%% saved",
+                 halfResMs, furDepthMs, fullResMs, fullResMs > 0.0 ? (1.0 - halfResMs / fullResMs) * 100.0 : 0.0);
+    } else if (m_furResolution == FurResolution::Full) {
+        snprintf(furPaths, sizeof(furPaths), "Fur and resolve %.3f ms at full resolution", fullResMs);
+    } else {
+        snprintf(furPaths, sizeof(furPaths), "Fur and resolve %.3f ms at half resolution (fur depth %.3f ms)", halfResMs, furDepthMs);
+    }
+    char buffer[1024];
+    snprintf(buffer, sizeof(buffer),
+        "GPU avg over %u frames: OSM %.3f ms, Skin %.3f ms, Fur %.3f ms, %.2fM fur pixels shaded"
+        " | %s"
+        " | OSM full %llu, partial %llu, reused %llu, raster work saved %.1f%%"
+        " | Occlusion raster %.3f ms, test %.3f ms, %u/%u clusters culled (%.1f%% of triangles)"
+        " | CPU frame %.3f ms, BVH query %.3f ms, %llu nodes | Skinning %.3f ms (%.1fM vertices/s)"
+        " | %u draws, %u material switches over %u materials"
+        " | Graph %u passes (%u culled), %u barriers (%u split), transients %.1f MB in a %.1f MB heap\n",
+        m_statsFrameCount,
+        m_gpuTimerTotalMs[GpuTimerOsm] / m_statsFrameCount,
+        m_gpuTimerTotalMs[GpuTimerSkin] / m_statsFrameCount,
+        m_gpuTimerTotalMs[GpuTimerMain] / m_statsFrameCount,
+        (double)m_furPixelsShadedTotal / m_statsFrameCount / 1e6,
+        furPaths,
+        (unsigned long long)osm.FullRefreshes, (unsigned long long)osm.PartialRefreshes, (unsigned long long)osm.Reuses,
+        osm.SavedFraction() * 100.0,
+        occlusion.RasterMs, occlusion.TestMs, occlusion.CulledClusters, occlusion.TestedClusters,
+        occlusion.CulledTriangleFraction() * 100.0,
+        m_framePipeline.Stats().TotalMs, bvh.QueryMs, (unsigned long long)bvh.QueryNodesVisited,
+        skinning.SkinMs, skinning.VerticesPerSecond() / 1e6,
+        m_frameDrawCalls, m_frameMaterialSwitches, m_furMaterialCount,
+        m_renderGraphStats.PassCount, m_renderGraphStats.CulledPasses, m_renderGraphStats.Barriers, m_renderGraphStats.SplitBarriers,
+        m_renderGraphStats.TransientBytes / (1024.0 * 1024.0), m_renderGraphStats.HeapBytes / (1024.0 * 1024.0));
+    OutputDebugStringA(buffer);
+
+    m_statsFrameCount = 0;
+    for (UINT i = 0; i < GpuTimerCount; i++) m_gpuTimerTotalMs[i] = 0.0;
+    for (uint32_t i = 0; i < 2; i++) {
+        m_furPathTotalMs[i] = 0.0;
+        m_furPathFrames[i] = 0;
+    }
+    m_furPixelsShadedTotal = 0;
+    m_framePipeline.OsmSchedule().ResetStats();
+}
+
+void FurRenderer::DrawClusterRanges(const std::vector<DrawRange>& ranges, uint32_t indicesPerTriangle, uint32_t instanceCount) {
+    // Index buffers are in cluster order, so each range is one contiguous draw. Switching
+    // material is a single root constant, so the cost per draw doesn't grow with the material count.
+    uint32_t boundMaterial = UINT32_MAX;
+    for (const DrawRange& range : ranges) {
+        if (range.Material != boundMaterial) {
+            boundMaterial = range.Material;
+            m_commandList->SetGraphicsRoot32BitConstant(4, boundMaterial, 0);
+            m_frameMaterialSwitches++;
+        }
+        m_frameDrawCalls++;
+        m_commandList->DrawIndexedInstanced(range.TriangleCount * indicesPerTriangle, instanceCount,
+                                            range.FirstTriangle * indicesPerTriangle, 0, 0);
+    }
+}
+
+void FurRenderer::DrawCoatRanges(const std::vector<DrawRange>& ranges) {
+    uint32_t boundMaterial = UINT32_MAX;
+    for (const DrawRange& range : ranges) {
+        if (range.Material != boundMaterial) {
+            boundMaterial = range.Material;
+            m_commandList->SetGraphicsRoot32BitConstant(4, boundMaterial, 0);
+            m_frameMaterialSwitches++;
+        }
+        m_frameDrawCalls++;
+        const uint32_t shells = range.Material < m_coatInstances.size() ? m_coatInstances[range.Material] : FramePipeline::ShellInstances;
+        m_commandList->DrawIndexedInstanced(range.TriangleCount * 3, shells, range.FirstTriangle * 3, 0, 0);
+    }
 }
 
 void FurRenderer::FlushCommandQueue() {
     m_currentFence++;
     ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_currentFence));
-    if (m_fence->GetCompletedValue() < m_currentFence) {
+    WaitForFence(m_currentFence);
+}
+
+void FurRenderer::WaitForFence(UINT64 value) {
+    if (m_fence->GetCompletedValue() < value) {
         HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(m_fence->SetEventOnCompletion(m_currentFence, eventHandle));
+        ThrowIfFailed(m_fence->SetEventOnCompletion(value, eventHandle));
         WaitForSingleObject(eventHandle, INFINITE);
         CloseHandle(eventHandle);
     }
@@ -11,6 +11,19 @@
 #include <vector>
 
 #include "d3dx12.h"
+#include "JobSystem.h"
+#include "RenderGraph.h"
+#include "FramePipeline.h"
+#include "FrameScript.h"
+#include "GeometryGen.h"
+#include "AssetGraph.h"
+#include "FileWatcher.h"
+#include "FurVolume.h"
+#include "FurCoat.h"
+#include "LodStream.h"
+#include "DescriptorAllocator.h"
+#include <memory>
+#include <mutex>
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -25,6 +38,19 @@ public:
     void Render();
     void Resize(uint32_t width, uint32_t height);
 
+    // Plays 'script' from its start instead of the default orbit, at the live frame rate
+    void PlayScript(const FrameScript& script);
+    // Records every frame's scene into a script, saved to 'path' when the renderer shuts down
+    void RecordTo(const std::string& path);
+    // Draws a generated scene instead of the carpet glTF; call before Init
+    void UseSyntheticScene(const SynthScene& scene);
+
+    // Fins, shells and impostor layers at half resolution (the default) or at full resolution.
+    // Compare alternates the two every frame so the stats report can time one path against the
+    // other; it is a measurement mode, not for viewing.
+    enum class FurResolution { Half, Full, Compare };
+    void SetFurResolution(FurResolution resolution) { m_furResolution = resolution; }
+
 private:
     void InitD3D12();
     void CreateCommandObjects();
@@ -32,30 +58,142 @@ private:
     void CreateRtvAndDsvDescriptorHeaps();
     void CreateRootSignature();
     void CreateConstantBuffers();
-    void CreateShadersAndPSOs();
     void BuildRenderItems();
+    void CreateGpuTimers();
+    void ReadGpuTimers();
+    void ReportFrameStats();
+    void CreateColorMaps(ID3D12GraphicsCommandList* list, const std::vector<TextureImage>& textures,
+                         std::vector<ComPtr<ID3D12Resource>>& uploadBuffers);
+    void DrawClusterRanges(const std::vector<DrawRange>& ranges, uint32_t indicesPerTriangle, uint32_t instanceCount);
+    // Shell draws: each material instances the shells of its coat
+    void DrawCoatRanges(const std::vector<DrawRange>& ranges);
+    // 'downscale' divides the size, rounding up
+    RgTextureDesc MakeTransientDesc(DXGI_FORMAT format, bool depthStencil, const float clearValue[4], uint32_t downscale = 1) const;
+    // 'viewSlots' gives each used transient its RTV slot or, for depth, the first of its DSV pair
+    void RealizeTransients(const RenderGraph& graph, std::vector<ID3D12Resource*>& physical, const std::vector<UINT>& viewSlots);
+    void SubmitBarriers(const std::vector<RgBarrier>& barriers, const std::vector<ID3D12Resource*>& physical);
     void FlushCommandQueue();
-    
-    // Core parameters from original setup
-    struct FrameCB {
-        XMMATRIX ViewProj;
-        XMMATRIX World;
-        XMMATRIX LightViewProj; // Added LightViewProj
-        XMFLOAT3 CameraPos;
-        float Time;
-        XMFLOAT3 Gravity;
-        float WindStrength;
-        XMFLOAT3 WindDirection;
-        float Padding;
+    void WaitForFence(UINT64 value);
+
+    // Hot reload. Shader variants, PSOs, the scene's mesh data and the fur noise are nodes of an
+    // AssetGraph over the shader files, the scene's files and the bake settings. The initial load
+    // builds all of it; afterwards the watched files are polled at the frame boundary, and only
+    // the nodes downstream of a changed file are rebuilt, with their copies recorded on a separate
+    // upload list queued ahead of the frame. Replaced resources are released once the GPU is past them.
+    enum ShaderVariant : uint32_t {
+        ShaderShellVs = 0, ShaderShellPs, ShaderFinVs, ShaderFinGs, ShaderSkinVs, ShaderSkinPs, ShaderOsmPs,
+        ShaderImpostorVs, ShaderImpostorPs, ShaderFullscreenVs, ShaderFurDepthPs, ShaderResolvePs, ShaderVariantCount
+    };
+    enum PipelineKind : uint32_t {
+        PipelineShell = 0, PipelineFin, PipelineImpostor, PipelineOpaque, PipelineOsm, PipelineOsmDepth, PipelineFurDepth,
+        PipelineResolve, PipelineCount
     };
+    // What a scene load produces, each uploaded on its own: vertex and index buffers, the static
+    // occlusion and tangent streams, materials with their colour maps, the groom map
+    enum MeshPart : uint32_t { MeshPartGeometry = 0, MeshPartStreams, MeshPartMaterials, MeshPartGroom, MeshPartCount };
+    static constexpr float HotReloadInterval = 0.5f; // Seconds between polls
 
-    struct FurCB {
-        float FurLength;
-        uint32_t ShellCount;
+    void InitAssetGraph();
+    void HotReload(float deltaTime);
+    // Builds the planned nodes that need it, recording copies on 'list'. The initial load throws
+    // on failure; a reload logs it and keeps the previous result.
+    void BuildAssets(const std::vector<AssetId>& plan, ID3D12GraphicsCommandList* list,
+                     std::vector<ComPtr<ID3D12Resource>>& uploadBuffers, bool initial);
+    bool BuildAsset(AssetId id, ID3D12GraphicsCommandList* list, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers,
+                    uint64_t& outputHash);
+    // Empty if the scene can't be loaded; safe on any thread
+    MeshData LoadScene(JobSystem& jobs);
+    std::vector<std::string> SceneFiles() const;
+    bool CreatePipelineState(PipelineKind kind);
+    void UploadGeometry(ID3D12GraphicsCommandList* list, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers);
+    // Animated meshes draw from it instead of a static vertex buffer
+    void CreateSkinnedVertexRing(const MeshData& mesh);
+    void UploadVertexStreams(ID3D12GraphicsCommandList* list, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers);
+    void UploadMaterials(ID3D12GraphicsCommandList* list, const MeshData& mesh, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers);
+    void UploadGroomMap(ID3D12GraphicsCommandList* list, const MeshData& mesh, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers);
+    void UploadFurNoise(ID3D12GraphicsCommandList* list, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers);
+    void UploadFurVolume(ID3D12GraphicsCommandList* list, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers);
+    void SetPipelineMesh(const MeshData& mesh);
+    // Keeps 'object' alive until the GPU is past the next fence signalled (the upload or the frame)
+    void Retire(const ComPtr<ID3D12Pageable>& object);
+    void ReleaseRetired();
+    // Writes a view of 'resource' into a fresh persistent heap slot and frees the one 'handle'
+    // held, by fence like Retire, so commands in flight keep reading the old view
+    void WriteSrv(DescriptorHandle& handle, ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc);
+    void FreeSrv(DescriptorHandle& handle);
+    // The frame's light lists, viewed from its descriptor ring
+    void WriteLightSrvs();
+
+    // Progressive scene load. The first build of the mesh asset puts the sphere on screen and
+    // hands the scene to a LodStreamer: its workers load the scene, cluster coarse LODs from it
+    // (MeshStreamer::ProcessInCore) and list each level's vertex, index and stream buffers, which
+    // Update streams on the upload list within StreamFrameBudget bytes a frame. A level is drawn
+    // from the frame after its copies retire. Skinned scenes only stream the full mesh. A reload
+    // of the scene's files replaces the stream.
+    static constexpr uint32_t SceneLodGrids[2] = { 32, 128 }; // Cells along the longest axis; then the full mesh
+    static constexpr uint32_t SceneLodCount = 3;
+    static constexpr UINT64 StreamFrameBudget = 8ull << 20;
+    enum SceneSection : uint32_t {
+        SceneSectionVertices = 0, SceneSectionIndices, SceneSectionIndicesAdj, SceneSectionOcclusion, SceneSectionTangents,
+        SceneSectionCount
+    };
+    struct SceneStream {
+        std::once_flag SourceLoaded;
+        MeshData Source;              // The scene as LoadScene returns it; the finest level
+        std::vector<MeshData> Levels; // Coarse levels, each written by its builder alone
+        bool MaterialsUploaded = false;
+        std::unique_ptr<LodStreamer> Streamer; // Last, so the builders are joined before the meshes go
+    };
+    // LodStreamer's GPU side. Each section of a level gets a default-heap buffer, left in the
+    // common state: buffers are promoted to copy destination by the copies and to vertex or
+    // index buffer by the draws, and decay back in between. The copies go through m_streamArena,
+    // a persistently mapped upload buffer of StreamFrameBudget bytes, free again every frame since
+    // every frame ends in FlushCommandQueue.
+    class SceneUploadQueue : public LodUploadQueue {
+    public:
+        explicit SceneUploadQueue(FurRenderer& renderer) : m_renderer(renderer) {}
+        void BeginLevel(uint32_t level, const std::vector<LodSection>& sections) override;
+        void Upload(uint32_t level, uint32_t section, uint64_t offset, const void* data, uint64_t size) override;
+        uint64_t EndLevel(uint32_t level) override;
+        uint64_t CompletedFence() override;
+
+        std::vector<ComPtr<ID3D12Resource>> Buffers[SceneLodCount]; // By level, then section
+        UINT64 ArenaOffset = 0;
+
+    private:
+        FurRenderer& m_renderer;
+    };
+    void StartSceneStream();
+    // On a worker: loads the source on the first call, then lists the level's sections
+    bool BuildSceneLevel(SceneStream& stream, uint32_t level, JobSystem& jobs, std::vector<LodSection>& sections);
+    // Once per frame, before the frame's commands
+    void StreamScene();
+    void SwapSceneLevel(uint32_t level, std::vector<ComPtr<ID3D12Resource>>& uploadBuffers);
+
+    // One coat layer of a material, as FurCoat plans it; heights are fractions of FurLength
+    struct CoatLayerCB {
+        float Length;
         float Density;
         float Thickness;
+        uint32_t NoiseChannel;
+        XMFLOAT3 Color;
+        float Reach;        // Height of the layer's top shell
+        uint32_t LastShell; // Last instance of the layer's segment
+        uint32_t Padding[3];
+    };
+
+    // One StructuredBuffer entry per material (240 bytes, no cbuffer padding rules apply)
+    struct FurCB {
+        float FurLength;    // The longest layer
+        uint32_t ShellCount;
+        float Density;      // Density, Thickness and FurColor are the outermost layer's, for the
+        float Thickness;    // fins and impostor layers
         XMFLOAT3 FurColor;
-        float Padding;
+        uint32_t ColorMap; // Heap slot of the colour map, UINT32_MAX for none
+        uint32_t LayerCount;
+        uint32_t ShellInstances; // Of the coat draw
+        uint32_t Padding[2];
+        CoatLayerCB Layers[FurCoat::MaxLayers];
     };
 
     // D3D12 Context
@@ -76,11 +214,10 @@ private:
     static const int SwapChainBufferCount = 2;
     int m_currentBackBuffer = 0;
     ComPtr<ID3D12Resource> m_swapChainBuffer[SwapChainBufferCount];
-    ComPtr<ID3D12Resource> m_depthStencilBuffer;
 
     ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
     ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
-    ComPtr<ID3D12DescriptorHeap> m_cbvSrvUavHeap;
+    ComPtr<ID3D12DescriptorHeap> m_cbvSrvUavHeap; // Every SRV, bound whole (see m_descriptors)
     
     UINT m_rtvDescriptorSize = 0;
     UINT m_dsvDescriptorSize = 0;
@@ -89,37 +226,216 @@ private:
     D3D12_VIEWPORT m_viewport;
     D3D12_RECT m_scissorRect;
 
+    // Separate list for hot-reload copies, so they can be queued without resetting the frame's allocator
+    ComPtr<ID3D12CommandAllocator> m_uploadAllocator;
+    ComPtr<ID3D12GraphicsCommandList> m_uploadList;
+    UINT64 m_uploadFence = 0;
+    struct RetiredObject {
+        UINT64 Fence = 0;
+        ComPtr<ID3D12Pageable> Object;
+    };
+    std::vector<RetiredObject> m_retired;
+
+    AssetGraph m_assets;
+    FileWatcher m_watcher;
+    float m_hotReloadTimer = 0.0f;
+    AssetId m_shaderAssets[ShaderVariantCount] = {};
+    AssetId m_pipelineAssets[PipelineCount] = {};
+    AssetId m_meshAsset = InvalidAsset;
+    AssetId m_meshPartAssets[MeshPartCount] = {};   // Hash of one part of the loaded mesh
+    AssetId m_meshUploadAssets[MeshPartCount] = {}; // That part on the GPU
+    AssetId m_framePipelineAsset = InvalidAsset;
+    AssetId m_noiseAsset = InvalidAsset;
+    AssetId m_volumeAsset = InvalidAsset;
+    ComPtr<ID3DBlob> m_shaderBytecode[ShaderVariantCount];
+    MeshData m_loadedMesh;         // Only during a walk that reloaded the scene
+    FurNoiseSettings m_noiseSettings;
+    FurVolumeSettings m_volumeSettings;
+    std::vector<float> m_noiseData; // The volume is baked from it
+    float m_materialFurLength = 0.0f; // Longest fur of any material, before grooming
+    float m_groomLongestStrand = 1.0f;
+    bool m_meshAnimated = false;
+
     // Pipeline Objects
     ComPtr<ID3D12RootSignature> m_commonRootSignature;
     ComPtr<ID3D12PipelineState> m_shellPSO;
     ComPtr<ID3D12PipelineState> m_finPSO;
     ComPtr<ID3D12PipelineState> m_osmPSO;
+    ComPtr<ID3D12PipelineState> m_osmDepthPSO;
     ComPtr<ID3D12PipelineState> m_opaquePSO;
+    ComPtr<ID3D12PipelineState> m_impostorPSO;
+    ComPtr<ID3D12PipelineState> m_furDepthPSO;
+    ComPtr<ID3D12PipelineState> m_resolvePSO;
+
+    // Render graph transients (MSAA scene colour and depth, and the half-resolution fur's), placed
+    // and aliased in one heap. Kept across frames and only recreated when the compiled layout
+    // changes. Their views have fixed slots: RTVs after the swap chain's, DSV pairs (writable,
+    // read-only) after the OSM depth's.
+    struct TransientTexture {
+        std::string Name;
+        uint64_t HeapOffset = 0;
+        ComPtr<ID3D12Resource> Resource;
+    };
+    ComPtr<ID3D12Heap> m_transientHeap;
+    uint64_t m_transientHeapSize = 0;
+    std::vector<TransientTexture> m_transientTextures;
+    RenderGraphStats m_renderGraphStats;
+    static const UINT RtvSceneColor = SwapChainBufferCount;
+    static const UINT RtvOsm = SwapChainBufferCount + 1;
+    static const UINT RtvFurColor = SwapChainBufferCount + 2;
+    static const UINT RtvCount = SwapChainBufferCount + 3;
+    static const UINT DsvOsm = 0;
+    static const UINT DsvSceneDepth = 1;
+    static const UINT DsvFurDepth = 3;
+    static const UINT DsvCount = 5;
+
+    // Half-resolution fur (FurUpsample): fins, shells and impostor layers draw into half-size MSAA
+    // targets, depth tested against the nearest depth of each 2x2 block, and the resolve step
+    // composites them over the base pass with a depth-aware upsample. Full resolution frames (see
+    // SetFurResolution) draw the fur straight over the skin, resolved with ResolveSubresource as
+    // before. The two paths compile to different transient layouts; RealizeTransients replaces
+    // whatever moved.
+    FurResolution m_furResolution = FurResolution::Half;
+    bool m_fullResFurFrame = false;
 
     // Buffers and Textures
-    ComPtr<ID3D12Resource> m_msaaRenderTarget;
     ComPtr<ID3D12DescriptorHeap> m_msaaRtvHeap;
     ComPtr<ID3D12Resource> m_noiseTex;
     ComPtr<ID3D12Resource> m_frameCB;
     ComPtr<ID3D12Resource> m_lightFrameCB;
-    ComPtr<ID3D12Resource> m_furCB;
+    ComPtr<ID3D12Resource> m_furMaterials; // StructuredBuffer<FurCB>, one entry per material
     UINT8* m_frameCBMapped = nullptr;
     UINT8* m_lightFrameCBMapped = nullptr;
-    UINT8* m_furCBMapped = nullptr;
+    UINT8* m_furMaterialsMapped = nullptr;
+    uint32_t m_furMaterialCount = 0;
+    std::vector<uint32_t> m_coatInstances; // Shells each material's coat draw instances
+
+    // Bindless SRVs: the shaders see the whole of m_cbvSrvUavHeap as one table and index it with
+    // the slots in BindlessConstants, root constants set once per frame; materials carry the slot
+    // of their colour map. DescriptorAllocator hands out the slots: persistent ones for the
+    // assets' views, freed by fence when a reload replaces them, then a ring per frame in flight
+    // for the views rewritten every frame.
+    static const uint32_t PersistentDescriptors = 4096;
+    static const uint32_t TransientDescriptorsPerFrame = 64;
+    DescriptorAllocator m_descriptors{ PersistentDescriptors, TransientDescriptorsPerFrame, SwapChainBufferCount };
+    // Root parameter 3, BindlessCB in the shaders
+    struct BindlessConstants {
+        uint32_t Noise;
+        uint32_t OsmLayers;
+        uint32_t OsmDepth;
+        uint32_t FurVolume;
+        uint32_t GroomMap;
+        uint32_t Lights;
+        uint32_t LightClusters;
+        uint32_t LightIndices;
+        uint32_t SceneColor; // The transients, viewed from the frame's ring for the resolve step
+        uint32_t SceneDepth;
+        uint32_t FurColor;
+        uint32_t FurDepth;
+    };
+    DescriptorHandle m_noiseSrv;
+    DescriptorHandle m_osmSrv;
+    DescriptorHandle m_osmDepthSrv;
+    DescriptorHandle m_furVolumeSrv;
+    DescriptorHandle m_groomMapSrv;
+    std::vector<DescriptorHandle> m_colorMapSrvs; // Per colour map; invalid for failed decodes
+    uint32_t m_lightSrvs = UINT32_MAX;            // First of the frame's three light list views
+
+    // Fur volume for the distant-pelt impostor layers, baked from the noise at load (FurVolume)
+    ComPtr<ID3D12Resource> m_furVolume;
+    // Groomed strand directions and lengths in UV space (Grooming), read by the shell and fin
+    // extrusion; a neutral 1x1 map when the mesh has no guides
+    ComPtr<ID3D12Resource> m_groomMap;
+    // Cooked material colour maps
+    std::vector<ComPtr<ID3D12Resource>> m_colorMaps;
+
+    // The frame pipeline's clustered light lists (LightCuller), copied every Update into
+    // persistently mapped upload buffers and viewed from the frame's descriptor ring. Every frame
+    // ends in FlushCommandQueue, so one copy suffices; a buffer that is too small is replaced.
+    struct LightUploadBuffer {
+        ComPtr<ID3D12Resource> Resource;
+        UINT8* Mapped = nullptr;
+        UINT64 Capacity = 0;
+    };
+    LightUploadBuffer m_lightBuffer;        // StructuredBuffer<GpuLight>
+    LightUploadBuffer m_lightClusterBuffer; // StructuredBuffer<LightCluster>
+    LightUploadBuffer m_lightIndexBuffer;   // StructuredBuffer<uint>
+    void UploadLightData(LightUploadBuffer& buffer, const void* data, UINT64 byteSize);
     
-    ComPtr<ID3D12Resource> m_osmTextures[4];
+    // Deep opacity maps: all layers packed into one RGBA target, plus the light-space first-hit depth.
+    // Which bands are redrawn each frame is the frame pipeline's OSM schedule.
+    static const uint32_t OsmResolution = FramePipeline::OsmResolution;
+    ComPtr<ID3D12Resource> m_osmTexture;
+    ComPtr<ID3D12Resource> m_osmDepth;
     ComPtr<ID3D12DescriptorHeap> m_osmRtvHeap;
 
+    // GPU timestamps, a begin/end pair per timer, resolved to readback every frame
+    enum GpuTimer : UINT {
+        GpuTimerOsm = 0,
+        GpuTimerSkin,
+        GpuTimerMain,     // Fins and shells
+        GpuTimerFurDepth, // The half-resolution fur's depth; zero on full resolution frames
+        GpuTimerResolve,  // Composite and upsample, or the plain MSAA resolve on full resolution frames
+        GpuTimerCount
+    };
+    ComPtr<ID3D12QueryHeap> m_timestampHeap;
+    ComPtr<ID3D12Resource> m_timestampReadback;
+    UINT64 m_timestampFrequency = 0;
+    double m_gpuTimerMs[GpuTimerCount] = {};
+    double m_gpuTimerTotalMs[GpuTimerCount] = {};
+    // The fur and its resolve, summed by path over the report interval: half, then full resolution
+    double m_furPathTotalMs[2] = {};
+    uint32_t m_furPathFrames[2] = {};
+    // Pipeline statistics over the fin and shell draws, for the shaded pixel count
+    ComPtr<ID3D12QueryHeap> m_pipelineStatsHeap;
+    ComPtr<ID3D12Resource> m_pipelineStatsReadback;
+    uint64_t m_furPixelsShaded = 0;
+    uint64_t m_furPixelsShadedTotal = 0;
+    uint32_t m_statsFrameCount = 0;
+    uint32_t m_frameDrawCalls = 0;
+    uint32_t m_frameMaterialSwitches = 0;
+
     ComPtr<ID3D12Resource> m_vertexBuffer;
     ComPtr<ID3D12Resource> m_indexBuffer;
     ComPtr<ID3D12Resource> m_indexBufferAdj;
+    ComPtr<ID3D12Resource> m_occlusionBuffer; // VertexOcclusion per vertex, input slot 1
+    ComPtr<ID3D12Resource> m_tangentBuffer;   // VertexTangent per vertex, input slot 2
     
     D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
+    D3D12_VERTEX_BUFFER_VIEW m_occlusionBufferView;
+    D3D12_VERTEX_BUFFER_VIEW m_tangentBufferView;
     D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
     D3D12_INDEX_BUFFER_VIEW m_indexBufferAdjView;
     
     uint32_t m_indexCount = 0;
     uint32_t m_indexCountAdj = 0;
+
+    FurCB m_furParams = {}; // Shared settings; FurLength is the longest of any material
+
+    // The CPU side of every frame: skinning, OSM schedule, culling, draw lists and constants.
+    // m_jobs must be declared before the pipeline.
+    JobSystem m_jobs;
+    FramePipeline m_framePipeline{ m_jobs };
+
+    // Scene input: the default orbit or a loaded script, optionally recorded
+    FrameScript m_script = FrameScript::DefaultOrbit();
+    FrameScript m_recording;
+    std::string m_recordPath;
+    float m_time = 0.0f;
+
+    SynthScene m_syntheticScene; // No objects: load the carpet glTF
+
+    // Until the finest level of the scene is on screen
+    std::unique_ptr<SceneStream> m_sceneStream;
+    SceneUploadQueue m_sceneUploads{ *this };
+    ComPtr<ID3D12Resource> m_streamArena;
+    UINT8* m_streamArenaMapped = nullptr;
+
+    // Animated meshes: every frame the pipeline skins straight into one slot of this
+    // persistently mapped upload ring, which the draws read as their vertex buffer
+    ComPtr<ID3D12Resource> m_skinnedVertexRing;
+    UINT8* m_skinnedVertexRingMapped = nullptr;
+    uint32_t m_skinnedRingSlot = 0;
 };
 
 #endif
@@ -0,0 +1,80 @@
+#include "FurUpsample.h"
+#include <algorithm>
+#include <cmath>
+
+DepthImage FurUpsample::DownsampleDepth(const DepthImage& depth) {
+    DepthImage half;
+    half.Width = HalfSize(depth.Width);
+    half.Height = HalfSize(depth.Height);
+    half.Depth.resize((size_t)half.Width * half.Height);
+    for (uint32_t y = 0; y < half.Height; y++) {
+        for (uint32_t x = 0; x < half.Width; x++) {
+            // Odd sizes: the last block is one pixel wide or tall
+            const uint32_t x1 = std::min(x * 2 + 1, depth.Width - 1), y1 = std::min(y * 2 + 1, depth.Height - 1);
+            half.Depth[(size_t)y * half.Width + x] = std::min({ depth.At(x * 2, y * 2), depth.At(x1, y * 2),
+                                                                depth.At(x * 2, y1), depth.At(x1, y1) });
+        }
+    }
+    return half;
+}
+
+// Device depth is hyperbolic: 1 - z is close to proportional to one over view depth, so the
+// relative difference of 1 - z is the relative difference of view depth
+float FurUpsample::DepthWeight(float pixelDepth, float texelDepth, float tolerance) {
+    const float d = std::fabs(texelDepth - pixelDepth) / std::max(1.0f - pixelDepth, 1e-7f) / tolerance;
+    return 1.0f / (1.0f + d * d);
+}
+
+void FurUpsample::UpsamplePixel(const FurImage& halfFur, const DepthImage& halfDepth, uint32_t x, uint32_t y, float depth,
+                                const FurUpsampleSettings& settings, float out[4]) {
+    // Pixel centres in texel units: even pixels are a quarter texel before a texel centre, odd
+    // ones a quarter after
+    const float hx = (x + 0.5f) * 0.5f - 0.5f, hy = (y + 0.5f) * 0.5f - 0.5f;
+    const float fx0 = std::floor(hx), fy0 = std::floor(hy);
+    const float fx = hx - fx0, fy = hy - fy0;
+    const int32_t maxX = (int32_t)halfFur.Width - 1, maxY = (int32_t)halfFur.Height - 1;
+
+    uint32_t tx[4], ty[4];
+    float weights[4];
+    float total = 0.0f;
+    for (uint32_t i = 0; i < 4; i++) {
+        tx[i] = (uint32_t)std::clamp((int32_t)fx0 + (int32_t)(i & 1), 0, maxX);
+        ty[i] = (uint32_t)std::clamp((int32_t)fy0 + (int32_t)(i >> 1), 0, maxY);
+        weights[i] = ((i & 1) ? fx : 1.0f - fx) * ((i >> 1) ? fy : 1.0f - fy);
+        if (settings.DepthAware) weights[i] *= DepthWeight(depth, halfDepth.At(tx[i], ty[i]), settings.DepthTolerance);
+        total += weights[i];
+    }
+
+    if (settings.DepthAware && total < settings.MinWeight) {
+        uint32_t nearest = 0;
+        for (uint32_t i = 1; i < 4; i++) {
+            if (std::fabs(halfDepth.At(tx[i], ty[i]) - depth) < std::fabs(halfDepth.At(tx[nearest], ty[nearest]) - depth)) nearest = i;
+        }
+        for (uint32_t i = 0; i < 4; i++) weights[i] = i == nearest ? 1.0f : 0.0f;
+        total = 1.0f;
+    }
+
+    for (uint32_t c = 0; c < 4; c++) out[c] = 0.0f;
+    for (uint32_t i = 0; i < 4; i++) {
+        const float* texel = halfFur.Pixel(tx[i], ty[i]);
+        for (uint32_t c = 0; c < 4; c++) out[c] += texel[c] * weights[i];
+    }
+    for (uint32_t c = 0; c < 4; c++) out[c] /= total;
+}
+
+void FurUpsample::Composite(const FurImage& base, const DepthImage& depth, const FurImage& halfFur, const DepthImage& halfDepth,
+                            const FurUpsampleSettings& settings, FurImage& out) {
+    out.Width = base.Width;
+    out.Height = base.Height;
+    out.Rgba.resize(base.Rgba.size());
+    for (uint32_t y = 0; y < base.Height; y++) {
+        for (uint32_t x = 0; x < base.Width; x++) {
+            float fur[4];
+            UpsamplePixel(halfFur, halfDepth, x, y, depth.At(x, y), settings, fur);
+            const float* b = base.Pixel(x, y);
+            float* o = out.Pixel(x, y);
+            for (uint32_t c = 0; c < 3; c++) o[c] = b[c] * (1.0f - fur[3]) + fur[c];
+            o[3] = 1.0f;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Half-resolution fur. The shells and fins are drawn into a half-resolution MSAA target, depth
+// tested against the nearest depth of each 2x2 block of the full-resolution base pass, so a fur
+// pixel costs a quarter as much. The resolve step then puts the fur over the base: each full
+// resolution pixel takes the four half-resolution texels around it with bilinear weights, scaled
+// down for texels whose depth differs from the pixel's (a texel across a silhouette shows another
+// surface's fur). Colour is interpolated premultiplied by coverage, so texels the fur does not
+// cover lower the coverage without darkening the fur. Where no texel is at the pixel's depth (a
+// thin occluder took the whole block), the texel of nearest depth is used alone.
+//
+// This is the CPU reference of resolve_ps; PelageFurUpsampleBench tests it on images with known
+// answers.
+
+// RGBA per pixel, rows top to bottom. Fur images hold premultiplied colour and coverage in A.
+struct FurImage {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    std::vector<float> Rgba;
+
+    float* Pixel(uint32_t x, uint32_t y) { return &Rgba[((size_t)y * Width + x) * 4]; }
+    const float* Pixel(uint32_t x, uint32_t y) const { return &Rgba[((size_t)y * Width + x) * 4]; }
+};
+
+// Device depth per pixel, 0 near to 1 far
+struct DepthImage {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    std::vector<float> Depth;
+
+    float At(uint32_t x, uint32_t y) const { return Depth[(size_t)y * Width + x]; }
+};
+
+struct FurUpsampleSettings {
+    float DepthTolerance = 0.01f; // Relative view depth difference at which a texel's weight halves
+    float MinWeight = 0.05f;      // Total weight below which the nearest-depth texel is used alone
+    bool DepthAware = true;       // False for plain bilinear, to compare against
+};
+
+class FurUpsample {
+public:
+    static uint32_t HalfSize(uint32_t size) { return (size + 1) / 2; }
+
+    // What the fur passes test against: the nearest depth of each 2x2 block
+    static DepthImage DownsampleDepth(const DepthImage& depth);
+
+    // The fur at full resolution pixel (x, y) of depth 'depth': premultiplied colour and coverage
+    static void UpsamplePixel(const FurImage& halfFur, const DepthImage& halfDepth, uint32_t x, uint32_t y, float depth,
+                              const FurUpsampleSettings& settings, float out[4]);
+
+    // The resolve step: every pixel of 'base' with the upsampled fur over it, alpha 1
+    static void Composite(const FurImage& base, const DepthImage& depth, const FurImage& halfFur, const DepthImage& halfDepth,
+                          const FurUpsampleSettings& settings, FurImage& out);
+
+    // How much a texel of depth 'texelDepth' counts for a pixel of depth 'pixelDepth', in (0, 1]
+    static float DepthWeight(float pixelDepth, float texelDepth, float tolerance);
+};
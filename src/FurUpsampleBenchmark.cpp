@@ -0,0 +1,294 @@
+// Headless half-resolution fur benchmark. First checks FurUpsample on images with known answers:
+//   no fur              fur with no coverage leaves the base untouched
+//   flat fur            constant fur over constant depth comes back exactly
+//   gradient            a linear ramp comes back exactly away from the border, at odd sizes too,
+//                       so full resolution pixels line up with the half-resolution texels
+//   depth edge          fur on both sides of a silhouette on an odd column keeps to its side;
+//                       plain bilinear does not
+//   coverage edge       where coverage falls off the fur keeps its colour instead of darkening
+//   thin occluder       a one pixel line takes its blocks' depth, the fur around it is filled in
+//                       from the neighbouring texels and none lands on the line
+//   nearest fallback    with no texel at the pixel's depth the nearest one is used alone
+// Then draws a synthetic furry scene with silhouettes and thin occluders at full resolution and at
+// half resolution, and reports the error of nearest, bilinear and depth-aware upsampling against
+// full resolution, over the whole image and near depth edges, and the cost of the reference.
+// Usage: PelageFurUpsampleBench [width] [height]
+#include "BenchReport.h"
+#include "FurUpsample.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+// What a scene shows at a point given in full resolution pixel units
+struct SceneSample {
+    float Depth = 1.0f;
+    float Base[3] = {};
+    float Fur[4] = {}; // Premultiplied
+};
+
+using Scene = std::function<SceneSample(float x, float y)>;
+
+struct RenderedScene {
+    FurImage Base;
+    DepthImage Depth;
+    FurImage Fur;        // At full resolution, the reference
+    FurImage HalfFur;
+    DepthImage HalfDepth;
+};
+
+static FurImage MakeImage(uint32_t width, uint32_t height) {
+    FurImage image;
+    image.Width = width;
+    image.Height = height;
+    image.Rgba.assign((size_t)width * height * 4, 0.0f);
+    return image;
+}
+
+// The base pass and the fur at full resolution sample pixel centres. The fur at half resolution
+// samples texel centres, which sit on full resolution pixel corners, and is depth tested against
+// the nearest depth of its block, as the fur passes are.
+static RenderedScene Render(const Scene& scene, uint32_t width, uint32_t height) {
+    RenderedScene r;
+    r.Base = MakeImage(width, height);
+    r.Fur = MakeImage(width, height);
+    r.Depth.Width = width;
+    r.Depth.Height = height;
+    r.Depth.Depth.resize((size_t)width * height);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const SceneSample s = scene(x + 0.5f, y + 0.5f);
+            r.Depth.Depth[(size_t)y * width + x] = s.Depth;
+            std::copy(s.Base, s.Base + 3, r.Base.Pixel(x, y));
+            r.Base.Pixel(x, y)[3] = 1.0f;
+            std::copy(s.Fur, s.Fur + 4, r.Fur.Pixel(x, y));
+        }
+    }
+    r.HalfDepth = FurUpsample::DownsampleDepth(r.Depth);
+    r.HalfFur = MakeImage(r.HalfDepth.Width, r.HalfDepth.Height);
+    for (uint32_t y = 0; y < r.HalfDepth.Height; y++) {
+        for (uint32_t x = 0; x < r.HalfDepth.Width; x++) {
+            const SceneSample s = scene(x * 2.0f + 1.0f, y * 2.0f + 1.0f);
+            if (s.Depth <= r.HalfDepth.At(x, y)) std::copy(s.Fur, s.Fur + 4, r.HalfFur.Pixel(x, y));
+        }
+    }
+    return r;
+}
+
+// The base with the full resolution fur over it
+static FurImage Reference(const RenderedScene& r) {
+    FurImage out = MakeImage(r.Base.Width, r.Base.Height);
+    for (size_t i = 0; i < out.Rgba.size(); i += 4) {
+        for (uint32_t c = 0; c < 3; c++) out.Rgba[i + c] = r.Base.Rgba[i + c] * (1.0f - r.Fur.Rgba[i + 3]) + r.Fur.Rgba[i + c];
+        out.Rgba[i + 3] = 1.0f;
+    }
+    return out;
+}
+
+static float MaxError(const FurImage& a, const FurImage& b) {
+    float error = 0.0f;
+    for (size_t i = 0; i < a.Rgba.size(); i++) error = std::max(error, std::fabs(a.Rgba[i] - b.Rgba[i]));
+    return error;
+}
+
+static void SetFur(SceneSample& s, float r, float g, float b, float coverage) {
+    s.Fur[0] = r * coverage;
+    s.Fur[1] = g * coverage;
+    s.Fur[2] = b * coverage;
+    s.Fur[3] = coverage;
+}
+
+static SceneSample Flat(float depth, float base) {
+    SceneSample s;
+    s.Depth = depth;
+    s.Base[0] = s.Base[1] = s.Base[2] = base;
+    return s;
+}
+
+static bool Check() {
+    bool ok = true;
+    const FurUpsampleSettings bilateral;
+    FurUpsampleSettings bilinear;
+    bilinear.DepthAware = false;
+    FurImage out;
+
+    RenderedScene bare = Render([](float x, float y) { return Flat(0.99f, 0.1f + x * 0.01f + y * 0.002f); }, 64, 48);
+    FurUpsample::Composite(bare.Base, bare.Depth, bare.HalfFur, bare.HalfDepth, bilateral, out);
+    ok &= Report("no fur", MaxError(out, bare.Base) == 0.0f);
+
+    RenderedScene flat = Render([](float, float) {
+        SceneSample s = Flat(0.99f, 0.4f);
+        SetFur(s, 0.6f, 0.4f, 0.2f, 0.5f);
+        return s;
+    }, 64, 48);
+    FurUpsample::Composite(flat.Base, flat.Depth, flat.HalfFur, flat.HalfDepth, bilateral, out);
+    ok &= Report("flat fur", MaxError(out, Reference(flat)) < 1e-6f);
+
+    // The outermost pixels lie beyond the outermost texel centres (at even sizes) and are clamped
+    bool gradient = true;
+    for (uint32_t size : { 64u, 63u }) {
+        RenderedScene ramp = Render([](float x, float y) {
+            SceneSample s = Flat(0.99f, 0.0f);
+            SetFur(s, x * 0.01f, y * 0.01f, 0.5f + (x - y) * 0.004f, 1.0f);
+            return s;
+        }, size, size - 16);
+        FurUpsample::Composite(ramp.Base, ramp.Depth, ramp.HalfFur, ramp.HalfDepth, bilateral, out);
+        const FurImage reference = Reference(ramp);
+        for (uint32_t y = 1; y + 1 < out.Height; y++) {
+            for (uint32_t x = 1; x + 1 < out.Width; x++) {
+                for (uint32_t c = 0; c < 4; c++) gradient &= std::fabs(out.Pixel(x, y)[c] - reference.Pixel(x, y)[c]) < 1e-5f;
+            }
+        }
+    }
+    ok &= Report("gradient", gradient);
+
+    // Red fur on the background, blue on a nearer surface from column 31 on
+    RenderedScene edge = Render([](float x, float) {
+        SceneSample s = Flat(x < 31.0f ? 0.995f : 0.96f, 0.2f);
+        if (x < 31.0f) SetFur(s, 1.0f, 0.0f, 0.0f, 1.0f);
+        else SetFur(s, 0.0f, 0.0f, 1.0f, 1.0f);
+        return s;
+    }, 64, 16);
+    FurUpsample::Composite(edge.Base, edge.Depth, edge.HalfFur, edge.HalfDepth, bilateral, out);
+    const float edgeError = MaxError(out, Reference(edge));
+    FurUpsample::Composite(edge.Base, edge.Depth, edge.HalfFur, edge.HalfDepth, bilinear, out);
+    ok &= Report("depth edge", edgeError < 0.01f && MaxError(out, Reference(edge)) > 0.2f);
+
+    RenderedScene silhouette = Render([](float x, float) {
+        SceneSample s = Flat(0.99f, 0.5f);
+        if (x < 31.0f) SetFur(s, 0.8f, 0.6f, 0.4f, 1.0f);
+        return s;
+    }, 64, 16);
+    bool straight = true, partial = false;
+    for (uint32_t x = 0; x < 64; x++) {
+        float fur[4];
+        FurUpsample::UpsamplePixel(silhouette.HalfFur, silhouette.HalfDepth, x, 8, 0.99f, bilateral, fur);
+        if (fur[3] < 0.01f) continue;
+        partial |= fur[3] < 0.99f;
+        straight &= std::fabs(fur[0] / fur[3] - 0.8f) < 1e-5f && std::fabs(fur[1] / fur[3] - 0.6f) < 1e-5f &&
+                    std::fabs(fur[2] / fur[3] - 0.4f) < 1e-5f;
+    }
+    ok &= Report("coverage edge", straight && partial);
+
+    // A bare line at column 33, in front of furry background
+    bool thin = true;
+    for (float line : { 33.0f, 32.0f }) {
+        RenderedScene occluded = Render([line](float x, float) {
+            if (x >= line && x < line + 1.0f) return Flat(0.9f, 0.0f);
+            SceneSample s = Flat(0.995f, 0.2f);
+            SetFur(s, 1.0f, 0.0f, 0.0f, 1.0f);
+            return s;
+        }, 64, 16);
+        FurUpsample::Composite(occluded.Base, occluded.Depth, occluded.HalfFur, occluded.HalfDepth, bilateral, out);
+        thin &= MaxError(out, Reference(occluded)) < 0.01f;
+    }
+    ok &= Report("thin occluder", thin);
+
+    FurImage quad = MakeImage(2, 2);
+    DepthImage quadDepth;
+    quadDepth.Width = quadDepth.Height = 2;
+    quadDepth.Depth = { 0.2f, 0.3f, 0.8f, 0.45f };
+    for (uint32_t i = 0; i < 16; i++) quad.Rgba[i] = (float)i / 16.0f;
+    float nearest[4];
+    FurUpsample::UpsamplePixel(quad, quadDepth, 1, 1, 0.5f, bilateral, nearest);
+    ok &= Report("nearest fallback", std::equal(nearest, nearest + 4, quad.Pixel(1, 1)));
+    return ok;
+}
+
+// Pseudo-fur: strands as a wavy stripe pattern in coverage, a few pixels across
+static float Strands(float x, float y, float phase) {
+    const float wave = 0.5f + 0.5f * std::sin(x * 0.45f + 3.0f * std::sin(y * 0.05f + phase) + phase);
+    return std::clamp(wave * 1.6f - 0.3f, 0.0f, 1.0f);
+}
+
+// Furry background, furry discs in front at two depths, and bare posts one and three pixels wide
+static SceneSample FurScene(float x, float y, float width, float height) {
+    struct Disc {
+        float X, Y, Radius, Depth;
+    };
+    const Disc discs[] = { { 0.3f, 0.4f, 0.2f, 0.97f }, { 0.65f, 0.6f, 0.17f, 0.95f }, { 0.8f, 0.25f, 0.1f, 0.96f } };
+    const float u = x / width, v = y / height;
+    const float post = std::fmod(x, width / 7.0f);
+    if (post < 1.0f || (post > width / 14.0f && post < width / 14.0f + 3.0f)) {
+        SceneSample s = Flat(0.9f, 0.15f);
+        return s;
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        const float dx = (u - discs[i].X) * width / height, dy = v - discs[i].Y;
+        if (dx * dx + dy * dy < discs[i].Radius * discs[i].Radius) {
+            SceneSample s = Flat(discs[i].Depth + dx * 0.01f, 0.3f);
+            SetFur(s, 0.35f + 0.2f * i, 0.3f, 0.5f - 0.15f * i, Strands(x, y, 1.7f * (i + 1)));
+            return s;
+        }
+    }
+    SceneSample s = Flat(0.995f, 0.45f);
+    SetFur(s, 0.8f, 0.6f, 0.4f, Strands(x, y, 0.0f));
+    return s;
+}
+
+static void Benchmark(uint32_t width, uint32_t height) {
+    const RenderedScene r = Render([width, height](float x, float y) { return FurScene(x, y, (float)width, (float)height); }, width, height);
+    const FurImage reference = Reference(r);
+
+    // Pixels within two of a depth discontinuity
+    std::vector<uint8_t> nearEdge((size_t)width * height, 0);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x + 1 < width; x++) {
+            const float d0 = r.Depth.At(x, y), d1 = r.Depth.At(x + 1, y);
+            if (std::fabs(d0 - d1) < 1e-3f) continue;
+            for (uint32_t i = x > 1 ? x - 1 : 0; i <= std::min(x + 2, width - 1); i++) nearEdge[(size_t)y * width + i] = 1;
+        }
+    }
+
+    printf("\n%ux%u, fur drawn at %ux%u: %.2fx fewer fur pixels\n", width, height, r.HalfDepth.Width, r.HalfDepth.Height,
+           (double)width * height / ((double)r.HalfDepth.Width * r.HalfDepth.Height));
+    printf("  %-10s %10s %14s %10s\n", "upsample", "PSNR dB", "edge PSNR dB", "ms");
+
+    auto measure = [&](const char* name, const std::function<void(FurImage&)>& composite) {
+        FurImage out;
+        Clock::time_point start = Clock::now();
+        composite(out);
+        const double ms = MillisecondsSince(start);
+        double error = 0.0, edgeError = 0.0;
+        size_t edgeCount = 0;
+        for (size_t p = 0; p < nearEdge.size(); p++) {
+            double e = 0.0;
+            for (uint32_t c = 0; c < 3; c++) e += (out.Rgba[p * 4 + c] - reference.Rgba[p * 4 + c]) * (out.Rgba[p * 4 + c] - reference.Rgba[p * 4 + c]);
+            error += e;
+            if (nearEdge[p]) {
+                edgeError += e;
+                edgeCount++;
+            }
+        }
+        const double psnr = 10.0 * std::log10(1.0 / std::max(error / (nearEdge.size() * 3), 1e-12));
+        const double edgePsnr = 10.0 * std::log10(1.0 / std::max(edgeError / (std::max<size_t>(edgeCount, 1) * 3), 1e-12));
+        printf("  %-10s %10.2f %14.2f %10.2f\n", name, psnr, edgePsnr, ms);
+    };
+
+    measure("nearest", [&](FurImage& out) {
+        out = MakeImage(width, height);
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                const float* fur = r.HalfFur.Pixel(x / 2, y / 2);
+                const float* base = r.Base.Pixel(x, y);
+                for (uint32_t c = 0; c < 3; c++) out.Pixel(x, y)[c] = base[c] * (1.0f - fur[3]) + fur[c];
+                out.Pixel(x, y)[3] = 1.0f;
+            }
+        }
+    });
+    FurUpsampleSettings bilinear;
+    bilinear.DepthAware = false;
+    measure("bilinear", [&](FurImage& out) { FurUpsample::Composite(r.Base, r.Depth, r.HalfFur, r.HalfDepth, bilinear, out); });
+    measure("bilateral", [&](FurImage& out) { FurUpsample::Composite(r.Base, r.Depth, r.HalfFur, r.HalfDepth, FurUpsampleSettings(), out); });
+}
+
+int main(int argc, char** argv) {
+    const uint32_t width = argc > 1 ? (uint32_t)std::max(atoi(argv[1]), 2) : 1280;
+    const uint32_t height = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 2) : 720;
+    bool ok = Check();
+    Benchmark(width, height);
+    return ok ? 0 : 1;
+}
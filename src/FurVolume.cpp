@@ -0,0 +1,248 @@
+#include "FurVolume.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+
+static uint64_t SplitMix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static float Wrap(float x) {
+    return x - std::floor(x);
+}
+
+size_t FurVolume::SizeInBytes() const {
+    size_t bytes = 0;
+    for (const FurVolumeLevel& level : Levels) bytes += level.Texels.size() * sizeof(uint16_t);
+    return bytes;
+}
+
+// Bilinear RG lookup in one level, texel centres at (i + 0.5) / width
+static void SampleLevel(const FurVolumeLevel& level, float u, float v, float rg[2]) {
+    float x = Wrap(u) * level.Width - 0.5f;
+    float y = Wrap(v) * level.Height - 0.5f;
+    float fx = std::floor(x), fy = std::floor(y);
+    float wx = x - fx, wy = y - fy;
+    uint32_t x0 = ((int32_t)fx + level.Width) % level.Width, x1 = (x0 + 1) % level.Width;
+    uint32_t y0 = ((int32_t)fy + level.Height) % level.Height, y1 = (y0 + 1) % level.Height;
+    for (int c = 0; c < 2; c++) {
+        float a = level.Texels[(y0 * level.Width + x0) * 2 + c], b = level.Texels[(y0 * level.Width + x1) * 2 + c];
+        float d = level.Texels[(y1 * level.Width + x0) * 2 + c], e = level.Texels[(y1 * level.Width + x1) * 2 + c];
+        rg[c] = ((a + (b - a) * wx) * (1.0f - wy) + (d + (e - d) * wx) * wy) * (1.0f / 65535.0f);
+    }
+}
+
+void FurVolume::Sample(float u, float v, float t, float mip, float& coverage, float& partialMean) const {
+    coverage = partialMean = 0.0f;
+    if (Levels.empty()) return;
+    float slice = std::clamp(t, 0.0f, 1.0f) * (Slices - 1);
+    uint32_t s0 = (uint32_t)slice, s1 = std::min(s0 + 1, Slices - 1);
+    mip = std::clamp(mip, 0.0f, (float)(MipLevels - 1));
+    uint32_t m0 = (uint32_t)mip, m1 = std::min(m0 + 1, MipLevels - 1);
+
+    const uint32_t slices[2] = { s0, s1 };
+    const float sliceWeights[2] = { 1.0f - (slice - s0), slice - s0 };
+    const uint32_t mips[2] = { m0, m1 };
+    const float mipWeights[2] = { 1.0f - (mip - m0), mip - m0 };
+    for (int s = 0; s < 2; s++) {
+        for (int m = 0; m < 2; m++) {
+            float rg[2];
+            SampleLevel(Levels[slices[s] * MipLevels + mips[m]], u, v, rg);
+            float weight = sliceWeights[s] * mipWeights[m];
+            coverage += rg[0] * weight;
+            partialMean += rg[1] * weight;
+        }
+    }
+}
+
+float FurVolumeBaker::SampleNoise(const float* noise, uint32_t noiseSize, float u, float v) {
+    float x = Wrap(u) * noiseSize - 0.5f;
+    float y = Wrap(v) * noiseSize - 0.5f;
+    float fx = std::floor(x), fy = std::floor(y);
+    float wx = x - fx, wy = y - fy;
+    uint32_t x0 = ((int32_t)fx + noiseSize) % noiseSize, x1 = (x0 + 1) % noiseSize;
+    uint32_t y0 = ((int32_t)fy + noiseSize) % noiseSize, y1 = (y0 + 1) % noiseSize;
+    float a = noise[y0 * noiseSize + x0], b = noise[y0 * noiseSize + x1];
+    float c = noise[y1 * noiseSize + x0], d = noise[y1 * noiseSize + x1];
+    return (a + (b - a) * wx) * (1.0f - wy) + (c + (d - c) * wx) * wy;
+}
+
+void FurVolumeBaker::GenerateNoise(const FurNoiseSettings& settings, std::vector<float>& noise) {
+    Clock::time_point start = Clock::now();
+    const uint32_t size = settings.Size;
+    const uint32_t cells = settings.Cells;
+
+    // Feature points, as many as cells but placed anywhere in the tile
+    struct Point2D { float x, y; };
+    std::vector<Point2D> points(cells * cells);
+    for (uint32_t i = 0; i < cells * cells; i++) {
+        points[i].x = (SplitMix64(settings.Seed + 2 * i) % 1000) / 1000.0f;
+        points[i].y = (SplitMix64(settings.Seed + 2 * i + 1) % 1000) / 1000.0f;
+    }
+
+    // Distance to the nearest point, wrapped so the tile repeats without seams
+    const float cellMaxDist = std::sqrt(0.5f * 0.5f + 0.5f * 0.5f) / cells * 2.0f;
+    noise.resize((size_t)size * size);
+    m_jobs.ParallelFor(size, 8, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                float u = (float)x / size;
+                float v = (float)y / size;
+                float minDist = 1.0f;
+                for (const Point2D& pt : points) {
+                    float dx = std::abs(u - pt.x);
+                    float dy = std::abs(v - pt.y);
+                    if (dx > 0.5f) dx = 1.0f - dx;
+                    if (dy > 0.5f) dy = 1.0f - dy;
+                    minDist = std::min(minDist, std::sqrt(dx * dx + dy * dy));
+                }
+                // Thickest at the points, tapering sharply towards the cell edges
+                float val = std::max(1.0f - minDist / cellMaxDist, 0.0f);
+                noise[y * size + x] = std::pow(val, 2.5f);
+            }
+        }
+    });
+    m_stats.NoiseMs = MillisecondsSince(start);
+}
+
+void FurVolumeBaker::Bake(const float* noise, uint32_t noiseSize, const FurVolumeSettings& settings, FurVolume& volume) {
+    Clock::time_point start = Clock::now();
+    const uint32_t downsample = std::max(settings.Downsample, 1u);
+    const uint32_t supersample = std::max(settings.Supersample, 1u);
+    const uint32_t slices = std::max(settings.Slices, 2u);
+    const uint32_t width = std::max(noiseSize / downsample, 1u);
+
+    volume.Width = volume.Height = width;
+    volume.Slices = slices;
+    volume.MipLevels = 1;
+    while ((width >> volume.MipLevels) > 0) volume.MipLevels++;
+
+    // Mip 0 in float, slice-major: C then M per texel
+    std::vector<std::vector<float>> levels(volume.MipLevels);
+    levels[0].assign((size_t)width * width * slices * 2, 0.0f);
+    const uint32_t samplesPerSide = downsample * supersample;
+    const float sampleWeight = 1.0f / (samplesPerSide * samplesPerSide);
+    const float thresholdScale = (float)(slices - 1);
+    m_jobs.ParallelFor(width, 1, [&](size_t begin, size_t end) {
+        std::vector<float> sums(slices * 2);
+        for (size_t y = begin; y < end; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                std::fill(sums.begin(), sums.end(), 0.0f);
+                for (uint32_t sy = 0; sy < samplesPerSide; sy++) {
+                    for (uint32_t sx = 0; sx < samplesPerSide; sx++) {
+                        // Evenly spread over the texel's footprint, as bilinear filtering sees the noise
+                        float u = (x * samplesPerSide + sx + 0.5f) / (width * samplesPerSide);
+                        float v = (y * samplesPerSide + sy + 0.5f) / (width * samplesPerSide);
+                        float n = SampleNoise(noise, noiseSize, u, v);
+                        // Covers every slice whose threshold s / (slices - 1) is at most n
+                        uint32_t covered = std::min((uint32_t)(std::max(n, 0.0f) * thresholdScale) + 1, slices);
+                        for (uint32_t s = 0; s < covered; s++) {
+                            sums[s * 2] += 1.0f;
+                            sums[s * 2 + 1] += n;
+                        }
+                    }
+                }
+                for (uint32_t s = 0; s < slices; s++) {
+                    size_t texel = ((size_t)s * width * width + y * width + x) * 2;
+                    levels[0][texel] = sums[s * 2] * sampleWeight;
+                    levels[0][texel + 1] = sums[s * 2 + 1] * sampleWeight;
+                }
+            }
+        }
+    });
+
+    // Box-filtered mips; C and M are averages, so this is exact
+    for (uint32_t mip = 1; mip < volume.MipLevels; mip++) {
+        const uint32_t src = width >> (mip - 1), dst = width >> mip;
+        levels[mip].resize((size_t)dst * dst * slices * 2);
+        m_jobs.ParallelFor((size_t)slices * dst, 16, [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; row++) {
+                size_t s = row / dst, y = row % dst;
+                const float* in = levels[mip - 1].data() + s * src * src * 2;
+                float* out = levels[mip].data() + s * dst * dst * 2;
+                for (uint32_t x = 0; x < dst; x++) {
+                    for (int c = 0; c < 2; c++) {
+                        out[(y * dst + x) * 2 + c] = 0.25f * (in[((2 * y) * src + 2 * x) * 2 + c] + in[((2 * y) * src + 2 * x + 1) * 2 + c] +
+                                                              in[((2 * y + 1) * src + 2 * x) * 2 + c] + in[((2 * y + 1) * src + 2 * x + 1) * 2 + c]);
+                    }
+                }
+            }
+        });
+    }
+
+    volume.Levels.assign((size_t)slices * volume.MipLevels, FurVolumeLevel());
+    for (uint32_t s = 0; s < slices; s++) {
+        for (uint32_t mip = 0; mip < volume.MipLevels; mip++) {
+            const uint32_t size = width >> mip;
+            FurVolumeLevel& level = volume.Levels[s * volume.MipLevels + mip];
+            level.Width = level.Height = size;
+            level.Texels.resize((size_t)size * size * 2);
+            const float* in = levels[mip].data() + (size_t)s * size * size * 2;
+            for (size_t i = 0; i < level.Texels.size(); i++) {
+                level.Texels[i] = (uint16_t)(std::clamp(in[i], 0.0f, 1.0f) * 65535.0f + 0.5f);
+            }
+        }
+    }
+
+    m_stats.BakeMs = MillisecondsSince(start);
+    m_stats.Bytes = volume.SizeInBytes();
+}
+
+float FurVolumeBaker::BandBoundary(uint32_t band, const FurImpostorParams& params) {
+    return (float)band / params.Layers * (params.ShellInstances - 1) / (params.ShellCount - 1);
+}
+
+FurImpostorLayer FurVolumeBaker::ImpostorLayer(const FurVolume& volume, float u, float v, float mip, uint32_t layer,
+                                               const FurImpostorParams& params) {
+    const float step = 1.0f / (params.ShellCount - 1);
+    const float top = BandBoundary(params.Layers, params);
+    const float bandLow = BandBoundary(layer, params);
+    const float bandHigh = BandBoundary(layer + 1, params);
+    const bool topBand = layer + 1 == params.Layers;
+
+    float cLow, mLow, cHigh, mHigh;
+    volume.Sample(u, v, bandLow * params.Thickness, mip, cLow, mLow);
+    volume.Sample(u, v, bandHigh * params.Thickness, mip, cHigh, mHigh);
+
+    // Correlated shells: a noise texel shows the highest shell it reaches, so the band is seen
+    // where noise falls within its thresholds, out of what no higher band covers. Tips sit half
+    // a shell below noise / Thickness on average; the top band also takes everything that
+    // reaches past the top shell.
+    const float inBand = std::max(cLow - cHigh, 0.0f);
+    const float clamped = topBand ? cHigh : 0.0f;
+    FurImpostorLayer correlated;
+    correlated.Alpha = topBand ? cLow : inBand / std::max(1.0f - cHigh, 1e-4f);
+    float heightSum = (mLow - mHigh) / params.Thickness - 0.5f * step * inBand + top * clamped;
+    correlated.Height = heightSum / std::max(inBand + clamped, 1e-4f);
+
+    // Uncorrelated shells: each of the band's shells covers its own fraction independently, the
+    // fractions interpolated between the band's ends, from the top shell down
+    const uint32_t firstShell = (uint32_t)std::ceil(bandLow / step - 1e-3f);
+    const uint32_t endShell = topBand ? params.ShellInstances : (uint32_t)std::ceil(bandHigh / step - 1e-3f);
+    float transmitted = 1.0f;
+    float hitHeight = 0.0f;
+    for (uint32_t shell = endShell; shell-- > firstShell;) {
+        float h = shell * step;
+        float c = cLow + (cHigh - cLow) * (h - bandLow) / (bandHigh - bandLow);
+        hitHeight += transmitted * c * h;
+        transmitted *= 1.0f - c;
+    }
+    FurImpostorLayer independent;
+    independent.Alpha = 1.0f - transmitted;
+    independent.Height = hitHeight / std::max(independent.Alpha, 1e-4f);
+
+    FurImpostorLayer result;
+    result.Alpha = std::clamp(independent.Alpha + (correlated.Alpha - independent.Alpha) * params.Correlation, 0.0f, 1.0f);
+    result.Height = std::clamp(independent.Height + (correlated.Height - independent.Height) * params.Correlation, bandLow, bandHigh);
+    return result;
+}
+
+float FurVolumeBaker::ImpostorCorrelation(float cosView, float furLengthTiles, const FurImpostorParams& params, uint32_t noiseCells) {
+    float cosine = std::clamp(std::abs(cosView), 1e-3f, 1.0f);
+    float tanView = std::sqrt(1.0f - cosine * cosine) / cosine;
+    float shiftCells = furLengthTiles * tanView * noiseCells / (params.ShellCount - 1);
+    return std::clamp(1.0f - 3.0f * shiftCells, 0.0f, 1.0f);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "JobSystem.h"
+#include <cstdint>
+#include <vector>
+
+// Distance LOD for the fur. The shells clip every strand against the same tileable Voronoi noise
+// (shell_ps: a shell at height h keeps the texels where noise >= h * Thickness), so how much of a
+// footprint is covered at height h depends only on the noise and the threshold t = h * Thickness.
+// The baker tabulates that once at load time, independent of the material:
+//   slice s of the volume is the threshold t = s / (Slices - 1)
+//   R = C(t), the fraction of the texel's footprint with noise >= t
+//   G = M(t), the footprint mean of noise * [noise >= t]
+// Both are plain averages, so every mip is a box filter of the one above and the shaders can
+// interpolate between slices. A far pelt draws a few impostor layers instead of its shells; each
+// layer stands for one band of shells and takes its opacity and the mean height of the strand
+// tips in it (which drives the root darkening) from C and M. Colour still comes from the
+// material and its colour map. The noise the shells sample is generated here too, so both
+// paths see identical strands.
+
+struct FurNoiseSettings {
+    uint32_t Size = 512; // Texels per side
+    uint32_t Cells = 32; // Voronoi cells per side
+    uint64_t Seed = 1;
+};
+
+struct FurVolumeSettings {
+    uint32_t Slices = 16;     // Threshold steps over [0, 1]
+    uint32_t Downsample = 4;  // Noise texels per volume texel side at mip 0
+    uint32_t Supersample = 2; // Bilinear noise samples per noise texel side
+};
+
+// One mip of one slice: RG16_UNORM texels
+struct FurVolumeLevel {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    std::vector<uint16_t> Texels;
+};
+
+struct FurVolume {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t Slices = 0;
+    uint32_t MipLevels = 0;
+    std::vector<FurVolumeLevel> Levels; // D3D12 subresource order: slice * MipLevels + mip
+
+    bool Empty() const { return Levels.empty(); }
+    size_t SizeInBytes() const;
+
+    // What the impostor shader reads: bilinear within a mip, linear between mips and slices,
+    // wrapping like the shells' sampler. (u, v) in noise tiles (mesh UV * Density).
+    void Sample(float u, float v, float t, float mip, float& coverage, float& partialMean) const;
+};
+
+// Where one band of shells shows up: its opacity over what lies below, and the mean height of
+// the strand tips seen in it
+struct FurImpostorLayer {
+    float Alpha = 0.0f;
+    float Height = 0.0f;
+};
+
+// Shell and band layout of one material, as the shaders see it
+struct FurImpostorParams {
+    uint32_t ShellCount = 48;     // Material shell count (FurCB::ShellCount)
+    uint32_t ShellInstances = 32; // Shells actually drawn; the top one sits at (ShellInstances - 1) / (ShellCount - 1)
+    uint32_t Layers = 4;          // Impostor layers, each standing for an equal band of shells
+    float Thickness = 0.85f;
+    // 1 when the view looks straight down the strands, so every shell of a band samples the same
+    // noise; 0 when the parallax between neighbouring shells exceeds a noise cell and they are
+    // uncorrelated. See ImpostorCorrelation.
+    float Correlation = 1.0f;
+};
+
+struct FurVolumeStats {
+    double NoiseMs = 0.0;
+    double BakeMs = 0.0;
+    size_t Bytes = 0;
+};
+
+class FurVolumeBaker {
+public:
+    explicit FurVolumeBaker(JobSystem& jobs) : m_jobs(jobs) {}
+
+    // The shells' cellular noise: 1 at the feature points, falling to 0 half a cell away, with
+    // a power curve that tapers the strands. Tiles seamlessly.
+    void GenerateNoise(const FurNoiseSettings& settings, std::vector<float>& noise);
+
+    void Bake(const float* noise, uint32_t noiseSize, const FurVolumeSettings& settings, FurVolume& volume);
+
+    const FurVolumeStats& Stats() const { return m_stats; }
+
+    // Bilinear, wrapping lookup as the shells do it; (u, v) in noise tiles
+    static float SampleNoise(const float* noise, uint32_t noiseSize, float u, float v);
+
+    // Height where band 'band' starts; band params.Layers starts at the top shell
+    static float BandBoundary(uint32_t band, const FurImpostorParams& params);
+
+    // Mirrors ImpostorLayer in shell_ps: layer 'layer' of params.Layers at (u, v)
+    static FurImpostorLayer ImpostorLayer(const FurVolume& volume, float u, float v, float mip, uint32_t layer,
+                                          const FurImpostorParams& params);
+
+    // Correlation between neighbouring shells for a view 'cosView' off the strand axis: the
+    // parallax between two shells, in noise cells, from the fur length in noise tiles
+    static float ImpostorCorrelation(float cosView, float furLengthTiles, const FurImpostorParams& params, uint32_t noiseCells);
+
+private:
+    JobSystem& m_jobs;
+    FurVolumeStats m_stats;
+};
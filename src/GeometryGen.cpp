@@ -1,10 +1,16 @@
 #include "GeometryGen.h"
+#include "MeshStream.h"
+#include "MeshStreams.h"
+#include "MeshAdjacency.h"
+#include "MemoryArena.h"
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 
 #define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 #include "../third_party/tinygltf/tiny_gltf.h"
@@ -15,18 +21,459 @@ using namespace DirectX;
 #define XM_PI 3.141592654f
 #endif
 
-MeshData GeometryGen::LoadGLTF(const std::string& path) {
+// Float or normalized-integer accessor, 'components' floats per element, honouring byteStride.
+// 'values' is any float vector, so load-time temporaries can live in an arena.
+template <typename FloatVector>
+static void ReadAccessorFloats(const tinygltf::Model& model, const tinygltf::Accessor& accessor, int components, FloatVector& values) {
+    values.assign(accessor.count * components, 0.0f);
+    if (accessor.bufferView < 0) return;
+
+    const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+    const unsigned char* data = &model.buffers[view.buffer].data[view.byteOffset + accessor.byteOffset];
+    size_t stride = (size_t)accessor.ByteStride(view);
+    for (size_t i = 0; i < accessor.count; i++) {
+        const unsigned char* element = data + i * stride;
+        for (int c = 0; c < components; c++) {
+            float value = 0.0f;
+            if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
+                memcpy(&value, element + c * 4, 4);
+            } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+                uint16_t raw; memcpy(&raw, element + c * 2, 2);
+                value = raw / 65535.0f;
+            } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_SHORT) {
+                int16_t raw; memcpy(&raw, element + c * 2, 2);
+                value = std::max(raw / 32767.0f, -1.0f);
+            } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+                value = element[c] / 255.0f;
+            } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_BYTE) {
+                value = std::max((int8_t)element[c] / 127.0f, -1.0f);
+            }
+            values[i * components + c] = value;
+        }
+    }
+}
+
+// JOINTS_0: four unsigned byte or short indices into skin.joints per vertex
+template <typename JointVector>
+static void ReadAccessorJoints(const tinygltf::Model& model, const tinygltf::Accessor& accessor, JointVector& joints) {
+    joints.assign(accessor.count * 4, 0);
+    if (accessor.bufferView < 0) return;
+
+    const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+    const unsigned char* data = &model.buffers[view.buffer].data[view.byteOffset + accessor.byteOffset];
+    size_t stride = (size_t)accessor.ByteStride(view);
+    for (size_t i = 0; i < accessor.count; i++) {
+        const unsigned char* element = data + i * stride;
+        for (int c = 0; c < 4; c++) {
+            if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+                memcpy(&joints[i * 4 + c], element + c * 2, 2);
+            } else {
+                joints[i * 4 + c] = element[c];
+            }
+        }
+    }
+}
+
+// Rotation of a row-vector matrix given its three unit-length rows
+static Quat QuatFromRows(const Float3 rows[3]) {
+    // r(i, j) is the column-vector rotation matrix, the transpose of the rows
+    auto r = [&](int i, int j) { const Float3& row = rows[j]; return i == 0 ? row.x : (i == 1 ? row.y : row.z); };
+    float trace = r(0, 0) + r(1, 1) + r(2, 2);
+    Quat q;
+    if (trace > 0.0f) {
+        float s = std::sqrt(trace + 1.0f) * 2.0f;
+        q = Quat((r(2, 1) - r(1, 2)) / s, (r(0, 2) - r(2, 0)) / s, (r(1, 0) - r(0, 1)) / s, 0.25f * s);
+    } else if (r(0, 0) > r(1, 1) && r(0, 0) > r(2, 2)) {
+        float s = std::sqrt(1.0f + r(0, 0) - r(1, 1) - r(2, 2)) * 2.0f;
+        q = Quat(0.25f * s, (r(0, 1) + r(1, 0)) / s, (r(0, 2) + r(2, 0)) / s, (r(2, 1) - r(1, 2)) / s);
+    } else if (r(1, 1) > r(2, 2)) {
+        float s = std::sqrt(1.0f + r(1, 1) - r(0, 0) - r(2, 2)) * 2.0f;
+        q = Quat((r(0, 1) + r(1, 0)) / s, 0.25f * s, (r(1, 2) + r(2, 1)) / s, (r(0, 2) - r(2, 0)) / s);
+    } else {
+        float s = std::sqrt(1.0f + r(2, 2) - r(0, 0) - r(1, 1)) * 2.0f;
+        q = Quat((r(0, 2) + r(2, 0)) / s, (r(1, 2) + r(2, 1)) / s, 0.25f * s, (r(1, 0) - r(0, 1)) / s);
+    }
+    return Normalize(q);
+}
+
+static JointPose NodeLocalPose(const tinygltf::Node& node) {
+    JointPose pose;
+    if (node.matrix.size() == 16) {
+        // glTF stores column-vector matrices column-major, which is our row-major row-vector layout
+        Float3 rows[3];
+        for (int r = 0; r < 3; r++) {
+            rows[r] = Float3((float)node.matrix[r * 4 + 0], (float)node.matrix[r * 4 + 1], (float)node.matrix[r * 4 + 2]);
+        }
+        pose.Translation = Float3((float)node.matrix[12], (float)node.matrix[13], (float)node.matrix[14]);
+        pose.Scale = Float3(Length(rows[0]), Length(rows[1]), Length(rows[2]));
+        for (Float3& row : rows) row = Normalize(row);
+        pose.Rotation = QuatFromRows(rows);
+        return pose;
+    }
+    if (node.translation.size() == 3) {
+        pose.Translation = Float3((float)node.translation[0], (float)node.translation[1], (float)node.translation[2]);
+    }
+    if (node.rotation.size() == 4) {
+        pose.Rotation = Quat((float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2], (float)node.rotation[3]);
+    }
+    if (node.scale.size() == 3) {
+        pose.Scale = Float3((float)node.scale[0], (float)node.scale[1], (float)node.scale[2]);
+    }
+    return pose;
+}
+
+// Skeleton of model.skins[skinIndex], joints reordered so parents come first. 'skinToJoint' maps
+// the skin's joint list (what JOINTS_0 indexes) to that order, 'nodeToJoint' maps node indices.
+// 'importScale' is the uniform scale applied to the vertices; with the z flip it becomes part of
+// RootTransform, and its inverse is folded into the inverse bind matrices.
+static void LoadSkeleton(const tinygltf::Model& model, int skinIndex, float importScale,
+                         Skeleton& skeleton, std::vector<uint16_t>& skinToJoint, std::vector<int>& nodeToJoint) {
+    const tinygltf::Skin& skin = model.skins[skinIndex];
+    size_t jointCount = skin.joints.size();
+
+    std::vector<int> nodeParent(model.nodes.size(), -1);
+    for (size_t n = 0; n < model.nodes.size(); n++) {
+        for (int child : model.nodes[n].children) nodeParent[child] = (int)n;
+    }
+    auto nodeDepth = [&](int node) {
+        int depth = 0;
+        for (; nodeParent[node] >= 0; node = nodeParent[node]) depth++;
+        return depth;
+    };
+
+    std::vector<uint32_t> order(jointCount);
+    for (uint32_t k = 0; k < jointCount; k++) order[k] = k;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return nodeDepth(skin.joints[a]) < nodeDepth(skin.joints[b]);
+    });
+
+    skinToJoint.assign(jointCount, 0);
+    nodeToJoint.assign(model.nodes.size(), -1);
+    for (uint32_t j = 0; j < jointCount; j++) {
+        skinToJoint[order[j]] = (uint16_t)j;
+        nodeToJoint[skin.joints[order[j]]] = (int)j;
+    }
+
+    std::vector<float> inverseBind;
+    if (skin.inverseBindMatrices >= 0) {
+        ReadAccessorFloats(model, model.accessors[skin.inverseBindMatrices], 16, inverseBind);
+    }
+
+    // glTF -> DirectX: uniform scale plus the z flip the vertices got
+    Float4x4 importTransform = Float4x4::Identity();
+    importTransform.m[0][0] = importTransform.m[1][1] = importScale;
+    importTransform.m[2][2] = -importScale;
+    Float4x4 importInverse = Float4x4::Identity();
+    importInverse.m[0][0] = importInverse.m[1][1] = 1.0f / importScale;
+    importInverse.m[2][2] = -1.0f / importScale;
+
+    skeleton = Skeleton();
+    for (uint32_t j = 0; j < jointCount; j++) {
+        int node = skin.joints[order[j]];
+        skeleton.Names.push_back(model.nodes[node].name);
+        skeleton.RestPose.push_back(NodeLocalPose(model.nodes[node]));
+
+        // Nearest ancestor that is a joint; non-joint nodes in between are assumed static identity
+        int parent = nodeParent[node];
+        while (parent >= 0 && nodeToJoint[parent] < 0) parent = nodeParent[parent];
+        skeleton.Parents.push_back(parent >= 0 ? nodeToJoint[parent] : -1);
+
+        Float4x4 bind = Float4x4::Identity();
+        if (!inverseBind.empty()) {
+            memcpy(bind.m, &inverseBind[order[j] * 16], sizeof(bind.m));
+        }
+        skeleton.InverseBind.push_back(Multiply(importInverse, bind));
+    }
+
+    // Static ancestors of the (first) root joint, e.g. an armature node carrying a unit scale
+    Float4x4 ancestors = Float4x4::Identity();
+    if (jointCount > 0) {
+        for (int node = nodeParent[skin.joints[order[0]]]; node >= 0; node = nodeParent[node]) {
+            JointPose pose = NodeLocalPose(model.nodes[node]);
+            ancestors = Multiply(ancestors, ComposeTrs(pose.Translation, pose.Rotation, pose.Scale));
+        }
+    }
+    skeleton.RootTransform = Multiply(ancestors, importTransform);
+}
+
+// Clips that animate the skeleton's joints. Cubic spline keys keep only their values and are
+// interpolated linearly; morph target weights are ignored.
+static void LoadAnimations(const tinygltf::Model& model, const std::vector<int>& nodeToJoint, std::vector<AnimationClip>& clips) {
+    for (const tinygltf::Animation& animation : model.animations) {
+        AnimationClip clip;
+        clip.Name = animation.name;
+
+        for (const tinygltf::AnimationChannel& gltfChannel : animation.channels) {
+            if (gltfChannel.target_node < 0 || nodeToJoint[gltfChannel.target_node] < 0) continue;
+
+            AnimationChannel channel;
+            channel.Joint = (uint32_t)nodeToJoint[gltfChannel.target_node];
+            int components = 3;
+            if (gltfChannel.target_path == "translation") {
+                channel.Path = AnimationPath::Translation;
+            } else if (gltfChannel.target_path == "rotation") {
+                channel.Path = AnimationPath::Rotation;
+                components = 4;
+            } else if (gltfChannel.target_path == "scale") {
+                channel.Path = AnimationPath::Scale;
+            } else {
+                continue;
+            }
+
+            const tinygltf::AnimationSampler& sampler = animation.samplers[gltfChannel.sampler];
+            channel.Interpolation = sampler.interpolation == "STEP" ? AnimationInterpolation::Step : AnimationInterpolation::Linear;
+            ReadAccessorFloats(model, model.accessors[sampler.input], 1, channel.Times);
+            std::vector<float> values;
+            ReadAccessorFloats(model, model.accessors[sampler.output], components, values);
+            if (sampler.interpolation == "CUBICSPLINE") {
+                // In-tangent, value, out-tangent per key
+                for (size_t key = 0; key < channel.Times.size(); key++) {
+                    const float* value = &values[(key * 3 + 1) * components];
+                    channel.Values.insert(channel.Values.end(), value, value + components);
+                }
+            } else {
+                channel.Values = std::move(values);
+            }
+            if (channel.Values.size() < channel.Times.size() * components) continue;
+
+            if (!channel.Times.empty()) clip.Duration = std::max(clip.Duration, channel.Times.back());
+            clip.Channels.push_back(std::move(channel));
+        }
+        if (!clip.Channels.empty()) clips.push_back(std::move(clip));
+    }
+}
+
+// Cooks the images the materials use as colour maps and points ColorTexture at mesh.Textures.
+// Cooked results are cached next to the glTF as <name>.image<i>.ptex.
+static void LoadColorTextures(const tinygltf::Model& model, const std::string& path, JobSystem& jobs,
+                              TextureCompression compression, MeshData& mesh) {
+    std::vector<int> imageToTexture(model.images.size(), -1);
+    std::vector<TextureSource> sources;
+    std::string cacheStem = path.substr(0, path.find_last_of('.'));
+    for (FurMaterial& material : mesh.Materials) {
+        if (material.ColorTexture < 0) continue;
+        int& texture = imageToTexture[material.ColorTexture];
+        if (texture < 0) {
+            const tinygltf::Image& image = model.images[material.ColorTexture];
+            texture = (int)sources.size();
+            TextureSource source;
+            source.Name = image.name.empty() ? image.uri : image.name;
+            source.Encoded = image.image; // Still encoded: the loader keeps images as-is
+            source.CachePath = cacheStem + ".image" + std::to_string(material.ColorTexture) + ".ptex";
+            sources.push_back(std::move(source));
+        }
+        material.ColorTexture = texture;
+    }
+    if (sources.empty()) return;
+
+    TextureCooker cooker(jobs);
+    mesh.Textures = cooker.Cook(sources, compression);
+    for (FurMaterial& material : mesh.Materials) {
+        if (material.ColorTexture >= 0 && mesh.Textures[material.ColorTexture].Empty()) material.ColorTexture = -1;
+    }
+
+    const TextureCookStats& stats = cooker.Stats();
+    std::cout << "Textures: " << stats.Images << " colour maps, " << stats.CacheHits << " from cache, " << stats.Failed
+              << " failed; cooked " << stats.Megapixels << " MP (decode " << stats.DecodeMs << " ms, mips " << stats.MipMs
+              << " ms, compress " << stats.CompressMs << " ms)" << std::endl;
+}
+
+// Guide hairs from <name>.pgrm or <name>.groom.json next to the glTF, or else the glTF's root
+// extras ("furGuides": the GroomFile JSON guide array), baked into the strand direction map
+static void LoadGroom(const tinygltf::Model& model, const std::string& path, JobSystem& jobs, MeshData& mesh) {
+    const std::string stem = path.substr(0, path.find_last_of('.'));
+    Groom groom;
+    std::string source;
+    std::ifstream json(stem + ".groom.json");
+    std::ostringstream contents;
+    if (json) contents << json.rdbuf();
+    if (GroomFile::Read(stem + ".pgrm", groom)) {
+        source = stem + ".pgrm";
+    } else if (json && GroomFile::ParseJson(contents.str(), groom)) {
+        source = stem + ".groom.json";
+    } else if (model.extras.Has("furGuides") && model.extras.Get("furGuides").IsArray()) {
+        source = "glTF extras";
+        const tinygltf::Value& guides = model.extras.Get("furGuides");
+        std::vector<Float3> points;
+        for (size_t g = 0; g < guides.ArrayLen(); g++) {
+            const tinygltf::Value& guide = guides.Get((int)g);
+            const tinygltf::Value& uv = guide.Get("uv");
+            if (!uv.IsArray() || uv.ArrayLen() < 2) continue;
+            points.clear();
+            const tinygltf::Value& guidePoints = guide.Get("points");
+            for (size_t p = 0; guidePoints.IsArray() && p < guidePoints.ArrayLen(); p++) {
+                const tinygltf::Value& point = guidePoints.Get((int)p);
+                if (!point.IsArray() || point.ArrayLen() < 3) continue;
+                points.push_back(Float3((float)point.Get(0).GetNumberAsDouble(), (float)point.Get(1).GetNumberAsDouble(),
+                                        (float)point.Get(2).GetNumberAsDouble()));
+            }
+            groom.AddGuide((float)uv.Get(0).GetNumberAsDouble(), (float)uv.Get(1).GetNumberAsDouble(), points.data(), (uint32_t)points.size());
+        }
+    }
+    if (groom.Empty()) return;
+
+    GroomBaker baker(jobs);
+    baker.Bake(groom, GroomMapSettings(), mesh.FurGroomMap);
+    mesh.FurGroom = std::move(groom);
+    const GroomBakeStats& stats = baker.Stats();
+    std::cout << "Groom: " << stats.Guides << " guides from " << source << " baked to " << mesh.FurGroomMap.Width << "x"
+              << mesh.FurGroomMap.Height << " in " << stats.IndexMs + stats.BakeMs << " ms" << std::endl;
+}
+
+// Meshes above this many vertices are streamed out of core into a .pmesh instead of loaded whole
+static constexpr uint64_t StreamedVertexThreshold = 500000;
+// Clustering grid for streamed meshes: cells along the longest axis
+static constexpr uint32_t StreamedGridResolution = 256;
+
+// The glTF with all geometry stripped, so tinygltf parses materials and textures without
+// loading the buffers. Embedded images would need the buffers, so those are dropped too.
+static bool LoadGLTFMaterialsOnly(const std::string& path, tinygltf::Model& model) {
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    nlohmann::json gltf = nlohmann::json::parse(contents.str(), nullptr, false);
+    if (gltf.is_discarded()) return false;
+
+    bool embeddedImages = false;
+    for (const auto& image : gltf.value("images", nlohmann::json::array())) {
+        if (image.contains("bufferView")) embeddedImages = true;
+    }
+    if (embeddedImages) {
+        std::cout << "GLTF: images in buffers are not loaded for streamed meshes." << std::endl;
+        gltf.erase("images");
+        gltf.erase("textures");
+    }
+    for (const char* key : { "buffers", "bufferViews", "accessors", "meshes", "nodes", "skins", "animations", "scenes", "scene" }) {
+        gltf.erase(key);
+    }
+
+    tinygltf::TinyGLTF loader;
+    loader.SetImagesAsIs(true);
+    std::string text = gltf.dump(), err, warn;
+    std::string baseDir = path.find_last_of("/\\") == std::string::npos ? "" : path.substr(0, path.find_last_of("/\\"));
+    bool ret = loader.LoadASCIIFromString(&model, &err, &warn, text.c_str(), (unsigned int)text.size(), baseDir);
+    if (!warn.empty()) std::cout << "GLTF Warn: " << warn << std::endl;
+    if (!err.empty()) std::cout << "GLTF Err: " << err << std::endl;
+    return ret;
+}
+
+// Geometry of a large mesh from <name>.pmesh next to the glTF, streaming the glTF into it
+// first if the file is missing or was built from other inputs. The result is welded,
+// clustered to StreamedGridResolution and already has adjacency.
+static bool LoadStreamedGeometry(const std::string& path, float importScale, JobSystem& jobs, MeshData& mesh) {
+    MeshStreamSettings settings;
+    settings.ImportScale = importScale;
+    settings.GridResolution = StreamedGridResolution;
+    MeshStreamer streamer(settings);
+    std::string meshPath = path.substr(0, path.find_last_of('.')) + ".pmesh";
+
+    MeshFileHeader header;
+    if (!MeshFile::ReadHeader(meshPath, header) || header.SourceKey != streamer.SourceKey(path) ||
+        !(header.Flags & MeshFileHeader::HasAdjacency)) {
+        std::cout << "Streaming geometry into " << meshPath << "..." << std::endl;
+        if (!streamer.Process(path, meshPath)) return false;
+        const MeshStreamStats& stats = streamer.Stats();
+        std::cout << "Streamed " << stats.InputTriangles << " triangles in " << stats.Chunks << " chunks to "
+                  << stats.OutputTriangles << " (" << stats.DegenerateTriangles << " collapsed, " << stats.DuplicateTriangles
+                  << " duplicates, " << stats.StitchedEdges << " stitched edges)" << std::endl;
+    }
+
+    MeshArrays arrays;
+    if (!MeshFile::Read(meshPath, arrays, nullptr, &jobs)) return false;
+    static_assert(sizeof(Vertex) == MeshArrays::VertexStride * sizeof(float), "Vertex must match the .pmesh layout");
+    mesh.Vertices.resize(arrays.VertexCount());
+    memcpy(mesh.Vertices.data(), arrays.Vertices.data(), arrays.Vertices.size() * sizeof(float));
+    mesh.Indices = std::move(arrays.Indices);
+    mesh.IndicesAdj = std::move(arrays.IndicesAdj);
+
+    // Triangles without a glTF material share an extra default, as in LoadGLTF
+    const uint32_t gltfMaterials = (uint32_t)mesh.Materials.size();
+    uint32_t defaultMaterial = UINT32_MAX;
+    mesh.TriangleMaterials = std::move(arrays.TriangleMaterials);
+    mesh.TriangleMaterials.resize(mesh.Indices.size() / 3, UINT32_MAX);
+    for (uint32_t& material : mesh.TriangleMaterials) {
+        if (material < gltfMaterials) continue;
+        if (defaultMaterial == UINT32_MAX) {
+            defaultMaterial = (uint32_t)mesh.Materials.size();
+            mesh.Materials.push_back(FurMaterial());
+        }
+        material = defaultMaterial;
+    }
+    return true;
+}
+
+MeshData GeometryGen::LoadGLTF(const std::string& path, JobSystem& jobs, TextureCompression compression) {
     MeshData mesh;
     tinygltf::Model model;
     tinygltf::TinyGLTF loader;
     std::string err, warn;
 
-    bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    // Images stay encoded here; LoadColorTextures decodes the ones in use in parallel
+    loader.SetImagesAsIs(true);
+
+    // Large unskinned meshes with external buffers are streamed instead of loaded whole
+    MeshStreamSummary summary;
+    const bool streamed = MeshStreamer::Describe(path, summary) && summary.Streamable && !summary.Skinned &&
+                          summary.Vertices > StreamedVertexThreshold;
+
+    bool ret = streamed ? LoadGLTFMaterialsOnly(path, model) : loader.LoadASCIIFromFile(&model, &err, &warn, path);
     if (!warn.empty()) std::cout << "GLTF Warn: " << warn << std::endl;
     if (!err.empty()) std::cout << "GLTF Err: " << err << std::endl;
     if (!ret) return mesh;
 
-    if (model.meshes.empty()) return mesh;
+    if (model.meshes.empty() && !streamed) return mesh;
+
+    // The first node binding a mesh to a skin picks the skeleton; every skinned primitive is
+    // assumed to use it. The scale is the product of the two scale passes below.
+    const float importScale = 0.005f * 0.05f;
+    std::vector<uint16_t> skinToJoint;
+    std::vector<int> nodeToJoint;
+    for (const auto& node : model.nodes) {
+        if (node.mesh >= 0 && node.skin >= 0) {
+            LoadSkeleton(model, node.skin, importScale, mesh.Rig, skinToJoint, nodeToJoint);
+            LoadAnimations(model, nodeToJoint, mesh.Animations);
+            break;
+        }
+    }
+    const bool skinned = !mesh.Rig.Empty();
+
+    // Every glTF material keeps its index; primitives without one share an extra default
+    std::ifstream gltfFile(path, std::ios::binary);
+    std::ostringstream gltfText;
+    gltfText << gltfFile.rdbuf();
+    FurMaterials::ReadGltf(gltfText.str(), mesh.Materials);
+    LoadColorTextures(model, path, jobs, compression, mesh);
+    LoadGroom(model, path, jobs, mesh);
+
+    if (streamed) {
+        if (!LoadStreamedGeometry(path, importScale, jobs, mesh)) {
+            std::cout << "GLTF Err: streaming " << path << " failed." << std::endl;
+            return MeshData();
+        }
+        std::cout << "Loaded " << mesh.Vertices.size() << " vertices and " << mesh.Indices.size() / 3 << " triangles (streamed)." << std::endl;
+        BuildClusters(mesh);
+        std::cout << "Built " << mesh.Clusters.size() << " clusters over " << mesh.Materials.size() << " materials." << std::endl;
+        BakeOcclusion(mesh, jobs, path.substr(0, path.find_last_of('.')) + ".pocc");
+        std::cout << MemoryTracker::Report();
+        return mesh;
+    }
+    uint32_t defaultMaterial = UINT32_MAX;
+
+    // Sized once up front instead of growing primitive by primitive; per-primitive
+    // temporaries come from one arena that is rewound after each primitive
+    size_t vertexTotal = 0, indexTotal = 0;
+    for (const auto& gltfMesh : model.meshes) {
+        for (const auto& primitive : gltfMesh.primitives) {
+            if (!primitive.attributes.count("POSITION") || primitive.indices < 0) continue;
+            vertexTotal += model.accessors[primitive.attributes.at("POSITION")].count;
+            indexTotal += model.accessors[primitive.indices].count;
+        }
+    }
+    mesh.Vertices.reserve(vertexTotal);
+    mesh.Indices.reserve(indexTotal);
+    mesh.TriangleMaterials.reserve(indexTotal / 3);
+    if (skinned) mesh.Skin.reserve(vertexTotal);
+    LinearArena loadArena(MemoryTracker::Counter("GltfLoad"));
 
     for (const auto& gltfMesh : model.meshes) {
         if (gltfMesh.primitives.empty()) continue;
@@ -79,7 +526,7 @@ MeshData GeometryGen::LoadGLTF(const std::string& path) {
                 if (normals) {
                     v.Normal = XMFLOAT3(normals[i * 3 + 0], normals[i * 3 + 1], normals[i * 3 + 2]);
                 } else {
-                    v.Normal = XMFLOAT3(0, 1, 0); // Default normal
+                    v.Normal = XMFLOAT3(0, 1, 0); // Computed from the triangles below
                 }
                 
                 if (uvs) {
@@ -100,7 +547,52 @@ MeshData GeometryGen::LoadGLTF(const std::string& path) {
                 mesh.Vertices.push_back(v);
             }
 
+            // Skin influences, remapped to the skeleton's joint order. Vertices of primitives
+            // without any stay in place through the palette's identity entry.
+            if (skinned) {
+                ArenaScope scope(loadArena);
+                std::pmr::vector<uint16_t> joints(&loadArena);
+                std::pmr::vector<float> weights(&loadArena);
+                if (primitive.attributes.count("JOINTS_0") && primitive.attributes.count("WEIGHTS_0")) {
+                    ReadAccessorJoints(model, model.accessors[primitive.attributes.at("JOINTS_0")], joints);
+                    ReadAccessorFloats(model, model.accessors[primitive.attributes.at("WEIGHTS_0")], 4, weights);
+                }
+                for (size_t i = 0; i < posAccessor->count; ++i) {
+                    SkinWeights skin;
+                    float sum = 0.0f;
+                    if (i * 4 + 3 < joints.size() && i * 4 + 3 < weights.size()) {
+                        for (int k = 0; k < 4; k++) {
+                            uint16_t joint = joints[i * 4 + k];
+                            if (joint >= skinToJoint.size() || weights[i * 4 + k] <= 0.0f) continue;
+                            skin.Joints[k] = skinToJoint[joint];
+                            skin.Weights[k] = weights[i * 4 + k];
+                            sum += skin.Weights[k];
+                        }
+                    }
+                    if (sum > 0.0f) {
+                        for (float& w : skin.Weights) w /= sum;
+                    } else {
+                        skin = SkinWeights();
+                        skin.Joints[0] = (uint16_t)mesh.Rig.JointCount();
+                        skin.Weights[0] = 1.0f;
+                    }
+                    mesh.Skin.push_back(skin);
+                }
+            }
+
+            uint32_t material;
+            if (primitive.material >= 0 && primitive.material < (int)model.materials.size()) {
+                material = (uint32_t)primitive.material;
+            } else {
+                if (defaultMaterial == UINT32_MAX) {
+                    defaultMaterial = (uint32_t)mesh.Materials.size();
+                    mesh.Materials.push_back(FurMaterial());
+                }
+                material = defaultMaterial;
+            }
+
             // Extract Indices
+            const size_t firstIndex = mesh.Indices.size();
             if (indAccessor.componentType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT) {
                 const uint16_t* indices = reinterpret_cast<const uint16_t*>(&indBuffer.data[indView.byteOffset + indAccessor.byteOffset]);
                 for (size_t i = 0; i < indAccessor.count; i += 3) {
@@ -123,26 +615,38 @@ MeshData GeometryGen::LoadGLTF(const std::string& path) {
                     mesh.Indices.push_back(vertexOffset + indices[i + 1]);
                 }
             }
+            mesh.TriangleMaterials.resize(mesh.Indices.size() / 3, material);
+
+            // No normals in the file: smooth ones from this primitive's triangles, in the flipped space
+            if (!normals) ComputeNormals(mesh, vertexOffset, firstIndex);
         }
     }
     
     std::cout << "Loaded " << mesh.Vertices.size() << " vertices and " << mesh.Indices.size() / 3 << " triangles." << std::endl;
+    if (skinned) {
+        std::cout << "Skinned: " << mesh.Rig.JointCount() << " joints, " << mesh.Animations.size() << " animations." << std::endl;
+    }
     
     // Check if the mesh is massive and might cause memory/timeout issues
     if (mesh.Vertices.size() > 500000) {
         std::cout << "Warning: Mesh is extremely large. Downsampling for prototype performance..." << std::endl;
         
-        // Simple fast decimation (take only every Nth triangle)
-        std::vector<uint32_t> downsampledIndices;
+        // Simple fast decimation (take only every Nth triangle), compacted in place
+        size_t kept = 0;
         int step = 200; // Take 1 in 200 triangles (drastic cut)
         for (size_t i = 0; i < mesh.Indices.size(); i += 3 * step) {
             if (i + 2 < mesh.Indices.size()) {
-                downsampledIndices.push_back(mesh.Indices[i]);
-                downsampledIndices.push_back(mesh.Indices[i+1]);
-                downsampledIndices.push_back(mesh.Indices[i+2]);
+                mesh.Indices[kept * 3 + 0] = mesh.Indices[i];
+                mesh.Indices[kept * 3 + 1] = mesh.Indices[i+1];
+                mesh.Indices[kept * 3 + 2] = mesh.Indices[i+2];
+                mesh.TriangleMaterials[kept] = mesh.TriangleMaterials[i / 3];
+                kept++;
             }
         }
-        mesh.Indices = downsampledIndices;
+        mesh.Indices.resize(kept * 3);
+        mesh.Indices.shrink_to_fit();
+        mesh.TriangleMaterials.resize(kept);
+        mesh.TriangleMaterials.shrink_to_fit();
         std::cout << "Downsampled to " << mesh.Indices.size() / 3 << " triangles." << std::endl;
     }
 
@@ -156,9 +660,23 @@ MeshData GeometryGen::LoadGLTF(const std::string& path) {
     std::cout << "Generating Adjacency..." << std::endl;
     GenerateAdjacency(mesh);
     std::cout << "Adjacency Generated." << std::endl;
+
+    BuildClusters(mesh);
+    std::cout << "Built " << mesh.Clusters.size() << " clusters over " << mesh.Materials.size() << " materials." << std::endl;
+    BakeOcclusion(mesh, jobs, path.substr(0, path.find_last_of('.')) + ".pocc");
+    std::cout << MemoryTracker::Report();
     return mesh;
 }
 
+void GeometryGen::ComputeNormals(MeshData& mesh, size_t firstVertex, size_t firstIndex) {
+    static_assert(sizeof(Vertex) == MeshArrays::VertexStride * sizeof(float), "Vertex must match the stream layout");
+    if (firstVertex >= mesh.Vertices.size()) return;
+    MeshStreams streams;
+    streams.Load(&mesh.Vertices[firstVertex].Pos.x, mesh.Vertices.size() - firstVertex, MeshArrays::VertexStride);
+    MeshKernels::ComputeNormals(streams, mesh.Indices.data() + firstIndex, (mesh.Indices.size() - firstIndex) / 3, (uint32_t)firstVertex);
+    streams.Store(&mesh.Vertices[firstVertex].Pos.x, MeshArrays::VertexStride);
+}
+
 MeshData GeometryGen::CreateSphere(float radius, uint32_t sliceCount, uint32_t stackCount) {
     MeshData mesh;
 
@@ -223,75 +741,80 @@ MeshData GeometryGen::CreateSphere(float radius, uint32_t sliceCount, uint32_t s
     }
 
     GenerateAdjacency(mesh);
+    BuildClusters(mesh);
     return mesh;
 }
 
-struct Edge {
-    uint32_t v1, v2;
-    bool operator<(const Edge& other) const {
-        if (v1 != other.v1) return v1 < other.v1;
-        return v2 < other.v2;
+MeshData GeometryGen::CreateSynthetic(const SynthScene& scene, JobSystem& jobs) {
+    MeshData mesh;
+    uint64_t vertexCount, triangleCount;
+    SceneGen::Count(scene, vertexCount, triangleCount);
+    if (vertexCount > UINT32_MAX) {
+        std::cout << "Synthetic scene has too many vertices (" << vertexCount << ")." << std::endl;
+        return mesh;
     }
-};
+
+    static_assert(sizeof(Vertex) == MeshArrays::VertexStride * sizeof(float), "Vertex must match the generator layout");
+    mesh.Vertices.resize(vertexCount);
+    mesh.Indices.resize(triangleCount * 3);
+    mesh.TriangleMaterials.resize(triangleCount);
+    SceneGen generator(jobs);
+    generator.Generate(scene, reinterpret_cast<float*>(mesh.Vertices.data()), mesh.Indices.data(), mesh.TriangleMaterials.data());
+    std::cout << "Generated " << vertexCount << " vertices and " << triangleCount << " triangles in "
+              << generator.Stats().GenerateMs << " ms." << std::endl;
+
+    uint32_t materialCount = 1;
+    for (const SynthObject& object : scene.Objects) materialCount = std::max(materialCount, object.Material + 1);
+    const Float3 tints[] = { Float3(0.85f, 0.82f, 0.78f), Float3(0.55f, 0.35f, 0.2f), Float3(0.3f, 0.3f, 0.32f),
+                             Float3(0.8f, 0.6f, 0.35f) };
+    for (uint32_t m = 0; m < materialCount; m++) {
+        FurMaterial material;
+        material.Name = "Synthetic" + std::to_string(m);
+        material.FurColor = tints[m % (sizeof(tints) / sizeof(tints[0]))];
+        mesh.Materials.push_back(material);
+    }
+
+    GenerateAdjacency(mesh);
+    BuildClusters(mesh);
+    std::cout << "Built " << mesh.Clusters.size() << " clusters over " << mesh.Materials.size() << " materials." << std::endl;
+    BakeOcclusion(mesh, jobs);
+    return mesh;
+}
 
 void GeometryGen::GenerateAdjacency(MeshData& mesh) {
-    // Edge to triangles
-    std::map<Edge, std::vector<uint32_t>> edgeToTri;
-    
-    uint32_t numTris = (uint32_t)mesh.Indices.size() / 3;
-    for (uint32_t i = 0; i < numTris; i++) {
-        uint32_t i0 = mesh.Indices[i*3 + 0];
-        uint32_t i1 = mesh.Indices[i*3 + 1];
-        uint32_t i2 = mesh.Indices[i*3 + 2];
-        
-        Edge e0 = { std::min(i0,i1), std::max(i0,i1) };
-        Edge e1 = { std::min(i1,i2), std::max(i1,i2) };
-        Edge e2 = { std::min(i2,i0), std::max(i2,i0) };
-        
-        edgeToTri[e0].push_back(i);
-        edgeToTri[e1].push_back(i);
-        edgeToTri[e2].push_back(i);
+    // All scratch comes from one arena, counted as the adjacency stage
+    LinearArena arena(MemoryTracker::Counter("Adjacency"));
+    mesh.IndicesAdj.resize(mesh.Indices.size() * 2);
+    MeshAdjacency::Build(mesh.Indices.data(), mesh.Indices.size() / 3, mesh.IndicesAdj.data(), &arena);
+}
+
+void GeometryGen::BuildClusters(MeshData& mesh, uint32_t trianglesPerCluster) {
+    const float* positions = reinterpret_cast<const float*>(mesh.Vertices.data());
+    const size_t stride = sizeof(Vertex) / sizeof(float);
+
+    const bool hasMaterials = mesh.TriangleMaterials.size() == mesh.Indices.size() / 3;
+    std::vector<uint32_t> order = MeshClusters::SortTriangles(positions, stride, mesh.Indices, mesh.TriangleMaterials);
+    if (mesh.IndicesAdj.size() == mesh.Indices.size() * 2) {
+        MeshClusters::ApplyTriangleOrder(mesh.IndicesAdj, order, 6);
     }
 
-    mesh.IndicesAdj.resize(numTris * 6);
-    
-    for (uint32_t i = 0; i < numTris; i++) {
-        uint32_t i0 = mesh.Indices[i*3 + 0];
-        uint32_t i1 = mesh.Indices[i*3 + 1];
-        uint32_t i2 = mesh.Indices[i*3 + 2];
-        
-        uint32_t adj[3] = { i0, i1, i2 }; // defaults for borders (no neighbor)
-        
-        Edge edges[3] = {
-            { std::min(i0,i1), std::max(i0,i1) },
-            { std::min(i1,i2), std::max(i1,i2) },
-            { std::min(i2,i0), std::max(i2,i0) }
-        };
-        
-        // Find opposite vertex in neighbor triangles for each edge
-        for (int e = 0; e < 3; e++) {
-            const auto& tris = edgeToTri[edges[e]];
-            for (uint32_t t : tris) {
-                if (t != i) {
-                    // This is a neighbor triangle! Find its opposite vertex.
-                    uint32_t n0 = mesh.Indices[t*3+0];
-                    uint32_t n1 = mesh.Indices[t*3+1];
-                    uint32_t n2 = mesh.Indices[t*3+2];
-                    if (n0 != edges[e].v1 && n0 != edges[e].v2) adj[e] = n0;
-                    if (n1 != edges[e].v1 && n1 != edges[e].v2) adj[e] = n1;
-                    if (n2 != edges[e].v1 && n2 != edges[e].v2) adj[e] = n2;
-                    break; // Only expect one neighbor for a manifold
-                }
-            }
-        }
-        
-        // Output format: v0, adj0, v1, adj1, v2, adj2
-        // Where adj0 is opposite of edge v0-v1
-        mesh.IndicesAdj[i*6 + 0] = i0;
-        mesh.IndicesAdj[i*6 + 1] = adj[0];
-        mesh.IndicesAdj[i*6 + 2] = i1;
-        mesh.IndicesAdj[i*6 + 3] = adj[1];
-        mesh.IndicesAdj[i*6 + 4] = i2;
-        mesh.IndicesAdj[i*6 + 5] = adj[2];
+    mesh.Clusters = MeshClusters::Build(positions, stride, mesh.Indices, trianglesPerCluster,
+                                        hasMaterials ? &mesh.TriangleMaterials : nullptr);
+}
+
+void GeometryGen::BakeOcclusion(MeshData& mesh, JobSystem& jobs, const std::string& cachePath) {
+    OcclusionBakeSettings settings;
+    settings.HullOffset = mesh.Materials.empty() ? FurMaterial().FurLength : 0.0f;
+    for (const FurMaterial& material : mesh.Materials) settings.HullOffset = std::max(settings.HullOffset, material.FurLength);
+
+    OcclusionBaker baker(jobs);
+    baker.Bake(reinterpret_cast<const float*>(mesh.Vertices.data()), sizeof(Vertex) / sizeof(float), mesh.Vertices.size(),
+               mesh.Indices.data(), mesh.Indices.size() / 3, settings, mesh.Occlusion, cachePath);
+    const OcclusionBakeStats& stats = baker.Stats();
+    if (stats.CacheHit) {
+        std::cout << "Occlusion loaded from " << cachePath << "." << std::endl;
+    } else {
+        std::cout << "Baked occlusion: " << stats.Rays << " rays in " << stats.TraceMs << " ms (BVH " << stats.BuildMs
+                  << " ms), mean occlusion " << stats.MeanOcclusion << "." << std::endl;
     }
 }
@@ -1,8 +1,16 @@
 #pragma once
 #include <vector>
-#include <map>
 #include <string>
 #include <DirectXMath.h>
+#include "MeshClusters.h"
+#include "Animation.h"
+#include "Skinning.h"
+#include "TextureCooker.h"
+#include "SceneGen.h"
+#include "OcclusionBaker.h"
+#include "Grooming.h"
+#include "FurCoat.h"
+#include "FurMaterial.h"
 
 using namespace DirectX;
 
@@ -16,11 +24,37 @@ struct MeshData {
     std::vector<Vertex> Vertices;
     std::vector<uint32_t> Indices;
     std::vector<uint32_t> IndicesAdj; // With adjacency
+    std::vector<MeshCluster> Clusters; // Contiguous triangle ranges of Indices/IndicesAdj
+    std::vector<uint32_t> TriangleMaterials; // Index into Materials per triangle; empty means all 0
+    std::vector<FurMaterial> Materials;      // May be empty: one default material
+    std::vector<TextureImage> Textures;      // Colour maps, sRGB with full mip chains
+    std::vector<VertexOcclusion> Occlusion;  // Baked per vertex; empty means open everywhere
+    std::vector<VertexTangent> Tangents;     // Empty means derived from the UVs at upload
+    Groom FurGroom;                          // Guide hairs; empty means fur along the normals
+    GroomMap FurGroomMap;                    // Baked from FurGroom
+
+    // Skinned meshes only: Vertices hold the bind pose, Skin has one entry per vertex
+    std::vector<SkinWeights> Skin;
+    Skeleton Rig;
+    std::vector<AnimationClip> Animations;
 };
 
 class GeometryGen {
 public:
     static MeshData CreateSphere(float radius, uint32_t sliceCount, uint32_t stackCount);
-    static MeshData LoadGLTF(const std::string& path);
+    // Generated in parallel straight into the vertex and index arrays; one fur material per
+    // scene material, tinted so they can be told apart
+    static MeshData CreateSynthetic(const SynthScene& scene, JobSystem& jobs);
+    // Colour maps are cooked in parallel on 'jobs' and block-compressed with 'compression'
+    static MeshData LoadGLTF(const std::string& path, JobSystem& jobs, TextureCompression compression = TextureCompression::BC7);
     static void GenerateAdjacency(MeshData& mesh);
+    // Area-weighted smooth normals for the vertices from 'firstVertex' on, from the triangles
+    // from 'firstIndex' on, computed over a structure-of-arrays copy (MeshStreams)
+    static void ComputeNormals(MeshData& mesh, size_t firstVertex = 0, size_t firstIndex = 0);
+    // Reorders triangles (Indices, IndicesAdj and TriangleMaterials together) into spatially
+    // compact clusters, grouped by material
+    static void BuildClusters(MeshData& mesh, uint32_t trianglesPerCluster = MeshClusters::DefaultTrianglesPerCluster);
+    // Ambient occlusion and light visibility against the hull at the tips of the longest fur
+    // (bind pose for skinned meshes). Cached in 'cachePath' if not empty.
+    static void BakeOcclusion(MeshData& mesh, JobSystem& jobs, const std::string& cachePath = std::string());
 };
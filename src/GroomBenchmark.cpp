@@ -0,0 +1,199 @@
+// Headless grooming benchmark. First checks the baker on grooms with known answers:
+//   every guide combed the same way    that direction and length in every texel
+//   a guide on a texel centre          exactly that guide there
+//   .pgrm and JSON                     read back identical
+//   tangents of a UV-mapped plane      +U in the plane, bitangent along +V
+// Then bakes a combed groom of 10K and 1M guides (or the count given) into the direction map,
+// edits a few guides (combing only, and moving roots) and checks that every incremental re-bake
+// matches a full bake of the edited groom and beats it on time.
+// Usage: PelageGroomBench [guides] [map size]
+#include "BenchReport.h"
+#include "Grooming.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+static constexpr float Pi = 3.14159265f;
+
+static uint64_t g_random = 1;
+
+static float Random() {
+    g_random = g_random * 6364136223846793005ull + 1442695040888963407ull;
+    return (float)(g_random >> 40) * (1.0f / 16777216.0f);
+}
+
+// A guide of three points leaning 'lean' radians off the normal towards 'angle' in the tangent
+// plane, 'length' fur lengths long, bending further over towards the tip
+static void AddCombedGuide(Groom& groom, float u, float v, float angle, float lean, float length) {
+    Float3 points[3];
+    Float3 p;
+    for (int i = 0; i < 3; i++) {
+        float tilt = lean * (0.6f + 0.2f * i);
+        p += Float3(std::cos(angle) * std::sin(tilt), std::sin(angle) * std::sin(tilt), std::cos(tilt)) * (length / 3.0f);
+        points[i] = p;
+    }
+    groom.AddGuide(u, v, points, 3);
+}
+
+// A swirl around the middle of the UV square with a parting along v = 0.5
+static Groom CombedGroom(uint32_t guides) {
+    Groom groom;
+    groom.Guides.reserve(guides);
+    groom.Points.reserve(guides * 3);
+    for (uint32_t g = 0; g < guides; g++) {
+        float u = Random(), v = Random();
+        float angle = std::atan2(v - 0.5f, u - 0.5f) + Pi * 0.5f + (v < 0.5f ? Pi : 0.0f);
+        AddCombedGuide(groom, u, v, angle, 0.3f + 0.9f * Random(), 0.5f + Random());
+    }
+    return groom;
+}
+
+static bool SameMap(const GroomMap& a, const GroomMap& b) {
+    return a.Width == b.Width && a.Height == b.Height && a.Texels == b.Texels;
+}
+
+static bool SameGroom(const Groom& a, const Groom& b) {
+    if (a.Guides.size() != b.Guides.size() || a.Points.size() != b.Points.size()) return false;
+    for (size_t g = 0; g < a.Guides.size(); g++) {
+        const GroomGuide& x = a.Guides[g];
+        const GroomGuide& y = b.Guides[g];
+        if (x.U != y.U || x.V != y.V || x.FirstPoint != y.FirstPoint || x.PointCount != y.PointCount) return false;
+    }
+    for (size_t p = 0; p < a.Points.size(); p++) {
+        if (a.Points[p].x != b.Points[p].x || a.Points[p].y != b.Points[p].y || a.Points[p].z != b.Points[p].z) return false;
+    }
+    return true;
+}
+
+static bool CheckKnownGrooms(JobSystem& jobs) {
+    bool ok = true;
+    GroomBaker baker(jobs);
+    GroomMapSettings settings;
+    settings.Size = 64;
+
+    // Combed the same way everywhere
+    Groom uniform;
+    const Float3 combed = Normalize(Float3(0.6f, -0.3f, 0.74f));
+    for (int g = 0; g < 100; g++) {
+        Float3 tip = combed * 1.5f;
+        uniform.AddGuide(Random(), Random(), &tip, 1);
+    }
+    GroomMap map;
+    baker.Bake(uniform, settings, map);
+    float worstAngle = 0.0f, worstLength = 0.0f;
+    for (uint32_t y = 0; y < map.Height; y++) {
+        for (uint32_t x = 0; x < map.Width; x++) {
+            Float3 direction;
+            float length;
+            map.Decode(x, y, direction, length);
+            worstAngle = std::max(worstAngle, std::acos(std::min(Dot(direction, combed), 1.0f)));
+            worstLength = std::max(worstLength, std::fabs(length - 1.5f));
+        }
+    }
+    ok &= Report("uniform comb", worstAngle < 0.02f && worstLength <= settings.MaxLength / 255.0f);
+
+    // One guide sitting on texel (10, 20) among random ones
+    Groom scattered = CombedGroom(200);
+    Float3 tip(0.0f, 0.8f, 0.6f);
+    scattered.AddGuide(10.5f / settings.Size, 20.5f / settings.Size, &tip, 1);
+    baker.Bake(scattered, settings, map);
+    Float3 direction;
+    float length;
+    map.Decode(10, 20, direction, length);
+    ok &= Report("guide on a texel centre", Dot(direction, tip) > 0.999f && std::fabs(length - 1.0f) <= settings.MaxLength / 255.0f);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "pelage_groom_bench.pgrm").string();
+    Groom readBack;
+    bool written = GroomFile::Write(path, scattered) && GroomFile::Read(path, readBack);
+    std::filesystem::remove(path);
+    ok &= Report(".pgrm round trip", written && SameGroom(scattered, readBack));
+
+    Groom expected, parsed, parsedArray;
+    Float3 jsonPoints[2] = { Float3(0.0f, 0.0f, 0.5f), Float3(0.25f, 0.0f, 1.0f) };
+    expected.AddGuide(0.25f, 0.75f, jsonPoints, 2);
+    expected.AddGuide(0.5f, 0.5f, nullptr, 0);
+    const char* guidesJson = "[{\"uv\": [0.25, 0.75], \"points\": [[0, 0, 0.5], [0.25, 0, 1]]}, {\"uv\": [0.5, 0.5]}]";
+    bool json = GroomFile::ParseJson(std::string("{\"guides\": ") + guidesJson + "}", parsed) &&
+                GroomFile::ParseJson(guidesJson, parsedArray) && !GroomFile::ParseJson("{\"guides\": [{\"points\": []}]}", readBack);
+    ok &= Report("JSON guides", json && SameGroom(expected, parsed) && SameGroom(expected, parsedArray));
+
+    // A unit quad in the xz plane facing +y, u along +x and v along -z
+    const float quad[4][8] = {
+        { 0, 0, 0, 0, 1, 0, 0, 0 }, { 1, 0, 0, 0, 1, 0, 1, 0 }, { 0, 0, -1, 0, 1, 0, 0, 1 }, { 1, 0, -1, 0, 1, 0, 1, 1 },
+    };
+    const uint32_t quadIndices[6] = { 0, 2, 1, 1, 2, 3 };
+    std::vector<VertexTangent> tangents;
+    GroomBaker::ComputeTangents(&quad[0][0], 8, 4, quadIndices, 2, tangents);
+    bool tangentsOk = true;
+    for (const VertexTangent& t : tangents) {
+        Float3 bitangent = Cross(Float3(0.0f, 1.0f, 0.0f), t.Tangent) * t.Handedness;
+        tangentsOk &= Dot(t.Tangent, Float3(1.0f, 0.0f, 0.0f)) > 0.999f && Dot(bitangent, Float3(0.0f, 0.0f, -1.0f)) > 0.999f;
+    }
+    ok &= Report("tangents", tangentsOk);
+    return ok;
+}
+
+// Full bake, then incremental edits of the groom each checked against a fresh full bake
+static bool Benchmark(JobSystem& jobs, uint32_t guides, uint32_t size) {
+    Groom groom = CombedGroom(guides);
+    GroomMapSettings settings;
+    settings.Size = size;
+    GroomBaker baker(jobs);
+    GroomMap map;
+    baker.Bake(groom, settings, map);
+    const GroomBakeStats full = baker.Stats();
+    const double fullMs = full.IndexMs + full.BakeMs;
+    printf("%u guides into %ux%u: index %.1f ms, bake %.1f ms, %.1f Mtexels/s, longest strand %.2f\n", guides, size, size,
+           full.IndexMs, full.BakeMs, full.Texels / (full.BakeMs * 1000.0), map.LongestStrand());
+
+    struct Edit {
+        const char* Name;
+        uint32_t Guides;
+        bool Move;
+    };
+    const Edit edits[] = { { "comb 1 guide", 1, false }, { "comb 64 guides", 64, false }, { "move 16 roots", 16, true } };
+    bool ok = true;
+    GroomBaker reference(jobs);
+    GroomMap referenceMap;
+    for (const Edit& edit : edits) {
+        std::vector<uint32_t> changed;
+        for (uint32_t i = 0; i < edit.Guides; i++) {
+            uint32_t g = (uint32_t)(Random() * guides) % guides;
+            changed.push_back(g);
+            GroomGuide& guide = groom.Guides[g];
+            if (edit.Move) {
+                guide.U = std::clamp(guide.U + (Random() - 0.5f) * 0.05f, 0.0f, 1.0f);
+                guide.V = std::clamp(guide.V + (Random() - 0.5f) * 0.05f, 0.0f, 1.0f);
+            }
+            // Comb it: a new lean and length, in place
+            float angle = Random() * 2.0f * Pi, lean = Random() * 1.2f, length = 0.5f + Random();
+            Groom combed;
+            AddCombedGuide(combed, 0.0f, 0.0f, angle, lean, length);
+            for (uint32_t p = 0; p < guide.PointCount; p++) groom.Points[guide.FirstPoint + p] = combed.Points[p];
+        }
+        baker.Update(groom, changed, map);
+        const GroomBakeStats& stats = baker.Stats();
+        const double updateMs = stats.IndexMs + stats.BakeMs;
+        reference.Bake(groom, settings, referenceMap);
+        bool same = SameMap(map, referenceMap);
+        bool faster = stats.Incremental && updateMs < fullMs;
+        printf("  %-15s %8.3f ms (%6.1fx faster), %8llu texels in x [%u,%u) y [%u,%u): %s, %s\n", edit.Name, updateMs,
+               fullMs / std::max(updateMs, 1e-6), (unsigned long long)stats.Texels, stats.Dirty.Left, stats.Dirty.Right,
+               stats.Dirty.Top, stats.Dirty.Bottom, same ? "matches full bake" : "DIFFERS from full bake",
+               faster ? "ok" : "NOT FASTER");
+        ok &= same && faster;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    std::vector<uint32_t> guideCounts = { 10000, 1000000 };
+    if (argc > 1) guideCounts = { (uint32_t)std::max(atoi(argv[1]), 1) };
+    const uint32_t size = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 16) : 1024;
+
+    JobSystem jobs;
+    bool ok = CheckKnownGrooms(jobs);
+    printf("%u threads\n", jobs.ThreadCount());
+    for (uint32_t guides : guideCounts) ok &= Benchmark(jobs, guides, size);
+    return ok ? 0 : 1;
+}
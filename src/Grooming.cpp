@@ -0,0 +1,443 @@
+#include "Grooming.h"
+#include "Timing.h"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include "../third_party/tinygltf/json.hpp"
+
+static constexpr float Unreached = std::numeric_limits<float>::infinity();
+
+struct GroomFileHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint64_t GuideCount;
+    uint64_t PointCount;
+};
+
+void Groom::AddGuide(float u, float v, const Float3* points, uint32_t count) {
+    GroomGuide guide;
+    guide.U = u;
+    guide.V = v;
+    guide.FirstPoint = (uint32_t)Points.size();
+    guide.PointCount = count;
+    Guides.push_back(guide);
+    Points.insert(Points.end(), points, points + count);
+}
+
+bool GroomFile::Read(const std::string& path, Groom& groom) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    GroomFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if (memcmp(header.Magic, "PGRM", 4) != 0 || header.Version != Version || header.PointCount > UINT32_MAX) return false;
+
+    Groom loaded;
+    loaded.Guides.resize(header.GuideCount);
+    loaded.Points.resize(header.PointCount);
+    if (!file.read(reinterpret_cast<char*>(loaded.Guides.data()), header.GuideCount * sizeof(GroomGuide)) ||
+        !file.read(reinterpret_cast<char*>(loaded.Points.data()), header.PointCount * sizeof(Float3))) {
+        return false;
+    }
+    for (const GroomGuide& guide : loaded.Guides) {
+        if ((uint64_t)guide.FirstPoint + guide.PointCount > header.PointCount) return false;
+    }
+    groom = std::move(loaded);
+    return true;
+}
+
+bool GroomFile::Write(const std::string& path, const Groom& groom) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    GroomFileHeader header = {};
+    memcpy(header.Magic, "PGRM", 4);
+    header.Version = Version;
+    header.GuideCount = groom.Guides.size();
+    header.PointCount = groom.Points.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(groom.Guides.data()), groom.Guides.size() * sizeof(GroomGuide));
+    file.write(reinterpret_cast<const char*>(groom.Points.data()), groom.Points.size() * sizeof(Float3));
+    return (bool)file;
+}
+
+bool GroomFile::ParseJson(const std::string& text, Groom& groom) {
+    nlohmann::json json = nlohmann::json::parse(text, nullptr, false);
+    if (json.is_discarded()) return false;
+    const nlohmann::json& guides = json.is_array() ? json : json.value("guides", nlohmann::json());
+    if (!guides.is_array()) return false;
+
+    Groom parsed;
+    std::vector<Float3> points;
+    for (const nlohmann::json& guide : guides) {
+        const nlohmann::json& uv = guide.value("uv", nlohmann::json());
+        if (!uv.is_array() || uv.size() < 2 || !uv[0].is_number() || !uv[1].is_number()) return false;
+        points.clear();
+        for (const nlohmann::json& point : guide.value("points", nlohmann::json::array())) {
+            if (!point.is_array() || point.size() < 3 || !point[0].is_number() || !point[1].is_number() || !point[2].is_number()) {
+                return false;
+            }
+            points.push_back(Float3(point[0].get<float>(), point[1].get<float>(), point[2].get<float>()));
+        }
+        parsed.AddGuide(uv[0].get<float>(), uv[1].get<float>(), points.data(), (uint32_t)points.size());
+    }
+    groom = std::move(parsed);
+    return true;
+}
+
+static uint32_t EncodeUnorm8(float x) {
+    return (uint32_t)(std::clamp(x, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static uint32_t EncodeGroomTexel(const Float3& direction, float length, float maxLength) {
+    return EncodeUnorm8(direction.x * 0.5f + 0.5f) | (EncodeUnorm8(direction.y * 0.5f + 0.5f) << 8) |
+           (EncodeUnorm8(direction.z * 0.5f + 0.5f) << 16) | (EncodeUnorm8(length / maxLength) << 24);
+}
+
+GroomMap GroomMap::Neutral() {
+    GroomMap map;
+    map.Width = map.Height = 1;
+    map.Texels.push_back(EncodeGroomTexel(Float3(0.0f, 0.0f, 1.0f), 1.0f, map.MaxLength));
+    return map;
+}
+
+void GroomMap::Decode(uint32_t x, uint32_t y, Float3& direction, float& length) const {
+    uint32_t texel = Texels[y * Width + x];
+    auto channel = [&](int c) { return ((texel >> (c * 8)) & 0xff) * (1.0f / 255.0f); };
+    direction = Normalize(Float3(channel(0) * 2.0f - 1.0f, channel(1) * 2.0f - 1.0f, channel(2) * 2.0f - 1.0f));
+    length = channel(3) * MaxLength;
+}
+
+float GroomMap::LongestStrand() const {
+    uint32_t longest = 0;
+    for (uint32_t texel : Texels) longest = std::max(longest, texel >> 24);
+    return longest * (1.0f / 255.0f) * MaxLength;
+}
+
+// Texel centres; Update's reach test must see exactly the distances the bake saw
+static float TexelCentre(uint32_t i, uint32_t size) {
+    return (i + 0.5f) / size;
+}
+
+// Straight from the root to the tip, as the shells extrude; the length is along the curve.
+// Tips under the surface are lifted to lie flat on it.
+void GroomBaker::IndexGuide(const Groom& groom, size_t g) {
+    const GroomGuide& guide = groom.Guides[g];
+    GuideSample& sample = m_guides[g];
+    sample.U = guide.U;
+    sample.V = guide.V;
+    sample.Direction = Float3(0.0f, 0.0f, 1.0f);
+    sample.Length = 1.0f;
+    if (guide.PointCount == 0) return;
+
+    Float3 previous;
+    float length = 0.0f;
+    for (uint32_t p = 0; p < guide.PointCount; p++) {
+        const Float3& point = groom.Points[guide.FirstPoint + p];
+        length += Length(point - previous);
+        previous = point;
+    }
+    Float3 tip = previous;
+    tip.z = std::max(tip.z, 0.0f);
+    if (Dot(tip, tip) > 1e-12f) sample.Direction = Normalize(tip);
+    sample.Length = length;
+}
+
+// Counting sort of the roots into cells, in guide order within each cell
+void GroomBaker::BuildGrid() {
+    const uint32_t guideCount = (uint32_t)m_guides.size();
+    m_gridSize = std::clamp((uint32_t)std::sqrt(guideCount * 0.5f), 1u, 1024u);
+    const uint32_t cells = m_gridSize * m_gridSize;
+    std::vector<uint32_t> guideCells(guideCount);
+    m_cellStart.assign(cells + 1, 0);
+    auto axisCell = [&](float x) { return (uint32_t)std::clamp((int32_t)std::floor(x * m_gridSize), 0, (int32_t)m_gridSize - 1); };
+    for (uint32_t g = 0; g < guideCount; g++) {
+        guideCells[g] = axisCell(m_guides[g].V) * m_gridSize + axisCell(m_guides[g].U);
+        m_cellStart[guideCells[g] + 1]++;
+    }
+    for (uint32_t c = 0; c < cells; c++) m_cellStart[c + 1] += m_cellStart[c];
+    m_cellGuides.resize(guideCount);
+    std::vector<uint32_t> cursor(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (uint32_t g = 0; g < guideCount; g++) m_cellGuides[cursor[guideCells[g]]++] = g;
+}
+
+uint32_t GroomBaker::EncodeTexel(uint32_t x, uint32_t y) {
+    const uint32_t neighbours = std::clamp(m_settings.Neighbours, 1u, MaxNeighbours);
+    const uint32_t wanted = neighbours + 1;
+    const float u = TexelCentre(x, m_width), v = TexelCentre(y, m_height);
+
+    // The nearest 'wanted' guides by distance, then index, so ties resolve the same every time
+    uint32_t nearest[MaxNeighbours + 1];
+    float nearestD2[MaxNeighbours + 1];
+    uint32_t found = 0;
+    auto consider = [&](uint32_t g) {
+        float du = m_guides[g].U - u, dv = m_guides[g].V - v;
+        float d2 = du * du + dv * dv;
+        auto closer = [&](uint32_t i) { return d2 < nearestD2[i] || (d2 == nearestD2[i] && g < nearest[i]); };
+        if (found == wanted && !closer(wanted - 1)) return;
+        uint32_t i = found < wanted ? found++ : wanted - 1;
+        for (; i > 0 && closer(i - 1); i--) {
+            nearest[i] = nearest[i - 1];
+            nearestD2[i] = nearestD2[i - 1];
+        }
+        nearest[i] = g;
+        nearestD2[i] = d2;
+    };
+
+    // Rings of cells outwards; every cell beyond ring r is at least r cells away (less a margin
+    // for rounding, so the set found is exactly the nearest)
+    const int32_t grid = (int32_t)m_gridSize;
+    const float cellSize = 1.0f / m_gridSize;
+    const int32_t cx = std::clamp((int32_t)std::floor(u * grid), 0, grid - 1);
+    const int32_t cy = std::clamp((int32_t)std::floor(v * grid), 0, grid - 1);
+    auto visit = [&](int32_t i, int32_t j) {
+        if (i < 0 || j < 0 || i >= grid || j >= grid) return;
+        uint32_t cell = (uint32_t)(j * grid + i);
+        for (uint32_t k = m_cellStart[cell]; k < m_cellStart[cell + 1]; k++) consider(m_cellGuides[k]);
+    };
+    for (int32_t r = 0; r < grid; r++) {
+        for (int32_t j = cy - r; j <= cy + r; j++) {
+            if (j == cy - r || j == cy + r) {
+                for (int32_t i = cx - r; i <= cx + r; i++) visit(i, j);
+            } else {
+                visit(cx - r, j);
+                visit(cx + r, j);
+            }
+        }
+        float bound = r * cellSize * 0.999f;
+        if (found == wanted && nearestD2[wanted - 1] < bound * bound) break;
+    }
+
+    // Shepard weights ((R - d) / (R d))^2 with R the distance to the next-nearest guide, which
+    // therefore enters at weight zero. With too few guides for that, plain inverse squares.
+    Float3 direction(0.0f, 0.0f, 1.0f);
+    float length = 1.0f;
+    float reach = Unreached;
+    if (found > 0 && nearestD2[0] <= 1e-12f) {
+        direction = m_guides[nearest[0]].Direction;
+        length = m_guides[nearest[0]].Length;
+        if (found == wanted) reach = nearestD2[neighbours];
+    } else if (found > 0) {
+        uint32_t used = found;
+        float radius = 0.0f;
+        if (found == wanted) {
+            used = neighbours;
+            reach = nearestD2[neighbours];
+            radius = std::sqrt(reach);
+        }
+        float weights[MaxNeighbours + 1];
+        float total = 0.0f;
+        for (uint32_t i = 0; i < used; i++) {
+            float d = std::sqrt(nearestD2[i]);
+            weights[i] = found == wanted ? (radius - d) * (radius - d) / (radius * radius * nearestD2[i]) : 1.0f / nearestD2[i];
+            total += weights[i];
+        }
+        if (!(total > 0.0f)) { // Every neighbour as far as the next one
+            for (uint32_t i = 0; i < used; i++) weights[i] = 1.0f;
+            total = (float)used;
+        }
+        Float3 sum;
+        length = 0.0f;
+        for (uint32_t i = 0; i < used; i++) {
+            sum += m_guides[nearest[i]].Direction * weights[i];
+            length += m_guides[nearest[i]].Length * weights[i];
+        }
+        length /= total;
+        if (Dot(sum, sum) > 1e-12f) direction = Normalize(sum);
+    }
+    m_reach[(size_t)y * m_width + x] = reach;
+    return EncodeGroomTexel(direction, length, m_settings.MaxLength);
+}
+
+void GroomBaker::UpdateTileReach(uint32_t tile) {
+    const uint32_t tilesX = (m_width + ReachTile - 1) / ReachTile;
+    const uint32_t x0 = (tile % tilesX) * ReachTile, y0 = (tile / tilesX) * ReachTile;
+    float reach = 0.0f;
+    for (uint32_t y = y0; y < std::min(y0 + ReachTile, m_height); y++) {
+        for (uint32_t x = x0; x < std::min(x0 + ReachTile, m_width); x++) reach = std::max(reach, m_reach[(size_t)y * m_width + x]);
+    }
+    m_tileReach[tile] = reach;
+}
+
+void GroomBaker::Bake(const Groom& groom, const GroomMapSettings& settings, GroomMap& map) {
+    m_stats = GroomBakeStats();
+    m_stats.Guides = (uint32_t)groom.Guides.size();
+    m_settings = settings;
+
+    Clock::time_point start = Clock::now();
+    m_guides.resize(groom.Guides.size());
+    m_jobs.ParallelFor(m_guides.size(), 16384, [&](size_t begin, size_t end) {
+        for (size_t g = begin; g < end; g++) IndexGuide(groom, g);
+    });
+    BuildGrid();
+    m_stats.IndexMs = MillisecondsSince(start);
+
+    start = Clock::now();
+    m_width = m_height = std::max(settings.Size, 1u);
+    map.Width = m_width;
+    map.Height = m_height;
+    map.MaxLength = settings.MaxLength;
+    map.Texels.resize((size_t)m_width * m_height);
+    m_reach.resize(map.Texels.size());
+    m_jobs.ParallelFor(m_height, 4, [&](size_t begin, size_t end) {
+        for (uint32_t y = (uint32_t)begin; y < end; y++) {
+            for (uint32_t x = 0; x < m_width; x++) map.Texels[(size_t)y * m_width + x] = EncodeTexel(x, y);
+        }
+    });
+    const uint32_t tilesX = (m_width + ReachTile - 1) / ReachTile, tilesY = (m_height + ReachTile - 1) / ReachTile;
+    m_tileReach.resize((size_t)tilesX * tilesY);
+    m_jobs.ParallelFor(m_tileReach.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) UpdateTileReach((uint32_t)tile);
+    });
+    m_stats.BakeMs = MillisecondsSince(start);
+    m_stats.Texels = map.Texels.size();
+    m_stats.Dirty = { 0, 0, m_width, m_height };
+}
+
+void GroomBaker::Update(const Groom& groom, const std::vector<uint32_t>& changed, GroomMap& map) {
+    // Past a quarter of the guides, scanning for affected texels costs more than it saves
+    if (groom.Guides.size() != m_guides.size() || map.Width != m_width || map.Height != m_height || m_reach.empty() ||
+        changed.size() * 4 > m_guides.size()) {
+        Bake(groom, m_settings, map);
+        return;
+    }
+    m_stats = GroomBakeStats();
+    m_stats.Guides = (uint32_t)groom.Guides.size();
+    m_stats.Incremental = true;
+
+    // Where the edited guides were and are: a texel that has neither within its reach keeps
+    // the same neighbours and the same result
+    Clock::time_point start = Clock::now();
+    std::vector<float> points; // u, v pairs
+    bool rootsMoved = false;
+    for (uint32_t g : changed) {
+        if (g >= m_guides.size()) continue;
+        const GuideSample before = m_guides[g];
+        IndexGuide(groom, g);
+        points.push_back(before.U);
+        points.push_back(before.V);
+        if (m_guides[g].U != before.U || m_guides[g].V != before.V) {
+            points.push_back(m_guides[g].U);
+            points.push_back(m_guides[g].V);
+            rootsMoved = true;
+        }
+    }
+    if (rootsMoved) BuildGrid();
+    m_stats.IndexMs = MillisecondsSince(start);
+
+    start = Clock::now();
+    const uint32_t tilesX = (m_width + ReachTile - 1) / ReachTile, tilesY = (m_height + ReachTile - 1) / ReachTile;
+    float maxReach = 0.0f;
+    for (float reach : m_tileReach) maxReach = std::max(maxReach, reach);
+    std::vector<std::vector<uint32_t>> tilePoints(m_tileReach.size());
+    std::vector<uint32_t> tiles;
+    for (uint32_t p = 0; p < points.size() / 2; p++) {
+        const float u = points[p * 2], v = points[p * 2 + 1];
+        uint32_t tx0 = 0, ty0 = 0, tx1 = tilesX - 1, ty1 = tilesY - 1;
+        if (maxReach < Unreached) {
+            const float r = std::sqrt(maxReach);
+            auto tileOf = [&](float x, uint32_t size, uint32_t tiles) {
+                return (uint32_t)std::clamp((int32_t)std::floor(x * size / ReachTile), 0, (int32_t)tiles - 1);
+            };
+            tx0 = tileOf(u - r, m_width, tilesX), tx1 = tileOf(u + r, m_width, tilesX);
+            ty0 = tileOf(v - r, m_height, tilesY), ty1 = tileOf(v + r, m_height, tilesY);
+        }
+        for (uint32_t ty = ty0; ty <= ty1; ty++) {
+            for (uint32_t tx = tx0; tx <= tx1; tx++) {
+                // Nearest texel centre of the tile, against the tile's largest reach
+                uint32_t tile = ty * tilesX + tx;
+                float nu = std::clamp(u, TexelCentre(tx * ReachTile, m_width),
+                                      TexelCentre(std::min((tx + 1) * ReachTile, m_width) - 1, m_width));
+                float nv = std::clamp(v, TexelCentre(ty * ReachTile, m_height),
+                                      TexelCentre(std::min((ty + 1) * ReachTile, m_height) - 1, m_height));
+                float d2 = (nu - u) * (nu - u) + (nv - v) * (nv - v);
+                if (d2 > m_tileReach[tile] * 1.0001f + 1e-12f) continue;
+                if (tilePoints[tile].empty()) tiles.push_back(tile);
+                tilePoints[tile].push_back(p);
+            }
+        }
+    }
+
+    std::atomic<uint64_t> texels{ 0 };
+    std::vector<GroomTexelRect> dirty(tiles.size());
+    m_jobs.ParallelFor(tiles.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            const uint32_t tile = tiles[t];
+            const uint32_t x0 = (tile % tilesX) * ReachTile, y0 = (tile / tilesX) * ReachTile;
+            const uint32_t x1 = std::min(x0 + ReachTile, m_width), y1 = std::min(y0 + ReachTile, m_height);
+            GroomTexelRect rect = { x1, y1, x0, y0 };
+            uint64_t count = 0;
+            for (uint32_t y = y0; y < y1; y++) {
+                const float v = TexelCentre(y, m_height);
+                for (uint32_t x = x0; x < x1; x++) {
+                    const float u = TexelCentre(x, m_width);
+                    const float reach = m_reach[(size_t)y * m_width + x];
+                    bool reached = false;
+                    for (uint32_t p : tilePoints[tile]) {
+                        float du = points[p * 2] - u, dv = points[p * 2 + 1] - v;
+                        if (du * du + dv * dv <= reach) {
+                            reached = true;
+                            break;
+                        }
+                    }
+                    if (!reached) continue;
+                    map.Texels[(size_t)y * m_width + x] = EncodeTexel(x, y);
+                    rect = { std::min(rect.Left, x), std::min(rect.Top, y), std::max(rect.Right, x + 1), std::max(rect.Bottom, y + 1) };
+                    count++;
+                }
+            }
+            if (count) UpdateTileReach(tile);
+            dirty[t] = rect;
+            texels += count;
+        }
+    });
+
+    GroomTexelRect bounds = { m_width, m_height, 0, 0 };
+    for (const GroomTexelRect& rect : dirty) {
+        if (rect.Empty()) continue;
+        bounds = { std::min(bounds.Left, rect.Left), std::min(bounds.Top, rect.Top), std::max(bounds.Right, rect.Right),
+                   std::max(bounds.Bottom, rect.Bottom) };
+    }
+    m_stats.Dirty = bounds.Empty() ? GroomTexelRect() : bounds;
+    m_stats.Texels = texels.load();
+    m_stats.BakeMs = MillisecondsSince(start);
+}
+
+// Lengyel's per-triangle UV gradients, summed per vertex and made orthogonal to the normal
+void GroomBaker::ComputeTangents(const float* vertices, size_t stride, size_t vertexCount, const uint32_t* indices,
+                                 size_t triangleCount, std::vector<VertexTangent>& tangents) {
+    std::vector<Float3> uDirs(vertexCount), vDirs(vertexCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t i0 = indices[t * 3], i1 = indices[t * 3 + 1], i2 = indices[t * 3 + 2];
+        if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount) continue;
+        const float* a = vertices + i0 * stride;
+        const float* b = vertices + i1 * stride;
+        const float* c = vertices + i2 * stride;
+        Float3 e1(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+        Float3 e2(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+        float du1 = b[6] - a[6], dv1 = b[7] - a[7];
+        float du2 = c[6] - a[6], dv2 = c[7] - a[7];
+        float det = du1 * dv2 - du2 * dv1;
+        if (std::fabs(det) < 1e-20f) continue;
+        float inv = 1.0f / det;
+        Float3 uDir = (e1 * dv2 - e2 * dv1) * inv;
+        Float3 vDir = (e2 * du1 - e1 * du2) * inv;
+        for (uint32_t i : { i0, i1, i2 }) {
+            uDirs[i] += uDir;
+            vDirs[i] += vDir;
+        }
+    }
+
+    tangents.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float* src = vertices + v * stride;
+        Float3 n = Normalize(Float3(src[3], src[4], src[5]));
+        Float3 t = uDirs[v] - n * Dot(n, uDirs[v]);
+        if (Dot(t, t) < 1e-20f) {
+            // No usable UVs: any direction across the normal
+            t = std::fabs(n.x) < 0.9f ? Cross(n, Float3(1.0f, 0.0f, 0.0f)) : Cross(n, Float3(0.0f, 1.0f, 0.0f));
+        }
+        tangents[v].Tangent = Normalize(t);
+        tangents[v].Handedness = Dot(Cross(n, tangents[v].Tangent), vDirs[v]) < 0.0f ? -1.0f : 1.0f;
+    }
+}
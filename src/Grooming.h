@@ -0,0 +1,132 @@
+#pragma once
+#include "CoreMath.h"
+#include "JobSystem.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Combed and parted fur. Guide hairs are rooted in UV space and their points live in the
+// surface's tangent frame (x along +U, y along +V, z along the normal) in units of the material's
+// fur length, so a groom fits any mesh with the same UV layout and follows it when skinned. The
+// baker interpolates the guides into a UV-space map the shell and fin extrusion read: per texel
+// the strand direction in the tangent frame and a scale on the fur length.
+// Each texel blends its Neighbours nearest guides with Shepard weights that fall to zero at the
+// next-nearest one, which keeps the map continuous as the set of neighbours changes. The guides
+// are indexed by a uniform grid over UV. Since a texel only depends on guides within the distance
+// of its (Neighbours + 1)-th nearest, the baker keeps that radius per texel and a guide edit
+// re-bakes only the texels it can reach; the result is identical to a full bake.
+
+// Root of one guide; its points follow the root, which is implicitly the origin
+struct GroomGuide {
+    float U = 0.0f;
+    float V = 0.0f;
+    uint32_t FirstPoint = 0; // Into Groom::Points
+    uint32_t PointCount = 0;
+};
+
+struct Groom {
+    std::vector<GroomGuide> Guides;
+    std::vector<Float3> Points; // Tangent frame, fur lengths
+
+    bool Empty() const { return Guides.empty(); }
+    void AddGuide(float u, float v, const Float3* points, uint32_t count);
+};
+
+// Binary .pgrm files, and JSON either as a file or inside glTF extras:
+//   { "guides": [ { "uv": [u, v], "points": [[x, y, z], ...] }, ... ] }
+// The bare guide array is accepted too.
+class GroomFile {
+public:
+    static constexpr uint32_t Version = 1;
+
+    static bool Read(const std::string& path, Groom& groom);
+    static bool Write(const std::string& path, const Groom& groom);
+    static bool ParseJson(const std::string& text, Groom& groom);
+};
+
+// Tangent of a vertex, its bitangent being cross(normal, Tangent) * Handedness; matches the
+// TANGENT vertex stream
+struct VertexTangent {
+    Float3 Tangent = Float3(1.0f, 0.0f, 0.0f);
+    float Handedness = 1.0f;
+};
+
+struct GroomMapSettings {
+    uint32_t Size = 1024;     // Texels per side
+    uint32_t Neighbours = 4;  // Guides blended per texel
+    float MaxLength = 2.0f;   // Length scale at alpha 1
+};
+
+// RGBA8 texels: rgb = direction * 0.5 + 0.5, a = length scale / MaxLength. Row 0 is v = 0.
+struct GroomMap {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    float MaxLength = 2.0f;
+    std::vector<uint32_t> Texels;
+
+    bool Empty() const { return Texels.empty(); }
+    // Fur along the normal at the material's length, everywhere
+    static GroomMap Neutral();
+    void Decode(uint32_t x, uint32_t y, Float3& direction, float& length) const;
+    float LongestStrand() const; // Largest length scale of any texel
+};
+
+struct GroomTexelRect {
+    uint32_t Left = 0, Top = 0, Right = 0, Bottom = 0; // Right and Bottom exclusive
+
+    bool Empty() const { return Right <= Left || Bottom <= Top; }
+};
+
+struct GroomBakeStats {
+    uint32_t Guides = 0;
+    uint64_t Texels = 0;    // Re-evaluated by the last Bake or Update
+    double IndexMs = 0.0;   // Guide directions and the grid; Update only rebuilds it if roots moved
+    double BakeMs = 0.0;
+    bool Incremental = false;
+    GroomTexelRect Dirty;   // Texels that may have changed, for a partial upload
+};
+
+class GroomBaker {
+public:
+    explicit GroomBaker(JobSystem& jobs) : m_jobs(jobs) {}
+
+    void Bake(const Groom& groom, const GroomMapSettings& settings, GroomMap& map);
+
+    // After 'changed' guides of the groom last baked into 'map' were edited (moved, combed or
+    // resized), re-bakes the texels they reach. A different guide count falls back to Bake.
+    void Update(const Groom& groom, const std::vector<uint32_t>& changed, GroomMap& map);
+
+    const GroomBakeStats& Stats() const { return m_stats; }
+
+    // Per-vertex tangents from the UV layout, for meshes that don't bring their own. 'vertices'
+    // holds 'stride' floats per vertex: position, normal, UV (GeometryGen's Vertex).
+    static void ComputeTangents(const float* vertices, size_t stride, size_t vertexCount, const uint32_t* indices,
+                                size_t triangleCount, std::vector<VertexTangent>& tangents);
+
+private:
+    static constexpr uint32_t MaxNeighbours = 16;
+    static constexpr uint32_t ReachTile = 32; // Texels per side of the tiles Update scans
+
+    struct GuideSample {
+        float U, V;
+        Float3 Direction;
+        float Length;
+    };
+
+    void IndexGuide(const Groom& groom, size_t guide);
+    void BuildGrid();
+    uint32_t EncodeTexel(uint32_t x, uint32_t y);
+    void UpdateTileReach(uint32_t tile);
+
+    JobSystem& m_jobs;
+    GroomMapSettings m_settings;
+    GroomBakeStats m_stats;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    std::vector<GuideSample> m_guides;
+    uint32_t m_gridSize = 0;
+    std::vector<uint32_t> m_cellStart; // m_gridSize^2 + 1, into m_cellGuides
+    std::vector<uint32_t> m_cellGuides;
+    std::vector<float> m_reach;        // Per texel: squared distance to the nearest guide that has no say in it
+    std::vector<float> m_tileReach;    // Per tile, the largest m_reach
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 64-bit FNV-1a, for the cache keys, the asset graph's content hashes and the benches' checksums.
+constexpr uint64_t HashSeed = 14695981039346656037ull;
+constexpr uint64_t HashPrime = 1099511628211ull;
+
+// Continues from 'hash'; HashSeed to start
+inline uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * HashPrime;
+    return hash;
+}
+
+// The same over 32-bit words, a quarter of the steps for float and index arrays; any trailing
+// bytes are hashed one at a time. Not interchangeable with HashBytes.
+inline uint64_t HashWords(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i + 4 <= size; i += 4) {
+        uint32_t word;
+        memcpy(&word, bytes + i, 4);
+        hash = (hash ^ word) * HashPrime;
+    }
+    return HashBytes(hash, bytes + (size & ~(size_t)3), size & 3);
+}
@@ -0,0 +1,224 @@
+// Headless hot-reload benchmark. First checks the asset graph and file watcher on cases with
+// known answers:
+//   a changed source                   rebuilds what is downstream of it, in order, and nothing else
+//   a rebuild with the same output     stops there (a shader edited in a comment keeps its PSOs)
+//   a diamond                          rebuilds the join once, after both sides
+//   a failed build                     keeps its output, is retried after the next edit, not after an undo
+//   a settings change                  rebuilds only what uses those settings
+//   touching or re-saving a file       is not a change; new content is, once, even after a delete
+// Then builds a renderer-shaped graph of 100K nodes (or the count given) over 1K watched files,
+// and times polling, planning and the rebuild walk after one edit and after editing every file.
+// Usage: PelageHotReloadBench [nodes]
+#include "AssetGraph.h"
+#include "BenchReport.h"
+#include "FileWatcher.h"
+#include "Timing.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+// Builds every planned node that needs it; a node's output is 'output(id)'. Returns the nodes built.
+template <typename Output>
+static std::vector<AssetId> Rebuild(AssetGraph& graph, Output output) {
+    std::vector<AssetId> built;
+    for (AssetId id : graph.Plan()) {
+        if (!graph.NeedsBuild(id)) continue;
+        graph.MarkBuilt(id, output(id));
+        built.push_back(id);
+    }
+    return built;
+}
+
+// Output derived from the inputs, as a real build would produce
+static std::vector<AssetId> RebuildAll(AssetGraph& graph) {
+    return Rebuild(graph, [&](AssetId id) { return graph.InputHash(id); });
+}
+
+static bool CheckGraph() {
+    bool ok = true;
+
+    // The renderer's shape in small: two shader files, variants, PSOs, and noise settings
+    AssetGraph graph;
+    AssetId shellPs = graph.AddSource("shell_ps.hlsl", 1);
+    AssetId shellVs = graph.AddSource("shell_vs.hlsl", 2);
+    AssetId noiseSettings = graph.AddSettings("noise settings", 3);
+    AssetId psVariant = graph.AddDerived("shell_ps", { shellPs });
+    AssetId vsVariant = graph.AddDerived("shell_vs", { shellVs });
+    AssetId shellPso = graph.AddDerived("shell PSO", { vsVariant, psVariant });
+    AssetId osmPso = graph.AddDerived("osm depth PSO", { vsVariant });
+    AssetId noise = graph.AddDerived("noise", { noiseSettings });
+    AssetId volume = graph.AddDerived("fur volume", { noise });
+    ok &= Report("first plan builds everything", RebuildAll(graph).size() == 6 && !graph.NeedsBuild(shellPso));
+    ok &= Report("nothing changed", graph.Plan().empty() && !graph.SetHash(shellPs, 1) && graph.Plan().empty());
+    ok &= Report("unknown input rejected", graph.AddDerived("broken", { 1000 }) == InvalidAsset &&
+                                           graph.AddDerived("noise", { noiseSettings }) == InvalidAsset);
+
+    graph.SetHash(shellPs, 10);
+    std::vector<AssetId> built = RebuildAll(graph);
+    ok &= Report("changed source", built == std::vector<AssetId>{ psVariant, shellPso });
+
+    // Same bytecode out of the variant: the PSO is planned but needs no build
+    graph.SetHash(shellPs, 11);
+    built = Rebuild(graph, [&](AssetId id) { return id == psVariant ? graph.Node(psVariant).Hash : graph.InputHash(id); });
+    ok &= Report("same output stops", built == std::vector<AssetId>{ psVariant } && graph.Stats().Planned == 2 &&
+                                      graph.Stats().Unchanged == 1);
+
+    graph.SetHash(noiseSettings, 30);
+    ok &= Report("settings change", RebuildAll(graph) == std::vector<AssetId>{ noise, volume });
+
+    // Diamond: both sides change, the join is built once, last
+    AssetGraph diamond;
+    AssetId source = diamond.AddSource("mesh.gltf", 1);
+    AssetId left = diamond.AddDerived("adjacency", { source });
+    AssetId right = diamond.AddDerived("clusters", { source });
+    AssetId join = diamond.AddDerived("draw lists", { left, right });
+    RebuildAll(diamond);
+    diamond.SetHash(source, 2);
+    ok &= Report("diamond", RebuildAll(diamond) == std::vector<AssetId>{ left, right, join });
+
+    // A failed compile keeps the last good PSO; undoing the edit needs nothing
+    graph.SetHash(shellVs, 20);
+    std::vector<AssetId> plan = graph.Plan();
+    graph.MarkFailed(vsVariant);
+    bool downstreamClean = !graph.NeedsBuild(shellPso) && !graph.NeedsBuild(osmPso);
+    graph.SetHash(shellVs, 2);
+    bool undone = RebuildAll(graph).empty();
+    graph.SetHash(shellVs, 21);
+    built = RebuildAll(graph);
+    ok &= Report("failed build", plan.size() == 3 && downstreamClean && undone &&
+                                 built == std::vector<AssetId>{ vsVariant, shellPso, osmPso });
+    return ok;
+}
+
+static bool WriteFile(const std::filesystem::path& path, const std::string& text) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << text;
+    return (bool)file;
+}
+
+// Modification times can be coarse; move them explicitly so every rewrite is seen
+static void Bump(const std::filesystem::path& path, int seconds) {
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::last_write_time(path, error) + std::chrono::seconds(seconds), error);
+}
+
+static bool CheckWatcher(const std::filesystem::path& directory) {
+    bool ok = true;
+    std::filesystem::path a = directory / "a.hlsl", b = directory / "b.hlsl";
+    WriteFile(a, "float4 main() : SV_TARGET { return 1; }");
+    WriteFile(b, "// b");
+    FileWatcher watcher;
+    uint64_t hashA = watcher.Watch(a.string());
+    watcher.Watch(b.string());
+    uint64_t expected = 0;
+    ok &= Report("watch hashes content", FileWatcher::HashFile(a.string(), expected) && hashA == expected && hashA != 0);
+    ok &= Report("quiet poll", watcher.Poll().empty() && watcher.Stats().Read == 0);
+
+    Bump(a, 5);
+    WriteFile(b, "// b");
+    Bump(b, 5);
+    ok &= Report("touch and re-save", watcher.Poll().empty() && watcher.Stats().Read == 2);
+
+    WriteFile(a, "float4 main() : SV_TARGET { return 0.5; }");
+    Bump(a, 10);
+    std::vector<std::string> changed = watcher.Poll();
+    ok &= Report("edit", changed == std::vector<std::string>{ a.string() } && watcher.Hash(a.string()) != hashA &&
+                         watcher.Poll().empty());
+
+    std::filesystem::remove(b);
+    bool deleted = watcher.Poll().empty();
+    WriteFile(b, "// b, again");
+    Bump(b, 20);
+    changed = watcher.Poll();
+    ok &= Report("delete and recreate", deleted && changed == std::vector<std::string>{ b.string() });
+    return ok;
+}
+
+// One source per path, then four layers shaped like the renderer's: shader variants, PSOs, baked
+// data and uploads, each node built from up to three neighbouring nodes of the layer before, until
+// 'nodeCount' nodes
+static void BuildLargeGraph(AssetGraph& graph, const std::vector<std::string>& paths, uint32_t nodeCount) {
+    std::vector<AssetId> layer;
+    for (const std::string& path : paths) {
+        uint64_t hash = 0;
+        FileWatcher::HashFile(path, hash);
+        layer.push_back(graph.AddSource(path, hash));
+    }
+    const uint32_t layers = 4;
+    const uint32_t width = std::max((nodeCount - graph.NodeCount()) / layers, 1u);
+    uint32_t seed = 1;
+    char name[32];
+    for (uint32_t l = 0; l < layers; l++) {
+        std::vector<AssetId> next;
+        for (uint32_t i = 0; i < width; i++) {
+            size_t first = (size_t)i * layer.size() / width;
+            std::vector<AssetId> inputs = { layer[first] };
+            seed = seed * 1664525u + 1013904223u;
+            for (uint32_t extra = 0; extra < (seed >> 30); extra++) {
+                size_t neighbour = first + 1 + extra;
+                if (neighbour < layer.size()) inputs.push_back(layer[neighbour]);
+            }
+            snprintf(name, sizeof(name), "node %u", graph.NodeCount());
+            next.push_back(graph.AddDerived(name, inputs));
+        }
+        layer = std::move(next);
+    }
+}
+
+static void Benchmark(const std::filesystem::path& directory, uint32_t nodeCount) {
+    const uint32_t sourceCount = std::max(nodeCount / 100, 1u);
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < sourceCount; i++) {
+        std::filesystem::path path = directory / ("source" + std::to_string(i) + ".txt");
+        WriteFile(path, "source " + std::to_string(i));
+        paths.push_back(path.string());
+    }
+
+    Clock::time_point start = Clock::now();
+    AssetGraph graph;
+    BuildLargeGraph(graph, paths, nodeCount);
+    FileWatcher watcher;
+    for (const std::string& path : paths) watcher.Watch(path);
+    double setupMs = MillisecondsSince(start);
+    RebuildAll(graph);
+
+    watcher.Poll();
+    double quietPollMs = watcher.Stats().PollMs;
+
+    // One edited file, then every file edited
+    for (uint32_t round = 0; round < 2; round++) {
+        uint32_t edits = round == 0 ? 1 : sourceCount;
+        for (uint32_t i = 0; i < edits; i++) {
+            WriteFile(paths[i], "edited " + std::to_string(i));
+            Bump(paths[i], 30);
+        }
+        start = Clock::now();
+        std::vector<std::string> changed = watcher.Poll();
+        double pollMs = MillisecondsSince(start);
+
+        start = Clock::now();
+        for (const std::string& path : changed) graph.SetHash(graph.Find(path), watcher.Hash(path));
+        std::vector<AssetId> built = RebuildAll(graph);
+        double rebuildMs = MillisecondsSince(start);
+        printf("%6u of %u files edited: poll %.3f ms, plan and walk %.3f ms, %u of %u nodes planned, %zu rebuilt\n",
+               (uint32_t)changed.size(), sourceCount, pollMs, rebuildMs, graph.Stats().Planned, graph.NodeCount(), built.size());
+    }
+    printf("%u nodes over %u files: set up in %.1f ms, quiet poll %.3f ms\n", graph.NodeCount(), sourceCount, setupMs, quietPollMs);
+}
+
+int main(int argc, char** argv) {
+    const uint32_t nodeCount = argc > 1 ? (uint32_t)std::max(atoi(argv[1]), 2) : 100000;
+
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(error) / "pelage_hot_reload_bench";
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory, error);
+
+    bool ok = CheckGraph();
+    ok &= CheckWatcher(directory);
+    Benchmark(directory, nodeCount);
+
+    std::filesystem::remove_all(directory, error);
+    return ok ? 0 : 1;
+}
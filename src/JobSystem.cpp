@@ -0,0 +1,102 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace {
+    // Set while a thread executes chunks, so nested ParallelFor calls run inline
+    thread_local bool t_insideJob = false;
+}
+
+JobSystem::JobSystem(uint32_t workerCount) {
+    if (workerCount == 0) {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_workers.emplace_back(&JobSystem::WorkerLoop, this);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::RunChunks(Batch& batch) {
+    size_t chunk;
+    while ((chunk = batch.NextChunk.fetch_add(1)) < batch.ChunkCount) {
+        size_t begin = chunk * batch.GrainSize;
+        size_t end = std::min(begin + batch.GrainSize, batch.Count);
+        (*batch.Fn)(begin, end);
+        batch.DoneChunks.fetch_add(1);
+    }
+}
+
+void JobSystem::WorkerLoop() {
+    uint64_t seenGeneration = 0;
+    for (;;) {
+        Batch* batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_quit || (m_batch && m_generation != seenGeneration); });
+            if (m_quit) return;
+            seenGeneration = m_generation;
+            batch = m_batch;
+            m_activeWorkers++;
+        }
+
+        t_insideJob = true;
+        RunChunks(*batch);
+        t_insideJob = false;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_activeWorkers--;
+        }
+        m_done.notify_all();
+    }
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& fn) {
+    if (count == 0) return;
+    grainSize = std::max<size_t>(grainSize, 1);
+    size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+    // Serial fallback: nothing to split, no workers, nested call, or another batch in flight
+    std::unique_lock<std::mutex> submitLock(m_submitMutex, std::defer_lock);
+    if (chunkCount == 1 || m_workers.empty() || t_insideJob || !submitLock.try_lock()) {
+        for (size_t begin = 0; begin < count; begin += grainSize) {
+            fn(begin, std::min(begin + grainSize, count));
+        }
+        return;
+    }
+
+    Batch batch;
+    batch.Fn = &fn;
+    batch.Count = count;
+    batch.GrainSize = grainSize;
+    batch.ChunkCount = chunkCount;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_batch = &batch;
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    t_insideJob = true;
+    RunChunks(batch);
+    t_insideJob = false;
+
+    // Wait for the remaining chunks and for every worker to let go of the batch before it goes out of scope
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return batch.DoneChunks.load() == batch.ChunkCount && m_activeWorkers == 0; });
+    m_batch = nullptr;
+}
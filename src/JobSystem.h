@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Minimal fork-join worker pool for the CPU-side kernels (culling, rasterization, baking...).
+// ParallelFor splits [0, count) into grain-sized chunks that the workers and the calling
+// thread pull from a shared counter; it returns when every chunk has run.
+// Nested or concurrent ParallelFor calls run inline on the calling thread instead of deadlocking.
+class JobSystem {
+public:
+    // workerCount = 0 picks hardware_concurrency - 1 (the caller is the extra thread)
+    explicit JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Threads that execute a ParallelFor, including the caller
+    uint32_t ThreadCount() const { return (uint32_t)m_workers.size() + 1; }
+
+    void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& fn);
+
+private:
+    struct Batch {
+        const std::function<void(size_t, size_t)>* Fn = nullptr;
+        size_t Count = 0;
+        size_t GrainSize = 1;
+        size_t ChunkCount = 0;
+        std::atomic<size_t> NextChunk{ 0 };
+        std::atomic<size_t> DoneChunks{ 0 };
+    };
+
+    void WorkerLoop();
+    static void RunChunks(Batch& batch);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    Batch* m_batch = nullptr;
+    uint64_t m_generation = 0;
+    uint32_t m_activeWorkers = 0; // Workers currently holding m_batch
+    bool m_quit = false;
+
+    std::mutex m_submitMutex; // One batch in flight at a time
+};
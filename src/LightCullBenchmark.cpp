@@ -0,0 +1,208 @@
+// Headless clustered light culling benchmark. First checks the culler on lights with known answers:
+//   a point light in front of the camera     in the clusters around it, and no others
+//   lights behind the camera or past far     in no cluster
+//   directional lights                       first in Lights(), never clustered
+// Then, on random scenes of point and spot lights, checks that the lists match the one-light-at-
+// a-time reference exactly and that every light reaching a random visible point is in that point's
+// cluster, and times the per-frame build of a moving camera at 1K lights (or the count given).
+// Usage: PelageLightCullBench [lights] [frames]
+#include "BenchReport.h"
+#include "LightCulling.h"
+#include "Timing.h"
+#include <cstdio>
+#include <cstdlib>
+
+static constexpr float Pi = 3.14159265f;
+static constexpr float FieldOfView = 0.785398163f;
+static constexpr float Aspect = 16.0f / 9.0f;
+static constexpr float NearZ = 0.1f;
+static constexpr float FarZ = 100.0f;
+
+static uint64_t g_random = 1;
+
+static float Random() {
+    g_random = g_random * 6364136223846793005ull + 1442695040888963407ull;
+    return (float)(g_random >> 40) * (1.0f / 16777216.0f);
+}
+
+// Point and spot lights scattered through a 60 m box around the origin, with ranges of 1-6 m
+static std::vector<SceneLight> RandomLights(uint32_t count) {
+    std::vector<SceneLight> lights(count);
+    for (SceneLight& light : lights) {
+        light.Type = Random() < 0.6f ? LightType::Point : LightType::Spot;
+        light.Position = Float3(Random() * 60.0f - 30.0f, Random() * 10.0f - 2.0f, Random() * 60.0f - 30.0f);
+        light.Direction = Normalize(Float3(Random() - 0.5f, Random() - 0.8f, Random() - 0.5f));
+        light.Color = Float3(Random(), Random(), Random()) * 4.0f;
+        light.Range = 1.0f + Random() * 5.0f;
+        light.OuterAngle = 0.1f + Random() * (0.5f * Pi - 0.1f);
+        light.InnerAngle = light.OuterAngle * Random();
+    }
+    return lights;
+}
+
+static Float4x4 OrbitView(float angle) {
+    Float3 camera(25.0f * std::cos(angle), 6.0f, 25.0f * std::sin(angle));
+    return LookAtLH(camera, Float3(0.0f, 0.0f, 0.0f), Float3(0.0f, 1.0f, 0.0f));
+}
+
+static bool Contains(const LightCuller& culler, uint32_t cluster, uint32_t light) {
+    const LightCluster& c = culler.Clusters()[cluster];
+    for (uint32_t i = 0; i < c.Count; i++) {
+        if (culler.Indices()[c.Offset + i] == light) return true;
+    }
+    return false;
+}
+
+static bool CheckKnownLights(JobSystem& jobs) {
+    bool ok = true;
+    LightCuller culler(jobs);
+    const Float4x4 view = Float4x4::Identity(); // Looking down +z from the origin
+
+    // A point light 10 m ahead of the camera, 1 m range: centre tiles only, around depth 10
+    SceneLight point;
+    point.Position = Float3(0.0f, 0.0f, 10.0f);
+    point.Range = 1.0f;
+    culler.Build({ point }, view, FieldOfView, Aspect, NearZ, FarZ);
+    const LightClusterGrid& grid = culler.Grid();
+    uint32_t centre = grid.ClusterIndex(point.Position);
+    uint32_t distant = grid.ClusterIndex(Float3(0.0f, 0.0f, 20.0f));
+    uint32_t corner = grid.ClusterIndex(Float3(-3.5f, 2.0f, 10.0f));
+    bool single = culler.Lights().size() == 1 && culler.DirectionalCount() == 0;
+    ok &= Report("point light clusters", single && Contains(culler, centre, 0) && !Contains(culler, distant, 0) &&
+                                             !Contains(culler, corner, 0) && culler.Stats().Indices < 64);
+
+    // Behind the camera and beyond the far plane
+    SceneLight behind = point, beyond = point;
+    behind.Position = Float3(0.0f, 0.0f, -2.0f);
+    beyond.Position = Float3(0.0f, 0.0f, FarZ + 2.0f);
+    culler.Build({ behind, beyond }, view, FieldOfView, Aspect, NearZ, FarZ);
+    ok &= Report("lights out of view", culler.Indices().empty());
+
+    // Directional lights sort first and the point light's index moves past them
+    SceneLight sun;
+    sun.Type = LightType::Directional;
+    culler.Build({ point, sun, sun }, view, FieldOfView, Aspect, NearZ, FarZ);
+    bool directional = culler.DirectionalCount() == 2 && culler.Lights()[0].Type == (uint32_t)LightType::Directional &&
+                       culler.Lights()[2].Type == (uint32_t)LightType::Point;
+    bool indices = true;
+    for (uint32_t index : culler.Indices()) indices &= index == 2;
+    ok &= Report("directional lights", directional && indices && Contains(culler, centre, 2));
+
+    // A spot light pointing away from the camera lights nothing in front of its apex's near side
+    SceneLight spot = point;
+    spot.Type = LightType::Spot;
+    spot.Direction = Float3(0.0f, 0.0f, 1.0f);
+    spot.Range = 4.0f;
+    spot.OuterAngle = 0.2f;
+    culler.Build({ spot }, view, FieldOfView, Aspect, NearZ, FarZ);
+    uint32_t inCone = grid.ClusterIndex(Float3(0.0f, 0.0f, 13.0f));
+    uint32_t behindApex = grid.ClusterIndex(Float3(0.0f, 0.0f, 7.0f));
+    uint32_t beside = grid.ClusterIndex(Float3(3.5f, 0.0f, 12.0f));
+    ok &= Report("spot light cone", Contains(culler, inCone, 0) && !Contains(culler, behindApex, 0) && !Contains(culler, beside, 0));
+    return ok;
+}
+
+// Every light that puts any light on a visible point must be listed in that point's cluster
+static bool Conservative(const LightCuller& culler, const Float4x4& view, uint32_t samples) {
+    const LightClusterGrid& grid = culler.Grid();
+    const std::vector<GpuLight>& lights = culler.Lights();
+    // World from view: the view matrix is a rotation and a translation
+    Float4x4 inverse = Float4x4::Identity();
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) inverse.m[i][j] = view.m[j][i];
+    }
+    Float3 translation(view.m[3][0], view.m[3][1], view.m[3][2]);
+    for (int j = 0; j < 3; j++) {
+        inverse.m[3][j] = -(translation.x * inverse.m[0][j] + translation.y * inverse.m[1][j] + translation.z * inverse.m[2][j]);
+    }
+
+    uint32_t missed = 0;
+    for (uint32_t sample = 0; sample < samples; sample++) {
+        // Uniform in the frustum's NDC square, at a depth where the lights are
+        float z = NearZ + Random() * 40.0f;
+        float ndcX = Random() * 2.0f - 1.0f, ndcY = Random() * 2.0f - 1.0f;
+        Float3 viewPosition(ndcX * z / grid.ProjX, ndcY * z / grid.ProjY, z);
+        Float3 world = TransformPoint(inverse, viewPosition);
+        uint32_t cluster = grid.ClusterIndex(viewPosition);
+        for (uint32_t i = culler.DirectionalCount(); i < (uint32_t)lights.size(); i++) {
+            const GpuLight& light = lights[i];
+            Float3 toLight = light.Position - world;
+            float distance = Length(toLight);
+            if (LightCuller::Attenuation(distance, light.Range) <= 0.0f) continue;
+            if (light.Type == (uint32_t)LightType::Spot &&
+                LightCuller::SpotFalloff(light, Dot(light.Direction, toLight * (-1.0f / distance))) <= 0.0f) continue;
+            if (!Contains(culler, cluster, i)) missed++;
+        }
+    }
+    if (missed) printf("  %u lit samples missing their light\n", missed);
+    return missed == 0;
+}
+
+static bool CheckRandomScenes(JobSystem& jobs) {
+    bool ok = true;
+    const uint32_t counts[] = { 1, 16, 256, 1024, 4096 };
+    for (uint32_t count : counts) {
+        std::vector<SceneLight> lights = RandomLights(count);
+        LightCuller culler(jobs);
+        bool same = true, conservative = true;
+        for (int frame = 0; frame < 4; frame++) {
+            Float4x4 view = OrbitView(frame * 1.7f);
+            culler.Build(lights, view, FieldOfView, Aspect, NearZ, FarZ);
+            std::vector<LightCluster> clusters;
+            std::vector<uint32_t> indices;
+            LightCuller::BuildReference(lights, view, FieldOfView, Aspect, NearZ, FarZ, LightClusterSettings(), clusters, indices);
+            same &= indices == culler.Indices() && clusters.size() == culler.Clusters().size();
+            for (size_t c = 0; same && c < clusters.size(); c++) {
+                same &= clusters[c].Offset == culler.Clusters()[c].Offset && clusters[c].Count == culler.Clusters()[c].Count;
+            }
+            conservative &= Conservative(culler, view, 20000);
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "%u lights: matches reference", count);
+        ok &= Report(name, same);
+        snprintf(name, sizeof(name), "%u lights: every lit point", count);
+        ok &= Report(name, conservative);
+    }
+    return ok;
+}
+
+// A camera orbiting through the lights, one build per frame
+static void Benchmark(JobSystem& jobs, uint32_t count, uint32_t frames) {
+    std::vector<SceneLight> lights = RandomLights(count);
+    LightCuller culler(jobs);
+    double totalMs = 0.0, worstMs = 0.0;
+    uint64_t indices = 0;
+    uint32_t maxClusterLights = 0, occupied = 0;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        culler.Build(lights, OrbitView(frame * 0.01f), FieldOfView, Aspect, NearZ, FarZ);
+        const LightCullingStats& stats = culler.Stats();
+        totalMs += stats.BuildMs;
+        worstMs = std::max(worstMs, stats.BuildMs);
+        indices += stats.Indices;
+        maxClusterLights = std::max(maxClusterLights, stats.MaxClusterLights);
+        occupied += stats.OccupiedClusters;
+    }
+
+    Clock::time_point start = Clock::now();
+    std::vector<LightCluster> clusters;
+    std::vector<uint32_t> referenceIndices;
+    LightCuller::BuildReference(lights, OrbitView(0.0f), FieldOfView, Aspect, NearZ, FarZ, LightClusterSettings(), clusters, referenceIndices);
+    double referenceMs = MillisecondsSince(start);
+
+    printf("%5u lights: build %.3f ms mean, %.3f ms worst (reference %.2f ms), %llu indices, %u of %u clusters lit, up to %u lights\n",
+           count, totalMs / frames, worstMs, referenceMs, (unsigned long long)(indices / frames), occupied / frames,
+           culler.Grid().ClusterCount(), maxClusterLights);
+}
+
+int main(int argc, char** argv) {
+    std::vector<uint32_t> lightCounts = { 64, 1024, 4096 };
+    if (argc > 1) lightCounts = { (uint32_t)std::max(atoi(argv[1]), 1) };
+    const uint32_t frames = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 1) : 200;
+
+    JobSystem jobs;
+    bool ok = CheckKnownLights(jobs);
+    ok &= CheckRandomScenes(jobs);
+    printf("%u threads, %u frames\n", jobs.ThreadCount(), frames);
+    for (uint32_t count : lightCounts) Benchmark(jobs, count, frames);
+    return ok ? 0 : 1;
+}
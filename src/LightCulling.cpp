@@ -0,0 +1,313 @@
+#include "LightCulling.h"
+#include "Simd.h"
+#include "Timing.h"
+
+static constexpr float HalfPi = 1.570796327f;
+
+// Padding columns never overlap anything
+static constexpr float NoBound = 1e30f;
+
+static Float3 TransformDirection(const Float4x4& t, const Float3& d) {
+    return {
+        d.x * t.m[0][0] + d.y * t.m[1][0] + d.z * t.m[2][0],
+        d.x * t.m[0][1] + d.y * t.m[1][1] + d.z * t.m[2][1],
+        d.x * t.m[0][2] + d.y * t.m[1][2] + d.z * t.m[2][2]
+    };
+}
+
+uint32_t LightClusterGrid::ClusterIndex(const Float3& viewPosition) const {
+    float z = std::max(viewPosition.z, 1e-6f);
+    float ndcX = viewPosition.x * ProjX / z;
+    float ndcY = viewPosition.y * ProjY / z;
+    int x = (int)std::floor((ndcX * 0.5f + 0.5f) * TilesX);
+    int y = (int)std::floor((0.5f - ndcY * 0.5f) * TilesY);
+    int slice = (int)std::floor(std::log(z) * DepthScale + DepthBias);
+    x = std::clamp(x, 0, (int)TilesX - 1);
+    y = std::clamp(y, 0, (int)TilesY - 1);
+    slice = std::clamp(slice, 0, (int)Slices - 1);
+    return ((uint32_t)slice * TilesY + (uint32_t)y) * TilesX + (uint32_t)x;
+}
+
+LightCuller::LightCuller(JobSystem& jobs, const LightClusterSettings& settings)
+    : m_jobs(jobs), m_settings(settings) {
+    m_settings.TilesX = std::max(m_settings.TilesX, 1u);
+    m_settings.TilesY = std::max(m_settings.TilesY, 1u);
+    m_settings.Slices = std::max(m_settings.Slices, 1u);
+}
+
+float LightCuller::Attenuation(float distance, float range) {
+    // Inverse square, windowed smoothly to zero at the range
+    float ratio = distance / range;
+    float ratio2 = ratio * ratio;
+    float window = std::clamp(1.0f - ratio2 * ratio2, 0.0f, 1.0f);
+    return window * window / std::max(distance * distance, 0.01f);
+}
+
+float LightCuller::SpotFalloff(const GpuLight& light, float cosAngle) {
+    float t = std::clamp(cosAngle * light.SpotScale + light.SpotOffset, 0.0f, 1.0f);
+    return t * t;
+}
+
+GpuLight LightCuller::ToGpu(const SceneLight& light) {
+    GpuLight gpu;
+    gpu.Position = light.Position;
+    gpu.Range = light.Range;
+    gpu.Direction = Normalize(light.Direction);
+    gpu.Type = (uint32_t)light.Type;
+    gpu.Color = light.Color;
+    if (light.Type == LightType::Spot) {
+        float cosOuter = std::cos(std::clamp(light.OuterAngle, 0.0f, HalfPi));
+        float cosInner = std::cos(std::clamp(light.InnerAngle, 0.0f, HalfPi));
+        gpu.SpotScale = 1.0f / std::max(cosInner - cosOuter, 1e-4f);
+        gpu.SpotOffset = -cosOuter * gpu.SpotScale;
+    }
+    return gpu;
+}
+
+void LightCuller::BuildGrid(const LightClusterSettings& settings, float fovY, float aspect, float nearZ, float farZ,
+                            LightClusterGrid& grid, std::vector<SliceBounds>& slices) {
+    grid.TilesX = settings.TilesX;
+    grid.TilesY = settings.TilesY;
+    grid.Slices = settings.Slices;
+    grid.ProjY = 1.0f / std::tan(0.5f * fovY);
+    grid.ProjX = grid.ProjY / aspect;
+    grid.DepthScale = settings.Slices / std::log(farZ / nearZ);
+    grid.DepthBias = -std::log(nearZ) * grid.DepthScale;
+
+    // A cluster's box holds its frustum piece, grown a little so positions on a border that
+    // ClusterIndex rounds into it are still inside
+    const uint32_t paddedX = (settings.TilesX + 3) & ~3u;
+    slices.resize(settings.Slices);
+    for (uint32_t s = 0; s < settings.Slices; s++) {
+        SliceBounds& slice = slices[s];
+        float zNear = nearZ * std::pow(farZ / nearZ, (float)s / settings.Slices);
+        float zFar = nearZ * std::pow(farZ / nearZ, (float)(s + 1) / settings.Slices);
+        float margin = 1e-4f * zFar;
+        slice.MinZ = zNear - margin;
+        slice.MaxZ = zFar + margin;
+
+        slice.MinX.assign(paddedX, NoBound);
+        slice.MaxX.assign(paddedX, -NoBound);
+        for (uint32_t x = 0; x < settings.TilesX; x++) {
+            float left = -1.0f + 2.0f * x / settings.TilesX;
+            float right = -1.0f + 2.0f * (x + 1) / settings.TilesX;
+            slice.MinX[x] = std::min(left * zNear, left * zFar) / grid.ProjX - margin;
+            slice.MaxX[x] = std::max(right * zNear, right * zFar) / grid.ProjX + margin;
+        }
+        slice.MinY.resize(settings.TilesY);
+        slice.MaxY.resize(settings.TilesY);
+        for (uint32_t y = 0; y < settings.TilesY; y++) {
+            float top = 1.0f - 2.0f * y / settings.TilesY;
+            float bottom = 1.0f - 2.0f * (y + 1) / settings.TilesY;
+            slice.MinY[y] = std::min(bottom * zNear, bottom * zFar) / grid.ProjY - margin;
+            slice.MaxY[y] = std::max(top * zNear, top * zFar) / grid.ProjY + margin;
+        }
+    }
+}
+
+void LightCuller::PrepareLights(const std::vector<SceneLight>& lights, const Float4x4& view, std::vector<GpuLight>& gpuLights,
+                                uint32_t& directionalCount, std::vector<ViewLight>& viewLights) {
+    gpuLights.clear();
+    viewLights.clear();
+    for (const SceneLight& light : lights) {
+        if (light.Type == LightType::Directional) gpuLights.push_back(ToGpu(light));
+    }
+    directionalCount = (uint32_t)gpuLights.size();
+
+    for (const SceneLight& light : lights) {
+        if (light.Type == LightType::Directional) continue;
+        gpuLights.push_back(ToGpu(light));
+
+        ViewLight v;
+        v.Position = TransformPoint(view, light.Position);
+        v.Axis = Normalize(TransformDirection(view, light.Direction));
+        v.Range = std::max(light.Range, 0.0f);
+        v.Center = v.Position;
+        v.Radius = v.Range;
+        if (light.Type == LightType::Spot) {
+            // The smallest sphere around the cone and its cap: through the apex and the rim for
+            // narrow cones, around the rim for wide ones
+            float angle = std::clamp(light.OuterAngle, 0.0f, HalfPi);
+            v.Spot = true;
+            v.CosOuter = std::cos(angle);
+            v.SinOuter = std::sin(angle);
+            if (angle <= 0.5f * HalfPi) {
+                v.Radius = v.Range / (2.0f * v.CosOuter);
+                v.Center = v.Position + v.Axis * v.Radius;
+            } else {
+                v.Radius = v.Range * v.SinOuter;
+                v.Center = v.Position + v.Axis * (v.Range * v.CosOuter);
+            }
+        }
+        viewLights.push_back(v);
+    }
+}
+
+// Both tests below decide exactly as the SIMD loop in CullSlice does, so the reference build
+// matches it bit for bit
+bool LightCuller::SphereOverlaps(const SliceBounds& slice, uint32_t x, uint32_t y, const ViewLight& light) {
+    const Float3& c = light.Center;
+    float dx = std::max(std::max(slice.MinX[x] - c.x, c.x - slice.MaxX[x]), 0.0f);
+    float dy = std::max(std::max(slice.MinY[y] - c.y, c.y - slice.MaxY[y]), 0.0f);
+    float dz = std::max(std::max(slice.MinZ - c.z, c.z - slice.MaxZ), 0.0f);
+    float dyz = dy * dy + dz * dz;
+    return dx * dx + dyz < light.Radius * light.Radius;
+}
+
+bool LightCuller::ConeOverlaps(const SliceBounds& slice, uint32_t x, uint32_t y, const ViewLight& light) {
+    // The cluster's bounding sphere against the cone: its distance from the cone's side, and
+    // whether it is entirely in front of the cap or behind the apex
+    Float3 boxMin(slice.MinX[x], slice.MinY[y], slice.MinZ);
+    Float3 boxMax(slice.MaxX[x], slice.MaxY[y], slice.MaxZ);
+    Float3 center = (boxMin + boxMax) * 0.5f;
+    float radius = Length(boxMax - boxMin) * 0.5f;
+
+    Float3 v = center - light.Position;
+    float along = Dot(v, light.Axis);
+    float across = std::sqrt(std::max(Dot(v, v) - along * along, 0.0f));
+    float sideDistance = light.CosOuter * across - light.SinOuter * along;
+    return sideDistance <= radius && along <= radius + light.Range && along >= -radius;
+}
+
+void LightCuller::CullSlice(uint32_t s) {
+    const SliceBounds& slice = m_sliceBounds[s];
+    const uint32_t tilesX = m_settings.TilesX, tilesY = m_settings.TilesY;
+    std::vector<uint32_t>& pairs = m_slicePairs[s];
+    pairs.clear();
+
+    for (uint32_t i = 0; i < (uint32_t)m_viewLights.size(); i++) {
+        const ViewLight& light = m_viewLights[i];
+        const Float3& c = light.Center;
+        const float r = light.Radius;
+        if (!(r > 0.0f) || slice.MinZ - c.z >= r || c.z - slice.MaxZ >= r) continue;
+
+        // Columns and rows that are a full radius away on their own axis can't pass the sphere
+        // test, so only the range between them is tested
+        uint32_t firstX = 0, endX = tilesX;
+        while (firstX < endX && c.x - slice.MaxX[firstX] >= r) firstX++;
+        while (endX > firstX && slice.MinX[endX - 1] - c.x >= r) endX--;
+        if (firstX == endX) continue;
+        firstX &= ~3u;
+
+        const uint32_t lightIndex = m_directionalCount + i;
+        const float dz = std::max(std::max(slice.MinZ - c.z, c.z - slice.MaxZ), 0.0f);
+        for (uint32_t y = 0; y < tilesY; y++) {
+            if (c.y - slice.MaxY[y] >= r || slice.MinY[y] - c.y >= r) continue;
+            const float dy = std::max(std::max(slice.MinY[y] - c.y, c.y - slice.MaxY[y]), 0.0f);
+            const float dyz = dy * dy + dz * dz;
+
+            for (uint32_t x = firstX; x < endX; x += 4) {
+#if PELAGE_SSE2
+                __m128 cx = _mm_set1_ps(c.x);
+                __m128 below = _mm_sub_ps(_mm_loadu_ps(&slice.MinX[x]), cx);
+                __m128 above = _mm_sub_ps(cx, _mm_loadu_ps(&slice.MaxX[x]));
+                __m128 dx = _mm_max_ps(_mm_max_ps(below, above), _mm_setzero_ps());
+                __m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_set1_ps(dyz));
+                uint32_t mask = (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(distance, _mm_set1_ps(r * r)));
+#else
+                uint32_t mask = 0;
+                for (uint32_t lane = 0; lane < 4; lane++) {
+                    float dx = std::max(std::max(slice.MinX[x + lane] - c.x, c.x - slice.MaxX[x + lane]), 0.0f);
+                    if (dx * dx + dyz < r * r) mask |= 1u << lane;
+                }
+#endif
+                while (mask) {
+                    uint32_t lane = 0;
+                    while (!(mask & (1u << lane))) lane++;
+                    mask &= mask - 1;
+                    if (light.Spot && !ConeOverlaps(slice, x + lane, y, light)) continue;
+                    pairs.push_back(y * tilesX + x + lane);
+                    pairs.push_back(lightIndex);
+                }
+            }
+        }
+    }
+
+    // Counting sort by cluster; the pairs are in light order, so every list comes out ascending
+    const uint32_t tileCount = tilesX * tilesY;
+    LightCluster* clusters = &m_clusters[(size_t)s * tileCount];
+    for (uint32_t t = 0; t < tileCount; t++) clusters[t] = LightCluster();
+    for (size_t p = 0; p < pairs.size(); p += 2) clusters[pairs[p]].Count++;
+    uint32_t offset = 0;
+    for (uint32_t t = 0; t < tileCount; t++) {
+        clusters[t].Offset = offset;
+        offset += clusters[t].Count;
+    }
+    std::vector<uint32_t>& indices = m_sliceIndices[s];
+    indices.resize(offset);
+    std::vector<uint32_t> cursor(tileCount);
+    for (uint32_t t = 0; t < tileCount; t++) cursor[t] = clusters[t].Offset;
+    for (size_t p = 0; p < pairs.size(); p += 2) indices[cursor[pairs[p]]++] = pairs[p + 1];
+}
+
+void LightCuller::Build(const std::vector<SceneLight>& lights, const Float4x4& view, float fovY, float aspect, float nearZ, float farZ) {
+    const Clock::time_point start = Clock::now();
+    if (m_sliceBounds.empty() || fovY != m_fovY || aspect != m_aspect || nearZ != m_nearZ || farZ != m_farZ) {
+        BuildGrid(m_settings, fovY, aspect, nearZ, farZ, m_grid, m_sliceBounds);
+        m_fovY = fovY;
+        m_aspect = aspect;
+        m_nearZ = nearZ;
+        m_farZ = farZ;
+    }
+    PrepareLights(lights, view, m_lights, m_directionalCount, m_viewLights);
+
+    const uint32_t slices = m_settings.Slices;
+    m_slicePairs.resize(slices);
+    m_sliceIndices.resize(slices);
+    m_clusters.resize(m_grid.ClusterCount());
+    m_jobs.ParallelFor(slices, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) CullSlice((uint32_t)s);
+    });
+
+    // Slices were compacted on their own; place them one after another
+    std::vector<uint32_t> sliceStart(slices + 1, 0);
+    for (uint32_t s = 0; s < slices; s++) sliceStart[s + 1] = sliceStart[s] + (uint32_t)m_sliceIndices[s].size();
+    m_indices.resize(sliceStart[slices]);
+    const uint32_t tileCount = m_settings.TilesX * m_settings.TilesY;
+    m_jobs.ParallelFor(slices, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) {
+            LightCluster* clusters = &m_clusters[s * tileCount];
+            for (uint32_t t = 0; t < tileCount; t++) clusters[t].Offset += sliceStart[s];
+            std::copy(m_sliceIndices[s].begin(), m_sliceIndices[s].end(), m_indices.begin() + sliceStart[s]);
+        }
+    });
+
+    m_stats = {};
+    m_stats.Lights = (uint32_t)m_lights.size();
+    m_stats.Indices = (uint32_t)m_indices.size();
+    for (const LightCluster& cluster : m_clusters) {
+        m_stats.MaxClusterLights = std::max(m_stats.MaxClusterLights, cluster.Count);
+        m_stats.OccupiedClusters += cluster.Count ? 1 : 0;
+    }
+    m_stats.BuildMs = MillisecondsSince(start);
+}
+
+void LightCuller::BuildReference(const std::vector<SceneLight>& lights, const Float4x4& view, float fovY, float aspect,
+                                 float nearZ, float farZ, const LightClusterSettings& settings,
+                                 std::vector<LightCluster>& clusters, std::vector<uint32_t>& indices) {
+    LightClusterGrid grid;
+    std::vector<SliceBounds> slices;
+    BuildGrid(settings, fovY, aspect, nearZ, farZ, grid, slices);
+    std::vector<GpuLight> gpuLights;
+    std::vector<ViewLight> viewLights;
+    uint32_t directionalCount = 0;
+    PrepareLights(lights, view, gpuLights, directionalCount, viewLights);
+
+    clusters.assign(grid.ClusterCount(), LightCluster());
+    indices.clear();
+    for (uint32_t s = 0; s < grid.Slices; s++) {
+        for (uint32_t y = 0; y < grid.TilesY; y++) {
+            for (uint32_t x = 0; x < grid.TilesX; x++) {
+                LightCluster& cluster = clusters[(s * grid.TilesY + y) * grid.TilesX + x];
+                cluster.Offset = (uint32_t)indices.size();
+                for (uint32_t i = 0; i < (uint32_t)viewLights.size(); i++) {
+                    const ViewLight& light = viewLights[i];
+                    if (!(light.Radius > 0.0f) || !SphereOverlaps(slices[s], x, y, light)) continue;
+                    if (light.Spot && !ConeOverlaps(slices[s], x, y, light)) continue;
+                    indices.push_back(directionalCount + i);
+                }
+                cluster.Count = (uint32_t)indices.size() - cluster.Offset;
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include "CoreMath.h"
+#include "JobSystem.h"
+#include <vector>
+
+// Clustered light culling on the CPU. The view frustum is split into TilesX x TilesY screen tiles
+// and Slices depth slices, logarithmic in view depth, and every point and spot light is assigned
+// to the clusters its range reaches: its bounding sphere (the range, or the sphere around a
+// spot's cone) against each cluster's view-space box, 4 tiles at a time with SSE2, then a cone
+// test for spots. Slices are culled in parallel on the job system and compacted into one list
+// of light indices with an offset and count per cluster, which the shell shader looks up from its
+// own position (see ClusterIndex) so it only evaluates the lights that can reach it.
+// Directional lights reach everything and are not clustered; they come first in Lights().
+
+enum class LightType : uint32_t { Directional = 0, Point = 1, Spot = 2 };
+
+// A light as the scene describes it, in world space
+struct SceneLight {
+    LightType Type = LightType::Point;
+    Float3 Position;
+    Float3 Direction = { 0.0f, -1.0f, 0.0f }; // Directional and spot: where the light travels
+    Float3 Color = { 1.0f, 1.0f, 1.0f };      // Intensity included
+    float Range = 10.0f;                      // Point and spot: no light at or beyond it
+    float InnerAngle = 0.0f;                  // Spot: full intensity inside, radians from the axis
+    float OuterAngle = 0.785398163f;          // Spot: no light outside, at most pi / 2
+};
+
+// StructuredBuffer<GpuLight> in shell_ps (64 bytes)
+struct GpuLight {
+    Float3 Position;
+    float Range = 0.0f;
+    Float3 Direction;
+    uint32_t Type = 0;
+    Float3 Color;
+    float SpotScale = 0.0f;  // Spot falloff: saturate(dot(axis, -L) * SpotScale + SpotOffset)^2
+    float SpotOffset = 1.0f; // Point and directional lights get a falloff of 1
+    float Padding[3] = {};
+};
+
+// One cluster's slice of Indices()
+struct LightCluster {
+    uint32_t Offset = 0;
+    uint32_t Count = 0;
+};
+
+struct LightClusterSettings {
+    uint32_t TilesX = 16;
+    uint32_t TilesY = 9;
+    uint32_t Slices = 24;
+};
+
+// Maps view-space positions to clusters, as the shaders do from clip space: the tile from the
+// NDC position (tile row 0 at the top), the slice as log(depth) * DepthScale + DepthBias
+struct LightClusterGrid {
+    uint32_t TilesX = 0;
+    uint32_t TilesY = 0;
+    uint32_t Slices = 0;
+    float DepthScale = 0.0f;
+    float DepthBias = 0.0f;
+    float ProjX = 0.0f; // Projection scale of view x and y
+    float ProjY = 0.0f;
+
+    uint32_t ClusterCount() const { return TilesX * TilesY * Slices; }
+    uint32_t ClusterIndex(const Float3& viewPosition) const;
+};
+
+struct LightCullingStats {
+    uint32_t Lights = 0;
+    uint32_t Indices = 0;           // Light references over all clusters
+    uint32_t MaxClusterLights = 0;
+    uint32_t OccupiedClusters = 0;
+    double BuildMs = 0.0;
+};
+
+class LightCuller {
+public:
+    explicit LightCuller(JobSystem& jobs, const LightClusterSettings& settings = LightClusterSettings());
+
+    // Culls 'lights' for a camera with 'view' (world to view, row vectors) and a perspective
+    // projection of vertical field of view 'fovY'
+    void Build(const std::vector<SceneLight>& lights, const Float4x4& view, float fovY, float aspect, float nearZ, float farZ);
+
+    // The same lists from every light against every cluster, one at a time, for testing
+    static void BuildReference(const std::vector<SceneLight>& lights, const Float4x4& view, float fovY, float aspect,
+                               float nearZ, float farZ, const LightClusterSettings& settings,
+                               std::vector<LightCluster>& clusters, std::vector<uint32_t>& indices);
+
+    // What shell_ps evaluates: distance falloff of a point or spot light at 'distance' (zero
+    // from Range on), and a spot's cone falloff for the cosine of the angle off its axis
+    static float Attenuation(float distance, float range);
+    static float SpotFalloff(const GpuLight& light, float cosAngle);
+    static GpuLight ToGpu(const SceneLight& light);
+
+    const std::vector<GpuLight>& Lights() const { return m_lights; }        // Directional lights first
+    uint32_t DirectionalCount() const { return m_directionalCount; }
+    const std::vector<LightCluster>& Clusters() const { return m_clusters; } // By (slice, tile row, tile column)
+    const std::vector<uint32_t>& Indices() const { return m_indices; }      // Into Lights(), ascending per cluster
+    const LightClusterGrid& Grid() const { return m_grid; }
+    const LightCullingStats& Stats() const { return m_stats; }
+
+private:
+    // View-space cluster bounds of one slice. A tile column's x extent and a tile row's y extent
+    // are shared by every cluster of the slice; columns are padded to a multiple of 4.
+    struct SliceBounds {
+        float MinZ = 0.0f, MaxZ = 0.0f;
+        std::vector<float> MinX, MaxX;
+        std::vector<float> MinY, MaxY;
+    };
+
+    // A point or spot light in view space, with the sphere that bounds what it reaches
+    struct ViewLight {
+        Float3 Center; // Bounding sphere
+        float Radius = 0.0f;
+        Float3 Position;
+        Float3 Axis;
+        float CosOuter = 0.0f, SinOuter = 0.0f;
+        float Range = 0.0f;
+        bool Spot = false;
+    };
+
+    static void BuildGrid(const LightClusterSettings& settings, float fovY, float aspect, float nearZ, float farZ,
+                          LightClusterGrid& grid, std::vector<SliceBounds>& slices);
+    static void PrepareLights(const std::vector<SceneLight>& lights, const Float4x4& view, std::vector<GpuLight>& gpuLights,
+                              uint32_t& directionalCount, std::vector<ViewLight>& viewLights);
+    static bool SphereOverlaps(const SliceBounds& slice, uint32_t x, uint32_t y, const ViewLight& light);
+    static bool ConeOverlaps(const SliceBounds& slice, uint32_t x, uint32_t y, const ViewLight& light);
+    void CullSlice(uint32_t slice);
+
+    JobSystem& m_jobs;
+    LightClusterSettings m_settings;
+    LightClusterGrid m_grid;
+    float m_fovY = 0.0f, m_aspect = 0.0f, m_nearZ = 0.0f, m_farZ = 0.0f; // Of m_sliceBounds
+    std::vector<SliceBounds> m_sliceBounds;
+
+    std::vector<GpuLight> m_lights;
+    uint32_t m_directionalCount = 0;
+    std::vector<ViewLight> m_viewLights; // Point and spot lights, in Lights() order after the directional ones
+
+    // Per slice: the (cluster, light) pairs found in light order, then their counting sort
+    std::vector<std::vector<uint32_t>> m_slicePairs;
+    std::vector<std::vector<uint32_t>> m_sliceIndices;
+    std::vector<LightCluster> m_clusters;
+    std::vector<uint32_t> m_indices;
+    LightCullingStats m_stats;
+};
@@ -0,0 +1,167 @@
+#include "LodStream.h"
+#include "Timing.h"
+#include <algorithm>
+
+static uint32_t JobThreadsFor(const LodStreamSettings& settings) {
+    if (settings.JobThreads) return settings.JobThreads;
+    // JobSystem counts the calling thread; the render thread keeps the other half
+    return std::max(std::thread::hardware_concurrency() / 2, 2u) - 1;
+}
+
+LodStreamer::LodStreamer(const LodStreamSettings& settings) : m_settings(settings), m_jobs(JobThreadsFor(settings)) {
+    m_settings.FrameBudget = std::max<uint64_t>(m_settings.FrameBudget, 1);
+    m_settings.ChunkSize = std::max<uint64_t>(m_settings.ChunkSize, 1);
+    m_settings.Workers = std::max(m_settings.Workers, 1u);
+}
+
+LodStreamer::~LodStreamer() {
+    m_quit = true;
+    for (std::thread& worker : m_workers) worker.join();
+}
+
+void LodStreamer::Start(uint32_t levelCount, LodBuildFn build) {
+    m_build = std::move(build);
+    m_levels.resize(levelCount);
+    m_stats.Levels.resize(levelCount);
+    m_start = Clock::now();
+    for (uint32_t i = 0; i < std::min(m_settings.Workers, levelCount); i++) m_workers.emplace_back(&LodStreamer::WorkerLoop, this);
+    if (levelCount == 0) m_finished = true;
+}
+
+double LodStreamer::ElapsedMs() const {
+    return MillisecondsSince(m_start);
+}
+
+// Levels are taken in order, so the coarse ones, cheapest to build, are ready first
+void LodStreamer::WorkerLoop() {
+    while (!m_quit) {
+        const uint32_t level = m_nextLevel++;
+        if (level >= m_levels.size()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_levels[level].State = LevelState::Building;
+        }
+        const auto start = Clock::now();
+        std::vector<LodSection> sections;
+        bool built = false;
+        try {
+            built = m_build(level, m_jobs, sections);
+        } catch (...) {
+            built = false; // Nothing to rethrow into from here; the level is skipped like any failed one
+        }
+        const double buildMs = MillisecondsSince(start);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Level& l = m_levels[level];
+        l.Sections = std::move(sections);
+        l.State = built ? LevelState::Ready : LevelState::Failed;
+        l.BuildMs = buildMs;
+        l.ReadyMs = ElapsedMs();
+    }
+}
+
+int32_t LodStreamer::Update(LodUploadQueue& queue) {
+    m_stats.Updates++;
+    if (m_finished) return -1;
+
+    // Copies queued by an earlier Update: swap once they are done
+    int32_t swap = -1;
+    if (m_streaming >= 0 && m_levels[m_streaming].State == LevelState::Queued && queue.CompletedFence() >= m_fence) {
+        swap = m_current = m_streaming;
+        m_streaming = -1;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_levels[swap].State = LevelState::Shown;
+            m_levels[swap].Sections.clear();
+        }
+        LodLevelStats& stats = m_stats.Levels[swap];
+        stats.Shown = true;
+        stats.ShownMs = ElapsedMs();
+        if (m_stats.FirstLevelMs == 0.0) m_stats.FirstLevelMs = stats.ShownMs;
+    }
+
+    uint64_t budget = m_settings.FrameBudget;
+    Stream(queue, budget);
+    const uint64_t queued = m_settings.FrameBudget - budget;
+    m_stats.BytesQueued += queued;
+    m_stats.MaxFrameBytes = std::max(m_stats.MaxFrameBytes, queued);
+    return swap;
+}
+
+void LodStreamer::Stream(LodUploadQueue& queue, uint64_t& budget) {
+    if (m_streaming < 0) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        int32_t next = -1;
+        bool building = false;
+        for (uint32_t i = 0; i < m_levels.size(); i++) {
+            Level& level = m_levels[i];
+            LodLevelStats& stats = m_stats.Levels[i];
+            if (level.State == LevelState::Ready || level.State == LevelState::Failed) {
+                stats.Built = level.State == LevelState::Ready;
+                stats.Failed = !stats.Built;
+                stats.BuildMs = level.BuildMs;
+                stats.ReadyMs = level.ReadyMs;
+            }
+            // Coarser levels still building count too: the streamer is only done once its workers are
+            if (level.State == LevelState::Pending || level.State == LevelState::Building) {
+                building = true;
+            } else if ((int32_t)i <= m_current) {
+                // Finished after a finer level was already on screen
+                if (level.State == LevelState::Ready) {
+                    level.State = LevelState::Skipped;
+                    stats.Skipped = true;
+                }
+            } else if (level.State == LevelState::Ready) {
+                next = (int32_t)i;
+            }
+        }
+        if (next < 0) {
+            if (!building) {
+                m_finished = true;
+                m_stats.FinestMs = m_current >= 0 ? m_stats.Levels[m_current].ShownMs : ElapsedMs();
+            }
+            return;
+        }
+        // Coarser levels ready but not started would only delay this one
+        for (int32_t i = m_current + 1; i < next; i++) {
+            if (m_levels[i].State != LevelState::Ready) continue;
+            m_levels[i].State = LevelState::Skipped;
+            m_stats.Levels[i].Skipped = true;
+        }
+        m_levels[next].State = LevelState::Streaming;
+        lock.unlock();
+
+        m_streaming = next;
+        m_section = 0;
+        m_offset = 0;
+        uint64_t bytes = 0;
+        for (const LodSection& section : m_levels[next].Sections) bytes += section.Size;
+        m_stats.Levels[next].Bytes = bytes;
+        queue.BeginLevel((uint32_t)next, m_levels[next].Sections);
+    }
+
+    // The level's sections are only written before it is Ready, so they are read without the lock
+    Level& level = m_levels[m_streaming];
+    if (level.State != LevelState::Streaming) return;
+    LodLevelStats& stats = m_stats.Levels[m_streaming];
+    if (budget > 0) stats.Frames++;
+    while (budget > 0 && m_section < level.Sections.size()) {
+        const LodSection& section = level.Sections[m_section];
+        const uint64_t size = std::min({ m_settings.ChunkSize, section.Size - m_offset, budget });
+        if (size > 0) {
+            queue.Upload((uint32_t)m_streaming, m_section, m_offset, static_cast<const uint8_t*>(section.Data) + m_offset, size);
+            m_offset += size;
+            budget -= size;
+        }
+        if (m_offset == section.Size) {
+            m_section++;
+            m_offset = 0;
+        }
+    }
+    if (m_section == level.Sections.size()) {
+        m_fence = queue.EndLevel((uint32_t)m_streaming);
+        stats.QueuedMs = ElapsedMs();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        level.State = LevelState::Queued;
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include "JobSystem.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Progressive loading of a mesh's levels of detail. Worker threads build the levels, coarsest
+// first, while the render thread keeps drawing what it has (a placeholder before anything is
+// ready). Once per frame, Update streams the bytes of the finest level built so far to the GPU in
+// chunks, no more than a frame's budget at a time, and swaps to that level once the fence of its
+// last copy has retired. A level that becomes ready while a coarser one is still streaming waits
+// for it; a coarser level that is ready but not started yet when a finer one is ready is skipped.
+//
+// The streamer only sees bytes: a level is a list of sections (vertex buffer, index buffer, ...)
+// that each go to a GPU buffer of their own. LodUploadQueue is the GPU side, so the whole schedule
+// runs headless against a stand-in queue (PelageLodStreamBench).
+
+// One buffer's worth of a level. The bytes must stay put until the level has been swapped in, or
+// until the streamer is destroyed.
+struct LodSection {
+    const void* Data = nullptr;
+    uint64_t Size = 0;
+};
+
+// Builds level 'level' (0 the coarsest) on a worker thread, listing the bytes to stream. The
+// streamer's job pool is the builder's to use. Returns false if the level can't be built; it is
+// skipped.
+using LodBuildFn = std::function<bool(uint32_t level, JobSystem& jobs, std::vector<LodSection>& sections)>;
+
+// The GPU side, called from Update on the render thread only
+class LodUploadQueue {
+public:
+    virtual ~LodUploadQueue() = default;
+    // A level starts streaming: one destination buffer per section
+    virtual void BeginLevel(uint32_t level, const std::vector<LodSection>& sections) = 0;
+    // Queues a copy of bytes [offset, offset + size) of a section; 'data' only lives through the call
+    virtual void Upload(uint32_t level, uint32_t section, uint64_t offset, const void* data, uint64_t size) = 0;
+    // Every copy of the level is queued. Returns the fence value that signals they are done.
+    virtual uint64_t EndLevel(uint32_t level) = 0;
+    virtual uint64_t CompletedFence() = 0;
+};
+
+struct LodStreamSettings {
+    uint64_t FrameBudget = 8ull << 20; // Bytes queued per Update at most
+    uint64_t ChunkSize = 1ull << 20;   // Largest single copy
+    uint32_t Workers = 2;              // Threads building levels, each level on one of them
+    uint32_t JobThreads = 0;           // Of the job pool the builders share; 0 for half the hardware threads
+};
+
+struct LodLevelStats {
+    bool Built = false;
+    bool Failed = false;
+    bool Skipped = false; // Ready, but a finer level was ready before it could start streaming
+    bool Shown = false;
+    uint64_t Bytes = 0;
+    double BuildMs = 0.0;  // On its worker
+    double ReadyMs = 0.0;  // Since Start, like the rest
+    double QueuedMs = 0.0; // Last copy queued
+    double ShownMs = 0.0;  // Swapped in
+    uint32_t Frames = 0;   // Updates that queued some of its bytes
+};
+
+struct LodStreamStats {
+    std::vector<LodLevelStats> Levels;
+    uint64_t Updates = 0;
+    uint64_t BytesQueued = 0;
+    uint64_t MaxFrameBytes = 0; // Most bytes one Update queued
+    double FirstLevelMs = 0.0;  // A level on screen; 0 until then
+    double FinestMs = 0.0;      // The finest level built on screen (or every level failed)
+};
+
+class LodStreamer {
+public:
+    explicit LodStreamer(const LodStreamSettings& settings = LodStreamSettings());
+    // Levels not started are dropped; blocks until the builders running finish
+    ~LodStreamer();
+
+    LodStreamer(const LodStreamer&) = delete;
+    LodStreamer& operator=(const LodStreamer&) = delete;
+
+    // Starts building 'levelCount' levels on the workers. Call once.
+    void Start(uint32_t levelCount, LodBuildFn build);
+
+    // Once per frame on the render thread. Queues at most FrameBudget bytes on 'queue' and
+    // returns the level to draw from now on (its copies have retired), or -1 to keep the current one.
+    int32_t Update(LodUploadQueue& queue);
+
+    int32_t Current() const { return m_current; } // -1 before the first swap
+    // The finest level that could be built is on screen and every builder has returned, so
+    // destroying the streamer doesn't block
+    bool Finished() const { return m_finished; }
+    const LodStreamStats& Stats() const { return m_stats; }
+
+private:
+    enum class LevelState : uint32_t { Pending, Building, Ready, Failed, Streaming, Queued, Shown, Skipped };
+
+    struct Level {
+        LevelState State = LevelState::Pending;
+        std::vector<LodSection> Sections;
+        double BuildMs = 0.0;
+        double ReadyMs = 0.0;
+    };
+
+    void WorkerLoop();
+    double ElapsedMs() const;
+    // Picks the level to stream if none is, then queues its next chunks within 'budget'
+    void Stream(LodUploadQueue& queue, uint64_t& budget);
+
+    LodStreamSettings m_settings;
+    JobSystem m_jobs;
+    LodBuildFn m_build;
+    std::vector<std::thread> m_workers;
+    std::atomic<uint32_t> m_nextLevel{ 0 };
+    std::atomic<bool> m_quit{ false };
+    std::chrono::steady_clock::time_point m_start;
+
+    std::mutex m_mutex; // Level states and sections, written by the workers
+    std::vector<Level> m_levels;
+
+    // Render thread only
+    int32_t m_current = -1;
+    int32_t m_streaming = -1; // Level being streamed or waiting for its fence
+    uint32_t m_section = 0;   // Next bytes of m_streaming to queue
+    uint64_t m_offset = 0;
+    uint64_t m_fence = 0;
+    bool m_finished = false;
+    LodStreamStats m_stats;
+};
@@ -0,0 +1,338 @@
+// Headless LOD streaming benchmark, against a stand-in for the GPU copy queue that copies into
+// CPU buffers and retires each frame's copies after a modelled bandwidth and latency. First checks
+// LodStreamer on builders with known timings:
+//   coarse first        levels built in order are streamed and shown coarsest to finest
+//   frame budget        no frame queues more than the budget, no copy is larger than a chunk
+//   bytes intact        every shown level's buffers hold exactly the bytes its builder listed
+//   waits for fence     a level is swapped in on the first frame after its copies retire, not before
+//   skips coarser       a coarse level still building when a finer one is ready is never streamed
+//   failed levels       a level whose builder fails or throws is passed over
+//   early destroy       destroying the streamer mid-build waits for the running builders only
+// Then streams three LODs of a generated scene (vertex clustering at two grid sizes, then the
+// full mesh) at 60 frames per second, and compares time to first frame and to full quality
+// against loading and uploading the full mesh before the first frame.
+// Usage: PelageLodStreamBench [triangles] [frame budget MB]
+#include "BenchReport.h"
+#include "LodStream.h"
+#include "MeshAdjacency.h"
+#include "MeshStream.h"
+#include "SceneGen.h"
+#include "Timing.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+
+// A copy queue: one submission per frame, done 'LatencyFrames' frames later, or when the bytes
+// submitted so far have gone through at 'BytesPerMs' (0 for no limit), whichever is later
+class StandInQueue : public LodUploadQueue {
+public:
+    StandInQueue(double bytesPerMs, uint32_t latencyFrames) : m_bytesPerMs(bytesPerMs), m_latencyFrames(latencyFrames) {}
+
+    struct LevelCopy {
+        std::vector<std::vector<uint8_t>> Buffers;
+        uint64_t Fence = 0;
+        uint64_t EndFrame = 0;
+    };
+
+    void BeginLevel(uint32_t level, const std::vector<LodSection>& sections) override {
+        if (m_levels.size() <= level) m_levels.resize(level + 1);
+        m_levels[level].Buffers.resize(sections.size());
+        for (size_t s = 0; s < sections.size(); s++) m_levels[level].Buffers[s].assign(sections[s].Size, 0);
+        m_begun.push_back(level);
+    }
+    void Upload(uint32_t level, uint32_t section, uint64_t offset, const void* data, uint64_t size) override {
+        memcpy(m_levels[level].Buffers[section].data() + offset, data, size);
+        m_pending += size;
+        m_largestCopy = std::max(m_largestCopy, size);
+    }
+    uint64_t EndLevel(uint32_t level) override {
+        m_levels[level].Fence = m_submitted + 1; // Signalled by this frame's Submit
+        m_levels[level].EndFrame = m_submitted;
+        return m_levels[level].Fence;
+    }
+    uint64_t CompletedFence() override {
+        const Clock::time_point now = Clock::now();
+        while (!m_inFlight.empty() && m_inFlight.front().Frame < m_submitted && m_inFlight.front().Done <= now) {
+            m_completed = m_inFlight.front().Fence;
+            m_inFlight.pop_front();
+        }
+        return m_completed;
+    }
+
+    // End of a frame: what was queued during it goes to the GPU
+    void Submit() {
+        const Clock::time_point now = Clock::now();
+        m_busyUntil = std::max(m_busyUntil, now);
+        if (m_bytesPerMs > 0.0) {
+            m_busyUntil += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(m_pending / m_bytesPerMs));
+        }
+        m_inFlight.push_back({ ++m_submitted, m_submitted - 1 + m_latencyFrames, m_busyUntil });
+        m_pending = 0;
+    }
+
+    uint64_t Frame() const { return m_submitted; }
+    uint64_t LargestCopy() const { return m_largestCopy; }
+    const std::vector<uint32_t>& Begun() const { return m_begun; }
+    const LevelCopy& Level(uint32_t level) const { return m_levels[level]; }
+
+private:
+    struct Submission {
+        uint64_t Fence;
+        uint64_t Frame; // Done from the Update after this frame on
+        Clock::time_point Done;
+    };
+
+    double m_bytesPerMs;
+    uint32_t m_latencyFrames;
+    std::vector<LevelCopy> m_levels;
+    std::vector<uint32_t> m_begun;
+    std::deque<Submission> m_inFlight;
+    Clock::time_point m_busyUntil;
+    uint64_t m_pending = 0, m_submitted = 0, m_completed = 0, m_largestCopy = 0;
+};
+
+struct Swap {
+    int32_t Level;
+    uint64_t Frame;
+};
+
+// The render loop: one Update per frame, at most 'frameMs' apart (0 to run flat out)
+static std::vector<Swap> RunFrames(LodStreamer& streamer, StandInQueue& queue, double frameMs, uint32_t maxFrames = 100000) {
+    std::vector<Swap> swaps;
+    for (uint32_t frame = 0; frame < maxFrames && !streamer.Finished(); frame++) {
+        const Clock::time_point start = Clock::now();
+        const int32_t level = streamer.Update(queue);
+        if (level >= 0) swaps.push_back({ level, queue.Frame() });
+        queue.Submit();
+        if (frameMs > 0.0) {
+            while (MillisecondsSince(start) < frameMs) std::this_thread::sleep_for(std::chrono::microseconds(200));
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    return swaps;
+}
+
+// Levels of 'bytes[level]' patterned bytes, ready after 'delayMs[level]'; a negative delay fails
+struct TestLevels {
+    std::vector<std::vector<uint8_t>> Data;
+    std::vector<int> DelayMs;
+    std::atomic<uint32_t> Built{ 0 };
+
+    TestLevels(std::vector<uint64_t> bytes, std::vector<int> delayMs) : DelayMs(std::move(delayMs)) {
+        for (size_t l = 0; l < bytes.size(); l++) {
+            Data.emplace_back(bytes[l]);
+            for (uint64_t i = 0; i < bytes[l]; i++) Data[l][i] = (uint8_t)(i * 131 + l * 17 + (i >> 8));
+        }
+    }
+    LodBuildFn Builder() {
+        return [this](uint32_t level, JobSystem&, std::vector<LodSection>& sections) {
+            Built++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::abs(DelayMs[level])));
+            if (DelayMs[level] < 0) return false;
+            // Two sections of uneven size, plus an empty one
+            const uint64_t split = Data[level].size() / 3;
+            sections.push_back({ Data[level].data(), split });
+            sections.push_back({ nullptr, 0 });
+            sections.push_back({ Data[level].data() + split, Data[level].size() - split });
+            return true;
+        };
+    }
+    bool Intact(const StandInQueue& queue, uint32_t level) const {
+        const StandInQueue::LevelCopy& copy = queue.Level(level);
+        if (copy.Buffers.size() != 3) return false;
+        std::vector<uint8_t> joined;
+        for (const std::vector<uint8_t>& buffer : copy.Buffers) joined.insert(joined.end(), buffer.begin(), buffer.end());
+        return joined == Data[level];
+    }
+};
+
+static bool Check() {
+    bool ok = true;
+
+    {
+        TestLevels levels({ 100000, 400000, 1600000 }, { 0, 30, 60 });
+        LodStreamSettings settings;
+        settings.FrameBudget = 256 << 10;
+        settings.ChunkSize = 48 << 10;
+        settings.Workers = 1;
+        StandInQueue queue(0.0, 0);
+        LodStreamer streamer(settings);
+        streamer.Start(3, levels.Builder());
+        const std::vector<Swap> swaps = RunFrames(streamer, queue, 2.0);
+        ok &= Report("coarse first", swaps.size() == 3 && swaps[0].Level == 0 && swaps[1].Level == 1 && swaps[2].Level == 2 &&
+                                     streamer.Current() == 2 && streamer.Finished());
+        ok &= Report("frame budget", streamer.Stats().MaxFrameBytes <= settings.FrameBudget && queue.LargestCopy() <= settings.ChunkSize &&
+                                     streamer.Stats().BytesQueued == 2100000 && streamer.Stats().Levels[2].Frames >= 1600000 / settings.FrameBudget);
+        ok &= Report("bytes intact", levels.Intact(queue, 0) && levels.Intact(queue, 1) && levels.Intact(queue, 2));
+    }
+
+    {
+        TestLevels levels({ 70000, 90000 }, { 0, 20 });
+        LodStreamSettings settings;
+        settings.FrameBudget = 32 << 10;
+        const uint32_t latency = 3;
+        StandInQueue queue(0.0, latency);
+        LodStreamer streamer(settings);
+        streamer.Start(2, levels.Builder());
+        const std::vector<Swap> swaps = RunFrames(streamer, queue, 1.0);
+        bool waited = swaps.size() == 2;
+        for (const Swap& swap : swaps) waited &= swap.Frame == queue.Level(swap.Level).EndFrame + 1 + latency;
+        ok &= Report("waits for fence", waited);
+    }
+
+    {
+        // Level 1 is ready long before level 0, and level 2 after both
+        TestLevels levels({ 50000, 60000, 70000 }, { 200, 0, 300 });
+        LodStreamSettings settings;
+        settings.Workers = 2;
+        StandInQueue queue(0.0, 1);
+        LodStreamer streamer(settings);
+        streamer.Start(3, levels.Builder());
+        const std::vector<Swap> swaps = RunFrames(streamer, queue, 1.0);
+        const std::vector<uint32_t>& begun = queue.Begun();
+        ok &= Report("skips coarser", swaps.size() == 2 && swaps[0].Level == 1 && swaps[1].Level == 2 && begun.size() == 2 &&
+                                      std::find(begun.begin(), begun.end(), 0u) == begun.end() && streamer.Stats().Levels[0].Skipped);
+    }
+
+    {
+        // The middle level fails, then the finest throws
+        TestLevels levels({ 20000, 30000, 40000 }, { 0, -10, 20 });
+        LodBuildFn build = levels.Builder();
+        LodStreamer streamer;
+        streamer.Start(3, [&](uint32_t level, JobSystem& jobs, std::vector<LodSection>& sections) -> bool {
+            if (level == 2) throw std::runtime_error("unreadable");
+            return build(level, jobs, sections);
+        });
+        StandInQueue queue(0.0, 0);
+        const std::vector<Swap> swaps = RunFrames(streamer, queue, 1.0);
+        const LodStreamStats& stats = streamer.Stats();
+        ok &= Report("failed levels", swaps.size() == 1 && streamer.Current() == 0 && streamer.Finished() && stats.Levels[1].Failed &&
+                                      stats.Levels[2].Failed && !stats.Levels[1].Shown);
+    }
+
+    {
+        TestLevels levels({ 1000, 1000, 1000, 1000, 1000, 1000 }, { 100, 100, 100, 100, 100, 100 });
+        const Clock::time_point start = Clock::now();
+        {
+            LodStreamSettings settings;
+            settings.Workers = 2;
+            LodStreamer streamer(settings);
+            streamer.Start(6, levels.Builder());
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        const double ms = MillisecondsSince(start);
+        ok &= Report("early destroy", levels.Built == 2 && ms >= 100.0 && ms < 180.0);
+    }
+    return ok;
+}
+
+struct SceneLevels {
+    JobSystem& Jobs;
+    uint64_t Triangles;
+    std::once_flag SourceLoaded;
+    MeshArrays Source;
+    MeshArrays Levels[3];
+    static constexpr uint32_t Grids[2] = { 32, 128 };
+
+    SceneLevels(JobSystem& jobs, uint64_t triangles) : Jobs(jobs), Triangles(triangles) {}
+
+    // What a loader would read: the scene as generated, without adjacency
+    void LoadSource(JobSystem& jobs) {
+        SynthScatterSettings scatter;
+        scatter.Triangles = Triangles;
+        scatter.ObjectCount = 32;
+        SceneGen(jobs).Generate(SceneGen::Scatter(scatter), Source);
+        Source.IndicesAdj.clear();
+    }
+
+    void BuildFull(MeshArrays& mesh) {
+        mesh.Vertices = Source.Vertices;
+        mesh.Indices = Source.Indices;
+        mesh.IndicesAdj.resize(mesh.Indices.size() * 2);
+        MeshAdjacency::Build(mesh.Indices.data(), mesh.TriangleCount(), mesh.IndicesAdj.data());
+    }
+
+    bool Build(uint32_t level, JobSystem& jobs, std::vector<LodSection>& sections) {
+        std::call_once(SourceLoaded, [&] { LoadSource(jobs); });
+        MeshArrays& mesh = Levels[level];
+        if (level < 2) {
+            MeshStreamSettings settings;
+            settings.GridResolution = Grids[level];
+            MeshStreamer::ProcessInCore(Source, settings, mesh);
+        } else {
+            BuildFull(mesh);
+        }
+        if (mesh.Indices.empty()) return false;
+        sections = { { mesh.Vertices.data(), mesh.Vertices.size() * sizeof(float) },
+                     { mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t) },
+                     { mesh.IndicesAdj.data(), mesh.IndicesAdj.size() * sizeof(uint32_t) } };
+        return true;
+    }
+};
+
+static void Benchmark(uint64_t triangles, uint64_t budget) {
+    const double frameMs = 1000.0 / 60.0;
+    const double bytesPerMs = 8e6; // 8 GB/s of copy bandwidth
+    JobSystem jobs;
+
+    // Before: the full mesh is loaded, built and uploaded in one go before the first frame
+    double blockingMs = 0.0;
+    {
+        SceneLevels scene(jobs, triangles);
+        const Clock::time_point start = Clock::now();
+        scene.LoadSource(jobs);
+        scene.BuildFull(scene.Levels[2]);
+        const MeshArrays& full = scene.Levels[2];
+        const uint64_t bytes = (full.Vertices.size() + full.Indices.size() + full.IndicesAdj.size()) * 4;
+        std::vector<uint8_t> gpu(bytes);
+        memcpy(gpu.data(), full.Vertices.data(), full.Vertices.size() * 4);
+        memcpy(gpu.data() + full.Vertices.size() * 4, full.Indices.data(), full.Indices.size() * 4);
+        memcpy(gpu.data() + (full.Vertices.size() + full.Indices.size()) * 4, full.IndicesAdj.data(), full.IndicesAdj.size() * 4);
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(bytes / bytesPerMs));
+        blockingMs = MillisecondsSince(start);
+    }
+
+    SceneLevels scene(jobs, triangles);
+    LodStreamSettings settings;
+    settings.FrameBudget = budget;
+    StandInQueue queue(bytesPerMs, 1);
+    const Clock::time_point start = Clock::now();
+    LodStreamer streamer(settings);
+    streamer.Start(3, [&](uint32_t level, JobSystem& levelJobs, std::vector<LodSection>& sections) {
+        return scene.Build(level, levelJobs, sections);
+    });
+    // The first frame draws the placeholder
+    streamer.Update(queue);
+    queue.Submit();
+    const double firstFrameMs = MillisecondsSince(start);
+    RunFrames(streamer, queue, frameMs);
+
+    const LodStreamStats& stats = streamer.Stats();
+    printf("\n%llu triangles, %.0f MB per frame at 60 fps, copies at %.0f GB/s, %u frames\n", (unsigned long long)triangles,
+           budget / 1048576.0, bytesPerMs / 1e6, (unsigned)stats.Updates);
+    printf("%-8s %10s %10s %10s %10s %10s %10s %8s\n", "level", "triangles", "MB", "build ms", "ready ms", "shown ms", "frames", "");
+    for (uint32_t l = 0; l < 3; l++) {
+        const LodLevelStats& level = stats.Levels[l];
+        printf("%-8s %10zu %10.1f %10.1f %10.1f %10.1f %10u %8s\n", l < 2 ? (l == 0 ? "grid 32" : "grid 128") : "full",
+               scene.Levels[l].TriangleCount(), level.Bytes / 1048576.0, level.BuildMs, level.ReadyMs, level.ShownMs, level.Frames,
+               level.Skipped ? "skipped" : level.Failed ? "failed" : "");
+    }
+    printf("first frame: %.2f ms streamed, %.1f ms blocking; first LOD %.1f ms; full quality %.1f ms streamed, %.1f ms blocking\n",
+           firstFrameMs, blockingMs, stats.FirstLevelMs, stats.FinestMs, blockingMs);
+    printf("most bytes queued in a frame: %.1f MB\n", stats.MaxFrameBytes / 1048576.0);
+}
+
+int main(int argc, char** argv) {
+    const uint64_t triangles = argc > 1 ? (uint64_t)std::max(atoll(argv[1]), 1000ll) : 2000000;
+    const uint64_t budget = (argc > 2 ? (uint64_t)std::max(atoi(argv[2]), 1) : 8) << 20;
+    bool ok = Check();
+    Benchmark(triangles, budget);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+// Headless benchmark of material batching. First checks how glTF materials reach the fur draws,
+// on a glTF of four primitives (two sharing a material, one without any) and four materials:
+//   fur mapping        defaults, the sheen colour, extras and coat layers give the expected
+//                      FurMaterial values; fields of the wrong type keep the defaults
+//   texture indices    the sheen colour texture wins over the base colour texture, and both go
+//                      through "textures" to image indices
+//   material ranges    the import keeps every primitive's triangles under its own material
+//   clusters           SortTriangles makes each material one contiguous run of clusters, and no
+//                      cluster straddles two materials
+//   draw batching      with every cluster visible, and with a random half, the draw ranges are
+//                      grouped by material: one material switch per material drawn
+// Then sorts, clusters and batches a generated scene of four materials and reports the time and
+// the draws against one per visible cluster.
+// Usage: PelageMaterialBench [triangles]
+#include "BenchReport.h"
+#include "FurMaterial.h"
+#include "MeshClusters.h"
+#include "MeshStream.h"
+#include "SceneGen.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static uint64_t g_random = 1;
+
+static uint32_t RandomBits() {
+    g_random = g_random * 6364136223846793005ull + 1442695040888963407ull;
+    return (uint32_t)(g_random >> 33);
+}
+
+// Primitive p is a grid of Quads[p]^2 quads in x in [2p, 2p + 1], so its triangles can be told
+// apart by position after the import
+static constexpr uint32_t PrimitiveCount = 4;
+static constexpr uint32_t Quads[PrimitiveCount] = { 8, 12, 16, 6 };
+static constexpr int PrimitiveMaterial[PrimitiveCount] = { 2, 0, 2, -1 };
+
+static const char* MaterialsJson = R"("materials":[
+    {"name":"plain","pbrMetallicRoughness":{"baseColorTexture":{"index":0}}},
+    {"name":"sheen","pbrMetallicRoughness":{"baseColorTexture":{"index":0}},
+     "extensions":{"KHR_materials_sheen":{"sheenColorFactor":[0.2,0.3,0.4],"sheenColorTexture":{"index":1}}},
+     "extras":{"furLength":0.06,"furDensity":90,"furThickness":"thick","furColor":[1,"x",0]}},
+    {"name":"coat","extras":{"furLength":0.05,"furColor":[0.5,0.4,0.3],"furLayers":[
+        {"length":0.02,"shells":24,"density":240,"thickness":0.9,"color":[0.1,0.1,0.1],"noise":0},
+        {"density":60,"noise":7},
+        "layer"]}},
+    5],
+    "textures":[{"source":1},{"source":0}],"images":[{"uri":"a.png"},{"uri":"b.png"}])";
+
+// Writes the primitives and MaterialsJson as 'directory'/materials.gltf
+static bool WriteMesh(const std::string& directory) {
+    std::ofstream bin(directory + "/materials.bin", std::ios::binary | std::ios::trunc);
+    std::string views, accessors, primitives;
+    uint64_t offset = 0;
+    for (uint32_t p = 0; p < PrimitiveCount; p++) {
+        const uint32_t n = Quads[p];
+        std::vector<float> positions, normals;
+        std::vector<uint32_t> indices;
+        for (uint32_t z = 0; z <= n; z++) {
+            for (uint32_t x = 0; x <= n; x++) {
+                positions.insert(positions.end(), { 2.0f * p + (float)x / n, 0.0f, (float)z / n });
+                normals.insert(normals.end(), { 0.0f, 1.0f, 0.0f });
+            }
+        }
+        for (uint32_t z = 0; z < n; z++) {
+            for (uint32_t x = 0; x < n; x++) {
+                uint32_t i0 = z * (n + 1) + x, i1 = i0 + 1, i2 = i0 + n + 1, i3 = i2 + 1;
+                indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+            }
+        }
+        const uint64_t sizes[3] = { positions.size() * 4, normals.size() * 4, indices.size() * 4 };
+        const size_t counts[3] = { positions.size() / 3, normals.size() / 3, indices.size() };
+        const char* types[3] = { "VEC3", "VEC3", "SCALAR" };
+        const int componentTypes[3] = { 5126, 5126, 5125 };
+        bin.write(reinterpret_cast<const char*>(positions.data()), (std::streamsize)sizes[0]);
+        bin.write(reinterpret_cast<const char*>(normals.data()), (std::streamsize)sizes[1]);
+        bin.write(reinterpret_cast<const char*>(indices.data()), (std::streamsize)sizes[2]);
+        for (int s = 0; s < 3; s++) {
+            const uint32_t view = p * 3 + s;
+            views += std::string(view ? "," : "") + "{\"buffer\":0,\"byteOffset\":" + std::to_string(offset) + ",\"byteLength\":" +
+                     std::to_string(sizes[s]) + "}";
+            accessors += std::string(view ? "," : "") + "{\"bufferView\":" + std::to_string(view) + ",\"componentType\":" +
+                         std::to_string(componentTypes[s]) + ",\"count\":" + std::to_string(counts[s]) + ",\"type\":\"" + types[s] + "\"}";
+            offset += sizes[s];
+        }
+        primitives += std::string(p ? "," : "") + "{\"attributes\":{\"POSITION\":" + std::to_string(p * 3) + ",\"NORMAL\":" +
+                      std::to_string(p * 3 + 1) + "},\"indices\":" + std::to_string(p * 3 + 2);
+        if (PrimitiveMaterial[p] >= 0) primitives += ",\"material\":" + std::to_string(PrimitiveMaterial[p]);
+        primitives += "}";
+    }
+    if (!bin) return false;
+
+    std::ofstream gltf(directory + "/materials.gltf", std::ios::trunc);
+    gltf << "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"uri\":\"materials.bin\",\"byteLength\":" << offset << "}],";
+    gltf << "\"bufferViews\":[" << views << "],\"accessors\":[" << accessors << "],";
+    gltf << "\"meshes\":[{\"primitives\":[" << primitives << "]}],\"nodes\":[{\"mesh\":0}],\"scenes\":[{\"nodes\":[0]}],\"scene\":0,";
+    gltf << MaterialsJson << "}";
+    return (bool)gltf;
+}
+
+static bool Near(float a, float b) {
+    return std::fabs(a - b) < 1e-6f;
+}
+
+static bool Near(const Float3& a, const Float3& b) {
+    return Near(a.x, b.x) && Near(a.y, b.y) && Near(a.z, b.z);
+}
+
+static bool Same(const FurMaterial& a, float length, float density, float thickness, const Float3& color) {
+    return Near(a.FurLength, length) && Near(a.Density, density) && Near(a.Thickness, thickness) && Near(a.FurColor, color);
+}
+
+// Every triangle of a cluster has its material, and each material is one contiguous run
+static bool Grouped(const std::vector<MeshCluster>& clusters, const std::vector<uint32_t>& triangleMaterials) {
+    bool grouped = true;
+    uint32_t next = 0;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        const MeshCluster& cluster = clusters[c];
+        grouped &= cluster.FirstTriangle == next && cluster.TriangleCount > 0;
+        for (uint32_t t = cluster.FirstTriangle; t < cluster.FirstTriangle + cluster.TriangleCount; t++) {
+            grouped &= triangleMaterials[t] == cluster.Material;
+        }
+        grouped &= c == 0 || clusters[c - 1].Material <= cluster.Material;
+        next = cluster.FirstTriangle + cluster.TriangleCount;
+    }
+    return grouped && next == triangleMaterials.size();
+}
+
+// Material switches between consecutive draw ranges; 'drawn' gets the distinct materials drawn
+static uint32_t MaterialSwitches(const std::vector<DrawRange>& ranges, uint32_t& drawn) {
+    uint32_t switches = 0;
+    for (size_t r = 1; r < ranges.size(); r++) {
+        if (ranges[r].Material != ranges[r - 1].Material) switches++;
+    }
+    std::vector<uint32_t> materials;
+    for (const DrawRange& range : ranges) materials.push_back(range.Material);
+    std::sort(materials.begin(), materials.end());
+    drawn = (uint32_t)(std::unique(materials.begin(), materials.end()) - materials.begin());
+    return switches;
+}
+
+// The ranges cover exactly the visible clusters, in order, each under its clusters' material
+static bool CoversVisible(const std::vector<MeshCluster>& clusters, const std::vector<uint8_t>& visible, const std::vector<DrawRange>& ranges) {
+    std::vector<uint32_t> triangles;
+    for (const DrawRange& range : ranges) {
+        for (uint32_t t = range.FirstTriangle; t < range.FirstTriangle + range.TriangleCount; t++) triangles.push_back(t);
+    }
+    size_t next = 0;
+    bool covered = true;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        if (!visible[c]) continue;
+        for (uint32_t t = clusters[c].FirstTriangle; t < clusters[c].FirstTriangle + clusters[c].TriangleCount; t++) {
+            covered &= next < triangles.size() && triangles[next++] == t;
+        }
+    }
+    for (const DrawRange& range : ranges) {
+        for (const MeshCluster& cluster : clusters) {
+            const bool inside = cluster.FirstTriangle >= range.FirstTriangle &&
+                                cluster.FirstTriangle < range.FirstTriangle + range.TriangleCount;
+            covered &= !inside || cluster.Material == range.Material;
+        }
+    }
+    return covered && next == triangles.size();
+}
+
+static bool Check() {
+    bool ok = true;
+    std::string gltfText = std::string("{") + MaterialsJson + "}";
+    std::vector<FurMaterial> materials;
+    const FurMaterial defaults;
+    bool mapping = FurMaterials::ReadGltf(gltfText, materials) && materials.size() == 4;
+    if (mapping) {
+        mapping &= materials[0].Name == "plain" && Same(materials[0], defaults.FurLength, defaults.Density, defaults.Thickness, defaults.FurColor);
+        // Thickness and furColor are of the wrong type: the default and the sheen colour stay
+        mapping &= Same(materials[1], 0.06f, 90.0f, defaults.Thickness, Float3(0.2f, 0.3f, 0.4f)) && materials[1].Layers.empty();
+        // Layer 1 takes the material's length, thickness and colour and the default shells; its
+        // noise channel is clamped, and the layer that is not an object is all defaults. The
+        // material is the coat's longest length and its outermost layer.
+        const std::vector<CoatLayer>& layers = materials[2].Layers;
+        mapping &= layers.size() == 3;
+        if (layers.size() == 3) {
+            mapping &= Near(layers[0].Length, 0.02f) && layers[0].Shells == 24 && Near(layers[0].Density, 240.0f) &&
+                       Near(layers[0].Thickness, 0.9f) && Near(layers[0].Color, Float3(0.1f, 0.1f, 0.1f)) && layers[0].NoiseChannel == 0;
+            mapping &= Near(layers[1].Length, 0.05f) && layers[1].Shells == CoatLayer().Shells && Near(layers[1].Density, 60.0f) &&
+                       Near(layers[1].Thickness, defaults.Thickness) && Near(layers[1].Color, Float3(0.5f, 0.4f, 0.3f)) &&
+                       layers[1].NoiseChannel == FurCoat::NoiseChannels - 1;
+            mapping &= Near(layers[2].Length, 0.05f) && Near(layers[2].Density, defaults.Density) && layers[2].NoiseChannel == 0;
+            const CoatPlan plan = FurCoat::Plan(layers.data(), (uint32_t)layers.size(), FurCoat::ShellCount);
+            const CoatPlanLayer& outer = plan.Layers[plan.LayerCount - 1];
+            mapping &= Near(materials[2].FurLength, 0.05f) && Near(materials[2].Density, outer.Density) &&
+                       Near(materials[2].Thickness, outer.Thickness) && Near(materials[2].FurColor, outer.Color);
+        }
+        mapping &= materials[3].Name.empty() && Same(materials[3], defaults.FurLength, defaults.Density, defaults.Thickness, defaults.FurColor);
+    }
+    mapping &= !FurMaterials::ReadGltf("[1]", materials) && !FurMaterials::ReadGltf("{\"materials\":", materials);
+    mapping &= FurMaterials::ReadGltf("{\"materials\":{}}", materials) && materials.empty();
+    ok &= Report("fur mapping", mapping);
+
+    bool textures = FurMaterials::ReadGltf(gltfText, materials) && materials.size() == 4;
+    textures &= materials[0].ColorTexture == 1 && materials[1].ColorTexture == 0 && materials[2].ColorTexture == -1;
+    textures &= FurMaterials::ReadGltf(R"({"materials":[{"pbrMetallicRoughness":{"baseColorTexture":{"index":2}}},
+                                                       {"pbrMetallicRoughness":{"baseColorTexture":{"index":0}}}],
+                                        "textures":[{"source":3}],"images":[{}]})", materials);
+    textures &= materials.size() == 2 && materials[0].ColorTexture == -1 && materials[1].ColorTexture == -1;
+    ok &= Report("texture indices", textures);
+
+    // The import: one triangle per half quad, each under its primitive's material
+    const std::string directory = (std::filesystem::temp_directory_path() / "pelage_material_bench").string();
+    std::filesystem::create_directories(directory);
+    MeshArrays mesh;
+    bool ranges = WriteMesh(directory);
+    if (ranges) MeshStreamer::LoadInCore(directory + "/materials.gltf", MeshStreamSettings(), mesh);
+    std::filesystem::remove_all(directory);
+    size_t expectedTriangles = 0;
+    for (uint32_t p = 0; p < PrimitiveCount; p++) expectedTriangles += 2 * Quads[p] * Quads[p];
+    ranges &= mesh.TriangleCount() == expectedTriangles && mesh.TriangleMaterials.size() == expectedTriangles;
+    std::vector<uint32_t> perPrimitive(PrimitiveCount, 0);
+    for (size_t t = 0; ranges && t < mesh.TriangleCount(); t++) {
+        float x = 0.0f;
+        for (int k = 0; k < 3; k++) x += mesh.Vertices[mesh.Indices[t * 3 + k] * MeshArrays::VertexStride] / 3.0f;
+        const uint32_t p = std::min((uint32_t)(x / 2.0f), PrimitiveCount - 1);
+        const uint32_t material = PrimitiveMaterial[p] >= 0 ? (uint32_t)PrimitiveMaterial[p] : UINT32_MAX;
+        ranges &= mesh.TriangleMaterials[t] == material;
+        perPrimitive[p]++;
+    }
+    for (uint32_t p = 0; p < PrimitiveCount; p++) ranges &= perPrimitive[p] == 2 * Quads[p] * Quads[p];
+    ok &= Report("material ranges", ranges);
+
+    // Small clusters, so every material spans several
+    const std::vector<uint32_t> imported = mesh.TriangleMaterials;
+    MeshClusters::SortTriangles(mesh.Vertices.data(), MeshArrays::VertexStride, mesh.Indices, mesh.TriangleMaterials);
+    const std::vector<MeshCluster> clusters = MeshClusters::Build(mesh.Vertices.data(), MeshArrays::VertexStride, mesh.Indices, 16,
+                                                                  &mesh.TriangleMaterials);
+    std::vector<uint32_t> sorted = mesh.TriangleMaterials, original = imported;
+    std::sort(original.begin(), original.end());
+    bool grouped = !clusters.empty() && sorted == original && Grouped(clusters, mesh.TriangleMaterials);
+    grouped &= clusters.size() > 12;
+    ok &= Report("clusters", grouped);
+
+    bool batching = true;
+    std::vector<DrawRange> draws;
+    uint32_t drawn = 0;
+    std::vector<uint8_t> visible(clusters.size(), 1);
+    MeshClusters::BuildDrawRanges(clusters, visible, draws);
+    batching &= CoversVisible(clusters, visible, draws) && draws.size() == 3 && MaterialSwitches(draws, drawn) == 2 && drawn == 3;
+    for (int trial = 0; trial < 20; trial++) {
+        for (uint8_t& v : visible) v = RandomBits() % 2;
+        MeshClusters::BuildDrawRanges(clusters, visible, draws);
+        const uint32_t switches = MaterialSwitches(draws, drawn);
+        batching &= CoversVisible(clusters, visible, draws) && switches + 1 == std::max(drawn, 1u);
+    }
+    ok &= Report("draw batching", batching);
+    return ok;
+}
+
+static void Benchmark(uint64_t triangles) {
+    JobSystem jobs;
+    SynthScatterSettings scatter;
+    scatter.Triangles = triangles;
+    MeshArrays mesh;
+    SceneGen(jobs).Generate(SceneGen::Scatter(scatter), mesh);
+    printf("\nScene of %zu triangles, %u materials, %u per cluster\n", mesh.TriangleCount(), scatter.MaterialCount,
+           MeshClusters::DefaultTrianglesPerCluster);
+
+    Clock::time_point start = Clock::now();
+    MeshClusters::SortTriangles(mesh.Vertices.data(), MeshArrays::VertexStride, mesh.Indices, mesh.TriangleMaterials);
+    const double sortMs = MillisecondsSince(start);
+    start = Clock::now();
+    const std::vector<MeshCluster> clusters = MeshClusters::Build(mesh.Vertices.data(), MeshArrays::VertexStride, mesh.Indices,
+                                                                  MeshClusters::DefaultTrianglesPerCluster, &mesh.TriangleMaterials);
+    const double buildMs = MillisecondsSince(start);
+    printf("  sort %8.2f ms, cluster %8.2f ms, %zu clusters\n", sortMs, buildMs, clusters.size());
+
+    printf("  visible   clusters    draws  switches   ranges ms\n");
+    std::vector<uint8_t> visible(clusters.size());
+    std::vector<DrawRange> draws;
+    for (uint32_t percent : { 100u, 50u, 10u }) {
+        size_t visibleCount = 0;
+        for (uint8_t& v : visible) visibleCount += v = RandomBits() % 100 < percent;
+        const int repeats = 20;
+        start = Clock::now();
+        for (int r = 0; r < repeats; r++) MeshClusters::BuildDrawRanges(clusters, visible, draws);
+        const double rangesMs = MillisecondsSince(start) / repeats;
+        uint32_t drawn = 0;
+        const uint32_t switches = MaterialSwitches(draws, drawn);
+        printf("  %6u%% %10zu %8zu %9u %11.3f\n", percent, visibleCount, draws.size(), switches, rangesMs);
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint64_t triangles = argc > 1 ? (uint64_t)std::max(atoll(argv[1]), 1000ll) : 1000000;
+    bool ok = Check();
+    Benchmark(triangles);
+    return ok ? 0 : 1;
+}
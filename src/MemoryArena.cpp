@@ -0,0 +1,140 @@
+#include "MemoryArena.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+void MemoryCounter::Allocated(size_t bytes) {
+    uint64_t current = m_current.fetch_add(bytes) + bytes;
+    m_allocations.fetch_add(1);
+    uint64_t peak = m_peak.load();
+    while (current > peak && !m_peak.compare_exchange_weak(peak, current)) {}
+}
+
+void MemoryCounter::Freed(size_t bytes) {
+    m_current.fetch_sub(bytes);
+}
+
+MemoryCounterStats MemoryCounter::Stats() const {
+    MemoryCounterStats stats;
+    stats.Name = m_name;
+    stats.CurrentBytes = m_current.load();
+    stats.PeakBytes = m_peak.load();
+    stats.Allocations = m_allocations.load();
+    return stats;
+}
+
+static std::mutex& RegistryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::vector<std::unique_ptr<MemoryCounter>>& Registry() {
+    static std::vector<std::unique_ptr<MemoryCounter>> counters;
+    return counters;
+}
+
+MemoryCounter& MemoryTracker::Counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    for (const auto& counter : Registry()) {
+        if (counter->Name() == name) return *counter;
+    }
+    Registry().push_back(std::make_unique<MemoryCounter>(name));
+    return *Registry().back();
+}
+
+std::vector<MemoryCounterStats> MemoryTracker::Snapshot() {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    std::vector<MemoryCounterStats> stats;
+    for (const auto& counter : Registry()) stats.push_back(counter->Stats());
+    return stats;
+}
+
+std::string MemoryTracker::Report() {
+    std::string report;
+    for (const MemoryCounterStats& stats : Snapshot()) {
+        char line[160];
+        snprintf(line, sizeof(line), "Memory %-12s current %8.2f MB, peak %8.2f MB, %llu allocations\n", stats.Name.c_str(),
+                 stats.CurrentBytes / (1024.0 * 1024.0), stats.PeakBytes / (1024.0 * 1024.0), (unsigned long long)stats.Allocations);
+        report += line;
+    }
+    return report;
+}
+
+void* CountingResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = m_upstream->allocate(bytes, alignment);
+    m_counter.Allocated(bytes);
+    return p;
+}
+
+void CountingResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    m_upstream->deallocate(p, bytes, alignment);
+    m_counter.Freed(bytes);
+}
+
+LinearArena::LinearArena(MemoryCounter& counter, size_t blockSize)
+    : m_upstream(counter), m_blockSize(blockSize) {}
+
+LinearArena::~LinearArena() {
+    for (const Block& block : m_blocks) m_upstream.deallocate(block.Data, block.Size, alignof(std::max_align_t));
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment) {
+    auto fit = [&](const Block& block, size_t offset) -> size_t {
+        uintptr_t start = reinterpret_cast<uintptr_t>(block.Data) + offset;
+        uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        size_t end = offset + (size_t)(aligned - start) + bytes;
+        return end <= block.Size ? end - bytes : SIZE_MAX;
+    };
+
+    size_t offset = m_blocks.empty() ? SIZE_MAX : fit(m_blocks[m_block], m_offset);
+    if (offset == SIZE_MAX) {
+        // The next kept block if it is big enough, otherwise a new one in its place
+        size_t next = m_blocks.empty() ? 0 : m_block + 1;
+        if (next < m_blocks.size() && fit(m_blocks[next], 0) == SIZE_MAX) {
+            for (size_t b = next; b < m_blocks.size(); b++) {
+                m_upstream.deallocate(m_blocks[b].Data, m_blocks[b].Size, alignof(std::max_align_t));
+            }
+            m_blocks.resize(next);
+        }
+        if (next == m_blocks.size()) {
+            Block block;
+            block.Size = std::max(m_blockSize, bytes + alignment);
+            block.Data = static_cast<std::byte*>(m_upstream.allocate(block.Size, alignof(std::max_align_t)));
+            m_blocks.push_back(block);
+        }
+        m_blocks[next].UsedBefore = m_used;
+        m_block = next;
+        m_offset = 0;
+        offset = fit(m_blocks[m_block], 0);
+    }
+
+    m_lastOffset = m_offset;
+    m_offset = offset + bytes;
+    m_used = m_blocks[m_block].UsedBefore + m_offset;
+    m_peakUsed = std::max(m_peakUsed, m_used);
+    m_last = m_blocks[m_block].Data + offset;
+    return m_last;
+}
+
+void LinearArena::do_deallocate(void* p, size_t, size_t) {
+    if (p != m_last) return;
+    m_offset = m_lastOffset;
+    m_used = m_blocks[m_block].UsedBefore + m_offset;
+    m_last = nullptr;
+}
+
+void LinearArena::Rewind(const Marker& marker) {
+    m_block = marker.Block;
+    m_offset = marker.Offset;
+    m_used = m_blocks.empty() ? 0 : m_blocks[m_block].UsedBefore + m_offset;
+    m_last = nullptr;
+}
+
+void LinearArena::Reset() {
+    for (size_t b = 1; b < m_blocks.size(); b++) {
+        m_upstream.deallocate(m_blocks[b].Data, m_blocks[b].Size, alignof(std::max_align_t));
+    }
+    if (m_blocks.size() > 1) m_blocks.resize(1);
+    Rewind(Marker());
+}
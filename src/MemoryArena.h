@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Memory accounting and arenas for load-time work. Each subsystem gets a named counter of the
+// bytes it holds, with the peak and the number of allocations; CountingResource feeds one from
+// any std::pmr container, and LinearArena hands out scratch memory for a whole stage from a
+// few large blocks, so the containers of a stage cost one counted allocation per block instead
+// of one per element.
+
+struct MemoryCounterStats {
+    std::string Name;
+    uint64_t CurrentBytes = 0;
+    uint64_t PeakBytes = 0;
+    uint64_t Allocations = 0;
+};
+
+class MemoryCounter {
+public:
+    explicit MemoryCounter(std::string name) : m_name(std::move(name)) {}
+
+    void Allocated(size_t bytes);
+    void Freed(size_t bytes);
+    // Lets the next stage report its own peak
+    void ResetPeak() { m_peak.store(m_current.load()); }
+
+    const std::string& Name() const { return m_name; }
+    MemoryCounterStats Stats() const;
+
+private:
+    std::string m_name;
+    std::atomic<uint64_t> m_current{ 0 };
+    std::atomic<uint64_t> m_peak{ 0 };
+    std::atomic<uint64_t> m_allocations{ 0 };
+};
+
+// Process-wide registry of counters. Counters live until exit, so references stay valid.
+class MemoryTracker {
+public:
+    static MemoryCounter& Counter(const std::string& name);
+    // Every counter in creation order
+    static std::vector<MemoryCounterStats> Snapshot();
+    // One line per counter: name, current, peak and allocations
+    static std::string Report();
+};
+
+// Forwards to 'upstream' and counts every byte in flight
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(MemoryCounter& counter, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : m_counter(counter), m_upstream(upstream) {}
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    MemoryCounter& m_counter;
+    std::pmr::memory_resource* m_upstream;
+};
+
+// Bump allocator over blocks of at least BlockSize bytes from a counted upstream. Freeing the
+// most recent allocation gives its space back; anything else is reclaimed by Rewind, Reset or
+// the destructor. Not thread-safe: one arena per thread or per stage.
+class LinearArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t DefaultBlockSize = 1 << 20;
+
+    struct Marker {
+        size_t Block = 0;
+        size_t Offset = 0;
+    };
+
+    explicit LinearArena(MemoryCounter& counter, size_t blockSize = DefaultBlockSize);
+    ~LinearArena() override;
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    Marker Mark() const { return { m_block, m_offset }; }
+    // Frees everything allocated since 'marker'; blocks are kept for reuse
+    void Rewind(const Marker& marker);
+    // Rewinds to the start and returns every block but the first to the upstream
+    void Reset();
+
+    size_t BytesUsed() const { return m_used; }
+    size_t PeakBytesUsed() const { return m_peakUsed; }
+
+private:
+    struct Block {
+        std::byte* Data = nullptr;
+        size_t Size = 0;
+        size_t UsedBefore = 0; // Bytes in use in earlier blocks when this one was started
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    CountingResource m_upstream;
+    size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    size_t m_block = 0;  // Current block
+    size_t m_offset = 0; // Into the current block
+    size_t m_used = 0;
+    size_t m_peakUsed = 0;
+    void* m_last = nullptr;  // Most recent allocation, which can be given back
+    size_t m_lastOffset = 0; // Current block offset before it
+};
+
+// Rewinds an arena when it goes out of scope. Containers allocated from the arena inside the
+// scope must not outlive it.
+class ArenaScope {
+public:
+    explicit ArenaScope(LinearArena& arena) : m_arena(arena), m_marker(arena.Mark()) {}
+    ~ArenaScope() { m_arena.Rewind(m_marker); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    LinearArena& m_arena;
+    LinearArena::Marker m_marker;
+};
@@ -0,0 +1,51 @@
+#include "MeshAdjacency.h"
+#include <algorithm>
+#include <vector>
+
+void MeshAdjacency::Build(const uint32_t* indices, size_t triangleCount, uint32_t* adjacency, std::pmr::memory_resource* scratch) {
+    uint32_t vertexCount = 0;
+    for (size_t i = 0; i < triangleCount * 3; i++) vertexCount = std::max(vertexCount, indices[i] + 1);
+
+    // Edge uses grouped by lower vertex. The counting sort is stable, so within a group the
+    // uses stay in triangle order and the first other triangle found is the first one added.
+    struct EdgeUse {
+        uint32_t Upper;
+        uint32_t Triangle;
+    };
+    std::pmr::vector<uint32_t> groupStart(vertexCount + 1, 0, scratch);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        size_t t = i / 3;
+        uint32_t a = indices[i], b = indices[t * 3 + (i + 1) % 3];
+        groupStart[std::min(a, b) + 1]++;
+    }
+    for (uint32_t v = 0; v < vertexCount; v++) groupStart[v + 1] += groupStart[v];
+
+    std::pmr::vector<EdgeUse> uses(triangleCount * 3, scratch);
+    {
+        std::pmr::vector<uint32_t> cursor(groupStart.begin(), groupStart.end() - 1, scratch);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            size_t t = i / 3;
+            uint32_t a = indices[i], b = indices[t * 3 + (i + 1) % 3];
+            uses[cursor[std::min(a, b)]++] = { std::max(a, b), (uint32_t)t };
+        }
+    }
+
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t* tri = indices + t * 3;
+        for (int e = 0; e < 3; e++) {
+            uint32_t lo = std::min(tri[e], tri[(e + 1) % 3]), hi = std::max(tri[e], tri[(e + 1) % 3]);
+            uint32_t opposite = tri[e]; // Border: no neighbour
+            for (uint32_t u = groupStart[lo]; u < groupStart[lo + 1]; u++) {
+                if (uses[u].Upper != hi || uses[u].Triangle == t) continue;
+                // Only one neighbour is expected on a manifold; a degenerate one leaves the border default
+                const uint32_t* neighbour = indices + (size_t)uses[u].Triangle * 3;
+                for (int c = 0; c < 3; c++) {
+                    if (neighbour[c] != lo && neighbour[c] != hi) opposite = neighbour[c];
+                }
+                break;
+            }
+            adjacency[t * 6 + e * 2] = tri[e];
+            adjacency[t * 6 + e * 2 + 1] = opposite;
+        }
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+// Triangle adjacency for the fin geometry shader: 6 indices per triangle, v0 adj0 v1 adj1 v2
+// adj2, where adjN is the vertex opposite edge (vN, vN+1) in the first other triangle sharing
+// that edge (in triangle order), or vN itself on a border.
+class MeshAdjacency {
+public:
+    // Edges are bucketed by their lower vertex with a counting sort, so the working set is two
+    // flat arrays taken from 'scratch' instead of a node and a vector per edge
+    static void Build(const uint32_t* indices, size_t triangleCount, uint32_t* adjacency,
+                      std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+};
@@ -0,0 +1,155 @@
+#include "MeshClusters.h"
+#include "RadixSort.h"
+#include <algorithm>
+
+// Spreads the low 10 bits of v so there are two zero bits between each
+static uint32_t SpreadBits10(uint32_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+std::vector<uint32_t> MeshClusters::SpatialTriangleOrder(const float* positions, size_t stride, const std::vector<uint32_t>& indices) {
+    uint32_t numTris = (uint32_t)indices.size() / 3;
+
+    std::vector<Float3> centroids(numTris);
+    Aabb bounds;
+    for (uint32_t i = 0; i < numTris; i++) {
+        const float* p0 = positions + indices[i * 3 + 0] * stride;
+        const float* p1 = positions + indices[i * 3 + 1] * stride;
+        const float* p2 = positions + indices[i * 3 + 2] * stride;
+        centroids[i] = Float3(p0[0] + p1[0] + p2[0], p0[1] + p1[1] + p2[1], p0[2] + p1[2] + p2[2]) * (1.0f / 3.0f);
+        bounds.Expand(centroids[i]);
+    }
+
+    Float3 size = bounds.Max - bounds.Min;
+    Float3 scale(size.x > 0.0f ? 1023.0f / size.x : 0.0f,
+                 size.y > 0.0f ? 1023.0f / size.y : 0.0f,
+                 size.z > 0.0f ? 1023.0f / size.z : 0.0f);
+
+    std::vector<uint64_t> keys(numTris);
+    for (uint32_t i = 0; i < numTris; i++) {
+        Float3 q = centroids[i] - bounds.Min;
+        uint32_t morton = SpreadBits10((uint32_t)(q.x * scale.x))
+                        | (SpreadBits10((uint32_t)(q.y * scale.y)) << 1)
+                        | (SpreadBits10((uint32_t)(q.z * scale.z)) << 2);
+        keys[i] = ((uint64_t)morton << 32) | i; // Triangle index breaks ties, keeping the sort stable
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<uint32_t> order(numTris);
+    for (uint32_t i = 0; i < numTris; i++) {
+        order[i] = (uint32_t)(keys[i] & 0xffffffffu);
+    }
+    return order;
+}
+
+void MeshClusters::ApplyTriangleOrder(std::vector<uint32_t>& indices, const std::vector<uint32_t>& order, uint32_t indicesPerTriangle) {
+    std::vector<uint32_t> reordered(indices.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        std::copy_n(indices.begin() + (size_t)order[i] * indicesPerTriangle, indicesPerTriangle,
+                    reordered.begin() + i * indicesPerTriangle);
+    }
+    indices.swap(reordered);
+}
+
+std::vector<uint32_t> MeshClusters::SortTriangles(const float* positions, size_t stride, std::vector<uint32_t>& indices,
+                                                  std::vector<uint32_t>& triangleMaterials) {
+    std::vector<uint32_t> order = SpatialTriangleOrder(positions, stride, indices);
+    if (triangleMaterials.size() == indices.size() / 3) {
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return triangleMaterials[a] < triangleMaterials[b]; });
+        ApplyTriangleOrder(triangleMaterials, order, 1);
+    }
+    ApplyTriangleOrder(indices, order, 3);
+    return order;
+}
+
+std::vector<MeshCluster> MeshClusters::Build(const float* positions, size_t stride, const std::vector<uint32_t>& indices,
+                                             uint32_t trianglesPerCluster, const std::vector<uint32_t>* triangleMaterials) {
+    std::vector<MeshCluster> clusters;
+    uint32_t numTris = (uint32_t)indices.size() / 3;
+    trianglesPerCluster = std::max(trianglesPerCluster, 1u);
+    clusters.reserve((numTris + trianglesPerCluster - 1) / trianglesPerCluster);
+    if (triangleMaterials && triangleMaterials->size() != numTris) triangleMaterials = nullptr;
+
+    for (uint32_t first = 0; first < numTris; first += clusters.back().TriangleCount) {
+        MeshCluster cluster;
+        cluster.FirstTriangle = first;
+        cluster.TriangleCount = std::min(trianglesPerCluster, numTris - first);
+        if (triangleMaterials) {
+            cluster.Material = (*triangleMaterials)[first];
+            for (uint32_t i = 1; i < cluster.TriangleCount; i++) {
+                if ((*triangleMaterials)[first + i] != cluster.Material) {
+                    cluster.TriangleCount = i;
+                    break;
+                }
+            }
+        }
+        cluster.Bounds = ClusterBounds(cluster, positions, stride, indices);
+        clusters.push_back(cluster);
+    }
+    return clusters;
+}
+
+Aabb MeshClusters::ClusterBounds(const MeshCluster& cluster, const float* positions, size_t stride, const std::vector<uint32_t>& indices) {
+    Aabb bounds;
+    for (uint32_t i = cluster.FirstTriangle * 3; i < (cluster.FirstTriangle + cluster.TriangleCount) * 3; i++) {
+        const float* p = positions + indices[i] * stride;
+        bounds.Expand(Float3(p[0], p[1], p[2]));
+    }
+    return bounds;
+}
+
+void MeshClusters::BuildDrawRanges(const std::vector<MeshCluster>& clusters, const std::vector<uint8_t>& visible, std::vector<DrawRange>& ranges) {
+    ranges.clear();
+    for (size_t i = 0; i < clusters.size(); i++) {
+        if (!visible[i]) continue;
+
+        const MeshCluster& cluster = clusters[i];
+        if (!ranges.empty() && ranges.back().Material == cluster.Material &&
+            ranges.back().FirstTriangle + ranges.back().TriangleCount == cluster.FirstTriangle) {
+            ranges.back().TriangleCount += cluster.TriangleCount;
+        } else {
+            ranges.push_back({ cluster.FirstTriangle, cluster.TriangleCount, cluster.Material });
+        }
+    }
+}
+
+void MeshClusters::SortByViewDepth(const std::vector<MeshCluster>& clusters, const std::vector<uint8_t>& visible,
+                                   const Float4x4& worldView, std::vector<uint32_t>& order) {
+    std::vector<uint32_t> keys;
+    keys.reserve(clusters.size());
+    order.clear();
+    for (uint32_t i = 0; i < (uint32_t)clusters.size(); i++) {
+        if (!visible[i]) continue;
+        float depth = TransformPoint(worldView, clusters[i].Bounds.Center()).z;
+        keys.push_back(RadixSort::FloatKey(depth));
+        order.push_back(i);
+    }
+
+    std::vector<uint32_t> scratchKeys, scratchValues;
+    RadixSort::SortPairs(keys, order, scratchKeys, scratchValues);
+}
+
+void MeshClusters::BuildDrawRanges(const std::vector<MeshCluster>& clusters, const std::vector<uint32_t>& order, std::vector<DrawRange>& ranges) {
+    ranges.clear();
+    for (uint32_t index : order) {
+        const MeshCluster& cluster = clusters[index];
+        if (!ranges.empty() && ranges.back().Material == cluster.Material) {
+            DrawRange& last = ranges.back();
+            if (last.FirstTriangle + last.TriangleCount == cluster.FirstTriangle) {
+                last.TriangleCount += cluster.TriangleCount;
+                continue;
+            }
+            if (cluster.FirstTriangle + cluster.TriangleCount == last.FirstTriangle) {
+                last.FirstTriangle = cluster.FirstTriangle;
+                last.TriangleCount += cluster.TriangleCount;
+                continue;
+            }
+        }
+        ranges.push_back({ cluster.FirstTriangle, cluster.TriangleCount, cluster.Material });
+    }
+}
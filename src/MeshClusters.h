@@ -0,0 +1,59 @@
+#pragma once
+#include "CoreMath.h"
+#include <vector>
+
+// Fixed-size groups of spatially coherent triangles. Clusters are contiguous ranges of the
+// index buffer, so whatever survives culling can be drawn with a handful of index ranges.
+
+struct MeshCluster {
+    uint32_t FirstTriangle = 0;
+    uint32_t TriangleCount = 0;
+    uint32_t Material = 0; // Clusters never straddle a material change
+    Aabb Bounds; // Object space, undisplaced base mesh
+};
+
+struct DrawRange {
+    uint32_t FirstTriangle = 0;
+    uint32_t TriangleCount = 0;
+    uint32_t Material = 0;
+};
+
+class MeshClusters {
+public:
+    static constexpr uint32_t DefaultTrianglesPerCluster = 128;
+
+    // Triangle order along a Morton curve of the triangle centroids. 'stride' is in floats.
+    static std::vector<uint32_t> SpatialTriangleOrder(const float* positions, size_t stride, const std::vector<uint32_t>& indices);
+
+    // Rewrites an index list (3 per triangle, or 6 for adjacency) into 'order'
+    static void ApplyTriangleOrder(std::vector<uint32_t>& indices, const std::vector<uint32_t>& order, uint32_t indicesPerTriangle);
+
+    // SpatialTriangleOrder with the material as the major key, so each material is one contiguous
+    // run of clusters and draws never switch parameters inside a cluster. Applied to 'indices',
+    // and to 'triangleMaterials' if it has one entry per triangle; returned for any other
+    // per-triangle data.
+    static std::vector<uint32_t> SortTriangles(const float* positions, size_t stride, std::vector<uint32_t>& indices,
+                                               std::vector<uint32_t>& triangleMaterials);
+
+    // Splits the current triangle order into clusters of up to 'trianglesPerCluster'. With
+    // per-triangle materials (already grouped, see SortTriangles) a cluster also ends wherever
+    // the material changes.
+    static std::vector<MeshCluster> Build(const float* positions, size_t stride, const std::vector<uint32_t>& indices,
+                                          uint32_t trianglesPerCluster = DefaultTrianglesPerCluster,
+                                          const std::vector<uint32_t>* triangleMaterials = nullptr);
+
+    // Bounds of a cluster's vertices, e.g. to refit after skinning moved them
+    static Aabb ClusterBounds(const MeshCluster& cluster, const float* positions, size_t stride, const std::vector<uint32_t>& indices);
+
+    // Merges runs of visible clusters of the same material into as few draw ranges as possible
+    static void BuildDrawRanges(const std::vector<MeshCluster>& clusters, const std::vector<uint8_t>& visible, std::vector<DrawRange>& ranges);
+
+    // Visible clusters sorted nearest first by the view depth of their bounds center.
+    // 'worldView' takes object space to view space (row vectors, +z forward).
+    static void SortByViewDepth(const std::vector<MeshCluster>& clusters, const std::vector<uint8_t>& visible,
+                                const Float4x4& worldView, std::vector<uint32_t>& order);
+
+    // Draw ranges that follow 'order', merging neighbours that are adjacent in the index buffer
+    // and share a material
+    static void BuildDrawRanges(const std::vector<MeshCluster>& clusters, const std::vector<uint32_t>& order, std::vector<DrawRange>& ranges);
+};
@@ -0,0 +1,604 @@
+#include "MeshCodec.h"
+#include "Simd.h"
+#include "Timing.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+// In front of every chunk's payload
+struct ChunkRecord {
+    uint32_t Size = 0;
+    uint32_t Count = 0;
+    uint32_t Base = 0;
+};
+
+static constexpr uint32_t BlockElements = 256; // Bytes: elements delta coded and transposed together
+static constexpr uint32_t IndexPadding = 16;   // Zeros after an index chunk, more than one triangle can read
+
+// Edge and vertex FIFOs of the index codec, newest first: slot i is the i-th most recent entry
+struct IndexFifos {
+    uint32_t EdgeFrom[16];
+    uint32_t EdgeTo[16];
+    uint32_t Vertices[16];
+    uint32_t EdgeHead = 0;
+    uint32_t VertexHead = 0;
+
+    IndexFifos() {
+        std::fill(std::begin(EdgeFrom), std::end(EdgeFrom), UINT32_MAX);
+        std::fill(std::begin(EdgeTo), std::end(EdgeTo), UINT32_MAX);
+        std::fill(std::begin(Vertices), std::end(Vertices), UINT32_MAX);
+    }
+    void PushEdge(uint32_t from, uint32_t to) {
+        EdgeFrom[EdgeHead & 15] = from;
+        EdgeTo[EdgeHead & 15] = to;
+        EdgeHead++;
+    }
+    void PushVertex(uint32_t v) { Vertices[VertexHead++ & 15] = v; }
+    uint32_t Edge(uint32_t slot) const { return (EdgeHead - 1 - slot) & 15; }
+    uint32_t Vertex(uint32_t slot) const { return Vertices[(VertexHead - 1 - slot) & 15]; }
+};
+
+// Vertex modes of the index codec
+enum : uint32_t { NextVertex = 0, RecentVertex = 1, ExplicitVertex = 2 };
+
+static void PutVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 128) {
+        out.push_back((uint8_t)(value | 128));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+// At most 5 bytes, whatever the input
+static inline uint32_t GetVarint(const uint8_t*& p) {
+    uint32_t value = 0;
+    for (uint32_t shift = 0; shift < 35; shift += 7) {
+        uint8_t b = *p++;
+        value |= (uint32_t)(b & 127) << shift;
+        if (b < 128) break;
+    }
+    return value;
+}
+
+static inline uint32_t ZigZag(uint32_t delta) {
+    return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+static inline uint32_t UnZigZag(uint32_t value) {
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+static uint32_t EncodeVertex(uint32_t v, IndexFifos& fifos, uint32_t& next, uint32_t& last, std::vector<uint8_t>& data) {
+    if (v == next) {
+        next++;
+        fifos.PushVertex(v);
+        return NextVertex;
+    }
+    for (uint32_t slot = 0; slot < 16; slot++) {
+        if (fifos.Vertex(slot) != v) continue;
+        data.push_back((uint8_t)slot);
+        return RecentVertex;
+    }
+    PutVarint(data, ZigZag(v - last));
+    last = v;
+    fifos.PushVertex(v);
+    return ExplicitVertex;
+}
+
+static inline uint32_t DecodeVertex(uint32_t mode, IndexFifos& fifos, uint32_t& next, uint32_t& last, const uint8_t*& data,
+                                    bool& valid) {
+    uint32_t v;
+    if (mode == NextVertex) {
+        v = next++;
+    } else if (mode == RecentVertex) {
+        return fifos.Vertex(*data++ & 15);
+    } else {
+        valid &= mode == ExplicitVertex;
+        v = last += UnZigZag(GetVarint(data));
+    }
+    fifos.PushVertex(v);
+    return v;
+}
+
+static void BeginChunk(std::vector<uint8_t>& stream, uint32_t count, uint32_t base) {
+    ChunkRecord record;
+    record.Count = count;
+    record.Base = base;
+    size_t offset = stream.size();
+    stream.resize(offset + sizeof(ChunkRecord));
+    memcpy(&stream[offset], &record, sizeof(record));
+}
+
+// Fills in the record of the chunk that starts at 'recordOffset' and adds it to the header
+static void EndChunk(std::vector<uint8_t>& stream, size_t recordOffset) {
+    ChunkRecord record;
+    memcpy(&record, &stream[recordOffset], sizeof(record));
+    record.Size = (uint32_t)(stream.size() - recordOffset - sizeof(ChunkRecord));
+    memcpy(&stream[recordOffset], &record, sizeof(record));
+
+    MeshCodecHeader header;
+    memcpy(&header, stream.data(), sizeof(header));
+    header.ChunkCount++;
+    header.Count += record.Count;
+    memcpy(stream.data(), &header, sizeof(header));
+}
+
+void MeshCodec::BeginStream(MeshCodecFormat format, uint32_t stride, std::vector<uint8_t>& stream) {
+    MeshCodecHeader header;
+    header.Format = format;
+    header.Stride = stride;
+    stream.resize(sizeof(header));
+    memcpy(stream.data(), &header, sizeof(header));
+}
+
+void MeshCodec::AppendIndexChunk(const uint32_t* indices, size_t triangleCount, uint32_t& next, std::vector<uint8_t>& stream) {
+    for (size_t first = 0; first < triangleCount; first += ChunkElements) {
+        const uint32_t count = (uint32_t)std::min<size_t>(ChunkElements, triangleCount - first);
+        const size_t recordOffset = stream.size();
+        BeginChunk(stream, count, next);
+        const size_t codesOffset = stream.size();
+        stream.resize(codesOffset + count);
+
+        IndexFifos fifos;
+        uint32_t last = next;
+        std::vector<uint8_t> data;
+        data.reserve(count * 2);
+        for (uint32_t t = 0; t < count; t++) {
+            const uint32_t* tri = indices + (first + t) * 3;
+            const uint32_t a = tri[0], b = tri[1], c = tri[2];
+            uint32_t code = 0;
+            bool shared = false;
+            // An earlier triangle's edge (p, q) matches ours running the other way
+            for (uint32_t slot = 0; slot < 16 && !shared; slot++) {
+                const uint32_t e = fifos.Edge(slot);
+                const uint32_t p = fifos.EdgeFrom[e], q = fifos.EdgeTo[e];
+                uint32_t rotation;
+                if (a == q && b == p) rotation = 0;
+                else if (b == q && c == p) rotation = 1;
+                else if (c == q && a == p) rotation = 2;
+                else continue;
+                const uint32_t x = q, y = p, z = rotation == 0 ? c : rotation == 1 ? a : b;
+                code = slot << 4 | rotation << 2 | EncodeVertex(z, fifos, next, last, data);
+                fifos.PushEdge(y, z);
+                fifos.PushEdge(z, x);
+                shared = true;
+            }
+            if (!shared) {
+                code = EncodeVertex(a, fifos, next, last, data) << 6;
+                code |= EncodeVertex(b, fifos, next, last, data) << 4;
+                code |= 3 << 2 | EncodeVertex(c, fifos, next, last, data);
+                fifos.PushEdge(a, b);
+                fifos.PushEdge(b, c);
+                fifos.PushEdge(c, a);
+            }
+            stream[codesOffset + t] = (uint8_t)code;
+        }
+        stream.insert(stream.end(), data.begin(), data.end());
+        stream.resize(stream.size() + IndexPadding, 0);
+        EndChunk(stream, recordOffset);
+    }
+}
+
+static bool DecodeIndexChunk(const uint8_t* payload, const MeshCodecChunk& chunk, uint32_t* out) {
+    if (chunk.Size < chunk.Count + IndexPadding) return false;
+    const uint8_t* codes = payload;
+    const uint8_t* data = payload + chunk.Count;
+    const uint8_t* dataEnd = payload + chunk.Size - IndexPadding;
+    IndexFifos fifos;
+    uint32_t next = chunk.Base, last = chunk.Base;
+    bool valid = true;
+    for (uint32_t t = 0; t < chunk.Count; t++) {
+        // A triangle reads at most 15 data bytes, which the padding covers
+        if (data > dataEnd) return false;
+        const uint32_t code = codes[t];
+        const uint32_t rotation = (code >> 2) & 3;
+        uint32_t a, b, c;
+        if (rotation != 3) {
+            const uint32_t e = fifos.Edge(code >> 4);
+            const uint32_t x = fifos.EdgeTo[e], y = fifos.EdgeFrom[e];
+            const uint32_t z = DecodeVertex(code & 3, fifos, next, last, data, valid);
+            fifos.PushEdge(y, z);
+            fifos.PushEdge(z, x);
+            if (rotation == 0) a = x, b = y, c = z;
+            else if (rotation == 1) b = x, c = y, a = z;
+            else c = x, a = y, b = z;
+        } else {
+            a = DecodeVertex(code >> 6, fifos, next, last, data, valid);
+            b = DecodeVertex((code >> 4) & 3, fifos, next, last, data, valid);
+            c = DecodeVertex(code & 3, fifos, next, last, data, valid);
+            fifos.PushEdge(a, b);
+            fifos.PushEdge(b, c);
+            fifos.PushEdge(c, a);
+        }
+        out[t * 3 + 0] = a;
+        out[t * 3 + 1] = b;
+        out[t * 3 + 2] = c;
+    }
+    return valid && data <= dataEnd;
+}
+
+// Bytes: per block, per lane, a 2-bit width per group of 16 (4 to a header byte) and the groups
+static const uint32_t GroupBits[4] = { 0, 2, 4, 8 };
+
+static void EncodeBytesBlock(const uint8_t* elements, uint32_t count, uint32_t stride, uint8_t* previous,
+                             std::vector<uint8_t>& out) {
+    const uint32_t groups = (count + 15) / 16;
+    uint8_t zigzag[BlockElements];
+    for (uint32_t lane = 0; lane < stride; lane++) {
+        memset(zigzag, 0, sizeof(zigzag));
+        for (uint32_t i = 0; i < count; i++) {
+            uint8_t value = elements[i * stride + lane];
+            uint8_t delta = (uint8_t)(value - previous[lane]);
+            previous[lane] = value;
+            zigzag[i] = (uint8_t)((delta << 1) ^ (uint8_t)((int8_t)delta >> 7));
+        }
+        const size_t headerOffset = out.size();
+        out.resize(headerOffset + (groups + 3) / 4, 0);
+        for (uint32_t g = 0; g < groups; g++) {
+            const uint8_t* z = zigzag + g * 16;
+            uint8_t largest = *std::max_element(z, z + 16);
+            uint32_t width = largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+            out[headerOffset + g / 4] |= (uint8_t)(width << (g % 4 * 2));
+            if (width == 1) {
+                for (int j = 0; j < 4; j++) out.push_back((uint8_t)(z[j * 4] | z[j * 4 + 1] << 2 | z[j * 4 + 2] << 4 | z[j * 4 + 3] << 6));
+            } else if (width == 2) {
+                for (int j = 0; j < 8; j++) out.push_back((uint8_t)(z[j * 2] | z[j * 2 + 1] << 4));
+            } else if (width == 3) {
+                out.insert(out.end(), z, z + 16);
+            }
+        }
+    }
+}
+
+#if PELAGE_SSE2
+// Rows become columns: r[i] byte j <- r[j] byte i. Four rounds of pairwise interleaving, which
+// leave column i in the register whose index is i with its 4 bits reversed.
+static inline void Transpose16x16(__m128i r[16]) {
+    static const int reversed[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+    __m128i t[16];
+    for (int i = 0; i < 8; i++) {
+        t[i] = _mm_unpacklo_epi8(r[2 * i], r[2 * i + 1]);
+        t[i + 8] = _mm_unpackhi_epi8(r[2 * i], r[2 * i + 1]);
+    }
+    for (int i = 0; i < 8; i++) {
+        r[i] = _mm_unpacklo_epi16(t[2 * i], t[2 * i + 1]);
+        r[i + 8] = _mm_unpackhi_epi16(t[2 * i], t[2 * i + 1]);
+    }
+    for (int i = 0; i < 8; i++) {
+        t[i] = _mm_unpacklo_epi32(r[2 * i], r[2 * i + 1]);
+        t[i + 8] = _mm_unpackhi_epi32(r[2 * i], r[2 * i + 1]);
+    }
+    for (int i = 0; i < 8; i++) {
+        r[reversed[i]] = _mm_unpacklo_epi64(t[2 * i], t[2 * i + 1]);
+        r[reversed[i + 8]] = _mm_unpackhi_epi64(t[2 * i], t[2 * i + 1]);
+    }
+}
+#endif
+
+// One block back into 'out' (stride bytes per element); 'lanes' is scratch of 64 rows of
+// BlockElements whose rows from 'stride' to the next multiple of 16 are zero
+static bool DecodeBytesBlock(const uint8_t*& p, const uint8_t* end, uint32_t count, uint32_t stride, uint8_t* previous,
+                             uint8_t* lanes, uint8_t* out) {
+    const uint32_t groups = (count + 15) / 16;
+    const uint32_t headerBytes = (groups + 3) / 4;
+    for (uint32_t lane = 0; lane < stride; lane++) {
+        if ((size_t)(end - p) < headerBytes) return false;
+        const uint8_t* header = p;
+        size_t bytes = headerBytes;
+        for (uint32_t g = 0; g < groups; g++) bytes += GroupBits[(header[g / 4] >> (g % 4 * 2)) & 3] * 2;
+        if ((size_t)(end - p) < bytes) return false;
+        p += headerBytes;
+
+        uint8_t* row = lanes + lane * BlockElements;
+        for (uint32_t g = 0; g < groups; g++) {
+            const uint32_t width = (header[g / 4] >> (g % 4 * 2)) & 3;
+#if PELAGE_SSE2
+            const __m128i low2 = _mm_set1_epi8(3), low4 = _mm_set1_epi8(15), one = _mm_set1_epi8(1), low7 = _mm_set1_epi8(127);
+            __m128i z;
+            if (width == 0) {
+                z = _mm_setzero_si128();
+            } else if (width == 1) {
+                int32_t packed;
+                memcpy(&packed, p, 4);
+                __m128i b = _mm_cvtsi32_si128(packed);
+                __m128i c0 = _mm_and_si128(b, low2);
+                __m128i c1 = _mm_and_si128(_mm_srli_epi16(b, 2), low2);
+                __m128i c2 = _mm_and_si128(_mm_srli_epi16(b, 4), low2);
+                __m128i c3 = _mm_and_si128(_mm_srli_epi16(b, 6), low2);
+                z = _mm_unpacklo_epi16(_mm_unpacklo_epi8(c0, c1), _mm_unpacklo_epi8(c2, c3));
+            } else if (width == 2) {
+                __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+                z = _mm_unpacklo_epi8(_mm_and_si128(b, low4), _mm_and_si128(_mm_srli_epi16(b, 4), low4));
+            } else {
+                z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            }
+            // (z >> 1) ^ -(z & 1)
+            __m128i delta = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(z, 1), low7),
+                                          _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(z, one)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + g * 16), delta);
+#else
+            uint8_t* z = row + g * 16;
+            for (int i = 0; i < 16; i++) {
+                uint32_t bits = GroupBits[width];
+                z[i] = bits == 0 ? 0 : (uint8_t)((p[i * bits / 8] >> (i * bits % 8)) & ((1u << bits) - 1));
+                z[i] = (uint8_t)((z[i] >> 1) ^ (0u - (z[i] & 1)));
+            }
+#endif
+            p += GroupBits[width] * 2;
+        }
+    }
+
+#if PELAGE_SSE2
+    // 16 lanes at a time: transpose 16 elements to rows and add each to the one before
+    for (uint32_t first = 0; first < stride; first += 16) {
+        const uint32_t width = std::min(stride - first, 16u);
+        __m128i sum = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + first));
+        for (uint32_t base = 0; base < count; base += 16) {
+            __m128i r[16];
+            for (int j = 0; j < 16; j++) r[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes + (first + j) * BlockElements + base));
+            Transpose16x16(r);
+            const uint32_t n = std::min(count - base, 16u);
+            uint8_t* dst = out + (size_t)base * stride + first;
+            for (uint32_t i = 0; i < n; i++, dst += stride) {
+                sum = _mm_add_epi8(sum, r[i]);
+                if (width == 16) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), sum);
+                } else {
+                    alignas(16) uint8_t partial[16];
+                    _mm_store_si128(reinterpret_cast<__m128i*>(partial), sum);
+                    memcpy(dst, partial, width);
+                }
+            }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(previous + first), sum);
+    }
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t lane = 0; lane < stride; lane++) {
+            previous[lane] = (uint8_t)(previous[lane] + lanes[lane * BlockElements + i]);
+            out[(size_t)i * stride + lane] = previous[lane];
+        }
+    }
+#endif
+    return true;
+}
+
+void MeshCodec::AppendBytesChunk(const void* elements, size_t count, uint32_t stride, std::vector<uint8_t>& stream) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(elements);
+    for (size_t first = 0; first < count; first += ChunkElements) {
+        const uint32_t chunkCount = (uint32_t)std::min<size_t>(ChunkElements, count - first);
+        const size_t recordOffset = stream.size();
+        BeginChunk(stream, chunkCount, 0);
+        uint8_t previous[MaxStride] = {};
+        for (uint32_t block = 0; block < chunkCount; block += BlockElements) {
+            EncodeBytesBlock(bytes + (first + block) * stride, std::min(chunkCount - block, BlockElements), stride, previous, stream);
+        }
+        EndChunk(stream, recordOffset);
+    }
+}
+
+// Block by block, into 'direct' when the decoded elements are the output, otherwise through
+// scratch handed to 'expand(first, count, block)'
+template <typename Expand>
+static bool DecodeBytesChunk(const uint8_t* payload, const MeshCodecChunk& chunk, uint32_t stride, uint8_t* direct,
+                             Expand expand) {
+    alignas(16) uint8_t lanes[MeshCodec::MaxStride * BlockElements];
+    alignas(16) uint8_t block[MeshCodec::MaxStride * BlockElements];
+    alignas(16) uint8_t previous[MeshCodec::MaxStride] = {};
+    const uint32_t padded = (stride + 15) & ~15u;
+    memset(lanes + stride * BlockElements, 0, (padded - stride) * BlockElements);
+    const uint8_t* p = payload;
+    const uint8_t* end = payload + chunk.Size;
+    for (uint32_t first = 0; first < chunk.Count; first += BlockElements) {
+        const uint32_t count = std::min(chunk.Count - first, BlockElements);
+        uint8_t* target = direct ? direct + (size_t)first * stride : block;
+        if (!DecodeBytesBlock(p, end, count, stride, previous, lanes, target)) return false;
+        if (!direct) expand(first, count, block);
+    }
+    return p == end;
+}
+
+void MeshCodec::AppendAdjacencyChunk(const uint32_t* indices, const uint32_t* adjacency, size_t triangleCount,
+                                     std::vector<uint8_t>& stream) {
+    std::vector<uint32_t> offsets(std::min<size_t>(triangleCount, ChunkElements) * 6);
+    for (size_t first = 0; first < triangleCount; first += ChunkElements) {
+        const size_t count = std::min<size_t>(ChunkElements, triangleCount - first);
+        for (size_t t = 0; t < count; t++) {
+            const uint32_t* tri = indices + (first + t) * 3;
+            const uint32_t* adj = adjacency + (first + t) * 6;
+            uint32_t* o = &offsets[t * 6];
+            for (int k = 0; k < 3; k++) {
+                o[k * 2] = adj[k * 2] - tri[k];
+                o[k * 2 + 1] = adj[k * 2 + 1] - adj[k * 2];
+            }
+        }
+        AppendBytesChunk(offsets.data(), count, 6 * sizeof(uint32_t), stream);
+    }
+}
+
+bool MeshCodec::ReadChunks(const uint8_t* stream, size_t size, MeshCodecHeader& header, std::vector<MeshCodecChunk>& chunks) {
+    chunks.clear();
+    if (size < sizeof(header)) return false;
+    memcpy(&header, stream, sizeof(header));
+    if (memcmp(header.Magic, "PMCS", 4) != 0) return false;
+    switch (header.Format) {
+    case MeshCodecFormat::Indices: if (header.Stride != 3 * sizeof(uint32_t)) return false; break;
+    case MeshCodecFormat::Bytes: if (header.Stride == 0 || header.Stride % 4 || header.Stride > MaxStride) return false; break;
+    case MeshCodecFormat::Unorm16: if (header.Stride != MeshCodecHeader::Lanes * sizeof(float)) return false; break;
+    case MeshCodecFormat::Adjacency: if (header.Stride != 6 * sizeof(uint32_t)) return false; break;
+    default: return false;
+    }
+
+    chunks.reserve(header.ChunkCount);
+    size_t offset = sizeof(header);
+    uint64_t first = 0;
+    for (uint32_t c = 0; c < header.ChunkCount; c++) {
+        ChunkRecord record;
+        if (size - offset < sizeof(record)) return false;
+        memcpy(&record, stream + offset, sizeof(record));
+        offset += sizeof(record);
+        if (size - offset < record.Size) return false;
+        MeshCodecChunk chunk;
+        chunk.Offset = offset;
+        chunk.Size = record.Size;
+        chunk.Count = record.Count;
+        chunk.First = first;
+        chunk.Base = record.Base;
+        chunks.push_back(chunk);
+        offset += record.Size;
+        first += record.Count;
+    }
+    return first == header.Count && offset == size;
+}
+
+bool MeshCodec::DecodeChunk(const MeshCodecHeader& header, const uint8_t* stream, const MeshCodecChunk& chunk, void* out,
+                            const uint32_t* indices) {
+    const uint8_t* payload = stream + chunk.Offset;
+    switch (header.Format) {
+    case MeshCodecFormat::Indices:
+        return DecodeIndexChunk(payload, chunk, static_cast<uint32_t*>(out));
+
+    case MeshCodecFormat::Bytes:
+        return DecodeBytesChunk(payload, chunk, header.Stride, static_cast<uint8_t*>(out), [](uint32_t, uint32_t, const uint8_t*) {});
+
+    case MeshCodecFormat::Unorm16: {
+        static_assert(MeshCodecHeader::Lanes == 8, "Unorm16 expands a 16-byte vertex into two float4");
+        float* vertices = static_cast<float*>(out);
+        return DecodeBytesChunk(payload, chunk, MeshCodecHeader::Lanes * sizeof(uint16_t), nullptr,
+                                [&](uint32_t first, uint32_t count, const uint8_t* block) {
+            float* dst = vertices + (size_t)first * MeshCodecHeader::Lanes;
+#if PELAGE_SSE2
+            const __m128 offsetLow = _mm_loadu_ps(header.Offset), offsetHigh = _mm_loadu_ps(header.Offset + 4);
+            const __m128 scaleLow = _mm_loadu_ps(header.Scale), scaleHigh = _mm_loadu_ps(header.Scale + 4);
+            const __m128i zero = _mm_setzero_si128();
+            for (uint32_t i = 0; i < count; i++, dst += 8) {
+                __m128i q = _mm_load_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+                __m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(q, zero));
+                __m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(q, zero));
+                _mm_storeu_ps(dst, _mm_add_ps(_mm_mul_ps(low, scaleLow), offsetLow));
+                _mm_storeu_ps(dst + 4, _mm_add_ps(_mm_mul_ps(high, scaleHigh), offsetHigh));
+            }
+#else
+            for (uint32_t i = 0; i < count; i++, dst += 8) {
+                uint16_t q[8];
+                memcpy(q, block + i * 16, sizeof(q));
+                for (int lane = 0; lane < 8; lane++) dst[lane] = (float)q[lane] * header.Scale[lane] + header.Offset[lane];
+            }
+#endif
+        });
+    }
+
+    case MeshCodecFormat::Adjacency: {
+        if (!indices) return false;
+        uint32_t* adjacency = static_cast<uint32_t*>(out);
+        return DecodeBytesChunk(payload, chunk, 6 * sizeof(uint32_t), nullptr, [&](uint32_t first, uint32_t count, const uint8_t* block) {
+            for (uint32_t t = 0; t < count; t++) {
+                uint32_t o[6];
+                memcpy(o, block + t * sizeof(o), sizeof(o));
+                const uint32_t* tri = indices + (size_t)(first + t) * 3;
+                uint32_t* adj = adjacency + (size_t)(first + t) * 6;
+                for (int k = 0; k < 3; k++) {
+                    adj[k * 2] = tri[k] + o[k * 2];
+                    adj[k * 2 + 1] = adj[k * 2] + o[k * 2 + 1];
+                }
+            }
+        });
+    }
+    }
+    return false;
+}
+
+bool MeshCodec::Decode(const uint8_t* stream, size_t size, void* out, const uint32_t* indices) {
+    Clock::time_point start = Clock::now();
+    MeshCodecHeader header;
+    std::vector<MeshCodecChunk> chunks;
+    if (!ReadChunks(stream, size, header, chunks)) return false;
+    std::atomic<bool> valid{ true };
+    uint8_t* dst = static_cast<uint8_t*>(out);
+    m_jobs.ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            const MeshCodecChunk& chunk = chunks[c];
+            if (!DecodeChunk(header, stream, chunk, dst + chunk.First * header.Stride, indices ? indices + chunk.First * 3 : nullptr)) {
+                valid = false;
+            }
+        }
+    });
+    m_stats.EncodedBytes = size;
+    m_stats.DecodedBytes = header.Count * header.Stride;
+    m_stats.Chunks = header.ChunkCount;
+    m_stats.DecodeMs = MillisecondsSince(start);
+    return valid;
+}
+
+void MeshCodec::EncodeIndices(const uint32_t* indices, size_t triangleCount, std::vector<uint8_t>& stream) {
+    Clock::time_point start = Clock::now();
+    BeginStream(MeshCodecFormat::Indices, 3 * sizeof(uint32_t), stream);
+    uint32_t next = 0;
+    AppendIndexChunk(indices, triangleCount, next, stream);
+    RecordEncode(MillisecondsSince(start), triangleCount * 3 * sizeof(uint32_t), stream);
+}
+
+void MeshCodec::EncodeBytes(const void* elements, size_t count, uint32_t stride, std::vector<uint8_t>& stream) {
+    Clock::time_point start = Clock::now();
+    BeginStream(MeshCodecFormat::Bytes, stride, stream);
+    AppendBytesChunk(elements, count, stride, stream);
+    RecordEncode(MillisecondsSince(start), count * stride, stream);
+}
+
+void MeshCodec::EncodeUnorm16(const float* vertices, size_t count, std::vector<uint8_t>& stream) {
+    Clock::time_point start = Clock::now();
+    const uint32_t lanes = MeshCodecHeader::Lanes;
+    BeginStream(MeshCodecFormat::Unorm16, lanes * sizeof(float), stream);
+    MeshCodecHeader header;
+    memcpy(&header, stream.data(), sizeof(header));
+
+    // Positions and UVs over their range, normals over [-1, 1]
+    float lowest[lanes], highest[lanes];
+    std::fill(lowest, lowest + lanes, count ? INFINITY : 0.0f);
+    std::fill(highest, highest + lanes, count ? -INFINITY : 0.0f);
+    for (size_t i = 0; i < count; i++) {
+        for (uint32_t lane = 0; lane < lanes; lane++) {
+            lowest[lane] = std::min(lowest[lane], vertices[i * lanes + lane]);
+            highest[lane] = std::max(highest[lane], vertices[i * lanes + lane]);
+        }
+    }
+    for (uint32_t lane = 3; lane < 6; lane++) {
+        lowest[lane] = -1.0f;
+        highest[lane] = 1.0f;
+    }
+    for (uint32_t lane = 0; lane < lanes; lane++) {
+        header.Offset[lane] = lowest[lane];
+        header.Scale[lane] = (highest[lane] - lowest[lane]) / 65535.0f;
+    }
+    memcpy(stream.data(), &header, sizeof(header));
+
+    std::vector<uint16_t> quantized(std::min<size_t>(count, ChunkElements) * lanes);
+    for (size_t first = 0; first < count; first += ChunkElements) {
+        const size_t n = std::min<size_t>(ChunkElements, count - first);
+        for (size_t i = 0; i < n * lanes; i++) {
+            const uint32_t lane = (uint32_t)(i % lanes);
+            float q = header.Scale[lane] > 0.0f ? (vertices[first * lanes + i] - header.Offset[lane]) / header.Scale[lane] : 0.0f;
+            quantized[i] = (uint16_t)std::clamp(std::lround(q), 0l, 65535l);
+        }
+        AppendBytesChunk(quantized.data(), n, lanes * sizeof(uint16_t), stream);
+    }
+    RecordEncode(MillisecondsSince(start), count * lanes * sizeof(float), stream);
+}
+
+void MeshCodec::EncodeAdjacency(const uint32_t* indices, const uint32_t* adjacency, size_t triangleCount,
+                                std::vector<uint8_t>& stream) {
+    Clock::time_point start = Clock::now();
+    BeginStream(MeshCodecFormat::Adjacency, 6 * sizeof(uint32_t), stream);
+    AppendAdjacencyChunk(indices, adjacency, triangleCount, stream);
+    RecordEncode(MillisecondsSince(start), triangleCount * 6 * sizeof(uint32_t), stream);
+}
+
+void MeshCodec::RecordEncode(double encodeMs, uint64_t decodedBytes, const std::vector<uint8_t>& stream) {
+    MeshCodecHeader header;
+    memcpy(&header, stream.data(), sizeof(header));
+    m_stats.EncodedBytes = stream.size();
+    m_stats.DecodedBytes = decodedBytes;
+    m_stats.Chunks = header.ChunkCount;
+    m_stats.EncodeMs = encodeMs;
+}
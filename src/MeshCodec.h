@@ -0,0 +1,100 @@
+#pragma once
+#include "JobSystem.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lossless compression of mesh streams, decoded at memory speed. A stream is a header followed by
+// independent chunks, so chunks decode in parallel or one after another into write-once memory
+// (a mapped upload buffer) without reading back what they wrote.
+//   Indices    Edge-based, one code byte per triangle. A triangle that shares an edge with one of
+//              the last 16 edges names that edge (4 bits), which of its own edges it is (2 bits)
+//              and how its third vertex is found (2 bits): the next vertex not seen yet, one of
+//              the last 16 vertices (a data byte) or a zigzag varint delta from the previous
+//              vertex coded that way. Other triangles code their three vertices with the same
+//              2-bit modes. Everything is whole bytes; well-ordered meshes take ~1-2 per triangle.
+//   Bytes      Any fixed-size elements (float vertices, materials). Each byte lane is delta coded
+//              against the previous element and zigzagged, then packed in groups of 16 at 0, 2, 4
+//              or 8 bits. Decoding unpacks a group with a few SSE2 shifts, then a 16x16 transpose
+//              and one add per element undo the deltas for 16 lanes at a time.
+//   Unorm16    The filter for quantized vertices: the 8 floats of a vertex (position, normal, uv)
+//              as 16-bit fractions of their range, stored as Bytes of 16 per vertex and expanded
+//              to floats with one multiply-add per 4 lanes. Lossy by the quantization step (the
+//              header keeps it); the codec itself is exact.
+//   Adjacency  The fin geometry shader's 6 indices per triangle as Bytes, each entry an offset:
+//              corners from the triangle's decoded indices (so all zero in practice), opposite
+//              vertices from the corner before them.
+
+enum class MeshCodecFormat : uint32_t { Indices = 1, Bytes = 2, Unorm16 = 3, Adjacency = 4 };
+
+struct MeshCodecHeader {
+    static constexpr uint32_t Lanes = 8; // Unorm16 lanes per vertex
+
+    char Magic[4] = { 'P', 'M', 'C', 'S' };
+    MeshCodecFormat Format = MeshCodecFormat::Bytes;
+    uint32_t Stride = 0;     // Decoded bytes per element (per triangle for indices and adjacency)
+    uint32_t ChunkCount = 0;
+    uint64_t Count = 0;      // Elements or triangles
+    float Offset[Lanes] = {}; // Unorm16: value = Offset + q * Scale
+    float Scale[Lanes] = {};
+};
+
+// One chunk of a stream, found by MeshCodec::ReadChunks
+struct MeshCodecChunk {
+    uint64_t Offset = 0; // Of the payload, from the start of the stream
+    uint32_t Size = 0;   // Payload bytes
+    uint32_t Count = 0;  // Elements or triangles
+    uint64_t First = 0;  // Element or triangle of the stream the chunk starts at
+    uint32_t Base = 0;   // Indices: the next unseen vertex when the chunk starts
+};
+
+struct MeshCodecStats {
+    uint64_t EncodedBytes = 0;
+    uint64_t DecodedBytes = 0;
+    uint32_t Chunks = 0;
+    double EncodeMs = 0.0;
+    double DecodeMs = 0.0;
+};
+
+class MeshCodec {
+public:
+    static constexpr uint32_t ChunkElements = 16384; // Or triangles
+    static constexpr uint32_t MaxStride = 64; // Bytes per element
+
+    explicit MeshCodec(JobSystem& jobs) : m_jobs(jobs) {}
+
+    // Whole streams, replacing 'stream'. Bytes needs a stride that is a multiple of 4 up to
+    // MaxStride; Unorm16 takes MeshCodecHeader::Lanes floats per vertex.
+    void EncodeIndices(const uint32_t* indices, size_t triangleCount, std::vector<uint8_t>& stream);
+    void EncodeBytes(const void* elements, size_t count, uint32_t stride, std::vector<uint8_t>& stream);
+    void EncodeUnorm16(const float* vertices, size_t count, std::vector<uint8_t>& stream);
+    void EncodeAdjacency(const uint32_t* indices, const uint32_t* adjacency, size_t triangleCount, std::vector<uint8_t>& stream);
+
+    // Chunks in parallel into 'out' (header.Count * header.Stride bytes). Adjacency reads the
+    // stream's decoded 'indices'. False on a malformed stream.
+    bool Decode(const uint8_t* stream, size_t size, void* out, const uint32_t* indices = nullptr);
+
+    const MeshCodecStats& Stats() const { return m_stats; }
+
+    // Building blocks for writing a stream piece by piece: BeginStream puts an empty header in
+    // 'stream', and every chunk appended after it adds itself to the header's totals, so the
+    // payload can be flushed between chunks as long as the header is rewritten at the end.
+    // Index chunks carry 'next' over to the following chunk (0 for the first).
+    static void BeginStream(MeshCodecFormat format, uint32_t stride, std::vector<uint8_t>& stream);
+    static void AppendIndexChunk(const uint32_t* indices, size_t triangleCount, uint32_t& next, std::vector<uint8_t>& stream);
+    static void AppendBytesChunk(const void* elements, size_t count, uint32_t stride, std::vector<uint8_t>& stream);
+    static void AppendAdjacencyChunk(const uint32_t* indices, const uint32_t* adjacency, size_t triangleCount,
+                                     std::vector<uint8_t>& stream);
+
+    // Streaming decode: the header and chunk table, then any chunk on its own. 'out' points at
+    // the chunk's first element; Adjacency needs the chunk's own triangles of 'indices'.
+    static bool ReadChunks(const uint8_t* stream, size_t size, MeshCodecHeader& header, std::vector<MeshCodecChunk>& chunks);
+    static bool DecodeChunk(const MeshCodecHeader& header, const uint8_t* stream, const MeshCodecChunk& chunk, void* out,
+                            const uint32_t* indices = nullptr);
+
+private:
+    void RecordEncode(double encodeMs, uint64_t decodedBytes, const std::vector<uint8_t>& stream);
+
+    JobSystem& m_jobs;
+    MeshCodecStats m_stats;
+};
@@ -0,0 +1,228 @@
+// Headless mesh codec benchmark. First checks that random data of every kind round-trips exactly
+// and that damaged streams are refused. Then encodes scattered synthetic scenes of 100K, 1M and
+// 4M triangles (or the count given) and per stream reports the compression ratio and the decode
+// speed, one chunk after another on the calling thread (the streaming path) and in parallel on
+// every thread, in GB/s of decoded data. Last, the largest scene goes through a raw and a
+// compressed .pmesh, comparing file size and load time.
+// Usage: PelageMeshCodecBench [triangles]
+#include "BenchReport.h"
+#include "MeshAdjacency.h"
+#include "MeshCodec.h"
+#include "MeshFile.h"
+#include "SceneGen.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+static uint64_t g_random = 1;
+
+static uint32_t Random() {
+    g_random = g_random * 6364136223846793005ull + 1442695040888963407ull;
+    return (uint32_t)(g_random >> 32);
+}
+
+// Every chunk in order on this thread, as a streaming upload would
+static bool DecodeSerial(const std::vector<uint8_t>& stream, void* out, const uint32_t* indices = nullptr) {
+    MeshCodecHeader header;
+    std::vector<MeshCodecChunk> chunks;
+    if (!MeshCodec::ReadChunks(stream.data(), stream.size(), header, chunks)) return false;
+    for (const MeshCodecChunk& chunk : chunks) {
+        if (!MeshCodec::DecodeChunk(header, stream.data(), chunk, static_cast<uint8_t*>(out) + chunk.First * header.Stride,
+                                    indices ? indices + chunk.First * 3 : nullptr)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool CheckRandomStreams(JobSystem& jobs) {
+    MeshCodec codec(jobs);
+    bool ok = true;
+
+    // Slowly drifting lanes with the odd random byte, at every stride and around block and chunk sizes
+    bool bytes = true;
+    for (uint32_t stride = 4; stride <= MeshCodec::MaxStride; stride += 4) {
+        for (size_t count : { 0, 1, 15, 17, 255, 256, 257, 16384, 40000 }) {
+            std::vector<uint8_t> input(count * stride), output(count * stride + 1, 0xcd);
+            for (size_t i = 0; i < input.size(); i++) input[i] = (uint8_t)(i % 7 ? i / stride / 3 + Random() % 3 : Random());
+            std::vector<uint8_t> stream;
+            codec.EncodeBytes(input.data(), count, stride, stream);
+            bytes &= codec.Decode(stream.data(), stream.size(), output.data()) && memcmp(input.data(), output.data(), input.size()) == 0 &&
+                     output.back() == 0xcd;
+        }
+    }
+    ok &= Report("bytes round trip", bytes);
+
+    bool indices = true, damaged = true;
+    for (size_t triangles : { 0, 1, 100, 50000 }) {
+        std::vector<uint32_t> input(triangles * 3), output(triangles * 3);
+        for (uint32_t& v : input) v = Random() % 1000;
+        std::vector<uint8_t> stream;
+        codec.EncodeIndices(input.data(), triangles, stream);
+        indices &= codec.Decode(stream.data(), stream.size(), output.data()) && output == input;
+        if (triangles > 1) {
+            std::vector<uint8_t> truncated(stream.begin(), stream.end() - 1);
+            damaged &= !codec.Decode(truncated.data(), truncated.size(), output.data());
+            // Flipped bits decode to something or fail, but stay inside the buffers
+            for (int i = 0; i < 100; i++) {
+                std::vector<uint8_t> flipped = stream;
+                flipped[sizeof(MeshCodecHeader) + Random() % (flipped.size() - sizeof(MeshCodecHeader))] ^= (uint8_t)(1 << Random() % 8);
+                codec.Decode(flipped.data(), flipped.size(), output.data());
+            }
+        }
+    }
+    ok &= Report("random indices round trip", indices);
+    ok &= Report("truncated streams refused", damaged);
+
+    std::vector<uint32_t> triangles(3000), adjacency(6000), output(6000);
+    for (uint32_t& v : triangles) v = Random() % 500;
+    for (uint32_t& v : adjacency) v = Random();
+    std::vector<uint8_t> stream;
+    codec.EncodeAdjacency(triangles.data(), adjacency.data(), 1000, stream);
+    ok &= Report("adjacency round trip", codec.Decode(stream.data(), stream.size(), output.data(), triangles.data()) && output == adjacency);
+    return ok;
+}
+
+struct StreamResult {
+    double Ratio = 0.0;
+    double SerialGBs = 0.0;
+    double ParallelGBs = 0.0;
+};
+
+template <typename Encode>
+static StreamResult Measure(MeshCodec& codec, size_t rawBytes, void* out, const uint32_t* indices, Encode encode,
+                            std::vector<uint8_t>& stream, bool& ok) {
+    encode(stream);
+    StreamResult result;
+    result.Ratio = (double)rawBytes / stream.size();
+    const int runs = 5;
+    double serialMs = 1e30, parallelMs = 1e30;
+    for (int run = 0; run < runs; run++) {
+        Clock::time_point start = Clock::now();
+        ok &= DecodeSerial(stream, out, indices);
+        serialMs = std::min(serialMs, MillisecondsSince(start));
+        ok &= codec.Decode(stream.data(), stream.size(), out, indices);
+        parallelMs = std::min(parallelMs, codec.Stats().DecodeMs);
+    }
+    result.SerialGBs = rawBytes / (serialMs * 1e6);
+    result.ParallelGBs = rawBytes / (parallelMs * 1e6);
+    return result;
+}
+
+static void PrintResult(const char* name, size_t rawBytes, const StreamResult& result, bool identical) {
+    printf("  %-18s %8.1f MB  %5.2fx  %6.2f GB/s serial  %6.2f GB/s parallel  %s\n", name, rawBytes / (1024.0 * 1024.0), result.Ratio,
+           result.SerialGBs, result.ParallelGBs, identical ? "ok" : "FAILED");
+}
+
+static bool Benchmark(JobSystem& jobs, uint64_t triangles, MeshArrays& mesh) {
+    SynthScatterSettings settings;
+    settings.Triangles = triangles;
+    SceneGen generator(jobs);
+    if (!generator.Generate(SceneGen::Scatter(settings), mesh)) return false;
+    mesh.IndicesAdj.resize(mesh.TriangleCount() * 6);
+    MeshAdjacency::Build(mesh.Indices.data(), mesh.TriangleCount(), mesh.IndicesAdj.data());
+    printf("%zu vertices, %zu triangles\n", mesh.VertexCount(), mesh.TriangleCount());
+
+    MeshCodec codec(jobs);
+    std::vector<uint8_t> stream;
+    bool ok = true;
+
+    bool valid = true;
+    std::vector<uint32_t> indices(mesh.Indices.size());
+    StreamResult result = Measure(codec, indices.size() * sizeof(uint32_t), indices.data(), nullptr, [&](std::vector<uint8_t>& s) {
+        codec.EncodeIndices(mesh.Indices.data(), mesh.TriangleCount(), s);
+    }, stream, valid);
+    printf("  indices: %.2f bytes per triangle, encoded in %.1f ms\n", (double)stream.size() / mesh.TriangleCount(), codec.Stats().EncodeMs);
+    bool identical = valid && indices == mesh.Indices;
+    PrintResult("indices", indices.size() * sizeof(uint32_t), result, identical);
+    ok &= identical;
+
+    valid = true;
+    std::vector<uint32_t> adjacency(mesh.IndicesAdj.size());
+    result = Measure(codec, adjacency.size() * sizeof(uint32_t), adjacency.data(), mesh.Indices.data(), [&](std::vector<uint8_t>& s) {
+        codec.EncodeAdjacency(mesh.Indices.data(), mesh.IndicesAdj.data(), mesh.TriangleCount(), s);
+    }, stream, valid);
+    identical = valid && adjacency == mesh.IndicesAdj;
+    PrintResult("adjacency", adjacency.size() * sizeof(uint32_t), result, identical);
+    ok &= identical;
+
+    valid = true;
+    const uint32_t vertexBytes = MeshArrays::VertexStride * sizeof(float);
+    std::vector<float> vertices(mesh.Vertices.size());
+    result = Measure(codec, vertices.size() * sizeof(float), vertices.data(), nullptr, [&](std::vector<uint8_t>& s) {
+        codec.EncodeBytes(mesh.Vertices.data(), mesh.VertexCount(), vertexBytes, s);
+    }, stream, valid);
+    identical = valid && memcmp(vertices.data(), mesh.Vertices.data(), vertices.size() * sizeof(float)) == 0;
+    PrintResult("vertices float32", vertices.size() * sizeof(float), result, identical);
+    ok &= identical;
+
+    // Quantized: within half a step of every lane's range, give or take float rounding
+    valid = true;
+    result = Measure(codec, vertices.size() * sizeof(float), vertices.data(), nullptr, [&](std::vector<uint8_t>& s) {
+        codec.EncodeUnorm16(mesh.Vertices.data(), mesh.VertexCount(), s);
+    }, stream, valid);
+    MeshCodecHeader header;
+    memcpy(&header, stream.data(), sizeof(header));
+    double worst = 0.0;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const uint32_t lane = (uint32_t)(i % MeshCodecHeader::Lanes);
+        worst = std::max(worst, (double)std::fabs(vertices[i] - mesh.Vertices[i]) / std::max(header.Scale[lane], 1e-30f));
+    }
+    identical = valid && worst <= 0.51;
+    PrintResult("vertices unorm16", vertices.size() * sizeof(float), result, identical);
+    printf("  %-18s worst error %.3f quantization steps\n", "", worst);
+    ok &= identical;
+
+    valid = true;
+    std::vector<uint32_t> materials(mesh.TriangleMaterials.size());
+    result = Measure(codec, materials.size() * sizeof(uint32_t), materials.data(), nullptr, [&](std::vector<uint8_t>& s) {
+        codec.EncodeBytes(mesh.TriangleMaterials.data(), mesh.TriangleCount(), sizeof(uint32_t), s);
+    }, stream, valid);
+    identical = valid && materials == mesh.TriangleMaterials;
+    PrintResult("materials", materials.size() * sizeof(uint32_t), result, identical);
+    ok &= identical;
+    return ok;
+}
+
+// Raw against compressed .pmesh of the same mesh
+static bool CompareFiles(JobSystem& jobs, const MeshArrays& mesh) {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string rawPath = (directory / "pelage_codec_raw.pmesh").string();
+    const std::string packedPath = (directory / "pelage_codec_packed.pmesh").string();
+    bool ok = MeshFile::Write(rawPath, mesh, 1) && MeshFile::Write(packedPath, mesh, 1, true);
+
+    MeshArrays raw, packed;
+    Clock::time_point start = Clock::now();
+    ok &= MeshFile::Read(rawPath, raw);
+    const double rawMs = MillisecondsSince(start);
+    start = Clock::now();
+    ok &= MeshFile::Read(packedPath, packed, nullptr, &jobs);
+    const double packedMs = MillisecondsSince(start);
+    const bool identical = ok && packed.Vertices == mesh.Vertices && packed.Indices == mesh.Indices &&
+                           packed.IndicesAdj == mesh.IndicesAdj && packed.TriangleMaterials == mesh.TriangleMaterials &&
+                           raw.Indices == packed.Indices;
+    const double rawMB = std::filesystem::file_size(rawPath) / (1024.0 * 1024.0);
+    const double packedMB = std::filesystem::file_size(packedPath) / (1024.0 * 1024.0);
+    printf(".pmesh raw %.1f MB read in %.1f ms, compressed %.1f MB (%.2fx) read in %.1f ms: %s\n", rawMB, rawMs, packedMB,
+           rawMB / packedMB, packedMs, identical ? "identical" : "DIFFERS");
+    std::filesystem::remove(rawPath);
+    std::filesystem::remove(packedPath);
+    return identical;
+}
+
+int main(int argc, char** argv) {
+    std::vector<uint64_t> triangleCounts = { 100000, 1000000, 4000000 };
+    if (argc > 1) triangleCounts = { (uint64_t)std::max(atoll(argv[1]), 1ll) };
+
+    JobSystem jobs;
+    bool ok = CheckRandomStreams(jobs);
+    printf("%u threads, %u elements per chunk\n", jobs.ThreadCount(), MeshCodec::ChunkElements);
+    MeshArrays mesh;
+    for (uint64_t triangles : triangleCounts) ok &= Benchmark(jobs, triangles, mesh);
+    ok &= CompareFiles(jobs, mesh);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+#include "MeshFile.h"
+#include "MeshCodec.h"
+#include <cstdio>
+#include <cstring>
+
+static bool HeaderValid(const MeshFileHeader& header) {
+    return memcmp(header.Magic, "PMSH", 4) == 0 && header.Version == MeshFile::Version &&
+           header.VertexStride == MeshArrays::VertexStride && header.VertexCount <= UINT32_MAX;
+}
+
+// One compressed section: its size, then a stream of 'count' elements of 'format' decoded into 'out'
+static bool ReadStream(std::ifstream& file, uint64_t fileSize, MeshCodecFormat format, uint32_t stride, uint64_t count,
+                       void* out, const uint32_t* indices, JobSystem* jobs, std::vector<uint8_t>& stream) {
+    uint64_t size = 0;
+    if (!file.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > fileSize - (uint64_t)file.tellg()) return false;
+    stream.resize(size);
+    if (!file.read(reinterpret_cast<char*>(stream.data()), (std::streamsize)size)) return false;
+
+    MeshCodecHeader header;
+    std::vector<MeshCodecChunk> chunks;
+    if (!MeshCodec::ReadChunks(stream.data(), stream.size(), header, chunks) || header.Format != format ||
+        header.Stride != stride || header.Count != count) {
+        return false;
+    }
+    if (jobs) return MeshCodec(*jobs).Decode(stream.data(), stream.size(), out, indices);
+    for (const MeshCodecChunk& chunk : chunks) {
+        if (!MeshCodec::DecodeChunk(header, stream.data(), chunk, static_cast<uint8_t*>(out) + chunk.First * stride,
+                                    indices ? indices + chunk.First * 3 : nullptr)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void WriteStream(std::ofstream& file, const std::vector<uint8_t>& stream) {
+    uint64_t size = stream.size();
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(stream.data()), (std::streamsize)stream.size());
+}
+
+bool MeshFile::ReadHeader(const std::string& path, MeshFileHeader& header) {
+    std::ifstream file(path, std::ios::binary);
+    return file.read(reinterpret_cast<char*>(&header), sizeof(header)) && HeaderValid(header);
+}
+
+bool MeshFile::Read(const std::string& path, MeshArrays& mesh, MeshFileHeader* headerOut, JobSystem* jobs) {
+    std::ifstream file(path, std::ios::binary);
+    MeshFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !HeaderValid(header)) return false;
+
+    mesh.Vertices.resize(header.VertexCount * MeshArrays::VertexStride);
+    mesh.Indices.resize(header.TriangleCount * 3);
+    mesh.IndicesAdj.resize(header.Flags & MeshFileHeader::HasAdjacency ? header.TriangleCount * 6 : 0);
+    mesh.TriangleMaterials.resize(header.Flags & MeshFileHeader::HasMaterials ? header.TriangleCount : 0);
+    bool ok;
+    if (header.Flags & MeshFileHeader::Compressed) {
+        file.seekg(0, std::ios::end);
+        const uint64_t fileSize = (uint64_t)file.tellg();
+        file.seekg(sizeof(header));
+        std::vector<uint8_t> stream;
+        ok = ReadStream(file, fileSize, MeshCodecFormat::Bytes, MeshArrays::VertexStride * sizeof(float), header.VertexCount,
+                        mesh.Vertices.data(), nullptr, jobs, stream) &&
+             ReadStream(file, fileSize, MeshCodecFormat::Indices, 3 * sizeof(uint32_t), header.TriangleCount, mesh.Indices.data(),
+                        nullptr, jobs, stream) &&
+             (mesh.IndicesAdj.empty() || ReadStream(file, fileSize, MeshCodecFormat::Adjacency, 6 * sizeof(uint32_t),
+                                                    header.TriangleCount, mesh.IndicesAdj.data(), mesh.Indices.data(), jobs, stream)) &&
+             (mesh.TriangleMaterials.empty() || ReadStream(file, fileSize, MeshCodecFormat::Bytes, sizeof(uint32_t), header.TriangleCount,
+                                                           mesh.TriangleMaterials.data(), nullptr, jobs, stream));
+    } else {
+        ok = file.read(reinterpret_cast<char*>(mesh.Vertices.data()), mesh.Vertices.size() * sizeof(float)) &&
+             file.read(reinterpret_cast<char*>(mesh.Indices.data()), mesh.Indices.size() * sizeof(uint32_t)) &&
+             file.read(reinterpret_cast<char*>(mesh.IndicesAdj.data()), mesh.IndicesAdj.size() * sizeof(uint32_t)) &&
+             file.read(reinterpret_cast<char*>(mesh.TriangleMaterials.data()), mesh.TriangleMaterials.size() * sizeof(uint32_t));
+    }
+    if (!ok) {
+        mesh = MeshArrays();
+        return false;
+    }
+    if (headerOut) *headerOut = header;
+    return true;
+}
+
+bool MeshFile::Write(const std::string& path, const MeshArrays& mesh, uint64_t sourceKey, bool compress) {
+    MeshFileHeader header;
+    header.Version = Version;
+    header.SourceKey = sourceKey;
+    header.VertexCount = mesh.VertexCount();
+    header.TriangleCount = mesh.TriangleCount();
+    header.Flags = (mesh.IndicesAdj.empty() ? 0u : (uint32_t)MeshFileHeader::HasAdjacency) |
+                   (mesh.TriangleMaterials.empty() ? 0u : (uint32_t)MeshFileHeader::HasMaterials) |
+                   (compress ? (uint32_t)MeshFileHeader::Compressed : 0u);
+    Aabb bounds = ComputeBounds(mesh.Vertices.data(), mesh.VertexCount(), MeshArrays::VertexStride);
+    if (!bounds.IsEmpty()) {
+        memcpy(header.BoundsMin, &bounds.Min, sizeof(header.BoundsMin));
+        memcpy(header.BoundsMax, &bounds.Max, sizeof(header.BoundsMax));
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (compress) {
+        std::vector<uint8_t> stream;
+        MeshCodec::BeginStream(MeshCodecFormat::Bytes, MeshArrays::VertexStride * sizeof(float), stream);
+        MeshCodec::AppendBytesChunk(mesh.Vertices.data(), mesh.VertexCount(), MeshArrays::VertexStride * sizeof(float), stream);
+        WriteStream(file, stream);
+        uint32_t next = 0;
+        MeshCodec::BeginStream(MeshCodecFormat::Indices, 3 * sizeof(uint32_t), stream);
+        MeshCodec::AppendIndexChunk(mesh.Indices.data(), mesh.TriangleCount(), next, stream);
+        WriteStream(file, stream);
+        if (!mesh.IndicesAdj.empty()) {
+            MeshCodec::BeginStream(MeshCodecFormat::Adjacency, 6 * sizeof(uint32_t), stream);
+            MeshCodec::AppendAdjacencyChunk(mesh.Indices.data(), mesh.IndicesAdj.data(), mesh.TriangleCount(), stream);
+            WriteStream(file, stream);
+        }
+        if (!mesh.TriangleMaterials.empty()) {
+            MeshCodec::BeginStream(MeshCodecFormat::Bytes, sizeof(uint32_t), stream);
+            MeshCodec::AppendBytesChunk(mesh.TriangleMaterials.data(), mesh.TriangleCount(), sizeof(uint32_t), stream);
+            WriteStream(file, stream);
+        }
+        return (bool)file;
+    }
+    file.write(reinterpret_cast<const char*>(mesh.Vertices.data()), mesh.Vertices.size() * sizeof(float));
+    file.write(reinterpret_cast<const char*>(mesh.Indices.data()), mesh.Indices.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(mesh.IndicesAdj.data()), mesh.IndicesAdj.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(mesh.TriangleMaterials.data()), mesh.TriangleMaterials.size() * sizeof(uint32_t));
+    return (bool)file;
+}
+
+MeshFileWriter::~MeshFileWriter() {
+    Close();
+}
+
+std::string MeshFileWriter::SectionPath(int section) const {
+    static const char* suffixes[SectionCount] = { ".vertices.tmp", ".indices.tmp", ".adjacency.tmp", ".materials.tmp" };
+    return m_path + suffixes[section];
+}
+
+void MeshFileWriter::Close() {
+    for (int section = 0; section < SectionCount; section++) {
+        if (!m_sections[section].is_open()) continue;
+        m_sections[section].close();
+        std::remove(SectionPath(section).c_str());
+    }
+}
+
+bool MeshFileWriter::Open(const std::string& path, uint32_t flags) {
+    Close();
+    m_path = path;
+    m_header = MeshFileHeader();
+    m_header.Version = MeshFile::Version;
+    m_header.Flags = flags;
+    m_failed = false;
+    for (int section = 0; section < SectionCount; section++) {
+        if (section == Adjacency && !(flags & MeshFileHeader::HasAdjacency)) continue;
+        if (section == Materials && !(flags & MeshFileHeader::HasMaterials)) continue;
+        // Adjacency is patched in place, so every section is opened for update
+        m_sections[section].open(SectionPath(section), std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+        if (!m_sections[section]) m_failed = true;
+    }
+    return !m_failed;
+}
+
+void MeshFileWriter::AppendVertices(const float* vertices, size_t count) {
+    m_sections[Vertices].write(reinterpret_cast<const char*>(vertices), count * MeshArrays::VertexStride * sizeof(float));
+    m_header.VertexCount += count;
+}
+
+void MeshFileWriter::AppendTriangles(const uint32_t* indices, const uint32_t* adjacency, const uint32_t* materials, size_t count) {
+    m_sections[Indices].write(reinterpret_cast<const char*>(indices), count * 3 * sizeof(uint32_t));
+    if (m_header.Flags & MeshFileHeader::HasAdjacency) {
+        m_sections[Adjacency].write(reinterpret_cast<const char*>(adjacency), count * 6 * sizeof(uint32_t));
+    }
+    if (m_header.Flags & MeshFileHeader::HasMaterials) {
+        m_sections[Materials].write(reinterpret_cast<const char*>(materials), count * sizeof(uint32_t));
+    }
+    m_header.TriangleCount += count;
+}
+
+void MeshFileWriter::PatchAdjacency(uint64_t triangle, uint32_t slot, uint32_t vertex) {
+    std::fstream& section = m_sections[Adjacency];
+    std::streampos end = section.tellp();
+    section.seekp((std::streamoff)((triangle * 6 + slot) * sizeof(uint32_t)));
+    section.write(reinterpret_cast<const char*>(&vertex), sizeof(vertex));
+    section.seekp(end);
+}
+
+bool MeshFileWriter::Finish(uint64_t sourceKey, const Aabb& bounds) {
+    m_header.SourceKey = sourceKey;
+    if (!bounds.IsEmpty()) {
+        memcpy(m_header.BoundsMin, &bounds.Min, sizeof(m_header.BoundsMin));
+        memcpy(m_header.BoundsMax, &bounds.Max, sizeof(m_header.BoundsMax));
+    }
+
+    std::ofstream file(m_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    std::vector<char> buffer(1 << 20);
+    for (int s = 0; s < SectionCount; s++) {
+        std::fstream& section = m_sections[s];
+        if (!section.is_open()) continue;
+        if (!section) m_failed = true;
+        section.flush();
+        section.seekg(0);
+        if (m_header.Flags & MeshFileHeader::Compressed) {
+            WriteCompressed(file, s);
+        } else {
+            while (section.read(buffer.data(), (std::streamsize)buffer.size()) || section.gcount() > 0) {
+                file.write(buffer.data(), section.gcount());
+            }
+        }
+        section.clear();
+    }
+    bool ok = !m_failed && (bool)file;
+    file.close();
+    Close();
+    if (!ok) std::remove(m_path.c_str());
+    return ok;
+}
+
+// Encodes one section a chunk at a time straight into the file, then goes back for the section
+// size and the stream header, which only now hold the totals
+void MeshFileWriter::WriteCompressed(std::ofstream& file, int section) {
+    static const MeshCodecFormat formats[SectionCount] = { MeshCodecFormat::Bytes, MeshCodecFormat::Indices,
+                                                           MeshCodecFormat::Adjacency, MeshCodecFormat::Bytes };
+    static const uint32_t strides[SectionCount] = { MeshArrays::VertexStride * sizeof(float), 3 * sizeof(uint32_t),
+                                                    6 * sizeof(uint32_t), sizeof(uint32_t) };
+    const uint32_t stride = strides[section];
+    std::vector<uint8_t> stream;
+    MeshCodec::BeginStream(formats[section], stride, stream);
+    const size_t headerSize = stream.size();
+    const std::streampos start = file.tellp();
+    uint64_t size = headerSize;
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(stream.data()), (std::streamsize)headerSize);
+
+    // Adjacency is coded against the triangles' own indices, read alongside it
+    std::fstream& indexSection = m_sections[Indices];
+    std::vector<uint32_t> indices(section == Adjacency ? MeshCodec::ChunkElements * 3 : 0);
+    if (section == Adjacency) {
+        indexSection.clear();
+        indexSection.seekg(0);
+    }
+    std::fstream& input = m_sections[section];
+    std::vector<char> buffer((size_t)MeshCodec::ChunkElements * stride);
+    uint32_t next = 0;
+    while (input.read(buffer.data(), (std::streamsize)buffer.size()) || input.gcount() > 0) {
+        const size_t count = (size_t)input.gcount() / stride;
+        if (section == Indices) {
+            MeshCodec::AppendIndexChunk(reinterpret_cast<const uint32_t*>(buffer.data()), count, next, stream);
+        } else if (section == Adjacency) {
+            if (!indexSection.read(reinterpret_cast<char*>(indices.data()), (std::streamsize)(count * 3 * sizeof(uint32_t)))) m_failed = true;
+            MeshCodec::AppendAdjacencyChunk(indices.data(), reinterpret_cast<const uint32_t*>(buffer.data()), count, stream);
+        } else {
+            MeshCodec::AppendBytesChunk(buffer.data(), count, stride, stream);
+        }
+        file.write(reinterpret_cast<const char*>(stream.data() + headerSize), (std::streamsize)(stream.size() - headerSize));
+        size += stream.size() - headerSize;
+        stream.resize(headerSize);
+    }
+
+    const std::streampos end = file.tellp();
+    file.seekp(start);
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(stream.data()), (std::streamsize)headerSize);
+    file.seekp(end);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "CoreMath.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// .pmesh: a flat binary mesh already in the renderer's layout, so loading it is a handful of
+// reads. Header, then the sections back to back: vertices (VertexStride floats: position,
+// normal, uv - GeometryGen's Vertex), indices (3 per triangle), adjacency (6 per triangle, as
+// GeometryGen::GenerateAdjacency), per-triangle materials. Little-endian.
+// With the Compressed flag every section is instead a MeshCodec stream behind its size in bytes
+// (uint64): lossless Bytes for vertices and materials, Indices, Adjacency.
+
+struct MeshArrays {
+    static constexpr uint32_t VertexStride = 8; // Floats per vertex
+
+    std::vector<float> Vertices;
+    std::vector<uint32_t> Indices;
+    std::vector<uint32_t> IndicesAdj;        // Empty or 6 per triangle
+    std::vector<uint32_t> TriangleMaterials; // Empty or 1 per triangle; UINT32_MAX for no material
+
+    size_t VertexCount() const { return Vertices.size() / VertexStride; }
+    size_t TriangleCount() const { return Indices.size() / 3; }
+};
+
+struct MeshFileHeader {
+    enum : uint32_t { HasAdjacency = 1, HasMaterials = 2, Compressed = 4 };
+
+    char Magic[4] = { 'P', 'M', 'S', 'H' };
+    uint32_t Version = 0;
+    uint64_t SourceKey = 0; // Identifies the input and settings the file was built from
+    uint64_t VertexCount = 0;
+    uint64_t TriangleCount = 0;
+    uint32_t VertexStride = MeshArrays::VertexStride;
+    uint32_t Flags = 0;
+    float BoundsMin[3] = {};
+    float BoundsMax[3] = {};
+};
+
+class MeshFile {
+public:
+    static constexpr uint32_t Version = 1;
+
+    static bool ReadHeader(const std::string& path, MeshFileHeader& header);
+    // Compressed sections decode in parallel on 'jobs' if given
+    static bool Read(const std::string& path, MeshArrays& mesh, MeshFileHeader* header = nullptr, JobSystem* jobs = nullptr);
+    static bool Write(const std::string& path, const MeshArrays& mesh, uint64_t sourceKey, bool compress = false);
+};
+
+// Writes a .pmesh whose sizes are only known at the end: every section streams into its own
+// temporary file next to the output, and Finish concatenates them behind the header, encoding
+// them a chunk at a time if the Compressed flag is set. Memory use is one copy buffer, however
+// large the mesh.
+class MeshFileWriter {
+public:
+    MeshFileWriter() = default;
+    ~MeshFileWriter();
+
+    MeshFileWriter(const MeshFileWriter&) = delete;
+    MeshFileWriter& operator=(const MeshFileWriter&) = delete;
+
+    bool Open(const std::string& path, uint32_t flags);
+
+    void AppendVertices(const float* vertices, size_t count);
+    // 'adjacency' (6 per triangle) and 'materials' are read only if the matching flag is set
+    void AppendTriangles(const uint32_t* indices, const uint32_t* adjacency, const uint32_t* materials, size_t count);
+    // Overwrites one adjacency entry of a triangle already appended
+    void PatchAdjacency(uint64_t triangle, uint32_t slot, uint32_t vertex);
+
+    uint64_t VertexCount() const { return m_header.VertexCount; }
+    uint64_t TriangleCount() const { return m_header.TriangleCount; }
+
+    // Writes the final file and removes the temporaries; false if any write failed
+    bool Finish(uint64_t sourceKey, const Aabb& bounds);
+
+private:
+    enum Section { Vertices, Indices, Adjacency, Materials, SectionCount };
+
+    std::string SectionPath(int section) const;
+    void WriteCompressed(std::ofstream& file, int section);
+    void Close();
+
+    std::string m_path;
+    MeshFileHeader m_header;
+    std::fstream m_sections[SectionCount];
+    bool m_failed = false;
+};
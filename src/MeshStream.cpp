@@ -0,0 +1,772 @@
+#include "MeshStream.h"
+#include "Hash.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include "../third_party/tinygltf/json.hpp"
+
+// ---------------------------------------------------------------------------------------------
+// glTF geometry description, straight from the JSON so no buffer is ever loaded whole
+// ---------------------------------------------------------------------------------------------
+
+struct AccessorStream {
+    int Buffer = -1;         // -1: attribute absent
+    uint64_t Offset = 0;     // Bytes into the buffer
+    uint32_t Stride = 0;     // Bytes between elements
+    uint64_t Count = 0;
+    uint32_t ComponentType = 0;
+};
+
+struct PrimitiveStreams {
+    AccessorStream Positions, Normals, UVs, Indices;
+    uint32_t Material = UINT32_MAX;
+
+    uint64_t TriangleCount() const { return Indices.Count / 3; }
+};
+
+struct GltfGeometry {
+    std::vector<std::string> BufferPaths; // Empty for embedded (data URI / GLB) buffers
+    std::vector<PrimitiveStreams> Primitives;
+    bool Skinned = false;
+};
+
+static constexpr uint32_t ComponentFloat = 5126;
+static constexpr uint32_t ComponentUint = 5125;
+static constexpr uint32_t ComponentUshort = 5123;
+static constexpr uint32_t ComponentUbyte = 5121;
+
+static std::string DecodeUri(const std::string& uri) {
+    std::string decoded;
+    for (size_t i = 0; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size()) {
+            decoded += (char)std::stoi(uri.substr(i + 1, 2), nullptr, 16);
+            i += 2;
+        } else {
+            decoded += uri[i];
+        }
+    }
+    return decoded;
+}
+
+static bool ReadTextFile(const std::string& path, std::string& text) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    text = contents.str();
+    return true;
+}
+
+// Accessor -> stream, if it has the expected element layout
+static bool ParseAccessor(const nlohmann::json& gltf, int index, const char* type, bool floatOnly, AccessorStream& stream) {
+    const nlohmann::json& accessors = gltf.value("accessors", nlohmann::json::array());
+    if (index < 0 || index >= (int)accessors.size()) return false;
+    const nlohmann::json& accessor = accessors[index];
+    if (accessor.value("type", std::string()) != type || !accessor.contains("bufferView")) return false;
+
+    uint32_t componentType = accessor.value("componentType", 0u);
+    uint32_t componentSize = componentType == ComponentUint || componentType == ComponentFloat ? 4
+                           : componentType == ComponentUshort ? 2 : componentType == ComponentUbyte ? 1 : 0;
+    if (componentSize == 0 || (floatOnly && componentType != ComponentFloat)) return false;
+    uint32_t components = strcmp(type, "VEC3") == 0 ? 3 : strcmp(type, "VEC2") == 0 ? 2 : 1;
+
+    const nlohmann::json& views = gltf.value("bufferViews", nlohmann::json::array());
+    int viewIndex = accessor.value("bufferView", -1);
+    if (viewIndex < 0 || viewIndex >= (int)views.size()) return false;
+    const nlohmann::json& view = views[viewIndex];
+
+    stream.Buffer = view.value("buffer", -1);
+    stream.Offset = view.value("byteOffset", 0ull) + accessor.value("byteOffset", 0ull);
+    stream.Stride = view.value("byteStride", components * componentSize);
+    stream.Count = accessor.value("count", 0ull);
+    stream.ComponentType = componentType;
+    return stream.Buffer >= 0;
+}
+
+static bool ParseGeometry(const std::string& path, GltfGeometry& geometry) {
+    std::string text;
+    if (!ReadTextFile(path, text)) return false;
+    nlohmann::json gltf = nlohmann::json::parse(text, nullptr, false);
+    if (gltf.is_discarded()) return false;
+
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    for (const nlohmann::json& buffer : gltf.value("buffers", nlohmann::json::array())) {
+        std::string uri = buffer.value("uri", std::string());
+        bool external = !uri.empty() && uri.compare(0, 5, "data:") != 0;
+        geometry.BufferPaths.push_back(external ? (std::filesystem::path(directory) / DecodeUri(uri)).string() : std::string());
+    }
+
+    // Same selection as GeometryGen::LoadGLTF: indexed triangle lists with positions
+    for (const nlohmann::json& mesh : gltf.value("meshes", nlohmann::json::array())) {
+        for (const nlohmann::json& primitive : mesh.value("primitives", nlohmann::json::array())) {
+            if (primitive.value("mode", 4) != 4) continue;
+            const nlohmann::json& attributes = primitive.value("attributes", nlohmann::json::object());
+            PrimitiveStreams streams;
+            if (!ParseAccessor(gltf, attributes.value("POSITION", -1), "VEC3", true, streams.Positions)) continue;
+            if (!ParseAccessor(gltf, primitive.value("indices", -1), "SCALAR", false, streams.Indices)) continue;
+            if (streams.Indices.ComponentType == ComponentFloat) continue;
+            if (!ParseAccessor(gltf, attributes.value("NORMAL", -1), "VEC3", true, streams.Normals)) streams.Normals = AccessorStream();
+            if (!ParseAccessor(gltf, attributes.value("TEXCOORD_0", -1), "VEC2", true, streams.UVs)) streams.UVs = AccessorStream();
+            int material = primitive.value("material", -1);
+            streams.Material = material >= 0 ? (uint32_t)material : UINT32_MAX;
+            geometry.Primitives.push_back(streams);
+        }
+    }
+
+    for (const nlohmann::json& node : gltf.value("nodes", nlohmann::json::array())) {
+        if (node.contains("mesh") && node.contains("skin")) geometry.Skinned = true;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Bounded random access to the buffer files
+// ---------------------------------------------------------------------------------------------
+
+// Fixed number of cached pages with least-recently-used eviction. Index buffers walk their
+// vertices mostly in order, so a few hundred pages keep the hit rate high.
+class PagedReader {
+public:
+    PagedReader(const std::string& path, size_t pageSize, size_t maxPages)
+        : m_file(path, std::ios::binary), m_pageSize(pageSize), m_pages(std::max<size_t>(maxPages, 2)) {}
+
+    bool IsOpen() const { return m_file.is_open(); }
+    uint64_t CachedBytes() const { return (uint64_t)m_pages.size() * m_pageSize; }
+
+    // Bytes past the end of the file read as zero
+    void Read(uint64_t offset, size_t size, void* dst) {
+        uint8_t* out = static_cast<uint8_t*>(dst);
+        while (size > 0) {
+            uint64_t pageIndex = offset / m_pageSize;
+            size_t inPage = (size_t)(offset % m_pageSize);
+            size_t count = std::min(size, m_pageSize - inPage);
+            const Page& page = Fetch(pageIndex);
+            for (size_t i = 0; i < count; i++) {
+                out[i] = inPage + i < page.Valid ? page.Data[inPage + i] : 0;
+            }
+            out += count;
+            offset += count;
+            size -= count;
+        }
+    }
+
+private:
+    struct Page {
+        uint64_t Index = UINT64_MAX;
+        uint64_t LastUse = 0;
+        size_t Valid = 0;
+        std::vector<uint8_t> Data;
+    };
+
+    const Page& Fetch(uint64_t pageIndex) {
+        m_clock++;
+        auto it = m_lookup.find(pageIndex);
+        if (it != m_lookup.end()) {
+            m_pages[it->second].LastUse = m_clock;
+            return m_pages[it->second];
+        }
+
+        size_t victim = 0;
+        for (size_t i = 1; i < m_pages.size(); i++) {
+            if (m_pages[i].LastUse < m_pages[victim].LastUse) victim = i;
+        }
+        Page& page = m_pages[victim];
+        if (page.Index != UINT64_MAX) m_lookup.erase(page.Index);
+        page.Data.resize(m_pageSize);
+        m_file.clear();
+        m_file.seekg((std::streamoff)(pageIndex * m_pageSize));
+        m_file.read(reinterpret_cast<char*>(page.Data.data()), (std::streamsize)m_pageSize);
+        page.Valid = (size_t)std::max<std::streamsize>(m_file.gcount(), 0);
+        page.Index = pageIndex;
+        page.LastUse = m_clock;
+        m_lookup[pageIndex] = victim;
+        return page;
+    }
+
+    std::ifstream m_file;
+    size_t m_pageSize;
+    std::vector<Page> m_pages;
+    std::unordered_map<uint64_t, size_t> m_lookup;
+    uint64_t m_clock = 0;
+};
+
+static constexpr size_t PageSize = 64 * 1024;
+
+// Vertex 'index' of a primitive in the output layout: scaled, z flipped to left-handed (as
+// GeometryGen::LoadGLTF), default normal +y and uv 0 where the attribute is missing
+static void FetchVertex(const PrimitiveStreams& primitive, std::vector<PagedReader>& readers, uint64_t index,
+                        float importScale, float* vertex) {
+    const AccessorStream& p = primitive.Positions;
+    readers[p.Buffer].Read(p.Offset + index * p.Stride, 3 * sizeof(float), vertex);
+    vertex[0] *= importScale;
+    vertex[1] *= importScale;
+    vertex[2] *= -importScale;
+
+    if (primitive.Normals.Buffer >= 0) {
+        const AccessorStream& n = primitive.Normals;
+        readers[n.Buffer].Read(n.Offset + index * n.Stride, 3 * sizeof(float), vertex + 3);
+        vertex[5] = -vertex[5];
+    } else {
+        vertex[3] = 0.0f; vertex[4] = 1.0f; vertex[5] = 0.0f;
+    }
+
+    if (primitive.UVs.Buffer >= 0) {
+        const AccessorStream& uv = primitive.UVs;
+        readers[uv.Buffer].Read(uv.Offset + index * uv.Stride, 2 * sizeof(float), vertex + 6);
+    } else {
+        vertex[6] = vertex[7] = 0.0f;
+    }
+}
+
+static uint32_t FetchIndex(const AccessorStream& indices, std::vector<PagedReader>& readers, uint64_t i) {
+    uint64_t offset = indices.Offset + i * indices.Stride;
+    if (indices.ComponentType == ComponentUint) {
+        uint32_t value;
+        readers[indices.Buffer].Read(offset, 4, &value);
+        return value;
+    }
+    if (indices.ComponentType == ComponentUshort) {
+        uint16_t value;
+        readers[indices.Buffer].Read(offset, 2, &value);
+        return value;
+    }
+    uint8_t value;
+    readers[indices.Buffer].Read(offset, 1, &value);
+    return value;
+}
+
+// Reversed winding, matching the z flip
+static void FetchTriangle(const AccessorStream& indices, std::vector<PagedReader>& readers, uint64_t triangle, uint32_t corners[3]) {
+    corners[0] = FetchIndex(indices, readers, triangle * 3 + 0);
+    corners[1] = FetchIndex(indices, readers, triangle * 3 + 2);
+    corners[2] = FetchIndex(indices, readers, triangle * 3 + 1);
+}
+
+static std::vector<PagedReader> OpenReaders(const GltfGeometry& geometry, uint64_t cacheBytes) {
+    size_t pagesPerBuffer = (size_t)(cacheBytes / PageSize / std::max<size_t>(geometry.BufferPaths.size(), 1));
+    std::vector<PagedReader> readers;
+    readers.reserve(geometry.BufferPaths.size());
+    for (const std::string& path : geometry.BufferPaths) readers.emplace_back(path, PageSize, pagesPerBuffer);
+    return readers;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Vertex clustering, shared by the in-core and out-of-core paths so both do identical float math
+// ---------------------------------------------------------------------------------------------
+
+struct ClusterGrid {
+    Float3 Origin;
+    float CellSize = 1.0f;
+    uint32_t MaxCell = 0;
+    double PositionScale = 1.0; // Fixed-point units per unit of distance from Origin
+};
+
+static constexpr double NormalScale = 16777216.0; // 2^24
+static constexpr double UvScale = 1048576.0;      // 2^20
+
+static ClusterGrid MakeGrid(const Aabb& bounds, const MeshStreamSettings& settings) {
+    ClusterGrid grid;
+    grid.Origin = bounds.Min;
+    Float3 size = bounds.Max - bounds.Min;
+    float extent = std::max(std::max(size.x, size.y), std::max(size.z, 1e-6f));
+    float cells = settings.GridResolution > 0 ? (float)settings.GridResolution : 1.0f / std::max(settings.WeldTolerance, 1e-6f);
+    // Keys pack 21 bits per axis
+    grid.MaxCell = (1u << 21) - 1;
+    grid.CellSize = extent / std::min(cells, (float)(grid.MaxCell - 1));
+    grid.PositionScale = NormalScale / extent;
+    return grid;
+}
+
+static uint64_t CellKey(const ClusterGrid& grid, const float* vertex) {
+    uint64_t key = 0;
+    const float origin[3] = { grid.Origin.x, grid.Origin.y, grid.Origin.z };
+    for (int c = 0; c < 3; c++) {
+        float cell = (vertex[c] - origin[c]) / grid.CellSize;
+        uint64_t coordinate = cell <= 0.0f ? 0 : std::min((uint64_t)cell, (uint64_t)grid.MaxCell);
+        key |= coordinate << (21 * c);
+    }
+    return key;
+}
+
+// Fixed-point corner sums: integer addition is associative, so the order corners arrive in
+// (chunk by chunk, or all at once) cannot change the result
+struct CellSum {
+    int64_t Sum[MeshArrays::VertexStride] = {};
+    uint32_t Count = 0;
+    uint32_t Index = 0;
+};
+
+// 'corners' corners at the same vertex
+static void Accumulate(const ClusterGrid& grid, const float* vertex, CellSum& cell, uint32_t corners = 1) {
+    const float origin[3] = { grid.Origin.x, grid.Origin.y, grid.Origin.z };
+    for (int c = 0; c < 3; c++) cell.Sum[c] += std::llround((double)(vertex[c] - origin[c]) * grid.PositionScale) * corners;
+    for (int c = 3; c < 6; c++) cell.Sum[c] += std::llround((double)vertex[c] * NormalScale) * corners;
+    for (int c = 6; c < 8; c++) cell.Sum[c] += std::llround((double)vertex[c] * UvScale) * corners;
+    cell.Count += corners;
+}
+
+static void ResolveCell(const ClusterGrid& grid, const CellSum& cell, float* vertex) {
+    const double origin[3] = { grid.Origin.x, grid.Origin.y, grid.Origin.z };
+    double count = (double)cell.Count;
+    for (int c = 0; c < 3; c++) vertex[c] = (float)(origin[c] + cell.Sum[c] / count / grid.PositionScale);
+    Float3 normal((float)(cell.Sum[3] / count / NormalScale), (float)(cell.Sum[4] / count / NormalScale),
+                  (float)(cell.Sum[5] / count / NormalScale));
+    normal = Length(normal) > 1e-8f ? Normalize(normal) : Float3(0.0f, 1.0f, 0.0f);
+    vertex[3] = normal.x; vertex[4] = normal.y; vertex[5] = normal.z;
+    for (int c = 6; c < 8; c++) vertex[c] = (float)(cell.Sum[c] / count / UvScale);
+}
+
+// Cells get their vertex index in key order, which is independent of how corners arrived
+static std::vector<std::pair<uint64_t, CellSum*>> NumberCells(std::unordered_map<uint64_t, CellSum>& cells) {
+    std::vector<std::pair<uint64_t, CellSum*>> ordered;
+    ordered.reserve(cells.size());
+    for (auto& cell : cells) ordered.push_back({ cell.first, &cell.second });
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (size_t i = 0; i < ordered.size(); i++) ordered[i].second->Index = (uint32_t)i;
+    return ordered;
+}
+
+// Triangle identity for duplicate removal, and the form triangles are written in: rotated so the
+// smallest index leads (winding kept), so whichever duplicate survives the output is the same
+struct TriangleKey {
+    uint32_t V[3];
+    uint32_t Material;
+
+    bool operator==(const TriangleKey& o) const {
+        return V[0] == o.V[0] && V[1] == o.V[1] && V[2] == o.V[2] && Material == o.Material;
+    }
+};
+
+struct TriangleKeyHash {
+    size_t operator()(const TriangleKey& k) const {
+        static_assert(sizeof(TriangleKey) == 16, "hashed as four words");
+        return (size_t)HashWords(HashSeed, &k, sizeof(k));
+    }
+};
+
+static TriangleKey MakeTriangleKey(const uint32_t v[3], uint32_t material) {
+    int first = v[0] <= v[1] && v[0] <= v[2] ? 0 : (v[1] <= v[2] ? 1 : 2);
+    return { { v[first], v[(first + 1) % 3], v[(first + 2) % 3] }, material };
+}
+
+// One side of an edge: triangle 'Triangle' has undirected edge 'Edge' in adjacency slot
+// 'Slot' (0..2), and 'Opposite' is its third vertex
+struct EdgeUse {
+    uint64_t Edge;
+    uint64_t Triangle;
+    uint32_t Slot;
+    uint32_t Opposite;
+
+    bool operator<(const EdgeUse& o) const { return Edge != o.Edge ? Edge < o.Edge : Triangle < o.Triangle; }
+};
+
+static void CollectEdges(const uint32_t* indices, size_t triangleCount, uint64_t firstTriangle, std::vector<EdgeUse>& edges) {
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t* v = indices + t * 3;
+        for (uint32_t e = 0; e < 3; e++) {
+            uint32_t a = v[e], b = v[(e + 1) % 3];
+            uint64_t edge = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+            edges.push_back({ edge, firstTriangle + t, e, v[(e + 2) % 3] });
+        }
+    }
+}
+
+// For every use in a group sharing one edge, the neighbour is the smallest opposite vertex of
+// the other triangles. Unlike "first triangle found" this does not depend on triangle order.
+template <typename Fn>
+static void ResolveEdgeGroup(const EdgeUse* begin, const EdgeUse* end, Fn&& setNeighbour) {
+    // Smallest and second smallest opposite, so each use can skip its own triangle in O(1)
+    const EdgeUse* best = nullptr;
+    const EdgeUse* second = nullptr;
+    for (const EdgeUse* use = begin; use != end; use++) {
+        if (!best || use->Opposite < best->Opposite) {
+            second = best;
+            best = use;
+        } else if (!second || use->Opposite < second->Opposite) {
+            second = use;
+        }
+    }
+    for (const EdgeUse* use = begin; use != end; use++) {
+        const EdgeUse* other = use == best ? second : best;
+        if (other) setNeighbour(*use, other->Opposite);
+    }
+}
+
+// Border edges point back at the slot's own first vertex, as in GeometryGen::GenerateAdjacency
+static void DefaultAdjacency(const uint32_t* indices, size_t triangleCount, uint32_t* adjacency) {
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int e = 0; e < 3; e++) {
+            adjacency[t * 6 + e * 2] = indices[t * 3 + e];
+            adjacency[t * 6 + e * 2 + 1] = indices[t * 3 + e];
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+
+bool MeshStreamer::Describe(const std::string& gltfPath, MeshStreamSummary& summary) {
+    GltfGeometry geometry;
+    if (!ParseGeometry(gltfPath, geometry)) return false;
+    summary = MeshStreamSummary();
+    summary.Skinned = geometry.Skinned;
+    summary.Streamable = true;
+    for (const PrimitiveStreams& primitive : geometry.Primitives) {
+        summary.Vertices += primitive.Positions.Count;
+        summary.Triangles += primitive.TriangleCount();
+        for (const AccessorStream* stream : { &primitive.Positions, &primitive.Normals, &primitive.UVs, &primitive.Indices }) {
+            if (stream->Buffer < 0) continue;
+            if (stream->Buffer >= (int)geometry.BufferPaths.size() || geometry.BufferPaths[stream->Buffer].empty()) summary.Streamable = false;
+        }
+    }
+    return true;
+}
+
+uint64_t MeshStreamer::SourceKey(const std::string& gltfPath) const {
+    // The glTF text, the size and write time of each buffer file, and the settings
+    uint64_t key = HashSeed;
+    std::string text;
+    ReadTextFile(gltfPath, text);
+    key = HashBytes(key, text.data(), text.size());
+
+    GltfGeometry geometry;
+    ParseGeometry(gltfPath, geometry);
+    for (const std::string& path : geometry.BufferPaths) {
+        std::error_code error;
+        uint64_t size = path.empty() ? 0 : (uint64_t)std::filesystem::file_size(path, error);
+        int64_t written = path.empty() ? 0 : (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+        key = HashBytes(key, &size, sizeof(size));
+        key = HashBytes(key, &written, sizeof(written));
+    }
+    key = HashBytes(key, &m_settings.ImportScale, sizeof(m_settings.ImportScale));
+    key = HashBytes(key, &m_settings.GridResolution, sizeof(m_settings.GridResolution));
+    key = HashBytes(key, &m_settings.WeldTolerance, sizeof(m_settings.WeldTolerance));
+    return key;
+}
+
+void MeshStreamer::TrackWorkingBytes(uint64_t bytes) {
+    m_stats.PeakWorkingBytes = std::max(m_stats.PeakWorkingBytes, bytes);
+}
+
+// A triangle in chunk files: its three output-layout vertices and material
+struct SoupTriangle {
+    float Corners[3][MeshArrays::VertexStride];
+    uint32_t Material;
+};
+
+// Rough bytes per triangle of a chunk in memory: the soup record, its cell indices,
+// adjacency, three edge uses and the output copies
+static constexpr uint64_t ChunkBytesPerTriangle = sizeof(SoupTriangle) + 3 * sizeof(EdgeUse) + 12 * sizeof(uint32_t);
+static constexpr uint32_t DensityBins = 4096;
+
+static std::string ChunkPath(const std::string& outputPath, uint32_t chunk) {
+    return outputPath + ".chunk" + std::to_string(chunk) + ".tmp";
+}
+
+bool MeshStreamer::Process(const std::string& gltfPath, const std::string& outputPath) {
+    m_stats = MeshStreamStats();
+    GltfGeometry geometry;
+    if (!ParseGeometry(gltfPath, geometry)) return false;
+    for (const PrimitiveStreams& primitive : geometry.Primitives) {
+        for (const AccessorStream* stream : { &primitive.Positions, &primitive.Normals, &primitive.UVs, &primitive.Indices }) {
+            if (stream->Buffer >= 0 && (stream->Buffer >= (int)geometry.BufferPaths.size() || geometry.BufferPaths[stream->Buffer].empty())) {
+                return false; // Embedded buffers are in memory anyway; use the in-core loader
+            }
+        }
+    }
+
+    // An eighth of the budget caches buffer pages, another eighth buffers chunk writes, and half
+    // holds the chunk being processed
+    const uint64_t budget = std::max<uint64_t>(m_settings.MemoryBudget, 16ull << 20);
+    std::vector<PagedReader> readers = OpenReaders(geometry, budget / 8);
+    for (size_t i = 0; i < readers.size(); i++) {
+        if (!readers[i].IsOpen()) return false;
+    }
+    uint64_t cacheBytes = 0;
+    for (const PagedReader& reader : readers) cacheBytes += reader.CachedBytes();
+
+    // Pass 1: exact bounds, then triangle density along the longest axis from the positions
+    // alone (sequential reads), weighting each vertex by its primitive's triangles per vertex
+    Clock::time_point start = Clock::now();
+    Aabb bounds;
+    float vertex[MeshArrays::VertexStride];
+    for (const PrimitiveStreams& primitive : geometry.Primitives) {
+        for (uint64_t i = 0; i < primitive.Positions.Count; i++) {
+            FetchVertex(primitive, readers, i, m_settings.ImportScale, vertex);
+            bounds.Expand(Float3(vertex[0], vertex[1], vertex[2]));
+        }
+        m_stats.InputVertices += primitive.Positions.Count;
+        m_stats.InputTriangles += primitive.TriangleCount();
+    }
+    if (bounds.IsEmpty() || m_stats.InputTriangles == 0) return false;
+
+    Float3 size = bounds.Max - bounds.Min;
+    const int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+    const float axisMin = axis == 0 ? bounds.Min.x : axis == 1 ? bounds.Min.y : bounds.Min.z;
+    const float axisExtent = std::max(axis == 0 ? size.x : axis == 1 ? size.y : size.z, 1e-6f);
+    auto densityBin = [&](float coordinate) {
+        return std::min((uint32_t)std::max((coordinate - axisMin) / axisExtent * DensityBins, 0.0f), DensityBins - 1);
+    };
+
+    std::vector<double> density(DensityBins, 0.0);
+    for (const PrimitiveStreams& primitive : geometry.Primitives) {
+        double weight = primitive.Positions.Count > 0 ? (double)primitive.TriangleCount() / primitive.Positions.Count : 0.0;
+        for (uint64_t i = 0; i < primitive.Positions.Count; i++) {
+            FetchVertex(primitive, readers, i, m_settings.ImportScale, vertex);
+            density[densityBin(vertex[axis])] += weight;
+        }
+    }
+
+    // Slabs of about equal triangle count, each small enough for half the budget
+    const uint64_t trianglesPerChunk = std::max<uint64_t>(budget / 2 / ChunkBytesPerTriangle, 1024);
+    const uint32_t targetChunks = (uint32_t)((m_stats.InputTriangles + trianglesPerChunk - 1) / trianglesPerChunk);
+    std::vector<uint32_t> binToChunk(DensityBins);
+    double total = 0.0, accumulated = 0.0;
+    for (double d : density) total += d;
+    uint32_t chunk = 0;
+    for (uint32_t bin = 0; bin < DensityBins; bin++) {
+        binToChunk[bin] = chunk;
+        accumulated += density[bin];
+        if (chunk + 1 < targetChunks && accumulated >= total * (chunk + 1) / targetChunks) chunk++;
+    }
+    const uint32_t chunkCount = binToChunk.back() + 1;
+    m_stats.Chunks = chunkCount;
+    m_stats.ScanMs = MillisecondsSince(start);
+
+    // Pass 2: triangles into chunk files by centroid
+    start = Clock::now();
+    const size_t bufferTriangles = (size_t)std::clamp<uint64_t>(budget / 8 / chunkCount / sizeof(SoupTriangle), 16, 4096);
+    std::vector<std::vector<SoupTriangle>> buffers(chunkCount);
+    std::vector<uint64_t> chunkTriangles(chunkCount, 0);
+    for (uint32_t c = 0; c < chunkCount; c++) std::remove(ChunkPath(outputPath, c).c_str());
+    bool writeFailed = false;
+    auto flush = [&](uint32_t c) {
+        if (buffers[c].empty()) return;
+        std::ofstream file(ChunkPath(outputPath, c), std::ios::binary | std::ios::app);
+        file.write(reinterpret_cast<const char*>(buffers[c].data()), buffers[c].size() * sizeof(SoupTriangle));
+        if (!file) writeFailed = true;
+        chunkTriangles[c] += buffers[c].size();
+        buffers[c].clear();
+    };
+    TrackWorkingBytes(cacheBytes + (uint64_t)chunkCount * bufferTriangles * sizeof(SoupTriangle));
+
+    for (const PrimitiveStreams& primitive : geometry.Primitives) {
+        for (uint64_t t = 0; t < primitive.TriangleCount(); t++) {
+            uint32_t corners[3];
+            FetchTriangle(primitive.Indices, readers, t, corners);
+            SoupTriangle triangle;
+            for (int k = 0; k < 3; k++) FetchVertex(primitive, readers, corners[k], m_settings.ImportScale, triangle.Corners[k]);
+            triangle.Material = primitive.Material;
+
+            float centroid = (triangle.Corners[0][axis] + triangle.Corners[1][axis] + triangle.Corners[2][axis]) / 3.0f;
+            uint32_t c = binToChunk[densityBin(centroid)];
+            if (buffers[c].capacity() < bufferTriangles) buffers[c].reserve(bufferTriangles);
+            buffers[c].push_back(triangle);
+            if (buffers[c].size() == bufferTriangles) flush(c);
+        }
+    }
+    for (uint32_t c = 0; c < chunkCount; c++) {
+        flush(c);
+        buffers[c] = std::vector<SoupTriangle>();
+    }
+    readers.clear();
+    m_stats.BucketMs = MillisecondsSince(start);
+    if (writeFailed) return false;
+
+    // Pass 3: corner sums per cell, streaming each chunk file in blocks; then the vertices
+    start = Clock::now();
+    const ClusterGrid grid = MakeGrid(bounds, m_settings);
+    std::unordered_map<uint64_t, CellSum> cells;
+    std::vector<SoupTriangle> block(bufferTriangles);
+    for (uint32_t c = 0; c < chunkCount; c++) {
+        std::ifstream file(ChunkPath(outputPath, c), std::ios::binary);
+        while (file.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(SoupTriangle)) || file.gcount() > 0) {
+            size_t count = (size_t)file.gcount() / sizeof(SoupTriangle);
+            for (size_t t = 0; t < count; t++) {
+                for (int k = 0; k < 3; k++) Accumulate(grid, block[t].Corners[k], cells[CellKey(grid, block[t].Corners[k])]);
+            }
+        }
+    }
+
+    MeshFileWriter writer;
+    if (!writer.Open(outputPath, MeshFileHeader::HasAdjacency | MeshFileHeader::HasMaterials | MeshFileHeader::Compressed)) return false;
+    Aabb outputBounds;
+    {
+        std::vector<std::pair<uint64_t, CellSum*>> ordered = NumberCells(cells);
+        std::vector<float> vertices;
+        vertices.reserve(4096 * MeshArrays::VertexStride);
+        for (size_t i = 0; i < ordered.size(); i++) {
+            vertices.resize(vertices.size() + MeshArrays::VertexStride);
+            float* v = &vertices[vertices.size() - MeshArrays::VertexStride];
+            ResolveCell(grid, *ordered[i].second, v);
+            outputBounds.Expand(Float3(v[0], v[1], v[2]));
+            if (vertices.size() == vertices.capacity() || i + 1 == ordered.size()) {
+                writer.AppendVertices(vertices.data(), vertices.size() / MeshArrays::VertexStride);
+                vertices.clear();
+            }
+        }
+    }
+    m_stats.OutputVertices = writer.VertexCount();
+    m_stats.ClusterMs = MillisecondsSince(start);
+
+    // Pass 4: per chunk, remap corners to cell vertices, drop degenerates and duplicates, and
+    // build adjacency. Edges used by a single triangle of the chunk wait for stitching.
+    start = Clock::now();
+    std::unordered_set<TriangleKey, TriangleKeyHash> emitted;
+    std::vector<EdgeUse> openEdges;
+    std::vector<SoupTriangle> soup;
+    std::vector<uint32_t> indices, adjacency, materials;
+    std::vector<EdgeUse> edges;
+    for (uint32_t c = 0; c < chunkCount; c++) {
+        soup.resize(chunkTriangles[c]);
+        std::ifstream file(ChunkPath(outputPath, c), std::ios::binary);
+        file.read(reinterpret_cast<char*>(soup.data()), soup.size() * sizeof(SoupTriangle));
+        file.close();
+        std::remove(ChunkPath(outputPath, c).c_str());
+
+        indices.clear();
+        materials.clear();
+        for (const SoupTriangle& triangle : soup) {
+            uint32_t v[3];
+            for (int k = 0; k < 3; k++) v[k] = cells[CellKey(grid, triangle.Corners[k])].Index;
+            if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0]) {
+                m_stats.DegenerateTriangles++;
+                continue;
+            }
+            TriangleKey key = MakeTriangleKey(v, triangle.Material);
+            if (!emitted.insert(key).second) {
+                m_stats.DuplicateTriangles++;
+                continue;
+            }
+            indices.insert(indices.end(), key.V, key.V + 3);
+            materials.push_back(triangle.Material);
+        }
+
+        const size_t triangleCount = materials.size();
+        const uint64_t firstTriangle = writer.TriangleCount();
+        adjacency.resize(triangleCount * 6);
+        DefaultAdjacency(indices.data(), triangleCount, adjacency.data());
+        edges.clear();
+        CollectEdges(indices.data(), triangleCount, firstTriangle, edges);
+        std::sort(edges.begin(), edges.end());
+        for (size_t begin = 0, end; begin < edges.size(); begin = end) {
+            for (end = begin + 1; end < edges.size() && edges[end].Edge == edges[begin].Edge; end++) {}
+            if (end - begin == 1) {
+                openEdges.push_back(edges[begin]);
+                continue;
+            }
+            ResolveEdgeGroup(&edges[begin], &edges[end], [&](const EdgeUse& use, uint32_t neighbour) {
+                adjacency[(use.Triangle - firstTriangle) * 6 + use.Slot * 2 + 1] = neighbour;
+            });
+        }
+        writer.AppendTriangles(indices.data(), adjacency.data(), materials.data(), triangleCount);
+
+        TrackWorkingBytes(soup.capacity() * sizeof(SoupTriangle) + edges.capacity() * sizeof(EdgeUse) +
+                          (indices.capacity() + adjacency.capacity() + materials.capacity()) * sizeof(uint32_t) +
+                          openEdges.capacity() * sizeof(EdgeUse));
+        soup = std::vector<SoupTriangle>();
+    }
+    m_stats.OutputTriangles = writer.TriangleCount();
+    m_stats.OutputStateBytes = cells.size() * (sizeof(uint64_t) + sizeof(CellSum) + 2 * sizeof(void*)) +
+                               emitted.size() * (sizeof(TriangleKey) + 2 * sizeof(void*));
+    m_stats.TriangleMs = MillisecondsSince(start);
+
+    // Pass 5: stitch the open edges across chunks
+    start = Clock::now();
+    std::sort(openEdges.begin(), openEdges.end());
+    for (size_t begin = 0, end; begin < openEdges.size(); begin = end) {
+        for (end = begin + 1; end < openEdges.size() && openEdges[end].Edge == openEdges[begin].Edge; end++) {}
+        if (end - begin == 1) continue;
+        m_stats.StitchedEdges++;
+        ResolveEdgeGroup(&openEdges[begin], &openEdges[end], [&](const EdgeUse& use, uint32_t neighbour) {
+            writer.PatchAdjacency(use.Triangle, use.Slot * 2 + 1, neighbour);
+        });
+    }
+    m_stats.StitchMs = MillisecondsSince(start);
+
+    return writer.Finish(SourceKey(gltfPath), outputBounds);
+}
+
+void MeshStreamer::LoadInCore(const std::string& gltfPath, const MeshStreamSettings& settings, MeshArrays& mesh) {
+    mesh = MeshArrays();
+    GltfGeometry geometry;
+    if (!ParseGeometry(gltfPath, geometry)) return;
+    std::vector<PagedReader> readers = OpenReaders(geometry, 64ull << 20);
+
+    for (const PrimitiveStreams& primitive : geometry.Primitives) {
+        uint32_t vertexOffset = (uint32_t)mesh.VertexCount();
+        mesh.Vertices.resize(mesh.Vertices.size() + primitive.Positions.Count * MeshArrays::VertexStride);
+        for (uint64_t i = 0; i < primitive.Positions.Count; i++) {
+            FetchVertex(primitive, readers, i, settings.ImportScale, &mesh.Vertices[(vertexOffset + i) * MeshArrays::VertexStride]);
+        }
+        for (uint64_t t = 0; t < primitive.TriangleCount(); t++) {
+            uint32_t corners[3];
+            FetchTriangle(primitive.Indices, readers, t, corners);
+            for (uint32_t corner : corners) mesh.Indices.push_back(vertexOffset + corner);
+            mesh.TriangleMaterials.push_back(primitive.Material);
+        }
+    }
+}
+
+void MeshStreamer::ProcessInCore(const MeshArrays& input, const MeshStreamSettings& settings, MeshArrays& output,
+                                 std::vector<uint32_t>* vertexRemap) {
+    output = MeshArrays();
+    if (vertexRemap) vertexRemap->assign(input.VertexCount(), UINT32_MAX);
+    Aabb bounds = ComputeBounds(input.Vertices.data(), input.VertexCount(), MeshArrays::VertexStride);
+    if (bounds.IsEmpty()) return;
+    const ClusterGrid grid = MakeGrid(bounds, settings);
+    const bool hasMaterials = input.TriangleMaterials.size() == input.TriangleCount();
+
+    // Every corner of a vertex lands in the same cell, so each vertex is looked up once and
+    // accumulated once per corner using it: the same fixed-point sums as corner by corner
+    const size_t vertexCount = input.VertexCount();
+    std::vector<uint32_t> corners(vertexCount, 0);
+    for (uint32_t index : input.Indices) corners[index]++;
+    std::unordered_map<uint64_t, CellSum> cells;
+    std::vector<CellSum*> vertexCells(vertexCount, nullptr);
+    for (size_t i = 0; i < vertexCount; i++) {
+        if (corners[i] == 0) continue;
+        const float* v = &input.Vertices[i * MeshArrays::VertexStride];
+        vertexCells[i] = &cells[CellKey(grid, v)];
+        Accumulate(grid, v, *vertexCells[i], corners[i]);
+    }
+    std::vector<std::pair<uint64_t, CellSum*>> ordered = NumberCells(cells);
+    output.Vertices.resize(ordered.size() * MeshArrays::VertexStride);
+    for (size_t i = 0; i < ordered.size(); i++) ResolveCell(grid, *ordered[i].second, &output.Vertices[i * MeshArrays::VertexStride]);
+    if (vertexRemap) {
+        for (size_t i = 0; i < vertexCount; i++) {
+            if (vertexCells[i]) (*vertexRemap)[i] = vertexCells[i]->Index;
+        }
+    }
+
+    std::unordered_set<TriangleKey, TriangleKeyHash> emitted;
+    for (size_t t = 0; t < input.TriangleCount(); t++) {
+        uint32_t v[3];
+        for (int k = 0; k < 3; k++) v[k] = vertexCells[input.Indices[t * 3 + k]]->Index;
+        uint32_t material = hasMaterials ? input.TriangleMaterials[t] : UINT32_MAX;
+        if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0]) continue;
+        TriangleKey key = MakeTriangleKey(v, material);
+        if (!emitted.insert(key).second) continue;
+        output.Indices.insert(output.Indices.end(), key.V, key.V + 3);
+        output.TriangleMaterials.push_back(material);
+    }
+
+    const size_t triangleCount = output.TriangleCount();
+    output.IndicesAdj.resize(triangleCount * 6);
+    DefaultAdjacency(output.Indices.data(), triangleCount, output.IndicesAdj.data());
+    std::vector<EdgeUse> edges;
+    CollectEdges(output.Indices.data(), triangleCount, 0, edges);
+    std::sort(edges.begin(), edges.end());
+    for (size_t begin = 0, end; begin < edges.size(); begin = end) {
+        for (end = begin + 1; end < edges.size() && edges[end].Edge == edges[begin].Edge; end++) {}
+        ResolveEdgeGroup(&edges[begin], &edges[end], [&](const EdgeUse& use, uint32_t neighbour) {
+            output.IndicesAdj[use.Triangle * 6 + use.Slot * 2 + 1] = neighbour;
+        });
+    }
+}
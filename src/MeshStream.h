@@ -0,0 +1,80 @@
+#pragma once
+#include "MeshFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Out-of-core geometry for meshes larger than memory: glTF triangles are streamed from the
+// buffer files through a small page cache, bucketed by position into spatial chunks on disk,
+// then welded and simplified chunk by chunk and written progressively into a .pmesh.
+//
+// Welding and simplification are one vertex-clustering step on a global grid: every corner
+// falling into a cell merges into that cell's vertex, placed at the mean of its corners. The
+// sums are fixed point, so a cell split across chunks gets exactly the value it would get in
+// core. Triangles whose corners collapse into fewer than three cells are dropped, as are
+// duplicates. Adjacency is built per chunk; edges with a single triangle in their chunk are
+// stitched across chunks at the end. Memory is bounded by the budget for everything that
+// scales with the input; the cell table and the duplicate filter scale with the output.
+
+struct MeshStreamSettings {
+    uint64_t MemoryBudget = 256ull << 20;
+    float ImportScale = 1.0f;      // Applied to positions; z is also flipped to left-handed
+    uint32_t GridResolution = 0;   // Cells along the longest axis; 0 only welds
+    float WeldTolerance = 1e-5f;   // Cell size when only welding, relative to the longest axis
+};
+
+struct MeshStreamStats {
+    uint64_t InputVertices = 0;
+    uint64_t InputTriangles = 0;
+    uint64_t OutputVertices = 0;
+    uint64_t OutputTriangles = 0;
+    uint64_t DegenerateTriangles = 0; // Collapsed by clustering
+    uint64_t DuplicateTriangles = 0;
+    uint64_t StitchedEdges = 0;       // Edges resolved across chunks
+    uint32_t Chunks = 0;
+    uint64_t PeakWorkingBytes = 0;    // Largest input-scaled working set (page cache, buffers, one chunk)
+    uint64_t OutputStateBytes = 0;    // Cell table and duplicate filter
+    double ScanMs = 0.0;     // Bounds and density pass
+    double BucketMs = 0.0;   // Triangles to chunk files
+    double ClusterMs = 0.0;  // Cell accumulation and vertex output
+    double TriangleMs = 0.0; // Remap, adjacency and triangle output
+    double StitchMs = 0.0;
+};
+
+// Sizes of a glTF's geometry, read from the JSON alone
+struct MeshStreamSummary {
+    uint64_t Vertices = 0;
+    uint64_t Triangles = 0;
+    bool Skinned = false;
+    bool Streamable = false; // Every buffer is an external file
+};
+
+class MeshStreamer {
+public:
+    explicit MeshStreamer(const MeshStreamSettings& settings) : m_settings(settings) {}
+
+    static bool Describe(const std::string& gltfPath, MeshStreamSummary& summary);
+
+    // Key of the input files and settings; Process stores it in the .pmesh header so callers
+    // can tell whether a cached file is still current
+    uint64_t SourceKey(const std::string& gltfPath) const;
+
+    // Out of core: glTF -> .pmesh with adjacency and materials. Temporaries go next to 'outputPath'.
+    bool Process(const std::string& gltfPath, const std::string& outputPath);
+
+    // Reference path on a mesh already in memory (same import as Process), giving the same
+    // vertices and the same set of triangles and adjacency
+    static void LoadInCore(const std::string& gltfPath, const MeshStreamSettings& settings, MeshArrays& mesh);
+    // 'vertexRemap', if given, receives the output vertex of every input vertex (UINT32_MAX for
+    // vertices no triangle uses), e.g. to follow the input through skinning.
+    static void ProcessInCore(const MeshArrays& input, const MeshStreamSettings& settings, MeshArrays& output,
+                              std::vector<uint32_t>* vertexRemap = nullptr);
+
+    const MeshStreamStats& Stats() const { return m_stats; }
+
+private:
+    void TrackWorkingBytes(uint64_t bytes);
+
+    MeshStreamSettings m_settings;
+    MeshStreamStats m_stats;
+};
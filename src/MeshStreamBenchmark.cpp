@@ -0,0 +1,185 @@
+// Headless out-of-core mesh benchmark: writes a tiled terrain glTF (every tile has its own
+// vertices, so seams must be welded; two materials) straight to disk, streams it into a .pmesh
+// under a memory cap, then runs the in-core reference on the same input and checks that both
+// give identical vertices, triangles, adjacency and materials. Peak RSS is sampled after each
+// path; the streamed path runs first so its peak is not inflated by the reference.
+// Usage: PelageMeshStreamBench [quads per side] [grid resolution] [budget MB]
+#include "BenchReport.h"
+#include "MeshStream.h"
+#include "Timing.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+static constexpr uint32_t TileQuads = 64;
+
+static float Height(float x, float z) {
+    return 0.08f * std::sin(x * 7.0f) * std::cos(z * 5.0f) + 0.02f * std::sin(x * 31.0f + z * 17.0f);
+}
+
+// Terrain over [0,1]^2 in tiles of TileQuads^2 quads; tiles alternate between two primitives.
+// Written a tile at a time, so generating it does not touch the RSS being measured.
+static bool WriteTerrain(const std::string& directory, uint32_t quads) {
+    const uint32_t tiles = std::max(quads / TileQuads, 1u);
+    const uint32_t tileVertices = (TileQuads + 1) * (TileQuads + 1);
+    const uint32_t tileTriangles = TileQuads * TileQuads * 2;
+    const float step = 1.0f / (tiles * TileQuads);
+
+    struct Primitive { uint32_t Tiles = 0; };
+    std::array<Primitive, 2> primitives;
+    for (uint32_t t = 0; t < tiles * tiles; t++) primitives[t % 2].Tiles++;
+
+    // Layout per primitive: positions, normals, uvs, indices, each a contiguous block
+    std::ofstream bin(directory + "/terrain.bin", std::ios::binary | std::ios::trunc);
+    uint64_t offsets[2][4];
+    uint64_t cursor = 0;
+    for (int p = 0; p < 2; p++) {
+        uint64_t vertices = (uint64_t)primitives[p].Tiles * tileVertices;
+        offsets[p][0] = cursor; cursor += vertices * 12;
+        offsets[p][1] = cursor; cursor += vertices * 12;
+        offsets[p][2] = cursor; cursor += vertices * 8;
+        offsets[p][3] = cursor; cursor += (uint64_t)primitives[p].Tiles * tileTriangles * 12;
+    }
+
+    std::vector<float> positions, normals, uvs;
+    std::vector<uint32_t> indices;
+    std::array<uint32_t, 2> written = { 0, 0 };
+    for (uint32_t t = 0; t < tiles * tiles; t++) {
+        int p = t % 2;
+        uint32_t tx = t % tiles, tz = t / tiles;
+        uint32_t base = written[p] * tileVertices;
+        positions.clear(); normals.clear(); uvs.clear(); indices.clear();
+        for (uint32_t z = 0; z <= TileQuads; z++) {
+            for (uint32_t x = 0; x <= TileQuads; x++) {
+                float px = (tx * TileQuads + x) * step, pz = (tz * TileQuads + z) * step;
+                float h = Height(px, pz);
+                Float3 normal = Normalize(Float3(Height(px - step, pz) - Height(px + step, pz), 2.0f * step,
+                                                 Height(px, pz - step) - Height(px, pz + step)));
+                positions.insert(positions.end(), { px, h, pz });
+                normals.insert(normals.end(), { normal.x, normal.y, normal.z });
+                uvs.insert(uvs.end(), { px, pz });
+            }
+        }
+        for (uint32_t z = 0; z < TileQuads; z++) {
+            for (uint32_t x = 0; x < TileQuads; x++) {
+                uint32_t i0 = base + z * (TileQuads + 1) + x, i1 = i0 + 1, i2 = i0 + TileQuads + 1, i3 = i2 + 1;
+                indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+            }
+        }
+        auto put = [&](int stream, uint64_t elementBytes, const void* data, size_t bytes) {
+            bin.seekp((std::streamoff)(offsets[p][stream] + written[p] * elementBytes));
+            bin.write(static_cast<const char*>(data), (std::streamsize)bytes);
+        };
+        put(0, tileVertices * 12ull, positions.data(), positions.size() * 4);
+        put(1, tileVertices * 12ull, normals.data(), normals.size() * 4);
+        put(2, tileVertices * 8ull, uvs.data(), uvs.size() * 4);
+        put(3, tileTriangles * 12ull, indices.data(), indices.size() * 4);
+        written[p]++;
+    }
+    if (!bin) return false;
+
+    std::ofstream gltf(directory + "/terrain.gltf", std::ios::trunc);
+    gltf << "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"uri\":\"terrain.bin\",\"byteLength\":" << cursor << "}],";
+    gltf << "\"bufferViews\":[";
+    const char* types[4] = { "VEC3", "VEC3", "VEC2", "SCALAR" };
+    const uint32_t componentTypes[4] = { 5126, 5126, 5126, 5125 };
+    for (int p = 0; p < 2; p++) {
+        uint64_t vertices = (uint64_t)primitives[p].Tiles * tileVertices;
+        uint64_t counts[4] = { vertices, vertices, vertices, (uint64_t)primitives[p].Tiles * tileTriangles * 3 };
+        uint64_t sizes[4] = { vertices * 12, vertices * 12, vertices * 8, counts[3] * 4 };
+        for (int s = 0; s < 4; s++) {
+            gltf << (p + s ? "," : "") << "{\"buffer\":0,\"byteOffset\":" << offsets[p][s] << ",\"byteLength\":" << sizes[s] << "}";
+        }
+    }
+    gltf << "],\"accessors\":[";
+    for (int p = 0; p < 2; p++) {
+        uint64_t vertices = (uint64_t)primitives[p].Tiles * tileVertices;
+        uint64_t counts[4] = { vertices, vertices, vertices, (uint64_t)primitives[p].Tiles * tileTriangles * 3 };
+        for (int s = 0; s < 4; s++) {
+            gltf << (p + s ? "," : "") << "{\"bufferView\":" << p * 4 + s << ",\"componentType\":" << componentTypes[s]
+                 << ",\"count\":" << counts[s] << ",\"type\":\"" << types[s] << "\"}";
+        }
+    }
+    gltf << "],\"materials\":[{\"name\":\"a\"},{\"name\":\"b\"}],\"meshes\":[{\"primitives\":[";
+    for (int p = 0; p < 2; p++) {
+        gltf << (p ? "," : "") << "{\"attributes\":{\"POSITION\":" << p * 4 << ",\"NORMAL\":" << p * 4 + 1
+             << ",\"TEXCOORD_0\":" << p * 4 + 2 << "},\"indices\":" << p * 4 + 3 << ",\"material\":" << p << "}";
+    }
+    gltf << "]}],\"nodes\":[{\"mesh\":0}],\"scenes\":[{\"nodes\":[0]}],\"scene\":0}";
+    return (bool)gltf;
+}
+
+// Triangles as (indices, adjacency, material) rows, sorted: the streamed file is in chunk order
+static std::vector<std::array<uint32_t, 10>> SortedTriangles(const MeshArrays& mesh) {
+    std::vector<std::array<uint32_t, 10>> rows(mesh.TriangleCount());
+    for (size_t t = 0; t < rows.size(); t++) {
+        for (int k = 0; k < 3; k++) rows[t][k] = mesh.Indices[t * 3 + k];
+        for (int k = 0; k < 6; k++) rows[t][3 + k] = mesh.IndicesAdj[t * 6 + k];
+        rows[t][9] = mesh.TriangleMaterials[t];
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+int main(int argc, char** argv) {
+    uint32_t quads = argc > 1 ? (uint32_t)std::max(atoi(argv[1]), (int)TileQuads) : 1024;
+    MeshStreamSettings settings;
+    settings.GridResolution = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 0) : 512;
+    settings.MemoryBudget = (argc > 3 ? (uint64_t)std::max(atoi(argv[3]), 16) : 32) << 20;
+
+    std::string directory = (std::filesystem::temp_directory_path() / "pelage_mesh_bench").string();
+    std::filesystem::create_directories(directory);
+    if (!WriteTerrain(directory, quads)) {
+        printf("Could not write the test mesh to %s\n", directory.c_str());
+        return 1;
+    }
+    std::string gltfPath = directory + "/terrain.gltf";
+    std::string meshPath = directory + "/terrain.pmesh";
+    double baseRss = PeakRssMB();
+
+    MeshStreamSummary summary;
+    MeshStreamer::Describe(gltfPath, summary);
+    printf("Terrain %ux%u quads: %llu vertices, %llu triangles, grid %u, budget %llu MB\n", quads, quads,
+           (unsigned long long)summary.Vertices, (unsigned long long)summary.Triangles, settings.GridResolution,
+           (unsigned long long)(settings.MemoryBudget >> 20));
+
+    MeshStreamer streamer(settings);
+    Clock::time_point start = Clock::now();
+    bool streamed = streamer.Process(gltfPath, meshPath);
+    double streamMs = MillisecondsSince(start);
+    double streamRss = PeakRssMB();
+    if (!streamed) {
+        printf("Streaming failed\n");
+        return 1;
+    }
+    const MeshStreamStats& stats = streamer.Stats();
+    printf("Streamed : %8.1f ms (scan %.1f, bucket %.1f, cluster %.1f, triangles %.1f, stitch %.1f), %u chunks\n",
+           streamMs, stats.ScanMs, stats.BucketMs, stats.ClusterMs, stats.TriangleMs, stats.StitchMs, stats.Chunks);
+    printf("           %llu vertices, %llu triangles (%llu degenerate, %llu duplicate dropped), %llu stitched edges\n",
+           (unsigned long long)stats.OutputVertices, (unsigned long long)stats.OutputTriangles,
+           (unsigned long long)stats.DegenerateTriangles, (unsigned long long)stats.DuplicateTriangles,
+           (unsigned long long)stats.StitchedEdges);
+    printf("           working set %.1f MB, output state %.1f MB\n", stats.PeakWorkingBytes / (1024.0 * 1024.0),
+           stats.OutputStateBytes / (1024.0 * 1024.0));
+
+    start = Clock::now();
+    MeshArrays input, reference;
+    MeshStreamer::LoadInCore(gltfPath, settings, input);
+    MeshStreamer::ProcessInCore(input, settings, reference);
+    double inCoreMs = MillisecondsSince(start);
+    double inCoreRss = PeakRssMB();
+    printf("In core  : %8.1f ms, %zu vertices, %zu triangles\n", inCoreMs, reference.VertexCount(), reference.TriangleCount());
+
+    MeshArrays loaded;
+    bool identical = MeshFile::Read(meshPath, loaded) && loaded.Vertices == reference.Vertices &&
+                     SortedTriangles(loaded) == SortedTriangles(reference);
+    printf("Identical: %s\n", identical ? "yes" : "NO");
+    printf("Peak RSS : %.1f MB before, %.1f MB after streaming, %.1f MB after in-core\n", baseRss, streamRss, inCoreRss);
+
+    std::filesystem::remove_all(directory);
+    return identical ? 0 : 1;
+}
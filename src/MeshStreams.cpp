@@ -0,0 +1,212 @@
+#include "MeshStreams.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+
+// Below this squared length a summed normal is treated as cancelled out
+static constexpr float MinNormalLengthSq = 1e-30f;
+
+void MeshStreams::Resize(size_t count) {
+    Count = count;
+    const size_t padded = Padded();
+    for (Stream* stream : { &PosX, &PosY, &PosZ, &NormalX, &NormalY, &NormalZ }) stream->assign(padded, 0.0f);
+    UV.assign(padded * 2, 0.0f);
+}
+
+void MeshStreams::Load(const float* vertices, size_t count, size_t stride) {
+    Resize(count);
+    size_t i = 0;
+#if PELAGE_SSE2
+    // Four vertices at a time: their first halves transpose into px, py, pz, nx and their second
+    // halves into ny, nz, u, v
+    for (; i + Lanes <= count; i += Lanes) {
+        const float* v = vertices + i * stride;
+        __m128 a0 = _mm_loadu_ps(v), a1 = _mm_loadu_ps(v + stride), a2 = _mm_loadu_ps(v + 2 * stride), a3 = _mm_loadu_ps(v + 3 * stride);
+        __m128 b0 = _mm_loadu_ps(v + 4), b1 = _mm_loadu_ps(v + stride + 4), b2 = _mm_loadu_ps(v + 2 * stride + 4),
+               b3 = _mm_loadu_ps(v + 3 * stride + 4);
+        _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+        _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+        _mm_store_ps(PosX.data() + i, a0);
+        _mm_store_ps(PosY.data() + i, a1);
+        _mm_store_ps(PosZ.data() + i, a2);
+        _mm_store_ps(NormalX.data() + i, a3);
+        _mm_store_ps(NormalY.data() + i, b0);
+        _mm_store_ps(NormalZ.data() + i, b1);
+        _mm_store_ps(UV.data() + i * 2, _mm_unpacklo_ps(b2, b3));
+        _mm_store_ps(UV.data() + i * 2 + 4, _mm_unpackhi_ps(b2, b3));
+    }
+#endif
+    for (; i < count; i++) {
+        const float* v = vertices + i * stride;
+        PosX[i] = v[0];
+        PosY[i] = v[1];
+        PosZ[i] = v[2];
+        NormalX[i] = v[3];
+        NormalY[i] = v[4];
+        NormalZ[i] = v[5];
+        UV[i * 2] = v[6];
+        UV[i * 2 + 1] = v[7];
+    }
+}
+
+void MeshStreams::Store(float* vertices, size_t stride) const {
+    size_t i = 0;
+#if PELAGE_SSE2
+    for (; i + Lanes <= Count; i += Lanes) {
+        __m128 a0 = _mm_load_ps(PosX.data() + i), a1 = _mm_load_ps(PosY.data() + i), a2 = _mm_load_ps(PosZ.data() + i),
+               a3 = _mm_load_ps(NormalX.data() + i);
+        const __m128 uv0 = _mm_load_ps(UV.data() + i * 2), uv1 = _mm_load_ps(UV.data() + i * 2 + 4);
+        __m128 b0 = _mm_load_ps(NormalY.data() + i), b1 = _mm_load_ps(NormalZ.data() + i),
+               b2 = _mm_shuffle_ps(uv0, uv1, _MM_SHUFFLE(2, 0, 2, 0)), b3 = _mm_shuffle_ps(uv0, uv1, _MM_SHUFFLE(3, 1, 3, 1));
+        _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+        _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+        float* v = vertices + i * stride;
+        _mm_storeu_ps(v, a0);
+        _mm_storeu_ps(v + 4, b0);
+        _mm_storeu_ps(v + stride, a1);
+        _mm_storeu_ps(v + stride + 4, b1);
+        _mm_storeu_ps(v + 2 * stride, a2);
+        _mm_storeu_ps(v + 2 * stride + 4, b2);
+        _mm_storeu_ps(v + 3 * stride, a3);
+        _mm_storeu_ps(v + 3 * stride + 4, b3);
+    }
+#endif
+    for (; i < Count; i++) {
+        float* v = vertices + i * stride;
+        v[0] = PosX[i];
+        v[1] = PosY[i];
+        v[2] = PosZ[i];
+        v[3] = NormalX[i];
+        v[4] = NormalY[i];
+        v[5] = NormalZ[i];
+        v[6] = UV[i * 2];
+        v[7] = UV[i * 2 + 1];
+    }
+}
+
+Aabb MeshKernels::Bounds(const Float3Streams& positions) {
+    Aabb bounds;
+    if (positions.Count == 0) return bounds;
+    size_t i = 0;
+#if PELAGE_SSE2
+    if (positions.Count >= MeshStreams::Lanes) {
+        __m128 minX = _mm_load_ps(positions.X), minY = _mm_load_ps(positions.Y), minZ = _mm_load_ps(positions.Z);
+        __m128 maxX = minX, maxY = minY, maxZ = minZ;
+        for (i = MeshStreams::Lanes; i + MeshStreams::Lanes <= positions.Count; i += MeshStreams::Lanes) {
+            const __m128 x = _mm_load_ps(positions.X + i), y = _mm_load_ps(positions.Y + i), z = _mm_load_ps(positions.Z + i);
+            minX = _mm_min_ps(minX, x);
+            minY = _mm_min_ps(minY, y);
+            minZ = _mm_min_ps(minZ, z);
+            maxX = _mm_max_ps(maxX, x);
+            maxY = _mm_max_ps(maxY, y);
+            maxZ = _mm_max_ps(maxZ, z);
+        }
+        alignas(16) float lanes[6][4];
+        _mm_store_ps(lanes[0], minX);
+        _mm_store_ps(lanes[1], minY);
+        _mm_store_ps(lanes[2], minZ);
+        _mm_store_ps(lanes[3], maxX);
+        _mm_store_ps(lanes[4], maxY);
+        _mm_store_ps(lanes[5], maxZ);
+        for (int lane = 0; lane < 4; lane++) {
+            bounds.Expand(Float3(lanes[0][lane], lanes[1][lane], lanes[2][lane]));
+            bounds.Expand(Float3(lanes[3][lane], lanes[4][lane], lanes[5][lane]));
+        }
+    }
+#endif
+    for (; i < positions.Count; i++) bounds.Expand(Float3(positions.X[i], positions.Y[i], positions.Z[i]));
+    return bounds;
+}
+
+void MeshKernels::ComputeNormals(MeshStreams& mesh, const uint32_t* indices, size_t triangleCount, uint32_t baseVertex) {
+    const size_t count = mesh.Count, padded = mesh.Padded();
+    const float* px = mesh.PosX.data();
+    const float* py = mesh.PosY.data();
+    const float* pz = mesh.PosZ.data();
+    float* nx = mesh.NormalX.data();
+    float* ny = mesh.NormalY.data();
+    float* nz = mesh.NormalZ.data();
+    std::fill(nx, nx + padded, 0.0f);
+    std::fill(ny, ny + padded, 0.0f);
+    std::fill(nz, nz + padded, 0.0f);
+
+    // Unnormalized face normals are twice the area, so larger faces weigh more
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t a = indices[t * 3] - baseVertex, b = indices[t * 3 + 1] - baseVertex, c = indices[t * 3 + 2] - baseVertex;
+        if (a >= count || b >= count || c >= count) continue;
+        const float e1x = px[b] - px[a], e1y = py[b] - py[a], e1z = pz[b] - pz[a];
+        const float e2x = px[c] - px[a], e2y = py[c] - py[a], e2z = pz[c] - pz[a];
+        const float fx = e1y * e2z - e1z * e2y, fy = e1z * e2x - e1x * e2z, fz = e1x * e2y - e1y * e2x;
+        for (uint32_t v : { a, b, c }) {
+            nx[v] += fx;
+            ny[v] += fy;
+            nz[v] += fz;
+        }
+    }
+
+    size_t i = 0;
+#if PELAGE_SSE2
+    // Elementwise, so it runs over the padding too
+    const __m128 one = _mm_set1_ps(1.0f), minLengthSq = _mm_set1_ps(MinNormalLengthSq);
+    for (; i < padded; i += MeshStreams::Lanes) {
+        const __m128 x = _mm_load_ps(nx + i), y = _mm_load_ps(ny + i), z = _mm_load_ps(nz + i);
+        const __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        const __m128 valid = _mm_cmpgt_ps(lengthSq, minLengthSq);
+        const __m128 inverse = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(lengthSq, minLengthSq)));
+        _mm_store_ps(nx + i, _mm_and_ps(valid, _mm_mul_ps(x, inverse)));
+        _mm_store_ps(ny + i, _mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(y, inverse)), _mm_andnot_ps(valid, one)));
+        _mm_store_ps(nz + i, _mm_and_ps(valid, _mm_mul_ps(z, inverse)));
+    }
+#endif
+    for (; i < padded; i++) {
+        const float lengthSq = nx[i] * nx[i] + ny[i] * ny[i] + nz[i] * nz[i];
+        if (lengthSq > MinNormalLengthSq) {
+            const float inverse = 1.0f / std::sqrt(lengthSq);
+            nx[i] *= inverse;
+            ny[i] *= inverse;
+            nz[i] *= inverse;
+        } else {
+            nx[i] = 0.0f;
+            ny[i] = 1.0f;
+            nz[i] = 0.0f;
+        }
+    }
+}
+
+void MeshKernels::ComputeNormals(float* vertices, size_t count, size_t stride, const uint32_t* indices, size_t triangleCount,
+                                 uint32_t baseVertex) {
+    for (size_t i = 0; i < count; i++) {
+        float* n = vertices + i * stride + 3;
+        n[0] = n[1] = n[2] = 0.0f;
+    }
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t a = indices[t * 3] - baseVertex, b = indices[t * 3 + 1] - baseVertex, c = indices[t * 3 + 2] - baseVertex;
+        if (a >= count || b >= count || c >= count) continue;
+        const float* pa = vertices + a * stride;
+        const float* pb = vertices + b * stride;
+        const float* pc = vertices + c * stride;
+        const float e1x = pb[0] - pa[0], e1y = pb[1] - pa[1], e1z = pb[2] - pa[2];
+        const float e2x = pc[0] - pa[0], e2y = pc[1] - pa[1], e2z = pc[2] - pa[2];
+        const float fx = e1y * e2z - e1z * e2y, fy = e1z * e2x - e1x * e2z, fz = e1x * e2y - e1y * e2x;
+        for (uint32_t v : { a, b, c }) {
+            float* n = vertices + v * stride + 3;
+            n[0] += fx;
+            n[1] += fy;
+            n[2] += fz;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        float* n = vertices + i * stride + 3;
+        const float lengthSq = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+        if (lengthSq > MinNormalLengthSq) {
+            const float inverse = 1.0f / std::sqrt(lengthSq);
+            n[0] *= inverse;
+            n[1] *= inverse;
+            n[2] *= inverse;
+        } else {
+            n[0] = 0.0f;
+            n[1] = 1.0f;
+            n[2] = 0.0f;
+        }
+    }
+}
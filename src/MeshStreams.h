@@ -0,0 +1,77 @@
+#pragma once
+#include "CoreMath.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Structure-of-arrays copy of a mesh's vertices for the CPU kernels that only touch positions or
+// normals. The GPU layout (GeometryGen's Vertex, MeshArrays::VertexStride floats) interleaves
+// position, normal and UV, so a bounds or normal pass over it drags the UVs through the cache
+// and has to shuffle every vertex into lanes. Here each coordinate is its own 64-byte aligned
+// stream, padded to whole SSE2 vectors, so kernels load four vertices per instruction and never
+// need a scalar tail. Conversion to and from the interleaved layout is a 4x4 transpose.
+
+template <typename T, size_t Alignment>
+struct AlignedAllocator {
+    using value_type = T;
+    template <typename U> struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment))); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+
+    bool operator==(const AlignedAllocator&) const { return true; }
+    bool operator!=(const AlignedAllocator&) const { return false; }
+};
+
+// Zero-copy view of three coordinate streams. Count vertices, readable up to Padded.
+struct Float3Streams {
+    const float* X = nullptr;
+    const float* Y = nullptr;
+    const float* Z = nullptr;
+    size_t Count = 0;
+    size_t Padded = 0;
+};
+
+struct MeshStreams {
+    static constexpr size_t Alignment = 64; // Each stream starts on a cache line
+    static constexpr size_t Lanes = 4;      // Streams are padded to a multiple of this
+    using Stream = std::vector<float, AlignedAllocator<float, Alignment>>;
+
+    Stream PosX, PosY, PosZ;
+    Stream NormalX, NormalY, NormalZ;
+    Stream UV; // u, v per vertex
+    size_t Count = 0;
+
+    static size_t PaddedCount(size_t count) { return (count + Lanes - 1) / Lanes * Lanes; }
+    size_t Padded() const { return PaddedCount(Count); }
+
+    // Padding is zero: elementwise kernels may run over it, reductions stop at Count
+    void Resize(size_t count);
+
+    // From 'count' vertices 'stride' floats apart (at least 8), each starting position xyz,
+    // normal xyz, uv: the GPU layout
+    void Load(const float* vertices, size_t count, size_t stride);
+    // Back into the first 8 floats of each vertex; the rest of a wider stride is left alone
+    void Store(float* vertices, size_t stride) const;
+
+    Float3Streams Positions() const { return { PosX.data(), PosY.data(), PosZ.data(), Count, Padded() }; }
+    Float3Streams Normals() const { return { NormalX.data(), NormalY.data(), NormalZ.data(), Count, Padded() }; }
+};
+
+class MeshKernels {
+public:
+    // Bounds of a position stream, four vertices per step
+    static Aabb Bounds(const Float3Streams& positions);
+
+    // Area-weighted smooth normals from 'triangleCount' triangles (vertex indices minus
+    // 'baseVertex'), with the winding GeometryGen uses: Cross(b - a, c - a) points out. Vertices
+    // no triangle reaches, or whose faces cancel out, get +Y.
+    static void ComputeNormals(MeshStreams& mesh, const uint32_t* indices, size_t triangleCount, uint32_t baseVertex = 0);
+    // The same on the interleaved layout, 'stride' floats per vertex
+    static void ComputeNormals(float* vertices, size_t count, size_t stride, const uint32_t* indices, size_t triangleCount,
+                               uint32_t baseVertex = 0);
+};
@@ -0,0 +1,207 @@
+#include "OcclusionBaker.h"
+#include "Hash.h"
+#include "Raycaster.h"
+#include "Timing.h"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
+static constexpr float Pi = 3.14159265f;
+static constexpr float ShY0 = 0.282095f; // Y00
+static constexpr float ShY1 = 0.488603f; // Y1m / w, each axis
+
+struct OcclusionCacheHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint64_t Key;
+    uint64_t VertexCount;
+};
+
+static uint64_t SplitMix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Orthonormal basis around a unit normal (Duff et al. 2017)
+static void TangentFrame(const Float3& n, Float3& t, Float3& b) {
+    float sign = std::copysign(1.0f, n.z);
+    float a = -1.0f / (sign + n.z);
+    float c = n.x * n.y * a;
+    t = Float3(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+    b = Float3(c, sign + n.y * n.y * a, -n.y);
+}
+
+float OcclusionBaker::AmbientOcclusion(const VertexOcclusion& occlusion, const Float3& normal) {
+    // Visibility convolved with the clamped cosine (band factors pi and 2pi/3), over pi
+    const float* sh = occlusion.Sh;
+    return ShY0 * sh[0] + (2.0f / 3.0f) * ShY1 * (sh[1] * normal.x + sh[2] * normal.y + sh[3] * normal.z);
+}
+
+float OcclusionBaker::Visibility(const VertexOcclusion& occlusion, const Float3& dir) {
+    const float* sh = occlusion.Sh;
+    return ShY0 * sh[0] + ShY1 * (sh[1] * dir.x + sh[2] * dir.y + sh[3] * dir.z);
+}
+
+uint64_t OcclusionBaker::Key(const float* vertices, size_t stride, size_t vertexCount, const uint32_t* indices, size_t triangleCount,
+                             const OcclusionBakeSettings& settings) {
+    // Packets only changes how the rays are traced, not the result
+    // Words: the inputs are float and index arrays
+    uint64_t hash = HashSeed;
+    hash = HashWords(hash, &CacheVersion, sizeof(CacheVersion));
+    hash = HashWords(hash, vertices, vertexCount * stride * sizeof(float));
+    hash = HashWords(hash, indices, triangleCount * 3 * sizeof(uint32_t));
+    const uint32_t words[] = { settings.RayCount, (uint32_t)settings.Directional, (uint32_t)stride };
+    hash = HashWords(hash, words, sizeof(words));
+    const float floats[] = { settings.HullOffset, settings.MaxDistance };
+    hash = HashWords(hash, floats, sizeof(floats));
+    return HashWords(hash, &settings.Seed, sizeof(settings.Seed));
+}
+
+bool OcclusionBaker::ReadCache(const std::string& path, uint64_t key, size_t vertexCount, std::vector<VertexOcclusion>& occlusion) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    OcclusionCacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if (memcmp(header.Magic, "POCC", 4) != 0 || header.Version != CacheVersion || header.Key != key || header.VertexCount != vertexCount) {
+        return false;
+    }
+    occlusion.resize(vertexCount);
+    if (!file.read(reinterpret_cast<char*>(occlusion.data()), vertexCount * sizeof(VertexOcclusion))) {
+        occlusion.clear();
+        return false;
+    }
+    return true;
+}
+
+bool OcclusionBaker::WriteCache(const std::string& path, uint64_t key, const std::vector<VertexOcclusion>& occlusion) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    OcclusionCacheHeader header = {};
+    memcpy(header.Magic, "POCC", 4);
+    header.Version = CacheVersion;
+    header.Key = key;
+    header.VertexCount = occlusion.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(occlusion.data()), occlusion.size() * sizeof(VertexOcclusion));
+    return (bool)file;
+}
+
+void OcclusionBaker::Bake(const float* vertices, size_t stride, size_t vertexCount, const uint32_t* indices, size_t triangleCount,
+                          const OcclusionBakeSettings& settings, std::vector<VertexOcclusion>& occlusion, const std::string& cachePath) {
+    m_stats = OcclusionBakeStats();
+    m_stats.Vertices = vertexCount;
+
+    Clock::time_point start = Clock::now();
+    uint64_t key = 0;
+    if (!cachePath.empty()) {
+        key = Key(vertices, stride, vertexCount, indices, triangleCount, settings);
+        if (ReadCache(cachePath, key, vertexCount, occlusion)) {
+            m_stats.CacheHit = true;
+            m_stats.BuildMs = MillisecondsSince(start);
+            return;
+        }
+    }
+
+    // The hull: every vertex pushed out along its normal
+    std::vector<float> hull(vertexCount * 3);
+    std::vector<Float3> normals(vertexCount);
+    m_jobs.ParallelFor(vertexCount, 4096, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++) {
+            const float* src = vertices + v * stride;
+            normals[v] = Normalize(Float3(src[3], src[4], src[5]));
+            for (int c = 0; c < 3; c++) hull[v * 3 + c] = src[c] + (&normals[v].x)[c] * settings.HullOffset;
+        }
+    });
+    TriangleRaycaster raycaster;
+    raycaster.Build(hull.data(), 3, indices, triangleCount);
+    m_stats.BuildMs = MillisecondsSince(start);
+
+    // Stratified over the hemisphere: uniform in cos(theta), golden-angle spiral in phi, the
+    // spiral turned by a per-vertex angle so neighbours don't alias
+    const uint32_t rayCount = std::max((settings.RayCount + 3) & ~3u, 4u);
+    const float bias = settings.MaxDistance * 1e-4f;
+    const float sampleWeight = 2.0f * Pi / rayCount; // Solid angle per uniform sample
+    std::atomic<uint64_t> occludedRays{ 0 };
+    std::atomic<uint64_t> aoSum{ 0 }; // Fixed point, so the total is order-independent
+    occlusion.assign(vertexCount, VertexOcclusion());
+
+    start = Clock::now();
+    m_jobs.ParallelFor(vertexCount, 256, [&](size_t begin, size_t end) {
+        uint64_t chunkOccluded = 0, chunkAo = 0;
+        RayPacket4 packet;
+        for (size_t v = begin; v < end; v++) {
+            const Float3 n = normals[v];
+            if (Dot(n, n) < 0.5f) continue; // No usable normal: left open
+            Float3 t, b;
+            TangentFrame(n, t, b);
+            const Float3 origin = Float3(hull[v * 3], hull[v * 3 + 1], hull[v * 3 + 2]) + n * bias;
+            const float turn = (float)(SplitMix64(settings.Seed ^ (v * 0x9e3779b97f4a7c15ull)) >> 40) * (1.0f / 16777216.0f);
+
+            float sh[4] = {};
+            float ao = 0.0f;
+            for (uint32_t first = 0; first < rayCount; first += 4) {
+                Float3 dirs[4];
+                float cosines[4];
+                for (int lane = 0; lane < 4; lane++) {
+                    uint32_t i = first + lane;
+                    float cosTheta = (i + 0.5f) / rayCount;
+                    float sinTheta = std::sqrt(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+                    float turns = i * 0.618034f + turn;
+                    float phi = 2.0f * Pi * (turns - std::floor(turns));
+                    dirs[lane] = t * (sinTheta * std::cos(phi)) + b * (sinTheta * std::sin(phi)) + n * cosTheta;
+                    cosines[lane] = cosTheta;
+                    packet.OriginX[lane] = origin.x;
+                    packet.OriginY[lane] = origin.y;
+                    packet.OriginZ[lane] = origin.z;
+                    packet.DirX[lane] = dirs[lane].x;
+                    packet.DirY[lane] = dirs[lane].y;
+                    packet.DirZ[lane] = dirs[lane].z;
+                    packet.TMax[lane] = settings.MaxDistance;
+                }
+
+                uint32_t hits = 0;
+                if (settings.Packets) {
+                    hits = raycaster.Occluded4(packet);
+                } else {
+                    for (int lane = 0; lane < 4; lane++) {
+                        if (raycaster.Occluded(origin, dirs[lane], settings.MaxDistance)) hits |= 1u << lane;
+                    }
+                }
+
+                for (int lane = 0; lane < 4; lane++) {
+                    if (hits & (1u << lane)) {
+                        chunkOccluded++;
+                        continue;
+                    }
+                    ao += 2.0f * cosines[lane];
+                    sh[0] += ShY0;
+                    sh[1] += ShY1 * dirs[lane].x;
+                    sh[2] += ShY1 * dirs[lane].y;
+                    sh[3] += ShY1 * dirs[lane].z;
+                }
+            }
+
+            ao /= rayCount;
+            VertexOcclusion& out = occlusion[v];
+            if (settings.Directional) {
+                for (int c = 0; c < 4; c++) out.Sh[c] = sh[c] * sampleWeight;
+            } else {
+                out.Sh[0] = ao / ShY0;
+                out.Sh[1] = out.Sh[2] = out.Sh[3] = 0.0f;
+            }
+            chunkAo += (uint64_t)(std::min(ao, 1.0f) * 1e6f + 0.5f);
+        }
+        occludedRays += chunkOccluded;
+        aoSum += chunkAo;
+    });
+    m_stats.TraceMs = MillisecondsSince(start);
+    m_stats.Rays = (uint64_t)vertexCount * rayCount;
+    m_stats.OccludedRays = occludedRays.load();
+    m_stats.MeanOcclusion = vertexCount ? 1.0 - aoSum.load() * 1e-6 / vertexCount : 0.0;
+
+    if (!cachePath.empty()) WriteCache(cachePath, key, occlusion);
+}
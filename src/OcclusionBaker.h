@@ -0,0 +1,71 @@
+#pragma once
+#include "CoreMath.h"
+#include "JobSystem.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Load-time ambient occlusion and directional self-shadowing for the fur. Rays are cast over the
+// hemisphere of every vertex against the fur hull (the mesh pushed out along its normals by the
+// fur length), so a vertex in a crevice or on the underside of the pelt sees the neighbouring
+// fur that blocks it. Each vertex gets order-1 spherical harmonics of its visibility, from which
+// the shaders read ambient occlusion about the shading normal and visibility towards the light.
+// Rays run in packets of four on the job system; every vertex's rays depend only on its index
+// and the seed, so the result is the same for any thread count. Bakes are cached in a .pocc
+// file keyed by the mesh contents and the settings.
+
+struct OcclusionBakeSettings {
+    uint32_t RayCount = 64;   // Per vertex, rounded up to a multiple of 4
+    float HullOffset = 0.04f; // Fur hull displacement along the normals (the fur length)
+    float MaxDistance = 0.5f; // Occluders further along a ray than this are ignored
+    bool Directional = true;  // L0 and L1 bands; otherwise isotropic (L0 only, from the AO)
+    bool Packets = true;      // Four rays per traversal; false traces them one at a time
+    uint64_t Seed = 1;
+};
+
+// Visibility V(w) ~ Sh[0] * 0.282095 + dot((Sh[1], Sh[2], Sh[3]), w) * 0.488603, mesh space.
+// The default is fully open in every direction.
+struct VertexOcclusion {
+    float Sh[4] = { 3.544908f, 0.0f, 0.0f, 0.0f };
+};
+
+struct OcclusionBakeStats {
+    uint64_t Vertices = 0;
+    uint64_t Rays = 0;
+    uint64_t OccludedRays = 0;
+    double MeanOcclusion = 0.0; // 1 - mean AO about the vertex normals
+    double BuildMs = 0.0;       // Hull and BVH
+    double TraceMs = 0.0;
+    bool CacheHit = false;
+};
+
+class OcclusionBaker {
+public:
+    static constexpr uint32_t CacheVersion = 1;
+
+    explicit OcclusionBaker(JobSystem& jobs) : m_jobs(jobs) {}
+
+    // 'vertices' holds 'stride' floats per vertex, position then normal (GeometryGen's Vertex
+    // and MeshArrays). With a cache path, a file matching the mesh and settings is loaded
+    // instead of baking, and a fresh bake is written back.
+    void Bake(const float* vertices, size_t stride, size_t vertexCount, const uint32_t* indices, size_t triangleCount,
+              const OcclusionBakeSettings& settings, std::vector<VertexOcclusion>& occlusion,
+              const std::string& cachePath = std::string());
+
+    // What the shaders evaluate: cosine-weighted visibility about 'normal' (1 on an open
+    // plane), and visibility along 'dir'
+    static float AmbientOcclusion(const VertexOcclusion& occlusion, const Float3& normal);
+    static float Visibility(const VertexOcclusion& occlusion, const Float3& dir);
+
+    static uint64_t Key(const float* vertices, size_t stride, size_t vertexCount, const uint32_t* indices, size_t triangleCount,
+                        const OcclusionBakeSettings& settings);
+
+    const OcclusionBakeStats& Stats() const { return m_stats; }
+
+private:
+    static bool ReadCache(const std::string& path, uint64_t key, size_t vertexCount, std::vector<VertexOcclusion>& occlusion);
+    static bool WriteCache(const std::string& path, uint64_t key, const std::vector<VertexOcclusion>& occlusion);
+
+    JobSystem& m_jobs;
+    OcclusionBakeStats m_stats;
+};
@@ -0,0 +1,153 @@
+// Headless occlusion baking benchmark. First checks the baker on geometry with known answers
+// (hull offset 0, so the rays see the surfaces themselves):
+//   open plane                         AO 1
+//   plane under a ceiling at height h  AO c^2 with c = h / MaxDistance (rays within reach)
+//   plane beside a wall                AO 1/2
+//   inside a closed sphere             AO 0
+// both as traced and as reconstructed from the SH, which is exact except under the ceiling:
+// there order 1 can only give the projection of the open band, (c + c^2) / 2. Then bakes a
+// scattered synthetic scene with single-ray and packet traversal and reports rays per second,
+// checks that both and a one-thread bake agree, and that a cached bake reads back identical.
+// Usage: PelageOcclusionBench [triangles] [rays per vertex]
+#include "OcclusionBaker.h"
+#include "Raycaster.h"
+#include "SceneGen.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+// A grid of (cells + 1)^2 vertices spanning origin + [0,1] u + [0,1] v
+static void AddGrid(MeshArrays& mesh, const Float3& origin, const Float3& u, const Float3& v, const Float3& normal, uint32_t cells) {
+    uint32_t base = (uint32_t)mesh.VertexCount();
+    for (uint32_t j = 0; j <= cells; j++) {
+        for (uint32_t i = 0; i <= cells; i++) {
+            Float3 p = origin + u * ((float)i / cells) + v * ((float)j / cells);
+            float vertex[MeshArrays::VertexStride] = { p.x, p.y, p.z, normal.x, normal.y, normal.z, (float)i / cells, (float)j / cells };
+            mesh.Vertices.insert(mesh.Vertices.end(), vertex, vertex + MeshArrays::VertexStride);
+        }
+    }
+    for (uint32_t j = 0; j < cells; j++) {
+        for (uint32_t i = 0; i < cells; i++) {
+            uint32_t a = base + j * (cells + 1) + i, b = a + 1, c = a + cells + 1, d = c + 1;
+            uint32_t tris[6] = { a, c, b, b, c, d };
+            mesh.Indices.insert(mesh.Indices.end(), tris, tris + 6);
+        }
+    }
+}
+
+static std::vector<VertexOcclusion> Bake(OcclusionBaker& baker, const MeshArrays& mesh, const OcclusionBakeSettings& settings,
+                                         const std::string& cachePath = std::string()) {
+    std::vector<VertexOcclusion> occlusion;
+    baker.Bake(mesh.Vertices.data(), MeshArrays::VertexStride, mesh.VertexCount(), mesh.Indices.data(), mesh.TriangleCount(),
+               settings, occlusion, cachePath);
+    return occlusion;
+}
+
+static Float3 Normal(const MeshArrays& mesh, size_t v) {
+    const float* p = &mesh.Vertices[v * MeshArrays::VertexStride];
+    return Float3(p[3], p[4], p[5]);
+}
+
+// AO of one vertex as traced (isotropic bake) and as reconstructed from the SH, against the exact
+// value and the exact value's order-1 projection
+static bool Check(OcclusionBaker& baker, const char* name, const MeshArrays& mesh, size_t vertex, float expected, float expectedSh,
+                  OcclusionBakeSettings settings, float tolerance) {
+    settings.Directional = false;
+    float traced = OcclusionBaker::AmbientOcclusion(Bake(baker, mesh, settings)[vertex], Normal(mesh, vertex));
+    settings.Directional = true;
+    float sh = OcclusionBaker::AmbientOcclusion(Bake(baker, mesh, settings)[vertex], Normal(mesh, vertex));
+    bool pass = std::fabs(traced - expected) <= tolerance && std::fabs(sh - expectedSh) <= tolerance;
+    printf("%-22s traced %.3f (expected %.3f), SH %.3f (expected %.3f)  %s\n", name, traced, expected, sh, expectedSh,
+           pass ? "ok" : "FAILED");
+    return pass;
+}
+
+static bool SameBake(const std::vector<VertexOcclusion>& a, const std::vector<VertexOcclusion>& b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(VertexOcclusion)) == 0;
+}
+
+int main(int argc, char** argv) {
+    const uint64_t triangles = argc > 1 ? (uint64_t)std::max(atoll(argv[1]), 1000ll) : 250000;
+    const uint32_t rays = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 4) : 64;
+
+    JobSystem jobs;
+    OcclusionBaker baker(jobs);
+    bool ok = true;
+
+    OcclusionBakeSettings exact;
+    exact.HullOffset = 0.0f;
+    exact.MaxDistance = 0.5f;
+    exact.RayCount = 1024;
+
+    const uint32_t cells = 16;
+    const size_t centre = (cells / 2) * (cells + 1) + cells / 2;
+    MeshArrays plane;
+    AddGrid(plane, Float3(-2.0f, 0.0f, -2.0f), Float3(4.0f, 0.0f, 0.0f), Float3(0.0f, 0.0f, 4.0f), Float3(0.0f, 1.0f, 0.0f), cells);
+    ok &= Check(baker, "open plane", plane, centre, 1.0f, 1.0f, exact, 0.01f);
+
+    const float height = 0.25f;
+    MeshArrays ceiling = plane;
+    AddGrid(ceiling, Float3(-2.0f, height, -2.0f), Float3(4.0f, 0.0f, 0.0f), Float3(0.0f, 0.0f, 4.0f), Float3(0.0f, -1.0f, 0.0f), 4);
+    // Open below cos(theta) = c: exactly c^2, and (c + c^2) / 2 once projected to order 1
+    float c = height / exact.MaxDistance;
+    ok &= Check(baker, "plane under a ceiling", ceiling, centre, c * c, (c + c * c) * 0.5f, exact, 0.01f);
+
+    // The centre vertex sits a hair off the wall so rays towards it hit at t > 0
+    MeshArrays wall = plane;
+    AddGrid(wall, Float3(0.001f, 0.0f, -2.0f), Float3(0.0f, 4.0f, 0.0f), Float3(0.0f, 0.0f, 4.0f), Float3(-1.0f, 0.0f, 0.0f), 4);
+    OcclusionBakeSettings farRays = exact;
+    farRays.MaxDistance = 100.0f;
+    ok &= Check(baker, "plane beside a wall", wall, centre, 0.5f, 0.5f, farRays, 0.02f);
+
+    SynthScene sphereScene;
+    SynthObject sphereObject;
+    sphereObject.Resolution = 8;
+    sphereScene.Objects.push_back(sphereObject);
+    MeshArrays sphere;
+    SceneGen(jobs).Generate(sphereScene, sphere);
+    for (size_t v = 0; v < sphere.VertexCount(); v++) {
+        for (int c = 3; c < 6; c++) sphere.Vertices[v * MeshArrays::VertexStride + c] *= -1.0f; // Facing in
+    }
+    farRays.RayCount = 256;
+    ok &= Check(baker, "inside a sphere", sphere, 0, 0.0f, 0.0f, farRays, 0.01f);
+
+    // Throughput on a scattered scene with the default fur hull
+    SynthScatterSettings scatter;
+    scatter.Triangles = triangles;
+    scatter.ObjectCount = 16;
+    MeshArrays scene;
+    SceneGen(jobs).Generate(SceneGen::Scatter(scatter), scene);
+
+    OcclusionBakeSettings settings;
+    settings.RayCount = rays;
+    printf("Scattered scene: %llu triangles, %llu vertices, %u rays per vertex, %u threads\n",
+           (unsigned long long)scene.TriangleCount(), (unsigned long long)scene.VertexCount(), settings.RayCount, jobs.ThreadCount());
+    std::vector<VertexOcclusion> results[2];
+    for (int packets = 0; packets < 2; packets++) {
+        settings.Packets = packets != 0;
+        results[packets] = Bake(baker, scene, settings);
+        const OcclusionBakeStats& stats = baker.Stats();
+        printf("%-8s build %8.1f ms, trace %8.1f ms, %6.2f Mrays/s, %4.1f%% of rays occluded, mean occlusion %.3f\n",
+               packets ? "packets" : "single", stats.BuildMs, stats.TraceMs, stats.Rays / (stats.TraceMs * 1000.0),
+               100.0 * stats.OccludedRays / std::max<uint64_t>(stats.Rays, 1), stats.MeanOcclusion);
+    }
+    bool agree = SameBake(results[0], results[1]);
+    printf("Single-ray and packet bakes %s\n", agree ? "identical" : "DIFFERENT");
+
+    JobSystem serialJobs(0);
+    OcclusionBaker serialBaker(serialJobs);
+    bool deterministic = SameBake(Bake(serialBaker, scene, settings), results[1]);
+    printf("1 thread vs %u threads: %s\n", jobs.ThreadCount(), deterministic ? "identical" : "DIFFERENT");
+
+    const std::string cachePath = (std::filesystem::temp_directory_path() / "pelage_occlusion_bench.pocc").string();
+    std::filesystem::remove(cachePath);
+    Bake(baker, scene, settings, cachePath);
+    std::vector<VertexOcclusion> cached = Bake(baker, scene, settings, cachePath);
+    bool cacheOk = baker.Stats().CacheHit && SameBake(cached, results[1]);
+    printf("Cache %s in %.1f ms: %s\n", baker.Stats().CacheHit ? "hit" : "MISS", baker.Stats().BuildMs, cacheOk ? "identical" : "DIFFERENT");
+    std::filesystem::remove(cachePath);
+
+    return ok && agree && deterministic && cacheOk ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+// Headless occlusion culling benchmark. First checks OcclusionCuller at 256x128 and 512x256 on a
+// camera at the origin looking down +z, with a quad as the only occluder:
+//   quad in front      a box behind the quad is culled, one in front of it is kept
+//   quad behind        a box in front of the quad is kept
+//   partly covered     a box reaching past the quad's edge is kept
+//   backfaces          the quad wound the other way occludes nothing, unless backface culling is off
+//   near plane         a box straddling the near plane is kept, and a quad straddling it occludes nothing
+//   frustum            boxes beside the view and beyond the far plane are culled
+//   clusters           CullClusters hides a cluster behind the quad, keeps it once the fur inflation
+//                      reaches past the quad, and leaves clusters already rejected at 0
+// Then orbits a camera over a scattered scene and reports rasterization and test times at both
+// sizes against the fraction of triangles culled, with the whole scene as occluder and with the
+// scene clustered to a coarse occluder the way FramePipeline does.
+// Usage: PelageOcclusionCullBench [triangles] [objects]
+#include "BenchReport.h"
+#include "FramePipeline.h"
+#include "MeshStream.h"
+#include "OcclusionCuller.h"
+#include "SceneGen.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static Aabb Box(const Float3& center, float halfSize) {
+    Aabb box;
+    box.Expand(center - Float3(halfSize, halfSize, halfSize));
+    box.Expand(center + Float3(halfSize, halfSize, halfSize));
+    return box;
+}
+
+// A square facing the camera at depth 'z', clockwise on screen (front facing) unless 'flipped'
+struct Quad {
+    float Positions[12];
+    uint32_t Indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+    Quad(float z, float halfSize, bool flipped = false, float bottomZ = 0.0f) {
+        const float corners[4][2] = { { -1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, -1.0f } };
+        for (int i = 0; i < 4; i++) {
+            Positions[i * 3 + 0] = corners[i][0] * halfSize;
+            Positions[i * 3 + 1] = corners[i][1] * halfSize;
+            // A non-zero 'bottomZ' tilts the bottom edge towards the camera
+            Positions[i * 3 + 2] = corners[i][1] < 0.0f && bottomZ != 0.0f ? bottomZ : z;
+        }
+        if (flipped) {
+            std::swap(Indices[1], Indices[2]);
+            std::swap(Indices[4], Indices[5]);
+        }
+    }
+};
+
+static void Rasterize(OcclusionCuller& culler, const Float4x4& viewProj, const Quad* quad) {
+    culler.BeginFrame(viewProj);
+    if (quad) culler.AddOccluder(quad->Positions, 3, 4, quad->Indices, 6, Float4x4::Identity());
+    culler.RasterizeOccluders();
+}
+
+static bool Check(JobSystem& jobs) {
+    bool ok = true;
+    const Float4x4 viewProj = Multiply(LookAtLH(Float3(0.0f, 0.0f, 0.0f), Float3(0.0f, 0.0f, 1.0f), Float3(0.0f, 1.0f, 0.0f)),
+                                       PerspectiveFovLH(1.5707963f, 2.0f, 0.1f, 100.0f));
+    bool inFront = true, behind = true, partly = true, backfaces = true, nearPlane = true, frustum = true, clusters = true;
+    for (uint32_t scale : { 1u, 2u }) {
+        OcclusionCullerSettings settings;
+        settings.Width = 256 * scale;
+        settings.Height = 128 * scale;
+        OcclusionCuller culler(jobs, settings);
+
+        const Quad front(5.0f, 4.0f);
+        Rasterize(culler, viewProj, &front);
+        inFront &= !culler.IsVisible(Box(Float3(0.0f, 0.0f, 10.0f), 1.0f)) && culler.IsVisible(Box(Float3(0.0f, 0.0f, 3.0f), 1.0f));
+        inFront &= culler.Stats().RasterizedTriangles == 2;
+        // The quad covers x / z up to 0.8: one box reaches past it, one stays inside
+        partly &= culler.IsVisible(Box(Float3(8.5f, 0.0f, 10.0f), 1.0f)) && !culler.IsVisible(Box(Float3(5.0f, 0.0f, 10.0f), 1.0f));
+
+        const Quad back(20.0f, 8.0f);
+        Rasterize(culler, viewProj, &back);
+        behind &= culler.IsVisible(Box(Float3(0.0f, 0.0f, 10.0f), 1.0f)) && !culler.IsVisible(Box(Float3(0.0f, 0.0f, 30.0f), 1.0f));
+
+        const Quad flipped(5.0f, 4.0f, true);
+        Rasterize(culler, viewProj, &flipped);
+        backfaces &= culler.IsVisible(Box(Float3(0.0f, 0.0f, 10.0f), 1.0f)) && culler.Stats().RasterizedTriangles == 0;
+        OcclusionCullerSettings twoSided = settings;
+        twoSided.BackfaceCull = false;
+        OcclusionCuller twoSidedCuller(jobs, twoSided);
+        Rasterize(twoSidedCuller, viewProj, &flipped);
+        backfaces &= !twoSidedCuller.IsVisible(Box(Float3(0.0f, 0.0f, 10.0f), 1.0f));
+
+        // Behind the front quad, but crossing the near plane
+        Rasterize(culler, viewProj, &front);
+        nearPlane &= culler.IsVisible(Box(Float3(0.0f, 0.0f, 0.0f), 1.0f));
+        const Quad straddling(5.0f, 4.0f, false, -1.0f);
+        Rasterize(culler, viewProj, &straddling);
+        nearPlane &= culler.IsVisible(Box(Float3(0.0f, 0.0f, 10.0f), 1.0f));
+
+        Rasterize(culler, viewProj, nullptr);
+        frustum &= culler.IsVisible(Box(Float3(0.0f, 0.0f, 10.0f), 1.0f));
+        frustum &= !culler.IsVisible(Box(Float3(100.0f, 0.0f, 10.0f), 1.0f)) && !culler.IsVisible(Box(Float3(0.0f, 50.0f, 10.0f), 1.0f));
+        frustum &= !culler.IsVisible(Box(Float3(0.0f, 0.0f, 150.0f), 1.0f)) && !culler.IsVisible(Aabb());
+
+        Rasterize(culler, viewProj, &front);
+        std::vector<MeshCluster> testClusters(3);
+        testClusters[0].Bounds = Box(Float3(0.0f, 0.0f, 6.0f), 0.25f); // Just behind the quad
+        testClusters[1].Bounds = Box(Float3(40.0f, 0.0f, 30.0f), 1.0f); // Beside it
+        testClusters[2].Bounds = Box(Float3(0.0f, 0.0f, 3.0f), 1.0f);  // In front, but rejected earlier
+        for (MeshCluster& cluster : testClusters) cluster.TriangleCount = 10;
+        std::vector<uint8_t> visible = { 1, 1, 0 };
+        culler.CullClusters(testClusters, Float4x4::Identity(), 0.1f, visible);
+        clusters &= visible == std::vector<uint8_t>({ 0, 1, 0 }) && culler.Stats().CulledTriangles == 20;
+        visible.assign(3, 1);
+        culler.CullClusters(testClusters, Float4x4::Identity(), 1.0f, visible);
+        clusters &= visible == std::vector<uint8_t>({ 1, 1, 1 });
+        // A size mismatch resets every entry before testing
+        visible.clear();
+        culler.CullClusters(testClusters, Float4x4::Identity(), 0.1f, visible);
+        clusters &= visible == std::vector<uint8_t>({ 0, 1, 1 });
+    }
+    ok &= Report("quad in front", inFront);
+    ok &= Report("quad behind", behind);
+    ok &= Report("partly covered", partly);
+    ok &= Report("backfaces", backfaces);
+    ok &= Report("near plane", nearPlane);
+    ok &= Report("frustum", frustum);
+    ok &= Report("clusters", clusters);
+    return ok;
+}
+
+static void Benchmark(JobSystem& jobs, uint64_t triangles, uint32_t objects) {
+    SynthScatterSettings scatter;
+    scatter.Triangles = triangles;
+    scatter.ObjectCount = objects;
+    MeshArrays scene;
+    SceneGen(jobs).Generate(SceneGen::Scatter(scatter), scene);
+
+    // Clusters the way the renderer builds them: Morton order, 128 triangles each
+    const std::vector<uint32_t> order = MeshClusters::SpatialTriangleOrder(scene.Vertices.data(), MeshArrays::VertexStride, scene.Indices);
+    MeshClusters::ApplyTriangleOrder(scene.Indices, order, 3);
+    const std::vector<MeshCluster> sceneClusters = MeshClusters::Build(scene.Vertices.data(), MeshArrays::VertexStride, scene.Indices);
+
+    MeshArrays coarse;
+    MeshStreamSettings clustering;
+    clustering.GridResolution = FramePipeline::OccluderGridResolution;
+    MeshStreamer::ProcessInCore(scene, clustering, coarse);
+
+    const Aabb bounds = ComputeBounds(scene.Vertices.data(), scene.VertexCount(), MeshArrays::VertexStride);
+    const Float3 center = bounds.Center();
+    const float radius = bounds.Extents().x;
+    const float furLength = 0.04f;
+    const uint32_t views = 64;
+
+    printf("\n%zu triangles in %zu clusters, %u objects, coarse occluder %zu triangles, %u views, %u threads\n", scene.TriangleCount(),
+           sceneClusters.size(), objects, coarse.TriangleCount(), views, jobs.ThreadCount());
+    printf("  size      occluder   raster ms   test ms   culled\n");
+    for (uint32_t scale : { 1u, 2u }) {
+        OcclusionCullerSettings settings;
+        settings.Width = 256 * scale;
+        settings.Height = 128 * scale;
+        OcclusionCuller culler(jobs, settings);
+        for (const MeshArrays* occluder : { &scene, &coarse }) {
+            double rasterMs = 0.0, testMs = 0.0;
+            uint64_t tested = 0, culled = 0;
+            std::vector<uint8_t> visible;
+            for (uint32_t view = 0; view < views; view++) {
+                // Low over the floor, looking across it, so objects hide each other
+                const float angle = 6.2831853f * view / views;
+                const Float3 eye = center + Float3(std::cos(angle) * radius * 0.8f, 0.6f, std::sin(angle) * radius * 0.8f);
+                const Float4x4 viewProj = Multiply(LookAtLH(eye, center + Float3(0.0f, 0.3f, 0.0f), Float3(0.0f, 1.0f, 0.0f)),
+                                                   PerspectiveFovLH(0.785398163f, 16.0f / 9.0f, 0.1f, 100.0f));
+                culler.BeginFrame(viewProj);
+                culler.AddOccluder(occluder->Vertices.data(), MeshArrays::VertexStride, occluder->VertexCount(), occluder->Indices.data(),
+                                   occluder->Indices.size(), Float4x4::Identity());
+                culler.RasterizeOccluders();
+                visible.assign(sceneClusters.size(), 1);
+                culler.CullClusters(sceneClusters, Float4x4::Identity(), furLength, visible);
+                rasterMs += culler.Stats().RasterMs;
+                testMs += culler.Stats().TestMs;
+                tested += culler.Stats().TestedTriangles;
+                culled += culler.Stats().CulledTriangles;
+            }
+            printf("  %3ux%-3u   %-8s %10.3f %9.3f %7.1f%%\n", settings.Width, settings.Height, occluder == &scene ? "full" : "coarse",
+                   rasterMs / views, testMs / views, 100.0 * culled / tested);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint64_t triangles = argc > 1 ? (uint64_t)std::max(atoll(argv[1]), 1000ll) : 1000000;
+    const uint32_t objects = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 1) : 256;
+    JobSystem jobs;
+    bool ok = Check(jobs);
+    Benchmark(jobs, triangles, objects);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+#include "OcclusionCuller.h"
+#include "Simd.h"
+#include "Timing.h"
+
+OcclusionCuller::OcclusionCuller(JobSystem& jobs, const OcclusionCullerSettings& settings)
+    : m_jobs(jobs), m_settings(settings) {
+    // Round up to whole tiles so every tile (and every 4-wide SIMD group) is complete
+    m_settings.Width = std::max(TileWidth, (m_settings.Width + TileWidth - 1) / TileWidth * TileWidth);
+    m_settings.Height = std::max(TileHeight, (m_settings.Height + TileHeight - 1) / TileHeight * TileHeight);
+
+    m_tilesX = m_settings.Width / TileWidth;
+    m_tilesY = m_settings.Height / TileHeight;
+    m_blocksX = m_settings.Width / BlockSize;
+    m_blocksY = m_settings.Height / BlockSize;
+
+    m_depth.assign((size_t)m_settings.Width * m_settings.Height, 1.0f);
+    m_blockMaxDepth.assign((size_t)m_blocksX * m_blocksY, 1.0f);
+    m_tileBins.resize((size_t)m_tilesX * m_tilesY);
+    m_viewProj = Float4x4::Identity();
+}
+
+void OcclusionCuller::BeginFrame(const Float4x4& viewProj) {
+    m_viewProj = viewProj;
+    m_occluders.clear();
+    m_stats = {};
+}
+
+void OcclusionCuller::AddOccluder(const float* positions, size_t stride, size_t vertexCount,
+                                  const uint32_t* indices, size_t indexCount, const Float4x4& world) {
+    Occluder occluder;
+    occluder.Positions = positions;
+    occluder.Stride = stride;
+    occluder.VertexCount = vertexCount;
+    occluder.Indices = indices;
+    occluder.IndexCount = indexCount;
+    occluder.WorldViewProj = Multiply(world, m_viewProj);
+    m_occluders.push_back(occluder);
+}
+
+void OcclusionCuller::TransformVertices(const Occluder& occluder, std::vector<ClipVertex>& out) {
+    out.resize(occluder.VertexCount);
+    const float width = (float)m_settings.Width;
+    const float height = (float)m_settings.Height;
+    const Float4x4& t = occluder.WorldViewProj;
+
+    m_jobs.ParallelFor(occluder.VertexCount, 4096, [&](size_t begin, size_t end) {
+#if PELAGE_SSE2
+        const __m128 row0 = _mm_loadu_ps(t.m[0]);
+        const __m128 row1 = _mm_loadu_ps(t.m[1]);
+        const __m128 row2 = _mm_loadu_ps(t.m[2]);
+        const __m128 row3 = _mm_loadu_ps(t.m[3]);
+#endif
+        for (size_t i = begin; i < end; i++) {
+            const float* p = occluder.Positions + i * occluder.Stride;
+            float clip[4];
+#if PELAGE_SSE2
+            __m128 c = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[0]), row0), _mm_mul_ps(_mm_set1_ps(p[1]), row1)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[2]), row2), row3));
+            _mm_storeu_ps(clip, c);
+#else
+            for (int j = 0; j < 4; j++) {
+                clip[j] = p[0] * t.m[0][j] + p[1] * t.m[1][j] + p[2] * t.m[2][j] + t.m[3][j];
+            }
+#endif
+            ClipVertex& v = out[i];
+            v.Valid = clip[3] > 1e-6f && clip[2] >= 0.0f;
+            float invW = v.Valid ? 1.0f / clip[3] : 0.0f;
+            v.X = (clip[0] * invW * 0.5f + 0.5f) * width;
+            v.Y = (0.5f - clip[1] * invW * 0.5f) * height;
+            v.Z = clip[2] * invW;
+        }
+    });
+}
+
+void OcclusionCuller::RasterizeOccluders() {
+    Clock::time_point start = Clock::now();
+
+    for (auto& bin : m_tileBins) bin.clear();
+    m_triangles.clear();
+
+    const int width = (int)m_settings.Width;
+    const int height = (int)m_settings.Height;
+
+    for (const Occluder& occluder : m_occluders) {
+        TransformVertices(occluder, m_clipVertices);
+
+        size_t numTris = occluder.IndexCount / 3;
+        size_t base = m_triangles.size();
+        m_triangles.resize(base + numTris);
+        m_stats.OccluderTriangles += (uint32_t)numTris;
+
+        // Triangle setup. Rejected triangles get an empty pixel box (MinX > MaxX).
+        m_jobs.ParallelFor(numTris, 2048, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                SetupTriangle& tri = m_triangles[base + i];
+                tri.MinX = 1; tri.MaxX = 0;
+
+                const ClipVertex& v0 = m_clipVertices[occluder.Indices[i * 3 + 0]];
+                ClipVertex v1 = m_clipVertices[occluder.Indices[i * 3 + 1]];
+                ClipVertex v2 = m_clipVertices[occluder.Indices[i * 3 + 2]];
+
+                // Dropping an occluder is always safe, so anything crossing the near plane is skipped
+                if (!v0.Valid || !v1.Valid || !v2.Valid) continue;
+                if (v0.Z > 1.0f && v1.Z > 1.0f && v2.Z > 1.0f) continue;
+
+                float area = (v1.X - v0.X) * (v2.Y - v0.Y) - (v2.X - v0.X) * (v1.Y - v0.Y);
+                if (area < 0.0f && !m_settings.BackfaceCull) {
+                    std::swap(v1, v2);
+                    area = -area;
+                }
+                if (area <= 0.0f) continue;
+
+                // Pixels whose centers can be covered
+                float minX = std::min({ v0.X, v1.X, v2.X }), maxX = std::max({ v0.X, v1.X, v2.X });
+                float minY = std::min({ v0.Y, v1.Y, v2.Y }), maxY = std::max({ v0.Y, v1.Y, v2.Y });
+                int px0 = std::max(0, (int)std::ceil(minX - 0.5f));
+                int px1 = std::min(width - 1, (int)std::floor(maxX - 0.5f));
+                int py0 = std::max(0, (int)std::ceil(minY - 0.5f));
+                int py1 = std::min(height - 1, (int)std::floor(maxY - 0.5f));
+                if (px0 > px1 || py0 > py1) continue;
+
+                tri.X[0] = v0.X; tri.Y[0] = v0.Y; tri.Z[0] = v0.Z;
+                tri.X[1] = v1.X; tri.Y[1] = v1.Y; tri.Z[1] = v1.Z;
+                tri.X[2] = v2.X; tri.Y[2] = v2.Y; tri.Z[2] = v2.Z;
+                tri.MinX = (uint16_t)px0; tri.MaxX = (uint16_t)px1;
+                tri.MinY = (uint16_t)py0; tri.MaxY = (uint16_t)py1;
+            }
+        });
+    }
+
+    // Binning is cheap next to setup and rasterization, so it stays serial and deterministic
+    for (uint32_t i = 0; i < (uint32_t)m_triangles.size(); i++) {
+        const SetupTriangle& tri = m_triangles[i];
+        if (tri.MinX > tri.MaxX) continue;
+        m_stats.RasterizedTriangles++;
+
+        for (uint32_t ty = tri.MinY / TileHeight; ty <= tri.MaxY / TileHeight; ty++) {
+            for (uint32_t tx = tri.MinX / TileWidth; tx <= tri.MaxX / TileWidth; tx++) {
+                m_tileBins[ty * m_tilesX + tx].push_back(i);
+            }
+        }
+    }
+
+    m_jobs.ParallelFor(m_tileBins.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) {
+            RasterizeTile((uint32_t)tile);
+            BuildHiZ((uint32_t)tile);
+        }
+    });
+
+    m_stats.RasterMs = MillisecondsSince(start);
+}
+
+void OcclusionCuller::RasterizeTile(uint32_t tileIndex) {
+    const uint32_t width = m_settings.Width;
+    const int tileX0 = (int)((tileIndex % m_tilesX) * TileWidth);
+    const int tileY0 = (int)((tileIndex / m_tilesX) * TileHeight);
+    const int tileX1 = tileX0 + (int)TileWidth - 1;
+    const int tileY1 = tileY0 + (int)TileHeight - 1;
+
+    for (int y = tileY0; y <= tileY1; y++) {
+        std::fill_n(m_depth.begin() + (size_t)y * width + tileX0, TileWidth, 1.0f);
+    }
+
+    for (uint32_t triIndex : m_tileBins[tileIndex]) {
+        const SetupTriangle& tri = m_triangles[triIndex];
+
+        // Edge functions E(p) = A * p.x + B * p.y + C, >= 0 inside (clockwise in screen space)
+        float edgeA[3], edgeB[3], edgeC[3];
+        for (int e = 0; e < 3; e++) {
+            int a = e, b = (e + 1) % 3;
+            edgeA[e] = tri.Y[a] - tri.Y[b];
+            edgeB[e] = tri.X[b] - tri.X[a];
+            edgeC[e] = -(edgeA[e] * tri.X[a] + edgeB[e] * tri.Y[a]);
+        }
+
+        // Depth plane from barycentrics: v1 weight is E(2->0), v2 weight is E(0->1)
+        float area = edgeA[0] * tri.X[2] + edgeB[0] * tri.Y[2] + edgeC[0];
+        float invArea = 1.0f / area;
+        float dz1 = (tri.Z[1] - tri.Z[0]) * invArea;
+        float dz2 = (tri.Z[2] - tri.Z[0]) * invArea;
+        float zA = edgeA[2] * dz1 + edgeA[0] * dz2;
+        float zB = edgeB[2] * dz1 + edgeB[0] * dz2;
+        float zC = tri.Z[0] + edgeC[2] * dz1 + edgeC[0] * dz2;
+
+        int x0 = std::max((int)tri.MinX, tileX0) & ~3; // Tiles are 4-aligned, so groups never leave the tile
+        int x1 = std::min((int)tri.MaxX, tileX1);
+        int y0 = std::max((int)tri.MinY, tileY0);
+        int y1 = std::min((int)tri.MaxY, tileY1);
+
+        for (int y = y0; y <= y1; y++) {
+            float py = (float)y + 0.5f;
+            float* row = m_depth.data() + (size_t)y * width;
+
+#if PELAGE_SSE2
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x0), laneOffsets);
+            const __m128 step = _mm_set1_ps(4.0f);
+
+            __m128 a0 = _mm_set1_ps(edgeA[0]), a1 = _mm_set1_ps(edgeA[1]), a2 = _mm_set1_ps(edgeA[2]), za = _mm_set1_ps(zA);
+            __m128 r0 = _mm_set1_ps(edgeB[0] * py + edgeC[0]);
+            __m128 r1 = _mm_set1_ps(edgeB[1] * py + edgeC[1]);
+            __m128 r2 = _mm_set1_ps(edgeB[2] * py + edgeC[2]);
+            __m128 rz = _mm_set1_ps(zB * py + zC);
+
+            for (int x = x0; x <= x1; x += 4) {
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), r0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), r1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), r2);
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+                if (_mm_movemask_ps(inside)) {
+                    __m128 z = _mm_add_ps(_mm_mul_ps(za, px), rz);
+                    __m128 depth = _mm_loadu_ps(row + x);
+                    __m128 closer = _mm_min_ps(depth, z);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, depth)));
+                }
+                px = _mm_add_ps(px, step);
+            }
+#else
+            for (int x = x0; x <= x1; x++) {
+                float px = (float)x + 0.5f;
+                float e0 = edgeA[0] * px + edgeB[0] * py + edgeC[0];
+                float e1 = edgeA[1] * px + edgeB[1] * py + edgeC[1];
+                float e2 = edgeA[2] * px + edgeB[2] * py + edgeC[2];
+                if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) {
+                    float z = zA * px + zB * py + zC;
+                    row[x] = std::min(row[x], z);
+                }
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::BuildHiZ(uint32_t tileIndex) {
+    const uint32_t width = m_settings.Width;
+    const uint32_t blockX0 = (tileIndex % m_tilesX) * (TileWidth / BlockSize);
+    const uint32_t blockY0 = (tileIndex / m_tilesX) * (TileHeight / BlockSize);
+
+    for (uint32_t by = blockY0; by < blockY0 + TileHeight / BlockSize; by++) {
+        for (uint32_t bx = blockX0; bx < blockX0 + TileWidth / BlockSize; bx++) {
+            float blockMax = 0.0f;
+            for (uint32_t y = by * BlockSize; y < (by + 1) * BlockSize; y++) {
+                const float* row = m_depth.data() + (size_t)y * width + bx * BlockSize;
+                for (uint32_t x = 0; x < BlockSize; x++) {
+                    blockMax = std::max(blockMax, row[x]);
+                }
+            }
+            m_blockMaxDepth[by * m_blocksX + bx] = blockMax;
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(const Aabb& worldBounds) const {
+    if (worldBounds.IsEmpty()) return false;
+
+    const float width = (float)m_settings.Width;
+    const float height = (float)m_settings.Height;
+
+    const float big = std::numeric_limits<float>::max();
+    float ndcMinX = big, ndcMaxX = -big, ndcMinY = big, ndcMaxY = -big, minZ = big;
+    for (int i = 0; i < 8; i++) {
+        Float3 p = worldBounds.Corner(i);
+        const Float4x4& t = m_viewProj;
+        float cx = p.x * t.m[0][0] + p.y * t.m[1][0] + p.z * t.m[2][0] + t.m[3][0];
+        float cy = p.x * t.m[0][1] + p.y * t.m[1][1] + p.z * t.m[2][1] + t.m[3][1];
+        float cz = p.x * t.m[0][2] + p.y * t.m[1][2] + p.z * t.m[2][2] + t.m[3][2];
+        float cw = p.x * t.m[0][3] + p.y * t.m[1][3] + p.z * t.m[2][3] + t.m[3][3];
+
+        // Straddles the near plane: no reliable screen rect, keep it
+        if (cw <= 1e-6f || cz < 0.0f) return true;
+
+        float invW = 1.0f / cw;
+        float nx = cx * invW, ny = cy * invW;
+        ndcMinX = std::min(ndcMinX, nx); ndcMaxX = std::max(ndcMaxX, nx);
+        ndcMinY = std::min(ndcMinY, ny); ndcMaxY = std::max(ndcMaxY, ny);
+        minZ = std::min(minZ, cz * invW);
+    }
+
+    // Frustum rejection
+    if (ndcMaxX < -1.0f || ndcMinX > 1.0f || ndcMaxY < -1.0f || ndcMinY > 1.0f || minZ > 1.0f) return false;
+
+    float minX = (ndcMinX * 0.5f + 0.5f) * width;
+    float maxX = (ndcMaxX * 0.5f + 0.5f) * width;
+    float minY = (0.5f - ndcMaxY * 0.5f) * height;
+    float maxY = (0.5f - ndcMinY * 0.5f) * height;
+
+    // Every pixel the rect touches
+    int px0 = std::clamp((int)std::floor(minX), 0, (int)m_settings.Width - 1);
+    int px1 = std::clamp((int)std::floor(maxX), 0, (int)m_settings.Width - 1);
+    int py0 = std::clamp((int)std::floor(minY), 0, (int)m_settings.Height - 1);
+    int py1 = std::clamp((int)std::floor(maxY), 0, (int)m_settings.Height - 1);
+
+    for (int by = py0 / (int)BlockSize; by <= py1 / (int)BlockSize; by++) {
+        for (int bx = px0 / (int)BlockSize; bx <= px1 / (int)BlockSize; bx++) {
+            // The whole block is covered by occluders in front of the bounds
+            if (m_blockMaxDepth[by * m_blocksX + bx] < minZ) continue;
+
+            int x0 = std::max(px0, bx * (int)BlockSize), x1 = std::min(px1, (bx + 1) * (int)BlockSize - 1);
+            int y0 = std::max(py0, by * (int)BlockSize), y1 = std::min(py1, (by + 1) * (int)BlockSize - 1);
+            for (int y = y0; y <= y1; y++) {
+                const float* row = m_depth.data() + (size_t)y * m_settings.Width;
+                for (int x = x0; x <= x1; x++) {
+                    if (row[x] >= minZ) return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void OcclusionCuller::CullClusters(const std::vector<MeshCluster>& clusters, const Float4x4& world, float furInflation, std::vector<uint8_t>& visible) {
+    Clock::time_point start = Clock::now();
+    if (visible.size() != clusters.size()) {
+        visible.assign(clusters.size(), 1);
+    }
+
+    m_jobs.ParallelFor(clusters.size(), 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (!visible[i]) continue;
+            Aabb bounds = TransformAabb(world, clusters[i].Bounds).Inflated(furInflation);
+            visible[i] = IsVisible(bounds) ? 1 : 0;
+        }
+    });
+
+    for (size_t i = 0; i < clusters.size(); i++) {
+        m_stats.TestedClusters++;
+        m_stats.TestedTriangles += clusters[i].TriangleCount;
+        if (!visible[i]) {
+            m_stats.CulledClusters++;
+            m_stats.CulledTriangles += clusters[i].TriangleCount;
+        }
+    }
+    m_stats.TestMs += MillisecondsSince(start);
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "CoreMath.h"
+#include "JobSystem.h"
+#include "MeshClusters.h"
+#include <vector>
+
+// CPU software occlusion culling.
+// Occluders (the base mesh, other opaque geometry) are rasterized into a small depth buffer,
+// split into screen tiles that are rasterized in parallel with SSE2, 4 pixels per step.
+// A hierarchical max-depth level per 8x8 block lets most occludee tests finish without touching
+// individual pixels. Clusters whose fur-inflated bounds are behind the occluders, or outside the
+// view, are culled. Depth follows D3D: 0 = near, 1 = far, LESS test.
+
+struct OcclusionCullerSettings {
+    uint32_t Width = 256;   // Multiple of TileWidth
+    uint32_t Height = 128;  // Multiple of TileHeight
+    bool BackfaceCull = true; // Clockwise front faces, as the D3D12 PSOs use
+};
+
+struct OcclusionStats {
+    uint32_t OccluderTriangles = 0;
+    uint32_t RasterizedTriangles = 0; // Survived near-plane, backface and screen rejection
+    uint32_t TestedClusters = 0;
+    uint32_t CulledClusters = 0;
+    uint64_t TestedTriangles = 0;
+    uint64_t CulledTriangles = 0;
+    double RasterMs = 0.0;
+    double TestMs = 0.0;
+
+    double CulledTriangleFraction() const {
+        return TestedTriangles ? (double)CulledTriangles / (double)TestedTriangles : 0.0;
+    }
+};
+
+class OcclusionCuller {
+public:
+    static constexpr uint32_t TileWidth = 64;
+    static constexpr uint32_t TileHeight = 32;
+    static constexpr uint32_t BlockSize = 8; // Hi-Z granularity
+
+    explicit OcclusionCuller(JobSystem& jobs, const OcclusionCullerSettings& settings = OcclusionCullerSettings());
+
+    // 'viewProj' uses the row-vector convention (DirectXMath view * proj, not transposed)
+    void BeginFrame(const Float4x4& viewProj);
+
+    // Occluder data is referenced, not copied, until RasterizeOccluders returns. 'stride' is in floats.
+    void AddOccluder(const float* positions, size_t stride, size_t vertexCount,
+                     const uint32_t* indices, size_t indexCount, const Float4x4& world);
+
+    void RasterizeOccluders();
+
+    // Frustum + occlusion test of world-space bounds against the rasterized occluders
+    bool IsVisible(const Aabb& worldBounds) const;
+
+    // Tests every cluster with bounds moved to world space and inflated by 'furInflation'.
+    // Writes 1/0 per cluster into 'visible'. Clusters already 0 in 'visible' (e.g. rejected by a
+    // BVH frustum pass) are not tested again; a size mismatch resets every entry to 1 first.
+    void CullClusters(const std::vector<MeshCluster>& clusters, const Float4x4& world, float furInflation, std::vector<uint8_t>& visible);
+
+    uint32_t Width() const { return m_settings.Width; }
+    uint32_t Height() const { return m_settings.Height; }
+    const std::vector<float>& Depth() const { return m_depth; }
+    const OcclusionStats& Stats() const { return m_stats; }
+
+private:
+    struct Occluder {
+        const float* Positions;
+        size_t Stride;
+        size_t VertexCount;
+        const uint32_t* Indices;
+        size_t IndexCount;
+        Float4x4 WorldViewProj;
+    };
+
+    // Screen-space triangle ready to rasterize
+    struct SetupTriangle {
+        float X[3], Y[3], Z[3];
+        uint16_t MinX, MinY, MaxX, MaxY; // Pixel bounds, inclusive
+    };
+
+    struct ClipVertex {
+        float X, Y, Z; // Pixels, pixels, NDC depth
+        bool Valid;    // In front of the near plane
+    };
+
+    void TransformVertices(const Occluder& occluder, std::vector<ClipVertex>& out);
+    void RasterizeTile(uint32_t tileIndex);
+    void BuildHiZ(uint32_t tileIndex);
+
+    JobSystem& m_jobs;
+    OcclusionCullerSettings m_settings;
+    Float4x4 m_viewProj;
+
+    uint32_t m_tilesX = 0, m_tilesY = 0;
+    uint32_t m_blocksX = 0, m_blocksY = 0;
+    std::vector<float> m_depth;
+    std::vector<float> m_blockMaxDepth;
+
+    std::vector<Occluder> m_occluders;
+    std::vector<ClipVertex> m_clipVertices;
+    std::vector<SetupTriangle> m_triangles;
+    std::vector<std::vector<uint32_t>> m_tileBins;
+
+    OcclusionStats m_stats;
+};
@@ -0,0 +1,168 @@
+// Headless benchmark of the temporal OSM schedule. First checks OsmScheduler with 8 bands, 3 per
+// partial frame, against its thresholds:
+//   reuse              changes below every reuse threshold keep the map and render nothing
+//   partial cycle      a drift between the thresholds redraws every band exactly once, in order,
+//                      with the projection of the last full refresh; only then does the map count
+//                      as up to date, so drifting on during the cycle starts another one
+//   full refresh       a large light, bounds or wind change, or Invalidate, redraws the whole map
+//                      with a new projection, also in the middle of a cycle
+//   sway               wind above SwayAmplitude keeps cycling on a still scene, and it settles
+//                      one cycle after the wind drops below it
+// Then runs a scripted sequence (static, slow light drift, light jumps, swaying fur) and prints
+// the fraction of OSM raster work saved against a full refresh every frame.
+// Usage: PelageOsmScheduleBench [frames per phase]
+#include "BenchReport.h"
+#include "OsmScheduler.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// A light in the xy plane 'angle' radians from straight down, over 2 x 1 x 2 of fur moved along x
+// by 'shift' times its largest extent
+static OsmSceneState State(float angle, float shift = 0.0f, float wind = 0.0f) {
+    OsmSceneState state;
+    state.LightDirection = Float3(std::sin(angle), -std::cos(angle), 0.0f);
+    state.FurBounds.Expand(Float3(-1.0f + shift * 2.0f, 0.0f, -1.0f));
+    state.FurBounds.Expand(Float3(1.0f + shift * 2.0f, 1.0f, 1.0f));
+    state.WindAmplitude = wind;
+    return state;
+}
+
+static bool Is(const OsmUpdate& update, OsmUpdateKind kind, uint32_t firstTile, uint32_t tileCount) {
+    return update.Kind == kind && update.FirstTile == firstTile && update.TileCount == tileCount;
+}
+
+static bool SameDirection(const OsmSceneState& a, const OsmSceneState& b) {
+    return OsmScheduler::LightAngle(a, b) < 1e-4f;
+}
+
+// Runs partial frames on 'state' until the cycle ends; true if they covered every band (and
+// every row of the map) exactly once, in order, and kept the projection
+static bool FullCycle(OsmScheduler& scheduler, const OsmSceneState& state) {
+    const OsmSceneState projection = scheduler.ProjectionState();
+    const uint32_t resolution = 1024;
+    std::vector<uint32_t> bands(scheduler.Settings().TileCount, 0), rows(resolution, 0);
+    uint32_t next = 0;
+    bool valid = true;
+    while (valid && next < scheduler.Settings().TileCount) {
+        const OsmUpdate update = scheduler.Update(state);
+        valid &= update.Kind == OsmUpdateKind::Partial && update.FirstTile == next && update.TileCount > 0;
+        for (uint32_t t = update.FirstTile; t < update.FirstTile + update.TileCount && t < bands.size(); t++) bands[t]++;
+        const OsmTileRect rect = scheduler.TileRange(update.FirstTile, update.TileCount, resolution);
+        for (uint32_t y = rect.Top; y < rect.Bottom; y++) rows[y]++;
+        valid &= rect.Left == 0 && rect.Right == resolution && SameDirection(scheduler.ProjectionState(), projection);
+        next += update.TileCount;
+    }
+    valid &= std::all_of(bands.begin(), bands.end(), [](uint32_t count) { return count == 1; });
+    valid &= std::all_of(rows.begin(), rows.end(), [](uint32_t count) { return count == 1; });
+    return valid;
+}
+
+static bool Check() {
+    bool ok = true;
+    OsmSchedulerSettings settings;
+    settings.TileCount = 8;
+    settings.TilesPerFrame = 3;
+
+    OsmScheduler scheduler(settings);
+    bool reuse = Is(scheduler.Update(State(0.0f)), OsmUpdateKind::Full, 0, 8);
+    reuse &= Is(scheduler.Update(State(0.0f)), OsmUpdateKind::Reuse, 0, 0);
+    const OsmSceneState below = State(settings.ReuseLightAngle * 0.5f, settings.ReuseBoundsChange * 0.5f, settings.ReuseWindChange * 0.5f);
+    for (int frame = 0; frame < 10; frame++) reuse &= Is(scheduler.Update(below), OsmUpdateKind::Reuse, 0, 0);
+    reuse &= scheduler.Stats().Reuses == 11 && scheduler.Stats().TilesRendered == 8 && SameDirection(scheduler.ProjectionState(), State(0.0f));
+    ok &= Report("reuse", reuse);
+
+    // Between the thresholds: 3 + 3 + 2 bands, then the map is up to date
+    scheduler = OsmScheduler(settings);
+    scheduler.Update(State(0.0f));
+    const float drift = (settings.ReuseLightAngle + settings.FullLightAngle) * 0.25f;
+    bool partial = FullCycle(scheduler, State(drift));
+    partial &= Is(scheduler.Update(State(drift)), OsmUpdateKind::Reuse, 0, 0);
+    // Drifting on in the middle of a cycle: the bands drawn before it are stale, so the map is up
+    // to date only after a second cycle
+    partial &= Is(scheduler.Update(State(drift * 2.0f)), OsmUpdateKind::Partial, 0, 3);
+    partial &= Is(scheduler.Update(State(drift * 3.0f)), OsmUpdateKind::Partial, 3, 3);
+    partial &= Is(scheduler.Update(State(drift * 3.0f)), OsmUpdateKind::Partial, 6, 2);
+    partial &= FullCycle(scheduler, State(drift * 3.0f));
+    partial &= Is(scheduler.Update(State(drift * 3.0f)), OsmUpdateKind::Reuse, 0, 0);
+    partial &= SameDirection(scheduler.ProjectionState(), State(0.0f)) && scheduler.Stats().FullRefreshes == 1;
+    ok &= Report("partial cycle", partial);
+
+    bool full = true;
+    // The wind falls from above the sway amplitude, or the still state after it would keep cycling
+    const OsmSceneState changes[][2] = { { State(0.0f), State(settings.FullLightAngle * 1.5f) },
+                                         { State(0.0f), State(0.0f, settings.FullBoundsChange * 1.5f) },
+                                         { State(0.0f, 0.0f, settings.FullWindChange * 1.5f), State(0.0f) } };
+    for (const OsmSceneState(&fromTo)[2] : changes) {
+        const OsmSceneState& change = fromTo[1];
+        scheduler = OsmScheduler(settings);
+        scheduler.Update(fromTo[0]);
+        full &= Is(scheduler.Update(change), OsmUpdateKind::Full, 0, 8);
+        full &= OsmScheduler::LightAngle(scheduler.ProjectionState(), change) == 0.0f &&
+                OsmScheduler::BoundsChange(scheduler.ProjectionState(), change) == 0.0f;
+        full &= Is(scheduler.Update(change), OsmUpdateKind::Reuse, 0, 0);
+    }
+    // A jump in the middle of a cycle drops the cycle
+    scheduler = OsmScheduler(settings);
+    scheduler.Update(State(0.0f));
+    full &= Is(scheduler.Update(State(drift)), OsmUpdateKind::Partial, 0, 3);
+    full &= Is(scheduler.Update(State(settings.FullLightAngle * 2.0f)), OsmUpdateKind::Full, 0, 8);
+    full &= Is(scheduler.Update(State(settings.FullLightAngle * 2.0f)), OsmUpdateKind::Reuse, 0, 0);
+    scheduler.Invalidate();
+    full &= Is(scheduler.Update(State(settings.FullLightAngle * 2.0f)), OsmUpdateKind::Full, 0, 8);
+    ok &= Report("full refresh", full);
+
+    // Nothing but the wind moves: sways above the amplitude, then calms down below it
+    scheduler = OsmScheduler(settings);
+    const float sway = settings.SwayAmplitude * 1.2f, calm = settings.SwayAmplitude * 0.8f;
+    bool swaying = Is(scheduler.Update(State(0.0f, 0.0f, sway)), OsmUpdateKind::Full, 0, 8);
+    for (int cycle = 0; cycle < 5; cycle++) swaying &= FullCycle(scheduler, State(0.0f, 0.0f, sway));
+    swaying &= FullCycle(scheduler, State(0.0f, 0.0f, calm));
+    for (int frame = 0; frame < 10; frame++) swaying &= Is(scheduler.Update(State(0.0f, 0.0f, calm)), OsmUpdateKind::Reuse, 0, 0);
+    swaying &= scheduler.Stats().FullRefreshes == 1 && scheduler.Stats().TilesRendered == 8 + 6 * 8;
+    ok &= Report("sway", swaying);
+    return ok;
+}
+
+static void Benchmark(uint32_t framesPerPhase) {
+    // Default settings, as FramePipeline uses them
+    OsmScheduler scheduler;
+    const OsmSchedulerSettings& settings = scheduler.Settings();
+    const char* phases[] = { "static", "small drift", "jump", "swaying" };
+    printf("\n%u frames per phase, %u bands, %u per partial frame\n", framesPerPhase, settings.TileCount, settings.TilesPerFrame);
+    printf("  phase          full  partial   reuse   tiles   saved\n");
+    uint64_t tiles = 0, tilesIfAlwaysFull = 0, updates = 0;
+    double updateMs = 0.0;
+    float angle = 0.0f;
+    for (uint32_t phase = 0; phase < 4; phase++) {
+        scheduler.ResetStats();
+        for (uint32_t frame = 0; frame < framesPerPhase; frame++) {
+            float wind = 0.0f;
+            if (phase == 1) angle += settings.ReuseLightAngle * 0.25f; // A slow sun: a new cycle every few frames
+            if (phase == 2 && frame % 30 == 0) angle += settings.FullLightAngle * 2.0f;
+            if (phase == 3) wind = settings.SwayAmplitude * 2.0f;
+            const Clock::time_point start = Clock::now();
+            scheduler.Update(State(angle, 0.0f, wind));
+            updateMs += MillisecondsSince(start);
+            updates++;
+        }
+        const OsmSchedulerStats& stats = scheduler.Stats();
+        printf("  %-12s %6llu %8llu %7llu %7llu %6.1f%%\n", phases[phase], (unsigned long long)stats.FullRefreshes,
+               (unsigned long long)stats.PartialRefreshes, (unsigned long long)stats.Reuses, (unsigned long long)stats.TilesRendered,
+               100.0 * stats.SavedFraction());
+        tiles += stats.TilesRendered;
+        tilesIfAlwaysFull += stats.TilesIfAlwaysFull;
+    }
+    printf("  %-12s %6s %8s %7s %7llu %6.1f%%\n", "all", "", "", "", (unsigned long long)tiles, 100.0 * (1.0 - (double)tiles / tilesIfAlwaysFull));
+    printf("  update              %8.1f ns\n", updateMs * 1e6 / updates);
+}
+
+int main(int argc, char** argv) {
+    const uint32_t framesPerPhase = argc > 1 ? (uint32_t)std::max(atoi(argv[1]), 1) : 240;
+    bool ok = Check();
+    Benchmark(framesPerPhase);
+    return ok ? 0 : 1;
+}
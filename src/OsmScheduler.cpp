@@ -0,0 +1,101 @@
+#include "OsmScheduler.h"
+
+OsmScheduler::OsmScheduler(const OsmSchedulerSettings& settings)
+    : m_settings(settings) {
+    m_settings.TileCount = std::max(m_settings.TileCount, 1u);
+    m_settings.TilesPerFrame = std::clamp(m_settings.TilesPerFrame, 1u, m_settings.TileCount);
+}
+
+float OsmScheduler::LightAngle(const OsmSceneState& a, const OsmSceneState& b) {
+    float cosAngle = Dot(Normalize(a.LightDirection), Normalize(b.LightDirection));
+    return std::acos(std::clamp(cosAngle, -1.0f, 1.0f));
+}
+
+float OsmScheduler::BoundsChange(const OsmSceneState& reference, const OsmSceneState& current) {
+    const Aabb& a = reference.FurBounds;
+    const Aabb& b = current.FurBounds;
+    if (a.IsEmpty() || b.IsEmpty()) return (a.IsEmpty() == b.IsEmpty()) ? 0.0f : 1.0f;
+
+    Float3 size = a.Max - a.Min;
+    float scale = std::max({ size.x, size.y, size.z, 1e-6f });
+
+    Float3 dMin = b.Min - a.Min;
+    Float3 dMax = b.Max - a.Max;
+    float largest = std::max({ std::abs(dMin.x), std::abs(dMin.y), std::abs(dMin.z),
+                               std::abs(dMax.x), std::abs(dMax.y), std::abs(dMax.z) });
+    return largest / scale;
+}
+
+OsmUpdate OsmScheduler::Update(const OsmSceneState& state) {
+    OsmUpdate update;
+    m_stats.Frames++;
+    m_stats.TilesIfAlwaysFull += m_settings.TileCount;
+
+    // Large changes invalidate the light projection itself, so nothing can be kept
+    bool needsFull = !m_valid
+        || LightAngle(m_projection, state) > m_settings.FullLightAngle
+        || BoundsChange(m_projection, state) > m_settings.FullBoundsChange
+        || std::abs(state.WindAmplitude - m_projection.WindAmplitude) > m_settings.FullWindChange;
+
+    if (needsFull) {
+        m_valid = true;
+        m_projection = state;
+        m_reference = state;
+        m_cycleActive = false;
+        m_cursor = 0;
+
+        update.Kind = OsmUpdateKind::Full;
+        update.FirstTile = 0;
+        update.TileCount = m_settings.TileCount;
+        m_stats.FullRefreshes++;
+        m_stats.TilesRendered += update.TileCount;
+        return update;
+    }
+
+    // Small changes since the content was last fully up to date start a time-sliced cycle.
+    // Visibly swaying fur never settles, so it keeps cycling.
+    bool drifted = LightAngle(m_reference, state) > m_settings.ReuseLightAngle
+        || BoundsChange(m_reference, state) > m_settings.ReuseBoundsChange
+        || std::abs(state.WindAmplitude - m_reference.WindAmplitude) > m_settings.ReuseWindChange
+        || state.WindAmplitude > m_settings.SwayAmplitude;
+
+    if (!m_cycleActive && drifted) {
+        m_cycleActive = true;
+        m_cycleStart = state;
+        m_cursor = 0;
+    }
+
+    if (!m_cycleActive) {
+        update.Kind = OsmUpdateKind::Reuse;
+        m_stats.Reuses++;
+        return update;
+    }
+
+    update.Kind = OsmUpdateKind::Partial;
+    update.FirstTile = m_cursor;
+    update.TileCount = std::min(m_settings.TilesPerFrame, m_settings.TileCount - m_cursor);
+    m_cursor += update.TileCount;
+
+    if (m_cursor >= m_settings.TileCount) {
+        // Every band has been redrawn since the cycle began
+        m_cycleActive = false;
+        m_cursor = 0;
+        m_reference = m_cycleStart;
+    }
+
+    m_stats.PartialRefreshes++;
+    m_stats.TilesRendered += update.TileCount;
+    return update;
+}
+
+OsmTileRect OsmScheduler::TileRange(uint32_t firstTile, uint32_t tileCount, uint32_t resolution) const {
+    uint32_t tiles = m_settings.TileCount;
+    uint32_t lastTile = std::min(firstTile + tileCount, tiles);
+
+    OsmTileRect rect;
+    rect.Left = 0;
+    rect.Right = resolution;
+    rect.Top = (uint32_t)((uint64_t)resolution * firstTile / tiles);
+    rect.Bottom = (uint32_t)((uint64_t)resolution * lastTile / tiles);
+    return rect;
+}
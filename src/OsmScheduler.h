@@ -0,0 +1,98 @@
+#pragma once
+#include "CoreMath.h"
+
+// Decides how much of the opacity shadow map to re-render each frame.
+// The OSM only depends on the light, where the fur is and how hard the wind moves it, so:
+//   - nothing moved beyond the reuse thresholds -> keep last frame's OSM
+//   - small changes -> time-slice: refresh a few light-space bands per frame, round-robin
+//   - large changes -> full refresh, and a new light projection
+// Partial refreshes keep rendering with the projection of the last full refresh so the bands
+// stay consistent with each other; the caller must use ProjectionState() for the light matrices.
+
+struct OsmSceneState {
+    Float3 LightDirection = { 0.0f, 0.0f, 1.0f }; // Normalized, pointing from the light into the scene
+    Aabb FurBounds;                               // World-space bounds of the displaced fur
+    float WindAmplitude = 0.0f;                   // FrameCB::WindStrength
+};
+
+struct OsmSchedulerSettings {
+    uint32_t TileCount = 8;        // Light-space bands (horizontal strips) the map is split into
+    uint32_t TilesPerFrame = 2;    // Bands refreshed per frame while time-slicing
+
+    float ReuseLightAngle = 0.002f; // Radians
+    float FullLightAngle = 0.035f;
+    float ReuseBoundsChange = 0.001f; // Relative to the largest extent of the projected bounds
+    float FullBoundsChange = 0.01f;   // Keep below the light fit's margin (2%) so partials never clip
+    float ReuseWindChange = 0.01f;
+    float FullWindChange = 0.1f;
+    float SwayAmplitude = 0.05f;    // Wind strength above which the fur visibly sways and keeps refreshing
+};
+
+enum class OsmUpdateKind {
+    Reuse,
+    Partial,
+    Full
+};
+
+struct OsmUpdate {
+    OsmUpdateKind Kind = OsmUpdateKind::Full;
+    uint32_t FirstTile = 0;
+    uint32_t TileCount = 0;
+
+    bool RendersAnything() const { return Kind != OsmUpdateKind::Reuse; }
+};
+
+struct OsmSchedulerStats {
+    uint64_t Frames = 0;
+    uint64_t FullRefreshes = 0;
+    uint64_t PartialRefreshes = 0;
+    uint64_t Reuses = 0;
+    uint64_t TilesRendered = 0;
+    uint64_t TilesIfAlwaysFull = 0; // What re-rendering the whole map every frame would have cost
+
+    // Fraction of OSM raster work avoided compared to a full refresh every frame
+    double SavedFraction() const {
+        return TilesIfAlwaysFull ? 1.0 - (double)TilesRendered / (double)TilesIfAlwaysFull : 0.0;
+    }
+};
+
+struct OsmTileRect {
+    uint32_t Left, Top, Right, Bottom;
+};
+
+class OsmScheduler {
+public:
+    explicit OsmScheduler(const OsmSchedulerSettings& settings = OsmSchedulerSettings());
+
+    // Call once per frame before rendering the OSM
+    OsmUpdate Update(const OsmSceneState& state);
+
+    // Forces the next Update to do a full refresh (resize, parameter edits, device reset...)
+    void Invalidate() { m_valid = false; }
+
+    // Scene state of the last full refresh; the light projection must be built from this
+    const OsmSceneState& ProjectionState() const { return m_projection; }
+
+    const OsmSchedulerSettings& Settings() const { return m_settings; }
+    const OsmSchedulerStats& Stats() const { return m_stats; }
+    void ResetStats() { m_stats = {}; }
+
+    // Pixel rect of a range of bands in a resolution x resolution map
+    OsmTileRect TileRange(uint32_t firstTile, uint32_t tileCount, uint32_t resolution) const;
+
+    // Change metrics, exposed for tuning
+    static float LightAngle(const OsmSceneState& a, const OsmSceneState& b);
+    static float BoundsChange(const OsmSceneState& reference, const OsmSceneState& current);
+
+private:
+    OsmSchedulerSettings m_settings;
+    OsmSchedulerStats m_stats;
+
+    bool m_valid = false;
+    OsmSceneState m_projection; // State of the last full refresh
+    OsmSceneState m_reference;  // State the map content fully reflects
+    OsmSceneState m_cycleStart; // State when the running partial cycle began
+
+    bool m_cycleActive = false;
+    uint32_t m_cursor = 0;
+};
@@ -0,0 +1,65 @@
+#include "RadixSort.h"
+#include <cstring>
+
+uint32_t RadixSort::FloatKey(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    // Negative floats sort in reverse, so flip all their bits; positives only need the sign set
+    uint32_t mask = (bits & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+    return bits ^ mask;
+}
+
+void RadixSort::SortPairs(std::vector<uint32_t>& keys, std::vector<uint32_t>& values,
+                          std::vector<uint32_t>& scratchKeys, std::vector<uint32_t>& scratchValues) {
+    const size_t count = keys.size();
+    if (count < 2) return;
+
+    // All four histograms in one read of the keys
+    uint32_t histograms[4][256] = {};
+    for (uint32_t key : keys) {
+        histograms[0][key & 0xff]++;
+        histograms[1][(key >> 8) & 0xff]++;
+        histograms[2][(key >> 16) & 0xff]++;
+        histograms[3][key >> 24]++;
+    }
+
+    scratchKeys.resize(count);
+    scratchValues.resize(count);
+    std::vector<uint32_t>* srcKeys = &keys;
+    std::vector<uint32_t>* srcValues = &values;
+    std::vector<uint32_t>* dstKeys = &scratchKeys;
+    std::vector<uint32_t>* dstValues = &scratchValues;
+
+    for (int pass = 0; pass < 4; pass++) {
+        uint32_t* histogram = histograms[pass];
+        const uint32_t shift = pass * 8;
+
+        // Every key lands in the same bucket: this byte doesn't affect the order
+        if (histogram[((*srcKeys)[0] >> shift) & 0xff] == count) continue;
+
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for (int b = 0; b < 256; b++) {
+            offsets[b] = sum;
+            sum += histogram[b];
+        }
+
+        const uint32_t* sk = srcKeys->data();
+        const uint32_t* sv = srcValues->data();
+        uint32_t* dk = dstKeys->data();
+        uint32_t* dv = dstValues->data();
+        for (size_t i = 0; i < count; i++) {
+            uint32_t slot = offsets[(sk[i] >> shift) & 0xff]++;
+            dk[slot] = sk[i];
+            dv[slot] = sv[i];
+        }
+        std::swap(srcKeys, dstKeys);
+        std::swap(srcValues, dstValues);
+    }
+
+    // An odd number of passes leaves the result in the scratch buffers
+    if (srcKeys != &keys) {
+        keys.swap(scratchKeys);
+        values.swap(scratchValues);
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// LSD radix sort of 32-bit keys carrying a 32-bit payload, 8 bits per pass.
+// Passes in which every key has the same byte are skipped, so keys from a narrow range
+// (e.g. view depths of one object) usually take two or three passes instead of four.
+class RadixSort {
+public:
+    // Order-preserving float -> uint32 mapping, negatives included
+    static uint32_t FloatKey(float value);
+
+    // Stable ascending sort of 'keys', permuting 'values' alongside. The scratch vectors are
+    // resized as needed and can be kept around to avoid per-frame allocations.
+    static void SortPairs(std::vector<uint32_t>& keys, std::vector<uint32_t>& values,
+                          std::vector<uint32_t>& scratchKeys, std::vector<uint32_t>& scratchValues);
+};
@@ -0,0 +1,192 @@
+#include "Raycaster.h"
+#include "Simd.h"
+#include "Timing.h"
+#include <bit>
+
+// Depth-first: at most three siblings wait per level, so this covers trees 80 levels deep
+static constexpr int StackSize = 256;
+
+// Zero direction components would give 0 * inf = NaN in the slab test
+static float SafeInverse(float d) {
+    const float tiny = 1e-30f;
+    return 1.0f / (std::fabs(d) > tiny ? d : (d < 0.0f ? -tiny : tiny));
+}
+
+static uint32_t ValidChildren(const Bvh4Node& node) {
+    uint32_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        if (node.Child[i] != Bvh4Node::InvalidChild) mask |= 1u << i;
+    }
+    return mask;
+}
+
+// Moller-Trumbore, two-sided. A zero determinant makes u infinite or NaN, which fails the tests.
+static bool HitTriangle(const Float3& v0, const Float3& e1, const Float3& e2, const Float3& origin, const Float3& dir, float tMax) {
+    Float3 p = Cross(dir, e2);
+    float inv = 1.0f / Dot(e1, p);
+    Float3 s = origin - v0;
+    float u = Dot(s, p) * inv;
+    if (!(u >= 0.0f && u <= 1.0f)) return false;
+    Float3 q = Cross(s, e1);
+    float v = Dot(dir, q) * inv;
+    if (!(v >= 0.0f && u + v <= 1.0f)) return false;
+    float t = Dot(e2, q) * inv;
+    return t > 0.0f && t < tMax;
+}
+
+void TriangleRaycaster::Build(const float* positions, size_t stride, const uint32_t* indices, size_t triangleCount) {
+    Clock::time_point start = Clock::now();
+    auto position = [&](uint32_t v) {
+        const float* p = positions + (size_t)v * stride;
+        return Float3(p[0], p[1], p[2]);
+    };
+
+    std::vector<Aabb> bounds(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int c = 0; c < 3; c++) bounds[t].Expand(position(indices[t * 3 + c]));
+    }
+    m_bvh.Build(bounds, 0.0f);
+
+    const std::vector<uint32_t>& order = m_bvh.PrimitiveIndices();
+    m_triangles.resize(triangleCount);
+    for (size_t slot = 0; slot < triangleCount; slot++) {
+        const uint32_t* tri = indices + (size_t)order[slot] * 3;
+        Float3 v0 = position(tri[0]);
+        m_triangles[slot] = { v0, position(tri[1]) - v0, position(tri[2]) - v0 };
+    }
+
+    m_stats.Triangles = (uint32_t)triangleCount;
+    m_stats.BuildMs = MillisecondsSince(start);
+}
+
+bool TriangleRaycaster::Occluded(const Float3& origin, const Float3& dir, float tMax) const {
+    if (m_triangles.empty() || !(tMax > 0.0f)) return false;
+    const std::vector<Bvh4Node>& nodes = m_bvh.Nodes();
+    const Float3 inv(SafeInverse(dir.x), SafeInverse(dir.y), SafeInverse(dir.z));
+#if PELAGE_SSE2
+    const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+    const __m128 ix = _mm_set1_ps(inv.x), iy = _mm_set1_ps(inv.y), iz = _mm_set1_ps(inv.z);
+    const __m128 zero = _mm_setzero_ps(), far = _mm_set1_ps(tMax);
+#endif
+
+    uint32_t stack[StackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Bvh4Node& node = nodes[stack[--top]];
+
+        // One lane per child box
+#if PELAGE_SSE2
+        __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinX), ox), ix), t2x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxX), ox), ix);
+        __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinY), oy), iy), t2y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxY), oy), iy);
+        __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinZ), oz), iz), t2z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxZ), oz), iz);
+        __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)), _mm_max_ps(_mm_min_ps(t1z, t2z), zero));
+        __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)), _mm_min_ps(_mm_max_ps(t1z, t2z), far));
+        uint32_t hits = (uint32_t)_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) & ValidChildren(node);
+#else
+        uint32_t hits = 0;
+        for (int i = 0; i < 4; i++) {
+            float t1x = (node.MinX[i] - origin.x) * inv.x, t2x = (node.MaxX[i] - origin.x) * inv.x;
+            float t1y = (node.MinY[i] - origin.y) * inv.y, t2y = (node.MaxY[i] - origin.y) * inv.y;
+            float t1z = (node.MinZ[i] - origin.z) * inv.z, t2z = (node.MaxZ[i] - origin.z) * inv.z;
+            float tNear = std::max({ std::min(t1x, t2x), std::min(t1y, t2y), std::min(t1z, t2z), 0.0f });
+            float tFar = std::min({ std::max(t1x, t2x), std::max(t1y, t2y), std::max(t1z, t2z), tMax });
+            if (tNear <= tFar) hits |= 1u << i;
+        }
+        hits &= ValidChildren(node);
+#endif
+
+        for (; hits; hits &= hits - 1) {
+            int i = std::countr_zero(hits);
+            if (node.Count[i] == 0) {
+                stack[top++] = node.Child[i];
+                continue;
+            }
+            for (uint32_t k = node.Child[i]; k < node.Child[i] + node.Count[i]; k++) {
+                const Triangle& tri = m_triangles[k];
+                if (HitTriangle(tri.V0, tri.E1, tri.E2, origin, dir, tMax)) return true;
+            }
+        }
+    }
+    return false;
+}
+
+uint32_t TriangleRaycaster::Occluded4(const RayPacket4& packet) const {
+#if PELAGE_SSE2
+    if (m_triangles.empty()) return 0;
+    const std::vector<Bvh4Node>& nodes = m_bvh.Nodes();
+
+    // One lane per ray
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 ox = _mm_loadu_ps(packet.OriginX), oy = _mm_loadu_ps(packet.OriginY), oz = _mm_loadu_ps(packet.OriginZ);
+    const __m128 dx = _mm_loadu_ps(packet.DirX), dy = _mm_loadu_ps(packet.DirY), dz = _mm_loadu_ps(packet.DirZ);
+    const __m128 far = _mm_loadu_ps(packet.TMax);
+    alignas(16) float inv[3][4];
+    for (int lane = 0; lane < 4; lane++) {
+        inv[0][lane] = SafeInverse(packet.DirX[lane]);
+        inv[1][lane] = SafeInverse(packet.DirY[lane]);
+        inv[2][lane] = SafeInverse(packet.DirZ[lane]);
+    }
+    const __m128 ix = _mm_load_ps(inv[0]), iy = _mm_load_ps(inv[1]), iz = _mm_load_ps(inv[2]);
+    const uint32_t active = (uint32_t)_mm_movemask_ps(_mm_cmpgt_ps(far, zero));
+    uint32_t occluded = 0;
+    if (!active) return 0;
+
+    uint32_t stack[StackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Bvh4Node& node = nodes[stack[--top]];
+        for (int i = 0; i < 4; i++) {
+            if (node.Child[i] == Bvh4Node::InvalidChild) continue;
+            const uint32_t live = active & ~occluded;
+
+            __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MinX[i]), ox), ix), t2x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MaxX[i]), ox), ix);
+            __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MinY[i]), oy), iy), t2y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MaxY[i]), oy), iy);
+            __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MinZ[i]), oz), iz), t2z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MaxZ[i]), oz), iz);
+            __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)), _mm_max_ps(_mm_min_ps(t1z, t2z), zero));
+            __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)), _mm_min_ps(_mm_max_ps(t1z, t2z), far));
+            if (!((uint32_t)_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) & live)) continue;
+
+            if (node.Count[i] == 0) {
+                stack[top++] = node.Child[i];
+                continue;
+            }
+
+            // Leaf: each triangle against the four rays
+            for (uint32_t k = node.Child[i]; k < node.Child[i] + node.Count[i]; k++) {
+                const Triangle& tri = m_triangles[k];
+                __m128 e1x = _mm_set1_ps(tri.E1.x), e1y = _mm_set1_ps(tri.E1.y), e1z = _mm_set1_ps(tri.E1.z);
+                __m128 e2x = _mm_set1_ps(tri.E2.x), e2y = _mm_set1_ps(tri.E2.y), e2z = _mm_set1_ps(tri.E2.z);
+                __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+                __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+                __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+                __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+                __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+                __m128 sx = _mm_sub_ps(ox, _mm_set1_ps(tri.V0.x)), sy = _mm_sub_ps(oy, _mm_set1_ps(tri.V0.y)), sz = _mm_sub_ps(oz, _mm_set1_ps(tri.V0.z));
+                __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+                __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+                __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+                __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+                __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+                __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+                // NaN lanes (zero determinant) fail every comparison
+                __m128 hit = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+                hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+                hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, far)));
+                occluded |= (uint32_t)_mm_movemask_ps(hit) & active;
+                if (occluded == active) return occluded;
+            }
+        }
+    }
+    return occluded;
+#else
+    uint32_t occluded = 0;
+    for (int lane = 0; lane < 4; lane++) {
+        Float3 origin(packet.OriginX[lane], packet.OriginY[lane], packet.OriginZ[lane]);
+        Float3 dir(packet.DirX[lane], packet.DirY[lane], packet.DirZ[lane]);
+        if (Occluded(origin, dir, packet.TMax[lane])) occluded |= 1u << lane;
+    }
+    return occluded;
+#endif
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Bvh.h"
+#include "CoreMath.h"
+#include <vector>
+
+// Occlusion rays against a static triangle mesh, for offline baking. The triangles go into a
+// Bvh4 (one primitive per triangle, no inflation) and are copied in leaf order as a vertex and
+// two edges, so a leaf is one contiguous run. Traversal is any-hit: a ray stops at the first
+// triangle closer than its TMax. Triangles are two-sided.
+//
+// Occluded traces one ray against the four child boxes of a node at once; Occluded4 traces a
+// packet of four rays (one per SSE lane) through the tree together, visiting a node if any live
+// ray hits it and retiring rays as they hit, which pays off when the rays are coherent (the
+// hemisphere rays of one baking point share their origin).
+
+struct RayPacket4 {
+    float OriginX[4], OriginY[4], OriginZ[4];
+    float DirX[4], DirY[4], DirZ[4];
+    float TMax[4]; // Lanes with TMax <= 0 are inactive
+};
+
+struct RaycasterStats {
+    uint32_t Triangles = 0;
+    double BuildMs = 0.0;
+};
+
+class TriangleRaycaster {
+public:
+    // 'positions' holds 'stride' floats per vertex with the position first
+    void Build(const float* positions, size_t stride, const uint32_t* indices, size_t triangleCount);
+
+    // True if the ray hits a triangle at 0 < t < tMax. 'dir' need not be normalized; t is in
+    // units of its length.
+    bool Occluded(const Float3& origin, const Float3& dir, float tMax) const;
+    // Bit i set when ray i of the packet is occluded
+    uint32_t Occluded4(const RayPacket4& packet) const;
+
+    bool Empty() const { return m_triangles.empty(); }
+    const Bvh4& Tree() const { return m_bvh; }
+    const RaycasterStats& Stats() const { return m_stats; }
+
+private:
+    struct Triangle {
+        Float3 V0, E1, E2;
+    };
+
+    Bvh4 m_bvh;
+    std::vector<Triangle> m_triangles; // Leaf order
+    RaycasterStats m_stats;
+};
@@ -0,0 +1,309 @@
+#include "RenderGraph.h"
+#include <algorithm>
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+RgResource RenderGraph::CreateTexture(const std::string& name, const RgTextureDesc& desc) {
+    Resource resource;
+    resource.Name = name;
+    resource.Desc = desc;
+    m_resources.push_back(resource);
+    return (RgResource)m_resources.size() - 1;
+}
+
+RgResource RenderGraph::ImportTexture(const std::string& name, uint32_t initialState, uint32_t finalState) {
+    Resource resource;
+    resource.Name = name;
+    resource.Imported = true;
+    resource.InitialState = initialState;
+    resource.FinalState = finalState;
+    m_resources.push_back(resource);
+    return (RgResource)m_resources.size() - 1;
+}
+
+RgPass RenderGraph::AddPass(const std::string& name, std::function<void()> execute) {
+    Pass pass;
+    pass.Name = name;
+    pass.Execute = std::move(execute);
+    m_passes.push_back(std::move(pass));
+    return (RgPass)m_passes.size() - 1;
+}
+
+void RenderGraph::Read(RgPass pass, RgResource resource, uint32_t state) {
+    // Several declarations of one resource in a pass merge into one combined state
+    for (Access& access : m_passes[pass].Accesses) {
+        if (access.Resource == resource) {
+            access.State |= state;
+            return;
+        }
+    }
+    m_passes[pass].Accesses.push_back({ resource, state, false });
+}
+
+void RenderGraph::Write(RgPass pass, RgResource resource, uint32_t state) {
+    for (Access& access : m_passes[pass].Accesses) {
+        if (access.Resource == resource) {
+            access.State |= state;
+            access.Write = true;
+            return;
+        }
+    }
+    m_passes[pass].Accesses.push_back({ resource, state, true });
+}
+
+void RenderGraph::SetSideEffects(RgPass pass) {
+    m_passes[pass].SideEffects = true;
+}
+
+void RenderGraph::Compile() {
+    m_stats = RenderGraphStats();
+    m_stats.PassCount = (uint32_t)m_passes.size();
+    m_finalBarriers.clear();
+    for (Pass& pass : m_passes) {
+        pass.Barriers.clear();
+        pass.Culled = false;
+    }
+
+    CullPasses();
+
+    for (Resource& resource : m_resources) {
+        resource.FirstPass = NoPass;
+        resource.LastPass = NoPass;
+    }
+    for (uint32_t p = 0; p < (uint32_t)m_passes.size(); p++) {
+        if (m_passes[p].Culled) continue;
+        for (const Access& access : m_passes[p].Accesses) {
+            Resource& resource = m_resources[access.Resource];
+            if (resource.FirstPass == NoPass) {
+                resource.FirstPass = p;
+                if (!resource.Imported) resource.InitialState = access.State;
+            }
+            resource.LastPass = p;
+        }
+    }
+
+    AllocateTransients();
+    BuildBarriers();
+}
+
+void RenderGraph::CullPasses() {
+    // Reference counting from the outputs backwards: a resource is needed if a surviving pass
+    // reads it or it is imported (someone outside the graph sees it); a pass survives if it
+    // writes a needed resource or has side effects.
+    std::vector<uint32_t> passRefs(m_passes.size(), 0);
+    std::vector<uint32_t> resourceRefs(m_resources.size(), 0);
+    std::vector<std::vector<RgPass>> writers(m_resources.size());
+
+    for (uint32_t p = 0; p < (uint32_t)m_passes.size(); p++) {
+        for (const Access& access : m_passes[p].Accesses) {
+            if (access.Write) {
+                passRefs[p]++;
+                writers[access.Resource].push_back(p);
+            } else {
+                resourceRefs[access.Resource]++;
+            }
+        }
+    }
+    for (uint32_t r = 0; r < (uint32_t)m_resources.size(); r++) {
+        if (m_resources[r].Imported) resourceRefs[r]++;
+    }
+
+    std::vector<RgResource> unreferenced;
+    auto cullPass = [&](RgPass p) {
+        m_passes[p].Culled = true;
+        m_stats.CulledPasses++;
+        for (const Access& access : m_passes[p].Accesses) {
+            if (!access.Write && --resourceRefs[access.Resource] == 0) unreferenced.push_back(access.Resource);
+        }
+    };
+
+    for (uint32_t p = 0; p < (uint32_t)m_passes.size(); p++) {
+        if (passRefs[p] == 0 && !m_passes[p].SideEffects) cullPass(p);
+    }
+    for (uint32_t r = 0; r < (uint32_t)m_resources.size(); r++) {
+        if (resourceRefs[r] == 0) unreferenced.push_back(r);
+    }
+
+    while (!unreferenced.empty()) {
+        RgResource r = unreferenced.back();
+        unreferenced.pop_back();
+        for (RgPass p : writers[r]) {
+            if (m_passes[p].Culled || m_passes[p].SideEffects) continue;
+            if (--passRefs[p] == 0) cullPass(p);
+        }
+    }
+}
+
+void RenderGraph::AllocateTransients() {
+    std::vector<RgResource> transients;
+    for (uint32_t r = 0; r < (uint32_t)m_resources.size(); r++) {
+        if (!m_resources[r].Imported && m_resources[r].FirstPass != NoPass) transients.push_back(r);
+    }
+
+    // Largest first packs best; ties by index keep the layout stable between frames
+    std::sort(transients.begin(), transients.end(), [&](RgResource a, RgResource b) {
+        if (m_resources[a].Desc.SizeInBytes != m_resources[b].Desc.SizeInBytes) {
+            return m_resources[a].Desc.SizeInBytes > m_resources[b].Desc.SizeInBytes;
+        }
+        return a < b;
+    });
+
+    std::vector<RgResource> placed;
+    for (RgResource r : transients) {
+        Resource& resource = m_resources[r];
+        uint64_t alignment = std::max<uint64_t>(resource.Desc.Alignment, 1);
+        uint64_t size = AlignUp(resource.Desc.SizeInBytes, alignment);
+        m_stats.TransientBytes += size;
+
+        // Memory of everything alive at the same time, in address order; take the first gap
+        std::vector<RgResource> conflicts;
+        for (RgResource q : placed) {
+            const Resource& other = m_resources[q];
+            if (other.LastPass < resource.FirstPass || resource.LastPass < other.FirstPass) continue;
+            conflicts.push_back(q);
+        }
+        std::sort(conflicts.begin(), conflicts.end(), [&](RgResource a, RgResource b) {
+            return m_resources[a].HeapOffset < m_resources[b].HeapOffset;
+        });
+
+        uint64_t offset = 0;
+        for (RgResource q : conflicts) {
+            const Resource& other = m_resources[q];
+            if (offset + size <= other.HeapOffset) break;
+            offset = std::max(offset, AlignUp(other.HeapOffset + other.Desc.SizeInBytes, alignment));
+        }
+
+        resource.HeapOffset = offset;
+        m_stats.HeapBytes = std::max(m_stats.HeapBytes, offset + size);
+        placed.push_back(r);
+    }
+}
+
+uint64_t RenderGraph::HeapAlignment() const {
+    uint64_t alignment = 65536;
+    for (const Resource& resource : m_resources) {
+        if (!resource.Imported && resource.FirstPass != NoPass) alignment = std::max(alignment, resource.Desc.Alignment);
+    }
+    return alignment;
+}
+
+void RenderGraph::BuildBarriers() {
+    // Within a batch: transients going back to their start state (while their memory is still
+    // theirs), then aliasing barriers, then the transitions for the pass itself
+    enum BatchOrder { OrderRestore = 0, OrderAliasing = 1, OrderTransition = 2 };
+    struct Pending {
+        int Order;
+        RgBarrier Barrier;
+    };
+    std::vector<std::vector<Pending>> batches(m_passes.size() + 1); // Last one is the end of frame
+    const uint32_t finalBatch = (uint32_t)m_passes.size();
+
+    // The first surviving pass after 'p', or the end-of-frame batch
+    auto nextPass = [&](uint32_t p) {
+        for (uint32_t q = p + 1; q < (uint32_t)m_passes.size(); q++) {
+            if (!m_passes[q].Culled) return q;
+        }
+        return finalBatch;
+    };
+    uint32_t firstPass = nextPass((uint32_t)-1);
+
+    // Transition from 'before' to 'after' between the use in pass 'from' (NoPass: frame start)
+    // and the use in batch 'to'. Split when other passes run in between.
+    auto addTransition = [&](RgResource r, uint32_t before, uint32_t after, uint32_t from, uint32_t to, int order) {
+        RgBarrier barrier;
+        barrier.Resource = r;
+        barrier.StateBefore = before;
+        barrier.StateAfter = after;
+        uint32_t begin = from == NoPass ? firstPass : nextPass(from);
+        m_stats.Barriers++;
+        if (begin < to) {
+            barrier.Split = RgBarrierSplit::Begin;
+            batches[begin].push_back({ order, barrier });
+            barrier.Split = RgBarrierSplit::End;
+            batches[to].push_back({ order, barrier });
+            m_stats.SplitBarriers++;
+        } else {
+            batches[to].push_back({ order, barrier });
+        }
+    };
+
+    // Aliasing: a transient sharing memory with another one takes it over before its first use.
+    // That holds across frames too, so any overlap at all needs the barrier.
+    for (uint32_t r = 0; r < (uint32_t)m_resources.size(); r++) {
+        const Resource& resource = m_resources[r];
+        if (resource.Imported || resource.FirstPass == NoPass) continue;
+
+        std::vector<RgResource> overlapping;
+        for (uint32_t q = 0; q < (uint32_t)m_resources.size(); q++) {
+            const Resource& other = m_resources[q];
+            if (q == r || other.Imported || other.FirstPass == NoPass) continue;
+            if (other.HeapOffset < resource.HeapOffset + resource.Desc.SizeInBytes &&
+                resource.HeapOffset < other.HeapOffset + other.Desc.SizeInBytes) {
+                overlapping.push_back(q);
+            }
+        }
+        if (overlapping.empty()) continue;
+
+        RgBarrier barrier;
+        barrier.Type = RgBarrierType::Aliasing;
+        barrier.Resource = r;
+        barrier.AliasBefore = overlapping.size() == 1 ? overlapping[0] : RgInvalidResource;
+        batches[resource.FirstPass].push_back({ OrderAliasing, barrier });
+        m_stats.AliasingBarriers++;
+    }
+
+    std::vector<uint32_t> state(m_resources.size());
+    std::vector<uint32_t> lastUse(m_resources.size(), NoPass);
+    std::vector<uint8_t> lastWasWrite(m_resources.size(), 0);
+    for (uint32_t r = 0; r < (uint32_t)m_resources.size(); r++) state[r] = m_resources[r].InitialState;
+
+    for (uint32_t p = 0; p < (uint32_t)m_passes.size(); p++) {
+        if (m_passes[p].Culled) continue;
+        for (const Access& access : m_passes[p].Accesses) {
+            RgResource r = access.Resource;
+            if (state[r] != access.State) {
+                addTransition(r, state[r], access.State, lastUse[r], p, OrderTransition);
+            } else if (access.State == RgStateUnorderedAccess && (access.Write || lastWasWrite[r]) && lastUse[r] != NoPass) {
+                RgBarrier barrier;
+                barrier.Type = RgBarrierType::Uav;
+                barrier.Resource = r;
+                batches[p].push_back({ OrderTransition, barrier });
+            }
+            state[r] = access.State;
+            lastUse[r] = p;
+            lastWasWrite[r] = access.Write ? 1 : 0;
+        }
+    }
+
+    // Imported resources end in their final state, split from their last use when possible.
+    // Transients go back to their first-use state straight after their last use so the next
+    // frame starts from the same place; that must not be split, as the memory may be aliased.
+    for (uint32_t r = 0; r < (uint32_t)m_resources.size(); r++) {
+        const Resource& resource = m_resources[r];
+        if (lastUse[r] == NoPass) continue;
+        if (resource.Imported) {
+            if (state[r] != resource.FinalState) {
+                addTransition(r, state[r], resource.FinalState, lastUse[r], finalBatch, OrderTransition);
+            }
+        } else if (state[r] != resource.InitialState) {
+            addTransition(r, state[r], resource.InitialState, lastUse[r], nextPass(lastUse[r]), OrderRestore);
+        }
+    }
+
+    for (uint32_t b = 0; b < (uint32_t)batches.size(); b++) {
+        std::stable_sort(batches[b].begin(), batches[b].end(), [](const Pending& a, const Pending& c) { return a.Order < c.Order; });
+        std::vector<RgBarrier>& out = b == finalBatch ? m_finalBarriers : m_passes[b].Barriers;
+        for (const Pending& pending : batches[b]) out.push_back(pending.Barrier);
+    }
+}
+
+void RenderGraph::Execute(const std::function<void(const std::vector<RgBarrier>&)>& submitBarriers) {
+    for (Pass& pass : m_passes) {
+        if (pass.Culled) continue;
+        if (!pass.Barriers.empty()) submitBarriers(pass.Barriers);
+        if (pass.Execute) pass.Execute();
+    }
+    if (!m_finalBarriers.empty()) submitBarriers(m_finalBarriers);
+}
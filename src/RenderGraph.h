@@ -0,0 +1,145 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Declarative frame graph. Passes declare which resources they read and write, and in which
+// state; Compile then works out, without touching any graphics API:
+//  - which passes can be culled because nothing consumes their output,
+//  - the state transitions in between, batched per pass and split (begin early / end late)
+//    when there is a gap between two uses,
+//  - where transient textures live in one shared heap, aliasing those whose lifetimes don't
+//    overlap, plus the aliasing barriers this needs.
+// The backend (FurRenderer) creates the physical resources from the compiled layout and turns
+// RgBarrier lists into ResourceBarrier calls while Execute runs the passes in order.
+//
+// Imported resources (swap chain, persistent caches such as the OSM) keep their memory and
+// are returned to their final state at the end of the frame. Transient textures start every
+// frame in the state of their first use; a transient placed over another one must be cleared
+// or discarded by its first writer, as D3D12 requires for aliased render targets.
+
+using RgResource = uint32_t;
+using RgPass = uint32_t;
+static constexpr RgResource RgInvalidResource = 0xffffffffu;
+
+// Bit values match D3D12_RESOURCE_STATES so the backend can cast them directly
+enum RgState : uint32_t {
+    RgStateCommon = 0,
+    RgStatePresent = 0,
+    RgStateRenderTarget = 0x4,
+    RgStateUnorderedAccess = 0x8,
+    RgStateDepthWrite = 0x10,
+    RgStateDepthRead = 0x20,
+    RgStateNonPixelShaderResource = 0x40,
+    RgStatePixelShaderResource = 0x80,
+    RgStateCopyDest = 0x400,
+    RgStateCopySource = 0x800,
+    RgStateResolveDest = 0x1000,
+    RgStateResolveSource = 0x2000,
+};
+
+struct RgTextureDesc {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t Format = 0;      // Backend format (DXGI_FORMAT on D3D12)
+    uint32_t SampleCount = 1;
+    bool DepthStencil = false;
+    float ClearValue[4] = {}; // Optimized clear colour, or depth in [0]
+    uint64_t SizeInBytes = 0; // From the backend's allocation query; drives the aliasing
+    uint64_t Alignment = 65536;
+};
+
+enum class RgBarrierType { Transition, Aliasing, Uav };
+enum class RgBarrierSplit { None, Begin, End };
+
+struct RgBarrier {
+    RgBarrierType Type = RgBarrierType::Transition;
+    RgBarrierSplit Split = RgBarrierSplit::None;
+    RgResource Resource = RgInvalidResource;
+    RgResource AliasBefore = RgInvalidResource; // Aliasing only; invalid means "any resource"
+    uint32_t StateBefore = RgStateCommon;
+    uint32_t StateAfter = RgStateCommon;
+};
+
+struct RenderGraphStats {
+    uint32_t PassCount = 0;
+    uint32_t CulledPasses = 0;
+    uint32_t Barriers = 0; // Transitions, counting a split pair once
+    uint32_t SplitBarriers = 0;
+    uint32_t AliasingBarriers = 0;
+    uint64_t TransientBytes = 0; // What the transients would take as separate allocations
+    uint64_t HeapBytes = 0;      // What they take aliased
+};
+
+class RenderGraph {
+public:
+    RgResource CreateTexture(const std::string& name, const RgTextureDesc& desc);
+    RgResource ImportTexture(const std::string& name, uint32_t initialState, uint32_t finalState);
+
+    // 'execute' is called from Execute if the pass survives culling
+    RgPass AddPass(const std::string& name, std::function<void()> execute);
+    void Read(RgPass pass, RgResource resource, uint32_t state);
+    void Write(RgPass pass, RgResource resource, uint32_t state);
+    // Never culled, e.g. a pass that only writes GPU timers
+    void SetSideEffects(RgPass pass);
+
+    void Compile();
+
+    // Calls 'submitBarriers' with each pass's batch (skipped when empty), then the pass,
+    // then the end-of-frame batch.
+    void Execute(const std::function<void(const std::vector<RgBarrier>&)>& submitBarriers);
+
+    // Compiled results
+    bool IsCulled(RgPass pass) const { return m_passes[pass].Culled; }
+    bool IsUsed(RgResource resource) const { return m_resources[resource].FirstPass != NoPass; }
+    bool IsTransient(RgResource resource) const { return !m_resources[resource].Imported; }
+    const std::string& Name(RgResource resource) const { return m_resources[resource].Name; }
+    const RgTextureDesc& Desc(RgResource resource) const { return m_resources[resource].Desc; }
+    uint64_t HeapOffset(RgResource resource) const { return m_resources[resource].HeapOffset; }
+    uint32_t InitialState(RgResource resource) const { return m_resources[resource].InitialState; }
+    uint64_t HeapSize() const { return m_stats.HeapBytes; }
+    uint64_t HeapAlignment() const;
+    const std::vector<RgBarrier>& BarriersBefore(RgPass pass) const { return m_passes[pass].Barriers; }
+    const std::vector<RgBarrier>& FinalBarriers() const { return m_finalBarriers; }
+    uint32_t ResourceCount() const { return (uint32_t)m_resources.size(); }
+    const RenderGraphStats& Stats() const { return m_stats; }
+
+private:
+    static constexpr uint32_t NoPass = 0xffffffffu;
+
+    struct Access {
+        RgResource Resource;
+        uint32_t State;
+        bool Write;
+    };
+
+    struct Pass {
+        std::string Name;
+        std::function<void()> Execute;
+        std::vector<Access> Accesses;
+        std::vector<RgBarrier> Barriers; // Submitted before the pass
+        bool SideEffects = false;
+        bool Culled = false;
+    };
+
+    struct Resource {
+        std::string Name;
+        RgTextureDesc Desc;
+        bool Imported = false;
+        uint32_t InitialState = RgStateCommon; // Transients: state of the first use
+        uint32_t FinalState = RgStateCommon;
+        uint32_t FirstPass = NoPass;
+        uint32_t LastPass = NoPass;
+        uint64_t HeapOffset = 0;
+    };
+
+    void CullPasses();
+    void AllocateTransients();
+    void BuildBarriers();
+
+    std::vector<Pass> m_passes;
+    std::vector<Resource> m_resources;
+    std::vector<RgBarrier> m_finalBarriers;
+    RenderGraphStats m_stats;
+};
@@ -0,0 +1,408 @@
+// Headless render graph benchmark. First checks RenderGraph::Compile on graphs with known answers:
+//   culling            a pass whose transient nobody reads goes, with the passes feeding only it;
+//                      side effects and imported outputs keep theirs
+//   split barriers     a transition with passes between two uses begins after the first and ends
+//                      before the second; adjacent uses get one plain barrier
+//   transient restore  transients go back to their first-use state straight after their last use,
+//                      unsplit, ahead of the other barriers of that batch
+//   aliasing           transients with disjoint lifetimes share memory behind aliasing barriers,
+//                      so the heap is smaller than the transients; overlapping ones never share
+//   frame passes       the exact barrier list of OSM -> Skin -> FurDepth -> Fur -> Resolve
+//   state replay       every graph above, and the renderer's other frame shapes, replayed through
+//                      its barriers: each pass finds its resources in the declared state
+// Then compiles random graphs of many passes and reports the compile time and the memory aliasing
+// saves, and the heap of the frame passes at 1080p and 4K.
+// Usage: PelageRenderGraphBench [passes]
+#include "BenchReport.h"
+#include "RenderGraph.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static uint64_t g_random = 1;
+
+static uint32_t Random(uint32_t range) {
+    g_random = g_random * 6364136223846793005ull + 1442695040888963407ull;
+    return (uint32_t)((g_random >> 33) % range);
+}
+
+static RgTextureDesc Texture(uint64_t sizeInBytes, uint64_t alignment = 65536) {
+    RgTextureDesc desc;
+    desc.SizeInBytes = sizeInBytes;
+    desc.Alignment = alignment;
+    return desc;
+}
+
+static const char* StateName(uint32_t state) {
+    switch (state) {
+    case RgStateCommon: return "Present";
+    case RgStateRenderTarget: return "RT";
+    case RgStateDepthWrite: return "DW";
+    case RgStateDepthRead: return "DR";
+    case RgStatePixelShaderResource: return "PSR";
+    case RgStateResolveSource: return "ResolveSrc";
+    case RgStateResolveDest: return "ResolveDst";
+    default: return "?";
+    }
+}
+
+// One batch as "Name Before>After [begin|end], ...", aliasing barriers as "alias Name"
+static std::string Describe(const RenderGraph& graph, const std::vector<RgBarrier>& barriers) {
+    std::string text;
+    for (const RgBarrier& barrier : barriers) {
+        if (!text.empty()) text += ", ";
+        if (barrier.Type == RgBarrierType::Aliasing) {
+            text += "alias " + graph.Name(barrier.Resource);
+            continue;
+        }
+        text += graph.Name(barrier.Resource) + " " + StateName(barrier.StateBefore) + ">" + StateName(barrier.StateAfter);
+        if (barrier.Split == RgBarrierSplit::Begin) text += " begin";
+        if (barrier.Split == RgBarrierSplit::End) text += " end";
+    }
+    return text;
+}
+
+static bool ExpectBatch(const RenderGraph& graph, const std::vector<RgBarrier>& barriers, const char* expected) {
+    const std::string actual = Describe(graph, barriers);
+    if (actual == expected) return true;
+    printf("  expected: %s\n  actual:   %s\n", expected, actual.c_str());
+    return false;
+}
+
+// Replays a compiled graph the way the backend submits it: a split barrier leaves its resource
+// unusable until the end half, each surviving pass must find what it declared in that state, and
+// the frame must end where the next one starts. 'accesses' repeats the declarations per pass.
+struct Declared {
+    RgPass Pass;
+    RgResource Resource;
+    uint32_t State;
+};
+
+static bool Replay(const RenderGraph& graph, const std::vector<Declared>& accesses, const std::vector<uint32_t>& finalStates) {
+    const uint32_t count = graph.ResourceCount();
+    std::vector<uint32_t> state(count);
+    std::vector<uint8_t> inFlight(count, 0);
+    for (RgResource r = 0; r < count; r++) state[r] = graph.InitialState(r);
+
+    bool valid = true;
+    auto apply = [&](const std::vector<RgBarrier>& barriers) {
+        for (const RgBarrier& barrier : barriers) {
+            if (barrier.Type != RgBarrierType::Transition) continue;
+            const RgResource r = barrier.Resource;
+            valid &= state[r] == barrier.StateBefore;
+            if (barrier.Split == RgBarrierSplit::Begin) {
+                valid &= !inFlight[r];
+                inFlight[r] = 1;
+            } else {
+                valid &= (barrier.Split == RgBarrierSplit::End) == (inFlight[r] != 0);
+                inFlight[r] = 0;
+                state[r] = barrier.StateAfter;
+            }
+        }
+    };
+
+    RgPass last = 0;
+    for (const Declared& access : accesses) last = std::max(last, access.Pass);
+    for (RgPass p = 0; p <= last; p++) {
+        if (graph.IsCulled(p)) continue;
+        apply(graph.BarriersBefore(p));
+        for (const Declared& access : accesses) {
+            if (access.Pass == p) valid &= !inFlight[access.Resource] && state[access.Resource] == access.State;
+        }
+    }
+    apply(graph.FinalBarriers());
+    for (RgResource r = 0; r < count; r++) {
+        if (!graph.IsUsed(r)) continue;
+        const uint32_t expected = graph.IsTransient(r) ? graph.InitialState(r) : finalStates[r];
+        valid &= !inFlight[r] && state[r] == expected;
+    }
+    return valid;
+}
+
+// Declares through the graph and records the declaration for Replay
+struct GraphBuilder {
+    RenderGraph Graph;
+    std::vector<Declared> Accesses;
+    std::vector<uint32_t> FinalStates;
+
+    RgResource Import(const char* name, uint32_t initial, uint32_t final) {
+        FinalStates.push_back(final);
+        return Graph.ImportTexture(name, initial, final);
+    }
+    RgResource Create(const char* name, const RgTextureDesc& desc) {
+        FinalStates.push_back(RgStateCommon);
+        return Graph.CreateTexture(name, desc);
+    }
+    void Read(RgPass pass, RgResource resource, uint32_t state) {
+        Graph.Read(pass, resource, state);
+        Accesses.push_back({ pass, resource, state });
+    }
+    void Write(RgPass pass, RgResource resource, uint32_t state) {
+        Graph.Write(pass, resource, state);
+        Accesses.push_back({ pass, resource, state });
+    }
+    bool Replay() const { return ::Replay(Graph, Accesses, FinalStates); }
+};
+
+// The passes FurRenderer::Render declares, with transient sizes for a width x height target
+// at 4x MSAA. 'drawOsm' false is a frame reusing the cached OSM, 'halfResFur' false draws the
+// fur straight over the skin and resolves with ResolveSubresource.
+static void DeclareFramePasses(GraphBuilder& b, bool drawOsm, bool halfResFur, uint32_t width, uint32_t height) {
+    const uint64_t msaaAlignment = 4u << 20;
+    auto target = [&](uint32_t downscale) {
+        const uint64_t pixels = (uint64_t)((width + downscale - 1) / downscale) * ((height + downscale - 1) / downscale);
+        return Texture((pixels * 4 * 4 + msaaAlignment - 1) / msaaAlignment * msaaAlignment, msaaAlignment);
+    };
+    const RgResource osmDepth = b.Import("OsmDepth", RgStatePixelShaderResource, RgStatePixelShaderResource);
+    const RgResource osmLayers = b.Import("OsmLayers", RgStatePixelShaderResource, RgStatePixelShaderResource);
+    const RgResource backBuffer = b.Import("BackBuffer", RgStatePresent, RgStatePresent);
+    const RgResource sceneColor = b.Create("SceneColor", target(1));
+    const RgResource sceneDepth = b.Create("SceneDepth", target(1));
+    const RgResource furColor = b.Create("FurColor", target(2));
+    const RgResource furDepth = b.Create("FurDepth", target(2));
+
+    if (drawOsm) {
+        const RgPass osmDepthPass = b.Graph.AddPass("OsmDepth", nullptr);
+        b.Write(osmDepthPass, osmDepth, RgStateDepthWrite);
+        const RgPass osmLayerPass = b.Graph.AddPass("OsmLayers", nullptr);
+        b.Read(osmLayerPass, osmDepth, RgStatePixelShaderResource);
+        b.Write(osmLayerPass, osmLayers, RgStateRenderTarget);
+    }
+
+    const RgPass skinPass = b.Graph.AddPass("Skin", nullptr);
+    b.Write(skinPass, sceneColor, RgStateRenderTarget);
+    b.Write(skinPass, sceneDepth, RgStateDepthWrite);
+
+    if (halfResFur) {
+        const RgPass furDepthPass = b.Graph.AddPass("FurDepth", nullptr);
+        b.Read(furDepthPass, sceneDepth, RgStatePixelShaderResource);
+        b.Write(furDepthPass, furDepth, RgStateDepthWrite);
+    }
+
+    const RgPass furPass = b.Graph.AddPass("Fur", nullptr);
+    b.Read(furPass, osmLayers, RgStatePixelShaderResource);
+    b.Read(furPass, osmDepth, RgStatePixelShaderResource);
+    if (halfResFur) {
+        b.Read(furPass, furDepth, RgStateDepthRead);
+        b.Write(furPass, furColor, RgStateRenderTarget);
+    } else {
+        b.Read(furPass, sceneDepth, RgStateDepthRead);
+        b.Write(furPass, sceneColor, RgStateRenderTarget);
+    }
+
+    const RgPass resolvePass = b.Graph.AddPass("Resolve", nullptr);
+    if (halfResFur) {
+        b.Read(resolvePass, sceneColor, RgStatePixelShaderResource);
+        b.Read(resolvePass, sceneDepth, RgStatePixelShaderResource);
+        b.Read(resolvePass, furColor, RgStatePixelShaderResource);
+        b.Read(resolvePass, furDepth, RgStatePixelShaderResource);
+        b.Write(resolvePass, backBuffer, RgStateRenderTarget);
+    } else {
+        b.Read(resolvePass, sceneColor, RgStateResolveSource);
+        b.Write(resolvePass, backBuffer, RgStateResolveDest);
+    }
+    b.Graph.Compile();
+}
+
+static bool Check() {
+    bool ok = true;
+    bool replays = true;
+
+    {
+        // Debug writes a transient nobody reads; Prepare only feeds Debug; Timers has side effects
+        GraphBuilder b;
+        const RgResource backBuffer = b.Import("BackBuffer", RgStatePresent, RgStatePresent);
+        const RgResource scratch = b.Create("Scratch", Texture(65536));
+        const RgResource debug = b.Create("Debug", Texture(65536));
+        const RgResource color = b.Create("Color", Texture(65536));
+        const RgPass prepare = b.Graph.AddPass("Prepare", nullptr);
+        b.Write(prepare, scratch, RgStateRenderTarget);
+        const RgPass debugPass = b.Graph.AddPass("Debug", nullptr);
+        b.Read(debugPass, scratch, RgStatePixelShaderResource);
+        b.Write(debugPass, debug, RgStateRenderTarget);
+        const RgPass draw = b.Graph.AddPass("Draw", nullptr);
+        b.Write(draw, color, RgStateRenderTarget);
+        const RgPass timers = b.Graph.AddPass("Timers", nullptr);
+        b.Graph.SetSideEffects(timers);
+        const RgPass present = b.Graph.AddPass("Present", nullptr);
+        b.Read(present, color, RgStatePixelShaderResource);
+        b.Write(present, backBuffer, RgStateRenderTarget);
+        b.Graph.Compile();
+
+        const bool culled = b.Graph.IsCulled(prepare) && b.Graph.IsCulled(debugPass) && !b.Graph.IsCulled(draw) &&
+                            !b.Graph.IsCulled(timers) && !b.Graph.IsCulled(present) && b.Graph.Stats().CulledPasses == 2 &&
+                            !b.Graph.IsUsed(scratch) && !b.Graph.IsUsed(debug) && b.Graph.IsUsed(color) &&
+                            b.Graph.Stats().HeapBytes == 65536;
+        ok &= Report("culling", culled);
+        replays &= b.Replay();
+    }
+
+    {
+        // A is written by Draw and read by Blur three passes later; B is read straight after
+        GraphBuilder b;
+        const RgResource out = b.Import("Out", RgStateCommon, RgStateCommon);
+        const RgResource a = b.Create("A", Texture(65536));
+        const RgResource bTex = b.Create("B", Texture(65536));
+        const RgResource c = b.Create("C", Texture(65536));
+        const RgPass draw = b.Graph.AddPass("Draw", nullptr);
+        b.Write(draw, a, RgStateRenderTarget);
+        const RgPass other1 = b.Graph.AddPass("Other1", nullptr);
+        b.Write(other1, bTex, RgStateRenderTarget);
+        const RgPass other2 = b.Graph.AddPass("Other2", nullptr);
+        b.Read(other2, bTex, RgStatePixelShaderResource);
+        b.Write(other2, c, RgStateRenderTarget);
+        const RgPass blur = b.Graph.AddPass("Blur", nullptr);
+        b.Read(blur, a, RgStatePixelShaderResource);
+        b.Read(blur, c, RgStatePixelShaderResource);
+        b.Write(blur, out, RgStateRenderTarget);
+        b.Graph.Compile();
+
+        bool split = ExpectBatch(b.Graph, b.Graph.BarriersBefore(draw), "Out Present>RT begin");
+        split &= ExpectBatch(b.Graph, b.Graph.BarriersBefore(other1), "A RT>PSR begin");
+        split &= ExpectBatch(b.Graph, b.Graph.BarriersBefore(other2), "B RT>PSR");
+        split &= ExpectBatch(b.Graph, b.Graph.BarriersBefore(blur), "B PSR>RT, A RT>PSR end, C RT>PSR, Out Present>RT end");
+        split &= b.Graph.Stats().SplitBarriers == 2 && b.Graph.Stats().Barriers == 8;
+        ok &= Report("split barriers", split);
+
+        // B's last use is Other2: its restore goes in the next batch, before Blur's own barriers
+        bool restore = ExpectBatch(b.Graph, b.Graph.FinalBarriers(), "A PSR>RT, C PSR>RT, Out RT>Present");
+        restore &= b.Graph.InitialState(a) == RgStateRenderTarget && b.Graph.InitialState(bTex) == RgStateRenderTarget;
+        for (const RgBarrier& barrier : b.Graph.FinalBarriers()) restore &= barrier.Split == RgBarrierSplit::None;
+        ok &= Report("transient restore", restore);
+        replays &= b.Replay();
+    }
+
+    {
+        // Early lives in passes 0-1, Late in 2-3, Long in all four: Late can take Early's memory
+        GraphBuilder b;
+        const RgResource out = b.Import("Out", RgStateRenderTarget, RgStateRenderTarget);
+        const RgResource early = b.Create("Early", Texture(1 << 20));
+        const RgResource late = b.Create("Late", Texture(1 << 20));
+        const RgResource longLived = b.Create("Long", Texture(1 << 20));
+        const RgPass p0 = b.Graph.AddPass("P0", nullptr);
+        b.Write(p0, early, RgStateRenderTarget);
+        b.Write(p0, longLived, RgStateRenderTarget);
+        const RgPass p1 = b.Graph.AddPass("P1", nullptr);
+        b.Read(p1, early, RgStatePixelShaderResource);
+        b.Write(p1, out, RgStateRenderTarget);
+        const RgPass p2 = b.Graph.AddPass("P2", nullptr);
+        b.Write(p2, late, RgStateRenderTarget);
+        const RgPass p3 = b.Graph.AddPass("P3", nullptr);
+        b.Read(p3, late, RgStatePixelShaderResource);
+        b.Read(p3, longLived, RgStatePixelShaderResource);
+        b.Write(p3, out, RgStateRenderTarget);
+        b.Graph.Compile();
+
+        const RenderGraphStats& stats = b.Graph.Stats();
+        bool aliased = b.Graph.HeapOffset(early) == b.Graph.HeapOffset(late) && b.Graph.HeapOffset(longLived) != b.Graph.HeapOffset(early);
+        aliased &= stats.TransientBytes == 3 << 20 && stats.HeapBytes == 2 << 20 && stats.HeapBytes < stats.TransientBytes;
+        // Both directions need the barrier: Late takes the memory over in P2, Early gets it back next frame
+        aliased &= stats.AliasingBarriers == 2;
+        aliased &= ExpectBatch(b.Graph, b.Graph.BarriersBefore(p2), "Early PSR>RT, alias Late");
+        const std::vector<RgBarrier>& batch = b.Graph.BarriersBefore(p2);
+        aliased &= batch.size() == 2 && batch[1].AliasBefore == early;
+        aliased &= b.Graph.BarriersBefore(p0).size() == 1 && b.Graph.BarriersBefore(p0)[0].AliasBefore == late;
+        ok &= Report("aliasing", aliased);
+        replays &= b.Replay();
+    }
+
+    {
+        GraphBuilder b;
+        DeclareFramePasses(b, true, true, 1920, 1080);
+        const RenderGraph& g = b.Graph;
+        bool frame = ExpectBatch(g, g.BarriersBefore(0), "OsmDepth PSR>DW, OsmLayers PSR>RT begin, BackBuffer Present>RT begin");
+        frame &= ExpectBatch(g, g.BarriersBefore(1), "OsmDepth DW>PSR, OsmLayers PSR>RT end");
+        frame &= ExpectBatch(g, g.BarriersBefore(2), "OsmLayers RT>PSR begin");
+        frame &= ExpectBatch(g, g.BarriersBefore(3), "SceneDepth DW>PSR, SceneColor RT>PSR begin");
+        frame &= ExpectBatch(g, g.BarriersBefore(4), "OsmLayers RT>PSR end, FurDepth DW>DR");
+        frame &= ExpectBatch(g, g.BarriersBefore(5), "SceneColor RT>PSR end, FurColor RT>PSR, FurDepth DR>PSR, BackBuffer Present>RT end");
+        frame &= ExpectBatch(g, g.FinalBarriers(),
+                             "SceneColor PSR>RT, SceneDepth PSR>DW, FurColor PSR>RT, FurDepth PSR>DW, BackBuffer RT>Present");
+        // Every transient lives until the resolve, so nothing can alias
+        frame &= g.Stats().CulledPasses == 0 && g.Stats().Barriers == 15 && g.Stats().SplitBarriers == 4 &&
+                 g.Stats().AliasingBarriers == 0 && g.Stats().HeapBytes == g.Stats().TransientBytes;
+        ok &= Report("frame passes", frame);
+        replays &= b.Replay();
+    }
+
+    // The renderer's other frame shapes: cached OSM, full resolution fur, and both. Full resolution
+    // fur leaves FurColor and FurDepth (resources 5 and 6) unused.
+    for (uint32_t shape = 0; shape < 3; shape++) {
+        GraphBuilder b;
+        DeclareFramePasses(b, shape == 1, shape == 0, 1920, 1080);
+        replays &= b.Replay() && b.Graph.Stats().CulledPasses == 0;
+        if (shape != 0) replays &= !b.Graph.IsUsed(5) && !b.Graph.IsUsed(6);
+    }
+    ok &= Report("state replay", replays);
+    return ok;
+}
+
+// A chain of passes each writing one new transient and reading a few recent ones, the last
+// writing the imported output; random sizes from a quarter to four times a 1080p target
+static void BuildRandomGraph(GraphBuilder& b, uint32_t passes) {
+    const RgResource out = b.Import("Out", RgStatePresent, RgStatePresent);
+    std::vector<RgResource> transients;
+    for (uint32_t p = 0; p < passes; p++) {
+        const RgPass pass = b.Graph.AddPass("Pass", nullptr);
+        const uint32_t reads = transients.empty() ? 0 : 1 + Random(3);
+        for (uint32_t i = 0; i < reads; i++) {
+            const uint32_t back = std::min<uint32_t>(Random(8), (uint32_t)transients.size() - 1);
+            b.Read(pass, transients[transients.size() - 1 - back], RgStatePixelShaderResource);
+        }
+        const uint64_t size = (uint64_t)(2 + Random(30)) << 20;
+        const RgResource written = b.Create("T", Texture(size, 4u << 20));
+        b.Write(pass, written, Random(4) == 0 ? RgStateDepthWrite : RgStateRenderTarget);
+        transients.push_back(written);
+        if (p + 1 == passes) b.Write(pass, out, RgStateRenderTarget);
+    }
+}
+
+static void Benchmark(uint32_t passes) {
+    const uint32_t graphs = std::max(20000u / passes, 10u);
+    double compileMs = 0.0;
+    uint64_t transientBytes = 0, heapBytes = 0, barriers = 0, aliasing = 0, culled = 0;
+    bool replays = true;
+    for (uint32_t i = 0; i < graphs; i++) {
+        GraphBuilder b;
+        BuildRandomGraph(b, passes);
+        Clock::time_point start = Clock::now();
+        b.Graph.Compile();
+        compileMs += MillisecondsSince(start);
+        replays &= b.Replay();
+        const RenderGraphStats& stats = b.Graph.Stats();
+        transientBytes += stats.TransientBytes;
+        heapBytes += stats.HeapBytes;
+        barriers += stats.Barriers;
+        aliasing += stats.AliasingBarriers;
+        culled += stats.CulledPasses;
+    }
+
+    printf("\n%u random graphs of %u passes\n", graphs, passes);
+    printf("  compile             %8.1f us per graph\n", compileMs * 1e3 / graphs);
+    printf("  culled              %8.1f passes per graph\n", (double)culled / graphs);
+    printf("  transitions         %8.1f per graph, %.1f aliasing barriers\n", (double)barriers / graphs, (double)aliasing / graphs);
+    printf("  transients          %8.1f MB separate, %.1f MB aliased (%.0f%% saved)\n", transientBytes / 1048576.0 / graphs,
+           heapBytes / 1048576.0 / graphs, 100.0 * (1.0 - (double)heapBytes / transientBytes));
+    printf("  state replay        %8s\n", replays ? "ok" : "FAILED");
+
+    const uint32_t sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    for (const auto& size : sizes) {
+        GraphBuilder b;
+        DeclareFramePasses(b, true, true, size[0], size[1]);
+        GraphBuilder full;
+        DeclareFramePasses(full, true, false, size[0], size[1]);
+        printf("  frame passes %4ux%-4u  %6.1f MB heap half-res fur, %.1f MB full-res fur, %u barriers (%u split)\n", size[0],
+               size[1], b.Graph.HeapSize() / 1048576.0, full.Graph.HeapSize() / 1048576.0, b.Graph.Stats().Barriers,
+               b.Graph.Stats().SplitBarriers);
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint32_t passes = argc > 1 ? (uint32_t)std::max(atoi(argv[1]), 2) : 64;
+    bool ok = Check();
+    Benchmark(passes);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+// Headless deterministic frame replay: runs the renderer's CPU frame pipeline (skinning, OSM
+// schedule, BVH and occlusion culling, draw lists, light lists, constants) over a scripted scene
+// at a fixed timestep, without a window or a GPU, and reports per-stage percentiles. A checksum of every
+// frame's constants, draw lists and light lists shows whether two runs did the same work.
+// First checks that FrameScript::Load rejects or defaults malformed scripts without throwing.
+// Usage: PelageReplayBench [script.json] [frames]
+// Without a script the renderer's default orbit is replayed over a dense built-in sphere.
+#include "BenchReport.h"
+#include "FrameScript.h"
+#include "Hash.h"
+#include "MeshFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+// Carpet default (FurMaterial::FurLength); .pmesh files carry no materials of their own
+static constexpr float ReplayFurLength = 0.04f;
+
+static void MakeSphere(float radius, uint32_t slices, uint32_t stacks, MeshArrays& mesh) {
+    mesh = MeshArrays();
+    for (uint32_t stack = 0; stack <= stacks; stack++) {
+        float phi = 3.14159265f * stack / stacks;
+        for (uint32_t slice = 0; slice <= slices; slice++) {
+            float theta = 2.0f * 3.14159265f * slice / slices;
+            Float3 n(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+            mesh.Vertices.insert(mesh.Vertices.end(), { n.x * radius, n.y * radius, n.z * radius, n.x, n.y, n.z,
+                                                        (float)slice / slices, (float)stack / stacks });
+        }
+    }
+    for (uint32_t stack = 0; stack < stacks; stack++) {
+        for (uint32_t slice = 0; slice < slices; slice++) {
+            uint32_t a = stack * (slices + 1) + slice, b = a + slices + 1;
+            mesh.Indices.insert(mesh.Indices.end(), { a, a + 1, b, a + 1, b + 1, b });
+        }
+    }
+}
+
+// Same ordering as GeometryGen::BuildClusters: Morton order, grouped by material (SortTriangles)
+static std::vector<MeshCluster> ClusterMesh(MeshArrays& mesh) {
+    const bool hasMaterials = mesh.TriangleMaterials.size() == mesh.TriangleCount();
+    MeshClusters::SortTriangles(mesh.Vertices.data(), MeshArrays::VertexStride, mesh.Indices, mesh.TriangleMaterials);
+    return MeshClusters::Build(mesh.Vertices.data(), MeshArrays::VertexStride, mesh.Indices,
+                               MeshClusters::DefaultTrianglesPerCluster, hasMaterials ? &mesh.TriangleMaterials : nullptr);
+}
+
+// Nearest rank
+static double Percentile(std::vector<double>& sorted, double p) {
+    size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+static void PrintStage(const char* name, std::vector<double> samples) {
+    double mean = 0.0;
+    for (double s : samples) mean += s;
+    mean /= samples.size();
+    std::sort(samples.begin(), samples.end());
+    printf("%-10s %8.3f %8.3f %8.3f %8.3f %8.3f\n", name, mean, Percentile(samples, 50), Percentile(samples, 90),
+           Percentile(samples, 99), samples.back());
+}
+
+// Loads 'text' as a script file; false if Load failed or threw
+static bool LoadText(const std::string& text, FrameScript& script) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "pelage_replay_check.json";
+    std::ofstream(path, std::ios::trunc) << text;
+    bool loaded = false;
+    try {
+        loaded = script.Load(path.string());
+    } catch (...) {
+        loaded = false;
+    }
+    std::filesystem::remove(path);
+    return loaded;
+}
+
+static bool Check() {
+    bool ok = true;
+    FrameScript script;
+    // Wrong-typed fields keep their defaults
+    bool defaults = LoadText(R"({"frames":"x","loop":1,"mesh":5,"keys":[{"time":1,"camera":["a",0,0],"fov":"wide"}]})", script);
+    defaults &= script.FrameCount == FrameScript().FrameCount && script.Loop == FrameScript().Loop && script.Mesh.empty();
+    defaults &= script.Keys.size() == 1 && script.Keys[0].State.CameraPosition.x == FrameSceneState().CameraPosition.x &&
+                script.Keys[0].State.FieldOfView == FrameSceneState().FieldOfView;
+    defaults &= LoadText(R"({"frames":-3,"lights":[{"type":"point","color":[1,null,1]}]})", script) && script.FrameCount == FrameScript().FrameCount &&
+                script.Lights.size() == 1 && script.Lights[0].Type == LightType::Point;
+    ok &= Report("script defaults", defaults);
+
+    // Structure that can't be read fails the load
+    bool rejected = !LoadText("[1, 2]", script) && !LoadText("{\"keys\":", script);
+    rejected &= !LoadText(R"({"keys":"x"})", script) && !LoadText(R"({"keys":[1]})", script) && !LoadText(R"({"keys":{"a":{}}})", script);
+    rejected &= !LoadText(R"({"lights":[{"type":3}]})", script) && !LoadText(R"({"lights":[{"type":"area"}]})", script);
+    rejected &= !LoadText(R"({"fixedDt":0})", script);
+    rejected &= LoadText(R"({"frames":10,"loop":true,"keys":[{"time":0},{"time":1}],"lights":[{"type":"spot"}]})", script) &&
+                script.FrameCount == 10 && script.Loop && script.Keys.size() == 2;
+    ok &= Report("script errors", rejected);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    bool ok = Check();
+    FrameScript script = FrameScript::DefaultOrbit();
+    std::string scriptName = "default orbit";
+    if (argc > 1) {
+        if (!script.Load(argv[1])) {
+            printf("Could not read script %s\n", argv[1]);
+            return 1;
+        }
+        scriptName = argv[1];
+    }
+    if (argc > 2) script.FrameCount = (uint32_t)std::max(atoi(argv[2]), 1);
+
+    MeshArrays mesh;
+    std::string meshName = "built-in sphere";
+    if (!script.Mesh.empty()) {
+        std::filesystem::path meshPath = script.Mesh;
+        if (meshPath.is_relative() && argc > 1) meshPath = std::filesystem::path(argv[1]).parent_path() / meshPath;
+        if (!MeshFile::Read(meshPath.string(), mesh)) {
+            printf("Could not read mesh %s\n", meshPath.string().c_str());
+            return 1;
+        }
+        meshName = meshPath.string();
+    } else {
+        MakeSphere(1.0f, 512, 256, mesh);
+    }
+    std::vector<MeshCluster> clusters = ClusterMesh(mesh);
+
+    JobSystem jobs;
+    FramePipeline pipeline(jobs);
+    pipeline.SetMesh(mesh.Vertices.data(), MeshArrays::VertexStride, mesh.VertexCount(), mesh.Indices, clusters, ReplayFurLength);
+    pipeline.SetLights(script.Lights);
+
+    printf("Replay of %s: %u frames at %.4f s, %s (%zu vertices, %zu triangles, %zu clusters), %u threads\n",
+           scriptName.c_str(), script.FrameCount, script.FixedDt, meshName.c_str(), mesh.VertexCount(),
+           mesh.TriangleCount(), clusters.size(), jobs.ThreadCount());
+
+    std::vector<double> stageMs[FrameStageCount];
+    std::vector<double> totalMs;
+    uint64_t checksum = HashSeed;
+    uint64_t drawnTriangles = 0;
+    for (uint32_t frame = 0; frame < script.FrameCount; frame++) {
+        float time = frame * script.FixedDt;
+        pipeline.Update(time, script.Evaluate(time), script.Aspect);
+
+        const FramePipelineStats& stats = pipeline.Stats();
+        for (uint32_t s = 0; s < FrameStageCount; s++) stageMs[s].push_back(stats.StageMs[s]);
+        totalMs.push_back(stats.TotalMs);
+
+        checksum = HashBytes(checksum, &pipeline.Constants(), sizeof(FrameConstants));
+        checksum = HashBytes(checksum, &pipeline.LightConstants(), sizeof(FrameConstants));
+        for (const std::vector<DrawRange>* ranges : { &pipeline.DrawRanges(), &pipeline.SkinDrawRanges(), &pipeline.OsmDrawRanges() }) {
+            checksum = HashBytes(checksum, ranges->data(), ranges->size() * sizeof(DrawRange));
+        }
+        const LightCuller& lights = pipeline.Lights();
+        checksum = HashBytes(checksum, lights.Clusters().data(), lights.Clusters().size() * sizeof(LightCluster));
+        checksum = HashBytes(checksum, lights.Indices().data(), lights.Indices().size() * sizeof(uint32_t));
+        for (const DrawRange& range : pipeline.DrawRanges()) drawnTriangles += range.TriangleCount;
+    }
+
+    printf("%-10s %8s %8s %8s %8s %8s  (ms)\n", "stage", "mean", "p50", "p90", "p99", "max");
+    for (uint32_t s = 0; s < FrameStageCount; s++) PrintStage(FrameStageName((FrameStage)s), stageMs[s]);
+    PrintStage("Total", totalMs);
+
+    const OsmSchedulerStats& osm = pipeline.OsmSchedule().Stats();
+    printf("OSM full %llu, partial %llu, reused %llu | %.1f fur triangles drawn per frame of %zu\n",
+           (unsigned long long)osm.FullRefreshes, (unsigned long long)osm.PartialRefreshes, (unsigned long long)osm.Reuses,
+           (double)drawnTriangles / script.FrameCount, mesh.TriangleCount());
+    printf("Checksum %016llx\n", (unsigned long long)checksum);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,654 @@
+#include "SceneGen.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static constexpr float Pi = 3.14159265f;
+static constexpr float TorusTubeRadius = 0.3f;   // Relative to the ring radius
+static constexpr float CarpetFrequency = 3.0f;   // Heightfield lattice cells per world unit, first octave
+static constexpr uint32_t CarpetOctaves = 4;
+static constexpr uint64_t NonManifoldSpacing = 256; // Base triangles per fin
+
+// Hash streams, so the scatter and the non-manifold picks never share random numbers
+enum HashStream : uint64_t { StreamScatter = 1, StreamFin, StreamFlip, StreamHeight };
+
+// SplitMix64 finalizer
+static uint64_t Mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static uint64_t Hash(uint64_t seed, uint64_t stream, uint64_t a, uint64_t b = 0) {
+    return Mix(Mix(Mix(seed ^ Mix(stream)) ^ a) ^ b);
+}
+
+static float Random01(uint64_t hash) {
+    return (float)(hash >> 40) * (1.0f / 16777216.0f);
+}
+
+// m such that m(m+1)/2 <= k < (m+1)(m+2)/2
+static uint64_t TriangularRow(uint64_t k) {
+    uint64_t m = (uint64_t)((std::sqrt(8.0 * (double)k + 1.0) - 1.0) * 0.5);
+    while (m * (m + 1) / 2 > k) m--;
+    while ((m + 1) * (m + 2) / 2 <= k) m++;
+    return m;
+}
+
+static uint64_t IntegerSqrt(uint64_t k) {
+    uint64_t r = (uint64_t)std::sqrt((double)k);
+    while (r * r > k) r--;
+    while ((r + 1) * (r + 1) <= k) r++;
+    return r;
+}
+
+struct SynthVertex {
+    Float3 Position;
+    Float3 Normal;
+    float U = 0.0f, V = 0.0f;
+};
+
+static void StoreVertex(const SynthVertex& v, float* out) {
+    const float values[MeshArrays::VertexStride] = { v.Position.x, v.Position.y, v.Position.z,
+                                                     v.Normal.x, v.Normal.y, v.Normal.z, v.U, v.V };
+    memcpy(out, values, sizeof(values));
+}
+
+static uint32_t ClampResolution(SynthShape shape, uint32_t resolution) {
+    return std::max(resolution, shape == SynthShape::Torus ? 3u : 1u);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Icosphere: the 20 faces of an icosahedron, each a triangular grid of n^2 triangles projected
+// onto the sphere. Welded, the vertices are the 12 corners, then n-1 per icosahedron edge, then
+// each face's interior; seamed, every face has its own (n+1)(n+2)/2.
+// ---------------------------------------------------------------------------------------------
+
+struct Icosahedron {
+    Float3 Corners[12];
+    uint32_t Faces[20][3];     // Outward facing, same winding as GeometryGen::CreateSphere
+    uint32_t Edges[30][2];     // Lower corner first
+    uint32_t FaceEdges[20][3]; // AB, AC, BC of each face
+};
+
+static const Icosahedron& GetIcosahedron() {
+    static const Icosahedron ico = [] {
+        Icosahedron result = {};
+        const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+        const Float3 corners[12] = {
+            { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+            { 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+            { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 },
+        };
+        const uint32_t faces[20][3] = {
+            { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+            { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+            { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+            { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 },
+        };
+        for (int i = 0; i < 12; i++) result.Corners[i] = Normalize(corners[i]);
+        uint32_t edgeCount = 0;
+        auto findEdge = [&](uint32_t a, uint32_t b) {
+            uint32_t lo = std::min(a, b), hi = std::max(a, b);
+            for (uint32_t e = 0; e < edgeCount; e++) {
+                if (result.Edges[e][0] == lo && result.Edges[e][1] == hi) return e;
+            }
+            result.Edges[edgeCount][0] = lo;
+            result.Edges[edgeCount][1] = hi;
+            return edgeCount++;
+        };
+        for (int f = 0; f < 20; f++) {
+            for (int c = 0; c < 3; c++) result.Faces[f][c] = faces[f][c];
+            result.FaceEdges[f][0] = findEdge(faces[f][0], faces[f][1]);
+            result.FaceEdges[f][1] = findEdge(faces[f][0], faces[f][2]);
+            result.FaceEdges[f][2] = findEdge(faces[f][1], faces[f][2]);
+        }
+        return result;
+    }();
+    return ico;
+}
+
+// What a face grid point (r, c), 0 <= c <= r <= n, lies on. A is (0, 0), B (n, 0), C (n, n).
+struct IcoPoint {
+    enum Kind { Corner, Edge, Interior } Type = Interior;
+    uint32_t Id = 0;   // Corner or edge
+    uint64_t Step = 0; // Along the edge from its lower corner
+};
+
+static IcoPoint ClassifyIcoPoint(const Icosahedron& ico, uint32_t f, uint64_t r, uint64_t c, uint32_t n) {
+    const uint32_t* face = ico.Faces[f];
+    if (r == 0) return { IcoPoint::Corner, face[0] };
+    if (r == n && c == 0) return { IcoPoint::Corner, face[1] };
+    if (r == n && c == n) return { IcoPoint::Corner, face[2] };
+    auto onEdge = [&](uint32_t slot, uint32_t from, uint64_t step) {
+        uint32_t edge = ico.FaceEdges[f][slot];
+        return IcoPoint{ IcoPoint::Edge, edge, ico.Edges[edge][0] == from ? step : n - step };
+    };
+    if (c == 0) return onEdge(0, face[0], r);
+    if (c == r) return onEdge(1, face[0], r);
+    if (r == n) return onEdge(2, face[1], c);
+    return {};
+}
+
+// Points on the icosahedron's edges are always interpolated from the edge's lower corner, so
+// the two faces sharing an edge compute bit-identical positions
+static Float3 IcoPosition(const Icosahedron& ico, uint32_t f, uint64_t r, uint64_t c, uint32_t n) {
+    IcoPoint point = ClassifyIcoPoint(ico, f, r, c, n);
+    if (point.Type == IcoPoint::Corner) return ico.Corners[point.Id];
+    if (point.Type == IcoPoint::Edge) {
+        const Float3& lo = ico.Corners[ico.Edges[point.Id][0]];
+        const Float3& hi = ico.Corners[ico.Edges[point.Id][1]];
+        return Normalize(lo + (hi - lo) * ((float)point.Step / n));
+    }
+    const Float3& a = ico.Corners[ico.Faces[f][0]];
+    const Float3& b = ico.Corners[ico.Faces[f][1]];
+    const Float3& cc = ico.Corners[ico.Faces[f][2]];
+    return Normalize(a + (b - a) * ((float)(r - c) / n) + (cc - a) * ((float)c / n));
+}
+
+static uint64_t IcoInteriorCount(uint32_t n) {
+    return n < 3 ? 0 : (uint64_t)(n - 1) * (n - 2) / 2;
+}
+
+static uint64_t IcoSeamedFaceVertices(uint32_t n) {
+    return (uint64_t)(n + 1) * (n + 2) / 2;
+}
+
+static uint64_t IcoWeldedIndex(const Icosahedron& ico, uint32_t f, uint64_t r, uint64_t c, uint32_t n) {
+    IcoPoint point = ClassifyIcoPoint(ico, f, r, c, n);
+    if (point.Type == IcoPoint::Corner) return point.Id;
+    if (point.Type == IcoPoint::Edge) return 12 + (uint64_t)point.Id * (n - 1) + point.Step - 1;
+    return 12 + 30ull * (n - 1) + f * IcoInteriorCount(n) + (r - 2) * (r - 1) / 2 + (c - 1);
+}
+
+static float SphereU(const Float3& p) {
+    return std::atan2(p.z, p.x) / (2.0f * Pi) + 0.5f;
+}
+
+static void IcosphereVertex(const SynthObject& object, uint32_t n, uint64_t i, SynthVertex& v) {
+    const Icosahedron& ico = GetIcosahedron();
+    Float3 unit;
+    float u;
+    if (object.Variants & SynthSeamed) {
+        uint64_t faceVertices = IcoSeamedFaceVertices(n);
+        uint32_t f = (uint32_t)(i / faceVertices);
+        uint64_t k = i % faceVertices;
+        uint64_t r = TriangularRow(k);
+        unit = IcoPosition(ico, f, r, k - r * (r + 1) / 2, n);
+        // Each face is its own UV chart, unwrapped around its centre: no face straddles u = 0
+        const Float3 centre = Normalize(ico.Corners[ico.Faces[f][0]] + ico.Corners[ico.Faces[f][1]] + ico.Corners[ico.Faces[f][2]]);
+        const float centreU = SphereU(centre);
+        u = SphereU(unit);
+        if (u - centreU > 0.5f) u -= 1.0f;
+        if (centreU - u > 0.5f) u += 1.0f;
+    } else {
+        const uint64_t edgeStart = 12, interiorStart = 12 + 30ull * (n - 1);
+        if (i < edgeStart) {
+            unit = ico.Corners[i];
+        } else if (i < interiorStart) {
+            uint64_t edge = (i - edgeStart) / (n - 1), step = (i - edgeStart) % (n - 1) + 1;
+            const Float3& lo = ico.Corners[ico.Edges[edge][0]];
+            const Float3& hi = ico.Corners[ico.Edges[edge][1]];
+            unit = Normalize(lo + (hi - lo) * ((float)step / n));
+        } else {
+            uint64_t interior = IcoInteriorCount(n);
+            uint32_t f = (uint32_t)((i - interiorStart) / interior);
+            uint64_t k = (i - interiorStart) % interior;
+            uint64_t m = TriangularRow(k);
+            unit = IcoPosition(ico, f, m + 2, k - m * (m + 1) / 2 + 1, n);
+        }
+        u = SphereU(unit);
+    }
+    v.Position = object.Position + unit * object.Scale;
+    v.Normal = unit;
+    v.U = u;
+    v.V = std::acos(std::min(std::max(unit.y, -1.0f), 1.0f)) / Pi;
+}
+
+static void IcosphereTriangle(const SynthObject& object, uint32_t n, uint64_t t, uint64_t out[3]) {
+    const Icosahedron& ico = GetIcosahedron();
+    const uint64_t faceTriangles = (uint64_t)n * n;
+    uint32_t f = (uint32_t)(t / faceTriangles);
+    uint64_t local = t % faceTriangles;
+    uint64_t r = IntegerSqrt(local), k = local - r * r, j = k / 2;
+    // Row r has 2r + 1 triangles, alternately pointing up and down; both keep the face's winding
+    uint64_t points[3][2];
+    if (k % 2 == 0) {
+        uint64_t up[3][2] = { { r, j }, { r + 1, j }, { r + 1, j + 1 } };
+        memcpy(points, up, sizeof(points));
+    } else {
+        uint64_t down[3][2] = { { r, j }, { r + 1, j + 1 }, { r, j + 1 } };
+        memcpy(points, down, sizeof(points));
+    }
+    for (int c = 0; c < 3; c++) {
+        out[c] = (object.Variants & SynthSeamed)
+            ? f * IcoSeamedFaceVertices(n) + points[c][0] * (points[c][0] + 1) / 2 + points[c][1]
+            : IcoWeldedIndex(ico, f, points[c][0], points[c][1], n);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Torus: lying in the XZ plane, 4n segments around the ring by n around the tube. Welded, the
+// grid wraps both ways; seamed, the last row and column repeat the first with u or v = 1.
+// ---------------------------------------------------------------------------------------------
+
+static void TorusVertex(const SynthObject& object, uint32_t n, uint64_t i, SynthVertex& v) {
+    const uint64_t ring = 4ull * n;
+    const uint64_t columns = (object.Variants & SynthSeamed) ? n + 1 : n;
+    uint64_t a = i / columns, b = i % columns;
+    // The angles come from the wrapped indices, so seam duplicates are bit-identical
+    float theta = 2.0f * Pi * (float)(a % ring) / ring;
+    float phi = 2.0f * Pi * (float)(b % n) / n;
+    Float3 centre(std::cos(theta), 0.0f, std::sin(theta));
+    v.Normal = Float3(std::cos(phi) * centre.x, std::sin(phi), std::cos(phi) * centre.z);
+    v.Position = object.Position + (centre + v.Normal * TorusTubeRadius) * object.Scale;
+    v.U = (float)a / ring;
+    v.V = (float)b / n;
+}
+
+static void TorusTriangle(const SynthObject& object, uint32_t n, uint64_t t, uint64_t out[3]) {
+    const uint64_t ring = 4ull * n;
+    const bool seamed = (object.Variants & SynthSeamed) != 0;
+    const uint64_t columns = seamed ? n + 1 : n;
+    uint64_t quad = t / 2, a = quad / n, b = quad % n;
+    uint64_t a1 = seamed ? a + 1 : (a + 1) % ring, b1 = seamed ? b + 1 : (b + 1) % n;
+    uint64_t v00 = a * columns + b, v01 = a * columns + b1, v10 = a1 * columns + b, v11 = a1 * columns + b1;
+    if (t % 2 == 0) {
+        out[0] = v00; out[1] = v01; out[2] = v10;
+    } else {
+        out[0] = v01; out[1] = v11; out[2] = v10;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Carpet tile: n^2 quads over a square of side Scale in XZ, heights from fractal value noise
+// evaluated at world XZ so that neighbouring tiles meet. Seamed, the middle row and column of
+// vertices are doubled.
+// ---------------------------------------------------------------------------------------------
+
+static float LatticeValue(uint64_t seed, int64_t x, int64_t z) {
+    return Random01(Hash(seed, StreamHeight, (uint64_t)x, (uint64_t)z)) * 2.0f - 1.0f;
+}
+
+// Smoothstepped bilinear lattice noise in [-1, 1], with its gradient
+static float ValueNoise(uint64_t seed, float x, float z, float& ddx, float& ddz) {
+    float fx = std::floor(x), fz = std::floor(z);
+    int64_t ix = (int64_t)fx, iz = (int64_t)fz;
+    float tx = x - fx, tz = z - fz;
+    float sx = tx * tx * (3.0f - 2.0f * tx), sz = tz * tz * (3.0f - 2.0f * tz);
+    float v00 = LatticeValue(seed, ix, iz), v10 = LatticeValue(seed, ix + 1, iz);
+    float v01 = LatticeValue(seed, ix, iz + 1), v11 = LatticeValue(seed, ix + 1, iz + 1);
+    float v0 = v00 + (v10 - v00) * sx, v1 = v01 + (v11 - v01) * sx;
+    ddx = ((v10 - v00) * (1.0f - sz) + (v11 - v01) * sz) * 6.0f * tx * (1.0f - tx);
+    ddz = (v1 - v0) * 6.0f * tz * (1.0f - tz);
+    return v0 + (v1 - v0) * sz;
+}
+
+// Fractal sum of value noise, with its gradient for the normal
+static float CarpetHeight(const SynthScene& scene, float x, float z, float& ddx, float& ddz) {
+    float height = 0.0f, amplitude = 1.0f, frequency = CarpetFrequency, total = 0.0f;
+    ddx = ddz = 0.0f;
+    for (uint32_t octave = 0; octave < CarpetOctaves; octave++) {
+        float octaveDdx, octaveDdz;
+        height += amplitude * ValueNoise(scene.Seed + octave, x * frequency, z * frequency, octaveDdx, octaveDdz);
+        ddx += amplitude * frequency * octaveDdx;
+        ddz += amplitude * frequency * octaveDdz;
+        total += amplitude;
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+    const float scale = scene.CarpetAmplitude / total;
+    ddx *= scale;
+    ddz *= scale;
+    return height * scale;
+}
+
+static bool CarpetSeamed(const SynthObject& object, uint32_t n) {
+    return (object.Variants & SynthSeamed) && n >= 2;
+}
+
+static void CarpetVertex(const SynthScene& scene, const SynthObject& object, uint32_t n, uint64_t i, SynthVertex& v) {
+    const bool seamed = CarpetSeamed(object, n);
+    const uint64_t columns = n + 1 + (seamed ? 1 : 0);
+    uint64_t row = i / columns, column = i % columns;
+    if (seamed && row > n / 2) row--;
+    if (seamed && column > n / 2) column--;
+
+    float x = object.Position.x + ((float)column / n - 0.5f) * object.Scale;
+    float z = object.Position.z + ((float)row / n - 0.5f) * object.Scale;
+    float ddx, ddz;
+    v.Position = Float3(x, object.Position.y + CarpetHeight(scene, x, z, ddx, ddz), z);
+    v.Normal = Normalize(Float3(-ddx, 1.0f, -ddz));
+    v.U = (float)column / n;
+    v.V = (float)row / n;
+}
+
+static void CarpetTriangle(const SynthObject& object, uint32_t n, uint64_t t, uint64_t out[3]) {
+    const bool seamed = CarpetSeamed(object, n);
+    const uint64_t columns = n + 1 + (seamed ? 1 : 0);
+    uint64_t quad = t / 2, row = quad / n, column = quad % n;
+    // Quads past the middle use the doubled vertices
+    if (seamed && row >= n / 2) row++;
+    if (seamed && column >= n / 2) column++;
+    uint64_t v00 = row * columns + column, v01 = (row + 1) * columns + column;
+    uint64_t v10 = v00 + 1, v11 = v01 + 1;
+    if (t % 2 == 0) {
+        out[0] = v00; out[1] = v01; out[2] = v10;
+    } else {
+        out[0] = v10; out[1] = v01; out[2] = v11;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Objects: the shape's own vertices and triangles, then the non-manifold extras. Fin k adds
+// vertex k (its apex) and triangle k; flipped duplicates follow the fins.
+// ---------------------------------------------------------------------------------------------
+
+struct ObjectLayout {
+    uint32_t Resolution = 0;
+    uint64_t BaseVertices = 0;
+    uint64_t BaseTriangles = 0;
+    uint64_t Fins = 0;
+
+    uint64_t VertexCount() const { return BaseVertices + Fins; }
+    uint64_t TriangleCount() const { return BaseTriangles + 2 * Fins; }
+};
+
+static ObjectLayout LayOutObject(const SynthObject& object) {
+    ObjectLayout layout;
+    const uint32_t n = ClampResolution(object.Shape, object.Resolution);
+    const bool seamed = (object.Variants & SynthSeamed) != 0;
+    layout.Resolution = n;
+    layout.BaseTriangles = SceneGen::TriangleCount(object.Shape, n);
+    switch (object.Shape) {
+    case SynthShape::Icosphere:
+        layout.BaseVertices = seamed ? 20 * IcoSeamedFaceVertices(n) : 10ull * n * n + 2;
+        break;
+    case SynthShape::Torus:
+        layout.BaseVertices = seamed ? (4ull * n + 1) * (n + 1) : 4ull * n * n;
+        break;
+    case SynthShape::CarpetTile: {
+        uint64_t side = n + 1 + (CarpetSeamed(object, n) ? 1 : 0);
+        layout.BaseVertices = side * side;
+        break;
+    }
+    }
+    if (object.Variants & SynthNonManifold) {
+        layout.Fins = std::max<uint64_t>(layout.BaseTriangles / NonManifoldSpacing, 1);
+    }
+    return layout;
+}
+
+static void ShapeVertex(const SynthScene& scene, const SynthObject& object, uint32_t n, uint64_t i, SynthVertex& v) {
+    switch (object.Shape) {
+    case SynthShape::Icosphere: IcosphereVertex(object, n, i, v); break;
+    case SynthShape::Torus: TorusVertex(object, n, i, v); break;
+    case SynthShape::CarpetTile: CarpetVertex(scene, object, n, i, v); break;
+    }
+}
+
+static void ShapeTriangle(const SynthObject& object, uint32_t n, uint64_t t, uint64_t out[3]) {
+    switch (object.Shape) {
+    case SynthShape::Icosphere: IcosphereTriangle(object, n, t, out); break;
+    case SynthShape::Torus: TorusTriangle(object, n, t, out); break;
+    case SynthShape::CarpetTile: CarpetTriangle(object, n, t, out); break;
+    }
+}
+
+static void ObjectVertex(const SynthScene& scene, uint32_t objectIndex, const ObjectLayout& layout, uint64_t i, float* out) {
+    const SynthObject& object = scene.Objects[objectIndex];
+    SynthVertex v;
+    if (i < layout.BaseVertices) {
+        ShapeVertex(scene, object, layout.Resolution, i, v);
+        StoreVertex(v, out);
+        return;
+    }
+
+    // Fin apex: above the midpoint of the first edge of a random triangle, as far out as the edge is long
+    uint64_t fin = i - layout.BaseVertices;
+    uint64_t source[3];
+    ShapeTriangle(object, layout.Resolution, Hash(scene.Seed, StreamFin, objectIndex, fin) % layout.BaseTriangles, source);
+    SynthVertex v0, v1;
+    ShapeVertex(scene, object, layout.Resolution, source[0], v0);
+    ShapeVertex(scene, object, layout.Resolution, source[1], v1);
+    Float3 normal = v0.Normal + v1.Normal;
+    normal = Dot(normal, normal) > 1e-12f ? Normalize(normal) : v0.Normal;
+    v.Position = (v0.Position + v1.Position) * 0.5f + normal * Length(v1.Position - v0.Position);
+    v.Normal = Normalize(Cross(v0.Position - v1.Position, v.Position - v1.Position));
+    v.U = (v0.U + v1.U) * 0.5f;
+    v.V = (v0.V + v1.V) * 0.5f;
+    StoreVertex(v, out);
+}
+
+static void ObjectTriangle(const SynthScene& scene, uint32_t objectIndex, const ObjectLayout& layout, uint64_t t, uint64_t out[3]) {
+    const SynthObject& object = scene.Objects[objectIndex];
+    if (t < layout.BaseTriangles) {
+        ShapeTriangle(object, layout.Resolution, t, out);
+        return;
+    }
+    uint64_t extra = t - layout.BaseTriangles;
+    uint64_t source[3];
+    if (extra < layout.Fins) {
+        // Shares the source's first edge, with the source's neighbour as the third face on it
+        ShapeTriangle(object, layout.Resolution, Hash(scene.Seed, StreamFin, objectIndex, extra) % layout.BaseTriangles, source);
+        out[0] = source[1];
+        out[1] = source[0];
+        out[2] = layout.BaseVertices + extra;
+    } else {
+        ShapeTriangle(object, layout.Resolution, Hash(scene.Seed, StreamFlip, objectIndex, extra) % layout.BaseTriangles, source);
+        out[0] = source[0];
+        out[1] = source[2];
+        out[2] = source[1];
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Scenes
+// ---------------------------------------------------------------------------------------------
+
+struct SceneLayout {
+    std::vector<ObjectLayout> Objects;
+    std::vector<uint64_t> VertexStart;   // Per object, plus the total
+    std::vector<uint64_t> TriangleStart;
+};
+
+static SceneLayout LayOutScene(const SynthScene& scene) {
+    SceneLayout layout;
+    layout.VertexStart.push_back(0);
+    layout.TriangleStart.push_back(0);
+    for (const SynthObject& object : scene.Objects) {
+        layout.Objects.push_back(LayOutObject(object));
+        layout.VertexStart.push_back(layout.VertexStart.back() + layout.Objects.back().VertexCount());
+        layout.TriangleStart.push_back(layout.TriangleStart.back() + layout.Objects.back().TriangleCount());
+    }
+    return layout;
+}
+
+// Vertices [first, first + count) of the scene
+static void GenerateVertices(JobSystem& jobs, const SynthScene& scene, const SceneLayout& layout, uint64_t first, uint64_t count, float* out) {
+    jobs.ParallelFor(count, 4096, [&](size_t begin, size_t end) {
+        uint64_t v = first + begin;
+        size_t o = std::upper_bound(layout.VertexStart.begin(), layout.VertexStart.end(), v) - layout.VertexStart.begin() - 1;
+        for (size_t i = begin; i < end; i++, v++) {
+            while (v >= layout.VertexStart[o + 1]) o++;
+            ObjectVertex(scene, (uint32_t)o, layout.Objects[o], v - layout.VertexStart[o], out + i * MeshArrays::VertexStride);
+        }
+    });
+}
+
+static void GenerateTriangles(JobSystem& jobs, const SynthScene& scene, const SceneLayout& layout, uint64_t first, uint64_t count,
+                              uint32_t* indices, uint32_t* materials) {
+    jobs.ParallelFor(count, 4096, [&](size_t begin, size_t end) {
+        uint64_t t = first + begin;
+        size_t o = std::upper_bound(layout.TriangleStart.begin(), layout.TriangleStart.end(), t) - layout.TriangleStart.begin() - 1;
+        for (size_t i = begin; i < end; i++, t++) {
+            while (t >= layout.TriangleStart[o + 1]) o++;
+            uint64_t triangle[3];
+            ObjectTriangle(scene, (uint32_t)o, layout.Objects[o], t - layout.TriangleStart[o], triangle);
+            for (int c = 0; c < 3; c++) indices[i * 3 + c] = (uint32_t)(layout.VertexStart[o] + triangle[c]);
+            if (materials) materials[i] = scene.Objects[o].Material;
+        }
+    });
+}
+
+uint64_t SceneGen::TriangleCount(SynthShape shape, uint32_t resolution) {
+    const uint64_t n = ClampResolution(shape, resolution);
+    switch (shape) {
+    case SynthShape::Icosphere: return 20 * n * n;
+    case SynthShape::Torus: return 8 * n * n;
+    case SynthShape::CarpetTile: return 2 * n * n;
+    }
+    return 0;
+}
+
+uint32_t SceneGen::ResolutionFor(SynthShape shape, uint64_t triangles) {
+    const double perSquare = (double)TriangleCount(shape, 4) / 16.0;
+    uint32_t resolution = (uint32_t)std::llround(std::sqrt((double)triangles / perSquare));
+    return ClampResolution(shape, resolution);
+}
+
+SynthScene SceneGen::Scatter(const SynthScatterSettings& settings) {
+    SynthScene scene;
+    scene.Seed = settings.Seed;
+    const uint32_t objectCount = std::max(settings.ObjectCount, 1u);
+
+    // About a quarter of the objects tile the floor, the rest stand on it
+    const uint32_t side = std::max((uint32_t)std::sqrt(objectCount / 4.0), 1u);
+    const float tileSize = 2.0f;
+    const float half = 0.5f * side * tileSize;
+    for (uint32_t row = 0; row < side; row++) {
+        for (uint32_t column = 0; column < side; column++) {
+            SynthObject tile;
+            tile.Shape = SynthShape::CarpetTile;
+            tile.Position = Float3((column + 0.5f) * tileSize - half, 0.0f, (row + 0.5f) * tileSize - half);
+            tile.Scale = tileSize;
+            scene.Objects.push_back(tile);
+        }
+    }
+    for (uint32_t i = (uint32_t)scene.Objects.size(); i < objectCount; i++) {
+        auto random = [&](uint64_t attribute) { return Random01(Hash(settings.Seed, StreamScatter, i, attribute)); };
+        SynthObject object;
+        object.Shape = random(0) < 0.5f ? SynthShape::Icosphere : SynthShape::Torus;
+        object.Scale = 0.15f + 0.35f * random(1);
+        float lift = object.Shape == SynthShape::Torus ? TorusTubeRadius * object.Scale : object.Scale;
+        object.Position = Float3((random(2) * 2.0f - 1.0f) * (half - object.Scale), lift + scene.CarpetAmplitude,
+                                 (random(3) * 2.0f - 1.0f) * (half - object.Scale));
+        if (settings.MaterialCount > 1) {
+            object.Material = 1 + (uint32_t)(Hash(settings.Seed, StreamScatter, i, 4) % (settings.MaterialCount - 1));
+        }
+        scene.Objects.push_back(object);
+    }
+
+    // Triangles in proportion to surface area
+    std::vector<double> areas;
+    double totalArea = 0.0;
+    for (SynthObject& object : scene.Objects) {
+        object.Variants = settings.Variants;
+        double s = object.Scale;
+        double area = object.Shape == SynthShape::CarpetTile ? s * s
+                    : object.Shape == SynthShape::Torus ? 4.0 * Pi * Pi * TorusTubeRadius * s * s
+                    : 4.0 * Pi * s * s;
+        areas.push_back(area);
+        totalArea += area;
+    }
+    for (size_t i = 0; i < scene.Objects.size(); i++) {
+        uint64_t share = (uint64_t)((double)settings.Triangles * areas[i] / totalArea);
+        scene.Objects[i].Resolution = ResolutionFor(scene.Objects[i].Shape, share);
+    }
+    return scene;
+}
+
+void SceneGen::Count(const SynthScene& scene, uint64_t& vertices, uint64_t& triangles) {
+    vertices = 0;
+    triangles = 0;
+    for (const SynthObject& object : scene.Objects) {
+        ObjectLayout layout = LayOutObject(object);
+        vertices += layout.VertexCount();
+        triangles += layout.TriangleCount();
+    }
+}
+
+uint64_t SceneGen::SourceKey(const SynthScene& scene) {
+    uint64_t key = Hash(scene.Seed, 0x5343454e45ull /* "SCENE" */, 1 /* generator version */);
+    uint32_t amplitude;
+    memcpy(&amplitude, &scene.CarpetAmplitude, sizeof(amplitude));
+    key = Hash(key, amplitude, scene.Objects.size());
+    for (const SynthObject& object : scene.Objects) {
+        uint32_t values[7] = { (uint32_t)object.Shape, object.Resolution, 0, 0, 0, object.Material, object.Variants };
+        memcpy(&values[2], &object.Position, sizeof(float) * 3);
+        uint32_t scale;
+        memcpy(&scale, &object.Scale, sizeof(scale));
+        for (uint32_t value : values) key = Hash(key, value, scale);
+    }
+    return key;
+}
+
+bool SceneGen::Generate(const SynthScene& scene, float* vertices, uint32_t* indices, uint32_t* materials) {
+    const Clock::time_point start = Clock::now();
+    SceneLayout layout = LayOutScene(scene);
+    m_stats = SceneGenStats();
+    m_stats.Vertices = layout.VertexStart.back();
+    m_stats.Triangles = layout.TriangleStart.back();
+    if (m_stats.Vertices > UINT32_MAX) return false;
+
+    GenerateVertices(m_jobs, scene, layout, 0, m_stats.Vertices, vertices);
+    GenerateTriangles(m_jobs, scene, layout, 0, m_stats.Triangles, indices, materials);
+    m_stats.GenerateMs = MillisecondsSince(start);
+    return true;
+}
+
+bool SceneGen::Generate(const SynthScene& scene, MeshArrays& mesh) {
+    uint64_t vertexCount, triangleCount;
+    Count(scene, vertexCount, triangleCount);
+    mesh = MeshArrays();
+    if (vertexCount > UINT32_MAX) return false;
+    mesh.Vertices.resize(vertexCount * MeshArrays::VertexStride);
+    mesh.Indices.resize(triangleCount * 3);
+    mesh.TriangleMaterials.resize(triangleCount);
+    return Generate(scene, mesh.Vertices.data(), mesh.Indices.data(), mesh.TriangleMaterials.data());
+}
+
+bool SceneGen::Stream(const SynthScene& scene, const std::string& path, uint64_t batchSize) {
+    SceneLayout layout = LayOutScene(scene);
+    m_stats = SceneGenStats();
+    m_stats.Vertices = layout.VertexStart.back();
+    m_stats.Triangles = layout.TriangleStart.back();
+    if (m_stats.Vertices > UINT32_MAX) return false;
+
+    MeshFileWriter writer;
+    if (!writer.Open(path, MeshFileHeader::HasMaterials | MeshFileHeader::Compressed)) return false;
+    batchSize = std::max<uint64_t>(batchSize, 1);
+
+    std::vector<float> vertices(std::min(batchSize, m_stats.Vertices) * MeshArrays::VertexStride);
+    Aabb bounds;
+    for (uint64_t first = 0; first < m_stats.Vertices; first += batchSize) {
+        uint64_t count = std::min(batchSize, m_stats.Vertices - first);
+        Clock::time_point start = Clock::now();
+        GenerateVertices(m_jobs, scene, layout, first, count, vertices.data());
+        bounds.Expand(ComputeBounds(vertices.data(), count, MeshArrays::VertexStride));
+        m_stats.GenerateMs += MillisecondsSince(start);
+        start = Clock::now();
+        writer.AppendVertices(vertices.data(), count);
+        m_stats.WriteMs += MillisecondsSince(start);
+    }
+    vertices = std::vector<float>();
+
+    std::vector<uint32_t> indices(std::min(batchSize, m_stats.Triangles) * 3);
+    std::vector<uint32_t> materials(std::min(batchSize, m_stats.Triangles));
+    for (uint64_t first = 0; first < m_stats.Triangles; first += batchSize) {
+        uint64_t count = std::min(batchSize, m_stats.Triangles - first);
+        Clock::time_point start = Clock::now();
+        GenerateTriangles(m_jobs, scene, layout, first, count, indices.data(), materials.data());
+        m_stats.GenerateMs += MillisecondsSince(start);
+        start = Clock::now();
+        writer.AppendTriangles(indices.data(), nullptr, materials.data(), count);
+        m_stats.WriteMs += MillisecondsSince(start);
+    }
+
+    Clock::time_point start = Clock::now();
+    bool ok = writer.Finish(SourceKey(scene), bounds);
+    m_stats.WriteMs += MillisecondsSince(start);
+    return ok;
+}
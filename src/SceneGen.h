@@ -0,0 +1,91 @@
+#pragma once
+#include "JobSystem.h"
+#include "MeshFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Procedural scenes for stress and scaling tests, from a thousand to tens of millions of
+// triangles. Every vertex and every triangle of an object is a closed-form function of its
+// index and the scene seed, so generation is a ParallelFor over index ranges: the output is the
+// same for any thread count, and streaming it batch by batch into a .pmesh gives the same
+// bytes as generating it in core.
+
+enum class SynthShape : uint32_t {
+    Icosphere,  // Geodesic: each of the 20 faces split into Resolution^2 triangles, no poles
+    Torus,      // Resolution segments around the tube, 4 x Resolution around the ring
+    CarpetTile, // Unit tile of Resolution^2 quads, displaced by a heightfield taken in world space so tiles meet
+};
+
+enum SynthVariant : uint32_t {
+    // Vertices split where UVs are discontinuous: per icosphere face, at the torus wraps, along
+    // the middle row and column of a carpet tile. Positions along a seam are bit-identical.
+    SynthSeamed = 1,
+    // One edge in 256 gets a fin triangle (three faces on the edge) and as many triangles are
+    // duplicated with flipped winding
+    SynthNonManifold = 2,
+};
+
+struct SynthObject {
+    SynthShape Shape = SynthShape::Icosphere;
+    uint32_t Resolution = 16;
+    Float3 Position = Float3(0.0f, 0.0f, 0.0f);
+    float Scale = 1.0f;    // Radius, ring radius or tile size
+    uint32_t Material = 0;
+    uint32_t Variants = 0; // SynthVariant flags
+};
+
+struct SynthScene {
+    uint64_t Seed = 1;
+    float CarpetAmplitude = 0.04f; // Heightfield displacement, world units
+    std::vector<SynthObject> Objects;
+};
+
+struct SynthScatterSettings {
+    uint32_t ObjectCount = 64;       // Carpet tiles included
+    uint64_t Triangles = 1000000;    // Target over the whole scene
+    uint32_t MaterialCount = 4;
+    uint32_t Variants = 0;           // Applied to every object
+    uint64_t Seed = 1;
+};
+
+struct SceneGenStats {
+    uint64_t Vertices = 0;
+    uint64_t Triangles = 0;
+    double GenerateMs = 0.0;
+    double WriteMs = 0.0; // Streaming only
+};
+
+class SceneGen {
+public:
+    explicit SceneGen(JobSystem& jobs) : m_jobs(jobs) {}
+
+    // Triangles of a shape at 'resolution' before variants, and the resolution closest to a target
+    static uint64_t TriangleCount(SynthShape shape, uint32_t resolution);
+    static uint32_t ResolutionFor(SynthShape shape, uint64_t triangles);
+
+    // A square floor of carpet tiles with icospheres and tori scattered over it, the triangle
+    // budget split between them by size
+    static SynthScene Scatter(const SynthScatterSettings& settings);
+
+    static void Count(const SynthScene& scene, uint64_t& vertices, uint64_t& triangles);
+
+    // Key of the scene description, stored in the .pmesh header by Stream
+    static uint64_t SourceKey(const SynthScene& scene);
+
+    // Into caller arrays sized by Count: MeshArrays::VertexStride floats per vertex, 3 indices
+    // and (if 'materials' is not null) a material per triangle. False if the scene has more
+    // vertices than 32-bit indices can address.
+    bool Generate(const SynthScene& scene, float* vertices, uint32_t* indices, uint32_t* materials);
+    bool Generate(const SynthScene& scene, MeshArrays& mesh);
+
+    // Out of core: 'batchSize' vertices or triangles at a time into a .pmesh with materials and
+    // no adjacency. Memory use is one batch, however large the scene.
+    bool Stream(const SynthScene& scene, const std::string& path, uint64_t batchSize = 1ull << 20);
+
+    const SceneGenStats& Stats() const { return m_stats; }
+
+private:
+    JobSystem& m_jobs;
+    SceneGenStats m_stats;
+};
@@ -0,0 +1,129 @@
+// Headless synthetic scene benchmark: generates scattered scenes (carpet floor, icospheres and
+// tori) from a thousand triangles up to the requested size and single shapes at the largest
+// size, reports throughput and a checksum per scene, checks that one thread gives the same
+// bytes as all of them, and counts the border and non-manifold edges of the seamed and
+// non-manifold variants. With an output path the largest scene is first streamed into a .pmesh
+// in batches, before anything has been generated in core so the peak RSS is its own, and
+// checked against the in-core result at the end.
+// Usage: PelageSceneGenBench [max triangles] [objects] [output.pmesh]
+#include "BenchReport.h"
+#include "Hash.h"
+#include "SceneGen.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+static uint64_t Checksum(const MeshArrays& mesh) {
+    uint64_t hash = HashSeed;
+    hash = HashBytes(hash, mesh.Vertices.data(), mesh.Vertices.size() * sizeof(float));
+    hash = HashBytes(hash, mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+    return HashBytes(hash, mesh.TriangleMaterials.data(), mesh.TriangleMaterials.size() * sizeof(uint32_t));
+}
+
+// Edges with one face (borders and seams) and with more than two
+static void CountEdges(const MeshArrays& mesh, uint64_t& border, uint64_t& nonManifold) {
+    std::vector<uint64_t> edges;
+    edges.reserve(mesh.Indices.size());
+    for (size_t t = 0; t < mesh.TriangleCount(); t++) {
+        for (int e = 0; e < 3; e++) {
+            uint64_t a = mesh.Indices[t * 3 + e], b = mesh.Indices[t * 3 + (e + 1) % 3];
+            edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    border = nonManifold = 0;
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i;
+        while (j < edges.size() && edges[j] == edges[i]) j++;
+        if (j - i == 1) border++;
+        if (j - i > 2) nonManifold++;
+        i = j;
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint64_t maxTriangles = argc > 1 ? (uint64_t)std::max(atoll(argv[1]), 1000ll) : 10000000;
+    const uint32_t objects = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 1) : 64;
+    const char* outputPath = argc > 3 ? argv[3] : nullptr;
+
+    JobSystem jobs;
+    SceneGen generator(jobs);
+    SynthScatterSettings settings;
+    settings.ObjectCount = objects;
+    settings.Triangles = maxTriangles;
+    const SynthScene largest = SceneGen::Scatter(settings);
+    if (outputPath) {
+        if (!generator.Stream(largest, outputPath)) {
+            printf("Could not write %s\n", outputPath);
+            return 1;
+        }
+        const SceneGenStats& stats = generator.Stats();
+        printf("Streamed %llu triangles to %s: generate %.1f ms, write %.1f ms, peak RSS %.1f MB\n",
+               (unsigned long long)stats.Triangles, outputPath, stats.GenerateMs, stats.WriteMs, PeakRssMB());
+    }
+
+    printf("Scattered scenes of %u objects, %u threads\n", objects, jobs.ThreadCount());
+    printf("%12s %12s %10s %10s  %s\n", "triangles", "vertices", "ms", "Mtri/s", "checksum");
+    MeshArrays mesh;
+    for (uint64_t target = 1000;; target *= 10) {
+        settings.Triangles = std::min(target, maxTriangles);
+        SynthScene scene = SceneGen::Scatter(settings);
+        if (!generator.Generate(scene, mesh)) {
+            printf("%llu triangles: too many vertices for 32-bit indices\n", (unsigned long long)settings.Triangles);
+            return 1;
+        }
+        const SceneGenStats& stats = generator.Stats();
+        printf("%12llu %12llu %10.1f %10.1f  %016llx\n", (unsigned long long)stats.Triangles, (unsigned long long)stats.Vertices,
+               stats.GenerateMs, stats.Triangles / (stats.GenerateMs * 1000.0), (unsigned long long)Checksum(mesh));
+        if (settings.Triangles == maxTriangles) break;
+    }
+
+    printf("Single shapes at %llu triangles\n", (unsigned long long)maxTriangles);
+    const char* shapeNames[] = { "Icosphere", "Torus", "CarpetTile" };
+    for (SynthShape shape : { SynthShape::Icosphere, SynthShape::Torus, SynthShape::CarpetTile }) {
+        SynthScene scene;
+        SynthObject object;
+        object.Shape = shape;
+        object.Resolution = SceneGen::ResolutionFor(shape, maxTriangles);
+        scene.Objects.push_back(object);
+        generator.Generate(scene, mesh);
+        const SceneGenStats& stats = generator.Stats();
+        printf("%-10s %5u: %llu triangles, %llu vertices in %.1f ms (%.1f Mtri/s)\n", shapeNames[(int)shape], object.Resolution,
+               (unsigned long long)stats.Triangles, (unsigned long long)stats.Vertices, stats.GenerateMs,
+               stats.Triangles / (stats.GenerateMs * 1000.0));
+    }
+
+    // The same scene on one thread must give the same bytes
+    settings.Triangles = std::min<uint64_t>(maxTriangles, 1000000);
+    SynthScene scene = SceneGen::Scatter(settings);
+    JobSystem serialJobs(0);
+    MeshArrays serial;
+    generator.Generate(scene, mesh);
+    SceneGen(serialJobs).Generate(scene, serial);
+    bool deterministic = mesh.Vertices == serial.Vertices && mesh.Indices == serial.Indices &&
+                         mesh.TriangleMaterials == serial.TriangleMaterials;
+    printf("1 thread vs %u threads at %llu triangles: %s\n", jobs.ThreadCount(), (unsigned long long)mesh.TriangleCount(),
+           deterministic ? "identical" : "DIFFERENT");
+
+    settings.Triangles = std::min<uint64_t>(maxTriangles, 100000);
+    const char* variantNames[] = { "plain", "seamed", "non-manifold" };
+    for (uint32_t variants : { 0u, (uint32_t)SynthSeamed, (uint32_t)SynthNonManifold }) {
+        settings.Variants = variants;
+        generator.Generate(SceneGen::Scatter(settings), mesh);
+        uint64_t border, nonManifold;
+        CountEdges(mesh, border, nonManifold);
+        printf("%-12s %llu triangles: %llu border edges, %llu edges with 3+ faces\n", variantNames[variants],
+               (unsigned long long)mesh.TriangleCount(), (unsigned long long)border, (unsigned long long)nonManifold);
+    }
+
+    if (outputPath) {
+        MeshArrays streamed;
+        if (!MeshFile::Read(outputPath, streamed)) {
+            printf("Could not read back %s\n", outputPath);
+            return 1;
+        }
+        generator.Generate(largest, mesh);
+        printf("Streamed file %s the in-core scene\n", Checksum(streamed) == Checksum(mesh) ? "matches" : "DIFFERS FROM");
+    }
+    return deterministic ? 0 : 1;
+}
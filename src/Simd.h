@@ -0,0 +1,10 @@
+#pragma once
+
+// SSE2 is baseline on every x64 target we ship (MSVC x64, GCC/Clang x86-64).
+// Kernels use it directly when available and fall back to scalar loops otherwise.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PELAGE_SSE2 1
+#include <emmintrin.h>
+#else
+#define PELAGE_SSE2 0
+#endif
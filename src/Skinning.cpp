@@ -0,0 +1,101 @@
+#include "Skinning.h"
+#include "Simd.h"
+#include "Timing.h"
+#include <cstring>
+
+void Skinner::Skin(const float* bindVertices, size_t stride, const SkinWeights* weights, size_t vertexCount,
+                   const Float4x4* palette, float* dst, float* positionsOut) {
+    Clock::time_point start = Clock::now();
+    m_jobs.ParallelFor(vertexCount, GrainSize, [&](size_t begin, size_t end) {
+        SkinRange(bindVertices, stride, weights, palette, dst, positionsOut, begin, end);
+    });
+    m_stats.Vertices = vertexCount;
+    m_stats.SkinMs = MillisecondsSince(start);
+}
+
+void Skinner::SkinRange(const float* bindVertices, size_t stride, const SkinWeights* weights,
+                        const Float4x4* palette, float* dst, float* positionsOut, size_t begin, size_t end) {
+    for (size_t v = begin; v < end; v++) {
+        const float* src = bindVertices + v * stride;
+        float* out = dst + v * stride;
+        const SkinWeights& skin = weights[v];
+
+#if PELAGE_SSE2
+        // Blend the affine rows of the weighted matrices; zero weights are skipped
+        const float* m = &palette[skin.Joints[0]].m[0][0];
+        __m128 w = _mm_set1_ps(skin.Weights[0]);
+        __m128 row0 = _mm_mul_ps(w, _mm_loadu_ps(m + 0));
+        __m128 row1 = _mm_mul_ps(w, _mm_loadu_ps(m + 4));
+        __m128 row2 = _mm_mul_ps(w, _mm_loadu_ps(m + 8));
+        __m128 row3 = _mm_mul_ps(w, _mm_loadu_ps(m + 12));
+        for (int k = 1; k < 4; k++) {
+            if (skin.Weights[k] == 0.0f) continue;
+            m = &palette[skin.Joints[k]].m[0][0];
+            w = _mm_set1_ps(skin.Weights[k]);
+            row0 = _mm_add_ps(row0, _mm_mul_ps(w, _mm_loadu_ps(m + 0)));
+            row1 = _mm_add_ps(row1, _mm_mul_ps(w, _mm_loadu_ps(m + 4)));
+            row2 = _mm_add_ps(row2, _mm_mul_ps(w, _mm_loadu_ps(m + 8)));
+            row3 = _mm_add_ps(row3, _mm_mul_ps(w, _mm_loadu_ps(m + 12)));
+        }
+
+        __m128 pos = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(src[0]), row0), _mm_mul_ps(_mm_set1_ps(src[1]), row1)),
+                                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(src[2]), row2), row3));
+        __m128 nrm = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(src[3]), row0), _mm_mul_ps(_mm_set1_ps(src[4]), row1)),
+                                _mm_mul_ps(_mm_set1_ps(src[5]), row2));
+
+        // Renormalize: blending rotations shortens the normal
+        __m128 sq = _mm_mul_ps(nrm, nrm);
+        __m128 lenSq = _mm_add_ss(_mm_add_ss(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1))),
+                                  _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 2, 2, 2)));
+        __m128 invLen = _mm_div_ss(_mm_set_ss(1.0f), _mm_sqrt_ss(_mm_max_ss(lenSq, _mm_set_ss(1e-20f))));
+        nrm = _mm_mul_ps(nrm, _mm_shuffle_ps(invLen, invLen, _MM_SHUFFLE(0, 0, 0, 0)));
+
+        alignas(16) float p[4];
+        _mm_store_ps(p, pos);
+        if (stride == 8) {
+            // Two full 16-byte stores per vertex: [p.xyz n.x] [n.yz uv]
+            __m128 uv = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(src + 6)));
+            __m128 zx = _mm_shuffle_ps(pos, nrm, _MM_SHUFFLE(0, 0, 2, 2));
+            _mm_storeu_ps(out, _mm_shuffle_ps(pos, zx, _MM_SHUFFLE(2, 0, 1, 0)));
+            _mm_storeu_ps(out + 4, _mm_shuffle_ps(nrm, uv, _MM_SHUFFLE(1, 0, 2, 1)));
+        } else {
+            alignas(16) float n[4];
+            _mm_store_ps(n, nrm);
+            out[0] = p[0]; out[1] = p[1]; out[2] = p[2];
+            out[3] = n[0]; out[4] = n[1]; out[5] = n[2];
+            memcpy(out + 6, src + 6, (stride - 6) * sizeof(float));
+        }
+        if (positionsOut) {
+            positionsOut[v * 3 + 0] = p[0];
+            positionsOut[v * 3 + 1] = p[1];
+            positionsOut[v * 3 + 2] = p[2];
+        }
+#else
+        float blended[4][3] = {};
+        for (int k = 0; k < 4; k++) {
+            float w = skin.Weights[k];
+            if (w == 0.0f) continue;
+            const Float4x4& m = palette[skin.Joints[k]];
+            for (int r = 0; r < 4; r++) {
+                for (int c = 0; c < 3; c++) blended[r][c] += w * m.m[r][c];
+            }
+        }
+
+        float p[3], n[3];
+        for (int c = 0; c < 3; c++) {
+            p[c] = src[0] * blended[0][c] + src[1] * blended[1][c] + src[2] * blended[2][c] + blended[3][c];
+            n[c] = src[3] * blended[0][c] + src[4] * blended[1][c] + src[5] * blended[2][c];
+        }
+        float invLen = 1.0f / std::sqrt(std::max(n[0] * n[0] + n[1] * n[1] + n[2] * n[2], 1e-20f));
+
+        out[0] = p[0]; out[1] = p[1]; out[2] = p[2];
+        out[3] = n[0] * invLen; out[4] = n[1] * invLen; out[5] = n[2] * invLen;
+        memcpy(out + 6, src + 6, (stride - 6) * sizeof(float));
+        if (positionsOut) {
+            positionsOut[v * 3 + 0] = p[0];
+            positionsOut[v * 3 + 1] = p[1];
+            positionsOut[v * 3 + 2] = p[2];
+        }
+#endif
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "CoreMath.h"
+#include "JobSystem.h"
+#include <vector>
+
+// Multithreaded linear blend skinning on the CPU. Vertex ranges are skinned in parallel with
+// SSE2: the (up to) four weighted palette matrices are blended row by row, then position and
+// normal go through the blended matrix. Topology never changes, so everything derived from the
+// bind pose (adjacency, fin edges, clusters) stays valid; only bounds need refitting.
+
+struct SkinWeights {
+    uint16_t Joints[4] = {};  // Palette indices
+    float Weights[4] = {};    // Sum to 1
+};
+
+struct SkinningStats {
+    uint64_t Vertices = 0;
+    double SkinMs = 0.0; // Last Skin call
+
+    double VerticesPerSecond() const { return SkinMs > 0.0 ? Vertices * 1000.0 / SkinMs : 0.0; }
+};
+
+class Skinner {
+public:
+    static constexpr size_t GrainSize = 4096; // Vertices per job
+
+    explicit Skinner(JobSystem& jobs) : m_jobs(jobs) {}
+
+    // Skins 'vertexCount' vertices of the GPU layout: position (3 floats), normal (3), then
+    // stride - 6 floats (UVs) copied through. 'stride' is in floats, the same for source and
+    // destination. 'dst' is only ever written, whole vertices in order, so it can point straight
+    // into write-combined upload memory. 'positionsOut', if not null, also receives the skinned
+    // positions tightly packed (xyz), for bounds and CPU occlusion.
+    void Skin(const float* bindVertices, size_t stride, const SkinWeights* weights, size_t vertexCount,
+              const Float4x4* palette, float* dst, float* positionsOut);
+
+    const SkinningStats& Stats() const { return m_stats; }
+
+private:
+    static void SkinRange(const float* bindVertices, size_t stride, const SkinWeights* weights,
+                          const Float4x4* palette, float* dst, float* positionsOut, size_t begin, size_t end);
+
+    JobSystem& m_jobs;
+    SkinningStats m_stats;
+};
@@ -0,0 +1,183 @@
+// Headless CPU skinning throughput benchmark: a synthetic 64-joint skeleton animated by a
+// looping clip, skinning 100K to 4M vertices of the GPU layout with four influences each.
+// First checks Skinner against a scalar reference that transforms each vertex by every weighted
+// matrix and sums the results:
+//   lbs vs scalar      positions, normals, copied UVs and the packed positions agree at every
+//                      vertex count, on the stride-8 layout the SSE2 path stores in two shuffles
+//   other layouts      the same at stride 6 and 10, and with some weights exactly zero
+// Usage: PelageSkinningBench [iterations]
+#include "Animation.h"
+#include "BenchReport.h"
+#include "Skinning.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+static Skeleton MakeChainSkeleton(uint32_t jointCount, float boneLength) {
+    Skeleton skeleton;
+    for (uint32_t j = 0; j < jointCount; j++) {
+        skeleton.Names.push_back("Joint" + std::to_string(j));
+        skeleton.Parents.push_back((int32_t)j - 1);
+
+        JointPose rest;
+        rest.Translation = Float3(0.0f, j == 0 ? 0.0f : boneLength, 0.0f);
+        skeleton.RestPose.push_back(rest);
+
+        // The bind pose is the rest pose: joint j sits at height j * boneLength
+        Float4x4 inverseBind = Float4x4::Identity();
+        inverseBind.m[3][1] = -(float)j * boneLength;
+        skeleton.InverseBind.push_back(inverseBind);
+    }
+    return skeleton;
+}
+
+static AnimationClip MakeBendClip(uint32_t jointCount) {
+    AnimationClip clip;
+    clip.Name = "Bend";
+    clip.Duration = 2.0f;
+    for (uint32_t j = 1; j < jointCount; j++) {
+        AnimationChannel channel;
+        channel.Joint = j;
+        channel.Path = AnimationPath::Rotation;
+        for (int key = 0; key <= 4; key++) {
+            float angle = 0.05f * std::sin(key * 1.5707963f + j * 0.3f);
+            channel.Times.push_back(key * 0.5f);
+            channel.Values.insert(channel.Values.end(), { std::sin(angle * 0.5f), 0.0f, 0.0f, std::cos(angle * 0.5f) });
+        }
+        clip.Channels.push_back(channel);
+    }
+    return clip;
+}
+
+static constexpr uint32_t JointCount = 64;
+static constexpr float BoneLength = 0.1f;
+
+// Vertices on a thin cylinder along the chain, 'stride' floats each (position, normal, then
+// extra floats to copy), each weighted to the four joints around its height. With 'zeroWeights'
+// every other vertex has only two influences.
+static void MakeMesh(size_t vertexCount, size_t stride, bool zeroWeights, std::mt19937& rng, std::vector<float>& bindVertices,
+                     std::vector<SkinWeights>& weights) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    bindVertices.assign(vertexCount * stride, 0.0f);
+    weights.assign(vertexCount, SkinWeights());
+    for (size_t v = 0; v < vertexCount; v++) {
+        float height = unit(rng) * (JointCount - 1) * BoneLength;
+        float angle = unit(rng) * 6.2831853f;
+        float* vertex = &bindVertices[v * stride];
+        vertex[0] = 0.05f * std::cos(angle); vertex[1] = height; vertex[2] = 0.05f * std::sin(angle);
+        vertex[3] = std::cos(angle); vertex[4] = 0.0f; vertex[5] = std::sin(angle);
+        for (size_t c = 6; c < stride; c++) vertex[c] = unit(rng);
+
+        // Four neighbouring joints around the vertex height, weights summing to 1
+        uint32_t base = std::min((uint32_t)(height / BoneLength), JointCount - 4);
+        float sum = 0.0f;
+        for (int k = 0; k < 4; k++) {
+            weights[v].Joints[k] = (uint16_t)(base + k);
+            weights[v].Weights[k] = zeroWeights && v % 2 && k % 2 ? 0.0f : 0.05f + unit(rng);
+            sum += weights[v].Weights[k];
+        }
+        for (int k = 0; k < 4; k++) weights[v].Weights[k] /= sum;
+    }
+}
+
+// Skins with Skinner and compares every vertex with the scalar reference
+static bool MatchesScalar(Skinner& skinner, const std::vector<float>& bindVertices, size_t stride, const std::vector<SkinWeights>& weights,
+                          const std::vector<Float4x4>& palette) {
+    const size_t vertexCount = weights.size();
+    std::vector<float> skinned(vertexCount * stride), positions(vertexCount * 3);
+    skinner.Skin(bindVertices.data(), stride, weights.data(), vertexCount, palette.data(), skinned.data(), positions.data());
+
+    const float epsilon = 1e-4f;
+    bool match = true;
+    for (size_t v = 0; v < vertexCount && match; v++) {
+        const float* src = &bindVertices[v * stride];
+        const float* out = &skinned[v * stride];
+        Float3 position(0.0f, 0.0f, 0.0f), normal(0.0f, 0.0f, 0.0f);
+        for (int k = 0; k < 4; k++) {
+            const Float4x4& m = palette[weights[v].Joints[k]];
+            const float w = weights[v].Weights[k];
+            position = position + TransformPoint(m, Float3(src[0], src[1], src[2])) * w;
+            normal = normal + Float3(src[3] * m.m[0][0] + src[4] * m.m[1][0] + src[5] * m.m[2][0],
+                                     src[3] * m.m[0][1] + src[4] * m.m[1][1] + src[5] * m.m[2][1],
+                                     src[3] * m.m[0][2] + src[4] * m.m[1][2] + src[5] * m.m[2][2]) * w;
+        }
+        normal = Normalize(normal);
+        const float expected[6] = { position.x, position.y, position.z, normal.x, normal.y, normal.z };
+        for (int c = 0; c < 6; c++) match &= std::fabs(out[c] - expected[c]) <= epsilon;
+        for (int c = 0; c < 3; c++) match &= positions[v * 3 + c] == out[c];
+        match &= memcmp(out + 6, src + 6, (stride - 6) * sizeof(float)) == 0;
+    }
+    return match;
+}
+
+static bool Check(Skinner& skinner, const Skeleton& skeleton, const AnimationClip& clip, const size_t* vertexCounts, size_t countCount) {
+    bool ok = true;
+    std::vector<JointPose> pose;
+    std::vector<Float4x4> palette;
+    std::vector<float> bindVertices;
+    std::vector<SkinWeights> weights;
+    std::mt19937 rng(99);
+
+    bool lbs = true;
+    for (size_t i = 0; i < countCount; i++) {
+        // A different frame of the bend at each size
+        Animation::Sample(skeleton, clip, 0.37f * (i + 1), pose);
+        Animation::ComputePalette(skeleton, pose, palette);
+        MakeMesh(vertexCounts[i], 8, false, rng, bindVertices, weights);
+        lbs &= MatchesScalar(skinner, bindVertices, 8, weights, palette);
+    }
+    ok &= Report("lbs vs scalar", lbs);
+
+    bool layouts = true;
+    for (size_t stride : { (size_t)6, (size_t)8, (size_t)10 }) {
+        MakeMesh(10000, stride, true, rng, bindVertices, weights);
+        layouts &= MatchesScalar(skinner, bindVertices, stride, weights, palette);
+    }
+    ok &= Report("other layouts", layouts);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    const size_t stride = 8; // Matches GeometryGen's Vertex
+    const size_t vertexCounts[] = { 100000, 250000, 1000000, 4000000 };
+    int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 20;
+
+    Skeleton skeleton = MakeChainSkeleton(JointCount, BoneLength);
+    AnimationClip clip = MakeBendClip(JointCount);
+    std::vector<JointPose> pose;
+    std::vector<Float4x4> palette;
+
+    JobSystem jobs;
+    Skinner skinner(jobs);
+    bool ok = Check(skinner, skeleton, clip, vertexCounts, sizeof(vertexCounts) / sizeof(vertexCounts[0]));
+    printf("\nCPU skinning, %u joints, 4 influences, %u threads, %d iterations\n", JointCount, jobs.ThreadCount(), iterations);
+    printf("%10s %10s %10s %12s %10s\n", "vertices", "median ms", "min ms", "Mverts/s", "GB/s out");
+
+    std::mt19937 rng(1234);
+    for (size_t vertexCount : vertexCounts) {
+        std::vector<float> bindVertices;
+        std::vector<SkinWeights> weights;
+        MakeMesh(vertexCount, stride, false, rng, bindVertices, weights);
+
+        std::vector<float> skinned(vertexCount * stride);
+        std::vector<float> positions(vertexCount * 3);
+        std::vector<double> times;
+        for (int i = -2; i < iterations; i++) { // Two warm-up runs
+            Animation::Sample(skeleton, clip, i * (1.0f / 60.0f), pose);
+            Animation::ComputePalette(skeleton, pose, palette);
+            skinner.Skin(bindVertices.data(), stride, weights.data(), vertexCount, palette.data(), skinned.data(), positions.data());
+            if (i >= 0) times.push_back(skinner.Stats().SkinMs);
+        }
+
+        std::sort(times.begin(), times.end());
+        double median = times[times.size() / 2];
+        double bytesOut = (double)vertexCount * (stride + 3) * sizeof(float);
+        printf("%10zu %10.3f %10.3f %12.1f %10.2f\n", vertexCount, median, times.front(),
+               vertexCount / median / 1000.0, bytesOut / median / 1e6);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+// Headless texture ingestion benchmark. First checks the cooker on a synthetic colour map:
+//   bc1 error          BC1 blocks decoded by the D3D rules stay close to the source, in the
+//                      opaque four-colour mode on every block
+//   bc7 error          mode 6 blocks decoded by the D3D rules stay closer still, alpha included
+//   srgb mips          a black and white checker averages to linear mid grey (sRGB 188) with
+//                      alpha averaged linearly, and odd sizes halve down to 1x1
+//   cache round trip   a second cook reads back from the .ptex exactly what the first wrote
+//   corrupt cache      truncated files and bad data sizes, formats, mip counts and sizes in the
+//                      header are rejected, and the cook falls back to re-cooking
+// Then cooks batches of synthetic PNG colour maps from 512^2 to 4096^2 without the disk cache and
+// reports decode (all images in parallel), sRGB mip chain and BC1/BC7 compression throughput in
+// megapixels of top level per second.
+// Usage: PelageTextureBench [iterations]
+#include "BenchReport.h"
+#include "Hash.h"
+#include "TextureCooker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../third_party/tinygltf/stb_image_write.h"
+
+// Smooth hue variation plus per-texel grain, so PNG compresses about as well as a painted map
+static std::vector<uint8_t> MakeColorMap(uint32_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> grain(-12, 12);
+    std::vector<uint8_t> rgba((size_t)size * size * 4);
+    float phase = seed * 0.7f;
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            float u = (float)x / size, v = (float)y / size;
+            float base[3] = { 0.55f + 0.35f * std::sin(6.0f * u + phase), 0.45f + 0.3f * std::sin(5.0f * v + 2.0f * phase),
+                              0.35f + 0.25f * std::sin(4.0f * (u + v) + phase) };
+            uint8_t* texel = &rgba[((size_t)y * size + x) * 4];
+            for (int c = 0; c < 3; c++) texel[c] = (uint8_t)std::clamp((int)(base[c] * 255.0f) + grain(rng), 0, 255);
+            texel[3] = 255;
+        }
+    }
+    return rgba;
+}
+
+static void AppendBytes(void* context, void* data, int size) {
+    auto* bytes = static_cast<std::vector<uint8_t>*>(context);
+    bytes->insert(bytes->end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+}
+
+// Four-colour mode when color0 > color1, else three colours and transparent black
+static void DecodeBc1(const uint8_t* block, uint8_t out[16][4]) {
+    uint16_t color0, color1;
+    uint32_t indices;
+    memcpy(&color0, block, 2);
+    memcpy(&color1, block + 2, 2);
+    memcpy(&indices, block + 4, 4);
+    int palette[4][4];
+    for (int e = 0; e < 2; e++) {
+        const uint16_t packed = e ? color1 : color0;
+        const int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        palette[e][0] = (r << 3) | (r >> 2);
+        palette[e][1] = (g << 2) | (g >> 4);
+        palette[e][2] = (b << 3) | (b >> 2);
+        palette[e][3] = 255;
+    }
+    for (int c = 0; c < 4; c++) {
+        if (color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) out[i][c] = (uint8_t)palette[(indices >> (2 * i)) & 3][c];
+    }
+}
+
+// Mode 6 only; false for any other mode
+static bool DecodeBc7(const uint8_t* block, uint8_t out[16][4]) {
+    uint32_t position = 0;
+    auto get = [&](uint32_t count) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < count; i++, position++) value |= ((block[position >> 3] >> (position & 7)) & 1u) << i;
+        return value;
+    };
+    if (get(7) != 1u << 6) return false;
+    uint32_t endpoints[2][4];
+    for (int c = 0; c < 4; c++) {
+        endpoints[0][c] = get(7) << 1;
+        endpoints[1][c] = get(7) << 1;
+    }
+    const uint32_t p0 = get(1), p1 = get(1);
+    static const uint32_t weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    for (int i = 0; i < 16; i++) {
+        const uint32_t w = weights[get(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; c++) out[i][c] = (uint8_t)(((64 - w) * (endpoints[0][c] | p0) + w * (endpoints[1][c] | p1) + 32) >> 6);
+    }
+    return true;
+}
+
+// RMS error per channel of a compressed top level against the source; -1 if a block didn't decode
+static double BlockRmsError(const TextureImage& image, const std::vector<uint8_t>& source) {
+    const TextureMip& top = image.Mips[0];
+    const uint32_t blockBytes = image.Format == TextureFormat::Bc1Srgb ? 8 : 16;
+    double sum = 0.0;
+    uint8_t texels[16][4];
+    for (uint32_t by = 0; by < top.RowCount; by++) {
+        for (uint32_t bx = 0; bx < top.RowPitch / blockBytes; bx++) {
+            const uint8_t* block = image.Data.data() + top.Offset + (size_t)by * top.RowPitch + bx * blockBytes;
+            if (image.Format == TextureFormat::Bc1Srgb) {
+                uint16_t color0, color1;
+                memcpy(&color0, block, 2);
+                memcpy(&color1, block + 2, 2);
+                // Opaque blocks must not use the three-colour mode's transparent index
+                if (color0 < color1) return -1.0;
+                DecodeBc1(block, texels);
+            } else if (!DecodeBc7(block, texels)) {
+                return -1.0;
+            }
+            for (int i = 0; i < 16; i++) {
+                const uint8_t* expected = &source[((size_t)(by * 4 + i / 4) * top.Width + bx * 4 + i % 4) * 4];
+                for (int c = 0; c < 4; c++) sum += (texels[i][c] - expected[c]) * (double)(texels[i][c] - expected[c]);
+            }
+        }
+    }
+    return std::sqrt(sum / ((double)top.Width * top.Height * 4));
+}
+
+static TextureSource EncodeSource(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, const std::string& cachePath = "") {
+    TextureSource source;
+    source.Name = "check";
+    source.CachePath = cachePath;
+    stbi_write_png_to_func(AppendBytes, &source.Encoded, (int)width, (int)height, 4, rgba.data(), (int)width * 4);
+    return source;
+}
+
+static bool SameImage(const TextureImage& a, const TextureImage& b) {
+    if (a.Width != b.Width || a.Height != b.Height || a.Format != b.Format || a.Data != b.Data || a.Mips.size() != b.Mips.size()) return false;
+    for (size_t i = 0; i < a.Mips.size(); i++) {
+        if (memcmp(&a.Mips[i], &b.Mips[i], sizeof(TextureMip)) != 0) return false;
+    }
+    return true;
+}
+
+static bool Check(TextureCooker& cooker) {
+    bool ok = true;
+    const uint32_t size = 256;
+    std::vector<uint8_t> source = MakeColorMap(size, 7);
+    // Coverage ramps across the map for BC7's alpha
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) source[((size_t)y * size + x) * 4 + 3] = (uint8_t)(x * 255 / (size - 1));
+    }
+    const std::vector<TextureSource> sources = { EncodeSource(source, size, size) };
+
+    TextureImage bc1 = cooker.Cook(sources, TextureCompression::BC1)[0];
+    std::vector<uint8_t> opaque = source;
+    for (size_t i = 3; i < opaque.size(); i += 4) opaque[i] = 255; // BC1 drops alpha
+    const double bc1Error = bc1.Format == TextureFormat::Bc1Srgb ? BlockRmsError(bc1, opaque) : -1.0;
+    TextureImage bc7 = cooker.Cook(sources, TextureCompression::BC7)[0];
+    const double bc7Error = bc7.Format == TextureFormat::Bc7Srgb ? BlockRmsError(bc7, source) : -1.0;
+    // The map's +-12 grain is the floor for both
+    ok &= Report("bc1 error", bc1Error >= 0.0 && bc1Error < 7.0 && bc1.Mips.size() == 9);
+    ok &= Report("bc7 error", bc7Error >= 0.0 && bc7Error < bc1Error && bc7Error < 6.0);
+
+    // Black and white checker, alpha 0 on black and 255 on white
+    std::vector<uint8_t> checker(8 * 8 * 4);
+    for (uint32_t i = 0; i < 64; i++) memset(&checker[i * 4], ((i % 8) + (i / 8)) % 2 ? 255 : 0, 4);
+    const TextureImage mips = cooker.Cook({ EncodeSource(checker, 8, 8) }, TextureCompression::None)[0];
+    bool srgb = mips.Format == TextureFormat::Rgba8Srgb && mips.Mips.size() == 4 && mips.Mips[3].Width == 1;
+    for (size_t level = 1; srgb && level < mips.Mips.size(); level++) {
+        for (uint64_t i = 0; i < mips.Mips[level].Size; i += 4) {
+            const uint8_t* texel = &mips.Data[mips.Mips[level].Offset + i];
+            srgb &= texel[0] == 188 && texel[1] == 188 && texel[2] == 188 && std::abs(texel[3] - 128) <= 1;
+        }
+    }
+    std::vector<uint8_t> odd(5 * 3 * 4, 200);
+    const TextureImage oddMips = cooker.Cook({ EncodeSource(odd, 5, 3) }, TextureCompression::BC7)[0];
+    srgb &= oddMips.Format == TextureFormat::Rgba8Srgb && oddMips.Mips.size() == 3 && oddMips.Mips[1].Width == 2 &&
+            oddMips.Mips[1].Height == 1 && oddMips.Mips[2].Width == 1 && oddMips.Data.back() == 200;
+    ok &= Report("srgb mips", srgb);
+
+    const std::string cachePath = (std::filesystem::temp_directory_path() / "pelage_texture_check.ptex").string();
+    std::filesystem::remove(cachePath);
+    const std::vector<TextureSource> cachedSources = { EncodeSource(source, size, size, cachePath) };
+    const TextureImage cooked = cooker.Cook(cachedSources, TextureCompression::BC7)[0];
+    bool roundTrip = cooker.Stats().CacheHits == 0 && std::filesystem::exists(cachePath);
+    const TextureImage read = cooker.Cook(cachedSources, TextureCompression::BC7)[0];
+    roundTrip &= cooker.Stats().CacheHits == 1 && SameImage(read, cooked);
+    // Another compression or another source misses
+    roundTrip &= !cooker.Cook(cachedSources, TextureCompression::BC1)[0].Empty() && cooker.Stats().CacheHits == 0;
+    ok &= Report("cache round trip", roundTrip);
+
+    // Header fields, see TextureCacheHeader: Format at 20, Width at 24, MipCount at 32, DataSize at 40
+    std::vector<uint8_t> good;
+    cooker.Cook(cachedSources, TextureCompression::BC7);
+    {
+        std::ifstream file(cachePath, std::ios::binary);
+        good.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    auto patched = [&](size_t offset, uint64_t value, size_t bytes) {
+        std::vector<uint8_t> file = good;
+        memcpy(&file[offset], &value, bytes);
+        return file;
+    };
+    const std::vector<std::vector<uint8_t>> corrupt = {
+        std::vector<uint8_t>(good.begin(), good.begin() + good.size() / 2), std::vector<uint8_t>(good.begin(), good.begin() + 20),
+        patched(40, 1ull << 60, 8), patched(40, good.size(), 8), patched(20, 7, 4), patched(20, (uint32_t)TextureFormat::Bc1Srgb, 4),
+        patched(32, 3, 4), patched(24, 128, 4), patched(24, 0, 4),
+    };
+    bool fallback = !good.empty();
+    for (const std::vector<uint8_t>& file : corrupt) {
+        std::ofstream(cachePath, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(file.data()), file.size());
+        TextureImage image;
+        fallback &= !TextureCooker::ReadCache(cachePath, HashBytes(HashSeed, cachedSources[0].Encoded.data(), cachedSources[0].Encoded.size()),
+                                              TextureCompression::BC7, image);
+        const TextureImage recooked = cooker.Cook(cachedSources, TextureCompression::BC7)[0];
+        fallback &= cooker.Stats().CacheHits == 0 && cooker.Stats().Failed == 0 && SameImage(recooked, cooked);
+        // The re-cook rewrote a good entry
+        fallback &= SameImage(cooker.Cook(cachedSources, TextureCompression::BC7)[0], cooked) && cooker.Stats().CacheHits == 1;
+    }
+    ok &= Report("corrupt cache", fallback);
+    std::filesystem::remove(cachePath);
+    return ok;
+}
+
+static double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    const uint32_t sizes[] = { 512, 1024, 2048, 4096 };
+    const uint32_t batch = 4;
+    int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 3;
+
+    JobSystem jobs;
+    TextureCooker cooker(jobs);
+    bool ok = Check(cooker);
+    printf("\nTexture cooking, batches of %u PNGs, %u threads, %d iterations (median)\n", batch, jobs.ThreadCount(), iterations);
+    printf("%6s %8s %12s %12s %12s %12s\n", "size", "MP", "decode MP/s", "mips MP/s", "BC1 MP/s", "BC7 MP/s");
+
+    for (uint32_t size : sizes) {
+        std::vector<TextureSource> sources(batch);
+        for (uint32_t i = 0; i < batch; i++) {
+            std::vector<uint8_t> rgba = MakeColorMap(size, i + 1);
+            sources[i].Name = "bench" + std::to_string(i);
+            stbi_write_png_to_func(AppendBytes, &sources[i].Encoded, (int)size, (int)size, 4, rgba.data(), (int)size * 4);
+        }
+
+        std::vector<double> decodeMs, mipMs, bc1Ms, bc7Ms;
+        double megapixels = 0.0;
+        for (int i = 0; i < iterations; i++) {
+            cooker.Cook(sources, TextureCompression::BC1);
+            decodeMs.push_back(cooker.Stats().DecodeMs);
+            mipMs.push_back(cooker.Stats().MipMs);
+            bc1Ms.push_back(cooker.Stats().CompressMs);
+            megapixels = cooker.Stats().Megapixels;
+
+            cooker.Cook(sources, TextureCompression::BC7);
+            decodeMs.push_back(cooker.Stats().DecodeMs);
+            mipMs.push_back(cooker.Stats().MipMs);
+            bc7Ms.push_back(cooker.Stats().CompressMs);
+        }
+
+        printf("%6u %8.1f %12.1f %12.1f %12.1f %12.1f\n", size, megapixels, megapixels / Median(decodeMs) * 1000.0,
+               megapixels / Median(mipMs) * 1000.0, megapixels / Median(bc1Ms) * 1000.0, megapixels / Median(bc7Ms) * 1000.0);
+    }
+    return ok ? 0 : 1;
+}
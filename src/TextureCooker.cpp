@@ -0,0 +1,544 @@
+#include "TextureCooker.h"
+#include "Hash.h"
+#include "Simd.h"
+#include "Timing.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+// The only stb_image implementation in the build; tinygltf in GeometryGen links against it
+#define STB_IMAGE_IMPLEMENTATION
+#include "../third_party/tinygltf/stb_image.h"
+
+static const float* SrgbToLinearTable() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> t{};
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+// Linear [0, 1] quantized to 12 bits -> sRGB byte. 4096 steps keep the darkest sRGB codes
+// (about 1/3300 apart in linear) distinct.
+static const uint8_t* LinearToSrgbTable() {
+    static const std::array<uint8_t, 4096> table = [] {
+        std::array<uint8_t, 4096> t{};
+        for (int i = 0; i < 4096; i++) {
+            float c = i / 4095.0f;
+            float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            t[i] = (uint8_t)std::clamp((int)(s * 255.0f + 0.5f), 0, 255);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+bool TextureCooker::Decode(const std::vector<uint8_t>& encoded, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height) {
+    int w = 0, h = 0, components = 0;
+    stbi_uc* pixels = stbi_load_from_memory(encoded.data(), (int)encoded.size(), &w, &h, &components, 4);
+    if (!pixels) return false;
+    width = (uint32_t)w;
+    height = (uint32_t)h;
+    rgba.assign(pixels, pixels + (size_t)w * h * 4);
+    stbi_image_free(pixels);
+    return true;
+}
+
+// One output row of the next level: a 2x2 box in linear space (edge texels repeat on odd
+// sizes), kept in float for the following level and encoded back to sRGB bytes
+static void DownsampleRow(const float* src, uint32_t srcWidth, uint32_t srcHeight, float* dst, uint32_t dstWidth,
+                          uint32_t y, uint8_t* dstBytes) {
+    const uint8_t* toSrgb = LinearToSrgbTable();
+    const float* row0 = src + (size_t)std::min(2 * y, srcHeight - 1) * srcWidth * 4;
+    const float* row1 = src + (size_t)std::min(2 * y + 1, srcHeight - 1) * srcWidth * 4;
+    float* out = dst + (size_t)y * dstWidth * 4;
+    uint8_t* outBytes = dstBytes + (size_t)y * dstWidth * 4;
+
+    for (uint32_t x = 0; x < dstWidth; x++) {
+        size_t x0 = (size_t)std::min(2 * x, srcWidth - 1) * 4;
+        size_t x1 = (size_t)std::min(2 * x + 1, srcWidth - 1) * 4;
+#if PELAGE_SSE2
+        __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+                                _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+        __m128 texel = _mm_mul_ps(sum, _mm_set1_ps(0.25f));
+        _mm_storeu_ps(out + x * 4, texel);
+
+        // RGB to 12-bit table indices, alpha straight to a byte
+        __m128 clamped = _mm_min_ps(_mm_max_ps(texel, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        __m128i quantized = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, _mm_set_ps(255.0f, 4095.0f, 4095.0f, 4095.0f)),
+                                                        _mm_set1_ps(0.5f)));
+        alignas(16) int32_t q[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(q), quantized);
+        outBytes[x * 4 + 0] = toSrgb[q[0]];
+        outBytes[x * 4 + 1] = toSrgb[q[1]];
+        outBytes[x * 4 + 2] = toSrgb[q[2]];
+        outBytes[x * 4 + 3] = (uint8_t)q[3];
+#else
+        for (int c = 0; c < 4; c++) {
+            float texel = 0.25f * (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]);
+            out[x * 4 + c] = texel;
+            float clamped = std::clamp(texel, 0.0f, 1.0f);
+            outBytes[x * 4 + c] = c < 3 ? toSrgb[(int)(clamped * 4095.0f + 0.5f)] : (uint8_t)(clamped * 255.0f + 0.5f);
+        }
+#endif
+    }
+}
+
+// The full chain down to 1x1, packed back to back: rows of pixels for RGBA8, rows of 4x4 blocks
+// (8 bytes for BC1, 16 for BC7) for the compressed formats
+static std::vector<TextureMip> MipChain(uint32_t width, uint32_t height, TextureFormat format) {
+    const uint32_t blockBytes = format == TextureFormat::Bc1Srgb ? 8 : format == TextureFormat::Bc7Srgb ? 16 : 0;
+    std::vector<TextureMip> mips;
+    uint64_t offset = 0;
+    for (uint32_t w = width, h = height;; w = std::max(1u, w / 2), h = std::max(1u, h / 2)) {
+        TextureMip mip;
+        mip.Width = w;
+        mip.Height = h;
+        mip.RowPitch = blockBytes ? (w + 3) / 4 * blockBytes : w * 4;
+        mip.RowCount = blockBytes ? (h + 3) / 4 : h;
+        mip.Offset = offset;
+        mip.Size = (uint64_t)mip.RowPitch * mip.RowCount;
+        mips.push_back(mip);
+        offset += mip.Size;
+        if (w == 1 && h == 1) break;
+    }
+    return mips;
+}
+
+void TextureCooker::BuildMips(const uint8_t* rgba, uint32_t width, uint32_t height, TextureImage& image) {
+    image.Width = width;
+    image.Height = height;
+    image.Format = TextureFormat::Rgba8Srgb;
+    image.Mips = MipChain(width, height, image.Format);
+    image.Data.resize(image.Mips.back().Offset + image.Mips.back().Size);
+    memcpy(image.Data.data(), rgba, image.Mips[0].Size);
+
+    // Each level filters the previous one in float, so rounding never compounds down the chain
+    const float* toLinear = SrgbToLinearTable();
+    std::vector<float> current((size_t)width * height * 4), next;
+    m_jobs.ParallelFor(height, RowGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin * width * 4; i < end * width * 4; i += 4) {
+            current[i + 0] = toLinear[rgba[i + 0]];
+            current[i + 1] = toLinear[rgba[i + 1]];
+            current[i + 2] = toLinear[rgba[i + 2]];
+            current[i + 3] = rgba[i + 3] * (1.0f / 255.0f);
+        }
+    });
+    for (size_t level = 1; level < image.Mips.size(); level++) {
+        const TextureMip& src = image.Mips[level - 1];
+        const TextureMip& dst = image.Mips[level];
+        next.resize((size_t)dst.Width * dst.Height * 4);
+        uint8_t* dstBytes = image.Data.data() + dst.Offset;
+        m_jobs.ParallelFor(dst.Height, RowGrain, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; y++) {
+                DownsampleRow(current.data(), src.Width, src.Height, next.data(), dst.Width, (uint32_t)y, dstBytes);
+            }
+        });
+        current.swap(next);
+    }
+}
+
+// Endpoints along the block's principal axis: power iteration on the covariance, started from
+// the bounding box diagonal, then the extreme projections. 'channels' is 3 (alpha ignored) or 4.
+static void FitEndpoints(const float pixels[16][4], int channels, float lo[4], float hi[4]) {
+    float mean[4] = {}, minimum[4], maximum[4];
+    for (int c = 0; c < 4; c++) {
+        minimum[c] = maximum[c] = pixels[0][c];
+    }
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < channels; c++) {
+            mean[c] += pixels[i][c] * (1.0f / 16.0f);
+            minimum[c] = std::min(minimum[c], pixels[i][c]);
+            maximum[c] = std::max(maximum[c], pixels[i][c]);
+        }
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int a = 0; a < channels; a++) {
+            for (int b = a; b < channels; b++) {
+                covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+            }
+        }
+    }
+    for (int a = 0; a < channels; a++) {
+        for (int b = 0; b < a; b++) covariance[a][b] = covariance[b][a];
+    }
+
+    float axis[4] = {};
+    for (int c = 0; c < channels; c++) axis[c] = maximum[c] - minimum[c];
+    for (int iteration = 0; iteration < 4; iteration++) {
+        float next[4] = {};
+        float largest = 0.0f;
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+            largest = std::max(largest, std::abs(next[a]));
+        }
+        if (largest < 1e-6f) break; // Flat block: keep the diagonal
+        for (int c = 0; c < channels; c++) axis[c] = next[c] / largest;
+    }
+
+    float axisLengthSq = 0.0f;
+    for (int c = 0; c < channels; c++) axisLengthSq += axis[c] * axis[c];
+    float tMin = 0.0f, tMax = 0.0f;
+    if (axisLengthSq > 0.0f) {
+        for (int i = 0; i < 16; i++) {
+            float t = 0.0f;
+            for (int c = 0; c < channels; c++) t += (pixels[i][c] - mean[c]) * axis[c];
+            tMin = std::min(tMin, t);
+            tMax = std::max(tMax, t);
+        }
+        tMin /= axisLengthSq;
+        tMax /= axisLengthSq;
+    }
+    for (int c = 0; c < 4; c++) {
+        lo[c] = c < channels ? std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f) : 255.0f;
+        hi[c] = c < channels ? std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f) : 255.0f;
+    }
+}
+
+static uint16_t Pack565(const float color[4]) {
+    uint32_t r = (uint32_t)(color[0] * (31.0f / 255.0f) + 0.5f);
+    uint32_t g = (uint32_t)(color[1] * (63.0f / 255.0f) + 0.5f);
+    uint32_t b = (uint32_t)(color[2] * (31.0f / 255.0f) + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void Unpack565(uint16_t packed, int color[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Opaque four-colour mode only: color0 > color1
+static void CompressBlockBc1(const float pixels[16][4], uint8_t* out) {
+    float lo[4], hi[4];
+    FitEndpoints(pixels, 3, lo, hi);
+    uint16_t color0 = Pack565(hi), color1 = Pack565(lo);
+    if (color0 < color1) std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        Unpack565(color0, palette[0]);
+        Unpack565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            uint32_t best = 0;
+            float bestError = 1e30f;
+            for (uint32_t p = 0; p < 4; p++) {
+                float error = 0.0f;
+                for (int c = 0; c < 3; c++) {
+                    float d = pixels[i][c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+    // Equal endpoints select the three-colour mode, where index 0 is still color0
+
+    memcpy(out + 0, &color0, 2);
+    memcpy(out + 2, &color1, 2);
+    memcpy(out + 4, &indices, 4);
+}
+
+// 128-bit little-endian block, filled LSB first
+struct BlockBits {
+    uint64_t Words[2] = {};
+    uint32_t Position = 0;
+
+    void Put(uint64_t value, uint32_t count) {
+        uint32_t word = Position >> 6, shift = Position & 63;
+        Words[word] |= value << shift;
+        if (shift + count > 64) Words[word + 1] |= value >> (64 - shift);
+        Position += count;
+    }
+};
+
+// Mode 6: one subset, RGBA endpoints of 7 bits plus a shared-per-endpoint p-bit, 4-bit indices
+static void CompressBlockBc7(const float pixels[16][4], uint8_t* out) {
+    static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    float endpoints[2][4];
+    FitEndpoints(pixels, 4, endpoints[0], endpoints[1]);
+
+    // Pick each endpoint's p-bit by the smaller reconstruction error
+    uint32_t quantized[2][4], pbits[2];
+    int rgba[2][4];
+    for (int e = 0; e < 2; e++) {
+        float bestError = 1e30f;
+        for (uint32_t p = 0; p < 2; p++) {
+            uint32_t q[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                q[c] = (uint32_t)std::clamp((int)((endpoints[e][c] - p) * 0.5f + 0.5f), 0, 127);
+                float d = (float)((q[c] << 1) | p) - endpoints[e][c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                pbits[e] = p;
+                memcpy(quantized[e], q, sizeof(q));
+            }
+        }
+        for (int c = 0; c < 4; c++) rgba[e][c] = (int)((quantized[e][c] << 1) | pbits[e]);
+    }
+
+    int palette[16][4];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) palette[i][c] = ((64 - weights[i]) * rgba[0][c] + weights[i] * rgba[1][c] + 32) >> 6;
+    }
+
+    // Project onto the endpoint segment for a first guess, then settle between its neighbours
+    float axis[4], axisLengthSq = 0.0f;
+    for (int c = 0; c < 4; c++) {
+        axis[c] = (float)(rgba[1][c] - rgba[0][c]);
+        axisLengthSq += axis[c] * axis[c];
+    }
+    uint32_t indices[16];
+    for (int i = 0; i < 16; i++) {
+        int guess = 0;
+        if (axisLengthSq > 0.0f) {
+            float t = 0.0f;
+            for (int c = 0; c < 4; c++) t += (pixels[i][c] - rgba[0][c]) * axis[c];
+            guess = std::clamp((int)(t / axisLengthSq * 15.0f + 0.5f), 0, 15);
+        }
+        uint32_t best = (uint32_t)guess;
+        float bestError = 1e30f;
+        for (int candidate = std::max(guess - 1, 0); candidate <= std::min(guess + 1, 15); candidate++) {
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                float d = pixels[i][c] - palette[candidate][c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                best = (uint32_t)candidate;
+            }
+        }
+        indices[i] = best;
+    }
+
+    // The anchor (first) index is stored without its top bit: swapping the endpoints and
+    // mirroring the indices gives the same colours, since the weights are symmetric
+    if (indices[0] & 8) {
+        for (int c = 0; c < 4; c++) std::swap(quantized[0][c], quantized[1][c]);
+        std::swap(pbits[0], pbits[1]);
+        for (uint32_t& index : indices) index = 15 - index;
+    }
+
+    BlockBits bits;
+    bits.Put(1u << 6, 7); // Mode 6
+    for (int c = 0; c < 4; c++) {
+        bits.Put(quantized[0][c], 7);
+        bits.Put(quantized[1][c], 7);
+    }
+    bits.Put(pbits[0], 1);
+    bits.Put(pbits[1], 1);
+    bits.Put(indices[0], 3);
+    for (int i = 1; i < 16; i++) bits.Put(indices[i], 4);
+    memcpy(out, bits.Words, 16);
+}
+
+void TextureCooker::Compress(TextureImage& image, TextureCompression compression) {
+    if (compression == TextureCompression::None || image.Format != TextureFormat::Rgba8Srgb || image.Empty()) return;
+    if (image.Width % 4 != 0 || image.Height % 4 != 0) return;
+
+    const TextureFormat format = compression == TextureCompression::BC1 ? TextureFormat::Bc1Srgb : TextureFormat::Bc7Srgb;
+    const uint32_t blockBytes = format == TextureFormat::Bc1Srgb ? 8 : 16;
+    std::vector<TextureMip> mips = MipChain(image.Width, image.Height, format);
+    std::vector<uint8_t> data(mips.back().Offset + mips.back().Size);
+
+    for (size_t level = 0; level < mips.size(); level++) {
+        const TextureMip& src = image.Mips[level];
+        const TextureMip& dst = mips[level];
+        const uint8_t* pixels = image.Data.data() + src.Offset;
+        m_jobs.ParallelFor(dst.RowCount, RowGrain, [&](size_t begin, size_t end) {
+            float block[16][4];
+            for (size_t by = begin; by < end; by++) {
+                uint8_t* out = data.data() + dst.Offset + by * dst.RowPitch;
+                for (uint32_t bx = 0; bx < dst.RowPitch / blockBytes; bx++) {
+                    // Blocks hanging over the edge of the small mips repeat the last texels
+                    for (uint32_t i = 0; i < 16; i++) {
+                        uint32_t x = std::min(bx * 4 + (i & 3), src.Width - 1);
+                        uint32_t y = std::min((uint32_t)by * 4 + (i >> 2), src.Height - 1);
+                        const uint8_t* texel = pixels + ((size_t)y * src.Width + x) * 4;
+                        for (int c = 0; c < 4; c++) block[i][c] = texel[c];
+                    }
+                    if (compression == TextureCompression::BC1) {
+                        CompressBlockBc1(block, out + bx * blockBytes);
+                    } else {
+                        CompressBlockBc7(block, out + bx * blockBytes);
+                    }
+                }
+            }
+        });
+    }
+
+    image.Format = format;
+    image.Mips = std::move(mips);
+    image.Data = std::move(data);
+}
+
+// Cache file: header, mip table, then the level data exactly as TextureImage holds it
+struct TextureCacheHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint64_t SourceHash;
+    uint32_t Compression;
+    uint32_t Format;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t MipCount;
+    uint32_t Reserved;
+    uint64_t DataSize;
+};
+
+bool TextureCooker::ReadCache(const std::string& path, uint64_t sourceHash, TextureCompression compression, TextureImage& image) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    const uint64_t fileSize = (uint64_t)file.tellg();
+    file.seekg(0);
+
+    // Nothing in the file is trusted: the header has to describe exactly the chain this cooker
+    // would have written, and fit in the file, before anything is allocated from it
+    const uint32_t maxDimension = 16384; // D3D12's largest 2D texture
+    TextureCacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if (memcmp(header.Magic, "PTEX", 4) != 0 || header.Version != CacheVersion || header.SourceHash != sourceHash ||
+        header.Compression != (uint32_t)compression || header.Width == 0 || header.Height == 0 || header.Width > maxDimension ||
+        header.Height > maxDimension) {
+        return false;
+    }
+    // RGBA8 is also what BC1 / BC7 cooks fall back to when the size isn't a multiple of 4
+    const TextureFormat format = (TextureFormat)header.Format;
+    const bool blockCompressed = format == TextureFormat::Bc1Srgb || format == TextureFormat::Bc7Srgb;
+    if (format != TextureFormat::Rgba8Srgb && !blockCompressed) return false;
+    if (blockCompressed && (format != (compression == TextureCompression::BC1 ? TextureFormat::Bc1Srgb : TextureFormat::Bc7Srgb) ||
+                            header.Width % 4 != 0 || header.Height % 4 != 0)) {
+        return false;
+    }
+    const std::vector<TextureMip> expected = MipChain(header.Width, header.Height, format);
+    const uint64_t tableSize = expected.size() * sizeof(TextureMip);
+    if (header.MipCount != expected.size() || header.DataSize != expected.back().Offset + expected.back().Size ||
+        sizeof(header) + tableSize + header.DataSize > fileSize) {
+        return false;
+    }
+
+    std::vector<TextureMip> mips(header.MipCount);
+    if (!file.read(reinterpret_cast<char*>(mips.data()), tableSize)) return false;
+    for (size_t level = 0; level < mips.size(); level++) {
+        const TextureMip& mip = mips[level];
+        const TextureMip& want = expected[level];
+        if (mip.Width != want.Width || mip.Height != want.Height || mip.RowPitch != want.RowPitch || mip.RowCount != want.RowCount ||
+            mip.Offset != want.Offset || mip.Size != want.Size) {
+            return false;
+        }
+    }
+
+    image.Width = header.Width;
+    image.Height = header.Height;
+    image.Format = format;
+    image.Mips = std::move(mips);
+    image.Data.resize(header.DataSize);
+    if (!file.read(reinterpret_cast<char*>(image.Data.data()), image.Data.size())) {
+        image = TextureImage();
+        return false;
+    }
+    return true;
+}
+
+bool TextureCooker::WriteCache(const std::string& path, uint64_t sourceHash, TextureCompression compression, const TextureImage& image) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    TextureCacheHeader header = {};
+    memcpy(header.Magic, "PTEX", 4);
+    header.Version = CacheVersion;
+    header.SourceHash = sourceHash;
+    header.Compression = (uint32_t)compression;
+    header.Format = (uint32_t)image.Format;
+    header.Width = image.Width;
+    header.Height = image.Height;
+    header.MipCount = (uint32_t)image.Mips.size();
+    header.DataSize = image.Data.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(image.Mips.data()), image.Mips.size() * sizeof(TextureMip));
+    file.write(reinterpret_cast<const char*>(image.Data.data()), image.Data.size());
+    return (bool)file;
+}
+
+std::vector<TextureImage> TextureCooker::Cook(const std::vector<TextureSource>& sources, TextureCompression compression) {
+    m_stats = TextureCookStats();
+    m_stats.Images = (uint32_t)sources.size();
+
+    const size_t count = sources.size();
+    std::vector<TextureImage> images(count);
+    std::vector<uint64_t> hashes(count);
+    std::vector<std::vector<uint8_t>> decoded(count);
+    std::vector<uint32_t> widths(count), heights(count);
+    std::vector<uint8_t> cached(count, 0);
+
+    // Cache probes and decodes, one image per job: stb_image is single-threaded per image
+    Clock::time_point start = Clock::now();
+    m_jobs.ParallelFor(count, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            hashes[i] = HashBytes(HashSeed, sources[i].Encoded.data(), sources[i].Encoded.size());
+            if (!sources[i].CachePath.empty() && ReadCache(sources[i].CachePath, hashes[i], compression, images[i])) {
+                cached[i] = 1;
+            } else if (!Decode(sources[i].Encoded, decoded[i], widths[i], heights[i])) {
+                decoded[i].clear();
+            }
+        }
+    });
+    m_stats.DecodeMs = MillisecondsSince(start);
+
+    // Mips and compression parallelize inside each image
+    for (size_t i = 0; i < count; i++) {
+        images[i].Name = sources[i].Name;
+        if (cached[i]) {
+            m_stats.CacheHits++;
+            continue;
+        }
+        if (decoded[i].empty()) {
+            m_stats.Failed++;
+            continue;
+        }
+        m_stats.Megapixels += widths[i] * (double)heights[i] * 1e-6;
+
+        start = Clock::now();
+        BuildMips(decoded[i].data(), widths[i], heights[i], images[i]);
+        m_stats.MipMs += MillisecondsSince(start);
+        decoded[i] = std::vector<uint8_t>();
+
+        start = Clock::now();
+        Compress(images[i], compression);
+        m_stats.CompressMs += MillisecondsSince(start);
+    }
+
+    start = Clock::now();
+    m_jobs.ParallelFor(count, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (!cached[i] && !images[i].Empty() && !sources[i].CachePath.empty()) {
+                WriteCache(sources[i].CachePath, hashes[i], compression, images[i]);
+            }
+        }
+    });
+    m_stats.CacheMs = MillisecondsSince(start);
+    return images;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "JobSystem.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Colour map ingestion: decode (stb_image), sRGB-correct mips and optional block compression,
+// with the result cached on disk so later loads skip all three. Images are decoded in parallel
+// across the job system; mip filtering and compression split each level into row bands.
+// Colour data is treated as sRGB, alpha as linear coverage.
+
+enum class TextureFormat : uint32_t {
+    Rgba8Srgb = 0,
+    Bc1Srgb = 1,   // 4 bpp, opaque RGB
+    Bc7Srgb = 2,   // 8 bpp, mode 6 only (RGBA, one subset)
+};
+
+enum class TextureCompression { None, BC1, BC7 };
+
+struct TextureMip {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t RowPitch = 0; // Bytes per row of pixels, or per row of 4x4 blocks
+    uint32_t RowCount = 0; // Pixel rows, or block rows
+    uint64_t Offset = 0;   // Into TextureImage::Data
+    uint64_t Size = 0;
+};
+
+struct TextureImage {
+    std::string Name;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    TextureFormat Format = TextureFormat::Rgba8Srgb;
+    std::vector<TextureMip> Mips; // Full chain down to 1x1
+    std::vector<uint8_t> Data;
+
+    bool Empty() const { return Mips.empty(); }
+};
+
+struct TextureSource {
+    std::string Name;
+    std::vector<uint8_t> Encoded; // PNG/JPEG/... file bytes
+    std::string CachePath;        // Empty to skip the disk cache
+};
+
+struct TextureCookStats {
+    uint32_t Images = 0;
+    uint32_t CacheHits = 0;
+    uint32_t Failed = 0;
+    double Megapixels = 0.0; // Top levels of the images actually cooked
+    double DecodeMs = 0.0;   // Cache probes and decodes, all images in parallel
+    double MipMs = 0.0;
+    double CompressMs = 0.0;
+    double CacheMs = 0.0;    // Writing new cache entries
+};
+
+class TextureCooker {
+public:
+    static constexpr uint32_t CacheVersion = 1;
+
+    explicit TextureCooker(JobSystem& jobs) : m_jobs(jobs) {}
+
+    // One image per source, in order. A source that fails to decode yields an empty image.
+    // Compression falls back to RGBA8 for images whose size is not a multiple of 4, which
+    // D3D12 requires of block-compressed top levels.
+    std::vector<TextureImage> Cook(const std::vector<TextureSource>& sources, TextureCompression compression);
+
+    // The stages Cook runs, exposed for the benchmark
+    static bool Decode(const std::vector<uint8_t>& encoded, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height);
+    // RGBA8 sRGB chain from a top level; filters in linear space with a 2x2 box
+    void BuildMips(const uint8_t* rgba, uint32_t width, uint32_t height, TextureImage& image);
+    // Compresses an RGBA8 chain in place
+    void Compress(TextureImage& image, TextureCompression compression);
+
+    static bool ReadCache(const std::string& path, uint64_t sourceHash, TextureCompression compression, TextureImage& image);
+    static bool WriteCache(const std::string& path, uint64_t sourceHash, TextureCompression compression, const TextureImage& image);
+
+    const TextureCookStats& Stats() const { return m_stats; }
+
+private:
+    static constexpr size_t RowGrain = 16; // Output rows (pixel or block) per job
+
+    JobSystem& m_jobs;
+    TextureCookStats m_stats;
+};
@@ -0,0 +1,9 @@
+#pragma once
+#include <chrono>
+
+// Wall-clock timing for the per-call stats the CPU modules and headless benches report.
+using Clock = std::chrono::steady_clock;
+
+inline double MillisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
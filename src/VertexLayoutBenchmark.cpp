@@ -0,0 +1,191 @@
+// Headless vertex layout benchmark: the same bounds and normal-recompute kernels over the
+// interleaved GPU layout and over MeshStreams (structure of arrays). First checks on cases with
+// known answers:
+//   round trip        interleaved -> streams -> interleaved is bit-exact, odd counts and wider strides
+//   bounds            match CoreMath's ComputeBounds exactly
+//   layouts agree     both normal kernels give the same normals
+//   sphere normals    recomputed normals of a generated icosphere point away from its centre
+//   base vertex       a sub-range of the vertices with its own indices, as GeometryGen uses it
+//   lone vertex       a vertex no triangle uses, and a degenerate triangle, get +Y
+// Then times each kernel on icospheres of 100K, 1M and 4M vertices (or up to the count given),
+// with the conversions to and from the streams timed separately.
+// Usage: PelageVertexLayoutBench [max vertices]
+#include "BenchReport.h"
+#include "MeshFile.h"
+#include "MeshStreams.h"
+#include "SceneGen.h"
+#include "Simd.h"
+#include "Timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static constexpr size_t Stride = MeshArrays::VertexStride;
+
+// Best of 'repeats' runs, in milliseconds
+template <typename Kernel>
+static double Time(int repeats, Kernel kernel) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        Clock::time_point start = Clock::now();
+        kernel();
+        best = std::min(best, MillisecondsSince(start));
+    }
+    return best;
+}
+
+// The fairest interleaved bounds: one unaligned load per vertex, xyz and a normal lane ignored
+static Aabb InterleavedBoundsSse2(const float* vertices, size_t count) {
+#if PELAGE_SSE2
+    if (count == 0) return Aabb();
+    __m128 low = _mm_loadu_ps(vertices), high = low;
+    for (size_t i = 1; i < count; i++) {
+        const __m128 p = _mm_loadu_ps(vertices + i * Stride);
+        low = _mm_min_ps(low, p);
+        high = _mm_max_ps(high, p);
+    }
+    alignas(16) float l[4], h[4];
+    _mm_store_ps(l, low);
+    _mm_store_ps(h, high);
+    Aabb bounds;
+    bounds.Expand(Float3(l[0], l[1], l[2]));
+    bounds.Expand(Float3(h[0], h[1], h[2]));
+    return bounds;
+#else
+    return ComputeBounds(vertices, count, Stride);
+#endif
+}
+
+static bool SameBounds(const Aabb& a, const Aabb& b) {
+    return a.Min.x == b.Min.x && a.Min.y == b.Min.y && a.Min.z == b.Min.z && a.Max.x == b.Max.x && a.Max.y == b.Max.y &&
+           a.Max.z == b.Max.z;
+}
+
+static float MaxNormalDifference(const float* vertices, size_t count, const MeshStreams& streams) {
+    float worst = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        const float* n = vertices + i * Stride + 3;
+        worst = std::max({ worst, std::fabs(n[0] - streams.NormalX[i]), std::fabs(n[1] - streams.NormalY[i]),
+                           std::fabs(n[2] - streams.NormalZ[i]) });
+    }
+    return worst;
+}
+
+static MeshArrays MakeIcosphere(JobSystem& jobs, uint64_t vertices) {
+    SynthScene scene;
+    SynthObject sphere;
+    sphere.Shape = SynthShape::Icosphere;
+    sphere.Resolution = SceneGen::ResolutionFor(SynthShape::Icosphere, vertices * 2); // About two triangles per vertex
+    scene.Objects.push_back(sphere);
+    MeshArrays mesh;
+    SceneGen(jobs).Generate(scene, mesh);
+    return mesh;
+}
+
+static bool Check(JobSystem& jobs) {
+    bool ok = true;
+
+    // Odd count, so the transposes and the scalar tail both run; and a stride with extra floats
+    const size_t count = 1003, wide = 11;
+    std::vector<float> source(count * wide), back(count * wide, -1.0f);
+    for (size_t i = 0; i < source.size(); i++) source[i] = std::sin((float)i * 0.37f) * 10.0f;
+    MeshStreams streams;
+    streams.Load(source.data(), count, wide);
+    streams.Store(back.data(), wide);
+    bool exact = true;
+    for (size_t i = 0; i < count; i++) {
+        exact &= memcmp(&source[i * wide], &back[i * wide], Stride * sizeof(float)) == 0;
+        exact &= back[i * wide + Stride] == -1.0f; // Beyond the GPU layout: untouched
+    }
+    exact &= streams.UV[2 * 1001 + 1] == source[1001 * wide + 7] && streams.PosX.size() == 1004 && streams.PosX[1003] == 0.0f;
+    ok &= Report("round trip", exact);
+
+    MeshArrays sphere = MakeIcosphere(jobs, 20000);
+    const size_t sphereCount = sphere.VertexCount();
+    streams.Load(sphere.Vertices.data(), sphereCount, Stride);
+    const Aabb reference = ComputeBounds(sphere.Vertices.data(), sphereCount, Stride);
+    ok &= Report("bounds", SameBounds(MeshKernels::Bounds(streams.Positions()), reference) &&
+                           SameBounds(InterleavedBoundsSse2(sphere.Vertices.data(), sphereCount), reference));
+
+    MeshKernels::ComputeNormals(streams, sphere.Indices.data(), sphere.TriangleCount());
+    MeshKernels::ComputeNormals(sphere.Vertices.data(), sphereCount, Stride, sphere.Indices.data(), sphere.TriangleCount());
+    ok &= Report("layouts agree", MaxNormalDifference(sphere.Vertices.data(), sphereCount, streams) <= 1e-6f);
+
+    // Unit sphere at the origin: the position is the outward normal
+    float worstDot = 1.0f;
+    for (size_t i = 0; i < sphereCount; i++) {
+        const float* v = &sphere.Vertices[i * Stride];
+        worstDot = std::min(worstDot, Dot(Normalize(Float3(v[0], v[1], v[2])), Float3(v[3], v[4], v[5])));
+    }
+    ok &= Report("sphere normals", worstDot > 0.999f);
+
+    // The second half of the sphere's vertices as their own mesh, indexed from the middle
+    const uint32_t base = (uint32_t)(sphereCount / 2);
+    std::vector<uint32_t> upper;
+    for (size_t t = 0; t < sphere.TriangleCount(); t++) {
+        const uint32_t* tri = &sphere.Indices[t * 3];
+        if (tri[0] >= base && tri[1] >= base && tri[2] >= base) upper.insert(upper.end(), tri, tri + 3);
+    }
+    MeshStreams part;
+    part.Load(&sphere.Vertices[base * Stride], sphereCount - base, Stride);
+    MeshKernels::ComputeNormals(part, upper.data(), upper.size() / 3, base);
+    std::vector<float> partVertices(sphere.Vertices.begin() + base * Stride, sphere.Vertices.end());
+    MeshKernels::ComputeNormals(partVertices.data(), sphereCount - base, Stride, upper.data(), upper.size() / 3, base);
+    ok &= Report("base vertex", MaxNormalDifference(partVertices.data(), sphereCount - base, part) <= 1e-6f);
+
+    // Vertex 3 is in no triangle; 4-5-6 lie on a line
+    const float loose[7 * Stride] = {
+        0, 0, 0, 9, 9, 9, 0, 0,   1, 0, 0, 9, 9, 9, 0, 0,   0, 0, 1, 9, 9, 9, 0, 0,   5, 5, 5, 9, 9, 9, 0, 0,
+        0, 2, 0, 9, 9, 9, 0, 0,   1, 2, 0, 9, 9, 9, 0, 0,   2, 2, 0, 9, 9, 9, 0, 0,
+    };
+    const uint32_t looseIndices[] = { 0, 1, 2, 4, 5, 6 };
+    MeshStreams lone;
+    lone.Load(loose, 7, Stride);
+    MeshKernels::ComputeNormals(lone, looseIndices, 2);
+    // Cross(b - a, c - a) of the first triangle is -Y
+    bool loneOk = lone.NormalY[0] == -1.0f && lone.NormalY[1] == -1.0f && lone.NormalY[2] == -1.0f;
+    for (size_t i = 3; i < 7; i++) loneOk &= lone.NormalX[i] == 0.0f && lone.NormalY[i] == 1.0f && lone.NormalZ[i] == 0.0f;
+    ok &= Report("lone vertex", loneOk);
+    return ok;
+}
+
+static void Benchmark(JobSystem& jobs, uint64_t maxVertices) {
+    printf("\n%10s %12s %12s %12s %12s %12s %10s %10s\n", "vertices", "bounds AoS", "AoS SSE2", "SoA SSE2",
+           "normals AoS", "normals SoA", "to SoA", "from SoA");
+    for (uint64_t target : { 100000ull, 1000000ull, 4000000ull }) {
+        if (target > maxVertices) break;
+        MeshArrays mesh = MakeIcosphere(jobs, target);
+        const size_t count = mesh.VertexCount(), triangles = mesh.TriangleCount();
+        const int repeats = count > 2000000 ? 5 : 20;
+        MeshStreams streams;
+        std::vector<float> out(mesh.Vertices.size());
+
+        // Results are folded into a sink so the compiler can't drop the calls
+        volatile float sink = 0.0f;
+        const double toSoA = Time(repeats, [&] { streams.Load(mesh.Vertices.data(), count, Stride); });
+        const double fromSoA = Time(repeats, [&] { streams.Store(out.data(), Stride); });
+        const double boundsScalar = Time(repeats, [&] { sink = sink + ComputeBounds(mesh.Vertices.data(), count, Stride).Max.x; });
+        const double boundsAoS = Time(repeats, [&] { sink = sink + InterleavedBoundsSse2(mesh.Vertices.data(), count).Max.x; });
+        const double boundsSoA = Time(repeats, [&] { sink = sink + MeshKernels::Bounds(streams.Positions()).Max.x; });
+        const double normalsAoS = Time(repeats, [&] {
+            MeshKernels::ComputeNormals(mesh.Vertices.data(), count, Stride, mesh.Indices.data(), triangles);
+        });
+        const double normalsSoA = Time(repeats, [&] { MeshKernels::ComputeNormals(streams, mesh.Indices.data(), triangles); });
+
+        printf("%10zu %9.3f ms %9.3f ms %9.3f ms %9.3f ms %9.3f ms %7.3f ms %7.3f ms\n", count, boundsScalar, boundsAoS,
+               boundsSoA, normalsAoS, normalsSoA, toSoA, fromSoA);
+        printf("%10s bounds %.1fx faster than scalar AoS, %.1fx than SSE2 AoS; normals %.2fx; %.2f GB/s to SoA\n", "",
+               boundsScalar / boundsSoA, boundsAoS / boundsSoA, normalsAoS / normalsSoA,
+               count * Stride * sizeof(float) / (toSoA * 1e6));
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint64_t maxVertices = argc > 1 ? (uint64_t)std::max(atoll(argv[1]), 1000ll) : 4000000;
+    JobSystem jobs;
+    bool ok = Check(jobs);
+    Benchmark(jobs, maxVertices);
+    return ok ? 0 : 1;
+}
@@ -1,5 +1,6 @@
 #include "FurRenderer.h"
 #include <iostream>
+#include <sstream>
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
     if (msg == WM_DESTROY) {
@@ -9,7 +10,21 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
     return DefWindowProc(hwnd, msg, wparam, lparam);
 }
 
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, PSTR, int) {
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, PSTR cmdLine, int) {
+    // -script <file.json> plays a frame script, -record <file.json> records the session into one,
+    // -synthetic <triangles> draws a generated scene instead of the carpet, -furres <half|full|compare>
+    // picks the fur resolution (compare alternates both every frame and reports their GPU times)
+    std::string scriptPath, recordPath, furResolution;
+    uint64_t syntheticTriangles = 0;
+    std::istringstream args(cmdLine ? cmdLine : "");
+    for (std::string arg; args >> arg;) {
+        if (arg == "-script") args >> scriptPath;
+        else if (arg == "-record") args >> recordPath;
+        else if (arg == "-synthetic") args >> syntheticTriangles;
+        else if (arg == "-furres") args >> furResolution;
+    }
+
+
     // Register Window Class
     WNDCLASS wc = {};
     wc.lpfnWndProc = WndProc;
@@ -31,7 +46,25 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, PSTR, int) {
 
     // Initialize Renderer
     FurRenderer renderer(hwnd, width, height);
+    if (syntheticTriangles > 0) {
+        SynthScatterSettings settings;
+        settings.Triangles = syntheticTriangles;
+        renderer.UseSyntheticScene(SceneGen::Scatter(settings));
+    }
+    if (furResolution == "full") renderer.SetFurResolution(FurRenderer::FurResolution::Full);
+    else if (furResolution == "compare") renderer.SetFurResolution(FurRenderer::FurResolution::Compare);
     renderer.Init();
+    if (!scriptPath.empty()) {
+        FrameScript script;
+        if (script.Load(scriptPath)) {
+            renderer.PlayScript(script);
+        } else {
+            MessageBox(hwnd, ("Failed to load frame script " + scriptPath).c_str(), "Error", MB_OK);
+        }
+    }
+    if (!recordPath.empty()) {
+        renderer.RecordTo(recordPath);
+    }
 
     // Main Loop
     MSG msg = {};